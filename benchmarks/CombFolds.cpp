@@ -0,0 +1,72 @@
+//===- CombFolds.cpp - Comb folding benchmarks ----------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file benchmarks the folders and canonicalization patterns of the Comb
+// dialect on chains of wide arithmetic, which spend most of their time in
+// APInt operations on multi-word values.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Comb/CombDialect.h"
+#include "circt/Dialect/HW/HWDialect.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/Passes.h"
+#include "benchmark/benchmark.h"
+
+using namespace mlir;
+using namespace circt;
+
+/// Return a module whose output is computed by `length` steps of arithmetic
+/// on `width`-bit values. Each step combines the previous one with constants
+/// that fold together, and with a product of constants that folds away.
+static std::string getArithmeticChain(unsigned length, unsigned width) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  os << "hw.module @Chain(%a: i" << width << ") -> (%o: i" << width << ") {\n";
+  std::string prev = "%a";
+  for (unsigned i = 0; i < length; ++i) {
+    os << "  %c" << i << " = hw.constant " << (i * 7919 + 1) << " : i" << width
+       << "\n";
+    os << "  %d" << i << " = hw.constant -" << (i * 104729 + 3) << " : i"
+       << width << "\n";
+    os << "  %p" << i << " = comb.mul %c" << i << ", %d" << i << " : i"
+       << width << "\n";
+    os << "  %s" << i << " = comb.add " << prev << ", %c" << i << ", %p" << i
+       << " : i" << width << "\n";
+    os << "  %x" << i << " = comb.xor %s" << i << ", %d" << i << " : i"
+       << width << "\n";
+    prev = "%x" + std::to_string(i);
+  }
+  os << "  hw.output " << prev << " : i" << width << "\n}\n";
+  return os.str();
+}
+
+static void BM_CombCanonicalize(benchmark::State &state) {
+  MLIRContext context;
+  context.loadDialect<hw::HWDialect, comb::CombDialect>();
+  OwningModuleRef source = parseSourceString(
+      getArithmeticChain(state.range(0), state.range(1)), &context);
+  assert(source && "the generated module should parse");
+
+  PassManager pm(&context);
+  pm.addPass(createCanonicalizerPass());
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    OwningModuleRef module(source->clone());
+    state.ResumeTiming();
+    if (failed(pm.run(*module)))
+      state.SkipWithError("canonicalization failed");
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CombCanonicalize)->Ranges({{1 << 6, 1 << 12}, {32, 256}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,77 @@
+//===- FieldRef.cpp - FieldRef hashing benchmarks -------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file benchmarks DenseMaps keyed by FieldRef, as used by the FIRRTL
+// passes which track the fields of aggregate values, such as InferWidths and
+// ExpandWhens.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Support/FieldRef.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "llvm/ADT/DenseMap.h"
+#include "benchmark/benchmark.h"
+
+using namespace mlir;
+using namespace circt;
+
+namespace {
+/// A module holding the specified number of values, each of them standing for
+/// an aggregate with `numFields` fields.
+struct FieldRefFixture {
+  FieldRefFixture(unsigned numValues, unsigned numFields) {
+    context.allowUnregisteredDialects();
+    auto loc = UnknownLoc::get(&context);
+    module = ModuleOp::create(loc);
+    auto builder = OpBuilder::atBlockEnd(module->getBody());
+    for (unsigned i = 0; i < numValues; ++i) {
+      OperationState state(loc, "bench.value");
+      state.addTypes(builder.getI32Type());
+      auto value = builder.createOperation(state)->getResult(0);
+      for (unsigned field = 0; field < numFields; ++field)
+        fieldRefs.push_back(FieldRef(value, field));
+    }
+  }
+
+  MLIRContext context;
+  OwningModuleRef module;
+  SmallVector<FieldRef> fieldRefs;
+};
+} // namespace
+
+static void BM_FieldRefMapInsert(benchmark::State &state) {
+  FieldRefFixture fixture(state.range(0), state.range(1));
+  for (auto _ : state) {
+    DenseMap<FieldRef, unsigned> map;
+    for (auto fieldRef : fixture.fieldRefs)
+      map.insert({fieldRef, fieldRef.getFieldID()});
+    benchmark::DoNotOptimize(map.size());
+  }
+  state.SetItemsProcessed(state.iterations() * fixture.fieldRefs.size());
+}
+BENCHMARK(BM_FieldRefMapInsert)
+    ->Ranges({{1 << 8, 1 << 16}, {1, 16}});
+
+static void BM_FieldRefMapLookup(benchmark::State &state) {
+  FieldRefFixture fixture(state.range(0), state.range(1));
+  DenseMap<FieldRef, unsigned> map;
+  for (auto fieldRef : fixture.fieldRefs)
+    map.insert({fieldRef, fieldRef.getFieldID()});
+  for (auto _ : state) {
+    unsigned sum = 0;
+    for (auto fieldRef : fixture.fieldRefs)
+      sum += map.lookup(fieldRef);
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * fixture.fieldRefs.size());
+}
+BENCHMARK(BM_FieldRefMapLookup)
+    ->Ranges({{1 << 8, 1 << 16}, {1, 16}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,94 @@
+//===- InstanceGraph.cpp - FIRRTL InstanceGraph benchmarks ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file benchmarks building the FIRRTL InstanceGraph of a circuit and
+// walking it, which most of the circuit-level FIRRTL passes start with.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/FIRRTL/FIRRTLDialect.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Parser.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "benchmark/benchmark.h"
+
+using namespace mlir;
+using namespace circt;
+using namespace firrtl;
+
+namespace {
+/// A circuit whose modules form a binary tree: module `Mi` instantiates the
+/// modules `M2i+1` and `M2i+2`.
+struct CircuitFixture {
+  explicit CircuitFixture(unsigned numModules) {
+    context.loadDialect<FIRRTLDialect>();
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    os << "firrtl.circuit \"M0\" {\n";
+    for (unsigned i = 0; i < numModules; ++i) {
+      os << "  firrtl.module @M" << i << "() {\n";
+      for (unsigned child = 2 * i + 1; child <= 2 * i + 2; ++child)
+        if (child < numModules)
+          os << "    firrtl.instance @M" << child << " {name = \"i" << child
+             << "\"}\n";
+      os << "  }\n";
+    }
+    os << "}\n";
+    module = parseSourceString(os.str(), &context);
+    assert(module && "the generated circuit should parse");
+    circuit = *module->getBody()->getOps<CircuitOp>().begin();
+  }
+
+  MLIRContext context;
+  OwningModuleRef module;
+  CircuitOp circuit;
+};
+} // namespace
+
+static void BM_InstanceGraphBuild(benchmark::State &state) {
+  CircuitFixture fixture(state.range(0));
+  for (auto _ : state) {
+    InstanceGraph instanceGraph(fixture.circuit);
+    benchmark::DoNotOptimize(instanceGraph.getTopLevelNode());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InstanceGraphBuild)->Range(1 << 6, 1 << 14);
+
+static void BM_InstanceGraphPostOrder(benchmark::State &state) {
+  CircuitFixture fixture(state.range(0));
+  InstanceGraph instanceGraph(fixture.circuit);
+  for (auto _ : state) {
+    unsigned numNodes = 0;
+    for (auto *node : llvm::post_order(&instanceGraph))
+      numNodes += node->getModule() != nullptr;
+    benchmark::DoNotOptimize(numNodes);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_InstanceGraphPostOrder)->Range(1 << 6, 1 << 14);
+
+static void BM_InstanceGraphLookup(benchmark::State &state) {
+  CircuitFixture fixture(state.range(0));
+  InstanceGraph instanceGraph(fixture.circuit);
+  SmallVector<Operation *> modules;
+  for (auto &op : *fixture.circuit.getBody())
+    modules.push_back(&op);
+  for (auto _ : state) {
+    unsigned numInstances = 0;
+    for (auto *module : modules)
+      for (auto *record : *instanceGraph.lookup(module))
+        numInstances += record->getTarget() != nullptr;
+    benchmark::DoNotOptimize(numInstances);
+  }
+  state.SetItemsProcessed(state.iterations() * modules.size());
+}
+BENCHMARK(BM_InstanceGraphLookup)->Range(1 << 6, 1 << 14);
+
+BENCHMARK_MAIN();
@@ -84,6 +84,7 @@ class module:
     # If it's a module parameterization function, inspect the arguments to
     # ensure sanity.
     self.func = func_or_class
+    self._parameterizations = {}
     self.sig = inspect.signature(self.func)
     for (_, param) in self.sig.parameters.items():
       if param.kind == param.VAR_KEYWORD:
@@ -95,15 +96,19 @@ class module:
   #   - In the case of a module function parameterizer, it is called when the
   #   user wants to apply specific parameters to the module. In this case, we
   #   should call the function, wrap the returned module class, and return it.
-  #   We _could_ also cache it, though that's not strictly necessary unless the
-  #   user is breaking the rules. TODO: cache it (requires all the parameters to
-  #   be hashable).
+  #   The module classes are cached by parameter values, so that a
+  #   parameterization is only wrapped (and its generators registered) once.
   #   - A simple (non-parameterized) module has been wrapped and the user wants
   #   to construct one. Just forward to the module class' constructor.
   def __call__(self, *args, **kwargs):
     if self.func is not None:
       param_values = self.sig.bind(*args, **kwargs)
       param_values.apply_defaults()
+
+      cache_key = _parameters_key(param_values.arguments)
+      if cache_key in self._parameterizations:
+        return self._parameterizations[cache_key][0]
+
       cls = self.func(*args, **kwargs)
       if cls is None:
         raise ValueError("Parameterization function must return module class")
@@ -120,6 +125,9 @@ class module:
         _register_generator(cls.__name__, "extern_instantiate",
                             self._instantiate,
                             mlir.ir.DictAttr.get(mod._parameters))
+      # Keep the arguments alive along with the class, since the objects among
+      # them are keyed by their id.
+      self._parameterizations[cache_key] = (mod, param_values.arguments)
       return mod
 
     return self.mod(*args, **kwargs)
@@ -163,6 +171,30 @@ class module:
       return inst
 
 
+def _parameters_key(arguments):
+  """Return a hashable key for the values of the arguments of a module
+  parameterization function."""
+  return tuple((name, _value_key(value)) for (name, value) in arguments.items())
+
+
+def _value_key(value):
+  """Return a hashable key for a parameter value. Values are keyed by their type
+  along with their value, so that e.g. None, False and 0 differ. Containers are
+  keyed by their elements, MLIR attributes and types by their assembly, and any
+  other object, such as a function, by its identity since its behavior can't be
+  compared."""
+  if value is None or isinstance(value, (bool, int, float, str)):
+    return (type(value), value)
+  if isinstance(value, (mlir.ir.Attribute, mlir.ir.Type)):
+    return (type(value), str(value))
+  if isinstance(value, (list, tuple)):
+    return (type(value), tuple(_value_key(v) for v in value))
+  if isinstance(value, dict):
+    return (dict,
+            tuple((_value_key(k), _value_key(v)) for (k, v) in value.items()))
+  return (type(value), id(value))
+
+
 def externmodule(cls_or_name):
   """Wrap an externally implemented module. If no name given in the decorator
   argument, use the class name."""
@@ -340,6 +372,12 @@ def _register_generator(class_name, generator_name, generator, parameters):
                                 generator_name, generator, parameters)
 
 
+# The modules built by the generators, by module name, along with the top level
+# MLIR module they were built in. This is only filled while the generators run,
+# see System.generate, so that it doesn't keep the top level modules alive.
+_generated_modules = {}
+
+
 class _Generate:
   """Represents a generator. Stores the generate function and wraps it with the
   necessary logic to build an HWModule."""
@@ -387,23 +425,20 @@ class _Generate:
     module_name = self.sanitize(module_name)
 
     # Track generated modules so we don't create unnecessary duplicates of
-    # modules that are structurally equivalent. If the module name exists in the
-    # top level MLIR module, assume that we've already generated it.
-    existing_module_names = [
-        o for o in mod.regions[0].blocks[0].operations
-        if mlir.ir.StringAttr(o.name).value == module_name
-    ]
-
-    if not existing_module_names:
-      with mlir.ir.InsertionPoint(mod.regions[0].blocks[0]), self.loc:
+    # modules that are structurally equivalent: the generator runs once per
+    # module name, i.e. per unique parameterization, and the following
+    # instances reuse the module. If the module name exists in the top level
+    # MLIR module, assume that we've already generated it.
+    top_mod = mod
+    mod = self._lookup_module(top_mod, module_name)
+    if mod is None:
+      with mlir.ir.InsertionPoint(top_mod.regions[0].blocks[0]), self.loc:
         mod = ModuleDefinition(self.modcls,
                                module_name,
                                input_ports=self.modcls._input_ports,
                                output_ports=self.modcls._output_ports,
                                body_builder=self._generate)
-    else:
-      assert (len(existing_module_names) == 1)
-      mod = existing_module_names[0]
+      _generated_modules[module_name] = (top_mod, mod)
 
     # Build a replacement instance at the op to be replaced.
     op_names = [name for name, _ in self.modcls._input_ports]
@@ -416,6 +451,25 @@ class _Generate:
         inst.attributes[name] = attr
       return inst
 
+  @staticmethod
+  def _lookup_module(top_mod, module_name):
+    """Return the module named `module_name` in the top level MLIR module, or
+    None if there is none. Modules generated before are found without scanning
+    the top level module."""
+    cached = _generated_modules.get(module_name)
+    if cached is not None and cached[0] is top_mod:
+      return cached[1]
+
+    existing_module_names = [
+        o for o in top_mod.regions[0].blocks[0].operations
+        if mlir.ir.StringAttr(o.name).value == module_name
+    ]
+    if not existing_module_names:
+      return None
+    assert (len(existing_module_names) == 1)
+    _generated_modules[module_name] = (top_mod, existing_module_names[0])
+    return existing_module_names[0]
+
   def create_module_name(self, op):
 
     def val_str(val):
@@ -3,7 +3,7 @@
 #  SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
 from .pycde_types import types
-from .module import ModuleDefinition
+from .module import ModuleDefinition, _generated_modules
 
 import mlir
 import mlir.ir
@@ -13,10 +13,15 @@ import circt
 import circt.support
 from circt.dialects import hw
 
+import concurrent.futures
 import gc
 import sys
 import typing
 
+# The threads running the passes of the systems lowered asynchronously. The
+# passes release the GIL, so several systems can be lowered at the same time.
+_pass_executor = None
+
 
 class System:
 
@@ -73,7 +78,10 @@ class System:
   def generate(self, generator_names=[]):
     pm = mlir.passmanager.PassManager.parse("run-generators{generators=" +
                                             ",".join(generator_names) + "}")
-    pm.run(self.mod)
+    try:
+      pm.run(self.mod)
+    finally:
+      _generated_modules.clear()
     if self.system_mod is None:
       return
     sys_mod_block = self.system_mod.operation.regions[0].blocks[0]
@@ -85,11 +93,32 @@ class System:
   def run_passes(self):
     if self.passed:
       return
-    pm = mlir.passmanager.PassManager.parse(",".join(self.passes))
-    pm.run(self.mod)
+    circt.run_passes(self.mod, ",".join(self.passes))
     types.declare_types(self.mod)
     self.passed = True
 
+  def run_passes_async(self) -> concurrent.futures.Future:
+    """Run the passes in a background thread. Return a future which completes
+    once the system is lowered, or raises the error the passes failed with.
+    The system must not be modified until then."""
+    global _pass_executor
+    if _pass_executor is None:
+      _pass_executor = concurrent.futures.ThreadPoolExecutor()
+    return _pass_executor.submit(self.run_passes)
+
   def print_verilog(self, out_stream: typing.TextIO = sys.stdout):
     self.run_passes()
     circt.export_verilog(self.mod, out_stream)
+
+  def write_verilog(self, path: str):
+    """Write the Verilog of the design into the file at `path`. Unlike
+    `print_verilog`, the file is written natively rather than through a Python
+    stream, which is much faster for large designs."""
+    self.run_passes()
+    circt.export_verilog_file(self.mod, path)
+
+  def write_split_verilog(self, directory: str):
+    """Write the Verilog of the design as one file per module in
+    `directory`."""
+    self.run_passes()
+    circt.export_split_verilog(self.mod, directory)
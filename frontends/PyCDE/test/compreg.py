@@ -21,6 +21,7 @@ class CompReg:
 
 mod = pycde.System([CompReg])
 mod.generate()
+mod.run_passes_async().result()
 mod.print_verilog()
 
 # CHECK: reg [7:0] [[NAME:.+]];
@@ -0,0 +1,64 @@
+# RUN: %PYTHON% %s 2>&1 | FileCheck %s
+
+import pycde
+import pycde.module
+import circt.dialects.hw
+
+# Record the calls to the generators registered with MSFT.
+calls = []
+generate_call = pycde.module._Generate.__call__
+
+
+def record_call(self, op):
+  calls.append(op.name)
+  return generate_call(self, op)
+
+
+pycde.module._Generate.__call__ = record_call
+
+
+@pycde.module
+class Select:
+  a = pycde.Input(pycde.types.i1)
+  b = pycde.Input(pycde.types.i1)
+  y = pycde.Output(pycde.types.i1)
+
+  @pycde.generator
+  def construct(mod):
+    return {"y": mod.b}
+
+
+@pycde.module
+class Test:
+  inputs = []
+  outputs = []
+
+  @pycde.generator
+  def build(_):
+    t = circt.dialects.hw.ConstantOp.create(pycde.types.i1, 1)
+    f = circt.dialects.hw.ConstantOp.create(pycde.types.i1, 0)
+    # The same value on both operands does not tell which one the instance
+    # uses, so this replacement is not reused.
+    Select(a=t, b=t)
+    Select(a=t, b=f)
+    Select(a=f, b=t)
+    Select(a=f, b=f)
+
+
+# The generator of Select runs for the first two instances only. The other ones
+# reuse the replacement of the second with their own operands, under a unique
+# name.
+# CHECK-LABEL: hw.module @pycde.Test
+# CHECK: [[T:%.+]] = hw.constant true
+# CHECK: [[F:%.+]] = hw.constant false
+# CHECK: hw.instance "pycde.Select" @pycde.Select([[T]], [[T]])
+# CHECK: hw.instance "pycde.Select" @pycde.Select([[T]], [[F]])
+# CHECK: hw.instance "pycde.Select_1" @pycde.Select([[F]], [[T]])
+# CHECK: hw.instance "pycde.Select_2" @pycde.Select([[F]], [[F]])
+# CHECK: 1 Test calls
+# CHECK: 2 Select calls
+t = pycde.System([Test])
+t.generate()
+t.print()
+print(calls.count("pycde.Test"), "Test calls")
+print(calls.count("pycde.Select"), "Select calls")
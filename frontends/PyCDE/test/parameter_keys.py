@@ -0,0 +1,64 @@
+# RUN: %PYTHON% %s 2>&1 | FileCheck %s
+
+import pycde
+import pycde.module
+import circt.dialects.hw
+
+
+@pycde.module
+def Parameterized(param):
+
+  class Module:
+    x = pycde.Input(pycde.types.i1)
+    y = pycde.Output(pycde.types.i1)
+
+    @pycde.generator
+    def construct(mod):
+      return {"y": mod.x}
+
+  return Module
+
+
+class Params:
+
+  def __init__(self, width):
+    self.width = width
+
+
+# Equal values share a module class, values of different types don't.
+# CHECK: True True
+print(Parameterized(1) is Parameterized(1),
+      Parameterized([1, "a"]) is Parameterized([1, "a"]))
+# CHECK: False False False
+print(Parameterized(None) is Parameterized(False),
+      Parameterized(0) is Parameterized(False),
+      Parameterized(1) is Parameterized(True))
+
+# Functions and other objects are keyed by identity.
+f = lambda: 1
+p = Params(8)
+# CHECK: True False
+print(Parameterized(f) is Parameterized(f),
+      Parameterized(lambda: 1) is Parameterized(lambda: 2))
+# CHECK: True False
+print(Parameterized(p) is Parameterized(p),
+      Parameterized(Params(8)) is Parameterized(Params(8)))
+
+
+@pycde.module
+class Top:
+  inputs = []
+  outputs = []
+
+  @pycde.generator
+  def build(_):
+    c1 = circt.dialects.hw.ConstantOp.create(pycde.types.i1, 1)
+    Parameterized(1)(x=c1)
+    Parameterized(1)(x=c1)
+
+
+# The generated modules are not kept once the generators ran.
+# CHECK: 0
+t = pycde.System([Top])
+t.generate()
+print(len(pycde.module._generated_modules))
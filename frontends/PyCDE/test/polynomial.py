@@ -92,6 +92,12 @@ class PolynomialSystem:
     return {"y": poly.y}
 
 
+# Parameterizations with equal parameter values share a module class.
+assert PolynomialCompute(Coefficients([62, 42, 6])) is PolynomialCompute(
+    coefficients=Coefficients([62, 42, 6]))
+assert PolynomialCompute(Coefficients([62, 42, 6])) is not PolynomialCompute(
+    Coefficients([1, 2, 3, 4, 5]))
+
 poly = pycde.System([PolynomialSystem])
 
 print("Generating 1...")
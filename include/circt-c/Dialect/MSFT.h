@@ -75,6 +75,49 @@ size_t circtMSFTSwitchInstanceAttrGetNumCases(MlirAttribute);
 void circtMSFTSwitchInstanceAttrGetCases(MlirAttribute,
                                          CirctMSFTSwitchInstanceCase *dstArray,
                                          size_t space);
+
+//===----------------------------------------------------------------------===//
+// PlacementDB.
+//===----------------------------------------------------------------------===//
+
+typedef struct {
+  void *ptr;
+} CirctMSFTPlacementDB;
+
+typedef struct {
+  MlirAttribute path; // Null if the entity is in the top module.
+  MlirStringRef subpath;
+  MlirOperation op;
+} CirctMSFTPlacedInstance;
+
+/// Create a placement database for the design whose top module is `top`. It
+/// must be destroyed with `circtMSFTDeletePlacementDB`.
+CirctMSFTPlacementDB circtMSFTCreatePlacementDB(MlirOperation top);
+void circtMSFTDeletePlacementDB(CirctMSFTPlacementDB self);
+/// Add the placements specified by the attributes of the design. Return the
+/// number of placements added, or -1 if any of them conflicted.
+int64_t circtMSFTPlacementDBAddDesignPlacements(CirctMSFTPlacementDB);
+/// Add a placement. Emit an error and fail if the location is occupied.
+MlirLogicalResult
+circtMSFTPlacementDBAddPlacement(CirctMSFTPlacementDB, MlirAttribute loc,
+                                 CirctMSFTPlacedInstance inst);
+/// Return true and set `out` if there is an entity at the location.
+bool circtMSFTPlacementDBTryGetInstanceAt(CirctMSFTPlacementDB,
+                                          MlirAttribute loc,
+                                          CirctMSFTPlacedInstance *out);
+size_t circtMSFTPlacementDBGetNumPlacements(CirctMSFTPlacementDB);
+
+typedef void (*CirctMSFTPlacementCallback)(MlirAttribute loc,
+                                           CirctMSFTPlacedInstance,
+                                           void *userData);
+/// Walk the placements in order of column, row and number. If `bounds` is not
+/// null, only walk the ones within the columns `bounds[0]` to `bounds[1]` and
+/// the rows `bounds[2]` to `bounds[3]`, bounds included.
+void circtMSFTPlacementDBWalkPlacements(CirctMSFTPlacementDB,
+                                        CirctMSFTPlacementCallback,
+                                        const uint64_t *bounds,
+                                        void *userData);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,16 @@ MLIR_CAPI_EXPORTED MlirLogicalResult mlirExportVerilog(MlirModule,
                                                        MlirStringCallback,
                                                        void *userData);
 
+/// Emits verilog for the specified module into the file at `path`, which is
+/// overwritten if it exists.
+MLIR_CAPI_EXPORTED MlirLogicalResult
+mlirExportVerilogToFile(MlirModule, MlirStringRef path);
+
+/// Emits verilog for the specified module as one file per module in the
+/// directory `dirname`, along with a file list.
+MLIR_CAPI_EXPORTED MlirLogicalResult
+mlirExportSplitVerilog(MlirModule, MlirStringRef dirname);
+
 #ifdef __cplusplus
 }
 #endif
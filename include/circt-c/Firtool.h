@@ -0,0 +1,104 @@
+//===-- circt-c/Firtool.h - C API for the firtool pipeline --------*- C -*-===//
+//
+// This header declares the C interface for running the pass pipeline of
+// firtool, which lowers FIRRTL to the HW dialect, and for controlling its
+// threads, its lowering options and its measurements.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_C_FIRTOOL_H
+#define CIRCT_C_FIRTOOL_H
+
+#include "mlir-c/IR.h"
+#include "mlir-c/Pass.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//===----------------------------------------------------------------------===//
+// Pipeline.
+//===----------------------------------------------------------------------===//
+
+typedef struct {
+  void *ptr;
+} CirctFirtoolOptions;
+
+/// Create the options of the firtool pipeline, with the defaults of the
+/// firtool command line. They must be destroyed with
+/// `circtFirtoolOptionsDestroy`.
+MLIR_CAPI_EXPORTED CirctFirtoolOptions circtFirtoolOptionsCreateDefault(void);
+MLIR_CAPI_EXPORTED void circtFirtoolOptionsDestroy(CirctFirtoolOptions);
+
+MLIR_CAPI_EXPORTED void
+circtFirtoolOptionsSetDisableOptimization(CirctFirtoolOptions, bool value);
+/// Lower to the HW dialect.
+MLIR_CAPI_EXPORTED void circtFirtoolOptionsSetLowerToHW(CirctFirtoolOptions,
+                                                        bool value);
+/// Lower to the HW dialect and prepare the IR for Verilog emission.
+MLIR_CAPI_EXPORTED void circtFirtoolOptionsSetEmitVerilog(CirctFirtoolOptions,
+                                                          bool value);
+MLIR_CAPI_EXPORTED void circtFirtoolOptionsSetDedup(CirctFirtoolOptions,
+                                                    bool value);
+MLIR_CAPI_EXPORTED void
+circtFirtoolOptionsSetParallelInferWidths(CirctFirtoolOptions, bool value);
+MLIR_CAPI_EXPORTED void
+circtFirtoolOptionsSetParallelIMConstProp(CirctFirtoolOptions, bool value);
+/// Set the root of the paths of the black box annotations.
+MLIR_CAPI_EXPORTED void
+circtFirtoolOptionsSetBlackBoxRoot(CirctFirtoolOptions, MlirStringRef path);
+
+/// Add the firtool pipeline with the specified options to a pass manager on
+/// builtin modules.
+MLIR_CAPI_EXPORTED void circtFirtoolPopulatePipeline(MlirPassManager,
+                                                     CirctFirtoolOptions);
+
+/// Set the LoweringOptions of a module from a comma separated list, as with the
+/// -lowering-options command line option. Emit an error on the module and fail
+/// if an option is invalid.
+MLIR_CAPI_EXPORTED MlirLogicalResult
+circtFirtoolSetLoweringOptions(MlirModule, MlirStringRef options);
+
+//===----------------------------------------------------------------------===//
+// Threads.
+//===----------------------------------------------------------------------===//
+
+/// Run parallel loops on at most `numThreads` threads, or one per available
+/// core if it is 0, as with the -threads command line option. This must be
+/// called before anything runs in parallel. The pass manager only runs in
+/// parallel if multithreading is enabled on the context.
+MLIR_CAPI_EXPORTED void circtSetNumThreads(unsigned numThreads);
+
+//===----------------------------------------------------------------------===//
+// Measurements.
+//===----------------------------------------------------------------------===//
+
+/// Print the time taken by each pass to stderr when the pass manager is
+/// destroyed, as with the -mlir-timing command line option.
+MLIR_CAPI_EXPORTED void circtPassManagerEnableTiming(MlirPassManager);
+
+/// Print the statistics of the passes to stderr when the pass manager is
+/// destroyed, as with the -pass-statistics command line option.
+MLIR_CAPI_EXPORTED void circtPassManagerEnableStatistics(MlirPassManager);
+
+typedef struct {
+  void *ptr;
+} CirctPipelineReport;
+
+/// Measure the time, the memory and the number of operations of each pass the
+/// pass manager runs, as with the firtool -pipeline-report command line
+/// option. The report is owned by the pass manager.
+MLIR_CAPI_EXPORTED CirctPipelineReport
+circtPassManagerAddPipelineReport(MlirPassManager);
+
+/// Print the measurements of the passes which have run so far as JSON, with
+/// the provided callback and user data.
+MLIR_CAPI_EXPORTED void circtPipelineReportPrintJSON(CirctPipelineReport,
+                                                     MlirStringCallback,
+                                                     void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CIRCT_C_FIRTOOL_H
@@ -26,8 +26,14 @@ class ModuleOp;
 namespace circt {
 namespace calyx {
 
+/// Emit the Calyx programs in `module`. The components are emitted in
+/// parallel if the context enables multithreading, and written in order.
 mlir::LogicalResult exportCalyx(mlir::ModuleOp module, llvm::raw_ostream &os);
 
+/// Emit the Calyx programs in `module` straight to the file descriptor `fd`,
+/// which is left open.
+mlir::LogicalResult exportCalyx(mlir::ModuleOp module, int fd);
+
 void registerToCalyxTranslation();
 
 } // namespace calyx
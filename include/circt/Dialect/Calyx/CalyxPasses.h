@@ -25,8 +25,14 @@ std::unique_ptr<mlir::Pass> createCompileControlPass();
 
 std::unique_ptr<mlir::Pass> createGoInsertionPass();
 
+std::unique_ptr<mlir::Pass> createInferStaticLatencyPass();
+
+std::unique_ptr<mlir::Pass> createRegisterSharingPass();
+
 std::unique_ptr<mlir::Pass> createRemoveGroupsPass();
 
+std::unique_ptr<mlir::Pass> createResourceSharingPass();
+
 /// Generate the code for registering passes.
 #define GEN_PASS_REGISTRATION
 #include "circt/Dialect/Calyx/CalyxPasses.h.inc"
@@ -29,6 +29,8 @@ class PatternRewriter;
 
 namespace circt {
 namespace comb {
+struct KnownBitCache;
+
 /// KnownBitAnalysis captures information about a value - the set of bits that
 /// are guaranteed to always be zero, and the set of bits that are guaranteed to
 /// always be one (these must be exclusive!).  A bit that exists in neither
@@ -55,6 +57,11 @@ struct KnownBitAnalysis {
   /// constant" always returns zeros for the zero bits in a constant.
   static KnownBitAnalysis compute(Value v);
 
+  /// Compute the known bits of `v`, reusing and extending the results in
+  /// `cache`.  This allows clients that perform many queries on overlapping
+  /// expression trees to share the work between them.
+  static KnownBitAnalysis compute(Value v, KnownBitCache &cache);
+
   /// Return the bitwidth of the analyzed value.
   unsigned getWidth() const { return ones.getBitWidth(); }
 
@@ -68,6 +75,34 @@ struct KnownBitAnalysis {
   APInt getBitsKnown() const { return ones | zeros; }
 };
 
+/// A cache of known bit results, which can be shared between multiple calls to
+/// `KnownBitAnalysis::compute`.  The known bits of a value only depend on the
+/// semantics of its expression tree, which rewrites preserve, but an entry
+/// must be invalidated before the operation defining its value is erased, as
+/// the storage may be reused by a new value.
+struct KnownBitCache {
+  struct Entry {
+    KnownBitAnalysis bits;
+    /// The recursion depth the bits were computed at.  Results computed
+    /// closer to the root of a query looked further down the tree.
+    unsigned depth;
+  };
+
+  /// Drop the result for the specified value, if any.
+  void invalidate(Value value) { entries.erase(value); }
+
+  /// Drop the results for all values defined by the specified operation.
+  void invalidate(Operation *op) {
+    for (auto result : op->getResults())
+      entries.erase(result);
+  }
+
+  /// Drop all results.
+  void clear() { entries.clear(); }
+
+  DenseMap<Value, Entry> entries;
+};
+
 } // namespace comb
 } // namespace circt
 
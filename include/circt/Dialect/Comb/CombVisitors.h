@@ -14,6 +14,7 @@
 #define CIRCT_DIALECT_COMB_COMBVISITORS_H
 
 #include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Support/OpDispatch.h"
 #include "llvm/ADT/TypeSwitch.h"
 
 namespace circt {
@@ -26,22 +27,24 @@ class CombinationalVisitor {
 public:
   ResultType dispatchCombinationalVisitor(Operation *op, ExtraArgs... args) {
     auto *thisCast = static_cast<ConcreteType *>(this);
-    return TypeSwitch<Operation *, ResultType>(op)
-        .template Case<
-            // Arithmetic and Logical Binary Operations.
-            AddOp, SubOp, MulOp, DivUOp, DivSOp, ModUOp, ModSOp, ShlOp, ShrUOp,
-            ShrSOp,
-            // Bitwise operations
-            AndOp, OrOp, XorOp,
-            // Comparison operations
-            ICmpOp,
-            // Reduction Operators
-            ParityOp,
-            // Other operations.
-            SExtOp, ConcatOp, ExtractOp, MuxOp>([&](auto expr) -> ResultType {
+    return dispatchOpClass<
+        ResultType,
+        // Arithmetic and Logical Binary Operations.
+        AddOp, SubOp, MulOp, DivUOp, DivSOp, ModUOp, ModSOp, ShlOp, ShrUOp,
+        ShrSOp,
+        // Bitwise operations
+        AndOp, OrOp, XorOp,
+        // Comparison operations
+        ICmpOp,
+        // Reduction Operators
+        ParityOp,
+        // Other operations.
+        SExtOp, ConcatOp, ExtractOp, MuxOp>(
+        op,
+        [&](auto expr) -> ResultType {
           return thisCast->visitComb(expr, args...);
-        })
-        .Default([&](auto expr) -> ResultType {
+        },
+        [&](Operation *) -> ResultType {
           return thisCast->visitInvalidComb(op, args...);
         });
   }
@@ -118,3 +118,309 @@ module ESI_PipelineStage # (
     end
   end
 endmodule
+
+/// ESI_FIFO: a circular buffer in memory for deep channel buffers. Holds up to
+/// DEPTH tokens in memory plus one in the output register. A token which
+/// arrives while the memory is empty and the output register is (or is
+/// becoming) free bypasses the memory, so the latency through an empty FIFO is
+/// one cycle regardless of DEPTH. a_ready only depends on the occupancy, so
+/// there is no combinational path from x_ready to a_ready.
+///
+/// The memory is read asynchronously, which maps to distributed (LUT) RAM on
+/// FPGAs.
+module ESI_FIFO # (
+  int WIDTH = 8,
+  int DEPTH = 16
+) (
+  input logic clk,
+  input logic rstn,
+
+  // Input LI channel.
+  input logic a_valid,
+  input logic [WIDTH-1:0] a,
+  output logic a_ready,
+
+  // Output LI channel.
+  output logic x_valid,
+  output logic [WIDTH-1:0] x,
+  input logic x_ready
+);
+
+  localparam int ADDR_WIDTH = DEPTH > 1 ? $clog2(DEPTH) : 1;
+  localparam int COUNT_WIDTH = $clog2(DEPTH + 1);
+
+  // Output register, holding the token at the head of the FIFO.
+  logic [WIDTH-1:0] x_reg;
+  logic x_valid_reg;
+  assign x = x_reg;
+  assign x_valid = x_valid_reg;
+
+  // The tokens behind the head.
+  logic [WIDTH-1:0] mem [DEPTH-1:0];
+  logic [ADDR_WIDTH-1:0] rd_ptr, wr_ptr;
+  logic [COUNT_WIDTH-1:0] count;
+  wire empty = count == '0;
+  assign a_ready = count != COUNT_WIDTH'(DEPTH);
+
+  // The output register can take a new token this cycle.
+  wire x_free = ~x_valid_reg || x_ready;
+  wire a_rcv = a_valid && a_ready;
+
+  // Move the oldest token in memory into the output register, send the input
+  // straight to the output register, or store the input in memory.
+  wire pop = ~empty && x_free;
+  wire bypass = a_rcv && empty && x_free;
+  wire push = a_rcv && ~bypass;
+
+  function automatic logic [ADDR_WIDTH-1:0] next(logic [ADDR_WIDTH-1:0] ptr);
+    return ptr == ADDR_WIDTH'(DEPTH - 1) ? '0 : ptr + 1'b1;
+  endfunction
+
+  always_ff @(posedge clk)
+    if (push)
+      mem[wr_ptr] <= a;
+
+  always_ff @(posedge clk) begin
+    if (~rstn) begin
+      x_valid_reg <= 1'b0;
+      rd_ptr <= '0;
+      wr_ptr <= '0;
+      count <= '0;
+    end else begin
+      if (pop) begin
+        x_reg <= mem[rd_ptr];
+        x_valid_reg <= 1'b1;
+        rd_ptr <= next(rd_ptr);
+      end else if (bypass) begin
+        x_reg <= a;
+        x_valid_reg <= 1'b1;
+      end else if (x_ready) begin
+        x_valid_reg <= 1'b0;
+      end
+
+      if (push)
+        wr_ptr <= next(wr_ptr);
+      if (push && ~pop)
+        count <= count + 1'b1;
+      else if (pop && ~push)
+        count <= count - 1'b1;
+    end
+  end
+endmodule
+
+/// ESI_SkidBuffer: a single-token buffer which registers the backpressure
+/// without adding latency. While the skid register is empty, tokens pass
+/// through combinationally. If the output stalls, the token accepted that
+/// cycle lands in the skid register and a_ready drops on the next cycle. Use it
+/// to break long ready paths where the extra cycle of a pipeline stage isn't
+/// affordable.
+module ESI_SkidBuffer # (
+  int WIDTH = 8
+) (
+  input logic clk,
+  input logic rstn,
+
+  // Input LI channel.
+  input logic a_valid,
+  input logic [WIDTH-1:0] a,
+  output logic a_ready,
+
+  // Output LI channel.
+  output logic x_valid,
+  output logic [WIDTH-1:0] x,
+  input logic x_ready
+);
+
+  // Skid register.
+  logic [WIDTH-1:0] s;
+  logic s_valid;
+
+  assign a_ready = ~s_valid;
+  assign x = s_valid ? s : a;
+  assign x_valid = s_valid || a_valid;
+
+  always_ff @(posedge clk) begin
+    if (~rstn) begin
+      s_valid <= 1'b0;
+    end else if (s_valid) begin
+      // Drain the skid register first.
+      if (x_ready)
+        s_valid <= 1'b0;
+    end else if (a_valid && ~x_ready) begin
+      // We accepted a token which couldn't be sent.
+      s <= a;
+      s_valid <= 1'b1;
+    end
+  end
+endmodule
+
+/// ESI_ElasticBuffer: a circular buffer in memory like ESI_FIFO, but without
+/// the bypass and with fully registered backpressure: a_ready is a flop, so
+/// neither x_ready nor a_valid reach it combinationally. Holds up to DEPTH
+/// tokens in memory plus one in the output register. almost_full is raised,
+/// also from a flop, while the memory holds ALMOST_FULL tokens or more.
+module ESI_ElasticBuffer # (
+  int WIDTH = 8,
+  int DEPTH = 16,
+  int ALMOST_FULL = DEPTH
+) (
+  input logic clk,
+  input logic rstn,
+
+  // Input LI channel.
+  input logic a_valid,
+  input logic [WIDTH-1:0] a,
+  output logic a_ready,
+
+  // Output LI channel.
+  output logic x_valid,
+  output logic [WIDTH-1:0] x,
+  input logic x_ready,
+
+  output logic almost_full
+);
+
+  localparam int ADDR_WIDTH = DEPTH > 1 ? $clog2(DEPTH) : 1;
+  localparam int COUNT_WIDTH = $clog2(DEPTH + 1);
+
+  // Output register, holding the token at the head of the buffer.
+  logic [WIDTH-1:0] x_reg;
+  logic x_valid_reg;
+  assign x = x_reg;
+  assign x_valid = x_valid_reg;
+
+  // The tokens behind the head.
+  logic [WIDTH-1:0] mem [DEPTH-1:0];
+  logic [ADDR_WIDTH-1:0] rd_ptr, wr_ptr;
+  logic [COUNT_WIDTH-1:0] count, count_next;
+
+  logic a_ready_reg, almost_full_reg;
+  assign a_ready = a_ready_reg;
+  assign almost_full = almost_full_reg;
+
+  wire a_rcv = a_valid && a_ready_reg;
+  wire pop = count != '0 && (~x_valid_reg || x_ready);
+
+  always_comb begin
+    count_next = count;
+    if (a_rcv && ~pop)
+      count_next = count + 1'b1;
+    else if (pop && ~a_rcv)
+      count_next = count - 1'b1;
+  end
+
+  function automatic logic [ADDR_WIDTH-1:0] next(logic [ADDR_WIDTH-1:0] ptr);
+    return ptr == ADDR_WIDTH'(DEPTH - 1) ? '0 : ptr + 1'b1;
+  endfunction
+
+  always_ff @(posedge clk)
+    if (a_rcv)
+      mem[wr_ptr] <= a;
+
+  always_ff @(posedge clk) begin
+    if (~rstn) begin
+      x_valid_reg <= 1'b0;
+      rd_ptr <= '0;
+      wr_ptr <= '0;
+      count <= '0;
+      a_ready_reg <= 1'b0;
+      almost_full_reg <= 1'b0;
+    end else begin
+      if (pop) begin
+        x_reg <= mem[rd_ptr];
+        x_valid_reg <= 1'b1;
+        rd_ptr <= next(rd_ptr);
+      end else if (x_ready) begin
+        x_valid_reg <= 1'b0;
+      end
+
+      if (a_rcv)
+        wr_ptr <= next(wr_ptr);
+      count <= count_next;
+      a_ready_reg <= count_next != COUNT_WIDTH'(DEPTH);
+      almost_full_reg <= count_next >= COUNT_WIDTH'(ALMOST_FULL);
+    end
+  end
+endmodule
+
+/// ESI_Gearbox: adapts the width of a channel. If OUT_WIDTH is N times
+/// IN_WIDTH, packs N input tokens into each output token, the first one in the
+/// least significant bits. If IN_WIDTH is N times OUT_WIDTH, sends each input
+/// token as N output tokens, least significant bits first. Either way a new
+/// input token is accepted in the same cycle as the last output of the
+/// previous one is sent, so the gearbox runs at the full rate of the narrow
+/// side.
+module ESI_Gearbox # (
+  int IN_WIDTH = 8,
+  int OUT_WIDTH = 32
+) (
+  input logic clk,
+  input logic rstn,
+
+  // Input LI channel.
+  input logic a_valid,
+  input logic [IN_WIDTH-1:0] a,
+  output logic a_ready,
+
+  // Output LI channel.
+  output logic x_valid,
+  output logic [OUT_WIDTH-1:0] x,
+  input logic x_ready
+);
+
+  generate
+    if (OUT_WIDTH >= IN_WIDTH) begin : pack
+      localparam int N = OUT_WIDTH / IN_WIDTH;
+      localparam int COUNT_WIDTH = $clog2(N + 1);
+
+      // The tokens packed so far. The output is valid once there are N.
+      logic [OUT_WIDTH-1:0] acc;
+      logic [COUNT_WIDTH-1:0] count;
+      wire full = count == COUNT_WIDTH'(N);
+      assign x = acc;
+      assign x_valid = full;
+
+      // A new packing starts as the full one is sent.
+      assign a_ready = ~full || x_ready;
+      wire a_rcv = a_valid && a_ready;
+      wire [COUNT_WIDTH-1:0] slot = full ? '0 : count;
+
+      always_ff @(posedge clk) begin
+        if (~rstn) begin
+          count <= '0;
+        end else if (a_rcv) begin
+          acc[slot * IN_WIDTH +: IN_WIDTH] <= a;
+          count <= slot + 1'b1;
+        end else if (full && x_ready) begin
+          count <= '0;
+        end
+      end
+    end else begin : serialize
+      localparam int N = IN_WIDTH / OUT_WIDTH;
+      localparam int COUNT_WIDTH = $clog2(N + 1);
+
+      // The rest of the token being sent, and the number of output tokens it
+      // still makes up.
+      logic [IN_WIDTH-1:0] shift;
+      logic [COUNT_WIDTH-1:0] remaining;
+      assign x = shift[OUT_WIDTH-1:0];
+      assign x_valid = remaining != '0;
+
+      wire last = remaining == COUNT_WIDTH'(1);
+      assign a_ready = remaining == '0 || (last && x_ready);
+      wire a_rcv = a_valid && a_ready;
+
+      always_ff @(posedge clk) begin
+        if (~rstn) begin
+          remaining <= '0;
+        end else if (a_rcv) begin
+          shift <= a;
+          remaining <= COUNT_WIDTH'(N);
+        end else if (x_valid && x_ready) begin
+          shift <= shift >> OUT_WIDTH;
+          remaining <= remaining - 1'b1;
+        end
+      end
+    end
+  endgenerate
+endmodule
@@ -41,10 +41,42 @@ import "DPI-C" sv2cCosimserverEpRegister =
     // The recv types max size, in bytes.
     input int recv_type_size);
 
+// Register simulated device endpoints which exchange the packed bits of their
+// values instead of capnp messages. The server wraps the data in UntypedData
+// messages for the client. The arguments are as for cosim_ep_register, with
+// the sizes being the exact data sizes.
+// - return 0 on success, non-zero on failure (duplicate EP registered).
+import "DPI-C" sv2cCosimserverEpRegisterPacked =
+  function int cosim_ep_register_packed(
+    input int endpoint_id,
+    input longint send_type_id,
+    input int send_type_size,
+    input longint esi_recv_type_id,
+    input int recv_type_size);
+
 // --------------------- Endpoint Accessors ------------------------------------
 
+// Check whether any endpoint may have a message from a client.
+// - return non-zero if so, 0 if no endpoint has any message.
+import "DPI-C" sv2cCosimserverAnyPending = function int cosim_any_pending();
+
+// The time of the last cosim_any_pending() call and its result, so that the
+// server is only asked once per time step however many endpoints check.
+time cosim_pending_time = '1;
+bit cosim_pending;
+
+// Return whether any endpoint may have a message from a client. Messages which
+// arrive during a time step may not be seen until the next one.
+function automatic bit cosim_poll_pending();
+  if (cosim_pending_time != $time) begin
+    cosim_pending = cosim_any_pending() != 0;
+    cosim_pending_time = $time;
+  end
+  return cosim_pending;
+endfunction
+
 // Attempt to send data to a client.
-// - return 0 on success, negative on failure (unregistered EP).
+// - return 0 on success, negative on failure (unregistered EP, full queue).
 import "DPI-C" sv2cCosimserverEpTryPut =
   function int cosim_ep_tryput(
     // The ID of the endpoint to which the data should be sent.
@@ -74,4 +106,32 @@ import "DPI-C" sv2cCosimserverEpTryGet =
     inout  int unsigned data_size
     );
 
+// Attempt to send several messages to a client in one call.
+// - return the number of messages queued (fewer than num_msgs if the queue is
+//   full), negative on failure (unregistered EP).
+import "DPI-C" sv2cCosimserverEpTryPutBatch =
+  function int cosim_ep_tryput_batch(
+    // The ID of the endpoint to which the data should be sent.
+    input int unsigned endpoint_id,
+    // A data buffer with one message per slot of the send type size.
+    input byte unsigned data[],
+    // The number of messages in the buffer.
+    input int num_msgs
+    );
+
+// Attempt to recieve several messages from a client in one call.
+//   - Returns negative when call failed (e.g. EP not registered).
+//   - If no message, return 0 with num_msgs == 0.
+//   - Each message is put in the next slot of the recv type size, zero padded.
+import "DPI-C" sv2cCosimserverEpTryGetBatch =
+  function int cosim_ep_tryget_batch(
+    // The ID of the endpoint from which data should be recieved.
+    input  int unsigned endpoint_id,
+    // The buffer in which to put the data, with room for num_msgs messages.
+    inout byte unsigned data[],
+    // Input: the number of message slots in the data[] buffer.
+    // Output: the number of messages received.
+    inout  int unsigned num_msgs
+    );
+
 endpackage // Cosim_DpiPkg
@@ -20,7 +20,13 @@ module Cosim_Endpoint
   parameter longint RECV_TYPE_ID = -1,
   parameter int RECV_TYPE_SIZE_BITS = -1,
   parameter longint SEND_TYPE_ID = -1,
-  parameter int SEND_TYPE_SIZE_BITS = -1
+  parameter int SEND_TYPE_SIZE_BITS = -1,
+  // Only poll for messages from the client while the server reports that some
+  // endpoint has one, instead of at every clock.
+  parameter bit POLL_ON_PENDING = 1'b0,
+  // The data is the packed bits of the values rather than Cap'nProto messages.
+  // The server wraps it in UntypedData messages for the clients.
+  parameter bit PACKED = 1'b0
 )
 (
   input  logic clk,
@@ -45,8 +51,13 @@ module Cosim_Endpoint
       rc = cosim_init();
       if (rc != 0)
         $error("Cosim init failed (%d)", rc);
-      rc = cosim_ep_register(ENDPOINT_ID, SEND_TYPE_ID, SEND_TYPE_SIZE_BYTES,
-                             RECV_TYPE_ID, RECV_TYPE_SIZE_BYTES);
+      if (PACKED)
+        rc = cosim_ep_register_packed(ENDPOINT_ID, SEND_TYPE_ID,
+                                      SEND_TYPE_SIZE_BYTES, RECV_TYPE_ID,
+                                      RECV_TYPE_SIZE_BYTES);
+      else
+        rc = cosim_ep_register(ENDPOINT_ID, SEND_TYPE_ID, SEND_TYPE_SIZE_BYTES,
+                               RECV_TYPE_ID, RECV_TYPE_SIZE_BYTES);
       if (rc != 0)
         $error("Cosim endpoint (%d) register failed: %d", ENDPOINT_ID, rc);
       Initialized = 1'b1;
@@ -70,7 +81,8 @@ module Cosim_Endpoint
       if (DataOutValid && DataOutReady) // A transfer occurred.
         DataOutValid <= 1'b0;
 
-      if (!DataOutValid || DataOutReady) begin
+      if ((!DataOutValid || DataOutReady) &&
+          (!POLL_ON_PENDING || cosim_poll_pending())) begin
         int data_limit;
         int rc;
 
@@ -13,18 +13,108 @@
 #ifndef CIRCT_DIALECT_ESI_COSIM_ENDPOINT_H
 #define CIRCT_DIALECT_ESI_COSIM_ENDPOINT_H
 
+#include "circt/Dialect/ESI/cosim/ShmChannel.h"
+
+#include <algorithm>
+#include <atomic>
 #include <functional>
+#include <list>
 #include <map>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
+#include <vector>
 
 namespace circt {
 namespace esi {
 namespace cosim {
 
+/// A bounded, lock-free queue for exactly one producer thread and one consumer
+/// thread. The head and tail counters only ever increase and are kept on
+/// separate cache lines, so the two threads only contend when they actually
+/// exchange a message.
+template <typename T>
+class SPSCQueue {
+public:
+  /// The capacity must be a power of two.
+  explicit SPSCQueue(size_t capacity) : slots(capacity), mask(capacity - 1) {}
+  SPSCQueue(const SPSCQueue &) = delete;
+
+  /// Queue a value. Must only be called by the producer. Return false, without
+  /// moving from `value`, if the queue is full.
+  bool push(T &&value) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == slots.size())
+      return false;
+    slots[t & mask] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Pop a value. Must only be called by the consumer. Return true if there was
+  /// a value in the queue.
+  bool pop(T &value) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    value = std::move(slots[h & mask]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::vector<T> slots;
+  const size_t mask;
+  /// The number of values popped, written by the consumer.
+  alignas(64) std::atomic<size_t> head{0};
+  /// The number of values pushed, written by the producer.
+  alignas(64) std::atomic<size_t> tail{0};
+};
+
+/// A message buffer.
+using Blob = std::vector<uint8_t>;
+
+/// Returns a blob to the `BlobPool` when its owner goes away.
+struct BlobDeleter {
+  void operator()(Blob *blob) const;
+};
+
+/// A thread-safe pool of blobs, in power-of-two size classes. Messages are
+/// allocated on one thread and freed on another at a high rate, so recycling
+/// their buffers avoids most of the allocation traffic. Blobs larger than the
+/// largest size class are not pooled.
+class BlobPool {
+public:
+  /// Get a zero-filled blob of the specified size.
+  static std::unique_ptr<Blob, BlobDeleter> allocate(size_t size);
+  /// Return a blob to its size class, or free it if the class is full.
+  static void release(Blob *blob);
+};
+
+/// Tracks whether any endpoint may have a message for the simulation, so that
+/// the simulator can skip polling the endpoints altogether when none does. An
+/// endpoint with shared memory attached always counts as pending, since its
+/// client writes the ring directly.
+struct PendingMessages {
+  /// The number of messages queued to the simulation over RPC.
+  std::atomic<int64_t> queued{0};
+  /// The number of endpoints with shared memory attached.
+  std::atomic<int> shmAttached{0};
+
+  bool any() const {
+    return queued.load(std::memory_order_acquire) > 0 ||
+           shmAttached.load(std::memory_order_acquire) > 0;
+  }
+};
+
 /// Implements a bi-directional, thread-safe bridge between the RPC server and
-/// DPI functions.
+/// DPI functions. Each direction is a lock-free queue with a single producer
+/// and a single consumer: messages to the simulation are pushed by the RPC
+/// server thread serving the client which has the endpoint open, and popped by
+/// the simulator, and vice versa. The endpoint is only open for one client at
+/// a time, and opening it synchronizes with the previous close. Clients on the
+/// same host can instead attach a shared-memory transport, which bypasses the
+/// RPC server entirely.
 ///
 /// Several of the methods below are inline with the declaration to make them
 /// candidates for inlining during compilation. This is particularly important
@@ -32,15 +122,15 @@ namespace cosim {
 /// want to slow down the simulation any more than necessary.
 class Endpoint {
 public:
-  /// Representing messages as shared pointers to vectors may be a performance
-  /// issue in the future but it is the easiest way to ensure memory
-  /// correctness.
-  using Blob = std::vector<uint8_t>;
-  using BlobPtr = std::shared_ptr<Blob>;
+  /// Messages have a single owner at a time, which hands them on through the
+  /// queues, and their buffers are recycled through the `BlobPool`.
+  using Blob = cosim::Blob;
+  using BlobPtr = std::unique_ptr<Blob, BlobDeleter>;
 
   /// Construct an endpoint which knows and the type IDs in both directions.
+  /// Messages to the simulation are accounted for in `pending`.
   Endpoint(uint64_t sendTypeId, int sendTypeMaxSize, uint64_t recvTypeId,
-           int recvTypeMaxSize);
+           int recvTypeMaxSize, bool packed, PendingMessages &pending);
   ~Endpoint();
   /// Disallow copying. There is only ONE endpoint object per logical endpoint
   /// so copying is almost always a bug.
@@ -48,82 +138,152 @@ public:
 
   uint64_t getSendTypeId() const { return sendTypeId; }
   uint64_t getRecvTypeId() const { return recvTypeId; }
+  /// The maximum message sizes in bytes, which were validated at registration.
+  /// The batched DPI transfers lay out one message per slot of this size.
+  int getSendTypeMaxSize() const { return sendTypeMaxSize; }
+  int getRecvTypeMaxSize() const { return recvTypeMaxSize; }
+  /// Packed endpoints exchange the raw bits of their values, which are exactly
+  /// the maximum sizes, instead of capnp messages. The RPC server wraps them
+  /// in `UntypedData` messages.
+  bool isPacked() const { return packed; }
 
   /// These two are used to set and unset the inUse flag, to ensure that an open
   /// endpoint is not opened again.
   bool setInUse();
   void returnForUse();
+  /// Return true if a client has the endpoint open.
+  bool isInUse() const { return inUse.load(std::memory_order_acquire); }
+
+  /// The maximum number of messages queued in each direction.
+  static constexpr size_t queueCapacity = 4096;
 
-  /// Queue message to the simulation.
-  void pushMessageToSim(BlobPtr msg) {
-    Lock g(m);
-    toCosim.push(msg);
+  /// Queue message to the simulation. Only called from the RPC server thread.
+  /// Return false, leaving `msg` with the caller, if the queue is full.
+  bool pushMessageToSim(BlobPtr &&msg) {
+    if (!toCosim.push(std::move(msg)))
+      return false;
+    pending.queued.fetch_add(1, std::memory_order_release);
+    return true;
   }
 
-  /// Pop from the to-simulator queue. Return true if there was a message in the
-  /// queue.
+  /// Pop from the to-simulator queue. Only called from the simulator thread.
+  /// Return true if there was a message in the queue.
   bool getMessageToSim(BlobPtr &msg) {
-    Lock g(m);
-    if (toCosim.empty())
+    if (!toCosim.pop(msg))
       return false;
-    msg = toCosim.front();
-    toCosim.pop();
+    pending.queued.fetch_sub(1, std::memory_order_relaxed);
     return true;
   }
 
-  /// Queue message to the RPC client.
-  void pushMessageToClient(BlobPtr msg) {
-    Lock g(m);
-    toClient.push(msg);
+  /// Queue message to the RPC client. Only called from the simulator thread.
+  /// Return false, leaving `msg` with the caller, if the queue is full.
+  bool pushMessageToClient(BlobPtr &&msg) {
+    return toClient.push(std::move(msg));
   }
 
-  /// Pop from the to-RPC-client queue. Return true if there was a message in
-  /// the queue.
-  bool getMessageToClient(BlobPtr &msg) {
-    Lock g(m);
-    if (toClient.empty())
+  /// Pop from the to-RPC-client queue. Only called from the RPC server thread.
+  /// Return true if there was a message in the queue.
+  bool getMessageToClient(BlobPtr &msg) { return toClient.pop(msg); }
+
+  /// Attach the shared-memory transport with the specified name, creating it
+  /// the first time. Only called from the RPC server thread, for an endpoint
+  /// in use. Return nullptr and set `error` if unsuccessful.
+  ShmChannel *attachShm(const std::string &name, std::string &error);
+
+  /// Call `f(data, size)` on the next message to the simulation and consume it.
+  /// Messages are taken from the shared memory if it is attached, and from
+  /// the RPC queue otherwise. Only called from the simulator thread. Return
+  /// false if there was no message.
+  template <typename F>
+  bool consumeMessageToSim(F f) {
+    if (ShmChannel *shm = attachedShm.load(std::memory_order_acquire)) {
+      const uint8_t *data;
+      size_t size;
+      if (shm->peekMessageToSim(data, size)) {
+        f(data, size);
+        shm->popMessageToSim();
+        return true;
+      }
+    }
+    BlobPtr msg;
+    if (!getMessageToSim(msg))
       return false;
-    msg = toClient.front();
-    toClient.pop();
+    f(msg->data(), msg->size());
     return true;
   }
 
+  /// Send a message of `size` bytes to the client, which `fill(data)` writes.
+  /// The message is written directly into the shared memory if it is
+  /// attached, and queued for RPC otherwise. Only called from the simulator
+  /// thread. Return false if the queue is full or the message doesn't fit.
+  template <typename F>
+  bool produceMessageToClient(size_t size, F fill) {
+    if (ShmChannel *shm = attachedShm.load(std::memory_order_acquire)) {
+      uint8_t *data = shm->getMessageToClientSlot(size);
+      if (!data)
+        return false;
+      fill(data);
+      shm->publishMessageToClient(size);
+      return true;
+    }
+    auto msg = BlobPool::allocate(size);
+    fill(msg->data());
+    return toClient.push(std::move(msg));
+  }
+
 private:
   const uint64_t sendTypeId;
+  const int sendTypeMaxSize;
   const uint64_t recvTypeId;
-  bool inUse;
-
-  using Lock = std::lock_guard<std::mutex>;
+  const int recvTypeMaxSize;
+  const bool packed;
+  std::atomic<bool> inUse;
+  PendingMessages &pending;
 
-  /// This class needs to be thread-safe. All of the mutable member variables
-  /// are protected with this object-wide lock. This may be a performance issue
-  /// in the future.
-  std::mutex m;
   /// Message queue from RPC client to the simulation.
-  std::queue<BlobPtr> toCosim;
+  SPSCQueue<BlobPtr> toCosim;
   /// Message queue to RPC client from the simulation.
-  std::queue<BlobPtr> toClient;
+  SPSCQueue<BlobPtr> toClient;
+
+  /// The shared-memory transport, once created. It lives as long as the
+  /// endpoint, since the simulator may still be using it after a client
+  /// detaches.
+  std::unique_ptr<ShmChannel> shm;
+  /// The shared-memory transport while a client has it attached.
+  std::atomic<ShmChannel *> attachedShm{nullptr};
 };
 
 /// The Endpoint registry is where Endpoints report their existence (register)
 /// and they are looked up by RPC clients.
+///
+/// Lookups happen at every clock on the simulation side, so they do not take a
+/// lock. Instead, each registration publishes a new immutable table of the
+/// endpoints sorted by ID, which readers access through an atomic pointer. The
+/// previous tables are kept alive, since a reader may still be using one;
+/// endpoints are only registered at the start of the simulation, so there are
+/// few of them.
 class EndpointRegistry {
 public:
   /// Register an Endpoint. Creates the Endpoint object and owns it. Returns
   /// false if unsuccessful.
   bool registerEndpoint(int epId, uint64_t sendTypeId, int sendTypeMaxSize,
-                        uint64_t recvTypeId, int recvTypeMaxSize);
+                        uint64_t recvTypeId, int recvTypeMaxSize,
+                        bool packed = false);
 
   /// Get the specified endpoint. Return nullptr if it does not exist. This
   /// method is defined inline so it can be inlined at compile time. Performance
   /// is important here since this method is used in the polling call from the
   /// simulator. Returns nullptr if the endpoint cannot be found.
   Endpoint *operator[](int epId) {
-    Lock g(m);
-    auto it = endpoints.find(epId);
-    if (it == endpoints.end())
+    const Table *table = currentTable.load(std::memory_order_acquire);
+    if (!table)
+      return nullptr;
+    auto it = std::lower_bound(
+        table->begin(), table->end(), epId,
+        [](const TableEntry &entry, int id) { return entry.first < id; });
+    if (it == table->end() || it->first != epId)
       return nullptr;
-    return &it->second;
+    return it->second;
   }
 
   /// Iterate over the list of endpoints, calling the provided function for each
@@ -132,14 +292,29 @@ public:
   /// Return the number of endpoints.
   size_t size() const;
 
+  /// Return true if any endpoint may have a message for the simulation. This
+  /// is a pair of atomic loads, so the simulator can call it at every clock
+  /// instead of polling each endpoint.
+  bool anyPending() const { return pending.any(); }
+
 private:
   using Lock = std::lock_guard<std::mutex>;
+  using TableEntry = std::pair<int, Endpoint *>;
+  using Table = std::vector<TableEntry>;
 
-  /// This object needs to be thread-safe. An object-wide mutex is sufficient.
+  /// Serializes registrations. Readers do not need it.
   std::mutex m;
 
-  /// Endpoint ID to object pointer mapping.
+  /// Endpoint ID to object mapping. Only accessed by registrations. The nodes
+  /// of a map are never moved, so the tables can point into it.
   std::map<int, Endpoint> endpoints;
+
+  /// All the published tables, the last one being the current one.
+  std::list<Table> tables;
+  std::atomic<const Table *> currentTable{nullptr};
+
+  /// Shared by all the endpoints.
+  PendingMessages pending;
 };
 
 } // namespace cosim
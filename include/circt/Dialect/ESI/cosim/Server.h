@@ -17,16 +17,20 @@
 #define CIRCT_DIALECT_ESI_COSIM_SERVER_H
 
 #include "circt/Dialect/ESI/cosim/Endpoint.h"
+#include <atomic>
 #include <thread>
+#include <vector>
 
 namespace circt {
 namespace esi {
 namespace cosim {
 
 /// The main RpcServer. Does not implement any capnp RPC interfaces but contains
-/// the capnp main RPC server. We run the capnp server in its own thread to be
-/// more responsive to network traffic and so as to not slow down the
-/// simulation.
+/// the capnp main RPC servers. We run the capnp servers in their own threads to
+/// be more responsive to network traffic and so as to not slow down the
+/// simulation. Each thread runs its own event loop and accepts connections on
+/// the same listening socket, so the client connections, and the endpoints
+/// they open, are spread over the threads.
 class RpcServer {
 public:
   EndpointRegistry endpoints;
@@ -34,18 +38,19 @@ public:
   RpcServer();
   ~RpcServer();
 
-  /// Start and stop the server thread.
-  void run(uint16_t port);
+  /// Start and stop the server threads.
+  void run(uint16_t port, unsigned numThreads = 1);
   void stop();
 
 private:
   using Lock = std::lock_guard<std::mutex>;
 
-  /// The thread's main loop function. Exits on shutdown.
-  void mainLoop(uint16_t port);
+  /// A thread's main loop function. Takes ownership of the listening socket.
+  /// Exits on shutdown.
+  void mainLoop(int listenFd, uint16_t port);
 
-  std::thread *mainThread;
-  volatile bool stopSig;
+  std::vector<std::thread> threads;
+  std::atomic<bool> stopSig;
   std::mutex m;
 };
 
@@ -0,0 +1,119 @@
+//===- ShmChannel.h - Cosim shared-memory transport -------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Declare the shared-memory transport between an endpoint and a client on the
+// same host. The memory layout below is part of the client interface: it is
+// what clients map after opening an endpoint with `openShm`.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_DIALECT_ESI_COSIM_SHMCHANNEL_H
+#define CIRCT_DIALECT_ESI_COSIM_SHMCHANNEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace circt {
+namespace esi {
+namespace cosim {
+
+/// A single-producer, single-consumer ring of fixed-size slots in shared
+/// memory. Each slot is a 32-bit message size followed by `slotSize` bytes of
+/// message data, padded to 8 bytes. The counters only ever increase (modulo
+/// 2^32) and message `i` lives in slot `i % capacity`, so the capacity is a
+/// power of two.
+///
+/// A consumer which wants to block sets `waiters`, re-checks `tail`, and waits
+/// on `tail` with a shared futex. Producers wake `tail` after publishing a
+/// message whenever `waiters` is set.
+struct ShmRing {
+  /// The number of messages consumed. Only written by the consumer.
+  alignas(64) std::atomic<uint32_t> head;
+  /// The number of messages produced, also the futex word. Only written by the
+  /// producer.
+  alignas(64) std::atomic<uint32_t> tail;
+  /// Non-zero while the consumer is waiting on `tail`.
+  std::atomic<uint32_t> waiters;
+  uint32_t capacity;
+  uint32_t slotSize;
+  /// The stride between slots, in bytes.
+  uint32_t slotStride;
+  /// The offset of the first slot from the start of the ring, in bytes.
+  uint32_t slotsOffset;
+};
+
+/// The header at the start of the shared memory.
+struct ShmHeader {
+  static constexpr uint32_t magicValue = 0x45534953; // "ESIS"
+  static constexpr uint32_t versionValue = 1;
+
+  uint32_t magic;
+  uint32_t version;
+  /// The offsets of the rings from the start of the shared memory, in bytes.
+  uint64_t toSimOffset;
+  uint64_t toClientOffset;
+  uint64_t totalSize;
+};
+
+/// The simulation side of the shared-memory transport of an endpoint. Messages
+/// are read directly out of, and written directly into, the shared slots, so
+/// they are not copied into intermediate buffers. The slots carry the same
+/// bytes as the RPC messages, i.e. single-segment capnp messages.
+class ShmChannel {
+public:
+  /// Create the shared memory with the specified name. Return nullptr and set
+  /// `error` if unsuccessful.
+  static std::unique_ptr<ShmChannel> create(const std::string &name,
+                                            uint32_t capacity,
+                                            uint32_t toSimSlotSize,
+                                            uint32_t toClientSlotSize,
+                                            std::string &error);
+  ~ShmChannel();
+  ShmChannel(const ShmChannel &) = delete;
+
+  const std::string &getName() const { return name; }
+  uint32_t getCapacity() const { return toSim->capacity; }
+  uint32_t getToSimSlotSize() const { return toSim->slotSize; }
+  uint32_t getToClientSlotSize() const { return toClient->slotSize; }
+
+  /// Get the next message to the simulation without consuming it. Return false
+  /// if there is none.
+  bool peekMessageToSim(const uint8_t *&data, size_t &size);
+  /// Consume the message returned by the last `peekMessageToSim`.
+  void popMessageToSim();
+
+  /// Get the slot of the next message to the client, to be filled with `size`
+  /// bytes. Return nullptr if the ring is full or the message doesn't fit.
+  uint8_t *getMessageToClientSlot(size_t size);
+  /// Publish the message of `size` bytes written to the slot returned by the
+  /// last `getMessageToClientSlot`, and wake the client if it is blocked.
+  void publishMessageToClient(size_t size);
+
+private:
+  ShmChannel(std::string name, void *memory, size_t size);
+
+  uint8_t *getSlot(ShmRing *ring, uint32_t index) {
+    return reinterpret_cast<uint8_t *>(ring) + ring->slotsOffset +
+           (size_t)(index % ring->capacity) * ring->slotStride;
+  }
+
+  std::string name;
+  void *memory;
+  size_t size;
+  ShmRing *toSim;
+  ShmRing *toClient;
+};
+
+} // namespace cosim
+} // namespace esi
+} // namespace circt
+
+#endif
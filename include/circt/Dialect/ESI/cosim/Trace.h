@@ -0,0 +1,69 @@
+//===- Trace.h - Cosim binary message traces --------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Define the format of the binary traces which the DPI server writes to the
+// file named by COSIM_TRACE_FILE, and which esi-cosim-replay plays back. The
+// format is also read by esi-cosim-trace.py.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_DIALECT_ESI_COSIM_TRACE_H
+#define CIRCT_DIALECT_ESI_COSIM_TRACE_H
+
+#include <cstdint>
+
+namespace circt {
+namespace esi {
+namespace cosim {
+
+/// A trace starts with this magic number and version, followed by one record
+/// per event, in the order of the DPI calls of the simulator. Version 1 traces
+/// only have message records.
+static constexpr uint32_t traceMagic = 0x54495345; // "ESIT"
+static constexpr uint32_t traceVersion = 2;
+
+/// The kinds of trace records.
+enum class TraceRecordKind : uint32_t {
+  /// A message to the simulation, from the client.
+  MessageToSim = 0,
+  /// A message to the client, from the simulation.
+  MessageToClient = 1,
+  /// The registration of an endpoint, followed by a `TraceEndpoint`.
+  Endpoint = 2,
+};
+
+/// The header of a record in the binary trace. It is followed by `size` bytes
+/// of payload, the message itself for the message records. The fields are in
+/// host byte order.
+struct TraceRecord {
+  /// The time of the DPI call, in nanoseconds since the trace was opened.
+  uint64_t timeNs;
+  uint32_t epId;
+  TraceRecordKind kind;
+  uint32_t size;
+  uint32_t reserved;
+};
+static_assert(sizeof(TraceRecord) == 24, "The trace format is fixed");
+
+/// The payload of an endpoint registration record, which lets a replay
+/// register the same endpoints as the simulation did.
+struct TraceEndpoint {
+  uint64_t sendTypeId;
+  uint64_t recvTypeId;
+  int32_t sendTypeMaxSize;
+  int32_t recvTypeMaxSize;
+  uint32_t packed;
+  uint32_t reserved;
+};
+static_assert(sizeof(TraceEndpoint) == 32, "The trace format is fixed");
+
+} // namespace cosim
+} // namespace esi
+} // namespace circt
+
+#endif
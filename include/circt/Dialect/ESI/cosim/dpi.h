@@ -30,6 +30,13 @@ extern "C" {
 extern int sv2cCosimserverEpRegister(int endpointId, long long sendTypeId,
                                      int sendTypeSize, long long recvTypeId,
                                      int recvTypeSize);
+/// Register an endpoint which exchanges packed data instead of capnp messages.
+extern int sv2cCosimserverEpRegisterPacked(int endpointId, long long sendTypeId,
+                                           int sendTypeSize,
+                                           long long recvTypeId,
+                                           int recvTypeSize);
+/// Return non-zero if any endpoint may have a message from a client.
+extern int sv2cCosimserverAnyPending();
 /// Try to get a message from a client.
 extern int sv2cCosimserverEpTryGet(unsigned int endpointId,
                                    // NOLINTNEXTLINE(misc-misplaced-const)
@@ -39,6 +46,17 @@ extern int sv2cCosimserverEpTryGet(unsigned int endpointId,
 extern int sv2cCosimserverEpTryPut(unsigned int endpointId,
                                    // NOLINTNEXTLINE(misc-misplaced-const)
                                    const svOpenArrayHandle data, int dataLimit);
+/// Try to get up to *numMsgs messages from a client, one per slot of the
+/// receive type size.
+extern int sv2cCosimserverEpTryGetBatch(unsigned int endpointId,
+                                        // NOLINTNEXTLINE(misc-misplaced-const)
+                                        const svOpenArrayHandle data,
+                                        unsigned int *numMsgs);
+/// Send numMsgs messages to a client, one per slot of the send type size.
+extern int sv2cCosimserverEpTryPutBatch(unsigned int endpointId,
+                                        // NOLINTNEXTLINE(misc-misplaced-const)
+                                        const svOpenArrayHandle data,
+                                        int numMsgs);
 
 /// Start the server. Not required as the first endpoint registration will do
 /// this. Provided if one wants to start the server early.
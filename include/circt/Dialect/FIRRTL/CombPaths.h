@@ -0,0 +1,92 @@
+//===- CombPaths.h - Combinational paths analysis ---------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FIRRTL CombPathsAnalysis, which summarizes the
+// combinational paths between the ports of each module of a circuit, and
+// records the combinational cycles found along the way.
+//
+//===----------------------------------------------------------------------===//
+#ifndef CIRCT_DIALECT_FIRRTL_COMBPATHS_H
+#define CIRCT_DIALECT_FIRRTL_COMBPATHS_H
+
+#include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "circt/Support/LLVM.h"
+#include "llvm/ADT/StringMap.h"
+
+namespace circt {
+namespace firrtl {
+
+class InstanceGraph;
+
+/// The combinational paths between the ports of a module. Ports are identified
+/// by their position in the FIRRTL module, and their names are recorded so
+/// that the summary can still be matched against the module once it has been
+/// lowered to the HW dialect, which keeps port names.
+struct ModuleCombPaths {
+  /// The names of the ports of the module.
+  SmallVector<StringAttr> portNames;
+
+  /// For each port, the output ports it reaches through combinational logic.
+  /// This is empty for output ports.
+  SmallVector<SmallVector<size_t, 2>> paths;
+
+  /// Return the output ports the specified port combinationally reaches.
+  ArrayRef<size_t> getOutputs(size_t port) const { return paths[port]; }
+
+  /// Return true if there is a combinational path from the input port named
+  /// `input` to the output port named `output`.
+  bool hasPath(StringRef input, StringRef output) const;
+};
+
+/// A combinational cycle detected in a module, recorded by location so that it
+/// can be reported after the IR has changed.
+struct CombCycle {
+  /// The module the cycle lives in.
+  Location moduleLoc;
+
+  /// The locations of the values which are part of the cycle.
+  SmallVector<Location> valueLocs;
+};
+
+/// This analysis computes the combinational paths between the ports of every
+/// module of a circuit, visiting modules in post order of the instance graph
+/// so that the paths through an instance are those of its module. The paths
+/// are computed once and can be queried by any pass as long as the analysis is
+/// preserved. Cycles are recorded rather than reported, which is left to the
+/// firrtl-check-comb-cycles pass.
+///
+/// The analysis expects the circuit to have been processed by LowerTypes, such
+/// that every port is a ground type and paths are tracked field by field.
+class CombPathsAnalysis {
+public:
+  explicit CombPathsAnalysis(Operation *circuit);
+  CombPathsAnalysis(Operation *circuit, InstanceGraph &instanceGraph);
+
+  /// Return the combinational paths of the module with the specified name, or
+  /// null if it is not part of the circuit.
+  const ModuleCombPaths *lookup(StringRef moduleName) const {
+    auto it = modules.find(moduleName);
+    return it == modules.end() ? nullptr : &it->second;
+  }
+
+  /// Return the combinational cycles detected in the circuit.
+  ArrayRef<CombCycle> getCycles() const { return cycles; }
+
+private:
+  void analyze(InstanceGraph &instanceGraph);
+
+  /// The combinational paths of each module, by module name.
+  llvm::StringMap<ModuleCombPaths> modules;
+
+  SmallVector<CombCycle> cycles;
+};
+
+} // namespace firrtl
+} // namespace circt
+
+#endif // CIRCT_DIALECT_FIRRTL_COMBPATHS_H
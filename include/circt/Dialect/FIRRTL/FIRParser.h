@@ -14,6 +14,13 @@
 #ifndef CIRCT_DIALECT_FIRRTL_FIRPARSER_H
 #define CIRCT_DIALECT_FIRRTL_FIRPARSER_H
 
+#include "mlir/Support/LogicalResult.h"
+#include "llvm/ADT/STLExtras.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace llvm {
 class SourceMgr;
 }
@@ -26,16 +33,73 @@ class OwningModuleRef;
 namespace circt {
 namespace firrtl {
 
+class FModuleOp;
+
+/// Statistics about the parsing of the body of one module, which are collected
+/// if `FIRParserOptions::moduleStatistics` is set.  Times are in microseconds,
+/// and the start time is relative to the start of the import.
+struct FIRModuleStatistics {
+  std::string name;
+  /// The size of the module body in the .fir file, in bytes.
+  size_t bytes = 0;
+  /// The number of tokens lexed and operations created for the module body.
+  size_t tokens = 0;
+  size_t ops = 0;
+  /// The thread that parsed the module.
+  uint64_t threadID = 0;
+  uint64_t startTime = 0;
+  uint64_t parseTime = 0;
+  /// The time it takes to verify the module on its own.
+  uint64_t verifyTime = 0;
+};
+
 struct FIRParserOptions {
   /// If this is set to true, the @info locators are ignored, and the locations
   /// are set to the location in the .fir file.
   bool ignoreInfoLocators = false;
+
+  /// If this is set to true, no source locations are attached to the IR at
+  /// all: the @info locators are skipped without being decoded, no locations
+  /// in the .fir file are created, and everything gets an unknown location.
+  /// Diagnostics produced by the parser itself still point into the .fir file.
+  bool ignoreAllLocations = false;
+
+  /// If this is set, it is filled with statistics about each module with a
+  /// body, in the order of the .fir file.  This verifies each module right
+  /// after it is parsed to measure how long that takes, on top of verifying
+  /// the whole circuit at the end.
+  std::vector<FIRModuleStatistics> *moduleStatistics = nullptr;
 };
 
 mlir::OwningModuleRef importFIRFile(llvm::SourceMgr &sourceMgr,
                                     mlir::MLIRContext *context,
                                     FIRParserOptions options = {});
 
+/// A callback that is handed each module as soon as its body is parsed.
+using FIRModuleCallback = llvm::function_ref<mlir::LogicalResult(FModuleOp)>;
+
+/// Parse the specified .fir file, streaming each module to `moduleCallback` as
+/// soon as its body has been parsed and verified, while later modules are still
+/// being parsed.  This allows module-local work to overlap with parsing.
+///
+/// Module bodies are parsed in parallel, so the callback is invoked
+/// concurrently from multiple threads, once for each module, in no particular
+/// order.  It may only modify the body of the module it is given, since the
+/// other modules may still be under construction; the signatures of all
+/// modules are complete before the first callback.  If the callback fails, the
+/// import fails.  The returned circuit is verified as a whole after all modules
+/// have been handed out.
+mlir::OwningModuleRef importFIRFile(llvm::SourceMgr &sourceMgr,
+                                    mlir::MLIRContext *context,
+                                    FIRParserOptions options,
+                                    FIRModuleCallback moduleCallback);
+
+/// Lex the .fir file in the main buffer of the source manager without parsing
+/// it, counting the tokens in it.  This exists to measure the performance of
+/// the lexer in isolation.  This fails if an invalid token is encountered.
+mlir::LogicalResult lexFIRFile(llvm::SourceMgr &sourceMgr,
+                               mlir::MLIRContext *context, size_t &numTokens);
+
 void registerFromFIRFileTranslation();
 
 } // namespace firrtl
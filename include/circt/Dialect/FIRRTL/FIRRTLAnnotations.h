@@ -16,7 +16,14 @@
 #include "circt/Support/LLVM.h"
 #include "mlir/IR/BuiltinAttributes.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/PointerLikeTypeTraits.h"
+#include "llvm/Support/Mutex.h"
+#include "llvm/Support/RWMutex.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace circt {
 namespace firrtl {
@@ -31,6 +38,63 @@ inline StringRef getAnnotationAttrName() { return "annotations"; }
 /// Return the name of the dialect-prefixed attribute used for annotations.
 inline StringRef getDialectAnnotationAttrName() { return "firrtl.annotations"; }
 
+namespace detail {
+/// A summary of the classes of the annotations in an annotation array.
+struct AnnotationClassSummary {
+  /// The bits of the registered classes which are in the array.
+  uint64_t classes = 0;
+  /// Whether the array holds classes which have no bit.
+  bool hasOtherClasses = false;
+};
+
+/// The annotation classes of a context, and a summary of the classes of each
+/// annotation array queried.  The first 64 class names seen are each given a
+/// bit, so most queries are a test of the summary of the array, even for
+/// classes it doesn't have.  Annotation arrays are uniqued and immutable, so
+/// summaries never become stale.  This is owned by the FIRRTL dialect and
+/// shared by all the threads of its context: the summaries are split in shards
+/// locked separately, and the class bits are read without a lock.
+class AnnotationClassCache {
+public:
+  AnnotationClassCache();
+
+  /// Return whether an annotation array holds an annotation of the specified
+  /// class, or None if its summary does not tell.
+  Optional<bool> hasClass(ArrayAttr annotations, StringRef className);
+
+  /// Return the summary of the classes in an annotation array, computing it
+  /// if needed.
+  AnnotationClassSummary getSummary(ArrayAttr annotations);
+
+  /// Return the bit of a class name, or 0 if it has none.  Classes are given a
+  /// bit when first seen in a summarized array, so a class without a bit is in
+  /// no summarized array which has no other classes.
+  uint64_t getClassBit(StringRef className) const;
+
+private:
+  using ClassBits = llvm::StringMap<uint64_t>;
+
+  /// Give a bit to each class of an annotation array which has none yet, while
+  /// there are bits left, and return the summary of the array.
+  AnnotationClassSummary summarize(ArrayAttr annotations);
+
+  /// A part of the summaries, selected by the address of the array.
+  struct Shard {
+    llvm::sys::SmartRWMutex<true> mutex;
+    DenseMap<ArrayAttr, AnnotationClassSummary> summaries;
+  };
+  static constexpr unsigned numShards = 32;
+  Shard shards[numShards];
+
+  /// The current class bits.  Registering a class publishes a new copy of
+  /// them, so that readers take no lock.  At most 64 classes are registered,
+  /// and all the copies are kept since readers may still be using them.
+  std::atomic<const ClassBits *> classBits;
+  std::vector<std::unique_ptr<ClassBits>> classBitsCopies;
+  llvm::sys::SmartMutex<true> classBitsMutex;
+};
+} // namespace detail
+
 /// This class provides a read-only projection over the MLIR attributes that
 /// represent a set of annotations.  It is intended to make this work less
 /// stringly typed and fiddly for clients.
@@ -219,6 +283,9 @@ public:
       llvm::function_ref<bool(unsigned, Annotation)> predicate);
 
 private:
+  /// Return whether this set has an annotation with the specified class name,
+  /// according to the class summary of the context, if it knows.
+  Optional<bool> lookupAnnotationClass(StringRef className) const;
   bool hasAnnotationImpl(StringAttr className) const;
   bool hasAnnotationImpl(StringRef className) const;
   DictionaryAttr getAnnotationImpl(StringAttr className) const;
@@ -227,6 +294,42 @@ private:
   ArrayAttr annotations;
 };
 
+/// A batch of edits to the port annotations of a module or extmodule.  The
+/// annotations of all the ports are read once when this is created, and
+/// written back to the module in a single update of its argument attributes by
+/// `applyToModule`, rather than one update per port edited.
+class PortAnnotationsBuilder {
+public:
+  explicit PortAnnotationsBuilder(Operation *module);
+
+  size_t getNumPorts() const { return annotations.size(); }
+
+  /// Return the annotations of a port, including the edits made so far.
+  const AnnotationSet &getPortAnnotations(unsigned portNo) const {
+    return annotations[portNo];
+  }
+
+  /// Replace the annotations of a port.
+  void setPortAnnotations(unsigned portNo, AnnotationSet portAnnotations);
+
+  /// Remove all port annotations for which `predicate` returns true. The
+  /// predicate is guaranteed to be called on every annotation. Returns true if
+  /// any annotations were removed, false otherwise.
+  bool
+  removeAnnotations(llvm::function_ref<bool(unsigned, Annotation)> predicate);
+
+  /// Store the edited port annotations in the module.  Returns true if the
+  /// module was modified, false otherwise.
+  bool applyToModule();
+
+private:
+  Operation *module;
+  /// The original attribute dictionary of each port.
+  SmallVector<DictionaryAttr, 8> portAttrs;
+  SmallVector<AnnotationSet, 8> annotations;
+  bool changed = false;
+};
+
 /// This class provides a read-only projection of an annotation.
 class Annotation {
 public:
@@ -34,6 +34,7 @@ class UIntType;
 class AnalogType;
 class BundleType;
 class FVectorType;
+struct FieldIDInfo;
 
 /// A collection of bits indicating the recursive properties of a type.
 struct RecursiveTypeProperties {
@@ -114,10 +115,27 @@ public:
   /// Returns the new id and whether the id is in the given child.
   std::pair<unsigned, bool> rootChildFieldID(unsigned fieldID, unsigned index);
 
+  /// Return the type of the field with the specified field ID, and where it is
+  /// within its parent aggregate. Field ID 0 is this type itself.
+  FieldIDInfo getFieldIDInfo(unsigned fieldID);
+
+  /// Return the type of the field with the specified field ID.
+  FIRRTLType getFieldType(unsigned fieldID);
+
 protected:
   using Type::Type;
 };
 
+/// Describes a field of an aggregate type, identified by its field ID.
+struct FieldIDInfo {
+  /// The type of the field.
+  FIRRTLType type;
+  /// The field ID of the aggregate directly containing the field.
+  unsigned parentID;
+  /// The index of the field within the aggregate directly containing it.
+  unsigned index;
+};
+
 /// Returns whether the two types are equivalent. See the FIRRTL spec for the
 /// full definition of type equivalence. This predicate differs from the spec in
 /// that it only compares passive types. Because of how the FIRRTL dialect uses
@@ -331,6 +349,11 @@ public:
   /// of the type.  Essentially maps a fieldID to a fieldID after a subfield op.
   /// Returns the new id and whether the id is in the given child.
   std::pair<unsigned, bool> rootChildFieldID(unsigned fieldID, unsigned index);
+
+  /// Describe the field with the specified field ID.  Bundles which are not
+  /// too large keep a table of all their nested fields, built on first use, so
+  /// this is a single lookup.
+  FieldIDInfo getFieldIDInfo(unsigned fieldID);
 };
 
 //===----------------------------------------------------------------------===//
@@ -372,6 +395,9 @@ public:
   /// of the type.  Essentially maps a fieldID to a fieldID after a subfield op.
   /// Returns the new id and whether the id is in the given child.
   std::pair<unsigned, bool> rootChildFieldID(unsigned fieldID, unsigned index);
+
+  /// Describe the field with the specified field ID.
+  FieldIDInfo getFieldIDInfo(unsigned fieldID);
 };
 
 } // namespace firrtl
@@ -14,6 +14,7 @@
 #define CIRCT_DIALECT_FIRRTL_FIRRTLVISITORS_H
 
 #include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "circt/Support/OpDispatch.h"
 #include "llvm/ADT/TypeSwitch.h"
 
 namespace circt {
@@ -26,31 +27,32 @@ class ExprVisitor {
 public:
   ResultType dispatchExprVisitor(Operation *op, ExtraArgs... args) {
     auto *thisCast = static_cast<ConcreteType *>(this);
-    return TypeSwitch<Operation *, ResultType>(op)
+    return dispatchOpClass<
+        ResultType,
         // Basic Expressions
-        .template Case<
-            ConstantOp, SpecialConstantOp, InvalidValueOp, SubfieldOp,
-            SubindexOp, SubaccessOp,
-            // Arithmetic and Logical Binary Primitives.
-            AddPrimOp, SubPrimOp, MulPrimOp, DivPrimOp, RemPrimOp, AndPrimOp,
-            OrPrimOp, XorPrimOp,
-            // Comparisons.
-            LEQPrimOp, LTPrimOp, GEQPrimOp, GTPrimOp, EQPrimOp, NEQPrimOp,
-            // Misc Binary Primitives.
-            CatPrimOp, DShlPrimOp, DShlwPrimOp, DShrPrimOp,
-            // Unary operators.
-            AsSIntPrimOp, AsUIntPrimOp, AsAsyncResetPrimOp, AsClockPrimOp,
-            CvtPrimOp, NegPrimOp, NotPrimOp, AndRPrimOp, OrRPrimOp, XorRPrimOp,
-            // Miscellaneous.
-            BitsPrimOp, HeadPrimOp, MuxPrimOp, PadPrimOp, ShlPrimOp, ShrPrimOp,
-            TailPrimOp, VerbatimExprOp, AsPassivePrimOp, AsNonPassivePrimOp,
-
-            // Conversion from FIRRTL to HW dialect types.
-            StdIntCastOp, HWStructCastOp, AnalogInOutCastOp>(
-            [&](auto expr) -> ResultType {
-              return thisCast->visitExpr(expr, args...);
-            })
-        .Default([&](auto expr) -> ResultType {
+        ConstantOp, SpecialConstantOp, InvalidValueOp, SubfieldOp, SubindexOp,
+        SubaccessOp,
+        // Arithmetic and Logical Binary Primitives.
+        AddPrimOp, SubPrimOp, MulPrimOp, DivPrimOp, RemPrimOp, AndPrimOp,
+        OrPrimOp, XorPrimOp,
+        // Comparisons.
+        LEQPrimOp, LTPrimOp, GEQPrimOp, GTPrimOp, EQPrimOp, NEQPrimOp,
+        // Misc Binary Primitives.
+        CatPrimOp, DShlPrimOp, DShlwPrimOp, DShrPrimOp,
+        // Unary operators.
+        AsSIntPrimOp, AsUIntPrimOp, AsAsyncResetPrimOp, AsClockPrimOp,
+        CvtPrimOp, NegPrimOp, NotPrimOp, AndRPrimOp, OrRPrimOp, XorRPrimOp,
+        // Miscellaneous.
+        BitsPrimOp, HeadPrimOp, MuxPrimOp, PadPrimOp, ShlPrimOp, ShrPrimOp,
+        TailPrimOp, VerbatimExprOp, AsPassivePrimOp, AsNonPassivePrimOp,
+
+        // Conversion from FIRRTL to HW dialect types.
+        StdIntCastOp, HWStructCastOp, AnalogInOutCastOp>(
+        op,
+        [&](auto expr) -> ResultType {
+          return thisCast->visitExpr(expr, args...);
+        },
+        [&](Operation *) -> ResultType {
           return thisCast->visitInvalidExpr(op, args...);
         });
   }
@@ -155,14 +157,14 @@ class StmtVisitor {
 public:
   ResultType dispatchStmtVisitor(Operation *op, ExtraArgs... args) {
     auto *thisCast = static_cast<ConcreteType *>(this);
-    return TypeSwitch<Operation *, ResultType>(op)
-        .template Case<AttachOp, ConnectOp, MemoryPortOp, MemoryPortAccessOp,
-                       PartialConnectOp, PrintFOp, SkipOp, StopOp, WhenOp,
-                       AssertOp, AssumeOp, CoverOp>(
-            [&](auto opNode) -> ResultType {
-              return thisCast->visitStmt(opNode, args...);
-            })
-        .Default([&](auto expr) -> ResultType {
+    return dispatchOpClass<ResultType, AttachOp, ConnectOp, MemoryPortOp,
+                           MemoryPortAccessOp, PartialConnectOp, PrintFOp,
+                           SkipOp, StopOp, WhenOp, AssertOp, AssumeOp, CoverOp>(
+        op,
+        [&](auto opNode) -> ResultType {
+          return thisCast->visitStmt(opNode, args...);
+        },
+        [&](Operation *) -> ResultType {
           return thisCast->visitInvalidStmt(op, args...);
         });
   }
@@ -206,12 +208,13 @@ class DeclVisitor {
 public:
   ResultType dispatchDeclVisitor(Operation *op, ExtraArgs... args) {
     auto *thisCast = static_cast<ConcreteType *>(this);
-    return TypeSwitch<Operation *, ResultType>(op)
-        .template Case<CombMemOp, InstanceOp, MemOp, NodeOp, RegOp, SeqMemOp,
-                       RegResetOp, WireOp>([&](auto opNode) -> ResultType {
+    return dispatchOpClass<ResultType, CombMemOp, InstanceOp, MemOp, NodeOp,
+                           RegOp, SeqMemOp, RegResetOp, WireOp>(
+        op,
+        [&](auto opNode) -> ResultType {
           return thisCast->visitDecl(opNode, args...);
-        })
-        .Default([&](auto expr) -> ResultType {
+        },
+        [&](Operation *) -> ResultType {
           return thisCast->visitInvalidDecl(op, args...);
         });
   }
@@ -0,0 +1,50 @@
+//===- FIRSnapshot.h - Binary FIRRTL snapshot format ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Defines the interface to the binary snapshot format, which is a compact
+// serialization of a parsed FIRRTL design that can be reloaded much faster
+// than re-parsing the .fir or .mlir text it came from.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_DIALECT_FIRRTL_FIRSNAPSHOT_H
+#define CIRCT_DIALECT_FIRRTL_FIRSNAPSHOT_H
+
+#include "circt/Support/LLVM.h"
+
+namespace llvm {
+class SourceMgr;
+}
+
+namespace mlir {
+class MLIRContext;
+class ModuleOp;
+class OwningModuleRef;
+} // namespace mlir
+
+namespace circt {
+namespace firrtl {
+
+/// Return true if the specified buffer starts with the snapshot magic number.
+bool isFIRSnapshot(StringRef buffer);
+
+/// Write the specified module, with all the operations, types, attributes and
+/// locations in it, to the specified stream as a binary snapshot.
+LogicalResult writeFIRSnapshot(mlir::ModuleOp module, raw_ostream &os);
+
+/// Load the binary snapshot in the main buffer of the source manager into the
+/// specified MLIR context.  The snapshot is read in place, so mapping the file
+/// makes loading it cheap.  This returns null and emits an error if the
+/// snapshot is malformed or the loaded IR does not verify.
+mlir::OwningModuleRef importFIRSnapshot(llvm::SourceMgr &sourceMgr,
+                                        mlir::MLIRContext *context);
+
+} // namespace firrtl
+} // namespace circt
+
+#endif // CIRCT_DIALECT_FIRRTL_FIRSNAPSHOT_H
@@ -15,8 +15,10 @@
 #include "circt/Dialect/FIRRTL/FIRRTLOps.h"
 #include "circt/Support/LLVM.h"
 #include "llvm/ADT/GraphTraits.h"
+#include "llvm/ADT/ilist.h"
+#include "llvm/ADT/ilist_node.h"
 #include "llvm/ADT/iterator.h"
-#include <deque>
+#include "llvm/Support/Allocator.h"
 
 namespace circt {
 namespace firrtl {
@@ -25,7 +27,7 @@ class InstanceGraphNode;
 
 /// This is an edge in the InstanceGraph. This tracks a specific instantiation
 /// of a module.
-class InstanceRecord {
+class InstanceRecord : public llvm::ilist_node<InstanceRecord> {
 public:
   InstanceRecord(InstanceOp instance, InstanceGraphNode *parent,
                  InstanceGraphNode *target)
@@ -41,6 +43,8 @@ public:
   InstanceGraphNode *getTarget() const { return target; }
 
 private:
+  friend class InstanceGraph;
+
   /// The InstanceOp that this is tracking.
   InstanceOp instance;
 
@@ -55,8 +59,8 @@ private:
 /// Circuit.  Both external modules and regular modules can be represented by
 /// this class. It is possible to efficiently iterate all modules instantiated
 /// by this module, as well as all instantiations of this module.
-class InstanceGraphNode {
-  using EdgeVec = std::deque<InstanceRecord>;
+class InstanceGraphNode : public llvm::ilist_node<InstanceGraphNode> {
+  using EdgeVec = llvm::iplist<InstanceRecord>;
   using UseVec = std::vector<InstanceRecord *>;
 
   static InstanceRecord *unwrap(EdgeVec::value_type &value) {
@@ -102,6 +106,9 @@ private:
   /// Record that a module instantiates this module.
   void recordUse(InstanceRecord *record);
 
+  /// Forget that a module instantiates this module.
+  void removeUse(InstanceRecord *record);
+
   /// The module.
   Operation *module;
 
@@ -123,10 +130,16 @@ private:
 ///
 /// To use this class, retrieve a cached copy from the analysis manager:
 ///   auto &instanceGraph = getAnalysis<InstanceGraph>(getOperation());
+///
+/// Passes which add or remove modules and instances can keep the graph up to
+/// date through the update methods below, and then preserve the analysis
+/// rather than having the next user rebuild it.  All query methods only read
+/// the graph, so they can be called from parallel workers without locking, as
+/// long as nothing updates the graph at the same time.
 class InstanceGraph {
 
   /// Storage for InstanceGraphNodes.
-  using NodeVec = std::deque<InstanceGraphNode>;
+  using NodeVec = llvm::iplist<InstanceGraphNode>;
 
   /// Iterator that unwraps a unique_ptr to return a regular pointer.
   static InstanceGraphNode *unwrap(NodeVec::value_type &value) {
@@ -167,6 +180,36 @@ public:
   iterator begin() { return nodes.begin(); }
   iterator end() { return nodes.end(); }
 
+  //===--------------------------------------------------------------------===//
+  // Updates
+  //===--------------------------------------------------------------------===//
+
+  /// Add a newly created module or extmodule to the graph.  Instances in the
+  /// body of the module are added as well.
+  InstanceGraphNode *addModule(Operation *module);
+
+  /// Remove a module from the graph, along with all the instances in it.  The
+  /// module must no longer be instantiated.  This must be called before the
+  /// module is erased.
+  void erase(InstanceGraphNode *node);
+
+  /// Replace a module with another operation of the same name, e.g. when an
+  /// extmodule is replaced by its implementation.  This only updates the
+  /// operation tracked by the node, the instances of the module are unchanged.
+  /// Instances in the body of the new module are added to the graph.
+  void replaceModule(Operation *oldModule, Operation *newModule);
+
+  /// Add a newly created instance op to the graph.
+  InstanceRecord *addInstance(InstanceOp instance);
+
+  /// Remove an instance op from the graph.  This must be called before the
+  /// instance is erased.
+  void removeInstance(InstanceOp instance);
+
+  /// Update the graph after the module referenced by an instance op was
+  /// changed, e.g. by setting its `moduleName` attribute.
+  void retargetInstance(InstanceOp instance);
+
 private:
   /// Get the node corresponding to the module.  If the node has does not exist
   /// yet, it will be created.
@@ -175,11 +218,47 @@ private:
   /// Lookup an module by name.
   InstanceGraphNode *lookup(StringRef name);
 
+  /// Lookup the record of an instance op, which is found by a linear search
+  /// through the instances of its parent module.
+  InstanceRecord *lookupRecord(InstanceOp instance);
+
+  /// Record all the instance ops in the body of a module.
+  void addInstances(InstanceGraphNode *node);
+
   /// The storage for graph nodes, with deterministic iteration.
   NodeVec nodes;
 
   /// This maps each operation to its graph node.
-  llvm::StringMap<unsigned> nodeMap;
+  llvm::StringMap<InstanceGraphNode *> nodeMap;
+};
+
+/// An absolute instance path, starting at an instance in the top-level module.
+using InstancePath = ArrayRef<InstanceOp>;
+
+/// A data structure that caches and provides absolute paths to module instances
+/// in the IR.  The paths are only valid as long as no instances are added or
+/// removed.  This is not thread-safe; compute the paths needed up front before
+/// handing them to parallel workers.
+struct InstancePathCache {
+  /// The instance graph of the IR.
+  InstanceGraph &instanceGraph;
+
+  explicit InstancePathCache(InstanceGraph &instanceGraph)
+      : instanceGraph(instanceGraph) {}
+
+  /// Return all the absolute instance paths to the specified module or
+  /// extmodule.  The top-level module has a single empty path.
+  ArrayRef<InstancePath> getAbsolutePaths(Operation *op);
+
+private:
+  /// An allocator for individual instance paths and entire path lists.
+  llvm::BumpPtrAllocator allocator;
+
+  /// Cached absolute instance paths.
+  DenseMap<Operation *, ArrayRef<InstancePath>> absolutePathsCache;
+
+  /// Append an instance to a path.
+  InstancePath appendInstance(InstancePath path, InstanceOp inst);
 };
 
 } // namespace firrtl
@@ -28,20 +28,33 @@ std::unique_ptr<mlir::Pass> createLowerFIRRTLTypesPass();
 
 std::unique_ptr<mlir::Pass> createLowerBundleVectorTypesPass();
 
-std::unique_ptr<mlir::Pass> createIMConstPropPass();
+std::unique_ptr<mlir::Pass>
+createIMConstPropPass(bool parallelPropagate = false);
+
+std::unique_ptr<mlir::Pass> createRemoveUnusedPortsPass();
+
+std::unique_ptr<mlir::Pass> createInlinerPass(bool autoInline = false);
+
+std::unique_ptr<mlir::Pass> createDedupPass();
 
-std::unique_ptr<mlir::Pass> createInlinerPass();
+std::unique_ptr<mlir::Pass>
+createDropAnnotationsPass(ArrayRef<std::string> keep = {});
 
 std::unique_ptr<mlir::Pass> createBlackBoxMemoryPass();
 
 std::unique_ptr<mlir::Pass> createExpandWhensPass();
 
-std::unique_ptr<mlir::Pass> createInferWidthsPass();
+std::unique_ptr<mlir::Pass> createFoldPass();
+
+std::unique_ptr<mlir::Pass>
+createInferWidthsPass(bool parallelSolve = false, StringRef cacheFile = {});
 
 std::unique_ptr<mlir::Pass> createInferResetsPass();
 
 std::unique_ptr<mlir::Pass> createPrintInstanceGraphPass();
 
+std::unique_ptr<mlir::Pass> createPrintCombPathsPass();
+
 std::unique_ptr<mlir::Pass>
 createBlackBoxReaderPass(llvm::Optional<StringRef> inputPrefix = {},
                          llvm::Optional<StringRef> resourcePrefix = {});
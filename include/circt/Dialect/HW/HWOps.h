@@ -81,6 +81,8 @@ SmallVector<ModulePortInfo> getModulePortInfo(Operation *op);
 /// Return true if the specified operation is a combinatorial logic op.
 bool isCombinatorial(Operation *op);
 
+class HWSymbolCache;
+
 } // namespace hw
 } // namespace circt
 
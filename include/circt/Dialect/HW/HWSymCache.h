@@ -0,0 +1,78 @@
+//===- HWSymCache.h - Declare Symbol Cache ----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares a cache of the symbols of a symbol table operation, used
+// to resolve instances to the modules they reference without going through the
+// symbol table of the parent op each time.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_DIALECT_HW_SYMCACHE_H
+#define CIRCT_DIALECT_HW_SYMCACHE_H
+
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/SymbolTable.h"
+#include "llvm/ADT/DenseMap.h"
+
+namespace circt {
+namespace hw {
+
+/// This stores a lookup table from the symbol names of the top-level
+/// operations of a symbol table op (typically the mlir::ModuleOp holding the
+/// design) to the operations themselves. It is built once and can be preserved
+/// as an analysis by passes which don't add, remove or rename modules.
+///
+/// Once built, the cache is only read, so it can be shared by threads which
+/// process different modules in parallel.
+class HWSymbolCache {
+public:
+  HWSymbolCache() = default;
+
+  /// Build the cache of the symbols defined directly in `symbolTableOp`. This
+  /// constructor makes the cache usable with `getAnalysis`.
+  explicit HWSymbolCache(Operation *symbolTableOp) {
+    auto symNameAttr = SymbolTable::getSymbolAttrName();
+    for (auto &region : symbolTableOp->getRegions())
+      for (auto &block : region)
+        for (auto &op : block)
+          if (auto name = op.getAttrOfType<StringAttr>(symNameAttr))
+            addDefinition(name, &op);
+  }
+
+  /// Record the specified operation as the definition of `symbol`. The first
+  /// definition of a symbol wins, as with a symbol table.
+  void addDefinition(StringAttr symbol, Operation *op) {
+    assert(symbol && op && "definitions require a symbol and an operation");
+    symbolCache.try_emplace(symbol.getValue(), op);
+  }
+
+  /// Return the operation defining the specified symbol, or null if it is
+  /// unknown.
+  Operation *getDefinition(StringRef symbol) const {
+    auto it = symbolCache.find(symbol);
+    return it == symbolCache.end() ? nullptr : it->second;
+  }
+  Operation *getDefinition(FlatSymbolRefAttr symbol) const {
+    return getDefinition(symbol.getValue());
+  }
+
+  /// Forget all the definitions, e.g. when the symbols they were built from
+  /// have changed.
+  void clear() { symbolCache.clear(); }
+
+private:
+  /// The keys are backed by the uniqued storage of the symbol name attributes,
+  /// which lives as long as the context.
+  llvm::DenseMap<StringRef, Operation *> symbolCache;
+};
+
+} // namespace hw
+} // namespace circt
+
+#endif // CIRCT_DIALECT_HW_SYMCACHE_H
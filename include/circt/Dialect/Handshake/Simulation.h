@@ -18,8 +18,20 @@
 #include "mlir/IR/MLIRContext.h"
 #include <string>
 
+/// Execute the given function of the module on the given arguments, and print
+/// its results. If `reportFile` is not empty, the tokens that went through
+/// each channel of a handshake function are written to that file.
 bool simulate(llvm::StringRef toplevelFunction,
               llvm::ArrayRef<std::string> inputArgs,
-              mlir::OwningModuleRef &module, mlir::MLIRContext &context);
+              mlir::OwningModuleRef &module, mlir::MLIRContext &context,
+              llvm::StringRef reportFile = {});
+
+/// Execute the given function of the module once for each line of
+/// `batchFile`, which holds the arguments of a run in the same form as the
+/// command line.  The runs are spread over the threads of the context, and
+/// their results are printed once all of them are done, one line per run in
+/// the order of the batch file.
+bool simulateBatch(llvm::StringRef toplevelFunction, llvm::StringRef batchFile,
+                   mlir::OwningModuleRef &module, mlir::MLIRContext &context);
 
 #endif
@@ -15,12 +15,17 @@
 
 #include "circt/Dialect/LLHD/IR/LLHDOps.h"
 #include "mlir/IR/BuiltinOps.h"
+#include "llvm/Support/DynamicLibrary.h"
+
+#include <limits>
+#include <vector>
 
 namespace mlir {
 class ExecutionEngine;
 } // namespace mlir
 
 namespace llvm {
+class BitVector;
 class Error;
 class Module;
 } // namespace llvm
@@ -32,22 +37,74 @@ namespace sim {
 struct State;
 struct Instance;
 
+/// The restrictions on the signal changes written to the trace.
+struct TraceFilter {
+  /// Glob patterns of the hierarchical names of the traced signals, such as
+  /// `root/core0/*`. All the signals are traced if there are none.
+  std::vector<std::string> patterns;
+
+  /// The window of simulation time that is traced, in picoseconds. The values
+  /// of all the traced signals are written with the first change in the
+  /// window.
+  uint64_t startTime = 0;
+  uint64_t stopTime = std::numeric_limits<uint64_t>::max();
+
+  /// The hierarchical name of the signal whose first change triggers the
+  /// capture. If it is not empty, only the `captureSteps` trace steps before
+  /// the step the trigger changes in, that step and the `captureSteps` steps
+  /// after it are written.
+  std::string trigger;
+  unsigned captureSteps = 16;
+};
+
 class Engine {
 public:
   /// Initialize an LLHD simulation engine. This initializes the state, as well
-  /// as the mlir::ExecutionEngine with the given module.
+  /// as the mlir::ExecutionEngine with the given module. The event queue is a
+  /// hierarchical timing wheel if `useTimingWheel` is set. If `designLibPath`
+  /// is not empty, the units of the design are loaded from that shared library
+  /// instead of being compiled, and the module is only used for the layout.
+  /// If `levelize` is set, the combinational entities are evaluated in a
+  /// static schedule, see levelizeCombinational.
   Engine(
       llvm::raw_ostream &out, ModuleOp module,
       llvm::function_ref<mlir::LogicalResult(mlir::ModuleOp)> mlirTransformer,
       llvm::function_ref<llvm::Error(llvm::Module *)> llvmTransformer,
-      std::string root, int mode, ArrayRef<StringRef> sharedLibPaths);
+      std::string root, int mode, ArrayRef<StringRef> sharedLibPaths,
+      bool useTimingWheel = false, StringRef designLibPath = {},
+      bool levelize = false);
 
   /// Default destructor
   ~Engine();
 
+  /// Restrict the signal changes written to the trace of the following
+  /// simulations.
+  void setTraceFilter(TraceFilter filter) { traceFilter = std::move(filter); }
+
   /// Run simulation up to n steps or maxTime picoseconds of simulation time.
-  /// n=0 and T=0 make the simulation run indefinitely.
-  int simulate(int n, uint64_t maxTime);
+  /// n=0 and T=0 make the simulation run indefinitely. If `parallel` is set,
+  /// the instances woken up in the same cycle run in parallel, which produces
+  /// the same trace. The simulation starts from the checkpoint in
+  /// `restoreFile` if it is not empty, and the state it stops in is saved to
+  /// `checkpointFile` if it is not empty. Counters of the work done by the
+  /// simulation are written as JSON to `statsFile` if it is not empty.
+  int simulate(int n, uint64_t maxTime, bool parallel = false,
+               StringRef restoreFile = {}, StringRef checkpointFile = {},
+               StringRef statsFile = {});
+
+  /// Run `count` independent simulations of the design concurrently, each on
+  /// its own state, and write the trace of the i-th one to `getOutput(i)`. The
+  /// design is only compiled once for all of them. Return -1 if any of them
+  /// failed.
+  int simulateConcurrently(
+      unsigned count,
+      llvm::function_ref<llvm::raw_ostream &(unsigned)> getOutput, int n,
+      uint64_t maxTime, bool parallel = false, StringRef restoreFile = {});
+
+  /// Write the compiled design to an object file, which can be linked into a
+  /// shared library with the signals runtime and loaded by later runs. Return
+  /// false if the design could not be compiled.
+  bool dumpToObjectFile(StringRef filename);
 
   /// Build the instance layout of the design.
   void buildLayout(ModuleOp module);
@@ -58,6 +115,13 @@ public:
   /// Get the simulation state.
   const State *getState() const { return state.get(); }
 
+  /// Order the combinational entity instances of the design topologically.
+  /// Whenever they are woken up, they are evaluated in that order before the
+  /// other instances, and their drives take effect right away rather than
+  /// after their delta or epsilon delay. All the combinational logic settles
+  /// in a single cycle, but the cycles in between no longer show up.
+  void levelizeCombinational(ModuleOp module);
+
   /// Dump the instance layout stored in the State.
   void dumpStateLayout();
 
@@ -65,14 +129,48 @@ public:
   void dumpStateSignalTriggers();
 
 private:
-  void walkEntity(EntityOp entity, Instance &child);
+  /// The signals and instances each entity creates, shared by all the
+  /// instances of the entity.
+  struct LayoutCache;
+
+  /// Add the signals and instances created by `child`, an instance of
+  /// `entity`, to the state.
+  void walkEntity(EntityOp entity, Instance &child, LayoutCache &cache);
+
+  /// Create a new simulation state of the design, on which the design can be
+  /// simulated independently of the state of the engine.
+  std::unique_ptr<State> createState() const;
+
+  /// Run a simulation like `simulate`, on the given state created by
+  /// createState, writing the trace to `out`.
+  int simulate(std::unique_ptr<State> &state, llvm::raw_ostream &out, int n,
+               uint64_t maxTime, bool parallel, StringRef restoreFile,
+               StringRef checkpointFile, StringRef statsFile);
+
+  /// Run the unit of the instance of the state with the given index.
+  void runInstance(std::unique_ptr<State> &state, unsigned index);
+
+  /// Run the instances of the state in the wakeup queue in order. Consecutive
+  /// instances of the same unit are run in a single call to its batched
+  /// function.
+  void runInstances(std::unique_ptr<State> &state,
+                    const llvm::BitVector &wakeupQueue);
+
+  /// Look up the packed wrapper of the given function of the design, either in
+  /// the JIT or in the precompiled design library.
+  llvm::Expected<void (*)(void **)> lookup(StringRef name);
 
   llvm::raw_ostream &out;
   std::string root;
   std::unique_ptr<State> state;
   std::unique_ptr<mlir::ExecutionEngine> engine;
+  llvm::sys::DynamicLibrary designLib;
+  // The statically scheduled instances, in topological order.
+  std::vector<unsigned> staticSchedule;
   ModuleOp module;
   int traceMode;
+  TraceFilter traceFilter;
+  bool useTimingWheel;
 };
 
 } // namespace sim
@@ -21,7 +21,8 @@ namespace llhd {
 
 class ProcOp;
 
-std::unique_ptr<OperationPass<ModuleOp>> createProcessLoweringPass();
+std::unique_ptr<OperationPass<ModuleOp>>
+createProcessLoweringPass(bool skipUnsupported = false);
 
 std::unique_ptr<OperationPass<ModuleOp>> createFunctionEliminationPass();
 
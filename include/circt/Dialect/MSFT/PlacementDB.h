@@ -0,0 +1,107 @@
+//===- PlacementDB.h - Database of device placements ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// A data structure which records which entities are placed at which locations
+// of the device, indexed by location so that floorplanning tools can query it
+// quickly.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_DIALECT_MSFT_PLACEMENTDB_H
+#define CIRCT_DIALECT_MSFT_PLACEMENTDB_H
+
+#include "circt/Dialect/MSFT/MSFTAttributes.h"
+#include "circt/Support/LLVM.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <functional>
+#include <map>
+
+namespace circt {
+namespace msft {
+
+/// A database of the placements of the entities of a design on the device.
+/// Locations are indexed by column, then row, then number, so point lookups
+/// are hash lookups and the placements within a rectangle of the device can be
+/// walked without visiting the others. Two entities conflict when they are
+/// placed at the same (x, y, num) coordinates, regardless of the device type,
+/// since there are never two kinds of primitives at the same location.
+class PlacementDB {
+public:
+  /// An entity placed on the device.
+  struct PlacedInstance {
+    /// The instance path to the module containing the entity, relative to the
+    /// top module of the design. Null for the top module itself.
+    InstanceIDAttr path;
+    /// The name of the entity within `op`.
+    StringRef subpath;
+    /// The operation which contains the entity.
+    Operation *op;
+  };
+
+  /// A rectangle of columns and rows of the device, bounds included.
+  struct Region {
+    uint64_t xMin, xMax, yMin, yMax;
+  };
+
+  using PlacementCallback =
+      std::function<void(PhysLocationAttr, const PlacedInstance &)>;
+
+  /// Create an empty database for the design whose top module is `top`.
+  PlacementDB(Operation *top) : top(top) {}
+
+  /// Record the placement of an entity at the specified location. If there is
+  /// already an entity at that location, emit an error on `inst.op` and fail.
+  LogicalResult addPlacement(PhysLocationAttr loc, PlacedInstance inst);
+
+  /// Record the placements specified by the "loc:" attributes of the
+  /// operations of the design, following the instance hierarchy from the top
+  /// module. Instance-specific placements are resolved for each instance path.
+  /// Return the number of placements added, or failure if any of them
+  /// conflicted.
+  FailureOr<size_t> addDesignPlacements();
+
+  /// Return the entity placed at the specified location, if any.
+  Optional<PlacedInstance> getInstanceAt(PhysLocationAttr loc) const;
+
+  /// Return true if nothing is placed at the specified location.
+  bool isFree(PhysLocationAttr loc) const { return !getInstanceAt(loc); }
+
+  /// Call `callback` for each placement, optionally restricted to a region of
+  /// the device, in order of column, row and number.
+  void walkPlacements(PlacementCallback callback,
+                      Optional<Region> bounds = {}) const;
+
+  /// Return the number of placements recorded.
+  size_t size() const { return numPlacements; }
+
+private:
+  struct Placement {
+    PhysLocationAttr loc;
+    PlacedInstance inst;
+  };
+
+  /// The placements at each number of a location.
+  using NumMap = DenseMap<uint64_t, Placement>;
+  /// The placements of each row of a column.
+  using RowMap = std::map<uint64_t, NumMap>;
+
+  LogicalResult addModulePlacements(Operation *module, InstanceIDAttr path,
+                                    size_t &numAdded);
+
+  Operation *top;
+  /// The placements of each column of the device.
+  std::map<uint64_t, RowMap> columns;
+  size_t numPlacements = 0;
+};
+
+} // namespace msft
+} // namespace circt
+
+#endif // CIRCT_DIALECT_MSFT_PLACEMENTDB_H
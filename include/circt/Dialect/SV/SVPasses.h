@@ -13,6 +13,7 @@
 #ifndef CIRCT_DIALECT_SV_SVPASSES_H
 #define CIRCT_DIALECT_SV_SVPASSES_H
 
+#include "circt/Support/LLVM.h"
 #include "mlir/Pass/Pass.h"
 
 #include <memory>
@@ -28,10 +29,16 @@ namespace sv {
 
 std::unique_ptr<mlir::Pass> createPrettifyVerilogPass();
 std::unique_ptr<mlir::Pass> createHWCleanupPass();
+std::unique_ptr<mlir::Pass> createCombNarrowWidthsPass();
+std::unique_ptr<mlir::Pass> createCombSimplifyPass();
+std::unique_ptr<mlir::Pass> createCombStructuralHashPass();
+std::unique_ptr<mlir::Pass> createCombBalanceMuxPass();
 std::unique_ptr<mlir::Pass> createHWStubExternalModulesPass();
 std::unique_ptr<mlir::Pass> createHWLegalizeNamesPass();
 std::unique_ptr<mlir::Pass> createHWGeneratorCalloutPass();
-std::unique_ptr<mlir::Pass> createHWMemSimImplPass();
+std::unique_ptr<mlir::Pass>
+createHWMemSimImplPass(StringRef model = "behavioral",
+                       unsigned sparseDepth = 0);
 std::unique_ptr<mlir::Pass> createSVExtractTestCodePass();
 /// Generate the code for registering passes.
 #define GEN_PASS_REGISTRATION
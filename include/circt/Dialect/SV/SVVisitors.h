@@ -14,6 +14,7 @@
 #define CIRCT_DIALECT_SV_SVVISITORS_H
 
 #include "circt/Dialect/SV/SVOps.h"
+#include "circt/Support/OpDispatch.h"
 #include "llvm/ADT/TypeSwitch.h"
 
 namespace circt {
@@ -25,31 +26,32 @@ class Visitor {
 public:
   ResultType dispatchSVVisitor(Operation *op, ExtraArgs... args) {
     auto *thisCast = static_cast<ConcreteType *>(this);
-    return TypeSwitch<Operation *, ResultType>(op)
-        .template Case<
-            // Expressions
-            ReadInOutOp, ArrayIndexInOutOp, VerbatimExprOp, VerbatimExprSEOp,
-            ConstantXOp, ConstantZOp,
-            // Declarations.
-            RegOp, WireOp, LocalParamOp,
-            // Control flow.
-            IfDefOp, IfDefProceduralOp, IfOp, AlwaysOp, AlwaysCombOp,
-            AlwaysFFOp, InitialOp, CaseZOp,
-            // Other Statements.
-            AssignOp, BPAssignOp, PAssignOp, ForceOp, ReleaseOp, AliasOp,
-            FWriteOp, FatalOp, FinishOp, VerbatimOp,
-            // Type declarations.
-            InterfaceOp, InterfaceSignalOp, InterfaceModportOp,
-            InterfaceInstanceOp, GetModportOp, AssignInterfaceSignalOp,
-            ReadInterfaceSignalOp,
-            // Verification statements.
-            AssertOp, AssumeOp, CoverOp, AssertConcurrentOp, AssumeConcurrentOp,
-            CoverConcurrentOp,
-            // Bind Statements
-            BindOp>([&](auto expr) -> ResultType {
+    return dispatchOpClass<
+        ResultType,
+        // Expressions
+        ReadInOutOp, ArrayIndexInOutOp, VerbatimExprOp, VerbatimExprSEOp,
+        ConstantXOp, ConstantZOp,
+        // Declarations.
+        RegOp, WireOp, LocalParamOp,
+        // Control flow.
+        IfDefOp, IfDefProceduralOp, IfOp, AlwaysOp, AlwaysCombOp, AlwaysFFOp,
+        InitialOp, CaseZOp,
+        // Other Statements.
+        AssignOp, BPAssignOp, PAssignOp, ForceOp, ReleaseOp, AliasOp, FWriteOp,
+        FatalOp, FinishOp, VerbatimOp,
+        // Type declarations.
+        InterfaceOp, InterfaceSignalOp, InterfaceModportOp, InterfaceInstanceOp,
+        GetModportOp, AssignInterfaceSignalOp, ReadInterfaceSignalOp,
+        // Verification statements.
+        AssertOp, AssumeOp, CoverOp, AssertConcurrentOp, AssumeConcurrentOp,
+        CoverConcurrentOp,
+        // Bind Statements
+        BindOp>(
+        op,
+        [&](auto expr) -> ResultType {
           return thisCast->visitSV(expr, args...);
-        })
-        .Default([&](auto expr) -> ResultType {
+        },
+        [&](Operation *) -> ResultType {
           return thisCast->visitInvalidSV(op, args...);
         });
   }
@@ -16,11 +16,19 @@
 #include "circt/Support/LLVM.h"
 #include "mlir/IR/Dialect.h"
 
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
 namespace circt {
 namespace seq {
 
 void registerSeqPasses();
 
+std::unique_ptr<mlir::Pass> createSeqRetimingPass();
+
 } // namespace seq
 } // namespace circt
 
@@ -0,0 +1,132 @@
+//===- Firtool.h - The firtool lowering pipeline ----------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the pass pipeline firtool runs to lower FIRRTL to the HW
+// dialect, so that other tools and the C API can run the same pipeline.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_FIRTOOL_FIRTOOL_H
+#define CIRCT_FIRTOOL_FIRTOOL_H
+
+#include "circt/Support/LLVM.h"
+#include <string>
+
+namespace mlir {
+class ModuleOp;
+class PassManager;
+} // namespace mlir
+
+namespace circt {
+namespace firtool {
+
+/// The options of the firtool pipeline. The defaults are those of the firtool
+/// command line options of the same name.
+struct FirtoolOptions {
+  /// Disable the optimizations, only run the passes required to lower.
+  bool disableOptimization = false;
+
+  bool inferWidths = true;
+  bool parallelInferWidths = false;
+  /// Reuse the widths of the unchanged modules from this cache file, if set.
+  std::string inferWidthsCache;
+
+  bool inferResets = true;
+
+  /// Fold the FIRRTL expressions before the types are lowered.
+  bool earlyFold = true;
+
+  bool lowerTypes = true;
+  /// Only takes effect if the types are lowered.
+  bool expandWhens = true;
+
+  bool checkCombCycles = false;
+
+  bool inliner = true;
+  /// Also inline small modules which are not annotated for inlining.
+  bool autoInline = false;
+
+  /// Defaults to enabled unless the optimizations are disabled.
+  Optional<bool> imconstprop;
+  bool parallelIMConstProp = false;
+  /// Remove the unused and constant ports of internal modules after
+  /// IMConstProp.
+  bool removeUnusedPorts = true;
+
+  bool dedup = false;
+
+  /// Create a black box for all memories.
+  bool blackBoxMemory = false;
+
+  /// The roots of the paths of the black box annotations and of the black box
+  /// resource annotations. The resource root defaults to the other one.
+  std::string blackBoxRoot;
+  std::string blackBoxResourceRoot;
+
+  bool grandCentral = false;
+
+  /// Lower to the HW dialect. This implies the IR is lowered.
+  bool lowerToHW = false;
+  /// Prepare the IR for Verilog emission. This implies `lowerToHW`.
+  bool emitVerilog = false;
+
+  /// The simulation model of the memories and the depth from which they use
+  /// sparse storage, see the hw-memory-sim pass.
+  std::string memoryModel = "behavioral";
+  unsigned sparseMemoryDepth = 0;
+
+  bool extractTestCode = false;
+
+  /// Balance the priority chains of muxes left by the expansion of whens, see
+  /// the comb-balance-mux pass.
+  bool balanceMuxChains = false;
+
+  bool warnOnUnprocessedAnnotations = false;
+
+  /// Reduce the memory the pipeline uses by dropping the annotations which the
+  /// lowering to HW does not read, once the passes consuming them ran. This
+  /// has no effect if the unprocessed annotations are warned about.
+  bool reduceMemory = false;
+
+  /// Return true if the pipeline lowers the circuit to the HW dialect.
+  bool lowersToHW() const { return lowerToHW || emitVerilog; }
+};
+
+/// Add the passes which lower a FIRRTL circuit to the HW dialect to `pm`, up to
+/// but not including the cleanup of the HW modules. firtool runs the cleanup
+/// separately when it reuses the output of the unchanged modules, and only
+/// runs it on the others.
+void populateFIRRTLToHWPasses(mlir::PassManager &pm,
+                              const FirtoolOptions &options);
+
+/// Add the passes which clean up the HW modules, and prepare them for Verilog
+/// emission if it is enabled, to `pm`.
+void populateHWCleanupPasses(mlir::PassManager &pm,
+                             const FirtoolOptions &options);
+
+/// Run the passes of `populateHWCleanupPasses` on the HW modules of `module`,
+/// divided into `numShards` shards of about the same size. Each shard is
+/// printed, parsed into an MLIRContext of its own, cleaned up there and
+/// imported back, so that the threads do not contend on the uniquing of the
+/// attributes and types of a single context. This is experimental: the text
+/// round trips cost time of their own, which only pays off with many threads.
+LogicalResult runShardedHWCleanup(mlir::ModuleOp module,
+                                  const FirtoolOptions &options,
+                                  unsigned numShards);
+
+/// Add the full firtool pipeline to `pm`.
+inline void populateFirtoolPasses(mlir::PassManager &pm,
+                                  const FirtoolOptions &options) {
+  populateFIRRTLToHWPasses(pm, options);
+  populateHWCleanupPasses(pm, options);
+}
+
+} // namespace firtool
+} // namespace circt
+
+#endif // CIRCT_FIRTOOL_FIRTOOL_H
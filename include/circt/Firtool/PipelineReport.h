@@ -0,0 +1,101 @@
+//===- PipelineReport.h - Measure the passes of a pipeline ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the pass instrumentation behind firtool's
+// -pipeline-report, which is also available through the C API.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_FIRTOOL_PIPELINEREPORT_H
+#define CIRCT_FIRTOOL_PIPELINEREPORT_H
+
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/Pass/PassInstrumentation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace circt {
+namespace firtool {
+
+/// Measure the time, the memory and the number of operations of each pass of a
+/// pipeline. The passes on the whole design or circuit run one after the
+/// other, and are measured individually. The passes on the modules run in
+/// parallel inside a pipeline over all modules, which is measured as a whole,
+/// and are summed up by pass within it.
+class PipelineReportInstrumentation : public mlir::PassInstrumentation {
+public:
+  /// The measurements of several runs of a pass on modules.
+  struct NestedPassRecord {
+    size_t runs = 0;
+    int64_t timeUs = 0;
+    size_t opsBefore = 0, opsAfter = 0;
+  };
+
+  /// The measurements of a pass on the whole design or circuit.
+  struct PassRecord {
+    std::string pass, op;
+    unsigned depth = 0;
+    bool failed = false;
+    int64_t wallTimeUs = 0, cpuTimeUs = 0, peakRSSDelta = 0;
+    size_t opsBefore = 0, opsAfter = 0;
+    llvm::MapVector<std::pair<StringRef, mlir::OperationName>,
+                    NestedPassRecord>
+        nested;
+  };
+
+  void runBeforePass(Pass *pass, Operation *op) override;
+  void runAfterPass(Pass *pass, Operation *op) override {
+    finishPass(pass, op, /*failed=*/false);
+  }
+  void runAfterPassFailed(Pass *pass, Operation *op) override {
+    finishPass(pass, op, /*failed=*/true);
+  }
+
+  /// Return the measurements of the passes in the order they ran.
+  ArrayRef<PassRecord> getRecords() const { return records; }
+
+  /// Write the measurements as a JSON array of passes in the order they ran.
+  void writeJSON(raw_ostream &os);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Start {
+    Clock::time_point wallTime;
+    std::chrono::nanoseconds cpuTime;
+    int64_t peakRSS;
+  };
+
+  static bool isMeasuredIndividually(Operation *op);
+
+  /// Return the CPU time used by all threads of the process so far.
+  static std::chrono::nanoseconds getCPUTime();
+
+  static StringRef getPassName(Pass *pass);
+
+  void finishPass(Pass *pass, Operation *op, bool failed);
+
+  std::mutex mutex;
+  std::vector<PassRecord> records;
+  /// The record and the start of each individually measured pass in progress,
+  /// innermost last.
+  SmallVector<std::pair<size_t, Start>> running;
+  /// The start time of each pass in progress on a module.
+  DenseMap<std::pair<Pass *, Operation *>, Clock::time_point> nestedStarts;
+};
+
+} // namespace firtool
+} // namespace circt
+
+#endif // CIRCT_FIRTOOL_PIPELINEREPORT_H
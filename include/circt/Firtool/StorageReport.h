@@ -0,0 +1,92 @@
+//===- StorageReport.h - Measure the attributes and types -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the measurement of the attributes and types behind
+// firtool's -storage-report.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_FIRTOOL_STORAGEREPORT_H
+#define CIRCT_FIRTOOL_STORAGEREPORT_H
+
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Types.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+namespace json {
+class OStream;
+} // namespace json
+} // namespace llvm
+
+namespace circt {
+namespace firtool {
+
+/// Measure the attributes and types uniqued in the MLIRContext that an
+/// operation refers to, through its attributes, locations and the types of its
+/// values, and transitively through the attributes and types those contain.
+/// Each distinct attribute or type is counted once, by dialect and kind.
+///
+/// The MLIRContext doesn't expose the size of its storage allocators, so the
+/// bytes are an estimate of the storage of each attribute or type: a fixed
+/// overhead for the storage and its entry in the uniquer, plus the size of
+/// the elements, characters or words it holds.
+class StorageReport {
+public:
+  /// The attributes or types of one kind, e.g. "builtin.StringAttr" or
+  /// "firrtl.bundle".
+  struct KindRecord {
+    std::string dialect, kind;
+    bool isType = false;
+    size_t count = 0, bytes = 0;
+  };
+
+  /// Measure everything reachable from `op`, itself included, in addition to
+  /// what was measured so far.
+  void collect(Operation *op);
+
+  size_t getNumAttributes() const { return attributes.size(); }
+  size_t getNumTypes() const { return types.size(); }
+
+  /// Write the measurements as a JSON object, with the `numLargest` largest
+  /// attributes and types printed.
+  void writeJSON(llvm::json::OStream &json, unsigned numLargest) const;
+
+private:
+  void addAttribute(Attribute attr);
+  void addType(Type type);
+  void drain();
+
+  KindRecord &getKind(Attribute attr);
+  KindRecord &getKind(Type type);
+
+  static size_t estimateBytes(Attribute attr);
+  static size_t estimateBytes(Type type);
+
+  /// The estimated size of each attribute and type, in discovery order.
+  llvm::MapVector<Attribute, size_t> attributes;
+  llvm::MapVector<Type, size_t> types;
+  SmallVector<Attribute> attributeWorklist;
+  SmallVector<Type> typeWorklist;
+
+  /// The kinds by name, and the name of the kind of each class of attributes
+  /// and types, which is only printed once.
+  llvm::StringMap<KindRecord> kinds;
+  DenseMap<TypeID, std::string> kindNames;
+};
+
+} // namespace firtool
+} // namespace circt
+
+#endif // CIRCT_FIRTOOL_STORAGEREPORT_H
@@ -37,6 +37,62 @@ LogicalResult scheduleSimplex(Problem &prob, Operation *lastOp);
 /// cycles that do not include at least one edge with a non-zero distance.
 LogicalResult scheduleSimplex(CyclicProblem &prob, Operation *lastOp);
 
+/// Solve the basic problem as a system of difference constraints, with a
+/// longest path algorithm on a sparse constraint graph. Each operation is
+/// assigned its earliest possible start time, which also minimizes the start
+/// time of any last operation. Unlike the simplex scheduler, time and memory
+/// scale with the number of dependences rather than the size of a dense
+/// tableau. Fails if the dependence graph contains cycles.
+LogicalResult scheduleDifferenceConstraints(Problem &prob);
+
+/// Solve the resource-free cyclic problem as a system of difference
+/// constraints. The smallest feasible initiation interval is found with a
+/// binary search, and each operation is assigned its earliest possible start
+/// time for it. Fails if the dependence graph contains cycles that do not
+/// include at least one edge with a non-zero distance.
+LogicalResult scheduleDifferenceConstraints(CyclicProblem &prob);
+
+/// Re-solve the basic problem after incremental changes, such as inserted or
+/// removed dependences and modified operator latencies, warm-started from the
+/// start times currently stored in \p prob. \p changedOps must contain the
+/// destinations of the changed dependences and the operations linked to the
+/// operator types whose latency changed. Operations without a start time are
+/// considered changed as well. Only the changed operations and their
+/// transitive successors are rescheduled, and the result is the same as the
+/// one of `scheduleDifferenceConstraints`.
+LogicalResult rescheduleDifferenceConstraints(Problem &prob,
+                                              ArrayRef<Operation *> changedOps);
+
+/// Re-solve the resource-free cyclic problem after incremental changes, see
+/// above. The start times are reused if the previous initiation interval is
+/// still the smallest feasible one, which is determined by checking the next
+/// smaller one. Otherwise the search for the II starts at the previous one.
+LogicalResult rescheduleDifferenceConstraints(CyclicProblem &prob,
+                                              ArrayRef<Operation *> changedOps);
+
+/// Solve the shared, pipelined operators problem with a list scheduler. Ready
+/// operations are scheduled in order of their critical-path priority, i.e. the
+/// longest latency path to any sink, and each is placed in the earliest time
+/// step in which an instance of its operator type is available. Fails if the
+/// dependence graph contains cycles.
+LogicalResult scheduleList(SharedPipelinedOperatorsProblem &prob);
+
+/// Solve the chaining problem with an as-soon-as-possible list scheduler that
+/// accumulates the operators' physical delays. Each operation starts in the
+/// earliest time step in which its predecessors' results are available, and is
+/// chained after the ones that become valid in that time step, unless its
+/// incoming delay would then exceed the cycle time, in which case it starts at
+/// the beginning of the next time step. Fails if the dependence graph contains
+/// cycles.
+LogicalResult scheduleChaining(ChainingProblem &prob);
+
+/// Solve the modulo scheduling problem with iterative modulo scheduling. The
+/// initiation interval is increased, starting at the larger of the recurrence-
+/// and resource-constrained lower bounds, until a schedule is found within the
+/// scheduling budget. Fails if the dependence graph contains cycles that do not
+/// include at least one edge with a non-zero distance.
+LogicalResult scheduleModulo(ModuloProblem &prob);
+
 } // namespace scheduling
 } // namespace circt
 
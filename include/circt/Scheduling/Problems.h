@@ -144,6 +144,11 @@ public:
   /// The endpoints become registered operations w.r.t. the problem.
   LogicalResult insertDependence(Dependence dep);
 
+  /// Remove \p dep from the scheduling problem. Return failure if \p dep is
+  /// not an auxiliary dependence of the problem; def-use dependences follow the
+  /// IR and cannot be removed. The endpoints remain registered operations.
+  LogicalResult removeDependence(Dependence dep);
+
   /// Include \p opr in this scheduling problem.
   void insertOperatorType(OperatorType opr) { operatorTypes.insert(opr); }
 
@@ -287,6 +292,97 @@ protected:
   virtual LogicalResult verifyOperatorType(OperatorType opr) override;
 };
 
+/// This class models the modulo scheduling problem, which is the composition of
+/// the cyclic problem and the shared, pipelined operators problem. As the
+/// executions of subsequent iterations overlap, an operator instance is used by
+/// all operations that start in the same *congruence class*, i.e. the same time
+/// step modulo the initiation interval.
+///
+/// A solution to this problem is feasible iff it is feasible for the cyclic
+/// problem, and the number of operations that use a certain limited operator
+/// type, and start in the same congruence class, does not exceed the operator
+/// type's limit.
+class ModuloProblem : public virtual CyclicProblem,
+                      public virtual SharedPipelinedOperatorsProblem {
+public:
+  ModuloProblem(Operation *containingOp)
+      : Problem(containingOp), CyclicProblem(containingOp),
+        SharedPipelinedOperatorsProblem(containingOp) {}
+
+protected:
+  virtual LogicalResult verifyOperatorType(OperatorType opr) override;
+};
+
+/// This class models the accumulation of physical propagation delays on
+/// combinational paths along SSA dependences, i.e. operator chaining.
+///
+/// Each operator type is annotated with an *incoming delay* and an *outgoing
+/// delay*. The incoming delay is the time from the arrival of the operands to
+/// the point at which the operator registers them, or produces its result if it
+/// is combinational, i.e. has a latency of 0. The outgoing delay is the time
+/// from the beginning of the time step in which a multi-cycle operator's result
+/// becomes available to the point at which it is valid. For combinational
+/// operators, both delays are the same.
+///
+/// The solution is extended by a *start time in cycle* per operation, i.e. the
+/// point in its start time step at which its operands are valid. A value flows
+/// combinationally to the operations starting in the time step in which it
+/// becomes available, so these must not start before it is valid. An optional
+/// *cycle time* bounds the length of the combinational paths in a time step.
+///
+/// A solution to this problem is feasible iff it is feasible for the basic
+/// problem, every operation starts in its time step after its combinational
+/// predecessors in the same time step are done, and, if a cycle time is set,
+/// every operation's incoming delay ends within its start time step.
+class ChainingProblem : public virtual Problem {
+private:
+  OperatorTypeProperty<float> incomingDelay;
+  OperatorTypeProperty<float> outgoingDelay;
+  OperationProperty<float> startTimeInCycle;
+  ProblemProperty<float> cycleTime;
+
+public:
+  using Problem::Problem;
+
+  /// The incoming delay denotes the propagation time from the operand inputs
+  /// of \p opr to its registers, or to its result for combinational operators.
+  Optional<float> getIncomingDelay(OperatorType opr) {
+    return incomingDelay.lookup(opr);
+  }
+  void setIncomingDelay(OperatorType opr, float delay) {
+    incomingDelay[opr] = delay;
+  }
+
+  /// The outgoing delay denotes the propagation time from the beginning of the
+  /// time step in which \p opr's result is available to its result output.
+  Optional<float> getOutgoingDelay(OperatorType opr) {
+    return outgoingDelay.lookup(opr);
+  }
+  void setOutgoingDelay(OperatorType opr, float delay) {
+    outgoingDelay[opr] = delay;
+  }
+
+  /// Return the point in \p op's start time step at which its operands are
+  /// valid, as computed by the scheduler.
+  Optional<float> getStartTimeInCycle(Operation *op) {
+    return startTimeInCycle.lookup(op);
+  }
+  void setStartTimeInCycle(Operation *op, float time) {
+    startTimeInCycle[op] = time;
+  }
+
+  /// The cycle time is the length of a time step, i.e. the target clock period
+  /// of the datapath. Combinational paths are not bounded if it is not set.
+  Optional<float> getCycleTime() { return cycleTime; }
+  void setCycleTime(float time) { cycleTime = time; }
+
+protected:
+  virtual LogicalResult checkOperatorType(OperatorType opr) override;
+  virtual LogicalResult checkProblem() override;
+  virtual LogicalResult verifyOperation(Operation *op) override;
+  virtual LogicalResult verifyDependence(Dependence dep) override;
+};
+
 } // namespace scheduling
 } // namespace circt
 
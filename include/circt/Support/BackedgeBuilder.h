@@ -16,10 +16,15 @@
 #define CIRCT_SUPPORT_BACKEDGEBUILDER_H
 
 #include "mlir/IR/Location.h"
+#include "mlir/IR/OperationSupport.h"
 #include "mlir/IR/Value.h"
+#include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
 
+#include <memory>
+
 namespace mlir {
+class Block;
 class OpBuilder;
 class PatternRewriter;
 class Operation;
@@ -43,6 +48,13 @@ class Backedge;
 ///   // When the actual value is available,
 ///   ready.set(anotherOp.getResult(0));
 /// ```
+///
+/// In bulk mode, the backedge ops are not inserted into the IR but kept in a
+/// block owned by the builder, and assigning a backedge only records its value.
+/// The uses of all the backedges are replaced in one pass by `resolve()` or
+/// during destruction, which then frees all the backedge ops at once. Until
+/// then, the operations using backedges have operands defined outside of
+/// their region, so the IR must not be verified or rewritten by patterns.
 class BackedgeBuilder {
   friend class Backedge;
 
@@ -50,17 +62,29 @@ public:
   /// To build a backedge op and manipulate it, we need a `PatternRewriter` and
   /// a `Location`. Store them during construct of this instance and use them
   /// when building.
-  BackedgeBuilder(mlir::OpBuilder &builder, mlir::Location loc);
-  BackedgeBuilder(mlir::PatternRewriter &rewriter, mlir::Location loc);
+  BackedgeBuilder(mlir::OpBuilder &builder, mlir::Location loc,
+                  bool bulk = false);
+  BackedgeBuilder(mlir::PatternRewriter &rewriter, mlir::Location loc,
+                  bool bulk = false);
   ~BackedgeBuilder();
   /// Create a typed backedge.
   Backedge get(mlir::Type resultType);
+  /// Replace the uses of the backedges assigned so far in bulk mode. This does
+  /// nothing otherwise. Backedges must not be assigned each other in a cycle.
+  void resolve();
 
 private:
   mlir::OpBuilder &builder;
   mlir::PatternRewriter *rewriter;
   mlir::Location loc;
+  mlir::OperationName opName;
   llvm::SmallVector<mlir::Operation *, 16> edges;
+  /// The backedge ops in bulk mode, null otherwise.
+  std::unique_ptr<mlir::Block> arena;
+  /// The values assigned to the backedges in bulk mode, by backedge value.
+  llvm::MapVector<mlir::Value, mlir::Value> replacements;
+  /// The number of replacements whose uses were replaced by `resolve()`.
+  unsigned numResolved = 0;
 };
 
 /// `Backedge` is a wrapper class around a `Value`. When assigned another
@@ -69,15 +93,19 @@ private:
 class Backedge {
   friend class BackedgeBuilder;
 
-  /// `Backedge` is constructed exclusively by `BackedgeBuilder`.
-  Backedge(mlir::Operation *op);
+  /// `Backedge` is constructed exclusively by `BackedgeBuilder`. `bulk` is the
+  /// builder to record the assignment with in bulk mode.
+  Backedge(mlir::Operation *op, BackedgeBuilder *bulk = nullptr);
 
 public:
   operator mlir::Value();
   void setValue(mlir::Value);
 
 private:
+  /// The value of the backedge op itself.
+  mlir::Value edge;
   mlir::Value value;
+  BackedgeBuilder *bulk;
 };
 
 } // namespace circt
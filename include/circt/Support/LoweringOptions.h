@@ -66,6 +66,21 @@ struct LoweringOptions {
   /// This is the target width of lines in an emitted verilog source file in
   /// columns.
   unsigned emittedLineLength = 90;
+
+  /// If true, ExportVerilog measures the output size and emission time of each
+  /// module, and split Verilog emission writes them to a JSON report next to
+  /// the file list.
+  bool emitEmissionReport = false;
+
+  /// If true, ExportVerilog merges the always_ff blocks of a module which are
+  /// sensitive to the same clock and reset into a single block.
+  bool mergeAlwaysBlocks = false;
+
+  /// Enable the options of the simulation performance profile, which shapes
+  /// the emitted code for the throughput of simulators such as Verilator and
+  /// VCS. This is set with the `profile=simulation` option, and is printed as
+  /// the individual options it implies.
+  void applySimulationProfile();
 };
 
 /// Register commandline options for the verilog emitter.
@@ -0,0 +1,72 @@
+//===- OpDispatch.h - Table-driven op class dispatch ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides a replacement for a TypeSwitch over many op classes, which
+// finds the op class of an operation with a single table lookup. It is used by
+// the dialect visitors.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_SUPPORT_OPDISPATCH_H
+#define CIRCT_SUPPORT_OPDISPATCH_H
+
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/Operation.h"
+#include "llvm/ADT/DenseMap.h"
+
+namespace circt {
+namespace detail {
+
+/// Return the position of the op class of `op` in `OpTys`, or -1 if it is none
+/// of them.
+template <typename... OpTys>
+int getOpClassIndex(Operation *op) {
+  // Built on first use, since TypeIDs are only known at runtime.
+  static const DenseMap<TypeID, int> indices = [] {
+    DenseMap<TypeID, int> indices;
+    TypeID typeIDs[] = {TypeID::get<OpTys>()...};
+    for (int i = 0, e = sizeof...(OpTys); i != e; ++i)
+      indices.insert({typeIDs[i], i});
+    return indices;
+  }();
+
+  auto *abstractOp = op->getAbstractOperation();
+  if (!abstractOp)
+    return -1;
+  auto it = indices.find(abstractOp->typeID);
+  return it == indices.end() ? -1 : it->second;
+}
+
+template <typename OpTy, typename ResultType, typename CallbackT>
+ResultType invokeOpCallback(Operation *op, CallbackT &callback) {
+  return callback(cast<OpTy>(op));
+}
+
+} // namespace detail
+
+/// Call `callback` with `op` cast to its op class if it is one of `OpTys`, or
+/// `defaultCallback` with `op` otherwise. This behaves like a TypeSwitch with a
+/// single case for all of `OpTys`, but looks up the op class of the operation
+/// in a table instead of testing each class in turn.
+template <typename ResultType, typename... OpTys, typename CallbackT,
+          typename DefaultT>
+ResultType dispatchOpClass(Operation *op, CallbackT &&callback,
+                           DefaultT &&defaultCallback) {
+  using Trampoline = ResultType (*)(Operation *, CallbackT &);
+  static constexpr Trampoline trampolines[] = {
+      &detail::invokeOpCallback<OpTys, ResultType, CallbackT>...};
+
+  auto index = detail::getOpClassIndex<OpTys...>(op);
+  if (index < 0)
+    return defaultCallback(op);
+  return trampolines[index](op, callback);
+}
+
+} // namespace circt
+
+#endif // CIRCT_SUPPORT_OPDISPATCH_H
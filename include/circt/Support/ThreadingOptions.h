@@ -0,0 +1,41 @@
+//===- ThreadingOptions.h - CIRCT Threading Options -------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Command line options which control the threads running the parallel parts of
+// the tools: the parsers, the pass manager and the passes and emitters which
+// use `mlir::parallelForEach`.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_SUPPORT_THREADINGOPTIONS_H
+#define CIRCT_SUPPORT_THREADINGOPTIONS_H
+
+namespace circt {
+
+/// Register the command line options for the threads of the tool:
+///
+///   -threads=<n>              Run parallel loops on at most n threads, 0 for
+///                             one per core available to the process.
+///   -thread-affinity=<cpus>   Run the process on the listed CPUs only, e.g.
+///                             "0-7,16-23". Linux only.
+///
+/// The options take effect as they are parsed, so they must be registered
+/// before the command line is parsed, and before anything runs in parallel:
+/// the threads are created by the first parallel loop and live as long as the
+/// process.
+void registerThreadingCLOptions();
+
+/// Run parallel loops on at most `numThreads` threads, or one per core
+/// available to the process if it is 0. This is what the -threads option does,
+/// for the tools and libraries which don't parse a command line. Like the
+/// option, it must be called before anything runs in parallel.
+void setNumThreads(unsigned numThreads);
+
+} // namespace circt
+
+#endif // CIRCT_SUPPORT_THREADINGOPTIONS_H
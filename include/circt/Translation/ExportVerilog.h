@@ -26,6 +26,9 @@ class ModuleOp;
 } // namespace mlir
 
 namespace circt {
+namespace hw {
+class HWModuleOp;
+} // namespace hw
 
 /// Export a module containing HW, and SV dialect code. Requires that the SV
 /// dialect is loaded in to the context.
@@ -38,6 +41,17 @@ mlir::LogicalResult exportVerilog(mlir::ModuleOp module, llvm::raw_ostream &os);
 mlir::LogicalResult exportSplitVerilog(mlir::ModuleOp module,
                                        llvm::StringRef dirname);
 
+/// Export a single HW module, such that a client can emit modules one at a
+/// time as soon as they are ready.  The module must be nested in a ModuleOp,
+/// whose lowering options are used, and module and port names must already
+/// have been legalized, e.g. by the HWLegalizeNames pass.  Only the signatures
+/// of the modules instantiated by \p module are needed, so clients may drop the
+/// bodies of modules once they have been emitted.
+///
+/// This prepares the body of the module for emission, which modifies it.
+mlir::LogicalResult exportVerilogModule(hw::HWModuleOp module,
+                                        llvm::raw_ostream &os);
+
 /// Register a translation for exporting HW, Comb and SV to SystemVerilog.
 void registerToVerilogTranslation();
 
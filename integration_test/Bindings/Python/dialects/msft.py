@@ -56,3 +56,26 @@ with ir.Context() as ctx, ir.Location.unknown():
   # CHECK:   set_location_assignment M20K_X50_Y100_N1 -to $parent|inst1|mem
   # CHECK:   set_location_assignment M20K_X25_Y25_N1 -to $parent|MyLocatableRegister|mem
   msft.export_tcl(m, sys.stdout)
+
+  # CHECK-LABEL: === placements ===
+  print("=== placements ===")
+  db = msft.PlacementDB(top.operation)
+  # CHECK: 2
+  print(db.add_design_placements())
+
+  # CHECK: None 'mem' hw.instance "inst1"
+  path, subpath, placed = db.get_instance_at(
+      msft.PhysLocationAttr.get(msft.M20K, x=50, y=100, num=1))
+  print(path, repr(subpath), placed)
+
+  # CHECK: False True
+  print(db.is_free(msft.PhysLocationAttr.get(msft.M20K, x=25, y=25, num=1)),
+        db.is_free(msft.PhysLocationAttr.get(msft.M20K, x=25, y=25, num=2)))
+
+  # CHECK: False
+  print(
+      db.add_placement(msft.PhysLocationAttr.get(msft.M20K, x=25, y=25, num=1),
+                       None, "other", placed))
+
+  # CHECK: ['#msft.physloc<M20K, 25, 25, 1>']
+  print([str(loc) for loc, _ in db.get_placements((0, 30, 0, 30))])
@@ -109,6 +109,18 @@ with Context() as ctx, Location.unknown():
       # CHECK: hw.instance "inst6" {{.*}} {BANKS = 2 : i64}
       one_input.create("inst6", a=inst1.a, parameters={"BANKS": 2})
 
+      # CHECK: %[[MANY0:.+]] = hw.instance "many0" @one_output()
+      # CHECK: %[[MANY1:.+]] = hw.instance "many1" @one_output()
+      many = one_output.create_many(["many0", "many1"])
+
+      # CHECK: hw.instance "many2" @two_inputs(%[[MANY0]], %[[MANY1]])
+      # CHECK: hw.instance "many3" @two_inputs(%[[MANY1]], %[[MANY0]])
+      many_inputs = two_inputs.create_many(["many2", "many3"], [
+          dict(a=many[0].a, b=many[1].a),
+          dict(a=many[1].a),
+      ])
+      connect(many_inputs[1].b, many[0].a)
+
     instance_builder_tests = hw.HWModuleOp(name="instance_builder_tests",
                                            body_builder=instance_builder_body)
 
@@ -131,3 +143,19 @@ with Context() as ctx, Location.unknown():
   # CHECK: module swap
   # CHECK: module top
   circt.export_verilog(m, sys.stdout)
+
+  # CHECK-LABEL: === Verilog files ===
+  print("=== Verilog files ===")
+
+  import os
+  import tempfile
+  with tempfile.TemporaryDirectory() as tmpdir:
+    # CHECK: module MyWidget
+    path = os.path.join(tmpdir, "design.sv")
+    circt.export_verilog_file(m, path)
+    print(open(path).read())
+
+    # CHECK: 'MyWidget.sv'
+    split_dir = os.path.join(tmpdir, "split")
+    circt.export_split_verilog(m, split_dir)
+    print(sorted(os.listdir(split_dir)))
@@ -0,0 +1,56 @@
+// REQUIRES: esi-cosim
+// RUN: circt-opt %s --lower-esi-to-physical --lower-esi-ports --lower-esi-to-hw --hw-legalize-names | circt-translate --export-verilog > %t1.sv
+// RUN: circt-translate %s -export-esi-capnp -verify-diagnostics > %t2.capnp
+// RUN: esi-cosim-runner.py --schema %t2.capnp %s %t1.sv
+// PY: import benchmark
+// PY: b = benchmark.CosimBenchmark(rpcschemapath, simhostport)
+// PY: b.run_latency(size=8, num_msgs=200)
+// PY: b.run_latency(size=128, num_msgs=200)
+// PY: b.run_latency(size=1024, num_msgs=100)
+// PY: b.run_throughput(size=8, num_eps=1, num_msgs=1000)
+// PY: b.run_throughput(size=8, num_eps=4, num_msgs=1000)
+// PY: b.run_throughput(size=1024, num_eps=1, num_msgs=500)
+
+// Loopbacks for the message sizes the benchmark measures. Each one echoes the
+// messages back to the client through a single-stage buffer. There are four
+// endpoints of the smallest size, to measure the scaling with the number of
+// endpoints. The endpoint IDs are the ones the benchmark client expects.
+
+hw.module @loopback8(%clk:i1, %rstn:i1) -> () {
+  %recv = esi.cosim %clk, %rstn, %resp, 1 {name="Loopback8"} : !esi.channel<i64> -> !esi.channel<i64>
+  %resp = esi.buffer %clk, %rstn, %recv {stages=1} : i64
+}
+
+hw.module @loopback8b(%clk:i1, %rstn:i1) -> () {
+  %recv = esi.cosim %clk, %rstn, %resp, 2 {name="Loopback8b"} : !esi.channel<i64> -> !esi.channel<i64>
+  %resp = esi.buffer %clk, %rstn, %recv {stages=1} : i64
+}
+
+hw.module @loopback8c(%clk:i1, %rstn:i1) -> () {
+  %recv = esi.cosim %clk, %rstn, %resp, 3 {name="Loopback8c"} : !esi.channel<i64> -> !esi.channel<i64>
+  %resp = esi.buffer %clk, %rstn, %recv {stages=1} : i64
+}
+
+hw.module @loopback8d(%clk:i1, %rstn:i1) -> () {
+  %recv = esi.cosim %clk, %rstn, %resp, 4 {name="Loopback8d"} : !esi.channel<i64> -> !esi.channel<i64>
+  %resp = esi.buffer %clk, %rstn, %recv {stages=1} : i64
+}
+
+hw.module @loopback128(%clk:i1, %rstn:i1) -> () {
+  %recv = esi.cosim %clk, %rstn, %resp, 16 {name="Loopback128"} : !esi.channel<!hw.array<16xi64>> -> !esi.channel<!hw.array<16xi64>>
+  %resp = esi.buffer %clk, %rstn, %recv {stages=1} : !hw.array<16xi64>
+}
+
+hw.module @loopback1024(%clk:i1, %rstn:i1) -> () {
+  %recv = esi.cosim %clk, %rstn, %resp, 128 {name="Loopback1024"} : !esi.channel<!hw.array<128xi64>> -> !esi.channel<!hw.array<128xi64>>
+  %resp = esi.buffer %clk, %rstn, %recv {stages=1} : !hw.array<128xi64>
+}
+
+hw.module @top(%clk:i1, %rstn:i1) -> () {
+  hw.instance "loopback8" @loopback8(%clk, %rstn) : (i1, i1) -> ()
+  hw.instance "loopback8b" @loopback8b(%clk, %rstn) : (i1, i1) -> ()
+  hw.instance "loopback8c" @loopback8c(%clk, %rstn) : (i1, i1) -> ()
+  hw.instance "loopback8d" @loopback8d(%clk, %rstn) : (i1, i1) -> ()
+  hw.instance "loopback128" @loopback128(%clk, %rstn) : (i1, i1) -> ()
+  hw.instance "loopback1024" @loopback1024(%clk, %rstn) : (i1, i1) -> ()
+}
@@ -0,0 +1,91 @@
+#!/usr/bin/python3
+
+import random
+import time
+import cosim
+
+
+class CosimBenchmark(cosim.CosimBase):
+  """Measures the message rate and round-trip latency of the loopback
+    endpoints in benchmark.mlir. The results are printed one per line, prefixed
+    with 'BENCH', so they can be collected from the test logs."""
+
+  # The endpoint IDs of the loopbacks, by message size in bytes.
+  endpoints = {8: [1, 2, 3, 4], 128: [16], 1024: [128]}
+
+  def msgType(self, size):
+    if size == 8:
+      return self.schema.I64
+    return getattr(self.schema, f"ArrayOf{size // 8}xI64")
+
+  def newMsg(self, size):
+    if size == 8:
+      return self.schema.I64.new_message(i=random.randrange(0, 2**63))
+    return self.msgType(size).new_message(
+        l=[random.randrange(0, 2**63) for _ in range(size // 8)])
+
+  def openEPs(self, size, num_eps):
+    epNums = self.endpoints[size]
+    assert num_eps <= len(epNums), f"Only {len(epNums)} endpoints of {size}B"
+    msgType = self.msgType(size)
+    return [
+        self.openEP(epNum=epNum, sendType=msgType, recvType=msgType)
+        for epNum in epNums[:num_eps]
+    ]
+
+  def tryRecv(self, ep):
+    """Poll for a message without sleeping, so that the latency measurement is
+      not dominated by the poll period."""
+    recvResp = ep.recv(False).wait()
+    return recvResp.hasData
+
+  def run_latency(self, size=8, num_msgs=100):
+    """Send one message at a time and wait for it to come back."""
+    ep = self.openEPs(size, 1)[0]
+    latencies = []
+    for _ in range(num_msgs):
+      msg = self.newMsg(size)
+      start = time.perf_counter()
+      ep.send(msg).wait()
+      while not self.tryRecv(ep):
+        pass
+      latencies.append(time.perf_counter() - start)
+    ep.close().wait()
+
+    latencies.sort()
+
+    def percentile(p):
+      return latencies[min(len(latencies) - 1, int(len(latencies) * p))] * 1e6
+
+    print(f"BENCH latency size={size} msgs={num_msgs} "
+          f"p50={percentile(0.5):.1f}us p90={percentile(0.9):.1f}us "
+          f"p99={percentile(0.99):.1f}us max={latencies[-1] * 1e6:.1f}us")
+    return latencies
+
+  def run_throughput(self, size=8, num_eps=1, num_msgs=1000, window=64):
+    """Stream messages through `num_eps` endpoints, keeping up to `window`
+      messages in flight on each, and measure the total message rate."""
+    eps = self.openEPs(size, num_eps)
+    sent = [0] * num_eps
+    recvd = [0] * num_eps
+    start = time.perf_counter()
+    while min(recvd) < num_msgs:
+      for i, ep in enumerate(eps):
+        # Issue the sends of the window together, so they are pipelined.
+        sends = []
+        while sent[i] < num_msgs and sent[i] - recvd[i] < window:
+          sends.append(ep.send(self.newMsg(size)))
+          sent[i] += 1
+        for s in sends:
+          s.wait()
+        while recvd[i] < sent[i] and self.tryRecv(ep):
+          recvd[i] += 1
+    elapsed = time.perf_counter() - start
+    for ep in eps:
+      ep.close().wait()
+
+    total = num_msgs * num_eps
+    print(f"BENCH throughput size={size} eps={num_eps} msgs={total} "
+          f"rate={total / elapsed:.0f}msgs/s "
+          f"bandwidth={total * size / elapsed / 1e6:.2f}MB/s")
+    return total / elapsed
@@ -0,0 +1,20 @@
+// REQUIRES: esi-cosim
+// RUN: circt-opt %s --lower-esi-to-physical --lower-esi-ports --lower-esi-to-hw --hw-legalize-names | circt-translate --export-verilog > %t1.sv
+// RUN: circt-translate %s -export-esi-capnp -verify-diagnostics > %t2.capnp
+// RUN: rm -f %t.trace
+// RUN: env COSIM_TRACE_FILE=%t.trace esi-cosim-runner.py --schema %t2.capnp %s %t1.sv
+// RUN: esi-cosim-runner.py --schema %t2.capnp --replay %t.trace %s
+
+// The client runs once against the simulation, which records its messages, and
+// once against esi-cosim-replay playing the recording. The seed makes the
+// client send the same messages both times.
+// PY: import random
+// PY: random.seed(0)
+// PY: import loopback as test
+// PY: rpc = test.LoopbackTester(rpcschemapath, simhostport)
+// PY: rpc.test_i32(25)
+
+hw.module @top(%clk:i1, %rstn:i1) -> () {
+  %cosimRecv = esi.cosim %clk, %rstn, %bufferedResp, 1 {name="IntTestEP"} : !esi.channel<i32> -> !esi.channel<i32>
+  %bufferedResp = esi.buffer %clk, %rstn, %cosimRecv {stages=1} : i32
+}
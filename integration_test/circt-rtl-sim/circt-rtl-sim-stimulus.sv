@@ -0,0 +1,29 @@
+// REQUIRES: verilator
+// RUN: printf '\001\002\003\004\005\006' > %t.stimulus
+// RUN: printf '\003\007\013' > %t.expected
+// RUN: printf '\003\010\013' > %t.wrong
+// RUN: circt-rtl-sim.py %s --driver-inputs a:8,b:8 --driver-outputs sum:8 \
+// RUN:   --simargs "--stimulus %t.stimulus --expected %t.expected" \
+// RUN:   | FileCheck %s
+// RUN: not circt-rtl-sim.py %s --driver-inputs a:8,b:8 --driver-outputs sum:8 \
+// RUN:   --simargs "--stimulus %t.stimulus --expected %t.wrong" 2>&1 \
+// RUN:   | FileCheck %s --check-prefix=WRONG
+
+// CHECK: [driver] Ending simulation at tick #{{[0-9]+}} after 3 cycles
+// CHECK-NOT: mismatches
+
+// WRONG: [driver] Mismatch at cycle 1 on sum: expected 0x08, got 0x07
+// WRONG: [driver] 1 mismatches
+
+module top(
+  input clk,
+  input rstn,
+  input [7:0] a,
+  input [7:0] b,
+  output reg [7:0] sum
+);
+
+  always@(posedge clk)
+    sum <= a + b;
+
+endmodule
@@ -77,6 +77,7 @@ tool_dirs = [
 ]
 tools = [
     'circt-opt', 'circt-translate', 'firtool', 'circt-rtl-sim.py',
+    'circt-bench.py',
     'esi-cosim-runner.py'
 ]
 
@@ -140,6 +141,7 @@ if len(ieee_sims) > 1:
 # Enable ESI cosim tests if they have been built.
 if config.esi_cosim_path != "":
   config.available_features.add('esi-cosim')
+  tools.append('esi-cosim-replay')
   config.substitutions.append(
       ('%ESIINC%', f'{config.circt_include_dir}/circt/Dialect/ESI/'))
   config.substitutions.append(('%ESICOSIM%', f'{config.esi_cosim_path}'))
@@ -16,6 +16,7 @@
 #include "circt-c/Dialect/Seq.h"
 #include "circt-c/ExportVerilog.h"
 #include "mlir-c/Bindings/Python/Interop.h"
+#include "mlir-c/Pass.h"
 #include "mlir-c/Registration.h"
 #include "mlir/Bindings/Python/PybindAdaptors.h"
 
@@ -68,6 +69,10 @@ PYBIND11_MODULE(_circt, m) {
         MlirDialectHandle sv = mlirGetDialectHandle__sv__();
         mlirDialectHandleRegisterDialect(sv, context);
         mlirDialectHandleLoadDialect(sv, context);
+
+        // Passes run from Python release the GIL, let them use the threads
+        // they can.
+        mlirContextEnableMultithreading(context, true);
       },
       "Register CIRCT dialects on a PyMlirContext.");
 
@@ -77,6 +82,60 @@ PYBIND11_MODULE(_circt, m) {
     mlirExportVerilog(mod, accum.getCallback(), accum.getUserData());
   });
 
+  // These variants write the files from C++ rather than through Python file
+  // objects, so the GIL is released while emitting and the modules are
+  // emitted in parallel if the context enables multithreading.
+  m.def(
+      "export_verilog_file",
+      [](MlirModule mod, const std::string &path) {
+        MlirLogicalResult result;
+        {
+          py::gil_scoped_release release;
+          result = mlirExportVerilogToFile(
+              mod, mlirStringRefCreate(path.data(), path.size()));
+        }
+        if (mlirLogicalResultIsFailure(result))
+          throw std::runtime_error("failed to export verilog to " + path);
+      },
+      "Emit the verilog of a module into the file at the specified path.");
+  m.def(
+      "export_split_verilog",
+      [](MlirModule mod, const std::string &directory) {
+        MlirLogicalResult result;
+        {
+          py::gil_scoped_release release;
+          result = mlirExportSplitVerilog(
+              mod, mlirStringRefCreate(directory.data(), directory.size()));
+        }
+        if (mlirLogicalResultIsFailure(result))
+          throw std::runtime_error("failed to export verilog to " + directory);
+      },
+      "Emit the verilog of a module as one file per module in the specified "
+      "directory.");
+
+  m.def(
+      "run_passes",
+      [](MlirModule mod, const std::string &pipeline) {
+        MlirPassManager pm = mlirPassManagerCreate(mlirModuleGetContext(mod));
+        MlirLogicalResult result = mlirParsePassPipeline(
+            mlirPassManagerGetAsOpPassManager(pm),
+            mlirStringRefCreate(pipeline.data(), pipeline.size()));
+        if (mlirLogicalResultIsFailure(result)) {
+          mlirPassManagerDestroy(pm);
+          throw std::invalid_argument("invalid pass pipeline: " + pipeline);
+        }
+        // The passes don't touch any Python object, so other Python threads
+        // can run, e.g. to elaborate or lower other designs, in the meantime.
+        {
+          py::gil_scoped_release release;
+          result = mlirPassManagerRun(pm, mod);
+        }
+        mlirPassManagerDestroy(pm);
+        if (mlirLogicalResultIsFailure(result))
+          throw std::runtime_error("failed to run pass pipeline: " + pipeline);
+      },
+      "Run the specified pass pipeline on a module without holding the GIL.");
+
   py::module esi = m.def_submodule("_esi", "ESI API");
   circt::python::populateDialectESISubmodule(esi);
   py::module msft = m.def_submodule("msft", "MSFT API");
@@ -41,6 +41,72 @@ static void registerGenerator(MlirContext ctxt, std::string opName,
                             parameters);
 }
 
+/// Convert a placed instance to a (path, subpath, op) tuple. The path is None
+/// for entities of the top module.
+static py::tuple placedInstanceToTuple(CirctMSFTPlacedInstance inst) {
+  py::object path = py::none();
+  if (!mlirAttributeIsNull(inst.path))
+    path = py::cast(inst.path);
+  return py::make_tuple(
+      path, std::string(inst.subpath.data, inst.subpath.length), inst.op);
+}
+
+/// Owns a placement database for the Python bindings.
+class PlacementDB {
+public:
+  PlacementDB(MlirOperation top) : db(circtMSFTCreatePlacementDB(top)) {}
+  ~PlacementDB() { circtMSFTDeletePlacementDB(db); }
+  PlacementDB(const PlacementDB &) = delete;
+
+  int64_t addDesignPlacements() {
+    return circtMSFTPlacementDBAddDesignPlacements(db);
+  }
+
+  bool addPlacement(MlirAttribute loc, py::object path, std::string subpath,
+                    MlirOperation op) {
+    MlirAttribute pathAttr = {nullptr};
+    if (!path.is_none())
+      pathAttr = path.cast<MlirAttribute>();
+    CirctMSFTPlacedInstance inst = {
+        pathAttr, mlirStringRefCreate(subpath.data(), subpath.size()), op};
+    return mlirLogicalResultIsSuccess(
+        circtMSFTPlacementDBAddPlacement(db, loc, inst));
+  }
+
+  py::object getInstanceAt(MlirAttribute loc) {
+    CirctMSFTPlacedInstance inst;
+    if (!circtMSFTPlacementDBTryGetInstanceAt(db, loc, &inst))
+      return py::none();
+    return placedInstanceToTuple(inst);
+  }
+
+  bool isFree(MlirAttribute loc) {
+    return !circtMSFTPlacementDBTryGetInstanceAt(db, loc, nullptr);
+  }
+
+  size_t size() { return circtMSFTPlacementDBGetNumPlacements(db); }
+
+  py::list getPlacements(py::object bounds) {
+    std::vector<uint64_t> boundsVec;
+    if (!bounds.is_none())
+      boundsVec = bounds.cast<std::vector<uint64_t>>();
+    if (!boundsVec.empty() && boundsVec.size() != 4)
+      throw std::invalid_argument("bounds must be (xmin, xmax, ymin, ymax)");
+    py::list placements;
+    circtMSFTPlacementDBWalkPlacements(
+        db,
+        [](MlirAttribute loc, CirctMSFTPlacedInstance inst, void *userData) {
+          ((py::list *)userData)
+              ->append(py::make_tuple(loc, placedInstanceToTuple(inst)));
+        },
+        boundsVec.empty() ? nullptr : boundsVec.data(), &placements);
+    return placements;
+  }
+
+private:
+  CirctMSFTPlacementDB db;
+};
+
 using namespace mlir::python::adaptors;
 
 /// Populate the msft python module.
@@ -68,6 +134,25 @@ void circt::python::populateDialectMSFTSubmodule(py::module &m) {
   m.def("register_generator", &::registerGenerator,
         "Register a generator for a design module");
 
+  py::class_<PlacementDB>(m, "PlacementDB")
+      .def(py::init<MlirOperation>(), py::arg("top"))
+      .def("add_design_placements", &PlacementDB::addDesignPlacements,
+           "Add the placements specified by the design. Return the number "
+           "added, or -1 if any conflicted.")
+      .def("add_placement", &PlacementDB::addPlacement,
+           "Place an entity. Return False if the location is occupied.",
+           py::arg("loc"), py::arg("path"), py::arg("subpath"), py::arg("op"))
+      .def("get_instance_at", &PlacementDB::getInstanceAt,
+           "Return the (path, subpath, op) placed at a location, or None.",
+           py::arg("loc"))
+      .def("is_free", &PlacementDB::isFree,
+           "Return True if nothing is placed at a location.", py::arg("loc"))
+      .def("get_placements", &PlacementDB::getPlacements,
+           "Return the (loc, (path, subpath, op)) placements, optionally "
+           "within (xmin, xmax, ymin, ymax), bounds included.",
+           py::arg("bounds") = py::none())
+      .def("__len__", &PlacementDB::size);
+
   mlir_attribute_subclass(m, "PhysLocationAttr",
                           circtMSFTAttributeIsAPhysLocationAttribute)
       .def_classmethod(
@@ -10,6 +10,39 @@ import circt.support as support
 from mlir.ir import *
 
 
+class _ModulePortInfo:
+  """The names and types of the ports of a module. Reading them from the
+  attributes of the module is slow compared to building an instance, so they
+  are gathered once and shared by all the instances built together."""
+
+  def __init__(self, module):
+    self.module_name = FlatSymbolRefAttr.get(StringAttr(module.name).value)
+    module_type = module.type
+    self.input_types = list(module_type.inputs)
+    self.results = module_type.results
+    self.operand_names = [
+        StringAttr(name).value for name in ArrayAttr(
+            module.attributes["argNames"])
+    ]
+    self.result_names = [
+        StringAttr(name).value for name in ArrayAttr(
+            module.attributes["resultNames"])
+    ]
+    self.input_pytypes = None
+    if not isinstance(module, hw.HWModuleExternOp):
+      self.input_pytypes = {
+          name: support.type_to_pytype(ty)
+          for name, ty in zip(self.operand_names, self.input_types)
+      }
+
+
+def _parameters_to_attr(parameters):
+  if isinstance(parameters, DictAttr):
+    return parameters
+  parameters = {k: Attribute.parse(str(v)) for (k, v) in parameters.items()}
+  return DictAttr.get(parameters)
+
+
 class InstanceBuilder(support.NamedValueOpView):
   """Helper class to incrementally construct an instance of a module."""
 
@@ -21,25 +54,24 @@ class InstanceBuilder(support.NamedValueOpView):
                results=None,
                parameters={},
                sym_name=None,
+               port_info=None,
                loc=None,
                ip=None):
     self.module = module
+    if port_info is None:
+      port_info = _ModulePortInfo(module)
+    self.port_info = port_info
     instance_name = StringAttr.get(name)
-    module_name = FlatSymbolRefAttr.get(StringAttr(module.name).value)
-    parameters = {k: Attribute.parse(str(v)) for (k, v) in parameters.items()}
-    parameters = DictAttr.get(parameters)
+    parameters = _parameters_to_attr(parameters)
     if sym_name:
       sym_name = StringAttr.get(sym_name)
-    pre_args = [instance_name, module_name]
+    pre_args = [instance_name, port_info.module_name]
     post_args = [parameters, sym_name]
     if results is None:
-      results = module.type.results
+      results = port_info.results
 
-    if not isinstance(module, hw.HWModuleExternOp):
-      input_name_type_lookup = {
-          name: support.type_to_pytype(ty)
-          for name, ty in zip(self.operand_names(), module.type.inputs)
-      }
+    if port_info.input_pytypes is not None:
+      input_name_type_lookup = port_info.input_pytypes
       for input_name, input_value in input_port_mapping.items():
         if input_name not in input_name_type_lookup:
           continue  # This error gets caught and raised later.
@@ -57,21 +89,17 @@ class InstanceBuilder(support.NamedValueOpView):
                      ip=ip)
 
   def create_default_value(self, index, data_type, arg_name):
-    type = self.module.type.inputs[index]
+    type = self.port_info.input_types[index]
     return support.BackedgeBuilder.create(type,
                                           arg_name,
                                           self,
                                           instance_of=self.module)
 
   def operand_names(self):
-    arg_names = ArrayAttr(self.module.attributes["argNames"])
-    arg_name_attrs = map(StringAttr, arg_names)
-    return list(map(lambda s: s.value, arg_name_attrs))
+    return self.port_info.operand_names
 
   def result_names(self):
-    arg_names = ArrayAttr(self.module.attributes["resultNames"])
-    arg_name_attrs = map(StringAttr, arg_names)
-    return list(map(lambda s: s.value, arg_name_attrs))
+    return self.port_info.result_names
 
 
 class ModuleLike:
@@ -166,6 +194,40 @@ class ModuleLike:
                            loc=loc,
                            ip=ip)
 
+  def create_many(self,
+                  names: Sequence[str],
+                  input_port_mappings: Sequence[Dict[str, object]] = None,
+                  parameters: Dict[str, object] = {},
+                  results=None,
+                  loc=None,
+                  ip=None):
+    """
+    Create an instance of this module for each of `names`, returning the list
+    of their builders. The inputs of the i-th instance are connected as
+    specified by the i-th mapping of `input_port_mappings`, if any, and the
+    remaining ones can be connected later. The ports of the module and the
+    parameters are only processed once for all the instances, which makes this
+    much faster than calling `create` for each instance of a regular design.
+    """
+    if input_port_mappings is None:
+      input_port_mappings = [{}] * len(names)
+    if len(input_port_mappings) != len(names):
+      raise ValueError(f"Got {len(input_port_mappings)} input port mappings "
+                       f"for {len(names)} instances")
+    port_info = _ModulePortInfo(self)
+    parameters = _parameters_to_attr(parameters)
+    return [
+        InstanceBuilder(self,
+                        name,
+                        mapping,
+                        parameters=parameters,
+                        results=results,
+                        port_info=port_info,
+                        loc=loc,
+                        ip=ip)
+        for name, mapping in zip(names, input_port_mappings)
+    ]
+
 
 def _create_output_op(cls_name, output_ports, entry_block, bb_ret):
   """Create the hw.OutputOp from the body_builder return."""
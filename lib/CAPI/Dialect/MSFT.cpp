@@ -6,6 +6,7 @@
 #include "circt/Dialect/MSFT/ExportTcl.h"
 #include "circt/Dialect/MSFT/MSFTAttributes.h"
 #include "circt/Dialect/MSFT/MSFTDialect.h"
+#include "circt/Dialect/MSFT/PlacementDB.h"
 #include "circt/Support/LLVM.h"
 #include "mlir/CAPI/IR.h"
 #include "mlir/CAPI/Registration.h"
@@ -110,3 +111,68 @@ void circtMSFTSwitchInstanceAttrGetCases(MlirAttribute attr,
     dstArray[i] = {wrap(c.first), wrap(c.second)};
   }
 }
+
+//===----------------------------------------------------------------------===//
+// PlacementDB.
+//===----------------------------------------------------------------------===//
+
+static PlacementDB *unwrap(CirctMSFTPlacementDB db) {
+  return (PlacementDB *)db.ptr;
+}
+
+static CirctMSFTPlacedInstance wrap(const PlacementDB::PlacedInstance &inst) {
+  return {wrap(inst.path), wrap(inst.subpath), wrap(inst.op)};
+}
+
+CirctMSFTPlacementDB circtMSFTCreatePlacementDB(MlirOperation top) {
+  return {new PlacementDB(unwrap(top))};
+}
+void circtMSFTDeletePlacementDB(CirctMSFTPlacementDB self) {
+  delete unwrap(self);
+}
+int64_t circtMSFTPlacementDBAddDesignPlacements(CirctMSFTPlacementDB self) {
+  auto numAdded = unwrap(self)->addDesignPlacements();
+  if (failed(numAdded))
+    return -1;
+  return *numAdded;
+}
+MlirLogicalResult
+circtMSFTPlacementDBAddPlacement(CirctMSFTPlacementDB self, MlirAttribute loc,
+                                 CirctMSFTPlacedInstance inst) {
+  Operation *op = unwrap(inst.op);
+  // The subpath is owned by the caller, intern it in the context.
+  StringRef subpath =
+      StringAttr::get(op->getContext(), unwrap(inst.subpath)).getValue();
+  InstanceIDAttr path;
+  if (!mlirAttributeIsNull(inst.path))
+    path = unwrap(inst.path).cast<InstanceIDAttr>();
+  return wrap(unwrap(self)->addPlacement(unwrap(loc).cast<PhysLocationAttr>(),
+                                         {path, subpath, op}));
+}
+bool circtMSFTPlacementDBTryGetInstanceAt(CirctMSFTPlacementDB self,
+                                          MlirAttribute loc,
+                                          CirctMSFTPlacedInstance *out) {
+  auto inst = unwrap(self)->getInstanceAt(unwrap(loc).cast<PhysLocationAttr>());
+  if (!inst)
+    return false;
+  if (out != nullptr)
+    *out = wrap(*inst);
+  return true;
+}
+size_t circtMSFTPlacementDBGetNumPlacements(CirctMSFTPlacementDB self) {
+  return unwrap(self)->size();
+}
+void circtMSFTPlacementDBWalkPlacements(CirctMSFTPlacementDB self,
+                                        CirctMSFTPlacementCallback cb,
+                                        const uint64_t *bounds,
+                                        void *userData) {
+  Optional<PlacementDB::Region> region;
+  if (bounds != nullptr)
+    region = PlacementDB::Region{bounds[0], bounds[1], bounds[2], bounds[3]};
+  unwrap(self)->walkPlacements(
+      [cb, userData](PhysLocationAttr loc,
+                     const PlacementDB::PlacedInstance &inst) {
+        cb(wrap(loc), wrap(inst), userData);
+      },
+      region);
+}
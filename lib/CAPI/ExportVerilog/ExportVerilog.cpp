@@ -10,6 +10,8 @@
 #include "mlir/CAPI/IR.h"
 #include "mlir/CAPI/Support.h"
 #include "mlir/CAPI/Utils.h"
+#include "mlir/Support/FileUtilities.h"
+#include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace circt;
@@ -20,3 +22,22 @@ MlirLogicalResult mlirExportVerilog(MlirModule module,
   mlir::detail::CallbackOstream stream(callback, userData);
   return wrap(exportVerilog(unwrap(module), stream));
 }
+
+MlirLogicalResult mlirExportVerilogToFile(MlirModule module,
+                                          MlirStringRef path) {
+  std::string errorMessage;
+  auto output = mlir::openOutputFile(unwrap(path), &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return mlirLogicalResultFailure();
+  }
+  if (mlir::failed(exportVerilog(unwrap(module), output->os())))
+    return mlirLogicalResultFailure();
+  output->keep();
+  return mlirLogicalResultSuccess();
+}
+
+MlirLogicalResult mlirExportSplitVerilog(MlirModule module,
+                                         MlirStringRef dirname) {
+  return wrap(exportSplitVerilog(unwrap(module), unwrap(dirname)));
+}
@@ -0,0 +1,117 @@
+//===- Firtool.cpp - C Interface to the firtool pipeline ------------------===//
+//
+//  Implements a C Interface for the firtool pipeline.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt-c/Firtool.h"
+
+#include "circt/Firtool/Firtool.h"
+#include "circt/Firtool/PipelineReport.h"
+#include "circt/Support/LoweringOptions.h"
+#include "circt/Support/ThreadingOptions.h"
+#include "mlir/CAPI/IR.h"
+#include "mlir/CAPI/Pass.h"
+#include "mlir/CAPI/Support.h"
+#include "mlir/CAPI/Utils.h"
+#include "mlir/Pass/PassManager.h"
+
+using namespace circt;
+using namespace circt::firtool;
+
+//===----------------------------------------------------------------------===//
+// Pipeline.
+//===----------------------------------------------------------------------===//
+
+static FirtoolOptions *unwrap(CirctFirtoolOptions options) {
+  return (FirtoolOptions *)options.ptr;
+}
+
+CirctFirtoolOptions circtFirtoolOptionsCreateDefault() {
+  return {new FirtoolOptions()};
+}
+void circtFirtoolOptionsDestroy(CirctFirtoolOptions options) {
+  delete unwrap(options);
+}
+
+void circtFirtoolOptionsSetDisableOptimization(CirctFirtoolOptions options,
+                                               bool value) {
+  unwrap(options)->disableOptimization = value;
+}
+void circtFirtoolOptionsSetLowerToHW(CirctFirtoolOptions options, bool value) {
+  unwrap(options)->lowerToHW = value;
+}
+void circtFirtoolOptionsSetEmitVerilog(CirctFirtoolOptions options,
+                                       bool value) {
+  unwrap(options)->emitVerilog = value;
+}
+void circtFirtoolOptionsSetDedup(CirctFirtoolOptions options, bool value) {
+  unwrap(options)->dedup = value;
+}
+void circtFirtoolOptionsSetParallelInferWidths(CirctFirtoolOptions options,
+                                               bool value) {
+  unwrap(options)->parallelInferWidths = value;
+}
+void circtFirtoolOptionsSetParallelIMConstProp(CirctFirtoolOptions options,
+                                               bool value) {
+  unwrap(options)->parallelIMConstProp = value;
+}
+void circtFirtoolOptionsSetBlackBoxRoot(CirctFirtoolOptions options,
+                                        MlirStringRef path) {
+  unwrap(options)->blackBoxRoot = unwrap(path).str();
+}
+
+void circtFirtoolPopulatePipeline(MlirPassManager pm,
+                                  CirctFirtoolOptions options) {
+  populateFirtoolPasses(*unwrap(pm), *unwrap(options));
+}
+
+MlirLogicalResult circtFirtoolSetLoweringOptions(MlirModule module,
+                                                 MlirStringRef options) {
+  auto moduleOp = unwrap(module);
+  bool failed = false;
+  LoweringOptions loweringOptions(unwrap(options), [&](llvm::Twine error) {
+    moduleOp.emitError(error);
+    failed = true;
+  });
+  if (failed)
+    return mlirLogicalResultFailure();
+  loweringOptions.setAsAttribute(moduleOp);
+  return mlirLogicalResultSuccess();
+}
+
+//===----------------------------------------------------------------------===//
+// Threads.
+//===----------------------------------------------------------------------===//
+
+void circtSetNumThreads(unsigned numThreads) { setNumThreads(numThreads); }
+
+//===----------------------------------------------------------------------===//
+// Measurements.
+//===----------------------------------------------------------------------===//
+
+void circtPassManagerEnableTiming(MlirPassManager pm) {
+  unwrap(pm)->enableTiming();
+}
+
+void circtPassManagerEnableStatistics(MlirPassManager pm) {
+  unwrap(pm)->enableStatistics();
+}
+
+static PipelineReportInstrumentation *unwrap(CirctPipelineReport report) {
+  return (PipelineReportInstrumentation *)report.ptr;
+}
+
+CirctPipelineReport circtPassManagerAddPipelineReport(MlirPassManager pm) {
+  auto instrumentation = std::make_unique<PipelineReportInstrumentation>();
+  CirctPipelineReport report = {instrumentation.get()};
+  unwrap(pm)->addInstrumentation(std::move(instrumentation));
+  return report;
+}
+
+void circtPipelineReportPrintJSON(CirctPipelineReport report,
+                                  MlirStringCallback callback,
+                                  void *userData) {
+  mlir::detail::CallbackOstream stream(callback, userData);
+  unwrap(report)->writeJSON(stream);
+}
@@ -16,6 +16,7 @@
 #include "circt/Dialect/FIRRTL/FIRRTLAnnotations.h"
 #include "circt/Dialect/FIRRTL/FIRRTLOps.h"
 #include "circt/Dialect/FIRRTL/FIRRTLVisitors.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
 #include "circt/Dialect/HW/HWOps.h"
 #include "circt/Dialect/HW/HWTypes.h"
 #include "circt/Dialect/SV/SVOps.h"
@@ -25,8 +26,11 @@
 #include "mlir/Pass/Pass.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/TinyPtrVector.h"
+#include "llvm/Support/Debug.h"
 #include "llvm/Support/FormatVariadic.h"
-#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Process.h"
+
+#define DEBUG_TYPE "lower-to-hw"
 
 using namespace circt;
 using namespace firrtl;
@@ -192,17 +196,15 @@ static SmallVector<FirMemory> collectFIRRTLMemories(Operation *op) {
   return retval;
 }
 
+/// Merge the memories collected from each module into a single sorted and
+/// uniqued list.
 static SmallVector<FirMemory>
-mergeFIRRTLMemories(const SmallVector<FirMemory> &lhs,
-                    SmallVector<FirMemory> rhs) {
-  if (rhs.empty())
-    return lhs;
-  // lhs is always sorted and uniqued
-  llvm::sort(rhs);
-  rhs.erase(std::unique(rhs.begin(), rhs.end()), rhs.end());
+mergeFIRRTLMemories(ArrayRef<SmallVector<FirMemory>> moduleMemories) {
   SmallVector<FirMemory> retval;
-  std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
-                 std::back_inserter(retval));
+  for (auto &memories : moduleMemories)
+    retval.append(memories.begin(), memories.end());
+  llvm::sort(retval);
+  retval.erase(std::unique(retval.begin(), retval.end()), retval.end());
   return retval;
 }
 
@@ -222,8 +224,10 @@ struct CircuitLoweringState {
       used_RANDOMIZE_MEM_INIT{false};
   std::atomic<bool> used_RANDOMIZE_GARBAGE_ASSIGN{false};
 
-  CircuitLoweringState(CircuitOp circuitOp, bool warn)
-      : circuitOp(circuitOp), enableAnnotationWarning(warn) {}
+  CircuitLoweringState(CircuitOp circuitOp, InstanceGraph &instanceGraph,
+                       bool warn)
+      : circuitOp(circuitOp), instanceGraph(instanceGraph),
+        enableAnnotationWarning(warn) {}
 
   Operation *getNewModule(Operation *oldModule) {
     auto it = oldToNewModuleMap.find(oldModule);
@@ -236,6 +240,11 @@ struct CircuitLoweringState {
 
   CircuitOp circuitOp;
 
+  /// The instance graph of the circuit, used to resolve instances to the
+  /// modules they instantiate.  It is only read while the module bodies are
+  /// lowered in parallel.
+  InstanceGraph &instanceGraph;
+
   // Safely add a BindOp to global mutable state.  This will acquire a lock to
   // do this safely.
   void addBind(sv::BindOp op) {
@@ -318,10 +327,9 @@ private:
                            SmallVectorImpl<hw::ModulePortInfo> &ports,
                            Operation *moduleOp,
                            CircuitLoweringState &loweringState);
-  hw::HWModuleOp lowerModule(FModuleOp oldModule, Block *topLevelModule,
+  hw::HWModuleOp lowerModule(FModuleOp oldModule,
                              CircuitLoweringState &loweringState);
   hw::HWModuleExternOp lowerExtModule(FExtModuleOp oldModule,
-                                      Block *topLevelModule,
                                       CircuitLoweringState &loweringState);
 
   void lowerModuleBody(FModuleOp oldModule,
@@ -365,23 +373,24 @@ void FIRRTLModuleLowering::runOnOperation() {
 
   // Keep track of the mapping from old to new modules.  The result may be null
   // if lowering failed.
-  CircuitLoweringState state(circuit, enableAnnotationWarning);
+  CircuitLoweringState state(circuit, getChildAnalysis<InstanceGraph>(circuit),
+                             enableAnnotationWarning);
 
   SmallVector<FModuleOp, 32> modulesToProcess;
+  SmallVector<Operation *, 32> modulesToLower;
 
   state.processRemainingAnnotations(circuit, AnnotationSet(circuit));
-  // Iterate through each operation in the circuit body, transforming any
+  // Iterate through each operation in the circuit body, collecting any
   // FModule's we come across.
   for (auto &op : circuitBody->getOperations()) {
     if (auto module = dyn_cast<FModuleOp>(op)) {
-      state.oldToNewModuleMap[&op] = lowerModule(module, topLevelModule, state);
+      modulesToLower.push_back(module);
       modulesToProcess.push_back(module);
       continue;
     }
 
-    if (auto extModule = dyn_cast<FExtModuleOp>(op)) {
-      state.oldToNewModuleMap[&op] =
-          lowerExtModule(extModule, topLevelModule, state);
+    if (isa<FExtModuleOp>(op)) {
+      modulesToLower.push_back(&op);
       continue;
     }
 
@@ -400,25 +409,48 @@ void FIRRTLModuleLowering::runOnOperation() {
         });
   }
 
-  SmallVector<FirMemory> memories;
-  if (getContext().isMultithreadingEnabled()) {
-    // TODO: Update this to use a mlir::parallelTransformReduce once it exists.
-    memories = llvm::parallelTransformReduce(
-        modulesToProcess.begin(), modulesToProcess.end(),
-        SmallVector<FirMemory>(), mergeFIRRTLMemories, collectFIRRTLMemories);
-  } else {
-    for (auto m : modulesToProcess)
-      memories = mergeFIRRTLMemories(memories, collectFIRRTLMemories(m));
+  // Lower the ports of all modules and create the new module shells in
+  // parallel.  The shells are created detached, and are inserted into the
+  // top level module afterwards so that their order is deterministic.
+  SmallVector<Operation *, 32> newModules(modulesToLower.size());
+  mlir::parallelForEachN(
+      &getContext(), 0, modulesToLower.size(), [&](size_t index) {
+        auto *op = modulesToLower[index];
+        if (auto module = dyn_cast<FModuleOp>(op))
+          newModules[index] = lowerModule(module, state);
+        else
+          newModules[index] = lowerExtModule(cast<FExtModuleOp>(op), state);
+      });
+  for (size_t i = 0, e = modulesToLower.size(); i != e; ++i) {
+    if (auto *newModule = newModules[i])
+      topLevelModule->push_back(newModule);
+    state.oldToNewModuleMap[modulesToLower[i]] = newModules[i];
   }
+
+  // Collect the memories of each module in parallel, then merge them.
+  SmallVector<SmallVector<FirMemory>> moduleMemories(modulesToProcess.size());
+  mlir::parallelForEachN(
+      &getContext(), 0, modulesToProcess.size(), [&](size_t index) {
+        moduleMemories[index] = collectFIRRTLMemories(modulesToProcess[index]);
+      });
+  auto memories = mergeFIRRTLMemories(moduleMemories);
   if (!memories.empty())
     lowerMemoryDecls(memories, topLevelModule, state);
 
+  LLVM_DEBUG(llvm::dbgs() << "MallocUsage before lowering module bodies: "
+                          << llvm::sys::Process::GetMallocUsage() << "\n");
+
   // Now that we've lowered all of the modules, move the bodies over and update
-  // any instances that refer to the old modules.
+  // any instances that refer to the old modules.  Each FIRRTL body is consumed
+  // in place, so its ops are freed as soon as the module is done, and only the
+  // empty FIRRTL module remains for instances to look up their ports.
   mlir::parallelForEachN(
       &getContext(), 0, modulesToProcess.size(),
       [&](auto index) { lowerModuleBody(modulesToProcess[index], state); });
 
+  LLVM_DEBUG(llvm::dbgs() << "MallocUsage after lowering module bodies: "
+                          << llvm::sys::Process::GetMallocUsage() << "\n");
+
   // Move binds from inside modules to outside modules.
   for (auto bind : state.binds) {
     bind->moveBefore(bind->getParentOfType<hw::HWModuleOp>());
@@ -687,7 +719,6 @@ FIRRTLModuleLowering::lowerPorts(ArrayRef<ModulePortInfo> firrtlPorts,
 
 hw::HWModuleExternOp
 FIRRTLModuleLowering::lowerExtModule(FExtModuleOp oldModule,
-                                     Block *topLevelModule,
                                      CircuitLoweringState &loweringState) {
   // Map the ports over, lowering their types as we go.
   SmallVector<ModulePortInfo> firrtlPorts = oldModule.getPorts();
@@ -701,9 +732,9 @@ FIRRTLModuleLowering::lowerExtModule(FExtModuleOp oldModule,
 
   loweringState.processRemainingAnnotations(oldModule,
                                             AnnotationSet(oldModule));
-  // Build the new hw.module op.
-  OpBuilder builder(topLevelModule->getParent()->getContext());
-  builder.setInsertionPointToEnd(topLevelModule);
+  // Build the new hw.module op.  This is called in parallel, so the op is
+  // created detached and inserted into the top level module by the caller.
+  OpBuilder builder(oldModule.getContext());
   auto nameAttr = builder.getStringAttr(oldModule.getName());
   return builder.create<hw::HWModuleExternOp>(oldModule.getLoc(), nameAttr,
                                               ports, verilogName);
@@ -712,7 +743,7 @@ FIRRTLModuleLowering::lowerExtModule(FExtModuleOp oldModule,
 /// Run on each firrtl.module, transforming it from an firrtl.module into an
 /// hw.module, then deleting the old one.
 hw::HWModuleOp
-FIRRTLModuleLowering::lowerModule(FModuleOp oldModule, Block *topLevelModule,
+FIRRTLModuleLowering::lowerModule(FModuleOp oldModule,
                                   CircuitLoweringState &loweringState) {
   // Map the ports over, lowering their types as we go.
   SmallVector<ModulePortInfo> firrtlPorts = oldModule.getPorts();
@@ -722,9 +753,9 @@ FIRRTLModuleLowering::lowerModule(FModuleOp oldModule, Block *topLevelModule,
 
   loweringState.processRemainingAnnotations(oldModule,
                                             AnnotationSet(oldModule));
-  // Build the new hw.module op.
-  OpBuilder builder(topLevelModule->getParent()->getContext());
-  builder.setInsertionPointToEnd(topLevelModule);
+  // Build the new hw.module op.  This is called in parallel, so the op is
+  // created detached and inserted into the top level module by the caller.
+  OpBuilder builder(oldModule.getContext());
   auto nameAttr = builder.getStringAttr(oldModule.getName());
   auto newModule =
       builder.create<hw::HWModuleOp>(oldModule.getLoc(), nameAttr, ports);
@@ -1200,7 +1231,15 @@ void FIRRTLLowering::run() {
   auto *body = theModule.getBodyBlock();
   randomizePrologEmitted = false;
 
+  // Size the value mapping up front, so that it doesn't get rehashed over and
+  // over again as the values of a large module are lowered.
+  size_t numResults = 0;
+  for (auto &op : *body)
+    numResults += op.getNumResults();
+  valueMapping.reserve(numResults);
+
   SmallVector<Operation *, 16> opsToRemove;
+  opsToRemove.reserve(body->getOperations().size());
 
   // Iterate through each operation in the module body, attempting to lower
   // each of them.  We maintain 'builder' for each invocation.
@@ -2029,8 +2068,7 @@ LogicalResult FIRRTLLowering::visitDecl(MemOp op) {
 }
 
 LogicalResult FIRRTLLowering::visitDecl(InstanceOp oldInstance) {
-  auto *oldModule =
-      circuitState.circuitOp.lookupSymbol(oldInstance.moduleName());
+  auto *oldModule = circuitState.instanceGraph.getReferencedModule(oldInstance);
   auto newModule = circuitState.getNewModule(oldModule);
   if (!newModule) {
     oldInstance->emitOpError("could not find module referenced by instance");
@@ -19,6 +19,7 @@
 #include "circt/Dialect/LLHD/IR/LLHDDialect.h"
 #include "circt/Dialect/LLHD/IR/LLHDOps.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/DialectConversion.h"
 
@@ -35,12 +36,6 @@ namespace {
 struct HWToLLHDPass : public ConvertHWToLLHDBase<HWToLLHDPass> {
   void runOnOperation() override;
 };
-
-/// A helper type converter class that automatically populates the relevant
-/// materializations and type conversions for converting HW to LLHD.
-struct HWToLLHDTypeConverter : public TypeConverter {
-  HWToLLHDTypeConverter();
-};
 } // namespace
 
 /// Create a HW to LLHD conversion pass.
@@ -48,8 +43,9 @@ std::unique_ptr<OperationPass<ModuleOp>> circt::createConvertHWToLLHDPass() {
   return std::make_unique<HWToLLHDPass>();
 }
 
-/// Forward declare conversion patterns.
-struct ConvertHWModule;
+/// Forward declare conversion patterns and helpers.
+static EntityOp convertHWModule(HWModuleOp module,
+                                SmallVectorImpl<PrbOp> &inputProbes);
 struct ConvertOutput;
 struct ConvertInstance;
 
@@ -58,99 +54,108 @@ void HWToLLHDPass::runOnOperation() {
   MLIRContext &context = getContext();
   ModuleOp module = getOperation();
 
+  // Create the entities and move the module bodies into them. This modifies
+  // the top-level module, so it is done serially. Instances only refer to the
+  // modules they instantiate by name, so the bodies can then be converted
+  // independently of each other.
+  SmallVector<EntityOp> entities;
+  SmallVector<PrbOp> inputProbes;
+  for (auto hwModule : llvm::make_early_inc_range(module.getOps<HWModuleOp>()))
+    entities.push_back(convertHWModule(hwModule, inputProbes));
+
   // Mark the HW structure ops as illegal such that they get rewritten.
   ConversionTarget target(context);
   target.addLegalDialect<LLHDDialect>();
   target.addLegalDialect<CombDialect>();
-  target.addIllegalOp<HWModuleOp>();
   target.addIllegalOp<OutputOp>();
   target.addIllegalOp<InstanceOp>();
 
-  // Rewrite `hw.module`, `hw.output`, and `hw.instance`.
-  HWToLLHDTypeConverter typeConverter;
+  // Rewrite `hw.output` and `hw.instance` in the body of each entity, in
+  // parallel if the context enables it. The entities are isolated from above,
+  // and the patterns only create operations within the entity they convert.
   RewritePatternSet patterns(&context);
-  mlir::populateFunctionLikeTypeConversionPattern<HWModuleOp>(patterns,
-                                                              typeConverter);
-  patterns.add<ConvertHWModule>(&context);
   patterns.add<ConvertInstance>(&context);
   patterns.add<ConvertOutput>(&context);
-  if (failed(applyPartialConversion(module, target, std::move(patterns))))
-    signalPassFailure();
-}
-
-//===----------------------------------------------------------------------===//
-// TypeConverter conversions and materializations
-//===----------------------------------------------------------------------===//
-
-HWToLLHDTypeConverter::HWToLLHDTypeConverter() {
-  // Convert any type by just wrapping it in `SigType`.
-  addConversion([](Type type) { return SigType::get(type); });
-
-  // Mark `SigType` legal by converting it to itself.
-  addConversion([](SigType type) { return type; });
-
-  // Materialze probes when arguments are converted from any type to `SigType`.
-  addArgumentMaterialization(
-      [](OpBuilder &builder, Type type, ValueRange values, Location loc) {
-        assert(values.size() == 1);
-        auto op = builder.create<PrbOp>(loc, type, values[0]);
-        return op.getResult();
-      });
+  FrozenRewritePatternSet frozenPatterns(std::move(patterns));
+  std::atomic<bool> anyFailed(false);
+  mlir::parallelForEachN(&context, 0, entities.size(), [&](size_t i) {
+    if (failed(applyPartialConversion(entities[i], target, frozenPatterns)))
+      anyFailed = true;
+  });
+  if (anyFailed)
+    return signalPassFailure();
+
+  // Remove the probes of the input signals which the conversion made unused
+  // by connecting the signals directly.
+  for (auto prb : inputProbes)
+    if (prb.use_empty())
+      prb.erase();
 }
 
 //===----------------------------------------------------------------------===//
 // Convert structure operations
 //===----------------------------------------------------------------------===//
 
-/// This works on each HW module, creates corresponding entities, moves the
-/// bodies of the modules into the entities, and converts the bodies.
-struct ConvertHWModule : public OpConversionPattern<HWModuleOp> {
-  using OpConversionPattern::OpConversionPattern;
-
-  LogicalResult
-  matchAndRewrite(HWModuleOp module, ArrayRef<Value> operands,
-                  ConversionPatternRewriter &rewriter) const override {
-    // Collect the HW module's port types.
-    FunctionType moduleType = module.getType();
-    unsigned numInputs = moduleType.getNumInputs();
-    TypeRange moduleInputs = moduleType.getInputs();
-    TypeRange moduleOutputs = moduleType.getResults();
-
-    // LLHD entities port types are all expressed as block arguments to the op,
-    // so collect all of the types in the expected order (inputs then outputs).
-    SmallVector<Type, 4> entityTypes(moduleInputs);
-    entityTypes.append(moduleOutputs.begin(), moduleOutputs.end());
-
-    // Ensure the input and output types have all been converted already. This
-    // is handled separately by the upstream FunctionLikeTypeConversionPattern.
-    if (!llvm::all_of(entityTypes,
-                      [](Type type) { return type.isa<SigType>(); }))
-      return rewriter.notifyMatchFailure(module, "Not all ports had SigType");
-
-    // Create the entity. Note that LLHD does not support parameterized
-    // entities, so this conversion does not support parameterized modules.
-    auto entity = rewriter.create<EntityOp>(module.getLoc(), numInputs);
-
-    // Inline the HW module body into the entity body.
-    Region &entityBodyRegion = entity.getBodyRegion();
-    rewriter.inlineRegionBefore(module.getBodyRegion(), entityBodyRegion,
-                                entityBodyRegion.end());
-
-    // Set the entity type and name attributes. Add block arguments for each
-    // output, since LLHD entity outputs are still block arguments to the op.
-    auto entityType = rewriter.getFunctionType(entityTypes, {});
-    rewriter.updateRootInPlace(entity, [&] {
-      entity->setAttr(entity.getTypeAttrName(), TypeAttr::get(entityType));
-      entity.setName(module.getName());
-      entityBodyRegion.addArguments(moduleOutputs);
-    });
-
-    // Erase the HW module.
-    rewriter.eraseOp(module);
+/// Return the type of the LLHD signal carrying a value of the specified type,
+/// which may already be a signal.
+static Type getSignalType(Type type) {
+  if (type.isa<SigType>())
+    return type;
+  return SigType::get(type);
+}
 
-    return success();
+/// This works on a HW module, creates the corresponding entity, and moves the
+/// body of the module into the entity. The input ports of the module become
+/// signals, whose values are probed at the start of the entity for the uses of
+/// the ports. These probes are appended to `inputProbes`. Output ops and
+/// instances are left for the conversion patterns.
+static EntityOp convertHWModule(HWModuleOp module,
+                                SmallVectorImpl<PrbOp> &inputProbes) {
+  OpBuilder builder(module);
+
+  // LLHD entities port types are all expressed as block arguments to the op,
+  // so collect all of the types in the expected order (inputs then outputs).
+  FunctionType moduleType = module.getType();
+  unsigned numInputs = moduleType.getNumInputs();
+  SmallVector<Type, 4> entityTypes;
+  for (auto type : moduleType.getInputs())
+    entityTypes.push_back(getSignalType(type));
+  for (auto type : moduleType.getResults())
+    entityTypes.push_back(getSignalType(type));
+
+  // Create the entity. Note that LLHD does not support parameterized
+  // entities, so this conversion does not support parameterized modules.
+  auto entity = builder.create<EntityOp>(module.getLoc(), numInputs);
+
+  // Move the HW module body into the entity body.
+  Region &entityBodyRegion = entity.getBodyRegion();
+  entityBodyRegion.takeBody(module.getBodyRegion());
+
+  // Set the entity type and name attributes. Add block arguments for each
+  // output, since LLHD entity outputs are still block arguments to the op.
+  auto entityType = builder.getFunctionType(entityTypes, {});
+  entity->setAttr(entity.getTypeAttrName(), TypeAttr::get(entityType));
+  entity.setName(module.getName());
+  Block *body = &entityBodyRegion.front();
+  body->addArguments(ArrayRef<Type>(entityTypes).drop_front(numInputs));
+
+  // Turn the input ports into signals, and probe them for the uses of the
+  // original values.
+  builder.setInsertionPointToStart(body);
+  for (auto arg : body->getArguments().take_front(numInputs)) {
+    auto type = arg.getType();
+    if (type.isa<SigType>())
+      continue;
+    arg.setType(SigType::get(type));
+    auto prb = builder.create<PrbOp>(arg.getLoc(), type, arg);
+    arg.replaceAllUsesExcept(prb, SmallPtrSet<Operation *, 1>{prb});
+    inputProbes.push_back(prb);
   }
-};
+
+  // Erase the HW module.
+  module.erase();
+  return entity;
+}
 
 /// This works on each output op, creating ops to drive the appropriate results.
 struct ConvertOutput : public OpConversionPattern<OutputOp> {
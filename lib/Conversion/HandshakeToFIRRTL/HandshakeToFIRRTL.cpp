@@ -470,18 +470,10 @@ static FModuleOp createTopModuleOp(handshake::FuncOp funcOp, unsigned numClocks,
 // FIRRTL Sub-module Related Functions
 //===----------------------------------------------------------------------===//
 
-/// Check whether a submodule with the same name has been created elsewhere.
-/// Return the matched submodule if true, otherwise return nullptr.
-static FModuleOp checkSubModuleOp(FModuleOp topModuleOp, Operation *oldOp) {
-  for (auto &op : topModuleOp->getParentRegion()->front()) {
-    if (auto subModuleOp = dyn_cast<FModuleOp>(op)) {
-      if (getSubModuleName(oldOp) == subModuleOp.getName()) {
-        return subModuleOp;
-      }
-    }
-  }
-  return FModuleOp(nullptr);
-}
+/// The sub-modules of a circuit, keyed by their name. The name of a sub-module
+/// encodes the signature of the operations it implements, so operations with
+/// the same signature are looked up without scanning the circuit.
+using SubModuleCache = llvm::StringMap<FModuleOp>;
 
 /// All standard expressions and handshake elastic components will be converted
 /// to a FIRRTL sub-module and be instantiated in the top-module.
@@ -2055,6 +2047,266 @@ static void convertReturnOp(Operation *oldOp, FModuleOp topModuleOp,
   rewriter.eraseOp(oldOp);
 }
 
+/// Return the sub-module implementing the given operation, creating it if it
+/// has not been created yet. Return nullptr if the operation is unsupported.
+static FModuleOp getOrCreateSubModuleOp(FModuleOp topModuleOp, Operation *op,
+                                        SubModuleCache &subModules,
+                                        ConversionPatternRewriter &rewriter) {
+  auto &subModuleOp = subModules[getSubModuleName(op)];
+  if (subModuleOp)
+    return subModuleOp;
+
+  bool hasClock = op->hasTrait<mlir::OpTrait::HasClock>();
+  subModuleOp = createSubModuleOp(topModuleOp, op, hasClock, rewriter);
+
+  Location insertLoc = subModuleOp.getLoc();
+  auto &bodyBlock = subModuleOp.getBody().front();
+  rewriter.setInsertionPoint(&bodyBlock, bodyBlock.end());
+
+  ValueVectorList portList = extractSubfields(subModuleOp, insertLoc, rewriter);
+
+  if (HandshakeBuilder(portList, insertLoc, rewriter)
+          .dispatchHandshakeVisitor(op))
+    return subModuleOp;
+  if (StdExprBuilder(portList, insertLoc, rewriter).dispatchStdExprVisitor(op))
+    return subModuleOp;
+  return FModuleOp(nullptr);
+}
+
+//===----------------------------------------------------------------------===//
+// Resource Sharing
+//===----------------------------------------------------------------------===//
+
+/// Return true if the operation is on a cycle of the dataflow graph, in which
+/// case it may fire on every iteration of a loop.
+static bool isOnGraphCycle(Operation *op) {
+  SmallVector<Operation *, 16> worklist;
+  DenseSet<Operation *> visited;
+  for (auto *user : op->getUsers())
+    worklist.push_back(user);
+  while (!worklist.empty()) {
+    auto *user = worklist.pop_back_val();
+    if (user == op)
+      return true;
+    if (!visited.insert(user).second)
+      continue;
+    for (auto *nextUser : user->getUsers())
+      worklist.push_back(nextUser);
+  }
+  return false;
+}
+
+using SharedOpGroup = SmallVector<Operation *, 4>;
+
+/// Group the operations of the top-module that are mapped onto shared units.
+/// Operations are grouped if they are named in `sharedOpNames` and lower to
+/// the same combinational standard sub-module. Operations on a cycle of the
+/// graph are considered highly utilized and are never shared, all the others
+/// fire at most once per invocation of the function. Each group holds up to
+/// `maxGroupSize` operations, in the order they appear in the top-module.
+static std::vector<SharedOpGroup>
+getSharedOpGroups(FModuleOp topModuleOp, ArrayRef<std::string> sharedOpNames,
+                  unsigned maxGroupSize) {
+  std::vector<SharedOpGroup> groups;
+  if (sharedOpNames.empty() || maxGroupSize < 2)
+    return groups;
+
+  llvm::StringMap<unsigned> openGroups;
+  for (auto &op : topModuleOp.getBody().front()) {
+    if (!op.getDialect() || op.getDialect()->getNamespace() != "std" ||
+        op.getNumResults() != 1 || op.hasTrait<mlir::OpTrait::HasClock>() ||
+        !llvm::is_contained(sharedOpNames, op.getName().getStringRef()) ||
+        isOnGraphCycle(&op))
+      continue;
+
+    auto it = openGroups.try_emplace(getSubModuleName(&op), groups.size());
+    if (it.second || groups[it.first->second].size() == maxGroupSize) {
+      it.first->second = groups.size();
+      groups.emplace_back();
+    }
+    groups[it.first->second].push_back(&op);
+  }
+
+  // A group of one operation does not share anything.
+  llvm::erase_if(groups,
+                 [](const SharedOpGroup &group) { return group.size() < 2; });
+  return groups;
+}
+
+/// Create a sub-module mapping the given operations onto a single instance of
+/// `unitModuleOp`, the sub-module they all lower to. The operations whose
+/// operands are all valid compete for the unit through a priority arbiter.
+/// Each operation has a result register, and only competes if the register
+/// can take a new result, such that a consumer that is not ready never blocks
+/// the unit for the other operations.
+static FModuleOp createSharedSubModuleOp(FModuleOp topModuleOp,
+                                         FModuleOp unitModuleOp,
+                                         ArrayRef<Operation *> ops,
+                                         SubModuleCache &subModules,
+                                         ConversionPatternRewriter &rewriter) {
+  auto *firstOp = ops.front();
+  auto subModuleName =
+      getSubModuleName(firstOp) + "_shared" + std::to_string(ops.size());
+  auto &cachedModuleOp = subModules[subModuleName];
+  if (cachedModuleOp)
+    return cachedModuleOp;
+
+  rewriter.setInsertionPoint(topModuleOp);
+  auto loc = firstOp->getLoc();
+  llvm::SmallVector<ModulePortInfo, 8> ports;
+  unsigned argIndex = 0;
+  auto addPort = [&](Type type, Direction direction) {
+    auto portName = rewriter.getStringAttr("arg" + std::to_string(argIndex++));
+    ports.push_back({portName, getBundleType(type), direction, loc});
+  };
+  for (auto *op : ops) {
+    for (auto type : op->getOperandTypes())
+      addPort(type, Direction::Input);
+    addPort(op->getResult(0).getType(), Direction::Output);
+  }
+  ports.push_back({rewriter.getStringAttr("clock"),
+                   rewriter.getType<ClockType>(), Direction::Input, loc});
+  ports.push_back({rewriter.getStringAttr("reset"),
+                   rewriter.getType<UIntType>(1), Direction::Input, loc});
+
+  auto subModuleOp = rewriter.create<FModuleOp>(
+      topModuleOp.getLoc(), rewriter.getStringAttr(subModuleName), ports);
+  cachedModuleOp = subModuleOp;
+  Location insertLoc = subModuleOp.getLoc();
+  auto &bodyBlock = subModuleOp.getBody().front();
+  rewriter.setInsertionPoint(&bodyBlock, bodyBlock.end());
+  ValueVectorList portList = extractSubfields(subModuleOp, insertLoc, rewriter);
+
+  unsigned numIns = firstOp->getNumOperands();
+  unsigned numOpPorts = numIns + 1;
+  Value clock = portList[ops.size() * numOpPorts][0];
+  Value reset = portList[ops.size() * numOpPorts + 1][0];
+
+  auto bitType = UIntType::get(rewriter.getContext(), 1);
+  auto falseConst = createConstantOp(bitType, APInt(1, 0), insertLoc, rewriter);
+  auto trueConst = createConstantOp(bitType, APInt(1, 1), insertLoc, rewriter);
+
+  // Instantiate the shared unit and extract the subfields of its ports.
+  llvm::SmallVector<Type> unitTypes;
+  for (auto &port : getModulePortInfo(unitModuleOp))
+    unitTypes.push_back(port.type);
+  auto unitOp = rewriter.create<firrtl::InstanceOp>(insertLoc, unitTypes,
+                                                    unitModuleOp.getName());
+  auto getUnitSubfield = [&](unsigned port, unsigned field) -> Value {
+    return rewriter.create<SubfieldOp>(insertLoc, unitOp.getResult(port),
+                                       field);
+  };
+  Value unitResultData = getUnitSubfield(numIns, 2);
+  rewriter.create<ConnectOp>(insertLoc, getUnitSubfield(numIns, 1), trueConst);
+  auto dataType = unitResultData.getType().cast<FIRRTLType>().getPassiveType();
+  auto dataZeroConst =
+      createConstantOp(dataType, APInt(dataType.getBitWidthOrSentinel(), 0),
+                       insertLoc, rewriter);
+
+  // Arbitrate between the operations, the first operation that requests the
+  // unit gets it.
+  Value taken = falseConst;
+  SmallVector<Value, 4> grants;
+  for (unsigned i = 0, e = ops.size(); i != e; ++i) {
+    auto firstPort = portList.begin() + i * numOpPorts;
+    ValueVector &resultSubfields = *(firstPort + numIns);
+    Value resultValid = resultSubfields[0];
+    Value resultReady = resultSubfields[1];
+    Value resultData = resultSubfields[2];
+
+    // All the operands of an operation are consumed together.
+    Value argsValid = (*firstPort)[0];
+    for (unsigned j = 1; j < numIns; ++j)
+      argsValid = rewriter.create<AndPrimOp>(insertLoc, bitType, argsValid,
+                                             (*(firstPort + j))[0]);
+
+    auto suffix = std::to_string(i);
+    auto validReg = rewriter.create<RegResetOp>(
+        insertLoc, bitType, clock, reset, falseConst, "validReg" + suffix);
+    auto dataReg = rewriter.create<RegResetOp>(
+        insertLoc, dataType, clock, reset, dataZeroConst, "dataReg" + suffix);
+    rewriter.create<ConnectOp>(insertLoc, resultValid, validReg);
+    rewriter.create<ConnectOp>(insertLoc, resultData, dataReg);
+
+    // The result register can take a new result if it is empty or if its
+    // result is consumed in this cycle.
+    auto notValidReg = rewriter.create<NotPrimOp>(insertLoc, bitType, validReg);
+    auto emptyOrReady =
+        rewriter.create<OrPrimOp>(insertLoc, bitType, notValidReg, resultReady);
+    auto request =
+        rewriter.create<AndPrimOp>(insertLoc, bitType, argsValid, emptyOrReady);
+    auto notTaken = rewriter.create<NotPrimOp>(insertLoc, bitType, taken);
+    Value grant =
+        rewriter.create<AndPrimOp>(insertLoc, bitType, request, notTaken);
+    taken = rewriter.create<OrPrimOp>(insertLoc, bitType, taken, request);
+    grants.push_back(grant);
+
+    for (unsigned j = 0; j < numIns; ++j)
+      rewriter.create<ConnectOp>(insertLoc, (*(firstPort + j))[1], grant);
+
+    // Load the result of the unit when granted, and empty the register when
+    // its result is consumed otherwise.
+    auto clearedValid = rewriter.create<MuxPrimOp>(
+        insertLoc, bitType, resultReady, falseConst, validReg);
+    auto nextValid = rewriter.create<MuxPrimOp>(insertLoc, bitType, grant,
+                                                trueConst, clearedValid);
+    rewriter.create<ConnectOp>(insertLoc, validReg, nextValid);
+    auto nextData = rewriter.create<MuxPrimOp>(insertLoc, dataType, grant,
+                                               unitResultData, dataReg);
+    rewriter.create<ConnectOp>(insertLoc, dataReg, nextData);
+  }
+
+  // Drive the unit with the operands of the granted operation.
+  for (unsigned j = 0; j < numIns; ++j) {
+    Value argData = portList[j][2];
+    for (unsigned i = 1, e = ops.size(); i != e; ++i)
+      argData = rewriter.create<MuxPrimOp>(insertLoc, argData.getType(),
+                                           grants[i],
+                                           portList[i * numOpPorts + j][2],
+                                           argData);
+    rewriter.create<ConnectOp>(insertLoc, getUnitSubfield(j, 0), taken);
+    rewriter.create<ConnectOp>(insertLoc, getUnitSubfield(j, 2), argData);
+  }
+
+  return subModuleOp;
+}
+
+/// Create the instance of a shared sub-module in the top-module, and connect
+/// it to the operands and results of all the operations it implements.
+static void createSharedInstOp(ArrayRef<Operation *> ops,
+                               FModuleOp subModuleOp, FModuleOp topModuleOp,
+                               ConversionPatternRewriter &rewriter) {
+  auto *firstOp = ops.front();
+  rewriter.setInsertionPointAfter(firstOp);
+
+  llvm::SmallVector<Type> resultTypes;
+  for (auto &port : getModulePortInfo(subModuleOp))
+    resultTypes.push_back(port.type);
+  auto instanceOp = rewriter.create<firrtl::InstanceOp>(
+      firstOp->getLoc(), resultTypes, subModuleOp.getName());
+
+  auto results = instanceOp.getResults();
+  unsigned portIndex = 0;
+  for (auto *op : ops) {
+    for (auto operand : op->getOperands())
+      rewriter.create<ConnectOp>(op->getLoc(), results[portIndex++], operand);
+    op->getResult(0).replaceAllUsesWith(results[portIndex++]);
+  }
+
+  auto topArgs = topModuleOp.getBody().front().getArguments();
+  auto firstClock =
+      std::find_if(topArgs.begin(), topArgs.end(), [](BlockArgument &arg) {
+        return arg.getType().isa<ClockType>();
+      });
+  rewriter.create<ConnectOp>(firstOp->getLoc(), results[portIndex],
+                             *firstClock);
+  rewriter.create<ConnectOp>(firstOp->getLoc(), results[portIndex + 1],
+                             *(firstClock + 1));
+
+  for (auto *op : ops)
+    rewriter.eraseOp(op);
+}
+
 //===----------------------------------------------------------------------===//
 // HandshakeToFIRRTL lowering Pass
 //===----------------------------------------------------------------------===//
@@ -2065,7 +2317,8 @@ static void convertReturnOp(Operation *oldOp, FModuleOp topModuleOp,
 /// 1)  Create and go into a new FIRRTL top-module;
 /// 2)  Inline Handshake FuncOp region into the FIRRTL top-module;
 /// 3)  Traverse and convert each Standard or Handshake operation:
-///   i)    Check if an identical sub-module exists. If so, skip to vi);
+///   i)    Look up an identical sub-module in the cache. If found, skip to
+///         vi);
 ///   ii)   Create and go into a new FIRRTL sub-module;
 ///   iii)  Extract data (if applied), valid, and ready subfield from each port
 ///         of the sub-module;
@@ -2076,15 +2329,23 @@ static void convertReturnOp(Operation *oldOp, FModuleOp topModuleOp,
 /// 4)  Erase the Handshake FuncOp.
 ///
 /// createTopModuleOp():  1) and 2)
-/// checkSubModuleOp():   3.i)
+/// getOrCreateSubModuleOp(): 3.i)
 /// createSubModuleOp():  3.ii)
 /// extractSubfields():   3.iii)
 /// build*Logic():        3.iv)
 /// createInstOp():       3.v), 3.vi), and 3.vii)
 ///
+/// Operations selected for resource sharing are lowered as a group when the
+/// first of them is visited, to a single instance of a shared sub-module.
+///
 /// Please refer to test_addi.mlir test case.
 struct HandshakeFuncOpLowering : public OpConversionPattern<handshake::FuncOp> {
-  using OpConversionPattern<handshake::FuncOp>::OpConversionPattern;
+  HandshakeFuncOpLowering(MLIRContext *context,
+                          ArrayRef<std::string> sharedOpNames,
+                          unsigned maxSharedOps)
+      : OpConversionPattern<handshake::FuncOp>(context),
+        sharedOpNames(sharedOpNames.begin(), sharedOpNames.end()),
+        maxSharedOps(maxSharedOps) {}
 
   LogicalResult
   matchAndRewrite(handshake::FuncOp funcOp, ArrayRef<Value> operands,
@@ -2094,6 +2355,16 @@ struct HandshakeFuncOpLowering : public OpConversionPattern<handshake::FuncOp> {
         funcOp.getLoc(), rewriter.getStringAttr(funcOp.getName()));
     rewriter.setInsertionPointToStart(circuitOp.getBody());
     auto topModuleOp = createTopModuleOp(funcOp, /*numClocks=*/1, rewriter);
+    SubModuleCache subModules;
+
+    // Select the operations mapped onto shared units.
+    DenseMap<Operation *, unsigned> sharedGroupIndices;
+    auto sharedGroups =
+        getSharedOpGroups(topModuleOp, sharedOpNames, maxSharedOps);
+    for (unsigned i = 0, e = sharedGroups.size(); i != e; ++i)
+      for (auto *op : sharedGroups[i])
+        sharedGroupIndices[op] = i;
+    DenseSet<Operation *> loweredSharedOps;
 
     // Traverse and convert each operation in funcOp.
     for (Operation &op : topModuleOp.getBody().front()) {
@@ -2103,26 +2374,23 @@ struct HandshakeFuncOpLowering : public OpConversionPattern<handshake::FuncOp> {
       // This branch takes care of all non-timing operations that require to
       // be instantiated in the top-module.
       else if (op.getDialect()->getNamespace() != "firrtl") {
-        FModuleOp subModuleOp = checkSubModuleOp(topModuleOp, &op);
-        bool hasClock = op.hasTrait<mlir::OpTrait::HasClock>();
-
-        // Check if the sub-module already exists.
-        if (!subModuleOp) {
-          subModuleOp = createSubModuleOp(topModuleOp, &op, hasClock, rewriter);
-
-          Location insertLoc = subModuleOp.getLoc();
-          auto &bodyBlock = subModuleOp.getBody().front();
-          rewriter.setInsertionPoint(&bodyBlock, bodyBlock.end());
-
-          ValueVectorList portList =
-              extractSubfields(subModuleOp, insertLoc, rewriter);
-
-          if (HandshakeBuilder(portList, insertLoc, rewriter)
-                  .dispatchHandshakeVisitor(&op)) {
-          } else if (StdExprBuilder(portList, insertLoc, rewriter)
-                         .dispatchStdExprVisitor(&op)) {
-          } else
-            return op.emitError("unsupported operation type");
+        // Erased operations are only removed at the end of the conversion.
+        if (loweredSharedOps.count(&op))
+          continue;
+
+        FModuleOp subModuleOp =
+            getOrCreateSubModuleOp(topModuleOp, &op, subModules, rewriter);
+        if (!subModuleOp)
+          return op.emitError("unsupported operation type");
+
+        auto sharedGroup = sharedGroupIndices.find(&op);
+        if (sharedGroup != sharedGroupIndices.end()) {
+          auto &ops = sharedGroups[sharedGroup->second];
+          auto sharedModuleOp = createSharedSubModuleOp(
+              topModuleOp, subModuleOp, ops, subModules, rewriter);
+          createSharedInstOp(ops, sharedModuleOp, topModuleOp, rewriter);
+          loweredSharedOps.insert(ops.begin(), ops.end());
+          continue;
         }
 
         // Instantiate the new created sub-module.
@@ -2136,6 +2404,12 @@ struct HandshakeFuncOpLowering : public OpConversionPattern<handshake::FuncOp> {
 
     return success();
   }
+
+private:
+  /// The names of the operations mapped onto shared units.
+  std::vector<std::string> sharedOpNames;
+  /// The maximum number of operations sharing a unit.
+  unsigned maxSharedOps;
 };
 
 namespace {
@@ -2149,8 +2423,11 @@ public:
     target.addLegalDialect<FIRRTLDialect>();
     target.addIllegalDialect<handshake::HandshakeOpsDialect>();
 
+    SmallVector<std::string, 4> sharedOpNames(sharedOps.begin(),
+                                              sharedOps.end());
     RewritePatternSet patterns(op.getContext());
-    patterns.insert<HandshakeFuncOpLowering>(op.getContext());
+    patterns.insert<HandshakeFuncOpLowering>(op.getContext(), sharedOpNames,
+                                             maxSharedOps);
 
     if (failed(applyPartialConversion(op, target, std::move(patterns))))
       signalPassFailure();
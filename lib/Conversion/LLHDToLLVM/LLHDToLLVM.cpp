@@ -72,6 +72,66 @@ getOrInsertFunction(ModuleOp &module, ConversionPatternRewriter &rewriter,
   return func;
 }
 
+/// Insert a function after the lowered unit, named like it with a `_batch`
+/// suffix, which runs the unit for a batch of instances. It takes the state,
+/// an array of instance states, an array of signal tables and the number of
+/// instances, such that the simulator can run the instances of a unit woken up
+/// together in a single call.
+static void insertBatchedUnit(ConversionPatternRewriter &rewriter,
+                              LLVM::LLVMFuncOp unit) {
+  auto loc = unit.getLoc();
+  Type i64Ty = rewriter.getIntegerType(64);
+  auto params = unit.getType().getParams();
+  auto instStatesTy = LLVM::LLVMPointerType::get(params[1]);
+  auto sigTablesTy = LLVM::LLVMPointerType::get(params[2]);
+  auto funcTy = LLVM::LLVMFunctionType::get(
+      LLVM::LLVMVoidType::get(rewriter.getContext()),
+      {params[0], instStatesTy, sigTablesTy, i64Ty});
+
+  OpBuilder::InsertionGuard guard(rewriter);
+  rewriter.setInsertionPointAfter(unit);
+  auto func = rewriter.create<LLVM::LLVMFuncOp>(
+      loc, (unit.getName() + "_batch").str(), funcTy);
+  auto &body = func.getBody();
+  auto *entryBlock =
+      rewriter.createBlock(&body, body.end(), funcTy.getParams());
+  auto *headerBlock =
+      rewriter.createBlock(&body, body.end(), ArrayRef<Type>(i64Ty));
+  auto *loopBlock = rewriter.createBlock(&body, body.end());
+  auto *exitBlock = rewriter.createBlock(&body, body.end());
+
+  // Loop over the instances, starting from the first one.
+  rewriter.setInsertionPointToEnd(entryBlock);
+  auto zeroC = rewriter.create<LLVM::ConstantOp>(loc, i64Ty,
+                                                 rewriter.getI64IntegerAttr(0));
+  rewriter.create<LLVM::BrOp>(loc, ValueRange(zeroC), headerBlock);
+
+  rewriter.setInsertionPointToEnd(headerBlock);
+  auto index = headerBlock->getArgument(0);
+  auto cmp = rewriter.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::slt, index,
+                                           entryBlock->getArgument(3));
+  rewriter.create<LLVM::CondBrOp>(loc, cmp, loopBlock, exitBlock);
+
+  // Run the unit with the state and signal table of the current instance.
+  rewriter.setInsertionPointToEnd(loopBlock);
+  auto instStatePtr = rewriter.create<LLVM::GEPOp>(
+      loc, instStatesTy, entryBlock->getArgument(1), ArrayRef<Value>(index));
+  auto instState = rewriter.create<LLVM::LoadOp>(loc, params[1], instStatePtr);
+  auto sigTablePtr = rewriter.create<LLVM::GEPOp>(
+      loc, sigTablesTy, entryBlock->getArgument(2), ArrayRef<Value>(index));
+  auto sigTable = rewriter.create<LLVM::LoadOp>(loc, params[2], sigTablePtr);
+  std::array<Value, 3> args({entryBlock->getArgument(0), instState, sigTable});
+  rewriter.create<LLVM::CallOp>(loc, llvm::None,
+                                rewriter.getSymbolRefAttr(unit), args);
+  auto oneC = rewriter.create<LLVM::ConstantOp>(loc, i64Ty,
+                                                rewriter.getI64IntegerAttr(1));
+  auto next = rewriter.create<LLVM::AddOp>(loc, index, oneC);
+  rewriter.create<LLVM::BrOp>(loc, ValueRange(next), headerBlock);
+
+  rewriter.setInsertionPointToEnd(exitBlock);
+  rewriter.create<LLVM::ReturnOp>(loc, ValueRange());
+}
+
 /// Return the LLVM type used to represent a signal. It corresponds to a struct
 /// with the format: {valuePtr, bitOffset, instanceIndex, globalIndex}.
 static Type getLLVMSigType(LLVM::LLVMDialect *dialect) {
@@ -797,6 +857,7 @@ struct EntityOpConversion : public ConvertToLLVMPattern {
     // Inline the entity region in the new llvm function.
     rewriter.inlineRegionBefore(entityOp.getBody(), llvmFunc.getBody(),
                                 llvmFunc.end());
+    insertBatchedUnit(rewriter, llvmFunc);
 
     // Erase the original operation.
     rewriter.eraseOp(op);
@@ -918,6 +979,7 @@ struct ProcOpConversion : public ConvertToLLVMPattern {
                                            &final))) {
       return failure();
     }
+    insertBatchedUnit(rewriter, llvmFunc);
 
     rewriter.eraseOp(op);
 
@@ -1149,14 +1211,16 @@ struct InstOpConversion : public ConvertToLLVMPattern {
                             "addSigStructElement", addSigStructElemFuncTy);
 
     // Get or insert allocProc library call definition.
-    auto allocProcFuncTy =
-        LLVM::LLVMFunctionType::get(voidTy, {i8PtrTy, i8PtrTy, i8PtrTy});
+    // Signature: (i8* state, i8* owner, i8* procState, i64 size) -> void
+    auto allocProcFuncTy = LLVM::LLVMFunctionType::get(
+        voidTy, {i8PtrTy, i8PtrTy, i8PtrTy, i64Ty});
     auto allocProcFunc = getOrInsertFunction(module, rewriter, op->getLoc(),
                                              "allocProc", allocProcFuncTy);
 
     // Get or insert allocEntity library call definition.
-    auto allocEntityFuncTy =
-        LLVM::LLVMFunctionType::get(voidTy, {i8PtrTy, i8PtrTy, i8PtrTy});
+    // Signature: (i8* state, i8* owner, i8* entityState, i64 size) -> void
+    auto allocEntityFuncTy = LLVM::LLVMFunctionType::get(
+        voidTy, {i8PtrTy, i8PtrTy, i8PtrTy, i64Ty});
     auto allocEntityFunc = getOrInsertFunction(
         module, rewriter, op->getLoc(), "allocEntity", allocEntityFuncTy);
 
@@ -1184,8 +1248,11 @@ struct InstOpConversion : public ConvertToLLVMPattern {
     }
 
     // Handle entity instantiation.
-    if (auto child = module.lookupSymbol<EntityOp>(instOp.callee())) {
-      auto regStateTy = getRegStateTy(&getDialect(), child.getOperation());
+    auto *unit = lookupUnit(module, instOp.callee());
+    if (auto child = dyn_cast_or_null<EntityOp>(unit)) {
+      auto regStateTy = getStateType(child, [&] {
+        return getRegStateTy(&getDialect(), child.getOperation());
+      });
       auto regStatePtrTy = LLVM::LLVMPointerType::get(regStateTy);
 
       // Get reg state size.
@@ -1233,7 +1300,7 @@ struct InstOpConversion : public ConvertToLLVMPattern {
       // Add reg state pointer to global state.
       initBuilder.create<LLVM::CallOp>(
           op->getLoc(), llvm::None, rewriter.getSymbolRefAttr(allocEntityFunc),
-          ArrayRef<Value>({initStatePtr, owner, regMall}));
+          ArrayRef<Value>({initStatePtr, owner, regMall, regSize}));
 
       // Index of the signal in the entity's signal table.
       int initCounter = 0;
@@ -1359,15 +1426,17 @@ struct InstOpConversion : public ConvertToLLVMPattern {
           }
         }
       });
-    } else if (auto proc = module.lookupSymbol<ProcOp>(instOp.callee())) {
+    } else if (auto proc = dyn_cast_or_null<ProcOp>(unit)) {
       // Handle process instantiation.
       auto sensesPtrTy = LLVM::LLVMPointerType::get(
           LLVM::LLVMArrayType::get(i1Ty, proc.getNumArguments()));
+      auto persistenceTy = getStateType(proc, [&] {
+        return getProcPersistenceTy(&getDialect(), typeConverter, proc);
+      });
       auto procStatePtrTy =
           LLVM::LLVMPointerType::get(LLVM::LLVMStructType::getLiteral(
               rewriter.getContext(),
-              {i32Ty, i32Ty, sensesPtrTy,
-               getProcPersistenceTy(&getDialect(), typeConverter, proc)}));
+              {i32Ty, i32Ty, sensesPtrTy, persistenceTy}));
 
       auto zeroC = initBuilder.create<LLVM::ConstantOp>(
           op->getLoc(), i32Ty, rewriter.getI32IntegerAttr(0));
@@ -1441,7 +1510,8 @@ struct InstOpConversion : public ConvertToLLVMPattern {
       initBuilder.create<LLVM::StoreOp>(op->getLoc(), sensesBC,
                                         procStateSensesPtr);
 
-      std::array<Value, 3> allocProcArgs({initStatePtr, owner, procStateMall});
+      std::array<Value, 4> allocProcArgs(
+          {initStatePtr, owner, procStateMall, procStateSize});
       initBuilder.create<LLVM::CallOp>(op->getLoc(), llvm::None,
                                        rewriter.getSymbolRefAttr(allocProcFunc),
                                        allocProcArgs);
@@ -1450,6 +1520,31 @@ struct InstOpConversion : public ConvertToLLVMPattern {
     rewriter.eraseOp(op);
     return success();
   }
+
+private:
+  /// Return the entity or process with the specified name. Instances are
+  /// converted one after the other, so the units they refer to are remembered
+  /// rather than looked up in the module for every instance.
+  Operation *lookupUnit(ModuleOp module, StringRef name) const {
+    auto &unit = units[name];
+    if (!unit)
+      unit = module.lookupSymbol(name);
+    return unit;
+  }
+
+  /// Return the type of the state of the specified unit, computing it with
+  /// `compute` the first time it is instantiated. The state types are built
+  /// by walking the whole unit, so they are not recomputed for every instance.
+  template <typename ComputeFn>
+  Type getStateType(Operation *unit, ComputeFn compute) const {
+    auto &type = stateTypes[unit];
+    if (!type)
+      type = compute();
+    return type;
+  }
+
+  mutable llvm::StringMap<Operation *> units;
+  mutable DenseMap<Operation *, Type> stateTypes;
 };
 } // namespace
 
@@ -13,8 +13,10 @@
 #include "../PassDetail.h"
 #include "circt/Dialect/Handshake/HandshakeOps.h"
 #include "circt/Dialect/StaticLogic/StaticLogic.h"
+#include "circt/Scheduling/Algorithms.h"
 #include "mlir/Analysis/AffineAnalysis.h"
 #include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/LoopAnalysis.h"
 #include "mlir/Conversion/AffineToStandard/AffineToStandard.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/Affine/IR/AffineValueMap.h"
@@ -29,9 +31,12 @@
 #include "mlir/IR/Value.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Support/LLVM.h"
+#include "mlir/Support/MathExtras.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "mlir/Transforms/LoopUtils.h"
 #include "mlir/Transforms/Passes.h"
 #include "mlir/Transforms/Utils.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/Support/raw_ostream.h"
 #include <map>
 
@@ -176,132 +181,100 @@ void setControlOnlyPath(handshake::FuncOp f,
   }
 }
 
-BlockValues getBlockUses(handshake::FuncOp f) {
-  // Returns map of values used in block but defined outside of block
-  // For liveness analysis
-  BlockValues uses;
-
-  for (Block &block : f) {
-
-    // Operands of operations in b which do not originate from operations or
-    // arguments of b
-    for (Operation &op : block) {
-      for (int i = 0, e = op.getNumOperands(); i < e; ++i) {
-
-        Block *operandBlock;
-
-        if (op.getOperand(i).isa<BlockArgument>()) {
-          // Operand is block argument, get its owner block
-          operandBlock = op.getOperand(i).cast<BlockArgument>().getOwner();
-        } else {
-          // Operand comes from operation, get the block of its defining op
-          auto *operand = op.getOperand(i).getDefiningOp();
-          assert(operand != NULL);
-          operandBlock = operand->getBlock();
-        }
-
-        // If operand defined in some other block, add to uses
-        if (operandBlock != &block)
-          // Add only unique uses
-          if (std::find(uses[&block].begin(), uses[&block].end(),
-                        op.getOperand(i)) == uses[&block].end())
-            uses[&block].push_back(op.getOperand(i));
-      }
-    }
-  }
-  return uses;
-}
-
-BlockValues getBlockDefs(handshake::FuncOp f) {
-  // Returns map of values defined in each block
-  // For liveness analysis
-  BlockValues defs;
-
-  for (Block &block : f) {
-
-    // Values produced by operations in b
-    for (Operation &op : block) {
-      if (op.getNumResults() > 0) {
-        for (auto result : op.getResults())
-          defs[&block].push_back(result);
-      }
-    }
-
-    // Argument values of b
-    for (auto &arg : block.getArguments())
-      defs[&block].push_back(arg);
-  }
-
-  return defs;
-}
-
-std::vector<Value> vectorUnion(std::vector<Value> v1, std::vector<Value> v2) {
-  // Returns v1 U v2
-  // Assumes unique values in v1
-
-  for (int i = 0, e = v2.size(); i < e; ++i) {
-    Value val = v2[i];
-    if (std::find(v1.begin(), v1.end(), val) == v1.end())
-      v1.push_back(val);
-  }
-  return v1;
-}
-
-std::vector<Value> vectorDiff(std::vector<Value> v1, std::vector<Value> v2) {
-  // Returns v1 - v2
-  std::vector<Value> d;
-
-  for (int i = 0, e = v1.size(); i < e; ++i) {
-    Value val = v1[i];
-    if (std::find(v2.begin(), v2.end(), val) == v2.end())
-      d.push_back(val);
-  }
-  return d;
-}
-
 BlockValues livenessAnalysis(handshake::FuncOp f) {
   // Liveness analysis algorithm adapted from:
   // https://suif.stanford.edu/~courses/cs243/lectures/l2.pdf
   // See slide 19 (Liveness: Iterative Algorithm)
+  //
+  // The live-ins of a block are listed with the values used in the block
+  // first, in the order they are used, followed by the values live into its
+  // successors that are not defined in the block.
 
-  // blockUses: values used in block but not defined in block
-  BlockValues blockUses = getBlockUses(f);
-
-  // blockDefs: values defined in block
-  BlockValues blockDefs = getBlockDefs(f);
-
-  BlockValues blockLiveIns;
-
-  bool change = true;
-  // Iterate while there are any changes to any of the livein sets
-  while (change) {
-    change = false;
+  // Number the values by block, such that the values defined in a block form a
+  // contiguous range of numbers.
+  std::vector<Block *> blocks;
+  DenseMap<Block *, unsigned> blockNumbers;
+  std::vector<Value> values;
+  DenseMap<Value, unsigned> valueNumbers;
+  std::vector<std::pair<unsigned, unsigned>> blockDefs;
+  auto getValueNumber = [&](Value val) {
+    auto it = valueNumbers.try_emplace(val, values.size());
+    if (it.second)
+      values.push_back(val);
+    return it.first->second;
+  };
+  for (Block &block : f) {
+    blockNumbers[&block] = blocks.size();
+    blocks.push_back(&block);
+    unsigned begin = values.size();
+    for (auto arg : block.getArguments())
+      getValueNumber(arg);
+    for (Operation &op : block)
+      for (auto result : op.getResults())
+        getValueNumber(result);
+    blockDefs.push_back({begin, values.size()});
+  }
+  auto isDefinedIn = [&](unsigned num, unsigned blockNum) {
+    return num >= blockDefs[blockNum].first &&
+           num < blockDefs[blockNum].second;
+  };
 
-    // liveOuts(b): all liveins of all successors of b
-    // liveOuts(b) = U (blockLiveIns(s)) forall successors s of b
-    for (Block &block : f) {
-      std::vector<Value> liveOuts;
-      for (int i = 0, e = block.getNumSuccessors(); i < e; ++i) {
-        Block *succ = block.getSuccessor(i);
-        liveOuts = vectorUnion(liveOuts, blockLiveIns[succ]);
+  // blockUses: values used in block but not defined in block
+  std::vector<std::vector<unsigned>> blockUses(blocks.size());
+  DenseSet<unsigned> blockUseSet;
+  for (unsigned i = 0, e = blocks.size(); i != e; ++i) {
+    blockUseSet.clear();
+    for (Operation &op : *blocks[i])
+      for (auto operand : op.getOperands()) {
+        auto num = getValueNumber(operand);
+        if (!isDefinedIn(num, i) && blockUseSet.insert(num).second)
+          blockUses[i].push_back(num);
       }
+  }
 
-      // diff(b):  liveouts of b which are not defined in b
-      // diff(b) = liveOuts(b) - blockDefs(b)
-      auto diff = vectorDiff(liveOuts, blockDefs[&block]);
-
-      // liveIns(b) = blockUses(b) U diff(b)
-      auto tmpLiveIns = vectorUnion(blockUses[&block], diff);
+  // Only the blocks whose successors have new live-ins since they were last
+  // visited can have new live-ins themselves.  The blocks are visited in order
+  // such that the live-ins are listed in a deterministic order.
+  std::vector<std::vector<unsigned>> blockLiveIns(blocks.size());
+  llvm::BitVector isDirty(blocks.size(), true);
+  llvm::BitVector isLiveIn(values.size());
+  std::vector<unsigned> liveIns;
+  while (isDirty.any()) {
+    for (unsigned i = 0, e = blocks.size(); i != e; ++i) {
+      if (!isDirty.test(i))
+        continue;
+      isDirty.reset(i);
+
+      // liveIns(b) = blockUses(b) U (liveOuts(b) - blockDefs(b)), where
+      // liveOuts(b) = U (blockLiveIns(s)) forall successors s of b
+      liveIns = blockUses[i];
+      for (auto num : liveIns)
+        isLiveIn.set(num);
+      for (auto *succ : blocks[i]->getSuccessors())
+        for (auto num : blockLiveIns[blockNumbers[succ]])
+          if (!isDefinedIn(num, i) && !isLiveIn.test(num)) {
+            isLiveIn.set(num);
+            liveIns.push_back(num);
+          }
+      for (auto num : liveIns)
+        isLiveIn.reset(num);
 
-      // Update blockLiveIns if new liveins found
-      if (tmpLiveIns.size() > blockLiveIns[&block].size()) {
-        blockLiveIns[&block] = tmpLiveIns;
-        change = true;
-      }
+      // Update blockLiveIns if new liveins found, and revisit the predecessors
+      if (liveIns.size() <= blockLiveIns[i].size())
+        continue;
+      std::swap(blockLiveIns[i], liveIns);
+      for (auto *pred : blocks[i]->getPredecessors())
+        isDirty.set(blockNumbers[pred]);
     }
   }
 
-  return blockLiveIns;
+  BlockValues result;
+  for (unsigned i = 0, e = blocks.size(); i != e; ++i) {
+    auto &blockValues = result[blocks[i]];
+    for (auto num : blockLiveIns[i])
+      blockValues.push_back(values[num]);
+  }
+  return result;
 }
 
 unsigned getBlockPredecessorCount(Block *block) {
@@ -726,6 +699,68 @@ void addForkOps(handshake::FuncOp f, OpBuilder &rewriter) {
   }
 }
 
+/// Collect the uses of the results of a tree of forks rooted at `fork`, in the
+/// order of the results, except the uses by other forks and sinks. These forks
+/// and sinks are collected into `treeOps`.
+static void collectForkTreeUses(ForkOp fork, SmallVectorImpl<OpOperand *> &uses,
+                                SmallVectorImpl<Operation *> &treeOps) {
+  treeOps.push_back(fork);
+  for (auto result : fork.getResults()) {
+    for (auto &use : result.getUses()) {
+      Operation *user = use.getOwner();
+      if (auto nestedFork = dyn_cast<ForkOp>(user))
+        collectForkTreeUses(nestedFork, uses, treeOps);
+      else if (isa<SinkOp>(user))
+        treeOps.push_back(user);
+      else
+        uses.push_back(&use);
+    }
+  }
+}
+
+// Replace every tree of chained forks by a single fork, dropping the outputs
+// which are only sunk. This visits every fork once, instead of rewriting them
+// one by one through the pattern driver.
+void simplifyForks(handshake::FuncOp f, OpBuilder &rewriter) {
+  SmallVector<ForkOp, 16> roots;
+  for (Block &block : f)
+    for (auto fork : block.getOps<ForkOp>())
+      if (!fork->getOperand(0).getDefiningOp<ForkOp>())
+        roots.push_back(fork);
+
+  SmallVector<OpOperand *, 16> uses;
+  SmallVector<Operation *, 16> treeOps;
+  for (auto root : roots) {
+    uses.clear();
+    treeOps.clear();
+    collectForkTreeUses(root, uses, treeOps);
+
+    // Leave the forks which can't be simplified untouched.
+    if (treeOps.size() == 1 && uses.size() > 1 &&
+        llvm::all_of(root.getResults(),
+                     [](Value result) { return result.hasOneUse(); }))
+      continue;
+
+    Value operand = root->getOperand(0);
+    rewriter.setInsertionPoint(root);
+    if (uses.empty()) {
+      rewriter.create<SinkOp>(root.getLoc(), operand);
+    } else if (uses.size() == 1) {
+      uses.front()->set(operand);
+    } else {
+      auto newFork =
+          rewriter.create<ForkOp>(root.getLoc(), operand, uses.size());
+      for (auto use : llvm::enumerate(uses))
+        use.value()->set(newFork.getResult(use.index()));
+    }
+
+    for (auto *op : treeOps)
+      op->dropAllReferences();
+    for (auto *op : treeOps)
+      op->erase();
+  }
+}
+
 void checkUseCount(Operation *op, Value res) {
   // Checks if every result has single use
   if (!res.hasOneUse()) {
@@ -1285,6 +1320,285 @@ void replaceCallOps(handshake::FuncOp f, ConversionPatternRewriter &rewriter) {
   }
 }
 
+/// Unroll the affine loops with a constant trip count by the given factor, and
+/// fold the affine.apply operations computing the induction variables of the
+/// unrolled iterations into the affine accesses using them. The remaining ones
+/// are expanded into standard arithmetic.
+static void unrollAffineLoops(mlir::FuncOp f, unsigned unrollFactor) {
+  SmallVector<mlir::AffineForOp, 8> forOps;
+  f.walk([&](mlir::AffineForOp op) { forOps.push_back(op); });
+  for (auto forOp : forOps)
+    if (mlir::getConstantTripCount(forOp))
+      (void)loopUnrollByFactor(forOp, unrollFactor);
+
+  f.walk([&](Operation *op) {
+    unsigned numPrefixOperands;
+    AffineMap map;
+    if (auto loadOp = dyn_cast<mlir::AffineLoadOp>(op)) {
+      numPrefixOperands = loadOp.getMemRefOperandIndex() + 1;
+      map = loadOp.getAffineMap();
+    } else if (auto storeOp = dyn_cast<mlir::AffineStoreOp>(op)) {
+      numPrefixOperands = storeOp.getMemRefOperandIndex() + 1;
+      map = storeOp.getAffineMap();
+    } else {
+      return;
+    }
+    SmallVector<Value, 8> mapOperands(
+        op->getOperands().drop_front(numPrefixOperands));
+    fullyComposeAffineMapAndOperands(&map, &mapOperands);
+    canonicalizeMapAndOperands(&map, &mapOperands);
+
+    SmallVector<Value, 8> operands(
+        op->getOperands().take_front(numPrefixOperands));
+    operands.append(mapOperands.begin(), mapOperands.end());
+    op->setOperands(operands);
+    op->setAttr(mlir::AffineLoadOp::getMapAttrName(), AffineMapAttr::get(map));
+  });
+
+  SmallVector<mlir::AffineApplyOp, 8> applyOps;
+  f.walk([&](mlir::AffineApplyOp op) { applyOps.push_back(op); });
+  for (auto applyOp : applyOps) {
+    if (!applyOp->use_empty()) {
+      OpBuilder builder(applyOp);
+      auto expanded = expandAffineMap(builder, applyOp.getLoc(),
+                                      applyOp.getAffineMap(),
+                                      applyOp.getMapOperands());
+      assert(expanded && "affine.apply cannot be expanded");
+      applyOp.getResult().replaceAllUsesWith((*expanded)[0]);
+    }
+    applyOp.erase();
+  }
+}
+
+/// Return the range of values of an affine expression over the iterations of
+/// the affine loops it depends on, if it is bounded.
+static Optional<std::pair<int64_t, int64_t>>
+getAffineExprRange(AffineExpr expr, ValueRange dims, ValueRange symbols) {
+  using Range = std::pair<int64_t, int64_t>;
+  auto getOperandRange = [](Value operand) -> Optional<Range> {
+    if (auto constantOp = operand.getDefiningOp<mlir::ConstantIndexOp>())
+      return Range(constantOp.getValue(), constantOp.getValue());
+    auto forOp = mlir::getForInductionVarOwner(operand);
+    if (!forOp || !forOp.hasConstantBounds() ||
+        forOp.getConstantLowerBound() >= forOp.getConstantUpperBound())
+      return llvm::None;
+    return Range(forOp.getConstantLowerBound(),
+                 forOp.getConstantUpperBound() - 1);
+  };
+
+  switch (expr.getKind()) {
+  case AffineExprKind::Constant: {
+    auto value = expr.cast<AffineConstantExpr>().getValue();
+    return Range(value, value);
+  }
+  case AffineExprKind::DimId:
+    return getOperandRange(dims[expr.cast<AffineDimExpr>().getPosition()]);
+  case AffineExprKind::SymbolId:
+    return getOperandRange(
+        symbols[expr.cast<AffineSymbolExpr>().getPosition()]);
+  default:
+    break;
+  }
+
+  auto binaryExpr = expr.cast<AffineBinaryOpExpr>();
+  auto lhs = getAffineExprRange(binaryExpr.getLHS(), dims, symbols);
+  auto rhs = getAffineExprRange(binaryExpr.getRHS(), dims, symbols);
+  if (!lhs || !rhs)
+    return llvm::None;
+  switch (expr.getKind()) {
+  case AffineExprKind::Add:
+    return Range(lhs->first + rhs->first, lhs->second + rhs->second);
+  case AffineExprKind::Mul: {
+    int64_t products[] = {lhs->first * rhs->first, lhs->first * rhs->second,
+                          lhs->second * rhs->first, lhs->second * rhs->second};
+    return Range(*std::min_element(std::begin(products), std::end(products)),
+                 *std::max_element(std::begin(products), std::end(products)));
+  }
+  case AffineExprKind::FloorDiv:
+    if (rhs->first != rhs->second || rhs->first <= 0)
+      return llvm::None;
+    return Range(mlir::floorDiv(lhs->first, rhs->first),
+                 mlir::floorDiv(lhs->second, rhs->first));
+  case AffineExprKind::Mod:
+    if (rhs->first != rhs->second || rhs->first <= 0)
+      return llvm::None;
+    if (mlir::floorDiv(lhs->first, rhs->first) !=
+        mlir::floorDiv(lhs->second, rhs->first))
+      return Range(0, rhs->first - 1);
+    return Range(mlir::mod(lhs->first, rhs->first),
+                 mlir::mod(lhs->second, rhs->first));
+  default:
+    return llvm::None;
+  }
+}
+
+/// Replace each dimension of an affine expression that is the induction
+/// variable of a loop with a constant lower bound by its value in terms of the
+/// iteration number of the loop.
+static AffineExpr substituteLoopIterations(AffineExpr expr, ValueRange dims,
+                                           unsigned numSymbols) {
+  auto *context = expr.getContext();
+  SmallVector<AffineExpr, 4> dimReplacements;
+  for (auto dim : llvm::enumerate(dims)) {
+    auto replacement = getAffineDimExpr(dim.index(), context);
+    auto forOp = mlir::getForInductionVarOwner(dim.value());
+    if (forOp && forOp.hasConstantLowerBound())
+      replacement =
+          replacement * forOp.getStep() + forOp.getConstantLowerBound();
+    dimReplacements.push_back(replacement);
+  }
+  SmallVector<AffineExpr, 4> symbolReplacements;
+  for (unsigned i = 0; i < numSymbols; ++i)
+    symbolReplacements.push_back(getAffineSymbolExpr(i, context));
+  return expr.replaceDimsAndSymbols(dimReplacements, symbolReplacements);
+}
+
+namespace {
+/// An affine access to a partitioned memref, with the bank it always reaches
+/// and the map of its indices within that bank.
+struct BankedAccess {
+  Operation *op;
+  unsigned memRefOperandIndex;
+  unsigned bank;
+  AffineMap map;
+};
+} // namespace
+
+/// Assign each of the affine accesses of a memref to one of `numBanks` banks
+/// partitioning the last dimension of the memref, either cyclically or in
+/// contiguous blocks. Fails if an access can reach more than one bank, or if
+/// all the accesses reach the same bank.
+static LogicalResult getBankedAccesses(ArrayRef<Operation *> accesses,
+                                       int64_t dimSize, unsigned numBanks,
+                                       bool cyclic,
+                                       SmallVectorImpl<BankedAccess> &result) {
+  result.clear();
+  int64_t blockSize = dimSize / numBanks;
+  llvm::SmallDenseSet<unsigned, 4> usedBanks;
+  for (auto *op : accesses) {
+    AffineMap map;
+    ValueRange mapOperands;
+    unsigned memRefOperandIndex;
+    if (auto loadOp = dyn_cast<mlir::AffineLoadOp>(op)) {
+      map = loadOp.getAffineMap();
+      mapOperands = loadOp.getMapOperands();
+      memRefOperandIndex = loadOp.getMemRefOperandIndex();
+    } else {
+      auto storeOp = cast<mlir::AffineStoreOp>(op);
+      map = storeOp.getAffineMap();
+      mapOperands = storeOp.getMapOperands();
+      memRefOperandIndex = storeOp.getMemRefOperandIndex();
+    }
+
+    unsigned numDims = map.getNumDims();
+    unsigned numSymbols = map.getNumSymbols();
+    auto index = map.getResults().back();
+    auto dims = mapOperands.take_front(numDims);
+    auto bankExpr = simplifyAffineExpr(
+        cyclic ? index % numBanks : index.floorDiv(blockSize), numDims,
+        numSymbols);
+    auto bankRange =
+        getAffineExprRange(bankExpr, dims, mapOperands.drop_front(numDims));
+
+    // The range of an induction variable does not capture the step of its
+    // loop, which can make the bank of a cyclic partitioning constant.
+    if (cyclic) {
+      auto iterationBankExpr = simplifyAffineExpr(
+          substituteLoopIterations(index, dims, numSymbols) % numBanks,
+          numDims, numSymbols);
+      if (auto constant = iterationBankExpr.dyn_cast<AffineConstantExpr>())
+        bankRange = std::make_pair(constant.getValue(), constant.getValue());
+    }
+    if (!bankRange || bankRange->first != bankRange->second ||
+        bankRange->first < 0 || bankRange->first >= (int64_t)numBanks)
+      return failure();
+    unsigned bank = bankRange->first;
+    usedBanks.insert(bank);
+
+    auto bankIndex = simplifyAffineExpr(
+        cyclic ? index.floorDiv(numBanks) : index - bank * blockSize, numDims,
+        numSymbols);
+    SmallVector<AffineExpr, 4> results(map.getResults().drop_back());
+    results.push_back(bankIndex);
+    result.push_back({op, memRefOperandIndex, bank,
+                      AffineMap::get(numDims, numSymbols, results,
+                                     map.getContext())});
+  }
+  return success(usedBanks.size() > 1);
+}
+
+/// Partition the local memrefs whose affine accesses each reach a single bank
+/// into separate memrefs, one per bank, such that they are lowered to separate
+/// memories and the accesses to different banks are not serialized. Up to
+/// `maxBanks` banks are used, trying cyclic partitioning before block
+/// partitioning for each number of banks. This has to run before the affine
+/// loops are rewritten, since the bank of an access is derived from the bounds
+/// of the loops.
+static void partitionMemRefs(handshake::FuncOp f, unsigned maxBanks,
+                             ConversionPatternRewriter &rewriter) {
+  if (maxBanks < 2)
+    return;
+
+  SmallVector<memref::AllocOp, 4> allocOps;
+  f.walk([&](memref::AllocOp op) { allocOps.push_back(op); });
+  for (auto allocOp : allocOps) {
+    auto type = allocOp.getType();
+    if (!type.hasStaticShape() || type.getRank() == 0 ||
+        !type.getAffineMaps().empty())
+      continue;
+
+    // The memref can only be partitioned if it is only used by affine loads
+    // and stores.
+    SmallVector<Operation *, 8> accesses;
+    bool onlyAffineAccesses =
+        llvm::all_of(allocOp->getUses(), [&](OpOperand &use) {
+          auto *user = use.getOwner();
+          accesses.push_back(user);
+          if (auto loadOp = dyn_cast<mlir::AffineLoadOp>(user))
+            return use.getOperandNumber() == loadOp.getMemRefOperandIndex();
+          if (auto storeOp = dyn_cast<mlir::AffineStoreOp>(user))
+            return use.getOperandNumber() == storeOp.getMemRefOperandIndex();
+          return false;
+        });
+    if (!onlyAffineAccesses || accesses.empty())
+      continue;
+
+    int64_t dimSize = type.getShape().back();
+    SmallVector<BankedAccess, 8> bankedAccesses;
+    unsigned numBanks = maxBanks;
+    for (; numBanks > 1; --numBanks) {
+      if (dimSize % numBanks != 0)
+        continue;
+      if (succeeded(getBankedAccesses(accesses, dimSize, numBanks,
+                                      /*cyclic=*/true, bankedAccesses)) ||
+          succeeded(getBankedAccesses(accesses, dimSize, numBanks,
+                                      /*cyclic=*/false, bankedAccesses)))
+        break;
+    }
+    if (numBanks < 2)
+      continue;
+
+    // Allocate the banks that are accessed next to the original memref, which
+    // is left unused and removed with the other unused allocations.
+    SmallVector<int64_t, 4> bankShape(type.getShape().begin(),
+                                      type.getShape().end());
+    bankShape.back() /= numBanks;
+    MemRefType bankType = MemRefType::Builder(type).setShape(bankShape);
+    SmallVector<Value, 4> banks(numBanks);
+    rewriter.setInsertionPointAfter(allocOp);
+    for (auto &access : bankedAccesses) {
+      auto &bank = banks[access.bank];
+      if (!bank)
+        bank = rewriter.create<memref::AllocOp>(allocOp.getLoc(), bankType);
+      rewriter.updateRootInPlace(access.op, [&] {
+        access.op->setOperand(access.memRefOperandIndex, bank);
+        access.op->setAttr(mlir::AffineLoadOp::getMapAttrName(),
+                           AffineMapAttr::get(access.map));
+      });
+    }
+  }
+}
+
 /// Rewrite affine.for operations in a handshake.func into its representations
 /// as a CFG in the standard dialect. Affine expressions in loop bounds will be
 /// expanded to code in the standard dialect that actually computes them. We
@@ -1418,7 +1732,10 @@ struct HandshakeCanonicalizePattern : public ConversionPattern {
 };
 
 struct FuncOpLowering : public OpConversionPattern<mlir::FuncOp> {
-  using OpConversionPattern<mlir::FuncOp>::OpConversionPattern;
+  FuncOpLowering(MLIRContext *context, unsigned maxMemoryBanks)
+      : OpConversionPattern<mlir::FuncOp>(context),
+        maxMemoryBanks(maxMemoryBanks) {}
+
   LogicalResult
   matchAndRewrite(mlir::FuncOp funcOp, ArrayRef<Value> operands,
                   ConversionPatternRewriter &rewriter) const override {
@@ -1463,6 +1780,10 @@ struct FuncOpLowering : public OpConversionPattern<mlir::FuncOp> {
     rewriter.inlineRegionBefore(funcOp.getBody(), newFuncOp.getBody(),
                                 newFuncOp.end());
 
+    // Partition local memrefs into banks while the affine loops still carry
+    // the bounds of their induction variables.
+    partitionMemRefs(newFuncOp, maxMemoryBanks, rewriter);
+
     // Rewrite affine.for operations.
     if (failed(rewriteAffineFor(newFuncOp, rewriter)))
       return newFuncOp.emitOpError("failed to rewrite Affine loops");
@@ -1505,6 +1826,10 @@ struct FuncOpLowering : public OpConversionPattern<mlir::FuncOp> {
 
     return success();
   }
+
+private:
+  /// The maximum number of banks a local memref is partitioned into.
+  unsigned maxMemoryBanks;
 };
 
 namespace {
@@ -1540,6 +1865,105 @@ struct HandshakeInsertBufferPass
                               });
   }
 
+  // Schedule the function and give every channel enough slots to absorb the
+  // slack between its producer and its consumer, such that reconvergent paths
+  // of different latencies do not stall the function below the initiation
+  // interval of its cycles.
+  void bufferThroughputStrategy() {
+    // Every cycle needs a sequential buffer for the schedule to exist.
+    bufferCyclesStrategy();
+
+    // Sequential buffers take one cycle, all the other operations are
+    // considered combinational.
+    auto f = getOperation();
+    auto &body = f.getBody().front();
+    scheduling::CyclicProblem prob(f);
+    auto combType = prob.getOrInsertOperatorType("comb");
+    auto seqType = prob.getOrInsertOperatorType("seq");
+    prob.setLatency(combType, 0);
+    prob.setLatency(seqType, 1);
+    for (auto &op : body) {
+      prob.insertOperation(&op);
+      auto buffer = dyn_cast<handshake::BufferOp>(op);
+      prob.setLinkedOperatorType(
+          &op, buffer && buffer.isSequential() ? seqType : combType);
+    }
+
+    // Each cycle contains a back edge of a depth first search, which carries
+    // the tokens of the cycle into the next iteration.
+    DenseSet<OpOperand *> backEdges;
+    DenseSet<Operation *> opVisited;
+    DenseSet<Operation *> opInFlight;
+    for (auto &op : body)
+      if (opVisited.count(&op) == 0)
+        collectBackEdgesDFS(&op, backEdges, opVisited, opInFlight);
+    for (auto *operand : backEdges)
+      prob.setDistance(operand, 1);
+
+    if (failed(prob.check()) ||
+        failed(scheduleSimplex(prob, body.getTerminator()))) {
+      emitError(f.getLoc()) << "Failed to schedule function for buffering";
+      signalPassFailure();
+      return;
+    }
+
+    auto builder = OpBuilder(f.getContext());
+    unsigned ii = *prob.getInitiationInterval();
+    SmallVector<Operation *, 32> ops;
+    for (auto &op : body)
+      ops.push_back(&op);
+    for (auto *op : ops) {
+      for (auto &operand : op->getOpOperands()) {
+        // Function arguments are available at the start of the schedule.
+        auto value = operand.get();
+        auto *definingOp = value.getDefiningOp();
+        unsigned ready = 0;
+        if (definingOp) {
+          if (!prob.hasOperation(definingOp))
+            continue;
+          ready = *prob.getStartTime(definingOp) +
+                  *prob.getLatency(*prob.getLinkedOperatorType(definingOp));
+        }
+        unsigned start = *prob.getStartTime(op);
+        if (backEdges.count(&operand))
+          start += ii;
+        if (start <= ready)
+          continue;
+
+        // A token waits `start - ready` cycles on the channel, during which a
+        // new token arrives every II cycles.
+        unsigned numSlots = (start - ready + ii - 1) / ii;
+        auto buffer = dyn_cast_or_null<handshake::BufferOp>(definingOp);
+        if (buffer && value.hasOneUse()) {
+          numSlots += buffer.getNumSlots().getZExtValue();
+          buffer->setAttr("slots", builder.getI32IntegerAttr(numSlots));
+          continue;
+        }
+        builder.setInsertionPoint(op);
+        auto newBuffer = builder.create<handshake::BufferOp>(
+            value.getLoc(), value.getType(), value, /*sequential=*/false,
+            /*control=*/value.getType().isa<NoneType>(),
+            /*slots=*/numSlots);
+        operand.set(newBuffer);
+      }
+    }
+  }
+
+  void collectBackEdgesDFS(Operation *op, DenseSet<OpOperand *> &backEdges,
+                           DenseSet<Operation *> &opVisited,
+                           DenseSet<Operation *> &opInFlight) {
+    opVisited.insert(op);
+    opInFlight.insert(op);
+    for (auto &operand : op->getUses()) {
+      auto *user = operand.getOwner();
+      if (opInFlight.count(user) != 0)
+        backEdges.insert(&operand);
+      else if (opVisited.count(user) == 0)
+        collectBackEdgesDFS(user, backEdges, opVisited, opInFlight);
+    }
+    opInFlight.erase(op);
+  }
+
   /// DFS-based graph cycle detection and naive buffer insertion. Exactly one
   /// 2-slot non-transparent buffer will be inserted into each graph cycle.
   void insertBufferDFS(Operation *op, OpBuilder &builder,
@@ -1606,6 +2030,8 @@ struct HandshakeInsertBufferPass
         bufferCyclesStrategy();
       else if (strategy == "all")
         bufferAllStrategy();
+      else if (strategy == "throughput")
+        bufferThroughputStrategy();
       else {
         emitError(getOperation().getLoc())
             << "Unknown buffer strategy: " << strategy;
@@ -1629,8 +2055,14 @@ struct HandshakeDataflowPass
     ConversionTarget target(getContext());
     target.addLegalDialect<HandshakeOpsDialect, StandardOpsDialect>();
 
+    // Unroll the loops before the conversion, such that the partitioning of
+    // the memrefs sees the accesses of all the unrolled iterations.
+    if (loopUnrollFactor > 1)
+      for (auto f : m.getOps<mlir::FuncOp>())
+        unrollAffineLoops(f, loopUnrollFactor);
+
     RewritePatternSet patterns(&getContext());
-    patterns.insert<FuncOpLowering>(m.getContext());
+    patterns.insert<FuncOpLowering>(m.getContext(), maxMemoryBanks);
 
     if (failed(applyPartialConversion(m, target, std::move(patterns))))
       signalPassFailure();
@@ -1648,6 +2080,7 @@ struct HandshakeCanonicalizePass
     OpBuilder builder(Op);
     addForkOps(Op, builder);
     addSinkOps(Op, builder);
+    simplifyForks(Op, builder);
 
     for (auto &block : Op)
       for (auto &nestedOp : block)
@@ -13,6 +13,7 @@
 #include "circt/Conversion/StandardToStaticLogic/StandardToStaticLogic.h"
 #include "../PassDetail.h"
 #include "circt/Dialect/StaticLogic/StaticLogic.h"
+#include "circt/Scheduling/Algorithms.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 
 using namespace circt;
@@ -122,3 +123,117 @@ struct CreatePipelinePass : public CreatePipelineBase<CreatePipelinePass> {
 std::unique_ptr<mlir::Pass> circt::createCreatePipelinePass() {
   return std::make_unique<CreatePipelinePass>();
 }
+
+/// Schedule the operations of a single-block pipeline, and split its body into
+/// one block per stage. Every operation takes one cycle, except constants,
+/// which are not registered and stay in the first stage. A stage branches to
+/// the next one, and the arguments of a stage block are the registers holding
+/// the values used in that stage or a later one.
+static LogicalResult schedulePipeline(PipelineOp pipeline) {
+  auto &region = pipeline.getRegion();
+  if (!llvm::hasSingleElement(region))
+    return success();
+  auto &body = region.front();
+  auto *terminator = body.getTerminator();
+
+  scheduling::Problem problem(pipeline);
+  auto stageType = problem.getOrInsertOperatorType("stage");
+  problem.setLatency(stageType, 1);
+  auto returnType = problem.getOrInsertOperatorType("return");
+  problem.setLatency(returnType, 0);
+  for (auto &op : body) {
+    if (isa<mlir::ConstantOp>(op))
+      continue;
+    problem.insertOperation(&op);
+    problem.setLinkedOperatorType(&op,
+                                  &op == terminator ? returnType : stageType);
+  }
+
+  // The terminator ends the last stage, so every operation has to finish
+  // before it, including those whose results do not reach it.
+  for (auto &op : body)
+    if (&op != terminator && problem.hasOperation(&op))
+      (void)problem.insertDependence(std::make_pair(&op, terminator));
+
+  if (failed(problem.check()) ||
+      failed(scheduling::scheduleSimplex(problem, terminator)))
+    return pipeline.emitError("failed to schedule pipeline");
+
+  unsigned numStages = *problem.getStartTime(terminator) + 1;
+  if (numStages == 1)
+    return success();
+
+  // Create the stage blocks and move the operations into them, in order.
+  SmallVector<Block *, 4> stages = {&body};
+  DenseMap<Block *, unsigned> stageIndices = {{&body, 0}};
+  for (unsigned i = 1; i < numStages; ++i) {
+    auto *stage = new Block();
+    region.push_back(stage);
+    stageIndices[stage] = i;
+    stages.push_back(stage);
+  }
+  for (auto &op : llvm::make_early_inc_range(body)) {
+    if (!problem.hasOperation(&op))
+      continue;
+    unsigned stage = *problem.getStartTime(&op);
+    if (stage != 0)
+      op.moveBefore(stages[stage], stages[stage]->end());
+  }
+
+  auto getStage = [&](Operation *op) {
+    while (op->getParentRegion() != &region)
+      op = op->getParentOp();
+    return stageIndices.lookup(op->getBlock());
+  };
+
+  // Forward every value from the stage that defines it to the stages that use
+  // it, through one register per stage boundary.
+  SmallVector<SmallVector<Value, 4>, 4> stageOperands(numStages - 1);
+  auto forwardValue = [&](Value value, unsigned defStage) {
+    unsigned lastStage = defStage;
+    for (auto *user : value.getUsers())
+      lastStage = std::max(lastStage, getStage(user));
+
+    SmallVector<Value, 4> versions = {value};
+    for (unsigned stage = defStage + 1; stage <= lastStage; ++stage) {
+      stageOperands[stage - 1].push_back(versions.back());
+      versions.push_back(stages[stage]->addArgument(value.getType()));
+    }
+    for (auto &use : llvm::make_early_inc_range(value.getUses()))
+      use.set(versions[getStage(use.getOwner()) - defStage]);
+  };
+  for (auto arg : body.getArguments())
+    forwardValue(arg, 0);
+  for (unsigned i = 0; i < numStages; ++i)
+    for (auto &op : stages[i]->getOperations())
+      if (problem.hasOperation(&op))
+        for (auto result : op.getResults())
+          forwardValue(result, i);
+
+  // Chain the stages.
+  auto builder = OpBuilder(pipeline.getContext());
+  for (unsigned i = 0; i < numStages - 1; ++i) {
+    builder.setInsertionPointToEnd(stages[i]);
+    builder.create<mlir::BranchOp>(pipeline.getLoc(), stages[i + 1],
+                                   stageOperands[i]);
+  }
+  return success();
+}
+
+namespace {
+
+struct SchedulePipelinePass
+    : public SchedulePipelineBase<SchedulePipelinePass> {
+  void runOnOperation() override {
+    getOperation().walk([&](PipelineOp pipeline) {
+      if (failed(schedulePipeline(pipeline)))
+        signalPassFailure();
+    });
+  }
+};
+
+} // namespace
+
+std::unique_ptr<mlir::Pass> circt::createSchedulePipelinePass() {
+  return std::make_unique<SchedulePipelinePass>();
+}
@@ -128,7 +128,7 @@ LogicalResult calyx::verifyControlLikeOp(Operation *op) {
   auto parent = op->getParentOp();
   // Operations that may parent other ControlLike operations.
   auto isValidParent = [](Operation *operation) {
-    return isa<ControlOp, SeqOp, IfOp, WhileOp>(operation);
+    return isa<ControlOp, SeqOp, ParOp, IfOp, WhileOp>(operation);
   };
   if (!isValidParent(parent))
     return op->emitOpError()
@@ -141,7 +141,7 @@ LogicalResult calyx::verifyControlLikeOp(Operation *op) {
   auto &region = op->getRegion(0);
   // Operations that are allowed in the body of a ControlLike op.
   auto isValidBodyOp = [](Operation *operation) {
-    return isa<EnableOp, SeqOp, IfOp, WhileOp>(operation);
+    return isa<EnableOp, SeqOp, ParOp, IfOp, WhileOp>(operation);
   };
   for (auto &&bodyOp : region.front()) {
     if (isValidBodyOp(&bodyOp))
@@ -515,8 +515,8 @@ static LogicalResult verifyWiresOp(WiresOp wires) {
 //===----------------------------------------------------------------------===//
 GroupGoOp GroupOp::getGoOp() {
   auto body = this->getBody();
-  auto opIt = body->getOps<GroupGoOp>().begin();
-  return *opIt;
+  auto goOps = body->getOps<GroupGoOp>();
+  return goOps.empty() ? GroupGoOp() : *goOps.begin();
 }
 
 GroupDoneOp GroupOp::getDoneOp() {
@@ -524,6 +524,13 @@ GroupDoneOp GroupOp::getDoneOp() {
   return cast<GroupDoneOp>(body->getTerminator());
 }
 
+Optional<uint64_t> GroupOp::getStaticLatency() {
+  auto latency = (*this)->getAttrOfType<IntegerAttr>("static");
+  if (!latency)
+    return None;
+  return latency.getValue().getZExtValue();
+}
+
 //===----------------------------------------------------------------------===//
 // Utilities for operations with the Cell trait.
 //===----------------------------------------------------------------------===//
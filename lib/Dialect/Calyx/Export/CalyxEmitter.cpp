@@ -17,8 +17,12 @@
 #include "circt/Support/LLVM.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Translation.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <atomic>
 
 using namespace circt;
 using namespace calyx;
@@ -43,7 +47,7 @@ struct Emitter {
   }
 
   // Program emission
-  void emitProgram(ProgramOp op);
+  void emitProgramBodyOp(Operation *op);
 
   // Component emission
   void emitComponent(ComponentOp op);
@@ -137,14 +141,12 @@ private:
 
 LogicalResult Emitter::finalize() { return failure(encounteredError); }
 
-/// Emit an entire program.
-void Emitter::emitProgram(ProgramOp op) {
-  for (auto &bodyOp : *op.getBody()) {
-    if (auto componentOp = dyn_cast<ComponentOp>(bodyOp))
-      emitComponent(componentOp);
-    else
-      emitOpError(&bodyOp, "Unexpected op");
-  }
+/// Emit an operation in the body of a program.
+void Emitter::emitProgramBodyOp(Operation *op) {
+  if (auto componentOp = dyn_cast<ComponentOp>(op))
+    emitComponent(componentOp);
+  else
+    emitOpError(op, "Unexpected op");
 }
 
 /// Emit a component.
@@ -264,12 +266,44 @@ void Emitter::emitControl(ControlOp op) {
 // Emit the specified Calyx circuit into the given output stream.
 mlir::LogicalResult circt::calyx::exportCalyx(mlir::ModuleOp module,
                                               llvm::raw_ostream &os) {
-  Emitter emitter(os);
-  for (auto &op : *module.getBody()) {
-    if (auto programOp = dyn_cast<ProgramOp>(op))
-      emitter.emitProgram(programOp);
+  SmallVector<Operation *, 0> ops;
+  for (auto programOp : module.getOps<ProgramOp>())
+    for (auto &op : *programOp.getBody())
+      ops.push_back(&op);
+
+  // Emit each component into its own buffer, in parallel if the context
+  // enables it. Components are emitted without indentation and don't share any
+  // state, so this produces the same output as emitting them serially.
+  std::vector<std::string> buffers(ops.size());
+  std::atomic<bool> encounteredError(false);
+  mlir::parallelForEachN(module.getContext(), 0, ops.size(), [&](size_t i) {
+    llvm::raw_string_ostream bufferOS(buffers[i]);
+    Emitter emitter(bufferOS);
+    emitter.emitProgramBodyOp(ops[i]);
+    if (failed(emitter.finalize()))
+      encounteredError = true;
+  });
+
+  // Write out the buffers in order, releasing each one once it is written.
+  for (auto &buffer : buffers) {
+    os << buffer;
+    std::string().swap(buffer);
+  }
+  return failure(encounteredError);
+}
+
+mlir::LogicalResult circt::calyx::exportCalyx(mlir::ModuleOp module, int fd) {
+  // The components are complete once they are written, so the stream doesn't
+  // need to copy them into a buffer of its own.
+  llvm::raw_fd_ostream os(fd, /*shouldClose=*/false, /*unbuffered=*/true);
+  auto result = exportCalyx(module, os);
+  if (os.has_error()) {
+    auto error = os.error();
+    os.clear_error();
+    return module.emitError("cannot write the Calyx output: ")
+           << error.message();
   }
-  return emitter.finalize();
+  return result;
 }
 
 void circt::calyx::registerToCalyxTranslation() {
@@ -17,6 +17,7 @@
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/OperationSupport.h"
 #include "mlir/IR/PatternMatch.h"
+#include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/TypeSwitch.h"
 
 using namespace circt;
@@ -49,25 +50,233 @@ static RegisterOp createRegister(OpBuilder &builder, ComponentOp &component,
                                     StringAttr::get(context, name), width);
 }
 
+/// Returns the value of the done signal of `group`, i.e. its source and
+/// guard combined.
+static Value getDoneValue(OpBuilder &builder, Location loc, GroupOp group) {
+  // TODO(Calyx): Eventually, we should canonicalize the GroupDoneOp's guard
+  // and source.
+  auto guard = group.getDoneOp().guard();
+  auto source = group.getDoneOp().src();
+  if (!guard)
+    return source;
+  return builder.create<comb::AndOp>(loc, guard, source);
+}
+
+/// Creates an empty compilation group at the end of the wires of
+/// `component`, with a unique name derived from `name`.
+static GroupOp createGroup(OpBuilder &builder, ComponentOp &component,
+                           SymbolTable &symTable, StringRef name) {
+  auto wires = component.getWiresOp();
+  builder.setInsertionPointToEnd(wires.getBody());
+  auto group =
+      builder.create<GroupOp>(wires->getLoc(), builder.getStringAttr(name));
+  group->getRegion(0).push_back(new Block());
+
+  // Guarantees a unique SymbolName for the group.
+  symTable.insert(group);
+  return group;
+}
+
+/// Returns the EnableOp of `region` if it is the only operation of the region.
+static EnableOp getSingleEnable(Region &region) {
+  auto &ops = region.front().getOperations();
+  if (ops.size() != 1)
+    return {};
+  return dyn_cast<EnableOp>(ops.front());
+}
+
+/// Replaces the control statement `op` with an EnableOp of the compilation
+/// group `group`.
+static void replaceWithEnable(OpBuilder &builder, Operation *op,
+                              GroupOp group,
+                              ArrayRef<Attribute> compiledGroups) {
+  builder.setInsertionPoint(op);
+  builder.create<EnableOp>(
+      op->getLoc(), group.sym_name(),
+      ArrayAttr::get(builder.getContext(), compiledGroups));
+  op->erase();
+}
+
+namespace {
+
+/// The encodings of the states of an FSM register.
+enum class FSMEncoding { Binary, OneHot };
+
+/// The state register of the FSM realizing a control statement. Registers
+/// reset to zero, so the one-hot encoding keeps the initial state as all zeros
+/// and gives each of the other states its own bit.
+class FSMRegister {
+public:
+  FSMRegister(OpBuilder &builder, ComponentOp &component, size_t numStates,
+              FSMEncoding encoding);
+
+  /// Returns a constant holding the encoding of `state`.
+  Value createState(OpBuilder &builder, Location loc, size_t state) const;
+
+  /// Returns whether the FSM is in `state`. Binary encoded states are compared
+  /// with `stateConstant` when it is given.
+  Value createIsState(OpBuilder &builder, Location loc, size_t state,
+                      Value stateConstant = {}) const;
+
+  FSMEncoding getEncoding() const { return encoding; }
+  size_t getWidth() const { return width; }
+
+  Value in, writeEn, out;
+
+private:
+  FSMEncoding encoding;
+  size_t width;
+};
+
+} // end anonymous namespace
+
+FSMRegister::FSMRegister(OpBuilder &builder, ComponentOp &component,
+                         size_t numStates, FSMEncoding encoding)
+    : encoding(encoding) {
+  width = encoding == FSMEncoding::Binary
+              ? getNecessaryBitWidth(numStates)
+              : std::max<size_t>(numStates - 1, 1);
+  auto fsmRegister = createRegister(builder, component, width, "fsm");
+  // TODO(Calyx): Add methods to RegisterOp to access ports.
+  in = fsmRegister.getResult(0);
+  writeEn = fsmRegister.getResult(1);
+  out = fsmRegister.getResult(4);
+}
+
+Value FSMRegister::createState(OpBuilder &builder, Location loc,
+                               size_t state) const {
+  if (encoding == FSMEncoding::OneHot && state != 0)
+    return builder.create<hw::ConstantOp>(
+        loc, APInt::getOneBitSet(width, state - 1));
+  return createConstant(builder, loc, width, state);
+}
+
+Value FSMRegister::createIsState(OpBuilder &builder, Location loc,
+                                 size_t state, Value stateConstant) const {
+  // A one-hot encoded state is decoded by its own bit.
+  if (encoding == FSMEncoding::OneHot && state != 0)
+    return builder.create<comb::ExtractOp>(loc, out, state - 1, 1);
+
+  if (!stateConstant)
+    stateConstant = createState(builder, loc, state);
+  return builder.create<comb::ICmpOp>(loc, comb::ICmpPredicate::eq, out,
+                                      stateConstant);
+}
+
 class CompileControlVisitor {
 public:
-  void dispatch(Operation *op, ComponentOp component) {
-    TypeSwitch<Operation *>(op)
-        .template Case<SeqOp, EnableOp>(
-            [&](auto opNode) { visit(opNode, component); })
-        .Default([&](auto) {
-          op->emitError() << "Operation '" << op->getName()
-                          << "' not supported for control compilation";
+  CompileControlVisitor(FSMEncoding encoding) : encoding(encoding) {}
+
+  LogicalResult dispatch(Operation *op, ComponentOp component) {
+    return TypeSwitch<Operation *, LogicalResult>(op)
+        .template Case<SeqOp, ParOp, IfOp, WhileOp, EnableOp, ControlOp>(
+            [&](auto opNode) { return visit(opNode, component); })
+        .Default([&](auto) -> LogicalResult {
+          return op->emitError() << "Operation '" << op->getName()
+                                 << "' not supported for control compilation";
         });
   }
 
 private:
-  void visit(SeqOp seqOp, ComponentOp &component);
-  void visit(EnableOp, ComponentOp &) {
+  LogicalResult visit(SeqOp seqOp, ComponentOp &component);
+  LogicalResult compileStaticSeq(SeqOp seqOp, ComponentOp &component);
+  LogicalResult visit(ParOp parOp, ComponentOp &component);
+  LogicalResult visit(IfOp ifOp, ComponentOp &component);
+  LogicalResult visit(WhileOp whileOp, ComponentOp &component);
+  LogicalResult visit(EnableOp, ComponentOp &) {
+    // nothing to do
+    return success();
+  }
+  LogicalResult visit(ControlOp, ComponentOp &) {
     // nothing to do
+    return success();
   }
+
+  void setGoGuard(OpBuilder &builder, GroupOp group, Value one, Value guard);
+  void guardDescendants(OpBuilder &builder, GroupOp group, GroupOp parent,
+                        Value guard);
+  Value enableGroup(OpBuilder &builder, GroupOp group, Value enable,
+                    Value one);
+  void compileCondition(OpBuilder &builder, GroupOp compiledGroup,
+                        GroupOp condGroup, Value cond,
+                        RegisterOp condComputed, RegisterOp condStored,
+                        Value one);
+
+  /// The encoding of the states of the FSM registers.
+  FSMEncoding encoding;
+
+  /// The groups run by each compilation group.
+  DenseMap<Operation *, SmallVector<GroupOp, 4>> compiledChildren;
 };
 
+/// Drives the GroupGoOp of `group` with `guard`, which must be defined before
+/// `group`. Compilation groups have no GroupGoOp, since they are created after
+/// the Go Insertion pass, so they are given one here. The groups they run are
+/// only guarded by their FSM, so they are guarded with `guard` as well.
+void CompileControlVisitor::setGoGuard(OpBuilder &builder, GroupOp group,
+                                       Value one, Value guard) {
+  if (auto goOp = group.getGoOp()) {
+    goOp->setOperands({one, guard});
+    return;
+  }
+
+  IRRewriter::InsertionGuard insertionGuard(builder);
+  builder.setInsertionPointToStart(group.getBody());
+  auto goOp = builder.create<GroupGoOp>(group.getLoc(), one, guard);
+  updateGroupAssignmentGuards(builder, group, goOp);
+  guardDescendants(builder, group, group, guard);
+}
+
+/// Adds `guard` to the go signal of the groups run by the compilation group
+/// `group`, and to the ones of their own descendants. These groups are moved
+/// right before `parent`, so that `guard` is defined before them.
+void CompileControlVisitor::guardDescendants(OpBuilder &builder,
+                                             GroupOp group, GroupOp parent,
+                                             Value guard) {
+  for (auto child : compiledChildren.lookup(group)) {
+    child->moveBefore(parent);
+    builder.setInsertionPoint(child);
+    auto goOp = child.getGoOp();
+    auto childGuard =
+        builder.create<comb::AndOp>(child.getLoc(), goOp.guard(), guard);
+    goOp->setOperands({goOp.src(), childGuard});
+    guardDescendants(builder, child, parent, guard);
+  }
+}
+
+/// Runs `group` while `enable` is high and the group is not done. The guard is
+/// built at the insertion point of `builder`, which must precede `group`.
+/// Returns the done signal of the group.
+Value CompileControlVisitor::enableGroup(OpBuilder &builder, GroupOp group,
+                                         Value enable, Value one) {
+  auto loc = group.getLoc();
+  auto doneOpValue = getDoneValue(builder, loc, group);
+  auto notDone = builder.create<comb::XorOp>(loc, doneOpValue, one);
+  auto groupGoGuard = builder.create<comb::AndOp>(loc, enable, notDone);
+  setGoGuard(builder, group, one, groupGoGuard);
+  return doneOpValue;
+}
+
+/// Runs `condGroup` until the condition has been computed, and stores `cond`
+/// once it is. The `condComputed` register is reset by the caller to compute
+/// the condition again.
+void CompileControlVisitor::compileCondition(
+    OpBuilder &builder, GroupOp compiledGroup, GroupOp condGroup, Value cond,
+    RegisterOp condComputed, RegisterOp condStored, Value one) {
+  auto loc = condGroup.getLoc();
+  builder.setInsertionPoint(condGroup);
+  auto notComputed =
+      builder.create<comb::XorOp>(loc, condComputed.getResult(4), one);
+  auto condDone = enableGroup(builder, condGroup, notComputed, one);
+  auto condDoneGuard = builder.create<comb::AndOp>(loc, notComputed, condDone);
+
+  builder.setInsertionPointToEnd(compiledGroup.getBody());
+  builder.create<AssignOp>(loc, condComputed.getResult(0), one, condDoneGuard);
+  builder.create<AssignOp>(loc, condComputed.getResult(1), one, condDoneGuard);
+  builder.create<AssignOp>(loc, condStored.getResult(0), cond, condDoneGuard);
+  builder.create<AssignOp>(loc, condStored.getResult(1), one, condDoneGuard);
+}
+
 /// Generates a latency-insensitive FSM to realize a sequential operation.
 /// This is done by initializing GroupGoOp values for the enabled groups in
 /// the SeqOp, and then creating a new Seq GroupOp with the given FSM. Each
@@ -75,40 +284,37 @@ private:
 /// being executed. After the group is complete, the FSM is incremented. This
 /// SeqOp is then replaced in the control with an Enable statement referring
 /// to the new Seq GroupOp.
-void CompileControlVisitor::visit(SeqOp seq, ComponentOp &component) {
+LogicalResult CompileControlVisitor::visit(SeqOp seq,
+                                           ComponentOp &component) {
   auto wires = component.getWiresOp();
   Block *wiresBody = wires.getBody();
 
   auto &seqOps = seq.getBody()->getOperations();
-  if (!llvm::all_of(seqOps, [](auto &&op) { return isa<EnableOp>(op); })) {
-    seq.emitOpError("should only contain EnableOps in this pass.");
-    return;
-  }
+  if (!llvm::all_of(seqOps, [](auto &&op) { return isa<EnableOp>(op); }))
+    return seq.emitOpError("should only contain EnableOps in this pass.");
+
+  // Sequences of groups with a static latency are realized with a counter.
+  auto isStatic = [&](EnableOp enable) {
+    auto latency =
+        wires.lookupSymbol<GroupOp>(enable.groupName()).getStaticLatency();
+    return latency && *latency > 0;
+  };
+  if (!seqOps.empty() &&
+      llvm::all_of(seq.getBody()->getOps<EnableOp>(), isStatic))
+    return compileStaticSeq(seq, component);
 
   // This should be the number of enable statements + 1 since this is the
   // maximum value the FSM register will reach.
-  size_t fsmBitWidth = getNecessaryBitWidth(seqOps.size() + 1);
-
   OpBuilder builder(component->getRegion(0));
-  auto fsmRegister = createRegister(builder, component, fsmBitWidth, "fsm");
-  // TODO(Calyx): Add methods to RegisterOp to access ports.
-  auto fsmIn = fsmRegister.getResult(0);
-  auto fsmWriteEn = fsmRegister.getResult(1);
-  auto fsmOut = fsmRegister.getResult(4);
+  FSMRegister fsm(builder, component, seqOps.size() + 1, encoding);
 
   builder.setInsertionPointToStart(wiresBody);
   auto oneConstant = createConstant(builder, wires->getLoc(), 1, 1);
 
   // Create the new compilation group to replace this SeqOp.
-  builder.setInsertionPointToEnd(wiresBody);
-  auto seqGroup =
-      builder.create<GroupOp>(wires->getLoc(), builder.getStringAttr("seq"));
-  Block *seqGroupBody = new Block();
-  seqGroup->getRegion(0).push_back(seqGroupBody);
-
-  // Guarantees a unique SymbolName for the group.
   SymbolTable symTable(wires);
-  symTable.insert(seqGroup);
+  auto seqGroup = createGroup(builder, component, symTable, "seq");
+  Block *seqGroupBody = seqGroup.getBody();
 
   size_t fsmIndex = 0;
   SmallVector<Attribute, 8> compiledGroups;
@@ -118,25 +324,21 @@ void CompileControlVisitor::visit(SeqOp seq, ComponentOp &component) {
     compiledGroups.push_back(
         SymbolRefAttr::get(builder.getContext(), groupName));
     auto groupOp = symTable.lookup<GroupOp>(groupName);
+    compiledChildren[seqGroup].push_back(groupOp);
 
     builder.setInsertionPoint(groupOp);
-    auto fsmCurrentState =
-        createConstant(builder, wires->getLoc(), fsmBitWidth, fsmIndex);
+    Value fsmCurrentState;
+    if (fsm.getEncoding() == FSMEncoding::Binary)
+      fsmCurrentState = fsm.createState(builder, wires->getLoc(), fsmIndex);
 
-    // TODO(Calyx): Eventually, we should canonicalize the GroupDoneOp's guard
-    // and source.
-    auto guard = groupOp.getDoneOp().guard();
-    auto source = groupOp.getDoneOp().src();
-    auto doneOpValue =
-        !guard ? source
-               : builder.create<comb::AndOp>(wires->getLoc(), guard, source);
+    auto doneOpValue = getDoneValue(builder, wires->getLoc(), groupOp);
 
     // Build the Guard for the `go` signal of the current group being walked.
     // The group should begin when:
     // (1) the current step in the fsm is reached, and
     // (2) the done signal of this group is not high.
-    auto eqCmp = builder.create<comb::ICmpOp>(
-        wires->getLoc(), comb::ICmpPredicate::eq, fsmOut, fsmCurrentState);
+    auto eqCmp = fsm.createIsState(builder, wires->getLoc(), fsmIndex,
+                                   fsmCurrentState);
     auto notDone =
         builder.create<comb::XorOp>(wires->getLoc(), doneOpValue, oneConstant);
     auto groupGoGuard =
@@ -149,17 +351,14 @@ void CompileControlVisitor::visit(SeqOp seq, ComponentOp &component) {
         builder.create<comb::AndOp>(wires->getLoc(), eqCmp, doneOpValue);
 
     // Directly update the GroupGoOp of the current group being walked.
-    auto goOp = groupOp.getGoOp();
-    assert(goOp && "The Go Insertion pass should be run before this.");
-    goOp->setOperands({oneConstant, groupGoGuard});
+    setGoGuard(builder, groupOp, oneConstant, groupGoGuard);
 
     // Add guarded assignments to the fsm register `in` and `write_en` ports.
-    fsmNextState =
-        createConstant(builder, wires->getLoc(), fsmBitWidth, fsmIndex + 1);
+    fsmNextState = fsm.createState(builder, wires->getLoc(), fsmIndex + 1);
     builder.setInsertionPointToEnd(seqGroupBody);
-    builder.create<AssignOp>(wires->getLoc(), fsmIn, fsmNextState,
+    builder.create<AssignOp>(wires->getLoc(), fsm.in, fsmNextState,
                              groupDoneGuard);
-    builder.create<AssignOp>(wires->getLoc(), fsmWriteEn, oneConstant,
+    builder.create<AssignOp>(wires->getLoc(), fsm.writeEn, oneConstant,
                              groupDoneGuard);
     // Increment the fsm index for the next group.
     ++fsmIndex;
@@ -168,8 +367,8 @@ void CompileControlVisitor::visit(SeqOp seq, ComponentOp &component) {
   // Build the final guard for the new Seq group's GroupDoneOp. This is
   // defined by the fsm's final state.
   builder.setInsertionPoint(seqGroup);
-  auto isFinalState = builder.create<comb::ICmpOp>(
-      wires->getLoc(), comb::ICmpPredicate::eq, fsmOut, fsmNextState);
+  auto isFinalState =
+      fsm.createIsState(builder, wires->getLoc(), fsmIndex, fsmNextState);
 
   // Insert the respective GroupDoneOp.
   builder.setInsertionPointToEnd(seqGroupBody);
@@ -178,18 +377,346 @@ void CompileControlVisitor::visit(SeqOp seq, ComponentOp &component) {
   // Add continuous wires to reset the `in` and `write_en` ports of the fsm
   // when the SeqGroup is finished executing.
   builder.setInsertionPointToEnd(wiresBody);
-  auto zeroConstant = createConstant(builder, wires->getLoc(), fsmBitWidth, 0);
-  builder.create<AssignOp>(wires->getLoc(), fsmIn, zeroConstant, isFinalState);
-  builder.create<AssignOp>(wires->getLoc(), fsmWriteEn, oneConstant,
+  auto zeroConstant = fsm.createState(builder, wires->getLoc(), 0);
+  builder.create<AssignOp>(wires->getLoc(), fsm.in, zeroConstant,
+                           isFinalState);
+  builder.create<AssignOp>(wires->getLoc(), fsm.writeEn, oneConstant,
                            isFinalState);
 
   // Replace the SeqOp with an EnableOp.
-  builder.setInsertionPoint(seq);
-  builder.create<EnableOp>(
-      seq->getLoc(), seqGroup.sym_name(),
-      ArrayAttr::get(builder.getContext(), compiledGroups));
+  replaceWithEnable(builder, seq, seqGroup, compiledGroups);
+  return success();
+}
+
+/// Generates a counter to realize a sequential operation of groups with static
+/// latencies. Each group runs while the counter is within its interval of
+/// cycles, so the done signals of the groups are not waited for. The new Seq
+/// GroupOp is done when the counter reaches the sum of the latencies, so it
+/// has a static latency as well.
+LogicalResult CompileControlVisitor::compileStaticSeq(SeqOp seq,
+                                                      ComponentOp &component) {
+  auto wires = component.getWiresOp();
+  Block *wiresBody = wires.getBody();
+
+  SymbolTable symTable(wires);
+  uint64_t totalLatency = 0;
+  for (auto enable : seq.getBody()->getOps<EnableOp>())
+    totalLatency +=
+        *symTable.lookup<GroupOp>(enable.groupName()).getStaticLatency();
+
+  OpBuilder builder(component->getRegion(0));
+  size_t counterBitWidth = getNecessaryBitWidth(totalLatency + 1);
+  auto counterRegister =
+      createRegister(builder, component, counterBitWidth, "counter");
+  // TODO(Calyx): Add methods to RegisterOp to access ports.
+  auto counterIn = counterRegister.getResult(0);
+  auto counterWriteEn = counterRegister.getResult(1);
+  auto counterOut = counterRegister.getResult(4);
+
+  builder.setInsertionPointToStart(wiresBody);
+  auto oneConstant = createConstant(builder, wires->getLoc(), 1, 1);
 
-  seq->erase();
+  auto seqGroup = createGroup(builder, component, symTable, "seq");
+
+  uint64_t cycle = 0;
+  SmallVector<Attribute, 8> compiledGroups;
+  for (auto enable : seq.getBody()->getOps<EnableOp>()) {
+    StringRef groupName = enable.groupName();
+    compiledGroups.push_back(
+        SymbolRefAttr::get(builder.getContext(), groupName));
+    auto groupOp = symTable.lookup<GroupOp>(groupName);
+    compiledChildren[seqGroup].push_back(groupOp);
+
+    // The group runs from the cycle the previous one is done in, for as many
+    // cycles as its latency.
+    auto latency = *groupOp.getStaticLatency();
+    builder.setInsertionPoint(groupOp);
+    auto startCycle =
+        createConstant(builder, wires->getLoc(), counterBitWidth, cycle);
+    Value groupGoGuard;
+    if (latency == 1) {
+      groupGoGuard = builder.create<comb::ICmpOp>(
+          wires->getLoc(), comb::ICmpPredicate::eq, counterOut, startCycle);
+    } else {
+      auto endCycle = createConstant(builder, wires->getLoc(),
+                                     counterBitWidth, cycle + latency);
+      auto hasStarted = builder.create<comb::ICmpOp>(
+          wires->getLoc(), comb::ICmpPredicate::uge, counterOut, startCycle);
+      auto hasEnded = builder.create<comb::ICmpOp>(
+          wires->getLoc(), comb::ICmpPredicate::ult, counterOut, endCycle);
+      groupGoGuard =
+          builder.create<comb::AndOp>(wires->getLoc(), hasStarted, hasEnded);
+    }
+    setGoGuard(builder, groupOp, oneConstant, groupGoGuard);
+    cycle += latency;
+  }
+
+  // Count the cycles until the last group is done.
+  builder.setInsertionPoint(seqGroup);
+  auto finalCycle =
+      createConstant(builder, wires->getLoc(), counterBitWidth, totalLatency);
+  auto isDone = builder.create<comb::ICmpOp>(
+      wires->getLoc(), comb::ICmpPredicate::eq, counterOut, finalCycle);
+  auto notDone =
+      builder.create<comb::XorOp>(wires->getLoc(), isDone, oneConstant);
+  auto counterStep =
+      createConstant(builder, wires->getLoc(), counterBitWidth, 1);
+  auto nextCycle =
+      builder.create<comb::AddOp>(wires->getLoc(), counterOut, counterStep);
+
+  builder.setInsertionPointToEnd(seqGroup.getBody());
+  builder.create<AssignOp>(wires->getLoc(), counterIn, nextCycle, notDone);
+  builder.create<AssignOp>(wires->getLoc(), counterWriteEn, oneConstant,
+                           notDone);
+  builder.create<GroupDoneOp>(seqGroup->getLoc(), oneConstant, isDone);
+  seqGroup->setAttr("static", builder.getI64IntegerAttr(totalLatency));
+
+  // Reset the counter when the SeqGroup is finished executing.
+  builder.setInsertionPointToEnd(wiresBody);
+  auto zeroConstant =
+      createConstant(builder, wires->getLoc(), counterBitWidth, 0);
+  builder.create<AssignOp>(wires->getLoc(), counterIn, zeroConstant, isDone);
+  builder.create<AssignOp>(wires->getLoc(), counterWriteEn, oneConstant,
+                           isDone);
+
+  replaceWithEnable(builder, seq, seqGroup, compiledGroups);
+  return success();
+}
+
+/// Realizes a parallel operation by running all of its enabled groups at
+/// once. A 1-bit register for each group records that the group is done, so
+/// that it is not run again while the other groups complete. The new Par
+/// GroupOp is done when all of these registers are set, at which point they are
+/// reset for the next execution.
+LogicalResult CompileControlVisitor::visit(ParOp par, ComponentOp &component) {
+  auto wires = component.getWiresOp();
+  Block *wiresBody = wires.getBody();
+
+  auto &parOps = par.getBody()->getOperations();
+  if (!llvm::all_of(parOps, [](auto &&op) { return isa<EnableOp>(op); }))
+    return par.emitOpError("should only contain EnableOps in this pass.");
+
+  OpBuilder builder(component->getRegion(0));
+  builder.setInsertionPointToStart(wiresBody);
+  auto oneConstant = createConstant(builder, wires->getLoc(), 1, 1);
+
+  SymbolTable symTable(wires);
+  auto parGroup = createGroup(builder, component, symTable, "par");
+
+  SmallVector<Attribute, 8> compiledGroups;
+  SmallVector<RegisterOp, 8> doneRegisters;
+  SmallVector<Value, 8> doneRegisterOuts;
+  for (auto enable : par.getBody()->getOps<EnableOp>()) {
+    StringRef groupName = enable.groupName();
+    compiledGroups.push_back(
+        SymbolRefAttr::get(builder.getContext(), groupName));
+    auto groupOp = symTable.lookup<GroupOp>(groupName);
+    compiledChildren[parGroup].push_back(groupOp);
+
+    auto doneRegister = createRegister(builder, component, 1,
+                                       (Twine("pd_") + groupName).str());
+    auto doneRegisterOut = doneRegister.getResult(4);
+    doneRegisters.push_back(doneRegister);
+    doneRegisterOuts.push_back(doneRegisterOut);
+
+    // The group runs until it has been done once.
+    builder.setInsertionPoint(groupOp);
+    auto notRecorded =
+        builder.create<comb::XorOp>(wires->getLoc(), doneRegisterOut,
+                                    oneConstant);
+    auto doneOpValue =
+        enableGroup(builder, groupOp, notRecorded, oneConstant);
+
+    builder.setInsertionPointToEnd(parGroup.getBody());
+    builder.create<AssignOp>(wires->getLoc(), doneRegister.getResult(0),
+                             oneConstant, doneOpValue);
+    builder.create<AssignOp>(wires->getLoc(), doneRegister.getResult(1),
+                             oneConstant, doneOpValue);
+  }
+
+  builder.setInsertionPoint(parGroup);
+  Value isParDone = doneRegisterOuts.front();
+  if (doneRegisterOuts.size() > 1)
+    isParDone = builder.create<comb::AndOp>(
+        wires->getLoc(), builder.getI1Type(), doneRegisterOuts);
+
+  builder.setInsertionPointToEnd(parGroup.getBody());
+  builder.create<GroupDoneOp>(parGroup->getLoc(), oneConstant, isParDone);
+
+  // Reset the done registers when the ParGroup is finished executing.
+  builder.setInsertionPointToEnd(wiresBody);
+  auto zeroConstant = createConstant(builder, wires->getLoc(), 1, 0);
+  for (auto doneRegister : doneRegisters) {
+    builder.create<AssignOp>(wires->getLoc(), doneRegister.getResult(0),
+                             zeroConstant, isParDone);
+    builder.create<AssignOp>(wires->getLoc(), doneRegister.getResult(1),
+                             oneConstant, isParDone);
+  }
+
+  replaceWithEnable(builder, par, parGroup, compiledGroups);
+  return success();
+}
+
+/// Realizes an if-then-else operation by first running the group computing
+/// the condition, and storing the condition in a register. The corresponding
+/// branch is then run, and the new If GroupOp is done when the branch is. The
+/// register recording that the condition was computed is reset when the If
+/// GroupOp is finished executing.
+LogicalResult CompileControlVisitor::visit(IfOp ifOp, ComponentOp &component) {
+  auto wires = component.getWiresOp();
+  Block *wiresBody = wires.getBody();
+
+  bool hasElse = !ifOp.elseRegion().empty();
+  auto thenEnable = getSingleEnable(ifOp.thenRegion());
+  auto elseEnable = hasElse ? getSingleEnable(ifOp.elseRegion()) : EnableOp();
+  if (!thenEnable || (hasElse && !elseEnable))
+    return ifOp.emitOpError(
+        "should only contain a single EnableOp in each branch in this pass.");
+
+  OpBuilder builder(component->getRegion(0));
+  auto condComputed = createRegister(builder, component, 1, "cond_computed");
+  auto condStored = createRegister(builder, component, 1, "cond_stored");
+  auto condComputedOut = condComputed.getResult(4);
+  auto condStoredOut = condStored.getResult(4);
+
+  builder.setInsertionPointToStart(wiresBody);
+  auto oneConstant = createConstant(builder, wires->getLoc(), 1, 1);
+
+  SymbolTable symTable(wires);
+  auto ifGroup = createGroup(builder, component, symTable, "if");
+
+  auto condGroup = symTable.lookup<GroupOp>(ifOp.groupName());
+  compileCondition(builder, ifGroup, condGroup, ifOp.cond(), condComputed,
+                   condStored, oneConstant);
+
+  SmallVector<Attribute, 3> compiledGroups;
+  auto &children = compiledChildren[ifGroup];
+  compiledGroups.push_back(ifOp.groupNameAttr());
+  children.push_back(condGroup);
+
+  // Run the then branch if the stored condition holds.
+  auto thenGroup = symTable.lookup<GroupOp>(thenEnable.groupName());
+  compiledGroups.push_back(thenEnable.groupNameAttr());
+  children.push_back(thenGroup);
+  builder.setInsertionPoint(thenGroup);
+  auto isThen = builder.create<comb::AndOp>(wires->getLoc(), condComputedOut,
+                                            condStoredOut);
+  auto thenDone = enableGroup(builder, thenGroup, isThen, oneConstant);
+
+  // Otherwise, run the else branch if there is one.
+  GroupOp elseGroup;
+  if (hasElse) {
+    elseGroup = symTable.lookup<GroupOp>(elseEnable.groupName());
+    compiledGroups.push_back(elseEnable.groupNameAttr());
+    children.push_back(elseGroup);
+    builder.setInsertionPoint(elseGroup);
+  } else {
+    builder.setInsertionPoint(ifGroup);
+  }
+  auto notStored = builder.create<comb::XorOp>(wires->getLoc(), condStoredOut,
+                                               oneConstant);
+  Value elseDone;
+  if (hasElse) {
+    auto isElse = builder.create<comb::AndOp>(wires->getLoc(),
+                                              condComputedOut, notStored);
+    elseDone = enableGroup(builder, elseGroup, isElse, oneConstant);
+  }
+
+  // Build the guard for the new If group's GroupDoneOp. This is defined by
+  // the done signal of the branch that is taken.
+  builder.setInsertionPoint(ifGroup);
+  auto thenTaken =
+      builder.create<comb::AndOp>(wires->getLoc(), condStoredOut, thenDone);
+  Value elseTaken = notStored;
+  if (hasElse)
+    elseTaken =
+        builder.create<comb::AndOp>(wires->getLoc(), notStored, elseDone);
+  auto branchDone =
+      builder.create<comb::OrOp>(wires->getLoc(), thenTaken, elseTaken);
+  auto isIfDone = builder.create<comb::AndOp>(wires->getLoc(),
+                                              condComputedOut, branchDone);
+
+  builder.setInsertionPointToEnd(ifGroup.getBody());
+  builder.create<GroupDoneOp>(ifGroup->getLoc(), oneConstant, isIfDone);
+
+  // Compute the condition again the next time the IfGroup is executed.
+  builder.setInsertionPointToEnd(wiresBody);
+  auto zeroConstant = createConstant(builder, wires->getLoc(), 1, 0);
+  builder.create<AssignOp>(wires->getLoc(), condComputed.getResult(0),
+                           zeroConstant, isIfDone);
+  builder.create<AssignOp>(wires->getLoc(), condComputed.getResult(1),
+                           oneConstant, isIfDone);
+
+  replaceWithEnable(builder, ifOp, ifGroup, compiledGroups);
+  return success();
+}
+
+/// Realizes a while operation by alternating between the group computing the
+/// condition, which is stored in a register, and the body of the loop. Once the
+/// body is done, the condition is computed again. The new While GroupOp is done
+/// when the stored condition does not hold.
+LogicalResult CompileControlVisitor::visit(WhileOp whileOp,
+                                           ComponentOp &component) {
+  auto wires = component.getWiresOp();
+  Block *wiresBody = wires.getBody();
+
+  auto bodyEnable = getSingleEnable(whileOp.body());
+  if (!bodyEnable)
+    return whileOp.emitOpError(
+        "should only contain a single EnableOp in its body in this pass.");
+
+  OpBuilder builder(component->getRegion(0));
+  auto condComputed = createRegister(builder, component, 1, "cond_computed");
+  auto condStored = createRegister(builder, component, 1, "cond_stored");
+  auto condComputedOut = condComputed.getResult(4);
+  auto condStoredOut = condStored.getResult(4);
+
+  builder.setInsertionPointToStart(wiresBody);
+  auto oneConstant = createConstant(builder, wires->getLoc(), 1, 1);
+  auto zeroConstant = createConstant(builder, wires->getLoc(), 1, 0);
+
+  SymbolTable symTable(wires);
+  auto whileGroup = createGroup(builder, component, symTable, "while");
+
+  auto condGroup = symTable.lookup<GroupOp>(whileOp.groupName());
+  compileCondition(builder, whileGroup, condGroup, whileOp.cond(),
+                   condComputed, condStored, oneConstant);
+
+  // Run the body while the stored condition holds.
+  auto bodyGroup = symTable.lookup<GroupOp>(bodyEnable.groupName());
+  compiledChildren[whileGroup].append({condGroup, bodyGroup});
+  builder.setInsertionPoint(bodyGroup);
+  auto isBody = builder.create<comb::AndOp>(wires->getLoc(), condComputedOut,
+                                            condStoredOut);
+  auto bodyDone = enableGroup(builder, bodyGroup, isBody, oneConstant);
+
+  // Compute the condition again once the body is done.
+  builder.setInsertionPoint(whileGroup);
+  auto bodyDoneGuard =
+      builder.create<comb::AndOp>(wires->getLoc(), isBody, bodyDone);
+  auto notStored = builder.create<comb::XorOp>(wires->getLoc(), condStoredOut,
+                                               oneConstant);
+  auto isWhileDone = builder.create<comb::AndOp>(wires->getLoc(),
+                                                 condComputedOut, notStored);
+
+  builder.setInsertionPointToEnd(whileGroup.getBody());
+  builder.create<AssignOp>(wires->getLoc(), condComputed.getResult(0),
+                           zeroConstant, bodyDoneGuard);
+  builder.create<AssignOp>(wires->getLoc(), condComputed.getResult(1),
+                           oneConstant, bodyDoneGuard);
+  builder.create<GroupDoneOp>(whileGroup->getLoc(), oneConstant, isWhileDone);
+
+  // Compute the condition again the next time the WhileGroup is executed.
+  builder.setInsertionPointToEnd(wiresBody);
+  builder.create<AssignOp>(wires->getLoc(), condComputed.getResult(0),
+                           zeroConstant, isWhileDone);
+  builder.create<AssignOp>(wires->getLoc(), condComputed.getResult(1),
+                           oneConstant, isWhileDone);
+
+  replaceWithEnable(
+      builder, whileOp, whileGroup,
+      {whileOp.groupNameAttr(), bodyEnable.groupNameAttr()});
+  return success();
 }
 
 namespace {
@@ -202,9 +729,23 @@ struct CompileControlPass : public CompileControlBase<CompileControlPass> {
 
 void CompileControlPass::runOnOperation() {
   ComponentOp component = getOperation();
-  CompileControlVisitor CompileControlVisitor;
-  component.getControlOp().walk(
-      [&](Operation *op) { CompileControlVisitor.dispatch(op, component); });
+  auto encoding = llvm::StringSwitch<Optional<FSMEncoding>>(fsmEncoding)
+                      .Case("binary", FSMEncoding::Binary)
+                      .Case("one-hot", FSMEncoding::OneHot)
+                      .Default(llvm::None);
+  if (!encoding) {
+    component.emitError() << "unknown FSM encoding '" << fsmEncoding << "'";
+    return signalPassFailure();
+  }
+
+  CompileControlVisitor compileControlVisitor(*encoding);
+  auto result = component.getControlOp().walk([&](Operation *op) {
+    if (failed(compileControlVisitor.dispatch(op, component)))
+      return WalkResult::interrupt();
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return signalPassFailure();
 
   // A post-condition of this pass is that all undefined GroupGoOps, created
   // in the Go Insertion pass, are now defined.
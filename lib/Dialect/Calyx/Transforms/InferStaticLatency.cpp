@@ -0,0 +1,76 @@
+//===- InferStaticLatency.cpp - Infer Static Latency Pass -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Contains the definitions of the Infer Static Latency pass.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Calyx/CalyxOps.h"
+#include "circt/Dialect/Calyx/CalyxPasses.h"
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
+
+using namespace circt;
+using namespace calyx;
+using namespace mlir;
+
+/// Returns the static latency of `group`, if it can be inferred.
+static Optional<uint64_t> inferLatency(GroupOp group) {
+  // A group done with a register, which it writes as soon as it runs, is done
+  // in a single cycle.
+  auto doneOp = group.getDoneOp();
+  if (doneOp.guard())
+    return None;
+  auto reg = doneOp.src().getDefiningOp<RegisterOp>();
+  if (!reg || doneOp.src() != reg.done())
+    return None;
+
+  bool writesRegister = false;
+  group.walk([&](AssignOp assign) {
+    if (assign.dest() == reg.write_en() && isUnconditional(assign, group) &&
+        matchPattern(assign.src(), m_One()))
+      writesRegister = true;
+  });
+  if (!writesRegister)
+    return None;
+  return 1;
+}
+
+namespace {
+
+struct InferStaticLatencyPass
+    : public InferStaticLatencyBase<InferStaticLatencyPass> {
+  void runOnOperation() override;
+};
+
+} // end anonymous namespace
+
+void InferStaticLatencyPass::runOnOperation() {
+  ComponentOp component = getOperation();
+  Builder builder(&getContext());
+
+  bool anythingChanged = false;
+  component.getWiresOp().walk([&](GroupOp group) {
+    if (group.getStaticLatency())
+      return;
+    auto latency = inferLatency(group);
+    if (!latency)
+      return;
+    group->setAttr("static", builder.getI64IntegerAttr(*latency));
+    anythingChanged = true;
+  });
+
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<mlir::Pass> circt::calyx::createInferStaticLatencyPass() {
+  return std::make_unique<InferStaticLatencyPass>();
+}
@@ -42,6 +42,16 @@ static void updateGroupAssignmentGuards(OpBuilder &builder, GroupOp &group,
   });
 }
 
+/// Returns true if `assign` is active whenever `group` runs, i.e. it is
+/// unguarded, or only guarded by the go signal of the group.
+static inline bool isUnconditional(AssignOp assign, GroupOp group) {
+  auto guard = assign.guard();
+  if (!guard)
+    return true;
+  auto goOp = group.getGoOp();
+  return goOp && guard == goOp.getResult();
+}
+
 } // namespace calyx
 } // namespace circt
 
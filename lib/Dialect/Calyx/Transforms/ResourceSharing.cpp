@@ -0,0 +1,433 @@
+//===- ResourceSharing.cpp - Resource Sharing Passes ------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Contains the definitions of the Resource Sharing and Register Sharing
+// passes. Both merge the cells of a component which are used by groups that
+// never need them at the same time, as computed from the control program.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/Calyx/CalyxOps.h"
+#include "circt/Dialect/Calyx/CalyxPasses.h"
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Matchers.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
+
+using namespace circt;
+using namespace calyx;
+using namespace mlir;
+
+using CellSet = llvm::DenseSet<Operation *>;
+
+/// Collects the groups run by the control statement `op`: the enabled groups,
+/// and the groups computing the conditions of if and while statements.
+static void collectGroups(Operation *op, WiresOp wires,
+                          SmallVectorImpl<GroupOp> &groups) {
+  op->walk([&](Operation *nested) {
+    if (auto enable = dyn_cast<EnableOp>(nested))
+      groups.push_back(wires.lookupSymbol<GroupOp>(enable.groupName()));
+    else if (auto ifOp = dyn_cast<IfOp>(nested))
+      groups.push_back(wires.lookupSymbol<GroupOp>(ifOp.groupName()));
+    else if (auto whileOp = dyn_cast<WhileOp>(nested))
+      groups.push_back(wires.lookupSymbol<GroupOp>(whileOp.groupName()));
+  });
+}
+
+/// Returns the groups using the results of `cell`, or None if any of them is
+/// used outside of a group, e.g. by a continuous assignment or as the
+/// condition of a control statement.
+static Optional<SmallPtrSet<Operation *, 4>> getUsingGroups(Operation *cell) {
+  SmallPtrSet<Operation *, 4> groups;
+  for (auto result : cell->getResults()) {
+    for (auto *user : result.getUsers()) {
+      auto group = user->getParentOfType<GroupOp>();
+      if (!group)
+        return None;
+      groups.insert(group);
+    }
+  }
+  return groups;
+}
+
+/// Replaces all the uses of `cell` with the results of `sharedCell`, and
+/// erases it.
+static void mergeCell(Operation *cell, Operation *sharedCell) {
+  for (auto results : llvm::zip(cell->getResults(), sharedCell->getResults()))
+    std::get<0>(results).replaceAllUsesWith(std::get<1>(results));
+  cell->erase();
+}
+
+//===----------------------------------------------------------------------===//
+// Cell sharing
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Greedily assigns cells to shared cells, such that none of the cells merged
+/// into a shared cell conflict with each other.
+class CellSharing {
+public:
+  /// Returns the shared cell `cell` is merged into. Cells are only merged into
+  /// cells added before them, with the same `kind`.
+  Operation *add(Operation *cell, Attribute kind,
+                 llvm::function_ref<bool(Operation *, Operation *)> conflict) {
+    for (auto &shared : sharedCells[kind]) {
+      if (llvm::any_of(shared.second, [&](Operation *member) {
+            return conflict(cell, member);
+          }))
+        continue;
+      shared.second.push_back(cell);
+      return shared.first;
+    }
+    sharedCells[kind].push_back({cell, {cell}});
+    return cell;
+  }
+
+private:
+  llvm::MapVector<Attribute,
+                  SmallVector<std::pair<Operation *, SmallVector<Operation *>>>>
+      sharedCells;
+};
+
+/// The pairs of groups which may run at the same time, as the children of a
+/// par statement.
+class ParallelGroups {
+public:
+  ParallelGroups(ComponentOp component);
+
+  bool mayRunInParallel(Operation *lhs, Operation *rhs) const {
+    auto it = parallelGroups.find(lhs);
+    return it != parallelGroups.end() && it->second.count(rhs);
+  }
+
+private:
+  DenseMap<Operation *, CellSet> parallelGroups;
+};
+
+} // end anonymous namespace
+
+ParallelGroups::ParallelGroups(ComponentOp component) {
+  auto wires = component.getWiresOp();
+  component.getControlOp().walk([&](ParOp par) {
+    SmallVector<SmallVector<GroupOp>> childGroups;
+    for (auto &child : *par.getBody())
+      collectGroups(&child, wires, childGroups.emplace_back());
+
+    for (size_t i = 0, e = childGroups.size(); i != e; ++i)
+      for (size_t j = i + 1; j != e; ++j)
+        for (auto lhs : childGroups[i])
+          for (auto rhs : childGroups[j]) {
+            parallelGroups[lhs].insert(rhs);
+            parallelGroups[rhs].insert(lhs);
+          }
+  });
+}
+
+//===----------------------------------------------------------------------===//
+// Resource sharing
+//===----------------------------------------------------------------------===//
+
+/// Returns true if the outputs of an instance of `component` only depend on
+/// its current inputs, so that instances of it can be used by different
+/// groups.
+static bool isStateless(ComponentOp component) {
+  if (!component.getControlOp().getBody()->empty())
+    return false;
+  auto result = component.getBody()->walk([](Operation *op) {
+    if (isa<RegisterOp>(op))
+      return WalkResult::interrupt();
+    if (auto instance = dyn_cast<InstanceOp>(op)) {
+      auto referencedComponent = instance.getReferencedComponent();
+      if (!referencedComponent || !isStateless(referencedComponent))
+        return WalkResult::interrupt();
+    }
+    return WalkResult::advance();
+  });
+  return !result.wasInterrupted();
+}
+
+namespace {
+
+struct ResourceSharingPass
+    : public ResourceSharingBase<ResourceSharingPass> {
+  void runOnOperation() override;
+};
+
+} // end anonymous namespace
+
+void ResourceSharingPass::runOnOperation() {
+  ComponentOp component = getOperation();
+  ParallelGroups parallelGroups(component);
+
+  DenseMap<Operation *, SmallPtrSet<Operation *, 4>> usingGroups;
+  auto conflict = [&](Operation *lhs, Operation *rhs) {
+    for (auto *lhsGroup : usingGroups.find(lhs)->second)
+      for (auto *rhsGroup : usingGroups.find(rhs)->second)
+        if (lhsGroup == rhsGroup ||
+            parallelGroups.mayRunInParallel(lhsGroup, rhsGroup))
+          return true;
+    return false;
+  };
+
+  CellSharing sharing;
+  bool anythingChanged = false;
+  for (auto instance :
+       llvm::make_early_inc_range(component.getBody()->getOps<InstanceOp>())) {
+    auto referencedComponent = instance.getReferencedComponent();
+    if (!referencedComponent || !isStateless(referencedComponent))
+      continue;
+    auto groups = getUsingGroups(instance);
+    if (!groups)
+      continue;
+    usingGroups[instance] = std::move(*groups);
+
+    auto *shared =
+        sharing.add(instance, instance.componentNameAttr(), conflict);
+    if (shared == instance)
+      continue;
+    mergeCell(instance, shared);
+    anythingChanged = true;
+  }
+
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+//===----------------------------------------------------------------------===//
+// Register sharing
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// A backward live range analysis of the registers of a component over its
+/// control program. Two registers interfere if one of them is live while the
+/// other is used, or if they are used by groups which may run in parallel.
+class RegisterLiveness {
+public:
+  RegisterLiveness(ComponentOp component, const CellSet &registers);
+
+  bool interfere(Operation *lhs, Operation *rhs) const {
+    auto it = interference.find(lhs);
+    return it != interference.end() && it->second.count(rhs);
+  }
+
+  /// Returns true if the value of `reg` is read before it is written, in which
+  /// case it carries a value across executions of the component.
+  bool isLiveOnEntry(Operation *reg) const { return liveOnEntry.count(reg); }
+
+private:
+  CellSet visit(Operation *op, const CellSet &liveOut);
+  CellSet visitBlock(Block &block, const CellSet &liveOut);
+  CellSet visitGroup(GroupOp group, const CellSet &liveOut);
+  CellSet getAccesses(Operation *op);
+  void addInterference(const CellSet &lhs, const CellSet &rhs);
+
+  WiresOp wires;
+  const CellSet &registers;
+
+  /// The registers read, written and written whenever each group runs.
+  DenseMap<Operation *, CellSet> reads, writes, kills;
+
+  DenseMap<Operation *, CellSet> interference;
+  CellSet liveOnEntry;
+};
+
+} // end anonymous namespace
+
+RegisterLiveness::RegisterLiveness(ComponentOp component,
+                                   const CellSet &registers)
+    : wires(component.getWiresOp()), registers(registers) {
+  wires.walk([&](GroupOp group) {
+    auto &groupReads = reads[group];
+    auto &groupWrites = writes[group];
+    auto &groupKills = kills[group];
+    group.walk([&](Operation *op) {
+      for (auto operand : op->getOperands()) {
+        auto reg = operand.getDefiningOp<RegisterOp>();
+        if (reg && registers.count(reg) && operand == reg.out())
+          groupReads.insert(reg);
+      }
+      auto assign = dyn_cast<AssignOp>(op);
+      if (!assign)
+        return;
+      auto reg = assign.dest().getDefiningOp<RegisterOp>();
+      if (!reg || !registers.count(reg))
+        return;
+      groupWrites.insert(reg);
+      if (assign.dest() == reg.write_en() && isUnconditional(assign, group) &&
+          matchPattern(assign.src(), m_One()))
+        groupKills.insert(reg);
+    });
+  });
+
+  liveOnEntry = visit(component.getControlOp(), {});
+}
+
+/// Returns the registers accessed by the groups run by `op`.
+CellSet RegisterLiveness::getAccesses(Operation *op) {
+  SmallVector<GroupOp> groups;
+  collectGroups(op, wires, groups);
+  CellSet accesses;
+  for (auto group : groups) {
+    accesses.insert(reads[group].begin(), reads[group].end());
+    accesses.insert(writes[group].begin(), writes[group].end());
+  }
+  return accesses;
+}
+
+void RegisterLiveness::addInterference(const CellSet &lhs,
+                                       const CellSet &rhs) {
+  for (auto *lhsReg : lhs)
+    for (auto *rhsReg : rhs) {
+      if (lhsReg == rhsReg)
+        continue;
+      interference[lhsReg].insert(rhsReg);
+      interference[rhsReg].insert(lhsReg);
+    }
+}
+
+/// Returns the live registers before `group`. The registers accessed by the
+/// group interfere with each other, and with the ones live across it.
+CellSet RegisterLiveness::visitGroup(GroupOp group, const CellSet &liveOut) {
+  CellSet liveIn = reads[group];
+  for (auto *reg : liveOut)
+    if (!kills[group].count(reg))
+      liveIn.insert(reg);
+
+  CellSet live = liveIn;
+  live.insert(liveOut.begin(), liveOut.end());
+  live.insert(writes[group].begin(), writes[group].end());
+  addInterference(live, live);
+  return liveIn;
+}
+
+/// Returns the live registers before the control statements of `block`, which
+/// run one after the other, given the ones live after them.
+CellSet RegisterLiveness::visitBlock(Block &block, const CellSet &liveOut) {
+  CellSet live = liveOut;
+  for (auto &child : llvm::reverse(block))
+    live = visit(&child, live);
+  return live;
+}
+
+/// Returns the live registers before the control statement `op`, given the
+/// ones live after it.
+CellSet RegisterLiveness::visit(Operation *op, const CellSet &liveOut) {
+  if (auto enable = dyn_cast<EnableOp>(op))
+    return visitGroup(wires.lookupSymbol<GroupOp>(enable.groupName()),
+                      liveOut);
+
+  if (isa<ControlOp, SeqOp>(op))
+    return visitBlock(op->getRegion(0).front(), liveOut);
+
+  if (auto par = dyn_cast<ParOp>(op)) {
+    // The registers accessed by different children may be used at the same
+    // time.
+    CellSet liveIn;
+    SmallVector<CellSet> childAccesses;
+    for (auto &child : *par.getBody()) {
+      auto childLiveIn = visit(&child, liveOut);
+      auto accesses = getAccesses(&child);
+      accesses.insert(childLiveIn.begin(), childLiveIn.end());
+      for (auto &otherAccesses : childAccesses)
+        addInterference(accesses, otherAccesses);
+      childAccesses.push_back(std::move(accesses));
+      liveIn.insert(childLiveIn.begin(), childLiveIn.end());
+    }
+    return liveIn;
+  }
+
+  if (auto ifOp = dyn_cast<IfOp>(op)) {
+    auto branchesLiveIn = visitBlock(ifOp.thenRegion().front(), liveOut);
+    if (!ifOp.elseRegion().empty()) {
+      auto elseLiveIn = visitBlock(ifOp.elseRegion().front(), liveOut);
+      branchesLiveIn.insert(elseLiveIn.begin(), elseLiveIn.end());
+    } else {
+      branchesLiveIn.insert(liveOut.begin(), liveOut.end());
+    }
+    return visitGroup(wires.lookupSymbol<GroupOp>(ifOp.groupName()),
+                      branchesLiveIn);
+  }
+
+  if (auto whileOp = dyn_cast<WhileOp>(op)) {
+    // The condition is computed before each iteration and before exiting the
+    // loop, iterate until the registers live after it are stable.
+    auto condGroup = wires.lookupSymbol<GroupOp>(whileOp.groupName());
+    CellSet condLiveOut = liveOut;
+    while (true) {
+      auto condLiveIn = visitGroup(condGroup, condLiveOut);
+      auto bodyLiveIn = visitBlock(whileOp.body().front(), condLiveIn);
+
+      auto size = condLiveOut.size();
+      condLiveOut.insert(bodyLiveIn.begin(), bodyLiveIn.end());
+      if (condLiveOut.size() == size)
+        return condLiveIn;
+    }
+  }
+
+  // Conservatively assume everything is live otherwise.
+  CellSet live = liveOut;
+  live.insert(registers.begin(), registers.end());
+  addInterference(live, live);
+  return live;
+}
+
+namespace {
+
+struct RegisterSharingPass
+    : public RegisterSharingBase<RegisterSharingPass> {
+  void runOnOperation() override;
+};
+
+} // end anonymous namespace
+
+void RegisterSharingPass::runOnOperation() {
+  ComponentOp component = getOperation();
+
+  // Only the registers used within groups are shared.
+  CellSet registers;
+  SmallVector<RegisterOp> sharableRegisters;
+  for (auto reg : component.getBody()->getOps<RegisterOp>()) {
+    if (!getUsingGroups(reg))
+      continue;
+    registers.insert(reg);
+    sharableRegisters.push_back(reg);
+  }
+
+  RegisterLiveness liveness(component, registers);
+
+  auto conflict = [&](Operation *lhs, Operation *rhs) {
+    return liveness.interfere(lhs, rhs);
+  };
+  CellSharing sharing;
+  bool anythingChanged = false;
+  for (auto reg : sharableRegisters) {
+    if (liveness.isLiveOnEntry(reg))
+      continue;
+    auto *shared =
+        sharing.add(reg, TypeAttr::get(reg.out().getType()), conflict);
+    if (shared == reg)
+      continue;
+    mergeCell(reg, shared);
+    anythingChanged = true;
+  }
+
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<mlir::Pass> circt::calyx::createResourceSharingPass() {
+  return std::make_unique<ResourceSharingPass>();
+}
+
+std::unique_ptr<mlir::Pass> circt::calyx::createRegisterSharingPass() {
+  return std::make_unique<RegisterSharingPass>();
+}
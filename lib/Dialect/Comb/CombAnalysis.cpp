@@ -17,8 +17,13 @@ using namespace comb;
 /// always returns zeros for the zero bits in a constant.
 ///
 /// Expression trees can be very large, so we need ot make sure to cap our
-/// recursion, this is controlled by `depth`.
-static KnownBitAnalysis computeKnownBits(Value v, unsigned depth) {
+/// recursion, this is controlled by `depth`.  Expression trees are DAGs, so the
+/// results are memoized in `cache` to avoid revisiting shared subexpressions.
+static KnownBitAnalysis computeKnownBits(Value v, unsigned depth,
+                                         KnownBitCache &cache);
+
+static KnownBitAnalysis computeKnownBitsImpl(Value v, unsigned depth,
+                                             KnownBitCache &cache) {
   Operation *op = v.getDefiningOp();
   if (!op || depth == 5)
     return KnownBitAnalysis::getUnknown(v);
@@ -29,9 +34,10 @@ static KnownBitAnalysis computeKnownBits(Value v, unsigned depth) {
 
   // `concat(x, y, z)` has whatever is known about the operands concat'd.
   if (auto concatOp = dyn_cast<ConcatOp>(op)) {
-    auto result = computeKnownBits(concatOp.getOperand(0), depth + 1);
+    auto result = computeKnownBits(concatOp.getOperand(0), depth + 1, cache);
     for (size_t i = 1, e = concatOp.getNumOperands(); i != e; ++i) {
-      auto otherBits = computeKnownBits(concatOp.getOperand(i), depth + 1);
+      auto otherBits =
+          computeKnownBits(concatOp.getOperand(i), depth + 1, cache);
       unsigned width = otherBits.getWidth();
       unsigned newWidth = result.getWidth() + width;
       result.zeros = (result.zeros.zext(newWidth) << width) |
@@ -44,9 +50,9 @@ static KnownBitAnalysis computeKnownBits(Value v, unsigned depth) {
 
   // `and(x, y, z)` has whatever is known about the operands intersected.
   if (auto andOp = dyn_cast<AndOp>(op)) {
-    auto result = computeKnownBits(andOp.getOperand(0), depth + 1);
+    auto result = computeKnownBits(andOp.getOperand(0), depth + 1, cache);
     for (size_t i = 1, e = andOp.getNumOperands(); i != e; ++i) {
-      auto otherBits = computeKnownBits(andOp.getOperand(i), depth + 1);
+      auto otherBits = computeKnownBits(andOp.getOperand(i), depth + 1, cache);
       result.zeros |= otherBits.zeros;
       result.ones &= otherBits.ones;
     }
@@ -55,9 +61,9 @@ static KnownBitAnalysis computeKnownBits(Value v, unsigned depth) {
 
   // `or(x, y, z)` has whatever is known about the operands unioned.
   if (auto orOp = dyn_cast<OrOp>(op)) {
-    auto result = computeKnownBits(orOp.getOperand(0), depth + 1);
+    auto result = computeKnownBits(orOp.getOperand(0), depth + 1, cache);
     for (size_t i = 1, e = orOp.getNumOperands(); i != e; ++i) {
-      auto otherBits = computeKnownBits(orOp.getOperand(i), depth + 1);
+      auto otherBits = computeKnownBits(orOp.getOperand(i), depth + 1, cache);
       result.zeros &= otherBits.zeros;
       result.ones |= otherBits.ones;
     }
@@ -66,9 +72,9 @@ static KnownBitAnalysis computeKnownBits(Value v, unsigned depth) {
 
   // `xor(x, cst)` inverts known bits and passes through unmodified ones.
   if (auto xorOp = dyn_cast<XorOp>(op)) {
-    auto result = computeKnownBits(xorOp.getOperand(0), depth + 1);
+    auto result = computeKnownBits(xorOp.getOperand(0), depth + 1, cache);
     for (size_t i = 1, e = xorOp.getNumOperands(); i != e; ++i) {
-      auto otherBits = computeKnownBits(xorOp.getOperand(i), depth + 1);
+      auto otherBits = computeKnownBits(xorOp.getOperand(i), depth + 1, cache);
       auto knownOtherBits = otherBits.getBitsKnown();
       // We can only know anything about bits that are known of all operands.
       result.zeros &= knownOtherBits;
@@ -84,19 +90,40 @@ static KnownBitAnalysis computeKnownBits(Value v, unsigned depth) {
 
   // `mux(cond, x, y)` is the intersection of the known bits of `x` and `y`.
   if (auto muxOp = dyn_cast<MuxOp>(op)) {
-    auto lhs = computeKnownBits(muxOp.trueValue(), depth + 1);
-    auto rhs = computeKnownBits(muxOp.falseValue(), depth + 1);
+    auto lhs = computeKnownBits(muxOp.trueValue(), depth + 1, cache);
+    auto rhs = computeKnownBits(muxOp.falseValue(), depth + 1, cache);
     lhs.ones &= rhs.ones;
-    lhs.zeros &= lhs.zeros;
+    lhs.zeros &= rhs.zeros;
     return lhs;
   }
 
   return KnownBitAnalysis::getUnknown(v);
 }
 
+static KnownBitAnalysis computeKnownBits(Value v, unsigned depth,
+                                         KnownBitCache &cache) {
+  // A result computed at the same or a smaller depth is at least as precise as
+  // what we would compute here.
+  auto it = cache.entries.find(v);
+  if (it != cache.entries.end() && it->second.depth <= depth)
+    return it->second.bits;
+
+  auto result = computeKnownBitsImpl(v, depth, cache);
+  KnownBitCache::Entry entry{result, depth};
+  auto insertion = cache.entries.insert({v, entry});
+  if (!insertion.second)
+    insertion.first->second = entry;
+  return result;
+}
+
 /// Given an integer SSA value, check to see if we know anything about the
 /// result of the computation.  For example, we know that "and with a
 /// constant" always returns zeros for the zero bits in a constant.
 KnownBitAnalysis KnownBitAnalysis::compute(Value v) {
-  return computeKnownBits(v, 0);
+  KnownBitCache cache;
+  return computeKnownBits(v, 0, cache);
+}
+
+KnownBitAnalysis KnownBitAnalysis::compute(Value v, KnownBitCache &cache) {
+  return computeKnownBits(v, 0, cache);
 }
\ No newline at end of file
@@ -244,7 +244,7 @@ circt::esi::buildESIWrapper(OpBuilder &b, Operation *pearl,
   shell.getBodyBlock()->clear(); // Erase the terminator.
   auto modBuilder =
       ImplicitLocOpBuilder::atBlockBegin(loc, shell.getBodyBlock());
-  BackedgeBuilder bb(modBuilder, modBuilder.getLoc());
+  BackedgeBuilder bb(modBuilder, modBuilder.getLoc(), /*bulk=*/true);
 
   // Hold the operands for `hw.output` here.
   SmallVector<Value, 64> outputs(shell.getNumResults());
@@ -64,6 +64,48 @@ static void printChannelBuffer(OpAsmPrinter &p, ChannelBuffer &op) {
   p << " : " << op.output().getType().cast<ChannelPort>().getInner();
 }
 
+/// Verify the options of a FIFO-based buffer implementation, which are shared
+/// between ChannelBuffer and ChannelFIFO.
+static LogicalResult verifyFIFOOptions(Operation *op, StringRef impl,
+                                       IntegerAttr depth,
+                                       IntegerAttr almostFull) {
+  if (impl != "fifo" && impl != "skid" && impl != "elastic")
+    return op->emitOpError("unknown buffer implementation '") << impl << "'";
+  if (impl == "skid") {
+    if (depth || almostFull)
+      return op->emitOpError("skid buffers hold a single token and take no "
+                             "depth or almost full options");
+    return success();
+  }
+  if (!depth)
+    return op->emitOpError("'") << impl << "' buffers require a depth";
+  if (almostFull) {
+    if (impl != "elastic")
+      return op->emitOpError("only 'elastic' buffers have an almost full "
+                             "threshold");
+    if (almostFull.getInt() > depth.getInt())
+      return op->emitOpError("almost full threshold (")
+             << almostFull.getInt() << ") exceeds the depth ("
+             << depth.getInt() << ")";
+  }
+  return success();
+}
+
+static LogicalResult verifyChannelBuffer(ChannelBuffer &op) {
+  ChannelBufferOptions opts = op.options();
+  StringRef impl = opts.impl() ? opts.impl().getValue() : "stages";
+  if (impl == "stages") {
+    if (opts.depth() || opts.almostFull())
+      return op.emitOpError("pipeline stage buffers take a number of stages, "
+                            "not a depth or almost full threshold");
+    return success();
+  }
+  if (opts.stages())
+    return op.emitOpError("'")
+           << impl << "' buffers take a depth, not a number of stages";
+  return verifyFIFOOptions(op, impl, opts.depth(), opts.almostFull());
+}
+
 //===----------------------------------------------------------------------===//
 // PipelineStage functions.
 //===----------------------------------------------------------------------===//
@@ -96,6 +138,76 @@ static void printPipelineStage(OpAsmPrinter &p, PipelineStage &op) {
   p << " : " << op.output().getType().cast<ChannelPort>().getInner();
 }
 
+//===----------------------------------------------------------------------===//
+// ChannelFIFO functions.
+//===----------------------------------------------------------------------===//
+
+static ParseResult parseChannelFIFO(OpAsmParser &parser,
+                                    OperationState &result) {
+  // The syntax is the same as that of the pipeline stage, with the
+  // implementation options in the attribute dictionary.
+  return parsePipelineStage(parser, result);
+}
+
+static void printChannelFIFO(OpAsmPrinter &p, ChannelFIFO &op) {
+  p << "esi.fifo " << op.clk() << ", " << op.rstn() << ", " << op.input()
+    << " ";
+  p.printOptionalAttrDict(op->getAttrs());
+  p << " : " << op.output().getType().cast<ChannelPort>().getInner();
+}
+
+static LogicalResult verifyChannelFIFO(ChannelFIFO &op) {
+  return verifyFIFOOptions(op, op.impl(), op.depthAttr(), op.almostFullAttr());
+}
+
+//===----------------------------------------------------------------------===//
+// ChannelGearbox functions.
+//===----------------------------------------------------------------------===//
+
+static ParseResult parseChannelGearbox(OpAsmParser &parser,
+                                       OperationState &result) {
+  llvm::SMLoc inputOperandsLoc = parser.getCurrentLocation();
+
+  SmallVector<OpAsmParser::OperandType, 4> operands;
+  Type innerInputType, innerOutputType;
+  if (parser.parseOperandList(operands, /*requiredOperandCount=*/3) ||
+      parser.parseOptionalAttrDict(result.attributes) || parser.parseColon() ||
+      parser.parseType(innerInputType) || parser.parseArrow() ||
+      parser.parseType(innerOutputType))
+    return failure();
+  auto *ctxt = parser.getBuilder().getContext();
+  result.addTypes({ChannelPort::get(ctxt, innerOutputType)});
+
+  auto i1 = IntegerType::get(result.getContext(), 1);
+  if (parser.resolveOperands(operands,
+                             {i1, i1, ChannelPort::get(ctxt, innerInputType)},
+                             inputOperandsLoc, result.operands))
+    return failure();
+  return success();
+}
+
+static void printChannelGearbox(OpAsmPrinter &p, ChannelGearbox &op) {
+  p << "esi.gearbox " << op.clk() << ", " << op.rstn() << ", " << op.input()
+    << " ";
+  p.printOptionalAttrDict(op->getAttrs());
+  p << " : " << op.input().getType().cast<ChannelPort>().getInner() << " -> "
+    << op.output().getType().cast<ChannelPort>().getInner();
+}
+
+static LogicalResult verifyChannelGearbox(ChannelGearbox &op) {
+  int64_t inWidth =
+      hw::getBitWidth(op.input().getType().cast<ChannelPort>().getInner());
+  int64_t outWidth =
+      hw::getBitWidth(op.output().getType().cast<ChannelPort>().getInner());
+  if (inWidth <= 0 || outWidth <= 0)
+    return op.emitOpError("requires message types of known, non-zero width");
+  if (std::max(inWidth, outWidth) % std::min(inWidth, outWidth) != 0)
+    return op.emitOpError("input width (")
+           << inWidth << ") and output width (" << outWidth
+           << ") must be multiples of one another";
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // Wrap / unwrap.
 //===----------------------------------------------------------------------===//
@@ -21,13 +21,22 @@
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/ImplicitLocOpBuilder.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/DialectConversion.h"
 
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/FormatVariadic.h"
 
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 #ifdef CAPNP
 #include "capnp/ESICapnp.h"
@@ -57,6 +66,8 @@ public:
   ESIHWBuilder(Operation *top);
 
   HWModuleExternOp declareStage();
+  HWModuleExternOp declareFIFO(StringRef impl);
+  HWModuleExternOp declareGearbox();
   // Will be unused when CAPNP is undefined
   HWModuleExternOp declareCosimEndpoint() LLVM_ATTRIBUTE_UNUSED;
 
@@ -68,7 +79,7 @@ public:
   const StringAttr dataOutValid, dataOutReady, dataOut, dataInValid,
       dataInReady, dataIn;
   const StringAttr clk, rstn;
-  const Identifier width;
+  const Identifier width, depth, almostFull, inWidth, outWidth;
 
   // Various identifier strings. Keep them all here in case we rename them.
   static constexpr char dataStr[] = "data", validStr[] = "valid",
@@ -81,7 +92,9 @@ private:
   StringAttr constructInterfaceName(ChannelPort);
 
   HWModuleExternOp declaredStage;
+  HWModuleExternOp declaredGearbox;
   HWModuleExternOp declaredCosimEndpoint;
+  llvm::StringMap<HWModuleExternOp> declaredFIFOs;
   llvm::DenseMap<Type, InterfaceOp> portTypeLookup;
 };
 } // anonymous namespace
@@ -108,7 +121,12 @@ ESIHWBuilder::ESIHWBuilder(Operation *top)
       dataIn(StringAttr::get(getContext(), "DataIn")),
       clk(StringAttr::get(getContext(), "clk")),
       rstn(StringAttr::get(getContext(), "rstn")),
-      width(Identifier::get("WIDTH", getContext())), declaredStage(nullptr) {
+      width(Identifier::get("WIDTH", getContext())),
+      depth(Identifier::get("DEPTH", getContext())),
+      almostFull(Identifier::get("ALMOST_FULL", getContext())),
+      inWidth(Identifier::get("IN_WIDTH", getContext())),
+      outWidth(Identifier::get("OUT_WIDTH", getContext())),
+      declaredStage(nullptr), declaredGearbox(nullptr) {
 
   auto regions = top->getRegions();
   if (regions.size() == 0) {
@@ -188,6 +206,56 @@ HWModuleExternOp ESIHWBuilder::declareStage() {
   return declaredStage;
 }
 
+/// Write an 'ExternModuleOp' to use the hand-coded SystemVerilog module which
+/// implements the specified FIFO-based buffer. The FIFO modules have the same
+/// ports as the pipeline stage, plus an almost full flag for the elastic
+/// buffer.
+HWModuleExternOp ESIHWBuilder::declareFIFO(StringRef impl) {
+  if (auto declared = declaredFIFOs.lookup(impl))
+    return declared;
+
+  StringRef moduleName = llvm::StringSwitch<StringRef>(impl)
+                             .Case("fifo", "ESI_FIFO")
+                             .Case("skid", "ESI_SkidBuffer")
+                             .Case("elastic", "ESI_ElasticBuffer");
+  auto name = StringAttr::get(getContext(), moduleName);
+  SmallVector<ModulePortInfo, 9> ports = {
+      {clk, PortDirection::INPUT, getI1Type(), 0},
+      {rstn, PortDirection::INPUT, getI1Type(), 1},
+      {a, PortDirection::INPUT, getNoneType(), 2},
+      {aValid, PortDirection::INPUT, getI1Type(), 3},
+      {aReady, PortDirection::OUTPUT, getI1Type(), 0},
+      {x, PortDirection::OUTPUT, getNoneType(), 1},
+      {xValid, PortDirection::OUTPUT, getI1Type(), 2},
+      {xReady, PortDirection::INPUT, getI1Type(), 4}};
+  if (impl == "elastic")
+    ports.push_back({StringAttr::get(getContext(), "almost_full"),
+                     PortDirection::OUTPUT, getI1Type(), 3});
+  auto declared = create<HWModuleExternOp>(name, ports);
+  declaredFIFOs[impl] = declared;
+  return declared;
+}
+
+/// Write an 'ExternModuleOp' to use the hand-coded SystemVerilog module which
+/// packs or serializes messages to adapt the width of a channel. It has the
+/// same ports as the pipeline stage, but the widths of a and x differ.
+HWModuleExternOp ESIHWBuilder::declareGearbox() {
+  if (declaredGearbox)
+    return declaredGearbox;
+
+  auto name = StringAttr::get(getContext(), "ESI_Gearbox");
+  ModulePortInfo ports[] = {{clk, PortDirection::INPUT, getI1Type(), 0},
+                            {rstn, PortDirection::INPUT, getI1Type(), 1},
+                            {a, PortDirection::INPUT, getNoneType(), 2},
+                            {aValid, PortDirection::INPUT, getI1Type(), 3},
+                            {aReady, PortDirection::OUTPUT, getI1Type(), 0},
+                            {x, PortDirection::OUTPUT, getNoneType(), 1},
+                            {xValid, PortDirection::OUTPUT, getI1Type(), 2},
+                            {xReady, PortDirection::INPUT, getI1Type(), 4}};
+  declaredGearbox = create<HWModuleExternOp>(name, ports);
+  return declaredGearbox;
+}
+
 /// Write an 'ExternModuleOp' to use a hand-coded SystemVerilog module. Said
 /// module contains a bi-directional Cosimulation DPI interface with valid/ready
 /// semantics.
@@ -244,9 +312,9 @@ InterfaceOp ESIHWBuilder::constructInterface(ChannelPort chan) {
 //===----------------------------------------------------------------------===//
 
 namespace {
-/// Lower `ChannelBuffer`s, breaking out the various options. For now, just
-/// replace with the specified number of pipeline stages (since that's the only
-/// option).
+/// Lower `ChannelBuffer`s, breaking out the various options. Replace with the
+/// specified number of pipeline stages by default, or with a `ChannelFIFO` if
+/// a FIFO implementation was selected.
 struct ChannelBufferLowering : public OpConversionPattern<ChannelBuffer> {
 public:
   using OpConversionPattern::OpConversionPattern;
@@ -264,6 +332,21 @@ LogicalResult ChannelBufferLowering::matchAndRewrite(
 
   ChannelBufferOptions opts = buffer.options();
   auto type = buffer.getType();
+  StringAttr bufferName = buffer.options().name();
+
+  // FIFO implementations map onto a single physical op. The options have
+  // already been checked by the verifier.
+  StringAttr impl = opts.impl();
+  if (impl && impl.getValue() != "stages") {
+    auto fifo = rewriter.create<ChannelFIFO>(loc, type, buffer.clk(),
+                                             buffer.rstn(), buffer.input(),
+                                             impl, opts.depth(),
+                                             opts.almostFull());
+    if (bufferName)
+      fifo->setAttr("name", bufferName);
+    rewriter.replaceOp(buffer, fifo.output());
+    return success();
+  }
 
   // Expand 'abstract' buffer into 'physical' stages.
   auto stages = opts.stages();
@@ -273,7 +356,6 @@ LogicalResult ChannelBufferLowering::matchAndRewrite(
     numStages = stages.getValue().getLimitedValue();
   }
   Value input = buffer.input();
-  StringAttr bufferName = buffer.options().name();
   for (uint64_t i = 0; i < numStages; ++i) {
     // Create the stages, connecting them up as we build.
     auto stage = rewriter.create<PipelineStage>(loc, type, buffer.clk(),
@@ -331,11 +413,16 @@ private:
 
   bool updateFunc(HWModuleExternOp mod);
   void updateInstance(HWModuleExternOp mod, InstanceOp inst);
+  InterfaceOp getOrConstructInterface(ChannelPort chanTy);
   ESIHWBuilder *build;
+  /// Guards `build` while the instances are updated in parallel.
+  std::mutex buildMutex;
 };
 } // anonymous namespace
 
-/// Iterate through the `hw.module[.extern]`s and lower their ports.
+/// Iterate through the `hw.module[.extern]`s and lower their ports. The new
+/// signatures are computed serially, since they create the shared interfaces.
+/// The instances are then updated in parallel, one module body at a time.
 void ESIPortsPass::runOnOperation() {
   ModuleOp top = getOperation();
   ESIHWBuilder b(top);
@@ -347,30 +434,51 @@ void ESIPortsPass::runOnOperation() {
     if (updateFunc(mod))
       externModsMutated[mod.getName()] = mod;
 
-  // Find all instances and update them.
-  top.walk([&externModsMutated, this](InstanceOp inst) {
-    auto mapIter = externModsMutated.find(inst.moduleName());
-    if (mapIter != externModsMutated.end())
-      updateInstance(mapIter->second, inst);
-  });
-
   // Find all modules and try to modify them to have wires with valid/ready
-  // semantics. Remember the modified ones.
+  // semantics. Remember the modified ones. This only touches the ports and the
+  // body of each module, not its instances.
   DenseMap<StringRef, HWModuleOp> modsMutated;
-  for (auto mod : top.getOps<HWModuleOp>())
+  SmallVector<HWModuleOp> modules;
+  for (auto mod : top.getOps<HWModuleOp>()) {
+    modules.push_back(mod);
     if (updateFunc(mod))
       modsMutated[mod.getName()] = mod;
+  }
 
-  // Find all instances and update them.
-  top.walk([&modsMutated, this](InstanceOp inst) {
-    auto mapIter = modsMutated.find(inst.moduleName());
-    if (mapIter != modsMutated.end())
-      updateInstance(mapIter->second, inst);
-  });
+  // Find all instances and update them. The instances of external modules are
+  // updated first, so the interface instances are named after the original
+  // users of their channels.
+  mlir::parallelForEach(
+      &getContext(), modules.begin(), modules.end(), [&](HWModuleOp mod) {
+        SmallVector<std::pair<HWModuleExternOp, InstanceOp>> externInsts;
+        SmallVector<std::pair<HWModuleOp, InstanceOp>> insts;
+        mod.walk([&](InstanceOp inst) {
+          auto externIter = externModsMutated.find(inst.moduleName());
+          if (externIter != externModsMutated.end()) {
+            externInsts.push_back({externIter->second, inst});
+            return;
+          }
+          auto modIter = modsMutated.find(inst.moduleName());
+          if (modIter != modsMutated.end())
+            insts.push_back({modIter->second, inst});
+        });
+        for (auto &externInst : externInsts)
+          updateInstance(externInst.first, externInst.second);
+        for (auto &inst : insts)
+          updateInstance(inst.first, inst.second);
+      });
 
   build = nullptr;
 }
 
+/// Get the interface of a channel type. The interfaces of all the mutated
+/// external modules exist already, so this only creates one if an instance
+/// doesn't match its module.
+InterfaceOp ESIPortsPass::getOrConstructInterface(ChannelPort chanTy) {
+  std::lock_guard<std::mutex> lock(buildMutex);
+  return build->getOrConstructInterface(chanTy);
+}
+
 /// Return a attribute with the specified suffix appended.
 static StringAttr appendToRtlName(StringAttr base, StringRef suffix) {
   auto *context = base.getContext();
@@ -505,7 +613,7 @@ bool ESIPortsPass::updateFunc(HWModuleOp mod) {
 /// pass.
 void ESIPortsPass::updateInstance(HWModuleOp mod, InstanceOp inst) {
   ImplicitLocOpBuilder b(inst.getLoc(), inst);
-  BackedgeBuilder beb(b, inst.getLoc());
+  BackedgeBuilder beb(b, inst.getLoc(), /*bulk=*/true);
   Type i1 = b.getI1Type();
 
   // -----
@@ -707,7 +815,7 @@ void ESIPortsPass::updateInstance(HWModuleExternOp mod, InstanceOp inst) {
 
     // Get the interface from the cache, and make sure it's the same one as
     // being used in the module.
-    auto iface = build->getOrConstructInterface(instChanTy);
+    auto iface = getOrConstructInterface(instChanTy);
     if (iface.getModportType(ESIHWBuilder::sourceStr) !=
         funcTy.getInput(opNum)) {
       inst.emitOpError("ESI ChannelPort (operand #")
@@ -752,7 +860,7 @@ void ESIPortsPass::updateInstance(HWModuleExternOp mod, InstanceOp inst) {
 
     // Get the interface from the cache, and make sure it's the same one as
     // being used in the module.
-    auto iface = build->getOrConstructInterface(instChanTy);
+    auto iface = getOrConstructInterface(instChanTy);
     if (iface.getModportType(ESIHWBuilder::sinkStr) != funcTy.getInput(opNum)) {
       inst.emitOpError("ESI ChannelPort (result #")
           << resNum << ", operand #" << opNum << ") doesn't match module!";
@@ -822,40 +930,36 @@ private:
 };
 } // anonymous namespace
 
-LogicalResult PipelineStageLowering::matchAndRewrite(
-    PipelineStage stage, ArrayRef<Value> stageOperands,
-    ConversionPatternRewriter &rewriter) const {
-  auto loc = stage.getLoc();
-  auto chPort = stage.input().getType().dyn_cast<ChannelPort>();
+/// Instantiate `bufferModule`, which has the ports of ESI_PipelineStage, on
+/// the channel `input` and return the buffered channel. The output channel has
+/// the type of the input unless `chPort` is specified.
+static Value instantiateBuffer(ConversionPatternRewriter &rewriter,
+                               Location loc, HWModuleExternOp bufferModule,
+                               StringRef instName, DictionaryAttr params,
+                               Value clk, Value rstn, Value input,
+                               ChannelPort chPort = {}) {
   if (!chPort)
-    return failure();
-  auto stageModule = builder.declareStage();
-
-  NamedAttrList stageParams;
-  size_t width = circt::hw::getBitWidth(chPort.getInner());
-  stageParams.set(builder.width, rewriter.getUI32IntegerAttr(width));
+    chPort = input.getType().cast<ChannelPort>();
 
   // Unwrap the channel. The ready signal is a Value we haven't created yet, so
   // create a temp value and replace it later. Give this constant an odd-looking
   // type to make debugging easier.
   circt::BackedgeBuilder back(rewriter, loc);
   circt::Backedge wrapReady = back.get(rewriter.getI1Type());
-  auto unwrap =
-      rewriter.create<UnwrapValidReady>(loc, stage.input(), wrapReady);
+  auto unwrap = rewriter.create<UnwrapValidReady>(loc, input, wrapReady);
 
-  StringRef pipeStageName = "pipelineStage";
-  if (auto name = stage->getAttrOfType<StringAttr>("name"))
-    pipeStageName = name.getValue();
-
-  // Instantiate the "ESI_PipelineStage" external module.
+  // Instantiate the external module.
   circt::Backedge stageReady = back.get(rewriter.getI1Type());
-  Value operands[] = {stage.clk(), stage.rstn(), unwrap.rawOutput(),
-                      unwrap.valid(), stageReady};
-  Type resultTypes[] = {rewriter.getI1Type(), unwrap.rawOutput().getType(),
-                        rewriter.getI1Type()};
+  Value operands[] = {clk, rstn, unwrap.rawOutput(), unwrap.valid(),
+                      stageReady};
+  SmallVector<Type, 4> resultTypes = {
+      rewriter.getI1Type(), chPort.getInner(), rewriter.getI1Type()};
+  // Any additional outputs are status flags, which are left unused.
+  resultTypes.resize(getModuleType(bufferModule).getNumResults(),
+                     rewriter.getI1Type());
   auto stageInst = rewriter.create<InstanceOp>(
-      loc, resultTypes, pipeStageName, stageModule.getName(), operands,
-      stageParams.getDictionary(rewriter.getContext()), StringAttr());
+      loc, resultTypes, instName, bufferModule.getName(), operands, params,
+      StringAttr());
   auto stageInstResults = stageInst.getResults();
 
   // Set a_ready (from the unwrap) back edge correctly to its output from stage.
@@ -869,8 +973,130 @@ LogicalResult PipelineStageLowering::matchAndRewrite(
                                               x, xValid);
   // Set the stages x_ready backedge correctly.
   stageReady.setValue(wrap.ready());
+  return wrap.chanOutput();
+}
+
+LogicalResult PipelineStageLowering::matchAndRewrite(
+    PipelineStage stage, ArrayRef<Value> stageOperands,
+    ConversionPatternRewriter &rewriter) const {
+  auto loc = stage.getLoc();
+  auto chPort = stage.input().getType().dyn_cast<ChannelPort>();
+  if (!chPort)
+    return failure();
+  auto stageModule = builder.declareStage();
+
+  NamedAttrList stageParams;
+  size_t width = circt::hw::getBitWidth(chPort.getInner());
+  stageParams.set(builder.width, rewriter.getUI32IntegerAttr(width));
+
+  StringRef pipeStageName = "pipelineStage";
+  if (auto name = stage->getAttrOfType<StringAttr>("name"))
+    pipeStageName = name.getValue();
+
+  // Instantiate the "ESI_PipelineStage" external module.
+  Value output = instantiateBuffer(
+      rewriter, loc, stageModule, pipeStageName,
+      stageParams.getDictionary(rewriter.getContext()), stage.clk(),
+      stage.rstn(), stage.input());
+  rewriter.replaceOp(stage, output);
+  return success();
+}
+
+namespace {
+/// Lower ChannelFIFO ops to the HW implementation selected by their `impl`
+/// attribute, the same way as PipelineStages.
+struct ChannelFIFOLowering : public OpConversionPattern<ChannelFIFO> {
+public:
+  ChannelFIFOLowering(ESIHWBuilder &builder, MLIRContext *ctxt)
+      : OpConversionPattern(ctxt), builder(builder) {}
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(ChannelFIFO fifo, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const final;
+
+private:
+  ESIHWBuilder &builder;
+};
+} // anonymous namespace
+
+LogicalResult ChannelFIFOLowering::matchAndRewrite(
+    ChannelFIFO fifo, ArrayRef<Value> fifoOperands,
+    ConversionPatternRewriter &rewriter) const {
+  auto loc = fifo.getLoc();
+  auto chPort = fifo.input().getType().dyn_cast<ChannelPort>();
+  if (!chPort)
+    return failure();
+  auto fifoModule = builder.declareFIFO(fifo.impl());
 
-  rewriter.replaceOp(stage, wrap.chanOutput());
+  NamedAttrList fifoParams;
+  size_t width = circt::hw::getBitWidth(chPort.getInner());
+  fifoParams.set(builder.width, rewriter.getUI32IntegerAttr(width));
+  if (auto depth = fifo.depth()) {
+    fifoParams.set(builder.depth, rewriter.getUI32IntegerAttr(*depth));
+    // The elastic buffer fills up completely unless told otherwise.
+    if (fifo.impl() == "elastic") {
+      uint64_t almostFull = fifo.almostFull().getValueOr(*depth);
+      fifoParams.set(builder.almostFull,
+                     rewriter.getUI32IntegerAttr(almostFull));
+    }
+  }
+
+  StringRef fifoName = "fifo";
+  if (auto name = fifo->getAttrOfType<StringAttr>("name"))
+    fifoName = name.getValue();
+
+  Value output = instantiateBuffer(
+      rewriter, loc, fifoModule, fifoName,
+      fifoParams.getDictionary(rewriter.getContext()), fifo.clk(),
+      fifo.rstn(), fifo.input());
+  rewriter.replaceOp(fifo, output);
+  return success();
+}
+
+namespace {
+/// Lower ChannelGearbox ops to the HW implementation of the width adaptation,
+/// the same way as PipelineStages.
+struct ChannelGearboxLowering : public OpConversionPattern<ChannelGearbox> {
+public:
+  ChannelGearboxLowering(ESIHWBuilder &builder, MLIRContext *ctxt)
+      : OpConversionPattern(ctxt), builder(builder) {}
+  using OpConversionPattern::OpConversionPattern;
+
+  LogicalResult
+  matchAndRewrite(ChannelGearbox gearbox, ArrayRef<Value> operands,
+                  ConversionPatternRewriter &rewriter) const final;
+
+private:
+  ESIHWBuilder &builder;
+};
+} // anonymous namespace
+
+LogicalResult ChannelGearboxLowering::matchAndRewrite(
+    ChannelGearbox gearbox, ArrayRef<Value> gearboxOperands,
+    ConversionPatternRewriter &rewriter) const {
+  auto loc = gearbox.getLoc();
+  auto inPort = gearbox.input().getType().dyn_cast<ChannelPort>();
+  auto outPort = gearbox.output().getType().dyn_cast<ChannelPort>();
+  if (!inPort || !outPort)
+    return failure();
+  auto gearboxModule = builder.declareGearbox();
+
+  NamedAttrList gearboxParams;
+  size_t inWidth = circt::hw::getBitWidth(inPort.getInner());
+  size_t outWidth = circt::hw::getBitWidth(outPort.getInner());
+  gearboxParams.set(builder.inWidth, rewriter.getUI32IntegerAttr(inWidth));
+  gearboxParams.set(builder.outWidth, rewriter.getUI32IntegerAttr(outWidth));
+
+  StringRef gearboxName = "gearbox";
+  if (auto name = gearbox->getAttrOfType<StringAttr>("name"))
+    gearboxName = name.getValue();
+
+  Value output = instantiateBuffer(
+      rewriter, loc, gearboxModule, gearboxName,
+      gearboxParams.getDictionary(rewriter.getContext()), gearbox.clk(),
+      gearbox.rstn(), gearbox.input(), outPort);
+  rewriter.replaceOp(gearbox, output);
   return success();
 }
 
@@ -1051,8 +1277,9 @@ namespace {
 /// gasket op.
 struct CosimLowering : public OpConversionPattern<CosimEndpoint> {
 public:
-  CosimLowering(ESIHWBuilder &b)
-      : OpConversionPattern(b.getContext(), 1), builder(b) {}
+  CosimLowering(ESIHWBuilder &b, bool pollOnPending, bool packed)
+      : OpConversionPattern(b.getContext(), 1), builder(b),
+        pollOnPending(pollOnPending), packed(packed) {}
 
   using OpConversionPattern::OpConversionPattern;
 
@@ -1062,6 +1289,11 @@ public:
 
 private:
   ESIHWBuilder &builder;
+  /// Gate the endpoint polling on the server having a message pending.
+  bool pollOnPending;
+  /// Exchange the packed bits of the messages, which the DPI server wraps in
+  /// `UntypedData` messages for the clients, instead of Cap'nProto messages.
+  bool packed;
 };
 } // anonymous namespace
 
@@ -1070,6 +1302,8 @@ CosimLowering::matchAndRewrite(CosimEndpoint ep, ArrayRef<Value> operands,
                                ConversionPatternRewriter &rewriter) const {
 #ifndef CAPNP
   (void)builder;
+  (void)pollOnPending;
+  (void)packed;
   return rewriter.notifyMatchFailure(
       ep, "Cosim lowering requires the ESI capnp plugin, which was disabled.");
 #else
@@ -1095,32 +1329,48 @@ CosimLowering::matchAndRewrite(CosimEndpoint ep, ArrayRef<Value> operands,
   params.set("ENDPOINT_ID", rewriter.getI32IntegerAttr(ep.endpointID()));
   params.set("SEND_TYPE_ID",
              IntegerAttr::get(ui64Type, sendTypeSchema.capnpTypeID()));
-  params.set("SEND_TYPE_SIZE_BITS",
-             rewriter.getI32IntegerAttr(sendTypeSchema.size()));
   params.set("RECV_TYPE_ID",
              IntegerAttr::get(ui64Type, recvTypeSchema.capnpTypeID()));
-  params.set("RECV_TYPE_SIZE_BITS",
-             rewriter.getI32IntegerAttr(recvTypeSchema.size()));
+  if (pollOnPending)
+    params.set("POLL_ON_PENDING", rewriter.getBoolAttr(true));
+
+  // The packed messages are just the bits of the values, so they don't need
+  // any encoding logic. They are still described by the capnp type IDs.
+  size_t sendSize = sendTypeSchema.size();
+  size_t recvSize = recvTypeSchema.size();
+  if (packed) {
+    sendSize = hw::getBitWidth(sendTypeSchema.getType());
+    recvSize = hw::getBitWidth(recvTypeSchema.getType());
+    params.set("PACKED", rewriter.getBoolAttr(true));
+  }
+  params.set("SEND_TYPE_SIZE_BITS", rewriter.getI32IntegerAttr(sendSize));
+  params.set("RECV_TYPE_SIZE_BITS", rewriter.getI32IntegerAttr(recvSize));
 
   // Set up the egest route to drive the EP's send ports.
-  ArrayType egestBitArrayType =
-      ArrayType::get(rewriter.getI1Type(), sendTypeSchema.size());
+  ArrayType egestBitArrayType = ArrayType::get(rewriter.getI1Type(), sendSize);
   auto sendReady = bb.get(rewriter.getI1Type());
   UnwrapValidReady unwrapSend =
       rewriter.create<UnwrapValidReady>(loc, send, sendReady);
-  auto encodeData = rewriter.create<CapnpEncode>(
-      loc, egestBitArrayType, clk, unwrapSend.valid(), unwrapSend.rawOutput());
+  Value sendBits;
+  if (packed)
+    sendBits = rewriter.create<hw::BitcastOp>(loc, egestBitArrayType,
+                                              unwrapSend.rawOutput());
+  else
+    sendBits = rewriter
+                   .create<CapnpEncode>(loc, egestBitArrayType, clk,
+                                        unwrapSend.valid(),
+                                        unwrapSend.rawOutput())
+                   .capnpBits();
 
   // Get information necessary for injest path.
   auto recvReady = bb.get(rewriter.getI1Type());
-  ArrayType ingestBitArrayType =
-      ArrayType::get(rewriter.getI1Type(), recvTypeSchema.size());
+  ArrayType ingestBitArrayType = ArrayType::get(rewriter.getI1Type(), recvSize);
 
   // Create replacement Cosim_Endpoint instance.
   StringAttr nameAttr = ep->getAttr("name").dyn_cast_or_null<StringAttr>();
   StringRef name = nameAttr ? nameAttr.getValue() : "cosimEndpoint";
   Value epInstInputs[] = {
-      clk, rstn, recvReady, unwrapSend.valid(), encodeData.capnpBits(),
+      clk, rstn, recvReady, unwrapSend.valid(), sendBits,
   };
   Type epInstOutputs[] = {rewriter.getI1Type(), ingestBitArrayType,
                           rewriter.getI1Type()};
@@ -1132,11 +1382,17 @@ CosimLowering::matchAndRewrite(CosimEndpoint ep, ArrayRef<Value> operands,
   // Set up the injest path.
   Value recvDataFromCosim = cosimEpModule.getResult(1);
   Value recvValidFromCosim = cosimEpModule.getResult(0);
-  auto decodeData =
-      rewriter.create<CapnpDecode>(loc, recvTypeSchema.getType(), clk,
-                                   recvValidFromCosim, recvDataFromCosim);
-  WrapValidReady wrapRecv = rewriter.create<WrapValidReady>(
-      loc, decodeData.decodedData(), recvValidFromCosim);
+  Value recvData;
+  if (packed)
+    recvData = rewriter.create<hw::BitcastOp>(loc, recvTypeSchema.getType(),
+                                              recvDataFromCosim);
+  else
+    recvData = rewriter
+                   .create<CapnpDecode>(loc, recvTypeSchema.getType(), clk,
+                                        recvValidFromCosim, recvDataFromCosim)
+                   .decodedData();
+  WrapValidReady wrapRecv =
+      rewriter.create<WrapValidReady>(loc, recvData, recvValidFromCosim);
   recvReady.setValue(wrapRecv.ready());
 
   // Replace the CosimEndpoint op.
@@ -1204,44 +1460,473 @@ void ESItoHWPass::runOnOperation() {
   auto top = getOperation();
   auto ctxt = &getContext();
 
-  // Set up a conversion and give it a set of laws.
-  ConversionTarget pass1Target(*ctxt);
-  pass1Target.addLegalDialect<CombDialect>();
-  pass1Target.addLegalDialect<HWDialect>();
-  pass1Target.addLegalDialect<SVDialect>();
-  pass1Target.addLegalOp<WrapValidReady, UnwrapValidReady>();
-  pass1Target.addLegalOp<CapnpDecode, CapnpEncode>();
-
-  pass1Target.addIllegalOp<WrapSVInterface, UnwrapSVInterface>();
-  pass1Target.addIllegalOp<PipelineStage>();
+  // The patterns only touch the module they run on, except for the external
+  // modules they instantiate, so declare those up front. The modules are then
+  // lowered in parallel.
+  ESIHWBuilder esiBuilder(top);
+  SmallVector<HWModuleOp> modules;
+  bool hasStage = false, hasGearbox = false, hasCosim = false;
+  llvm::SetVector<StringRef> fifoImpls;
+  for (auto mod : top.getOps<HWModuleOp>()) {
+    modules.push_back(mod);
+    mod.walk([&](Operation *op) {
+      hasStage |= isa<PipelineStage>(op);
+      hasGearbox |= isa<ChannelGearbox>(op);
+      hasCosim |= isa<CosimEndpoint>(op);
+      if (auto fifo = dyn_cast<ChannelFIFO>(op))
+        fifoImpls.insert(fifo.impl());
+    });
+  }
+  if (hasStage)
+    esiBuilder.declareStage();
+  for (auto impl : fifoImpls)
+    esiBuilder.declareFIFO(impl);
+  if (hasGearbox)
+    esiBuilder.declareGearbox();
+#ifdef CAPNP
+  if (hasCosim)
+    esiBuilder.declareCosimEndpoint();
+#else
+  (void)hasCosim;
+#endif
 
   // Add all the conversion patterns.
-  ESIHWBuilder esiBuilder(top);
-  RewritePatternSet pass1Patterns(ctxt);
-  pass1Patterns.insert<PipelineStageLowering>(esiBuilder, ctxt);
-  pass1Patterns.insert<WrapInterfaceLower>(ctxt);
-  pass1Patterns.insert<UnwrapInterfaceLower>(ctxt);
-  pass1Patterns.insert<CosimLowering>(esiBuilder);
-  pass1Patterns.insert<NullSourceOpLowering>(ctxt);
+  RewritePatternSet pass1Set(ctxt);
+  pass1Set.insert<PipelineStageLowering>(esiBuilder, ctxt);
+  pass1Set.insert<ChannelFIFOLowering>(esiBuilder, ctxt);
+  pass1Set.insert<ChannelGearboxLowering>(esiBuilder, ctxt);
+  pass1Set.insert<WrapInterfaceLower>(ctxt);
+  pass1Set.insert<UnwrapInterfaceLower>(ctxt);
+  pass1Set.insert<CosimLowering>(esiBuilder, cosimPollOnPending, cosimPacked);
+  pass1Set.insert<NullSourceOpLowering>(ctxt);
+  FrozenRewritePatternSet pass1Patterns(std::move(pass1Set));
+
+  RewritePatternSet pass2Set(ctxt);
+  pass2Set.insert<RemoveWrapUnwrap>(ctxt);
+  FrozenRewritePatternSet pass2Patterns(std::move(pass2Set));
+
+  // The Cap'nProto gaskets of each module are lowered last, serially, since
+  // they build modules shared by all the gaskets of the same type.
+  std::vector<SmallVector<Operation *, 2>> gaskets(modules.size());
+  std::atomic<bool> anyFailed(false);
+  auto lowerModule = [&](size_t index) {
+    HWModuleOp mod = modules[index];
+
+    // Set up a conversion and give it a set of laws.
+    ConversionTarget pass1Target(*ctxt);
+    pass1Target.addLegalDialect<CombDialect>();
+    pass1Target.addLegalDialect<HWDialect>();
+    pass1Target.addLegalDialect<SVDialect>();
+    pass1Target.addLegalOp<WrapValidReady, UnwrapValidReady>();
+    pass1Target.addLegalOp<CapnpDecode, CapnpEncode>();
+
+    pass1Target.addIllegalOp<WrapSVInterface, UnwrapSVInterface>();
+    pass1Target.addIllegalOp<PipelineStage, ChannelFIFO, ChannelGearbox>();
+
+    // Run the conversion.
+    if (failed(applyPartialConversion(mod, pass1Target, pass1Patterns)))
+      anyFailed = true;
+
+    ConversionTarget pass2Target(*ctxt);
+    pass2Target.addLegalDialect<CombDialect>();
+    pass2Target.addLegalDialect<HWDialect>();
+    pass2Target.addLegalDialect<SVDialect>();
+    pass2Target.addIllegalDialect<ESIDialect>();
+    pass2Target.addLegalOp<CapnpDecode, CapnpEncode>();
+    if (failed(applyPartialConversion(mod, pass2Target, pass2Patterns)))
+      anyFailed = true;
+
+    mod.walk([&](Operation *op) {
+      if (isa<CapnpDecode, CapnpEncode>(op))
+        gaskets[index].push_back(op);
+    });
+  };
+  mlir::parallelForEachN(ctxt, 0, modules.size(), lowerModule);
+  if (anyFailed)
+    signalPassFailure();
 
-  // Run the conversion.
-  if (failed(
-          applyPartialConversion(top, pass1Target, std::move(pass1Patterns))))
+  SmallVector<Operation *> allGaskets;
+  for (auto &modGaskets : gaskets)
+    allGaskets.append(modGaskets.begin(), modGaskets.end());
+  if (allGaskets.empty())
+    return;
+
+  ConversionTarget pass3Target(*ctxt);
+  pass3Target.addLegalDialect<CombDialect>();
+  pass3Target.addLegalDialect<HWDialect>();
+  pass3Target.addLegalDialect<SVDialect>();
+  pass3Target.addIllegalDialect<ESIDialect>();
+
+  RewritePatternSet pass3Patterns(ctxt);
+  pass3Patterns.insert<EncoderLowering>(ctxt);
+  pass3Patterns.insert<DecoderLowering>(ctxt);
+  if (failed(applyPartialConversion(allGaskets, pass3Target,
+                                    std::move(pass3Patterns))))
     signalPassFailure();
+}
 
-  ConversionTarget pass2Target(*ctxt);
-  pass2Target.addLegalDialect<CombDialect>();
-  pass2Target.addLegalDialect<HWDialect>();
-  pass2Target.addLegalDialect<SVDialect>();
-  pass2Target.addIllegalDialect<ESIDialect>();
+//===----------------------------------------------------------------------===//
+// Channel analysis pass.
+//===----------------------------------------------------------------------===//
 
-  RewritePatternSet pass2Patterns(ctxt);
-  pass2Patterns.insert<RemoveWrapUnwrap>(ctxt);
-  pass2Patterns.insert<EncoderLowering>(ctxt);
-  pass2Patterns.insert<DecoderLowering>(ctxt);
-  if (failed(
-          applyPartialConversion(top, pass2Target, std::move(pass2Patterns))))
-    signalPassFailure();
+namespace {
+/// A node of the channel graph of a module: an ESI operation with channel
+/// operands or results. The edges follow the flow of tokens, along the
+/// channels and from each `unwrap.vr` to the `wrap.vr`s whose inputs it feeds
+/// through the logic of the module.
+struct ChannelNode {
+  Operation *op = nullptr;
+  /// The number of cycles a token spends in the node.
+  uint64_t latency = 0;
+  /// The number of tokens the node can hold.
+  uint64_t capacity = 0;
+  SmallVector<ChannelNode *, 2> succs;
+  SmallVector<ChannelNode *, 2> preds;
+  /// The index of the strongly connected component the node belongs to.
+  unsigned scc = 0;
+};
+
+/// The latency and slack of the paths from a fork to a node.
+struct ForkPathInfo {
+  uint64_t minLatency, maxLatency;
+  /// The smallest number of tokens held by one of the paths.
+  uint64_t minCapacity;
+};
+
+/// The paths from each fork to each node reachable from it.
+using ForkPathMap =
+    DenseMap<ChannelNode *, DenseMap<ChannelNode *, ForkPathInfo>>;
+
+/// The channel graph of a module, with a root node pointing to all the others
+/// so that it can be traversed in one go.
+struct ChannelGraph {
+  ChannelGraph(HWModuleOp mod);
+
+  ChannelNode root;
+  std::vector<std::unique_ptr<ChannelNode>> nodes;
+  DenseMap<Operation *, ChannelNode *> nodeMap;
+
+private:
+  void addLogicEdges(ChannelNode *unwrap);
+};
+} // anonymous namespace
+
+namespace llvm {
+template <>
+struct GraphTraits<ChannelNode *> {
+  using NodeRef = ChannelNode *;
+  using ChildIteratorType = SmallVectorImpl<ChannelNode *>::iterator;
+
+  static NodeRef getEntryNode(NodeRef node) { return node; }
+  static ChildIteratorType child_begin(NodeRef node) {
+    return node->succs.begin();
+  }
+  static ChildIteratorType child_end(NodeRef node) { return node->succs.end(); }
+};
+} // namespace llvm
+
+/// Return true if the specified operation belongs to the ESI dialect.
+static bool isESIOp(Operation *op) {
+  return op->getDialect() &&
+         op->getDialect()->getNamespace() == ESIDialect::getDialectNamespace();
+}
+
+/// Return true if the operation belongs in the channel graph.
+static bool isChannelNode(Operation *op) {
+  if (!isESIOp(op))
+    return false;
+  auto isChannel = [](Type type) { return type.isa<ChannelPort>(); };
+  return llvm::any_of(op->getOperandTypes(), isChannel) ||
+         llvm::any_of(op->getResultTypes(), isChannel);
+}
+
+/// Set the latency and capacity of a FIFO-based buffer implementation. These
+/// match the primitives in ESIPrimitives.sv.
+static void getFIFOProperties(StringRef impl, uint64_t depth,
+                              ChannelNode &node) {
+  if (impl == "skid") {
+    node.latency = 0;
+    node.capacity = 1;
+  } else if (impl == "elastic") {
+    node.latency = 2;
+    node.capacity = depth + 1;
+  } else {
+    node.latency = 1;
+    node.capacity = depth + 1;
+  }
+}
+
+/// Set the latency and capacity of a channel graph node from its operation.
+/// Pipeline stages are double buffered, gearboxes hold one output message, and
+/// the rest of the ESI operations other than buffers don't hold tokens.
+static void getNodeProperties(ChannelNode &node) {
+  TypeSwitch<Operation *>(node.op)
+      .Case([&](ChannelBuffer buffer) {
+        ChannelBufferOptions opts = buffer.options();
+        if (opts.impl() && opts.impl().getValue() != "stages") {
+          uint64_t depth = opts.depth() ? opts.depth().getInt() : 0;
+          getFIFOProperties(opts.impl().getValue(), depth, node);
+          return;
+        }
+        uint64_t stages = opts.stages() ? opts.stages().getInt() : 1;
+        node.latency = stages;
+        node.capacity = 2 * stages;
+      })
+      .Case([&](PipelineStage) {
+        node.latency = 1;
+        node.capacity = 2;
+      })
+      .Case([&](ChannelFIFO fifo) {
+        getFIFOProperties(fifo.impl(), fifo.depth().getValueOr(0), node);
+      })
+      .Case([&](ChannelGearbox) {
+        node.latency = 1;
+        node.capacity = 1;
+      });
+}
+
+ChannelGraph::ChannelGraph(HWModuleOp mod) {
+  mod.walk([&](Operation *op) {
+    if (!isChannelNode(op))
+      return;
+    nodes.push_back(std::make_unique<ChannelNode>());
+    auto *node = nodes.back().get();
+    node->op = op;
+    getNodeProperties(*node);
+    nodeMap[op] = node;
+    root.succs.push_back(node);
+  });
+
+  for (auto &node : nodes) {
+    for (auto result : node->op->getResults()) {
+      if (!result.getType().isa<ChannelPort>())
+        continue;
+      for (auto *user : result.getUsers()) {
+        auto *succ = nodeMap.lookup(user);
+        if (!succ)
+          continue;
+        node->succs.push_back(succ);
+        succ->preds.push_back(node.get());
+      }
+    }
+    if (isa<UnwrapValidReady>(node->op))
+      addLogicEdges(node.get());
+  }
+}
+
+/// Add an edge from an `unwrap.vr` to each `wrap.vr` whose data or valid
+/// signal depends on its outputs. Only the logic within the module is
+/// followed: instances are opaque, and the latency of the logic is ignored.
+void ChannelGraph::addLogicEdges(ChannelNode *unwrap) {
+  SmallVector<Value, 8> worklist(unwrap->op->result_begin(),
+                                 unwrap->op->result_end());
+  SmallPtrSet<Operation *, 16> visited;
+  while (!worklist.empty()) {
+    Value value = worklist.pop_back_val();
+    for (auto *user : value.getUsers()) {
+      if (!visited.insert(user).second)
+        continue;
+      if (isa<WrapValidReady>(user)) {
+        auto *wrap = nodeMap.lookup(user);
+        unwrap->succs.push_back(wrap);
+        wrap->preds.push_back(unwrap);
+        continue;
+      }
+      if (isESIOp(user) || isa<InstanceOp>(user))
+        continue;
+      worklist.append(user->result_begin(), user->result_end());
+    }
+  }
+}
+
+/// Format a throughput estimate for diagnostics.
+static std::string formatRate(double rate) {
+  return llvm::formatv("{0:F2}", rate).str();
+}
+
+namespace {
+/// Estimate the latency and throughput of the channels of each module from the
+/// latency and capacity of the buffers along them, and warn about the loops and
+/// reconvergent paths which can't sustain one token per cycle.
+struct ESIChannelAnalysisPass
+    : public ESIChannelAnalysisBase<ESIChannelAnalysisPass> {
+  void runOnOperation() override;
+
+private:
+  void analyzeModule(HWModuleOp mod);
+  double analyzeLoop(ArrayRef<ChannelNode *> scc);
+  double analyzeJoin(ChannelNode *join, ForkPathMap &forkPaths);
+};
+} // anonymous namespace
+
+/// Estimate the throughput of a loop and warn if it is less than one token per
+/// cycle. To keep moving, a loop needs both tokens and empty slots, so at best
+/// half of its slots hold tokens.
+double ESIChannelAnalysisPass::analyzeLoop(ArrayRef<ChannelNode *> scc) {
+  uint64_t latency = 0, capacity = 0;
+  ChannelNode *first = scc.front();
+  for (auto *node : scc) {
+    latency += node->latency;
+    capacity += node->capacity;
+    if (node->op->isBeforeInBlock(first->op))
+      first = node;
+  }
+
+  if (capacity != 0 && latency != 0 && capacity / 2 >= latency)
+    return 1.0;
+
+  double rate = 1.0;
+  auto diag = first->op->emitWarning();
+  if (capacity == 0) {
+    rate = 0.0;
+    diag << "channel loop has no buffering and deadlocks";
+  } else if (latency == 0) {
+    diag << "channel loop has no pipeline stage, so its valid path is "
+            "combinational";
+  } else {
+    rate = (double)(capacity / 2) / latency;
+    diag << "channel loop is underbuffered: " << capacity << " slots over "
+         << latency << " cycles of latency sustain at most "
+         << formatRate(rate) << " tokens/cycle";
+  }
+  for (auto *node : scc)
+    if (node != first)
+      diag.attachNote(node->op->getLoc()) << "part of the loop";
+  return rate;
+}
+
+/// Estimate the throughput of the paths which reconverge at a node and warn if
+/// it is less than one token per cycle. The tokens of every path wait for the
+/// slowest one, so each path needs as many slots as its longest latency.
+double ESIChannelAnalysisPass::analyzeJoin(ChannelNode *join,
+                                           ForkPathMap &forkPaths) {
+  // Gather the paths from each fork through each predecessor.
+  llvm::MapVector<ChannelNode *, SmallVector<ForkPathInfo, 2>> branches;
+  for (auto *pred : join->preds) {
+    if (pred->scc == join->scc)
+      continue;
+    if (pred->succs.size() > 1)
+      branches[pred].push_back({0, 0, 0});
+    for (auto &it : forkPaths[pred])
+      branches[it.first].push_back(it.second);
+  }
+
+  double rate = 1.0;
+  for (auto &it : branches) {
+    if (it.second.size() < 2)
+      continue;
+    uint64_t minLatency = ~0ULL, maxLatency = 0, minCapacity = ~0ULL;
+    for (auto &branch : it.second) {
+      minLatency = std::min(minLatency, branch.minLatency);
+      maxLatency = std::max(maxLatency, branch.maxLatency);
+      minCapacity = std::min(minCapacity, branch.minCapacity);
+    }
+    if (minCapacity >= maxLatency)
+      continue;
+    // The head of each path can always hold one token.
+    double forkRate = (double)(minCapacity + 1) / (maxLatency + 1);
+    auto diag = join->op->emitWarning(
+        "reconvergent channels are underbuffered: paths of ");
+    diag << minLatency << " to " << maxLatency
+         << " cycles of latency with as few as " << minCapacity
+         << " slots sustain at most " << formatRate(forkRate)
+         << " tokens/cycle";
+    diag.attachNote(it.first->op->getLoc()) << "the paths fork here";
+    rate = std::min(rate, forkRate);
+  }
+  return rate;
+}
+
+void ESIChannelAnalysisPass::analyzeModule(HWModuleOp mod) {
+  ChannelGraph graph(mod);
+
+  // The SCCs come out in post order, reverse them to visit the predecessors
+  // of each node first. The root is in an SCC of its own, which comes last.
+  std::vector<std::vector<ChannelNode *>> sccs;
+  for (auto it = llvm::scc_begin(&graph.root); !it.isAtEnd(); ++it) {
+    if (it->front() == &graph.root)
+      continue;
+    for (auto *node : *it)
+      node->scc = sccs.size();
+    sccs.push_back(*it);
+  }
+  std::reverse(sccs.begin(), sccs.end());
+
+  DenseMap<ChannelNode *, uint64_t> latencies;
+  DenseMap<ChannelNode *, double> rates;
+  ForkPathMap forkPaths;
+  for (auto &scc : sccs) {
+    bool isLoop = scc.size() > 1 || llvm::is_contained(scc.front()->succs,
+                                                       scc.front());
+    double loopRate = isLoop ? analyzeLoop(scc) : 1.0;
+    // The tokens of a loop go all the way around it.
+    uint64_t loopLatency = 0;
+    if (isLoop)
+      for (auto *node : scc)
+        loopLatency += node->latency;
+
+    for (auto *node : scc) {
+      // Accumulate the latency, throughput, and fork paths of the
+      // predecessors outside of the SCC.
+      uint64_t latency = 0;
+      double rate = loopRate;
+      DenseMap<ChannelNode *, ForkPathInfo> paths;
+      auto addPath = [&](ChannelNode *fork, ForkPathInfo info) {
+        info.minLatency += node->latency;
+        info.maxLatency += node->latency;
+        info.minCapacity += node->capacity;
+        auto it = paths.try_emplace(fork, info);
+        if (it.second)
+          return;
+        auto &path = it.first->second;
+        path.minLatency = std::min(path.minLatency, info.minLatency);
+        path.maxLatency = std::max(path.maxLatency, info.maxLatency);
+        path.minCapacity = std::min(path.minCapacity, info.minCapacity);
+      };
+      for (auto *pred : node->preds) {
+        if (pred->scc == node->scc)
+          continue;
+        latency = std::max(latency, latencies[pred]);
+        rate = std::min(rate, rates[pred]);
+        if (pred->succs.size() > 1)
+          addPath(pred, {0, 0, 0});
+        for (auto &it : forkPaths[pred])
+          addPath(it.first, it.second);
+      }
+      if (node->preds.size() > 1)
+        rate = std::min(rate, analyzeJoin(node, forkPaths));
+      forkPaths[node] = std::move(paths);
+      latencies[node] = latency + (isLoop ? loopLatency : node->latency);
+      rates[node] = rate;
+    }
+  }
+
+  if (!report)
+    return;
+
+  // Report the channels at the boundaries of the graph: the ones unwrapped or
+  // used by anything other than an ESI operation.
+  for (auto &node : graph.nodes) {
+    Operation *op = node->op;
+    bool isSink = isa<UnwrapValidReady, UnwrapSVInterface, CosimEndpoint>(op);
+    for (auto result : op->getResults())
+      if (result.getType().isa<ChannelPort>())
+        for (auto *user : result.getUsers())
+          isSink |= !graph.nodeMap.count(user);
+    if (!isSink)
+      continue;
+    double rate = rates[node.get()];
+    op->emitRemark("channel latency: ")
+        << latencies[node.get()] << " cycles, throughput: at most "
+        << formatRate(rate) << " tokens/cycle ("
+        << llvm::formatv("{0:F0}", (1.0 - rate) * 100).str() << "% bubbles)";
+  }
+}
+
+void ESIChannelAnalysisPass::runOnOperation() {
+  for (auto mod : getOperation().getOps<HWModuleOp>())
+    analyzeModule(mod);
+  markAllAnalysesPreserved();
 }
 
 namespace circt {
@@ -1255,6 +1940,9 @@ std::unique_ptr<OperationPass<ModuleOp>> createESIPortLoweringPass() {
 std::unique_ptr<OperationPass<ModuleOp>> createESItoHWPass() {
   return std::make_unique<ESItoHWPass>();
 }
+std::unique_ptr<OperationPass<ModuleOp>> createESIChannelAnalysisPass() {
+  return std::make_unique<ESIChannelAnalysisPass>();
+}
 
 } // namespace esi
 } // namespace circt
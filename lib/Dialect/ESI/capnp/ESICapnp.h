@@ -68,10 +68,12 @@ public:
   /// Write out the schema in its entirety.
   mlir::LogicalResult write(llvm::raw_ostream &os) const;
 
-  /// Build an HW/SV dialect capnp encoder for this type.
+  /// Build an HW/SV dialect capnp encoder for this type. The encoder module is
+  /// shared by all the encoders of the type in the same MLIR module.
   mlir::Value buildEncoder(mlir::OpBuilder &, mlir::Value clk,
                            mlir::Value valid, mlir::Value rawData) const;
-  /// Build an HW/SV dialect capnp decoder for this type.
+  /// Build an HW/SV dialect capnp decoder for this type. The decoder module is
+  /// shared by all the decoders of the type in the same MLIR module.
   mlir::Value buildDecoder(mlir::OpBuilder &, mlir::Value clk,
                            mlir::Value valid, mlir::Value capnpData) const;
 
@@ -79,10 +81,6 @@ private:
   /// The implementation of this. Separate to hide the details and avoid having
   /// to include the capnp headers in this header.
   std::shared_ptr<detail::TypeSchemaImpl> s;
-
-  /// Cache of the decode/encode modules;
-  static llvm::SmallDenseMap<Type, hw::HWModuleOp> decImplMods;
-  static llvm::SmallDenseMap<Type, hw::HWModuleOp> encImplMods;
 };
 
 } // namespace capnp
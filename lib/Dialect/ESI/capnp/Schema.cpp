@@ -1221,11 +1221,6 @@ hw::HWModuleOp TypeSchemaImpl::buildDecoder(Value clk, Value valid,
 // TypeSchema wrapper.
 //===----------------------------------------------------------------------===//
 
-llvm::SmallDenseMap<Type, hw::HWModuleOp>
-    circt::esi::capnp::TypeSchema::decImplMods;
-llvm::SmallDenseMap<Type, hw::HWModuleOp>
-    circt::esi::capnp::TypeSchema::encImplMods;
-
 circt::esi::capnp::TypeSchema::TypeSchema(Type type) {
   circt::esi::ChannelPort chan = type.dyn_cast<circt::esi::ChannelPort>();
   if (chan) // Unwrap the channel if it's a channel.
@@ -1254,14 +1249,17 @@ bool circt::esi::capnp::TypeSchema::operator==(const TypeSchema &that) const {
 Value circt::esi::capnp::TypeSchema::buildEncoder(OpBuilder &builder, Value clk,
                                                   Value valid,
                                                   Value operand) const {
-  hw::HWModuleOp encImplMod;
-  auto encImplIT = encImplMods.find(getType());
-  if (encImplIT == encImplMods.end()) {
+  // Reuse the encoder module of this type if there is one already. Looking it
+  // up by name in the enclosing module, rather than caching it, keeps it
+  // correct when the modules are erased or several MLIR modules are lowered.
+  SmallString<64> modName;
+  modName.append("encode");
+  modName.append(name());
+  auto topMod =
+      builder.getInsertionBlock()->getParentOp()->getParentOfType<ModuleOp>();
+  auto encImplMod = topMod.lookupSymbol<hw::HWModuleOp>(modName);
+  if (!encImplMod)
     encImplMod = s->buildEncoder(clk, valid, operand);
-    encImplMods[getType()] = encImplMod;
-  } else {
-    encImplMod = encImplIT->second;
-  }
 
   SmallString<64> instName;
   instName.append("encode");
@@ -1277,14 +1275,15 @@ Value circt::esi::capnp::TypeSchema::buildEncoder(OpBuilder &builder, Value clk,
 Value circt::esi::capnp::TypeSchema::buildDecoder(OpBuilder &builder, Value clk,
                                                   Value valid,
                                                   Value operand) const {
-  hw::HWModuleOp decImplMod;
-  auto decImplIT = decImplMods.find(getType());
-  if (decImplIT == decImplMods.end()) {
+  // Reuse the decoder module of this type if there is one already, as above.
+  SmallString<64> modName;
+  modName.append("decode");
+  modName.append(name());
+  auto topMod =
+      builder.getInsertionBlock()->getParentOp()->getParentOfType<ModuleOp>();
+  auto decImplMod = topMod.lookupSymbol<hw::HWModuleOp>(modName);
+  if (!decImplMod)
     decImplMod = s->buildDecoder(clk, valid, operand);
-    decImplMods[getType()] = decImplMod;
-  } else {
-    decImplMod = decImplIT->second;
-  }
 
   SmallString<64> instName;
   instName.append("decode");
@@ -17,30 +17,86 @@
 //===----------------------------------------------------------------------===//
 
 #include "circt/Dialect/ESI/cosim/Server.h"
+#include "circt/Dialect/ESI/cosim/Trace.h"
 #include "circt/Dialect/ESI/cosim/dpi.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
 
 using namespace circt::esi::cosim;
 
 /// If non-null, log to this file. Protected by 'serverMutex`.
 static FILE *logFile;
+/// If non-null, write a binary trace of the messages to this file, with times
+/// relative to `traceStart`. Protected by `serverMutex`.
+static FILE *traceFile;
+static std::chrono::steady_clock::time_point traceStart;
 static RpcServer *server = nullptr;
 static std::mutex serverMutex;
 
 // ---- Helper functions ----
 
-/// Emit the contents of 'msg' to the log file in hex.
-static void log(int epId, bool toClient, Endpoint::BlobPtr msg) {
+/// Open the trace file and write its header.
+static void openTrace(const char *traceFN) {
+  printf("[cosim] Opening trace: %s\n", traceFN);
+  traceFile = fopen(traceFN, "wb");
+  if (!traceFile)
+    return;
+  uint32_t header[] = {traceMagic, traceVersion};
+  fwrite(header, sizeof(header), 1, traceFile);
+  traceStart = std::chrono::steady_clock::now();
+}
+
+/// Append a record with the specified payload to the trace file.
+static void trace(int epId, TraceRecordKind kind, const void *payload,
+                  size_t size) {
+  auto elapsed = std::chrono::steady_clock::now() - traceStart;
+  TraceRecord record;
+  record.timeNs =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+  record.epId = epId;
+  record.kind = kind;
+  record.size = size;
+  record.reserved = 0;
+  fwrite(&record, sizeof(record), 1, traceFile);
+  fwrite(payload, 1, size, traceFile);
+}
+
+/// Append the registration of an endpoint to the trace file, so that a replay
+/// can register it as well.
+static void traceEndpoint(int epId, long long sendTypeId, int sendTypeSize,
+                          long long recvTypeId, int recvTypeSize,
+                          bool packed) {
   std::lock_guard<std::mutex> g(serverMutex);
+  if (!traceFile)
+    return;
+  TraceEndpoint endpoint;
+  endpoint.sendTypeId = sendTypeId;
+  endpoint.recvTypeId = recvTypeId;
+  endpoint.sendTypeMaxSize = sendTypeSize;
+  endpoint.recvTypeMaxSize = recvTypeSize;
+  endpoint.packed = packed;
+  endpoint.reserved = 0;
+  trace(epId, TraceRecordKind::Endpoint, &endpoint, sizeof(endpoint));
+}
+
+/// Emit the contents of a message to the log file in hex, and to the trace
+/// file.
+static void log(int epId, bool toClient, const uint8_t *msg, size_t msgSize) {
+  std::lock_guard<std::mutex> g(serverMutex);
+  if (traceFile)
+    trace(epId,
+          toClient ? TraceRecordKind::MessageToClient
+                   : TraceRecordKind::MessageToSim,
+          msg, msgSize);
   if (!logFile)
     return;
 
   fprintf(logFile, "[ep: %4x to: %4s]", epId, toClient ? "host" : "sim");
-  size_t msgSize = msg->size();
   for (size_t i = 0; i < msgSize; ++i) {
-    auto b = (*msg)[i];
+    auto b = msg[i];
     // Separate 32-bit words.
     if (i % 4 == 0 && i > 0)
       fprintf(logFile, " ");
@@ -64,6 +120,15 @@ static int findPort() {
   return std::strtoull(portEnv, nullptr, 10);
 }
 
+/// Get the number of RPC server threads. Client connections are spread over
+/// them, so simulations with many clients can use more than one.
+static unsigned findNumThreads() {
+  const char *threadsEnv = getenv("COSIM_RPC_THREADS");
+  if (threadsEnv == nullptr)
+    return 1;
+  return std::max(1ul, std::strtoul(threadsEnv, nullptr, 10));
+}
+
 /// Check that an array is an array of bytes and has some size.
 // NOLINTNEXTLINE(misc-misplaced-const)
 static int validateSvOpenArray(const svOpenArrayHandle data,
@@ -105,10 +170,35 @@ DPI int sv2cCosimserverEpRegister(int endpointId, long long sendTypeId,
   // Ensure the server has been constructed.
   sv2cCosimserverInit();
   // Then register with it.
-  if (server->endpoints.registerEndpoint(endpointId, sendTypeId, sendTypeSize,
-                                         recvTypeId, recvTypeSize))
+  if (!server->endpoints.registerEndpoint(endpointId, sendTypeId, sendTypeSize,
+                                          recvTypeId, recvTypeSize))
+    return -1;
+  traceEndpoint(endpointId, sendTypeId, sendTypeSize, recvTypeId, recvTypeSize,
+                /*packed=*/false);
+  return 0;
+}
+
+// Register simulated device endpoints which exchange packed data.
+// - return 0 on success, non-zero on failure (duplicate EP registered).
+DPI int sv2cCosimserverEpRegisterPacked(int endpointId, long long sendTypeId,
+                                        int sendTypeSize, long long recvTypeId,
+                                        int recvTypeSize) {
+  sv2cCosimserverInit();
+  if (!server->endpoints.registerEndpoint(endpointId, sendTypeId, sendTypeSize,
+                                          recvTypeId, recvTypeSize,
+                                          /*packed=*/true))
+    return -1;
+  traceEndpoint(endpointId, sendTypeId, sendTypeSize, recvTypeId, recvTypeSize,
+                /*packed=*/true);
+  return 0;
+}
+
+// Check whether any endpoint may have a message for the simulation.
+//   - Returns 1 if so, 0 if every endpoint would return no message.
+DPI int sv2cCosimserverAnyPending() {
+  if (server == nullptr)
     return 0;
-  return -1;
+  return server->endpoints.anyPending() ? 1 : 0;
 }
 
 // Attempt to recieve data from a client.
@@ -130,57 +220,56 @@ DPI int sv2cCosimserverEpTryGet(unsigned int endpointId,
     return -4;
   }
 
-  Endpoint::BlobPtr msg;
-  // Poll for a message.
-  if (!ep->getMessageToSim(msg)) {
-    // No message.
-    *dataSize = 0;
-    return 0;
-  }
-  // Do the validation only if there's a message available. Since the
-  // simulator is going to poll up to every tick and there's not going to be
-  // a message most of the time, this is important for performance.
-
-  log(endpointId, false, msg);
+  // Poll for a message. Do the validation only if there's a message available.
+  // Since the simulator is going to poll up to every tick and there's not
+  // going to be a message most of the time, this is important for performance.
+  // '__func__' names the lambda inside of it.
+  const char *funcName = __func__;
+  int rc = 0;
+  bool gotMsg = ep->consumeMessageToSim([&](const uint8_t *msg,
+                                            size_t msgSize) {
+    log(endpointId, false, msg, msgSize);
 
-  if (validateSvOpenArray(data, sizeof(int8_t)) != 0) {
-    printf("ERROR: DPI-func=%s line=%d event=invalid-sv-array\n", __func__,
-           __LINE__);
-    return -2;
-  }
+    if (validateSvOpenArray(data, sizeof(int8_t)) != 0) {
+      printf("ERROR: DPI-func=%s line=%d event=invalid-sv-array\n", funcName,
+             __LINE__);
+      rc = -2;
+      return;
+    }
 
-  // Detect or verify size of buffer.
-  if (*dataSize == ~0u) {
-    *dataSize = svSizeOfArray(data);
-  } else if (*dataSize > (unsigned)svSizeOfArray(data)) {
-    printf("ERROR: DPI-func=%s line %d event=invalid-size (max %d)\n", __func__,
-           __LINE__, (unsigned)svSizeOfArray(data));
-    return -3;
-  }
-  // Verify it'll fit.
-  size_t msgSize = msg->size();
-  if (msgSize > *dataSize) {
-    printf("ERROR: Message size too big to fit in HW buffer\n");
-    return -5;
-  }
+    // Detect or verify size of buffer.
+    if (*dataSize == ~0u) {
+      *dataSize = svSizeOfArray(data);
+    } else if (*dataSize > (unsigned)svSizeOfArray(data)) {
+      printf("ERROR: DPI-func=%s line %d event=invalid-size (max %d)\n",
+             funcName, __LINE__, (unsigned)svSizeOfArray(data));
+      rc = -3;
+      return;
+    }
+    // Verify it'll fit.
+    if (msgSize > *dataSize) {
+      printf("ERROR: Message size too big to fit in HW buffer\n");
+      rc = -5;
+      return;
+    }
 
-  // Copy the message data.
-  size_t i;
-  for (i = 0; i < msgSize; ++i) {
-    auto b = (*msg)[i];
-    *(char *)svGetArrElemPtr1(data, i) = b;
-  }
-  // Zero out the rest of the buffer.
-  for (; i < *dataSize; ++i) {
-    *(char *)svGetArrElemPtr1(data, i) = 0;
+    // Copy the message data and zero out the rest of the buffer.
+    auto *buffer = static_cast<uint8_t *>(svGetArrayPtr(data));
+    memcpy(buffer, msg, msgSize);
+    memset(buffer + msgSize, 0, *dataSize - msgSize);
+    // Set the output data size.
+    *dataSize = msgSize;
+  });
+  if (!gotMsg) {
+    // No message.
+    *dataSize = 0;
+    return 0;
   }
-  // Set the output data size.
-  *dataSize = msg->size();
-  return 0;
+  return rc;
 }
 
 // Attempt to send data to a client.
-// - return 0 on success, negative on failure (unregistered EP).
+// - return 0 on success, negative on failure (unregistered EP, full queue).
 // - if dataSize is negative, attempt to dynamically determine the size of
 //   'data'.
 DPI int sv2cCosimserverEpTryPut(unsigned int endpointId,
@@ -204,22 +293,130 @@ DPI int sv2cCosimserverEpTryPut(unsigned int endpointId,
     return -3;
   }
 
-  Endpoint::BlobPtr blob = std::make_shared<Endpoint::Blob>(dataSize);
-  // Copy the message data into 'blob'.
-  for (int i = 0; i < dataSize; ++i) {
-    (*blob)[i] = *(char *)svGetArrElemPtr1(data, i);
-  }
-  // Queue the blob.
   Endpoint *ep = server->endpoints[endpointId];
   if (!ep) {
     fprintf(stderr, "Endpoint not found in registry!\n");
     return -4;
   }
-  log(endpointId, true, blob);
-  ep->pushMessageToClient(blob);
+
+  // Copy the message data straight into the queued message.
+  auto *buffer = static_cast<const uint8_t *>(svGetArrayPtr(data));
+  if (!ep->produceMessageToClient(dataSize, [&](uint8_t *msg) {
+        memcpy(msg, buffer, dataSize);
+      })) {
+    fprintf(stderr, "Endpoint queue to the client is full!\n");
+    return -5;
+  }
+  log(endpointId, true, buffer, dataSize);
   return 0;
 }
 
+// Attempt to receive up to *numMsgs messages from a client in one call.
+//   - 'data' holds *numMsgs slots of the endpoint's registered receive type
+//     size. Each message is copied into the next slot and zero padded.
+//   - Returns negative when call failed (e.g. EP not registered, a message
+//     doesn't fit in a slot). On return, *numMsgs is the number of messages
+//     copied, which is 0 if there was none.
+//   - The array is validated once per call rather than per message.
+DPI int sv2cCosimserverEpTryGetBatch(unsigned int endpointId,
+                                     // NOLINTNEXTLINE(misc-misplaced-const)
+                                     const svOpenArrayHandle data,
+                                     unsigned int *numMsgs) {
+  unsigned int maxMsgs = *numMsgs;
+  *numMsgs = 0;
+  if (server == nullptr)
+    return -1;
+
+  Endpoint *ep = server->endpoints[endpointId];
+  if (!ep) {
+    fprintf(stderr, "Endpoint not found in registry!\n");
+    return -4;
+  }
+
+  // Only touch the array once there's a message available, since the
+  // simulator polls up to every tick.
+  const char *funcName = __func__;
+  bool validated = false;
+  size_t slotSize = ep->getRecvTypeMaxSize();
+  uint8_t *buffer = nullptr;
+  int rc = 0;
+  while (rc == 0 && *numMsgs < maxMsgs &&
+         ep->consumeMessageToSim([&](const uint8_t *msg, size_t msgSize) {
+           log(endpointId, false, msg, msgSize);
+           if (!validated) {
+             if (validateSvOpenArray(data, sizeof(int8_t)) != 0) {
+               printf("ERROR: DPI-func=%s line=%d event=invalid-sv-array\n",
+                      funcName, __LINE__);
+               rc = -2;
+               return;
+             }
+             if (maxMsgs * slotSize > (size_t)svSizeOfArray(data)) {
+               printf("ERROR: DPI-func=%s line %d event=invalid-size (max "
+                      "%d)\n",
+                      funcName, __LINE__, (unsigned)svSizeOfArray(data));
+               rc = -3;
+               return;
+             }
+             buffer = static_cast<uint8_t *>(svGetArrayPtr(data));
+             validated = true;
+           }
+           if (msgSize > slotSize) {
+             printf("ERROR: Message size too big to fit in HW buffer\n");
+             rc = -5;
+             return;
+           }
+           uint8_t *slot = buffer + *numMsgs * slotSize;
+           memcpy(slot, msg, msgSize);
+           memset(slot + msgSize, 0, slotSize - msgSize);
+           ++*numMsgs;
+         }))
+    ;
+  return rc;
+}
+
+// Attempt to send numMsgs messages to a client in one call.
+// - 'data' holds numMsgs messages, each in a slot of the endpoint's registered
+//   send type size.
+// - return the number of messages queued, which is less than numMsgs if the
+//   queue filled up, or negative on failure (unregistered EP).
+// - The array is validated once per call rather than per message.
+DPI int sv2cCosimserverEpTryPutBatch(unsigned int endpointId,
+                                     // NOLINTNEXTLINE(misc-misplaced-const)
+                                     const svOpenArrayHandle data,
+                                     int numMsgs) {
+  if (server == nullptr)
+    return -1;
+
+  Endpoint *ep = server->endpoints[endpointId];
+  if (!ep) {
+    fprintf(stderr, "Endpoint not found in registry!\n");
+    return -4;
+  }
+
+  if (validateSvOpenArray(data, sizeof(int8_t)) != 0) {
+    printf("ERROR: DPI-func=%s line=%d event=invalid-sv-array\n", __func__,
+           __LINE__);
+    return -2;
+  }
+  size_t slotSize = ep->getSendTypeMaxSize();
+  if (numMsgs < 0 || numMsgs * slotSize > (size_t)svSizeOfArray(data)) {
+    printf("ERROR: DPI-func=%s line %d event=invalid-size msgs %d array %d\n",
+           __func__, __LINE__, numMsgs, svSizeOfArray(data));
+    return -3;
+  }
+
+  auto *buffer = static_cast<const uint8_t *>(svGetArrayPtr(data));
+  int numQueued = 0;
+  for (; numQueued < numMsgs; ++numQueued) {
+    const uint8_t *slot = buffer + numQueued * slotSize;
+    if (!ep->produceMessageToClient(
+            slotSize, [&](uint8_t *msg) { memcpy(msg, slot, slotSize); }))
+      break;
+    log(endpointId, true, slot, slotSize);
+  }
+  return numQueued;
+}
+
 // Teardown cosimserver (disconnects from primary server port, stops connections
 // from active clients).
 DPI void sv2cCosimserverFinish() {
@@ -229,8 +426,12 @@ DPI void sv2cCosimserverFinish() {
     server->stop();
     server = nullptr;
 
-    fclose(logFile);
+    if (logFile)
+      fclose(logFile);
     logFile = nullptr;
+    if (traceFile)
+      fclose(traceFile);
+    traceFile = nullptr;
   }
 }
 
@@ -245,11 +446,15 @@ DPI int sv2cCosimserverInit() {
       printf("[cosim] Opening debug log: %s\n", logFN);
       logFile = fopen(logFN, "w");
     }
+    // And the binary trace.
+    const char *traceFN = getenv("COSIM_TRACE_FILE");
+    if (traceFN != nullptr)
+      openTrace(traceFN);
 
     // Find the port and run.
     printf("[cosim] Starting RPC server.\n");
     server = new RpcServer();
-    server->run(findPort());
+    server->run(findPort(), findNumThreads());
   }
   return 0;
 }
@@ -6,7 +6,7 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// Definitions for Cosim EndPoint and EndPointRegistry.
+// Definitions for Cosim EndPoint, EndPointRegistry and BlobPool.
 //
 //===----------------------------------------------------------------------===//
 
@@ -14,30 +14,142 @@
 
 using namespace circt::esi::cosim;
 
+namespace {
+/// The pooled blobs of one size class.
+struct BlobSizeClass {
+  std::mutex m;
+  std::vector<Blob *> freeBlobs;
+};
+
+/// The storage of the `BlobPool`. Size class `i` holds blobs with a capacity
+/// of at least `2^(minLog2Size + i)` bytes.
+struct BlobPoolImpl {
+  /// The size classes go from 64 bytes to 1 MiB.
+  static constexpr unsigned minLog2Size = 6;
+  static constexpr unsigned maxLog2Size = 20;
+  static constexpr unsigned numClasses = maxLog2Size - minLog2Size + 1;
+  /// The maximum number of free blobs kept per size class.
+  static constexpr size_t maxFreeBlobs = 1024;
+
+  BlobSizeClass classes[numClasses];
+
+  static size_t getClassSize(unsigned index) {
+    return (size_t)1 << (minLog2Size + index);
+  }
+
+  /// Return the index of the smallest class that can serve the specified
+  /// size, or numClasses if it is too large to be pooled.
+  static unsigned getAllocClass(size_t size) {
+    unsigned index = 0;
+    while (index != numClasses && getClassSize(index) < size)
+      ++index;
+    return index;
+  }
+
+  /// Return the index of the largest class that a blob of the specified
+  /// capacity can serve, or numClasses if there is none.
+  static unsigned getReleaseClass(size_t capacity) {
+    if (capacity < getClassSize(0) ||
+        capacity >= getClassSize(numClasses - 1) * 2)
+      return numClasses;
+    unsigned index = 0;
+    while (index + 1 != numClasses && getClassSize(index + 1) <= capacity)
+      ++index;
+    return index;
+  }
+};
+} // anonymous namespace
+
+/// The pool is never destroyed, since the endpoints holding blobs may outlive
+/// static destructors.
+static BlobPoolImpl &getBlobPool() {
+  static BlobPoolImpl *pool = new BlobPoolImpl();
+  return *pool;
+}
+
+void BlobDeleter::operator()(Blob *blob) const { BlobPool::release(blob); }
+
+std::unique_ptr<Blob, BlobDeleter> BlobPool::allocate(size_t size) {
+  Blob *blob = nullptr;
+  unsigned index = BlobPoolImpl::getAllocClass(size);
+  if (index != BlobPoolImpl::numClasses) {
+    auto &sizeClass = getBlobPool().classes[index];
+    {
+      std::lock_guard<std::mutex> g(sizeClass.m);
+      if (!sizeClass.freeBlobs.empty()) {
+        blob = sizeClass.freeBlobs.back();
+        sizeClass.freeBlobs.pop_back();
+      }
+    }
+    // Allocate the full size of the class, so that the blob can be reused for
+    // any size in it.
+    if (!blob) {
+      blob = new Blob();
+      blob->reserve(BlobPoolImpl::getClassSize(index));
+    }
+  } else {
+    blob = new Blob();
+  }
+  blob->resize(size);
+  return std::unique_ptr<Blob, BlobDeleter>(blob);
+}
+
+void BlobPool::release(Blob *blob) {
+  if (!blob)
+    return;
+  unsigned index = BlobPoolImpl::getReleaseClass(blob->capacity());
+  if (index != BlobPoolImpl::numClasses) {
+    blob->clear();
+    auto &sizeClass = getBlobPool().classes[index];
+    std::lock_guard<std::mutex> g(sizeClass.m);
+    if (sizeClass.freeBlobs.size() < BlobPoolImpl::maxFreeBlobs) {
+      sizeClass.freeBlobs.push_back(blob);
+      return;
+    }
+  }
+  delete blob;
+}
+
 Endpoint::Endpoint(uint64_t sendTypeId, int sendTypeMaxSize,
-                   uint64_t recvTypeId, int recvTypeMaxSize)
-    : sendTypeId(sendTypeId), recvTypeId(recvTypeId), inUse(false) {}
+                   uint64_t recvTypeId, int recvTypeMaxSize, bool packed,
+                   PendingMessages &pending)
+    : sendTypeId(sendTypeId), sendTypeMaxSize(sendTypeMaxSize),
+      recvTypeId(recvTypeId), recvTypeMaxSize(recvTypeMaxSize), packed(packed),
+      inUse(false), pending(pending), toCosim(queueCapacity),
+      toClient(queueCapacity) {}
 Endpoint::~Endpoint() {}
 
-bool Endpoint::setInUse() {
-  Lock g(m);
-  if (inUse)
-    return false;
-  inUse = true;
-  return true;
-}
+bool Endpoint::setInUse() { return !inUse.exchange(true); }
 
 void Endpoint::returnForUse() {
-  Lock g(m);
-  if (!inUse)
+  if (attachedShm.exchange(nullptr, std::memory_order_acq_rel))
+    pending.shmAttached.fetch_sub(1, std::memory_order_release);
+  if (!inUse.exchange(false))
     fprintf(stderr, "Warning: Returning an endpoint which was not in use.\n");
-  inUse = false;
+}
+
+ShmChannel *Endpoint::attachShm(const std::string &name, std::string &error) {
+  // The slots hold messages of the maximum type sizes, rounded up to the capnp
+  // word size since the messages are capnp messages.
+  if (!shm)
+    shm = ShmChannel::create(name, queueCapacity, (recvTypeMaxSize + 7) & ~7,
+                             (sendTypeMaxSize + 7) & ~7, error);
+  if (!shm)
+    return nullptr;
+  if (!attachedShm.exchange(shm.get(), std::memory_order_acq_rel))
+    pending.shmAttached.fetch_add(1, std::memory_order_release);
+  return shm.get();
 }
 
 bool EndpointRegistry::registerEndpoint(int epId, uint64_t sendTypeId,
                                         int sendTypeMaxSize,
                                         uint64_t recvTypeId,
-                                        int recvTypeMaxSize) {
+                                        int recvTypeMaxSize, bool packed) {
+  // The batched transfers rely on the sizes, so check them once here.
+  if (sendTypeMaxSize <= 0 || recvTypeMaxSize <= 0) {
+    fprintf(stderr, "Endpoint type sizes must be positive!\n");
+    return false;
+  }
   Lock g(m);
   if (endpoints.find(epId) != endpoints.end()) {
     fprintf(stderr, "Endpoint ID already exists!\n");
@@ -50,23 +162,28 @@ bool EndpointRegistry::registerEndpoint(int epId, uint64_t sendTypeId,
                     std::forward_as_tuple(epId),
                     // Endpoint constructor args.
                     std::forward_as_tuple(sendTypeId, sendTypeMaxSize,
-                                          recvTypeId, recvTypeMaxSize));
+                                          recvTypeId, recvTypeMaxSize,
+                                          packed, pending));
+
+  // Publish a new table. The map is sorted by ID, and so is the table.
+  Table &table = tables.emplace_back();
+  table.reserve(endpoints.size());
+  for (auto &ep : endpoints)
+    table.emplace_back(ep.first, &ep.second);
+  currentTable.store(&table, std::memory_order_release);
   return true;
 }
 
 void EndpointRegistry::iterateEndpoints(
     std::function<void(int, const Endpoint &)> f) const {
-  // This function is logically const, but modification is needed to obtain a
-  // lock.
-  Lock g(const_cast<EndpointRegistry *>(this)->m);
-  for (const auto &ep : endpoints) {
-    f(ep.first, ep.second);
-  }
+  const Table *table = currentTable.load(std::memory_order_acquire);
+  if (!table)
+    return;
+  for (const auto &ep : *table)
+    f(ep.first, *ep.second);
 }
 
 size_t EndpointRegistry::size() const {
-  // This function is logically const, but modification is needed to obtain a
-  // lock.
-  Lock g(const_cast<EndpointRegistry *>(this)->m);
-  return endpoints.size();
+  const Table *table = currentTable.load(std::memory_order_acquire);
+  return table ? table->size() : 0;
 }
@@ -19,7 +19,14 @@
 
 #include "circt/Dialect/ESI/cosim/Server.h"
 #include "circt/Dialect/ESI/cosim/CosimDpi.capnp.h"
+#include <algorithm>
+#include <arpa/inet.h>
 #include <capnp/ez-rpc.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
 #include <thread>
 #include <unistd.h>
 
@@ -35,12 +42,26 @@ class EndpointServer final
     : public EsiDpiEndpoint<capnp::AnyPointer, capnp::AnyPointer>::Server {
   /// The wrapped endpoint.
   Endpoint &endpoint;
+  /// The timer of the event loop serving this endpoint.
+  kj::Timer &timer;
   /// Signals that this endpoint has been opened by a client and hasn't been
   /// closed by said client.
   bool open;
 
+  /// The number of sends waiting for room in the queue to the simulation.
+  unsigned numWaitingSends = 0;
+  /// Resolves once the last waiting send is queued. The next sends wait for
+  /// it, so the messages reach the simulation in the order they were sent.
+  kj::ForkedPromise<void> lastWaitingSend;
+
+  /// Queue a message to the simulation, after the sends which are waiting for
+  /// room in the queue.
+  kj::Promise<void> pushMessageToSim(Endpoint::BlobPtr blob);
+  /// Queue a message to the simulation, retrying until there is room.
+  kj::Promise<void> retryPushMessageToSim(Endpoint::BlobPtr blob);
+
 public:
-  EndpointServer(Endpoint &ep);
+  EndpointServer(Endpoint &ep, kj::Timer &timer);
   /// Release the Endpoint should the client disconnect without properly closing
   /// it.
   ~EndpointServer();
@@ -57,20 +78,29 @@ public:
 class CosimServer final : public CosimDpiServer::Server {
   /// The registry of endpoints. The RpcServer class owns this.
   EndpointRegistry &reg;
+  /// The timer of the event loop this server runs on. Set once the event loop
+  /// exists, before any client connects.
+  kj::Timer *timer = nullptr;
 
 public:
   CosimServer(EndpointRegistry &reg);
 
+  void setTimer(kj::Timer &newTimer) { timer = &newTimer; }
+
   /// List all the registered interfaces.
   kj::Promise<void> list(ListContext ctxt) override;
   /// Open a specific interface, locking it in the process.
   kj::Promise<void> open(OpenContext ctxt) override;
+  /// Open a specific interface with a shared-memory transport.
+  kj::Promise<void> openShm(OpenShmContext ctxt) override;
 };
 } // anonymous namespace
 
 /// ------ EndpointServer definitions.
 
-EndpointServer::EndpointServer(Endpoint &ep) : endpoint(ep), open(true) {}
+EndpointServer::EndpointServer(Endpoint &ep, kj::Timer &timer)
+    : endpoint(ep), timer(timer), open(true),
+      lastWaitingSend(kj::Promise<void>(kj::READY_NOW).fork()) {}
 EndpointServer::~EndpointServer() {
   if (open)
     endpoint.returnForUse();
@@ -87,50 +117,96 @@ kj::Promise<void> EndpointServer::recv(RecvContext context) {
   Endpoint::BlobPtr blob;
   auto msgPresent = endpoint.getMessageToClient(blob);
   context.getResults().setHasData(msgPresent);
-  if (msgPresent) {
+  if (msgPresent && endpoint.isPacked()) {
+    // Packed data just needs wrapping.
+    context.getResults().getResp().initAs<UntypedData>().setData(
+        kj::arrayPtr(blob->data(), blob->size()));
+  } else if (msgPresent) {
     KJ_REQUIRE(blob->size() % 8 == 0,
                "Response msg was malformed. Size of response was not a "
                "multiple of 8 bytes.");
-    // Copy the blob into a single segment.
+    // Read the message in place from the blob, which stays alive until the
+    // results are built.
     auto segment =
         kj::ArrayPtr<capnp::word>((word *)blob->data(), blob->size() / 8)
             .asConst();
-    // Create a single-element array of segments.
-    kj::Array<kj::ArrayPtr<const capnp::word>> segments =
-        kj::heapArray({segment});
-    // Create an object which will read the segments into a message on send.
-    std::unique_ptr<SegmentArrayMessageReader> msgReader =
-        std::make_unique<SegmentArrayMessageReader>(segments);
+    // Create a single-element array of segments, and a reader over them. Both
+    // live on the stack since they're only needed until the copy below.
+    kj::ArrayPtr<const capnp::word> segments[] = {segment};
+    SegmentArrayMessageReader msgReader(kj::arrayPtr(segments, 1));
     // Send.
-    context.getResults().getResp().set(msgReader->getRoot<AnyPointer>());
+    context.getResults().getResp().set(msgReader.getRoot<AnyPointer>());
   }
   return kj::READY_NOW;
 }
 
 /// 'Send' is from the client perspective, so this is a message we are
-/// recieving. The only way I could figure out to copy the raw message is a
-/// double copy. I was have issues getting libkj's arrays to play nice with
-/// others.
+/// recieving. The message is copied once, straight into a pooled blob, which
+/// is laid out as a flat, single segment message.
 kj::Promise<void> EndpointServer::send(SendContext context) {
   KJ_REQUIRE(open, "EndPoint closed already");
   auto capnpMsgPointer = context.getParams().getMsg();
   KJ_REQUIRE(capnpMsgPointer.isStruct(),
              "Only messages can go in the 'msg' parameter");
 
-  // Copy the incoming message into a flat, single segment buffer.
+  // Packed endpoints take the data of an UntypedData message as is.
+  if (endpoint.isPacked()) {
+    auto data = capnpMsgPointer.getAs<UntypedData>().getData();
+    KJ_REQUIRE(data.size() == (size_t)endpoint.getRecvTypeMaxSize(),
+               "Packed endpoints require UntypedData messages of the data size",
+               data.size(), endpoint.getRecvTypeMaxSize());
+    auto blob = BlobPool::allocate(data.size());
+    memcpy(blob->data(), data.begin(), data.size());
+    return pushMessageToSim(std::move(blob));
+  }
+
+  // Build the message in the blob: the root pointer followed by the content.
+  // The blob starts out zeroed, as capnp requires.
   auto msgSize = capnpMsgPointer.targetSize();
-  auto builder = std::make_unique<MallocMessageBuilder>(
-      msgSize.wordCount + 1, AllocationStrategy::FIXED_SIZE);
-  builder->setRoot(capnpMsgPointer);
-  auto segments = builder->getSegmentsForOutput();
+  size_t numWords = msgSize.wordCount + 1;
+  auto blob = BlobPool::allocate(numWords * sizeof(word));
+  FlatMessageBuilder builder(
+      kj::arrayPtr(reinterpret_cast<word *>(blob->data()), numWords));
+  builder.setRoot(capnpMsgPointer);
+  auto segments = builder.getSegmentsForOutput();
   KJ_ASSERT(segments.size() == 1);
+  blob->resize(segments[0].size() * sizeof(word));
 
-  // Now copy it into a blob and queue it.
-  auto fstSegmentData = segments[0].asBytes();
-  auto blob = std::make_shared<Endpoint::Blob>(fstSegmentData.begin(),
-                                               fstSegmentData.end());
-  endpoint.pushMessageToSim(blob);
-  return kj::READY_NOW;
+  return pushMessageToSim(std::move(blob));
+}
+
+/// This is the server-side flow control: while the simulation is not keeping
+/// up, the send() does not complete, so clients waiting on their sends are
+/// throttled instead of filling memory. A client may pipeline its sends, so
+/// once one send waits, the later ones wait for it before being queued.
+kj::Promise<void> EndpointServer::pushMessageToSim(Endpoint::BlobPtr blob) {
+  if (numWaitingSends == 0 && endpoint.pushMessageToSim(std::move(blob)))
+    return kj::READY_NOW;
+
+  ++numWaitingSends;
+  auto queued = lastWaitingSend.addBranch()
+                    .then([this, blob = std::move(blob)]() mutable {
+                      return retryPushMessageToSim(std::move(blob));
+                    })
+                    .fork();
+  // The failure of a send is reported to its client only, the next sends are
+  // still queued after it.
+  lastWaitingSend = queued.addBranch()
+                        .then([this]() { --numWaitingSends; },
+                              [this](kj::Exception &&) { --numWaitingSends; })
+                        .fork();
+  return queued.addBranch();
+}
+
+kj::Promise<void>
+EndpointServer::retryPushMessageToSim(Endpoint::BlobPtr blob) {
+  KJ_REQUIRE(open, "EndPoint closed already");
+  if (endpoint.pushMessageToSim(std::move(blob)))
+    return kj::READY_NOW;
+  return timer.afterDelay(100 * kj::MICROSECONDS)
+      .then([this, blob = std::move(blob)]() mutable {
+        return retryPushMessageToSim(std::move(blob));
+      });
 }
 
 kj::Promise<void> EndpointServer::close(CloseContext context) {
@@ -148,9 +224,13 @@ kj::Promise<void> CosimServer::list(ListContext context) {
   auto ifaces = context.getResults().initIfaces((unsigned int)reg.size());
   unsigned int ctr = 0u;
   reg.iterateEndpoints([&](int id, const Endpoint &ep) {
+    // Endpoints registered since the call to size() are left out.
+    if (ctr == ifaces.size())
+      return;
     ifaces[ctr].setEndpointID(id);
     ifaces[ctr].setSendTypeID(ep.getSendTypeId());
     ifaces[ctr].setRecvTypeID(ep.getRecvTypeId());
+    ifaces[ctr].setPacked(ep.isPacked());
     ++ctr;
   });
   return kj::READY_NOW;
@@ -164,17 +244,46 @@ kj::Promise<void> CosimServer::open(OpenContext ctxt) {
   KJ_REQUIRE(gotLock, "Endpoint in use");
 
   ctxt.getResults().setIface(EsiDpiEndpoint<AnyPointer, AnyPointer>::Client(
-      kj::heap<EndpointServer>(*ep)));
+      kj::heap<EndpointServer>(*ep, *timer)));
+  return kj::READY_NOW;
+}
+
+kj::Promise<void> CosimServer::openShm(OpenShmContext ctxt) {
+  int epId = ctxt.getParams().getIface().getEndpointID();
+  Endpoint *ep = reg[epId];
+  KJ_REQUIRE(ep != nullptr, "Could not find endpoint");
+
+  auto gotLock = ep->setInUse();
+  KJ_REQUIRE(gotLock, "Endpoint in use");
+
+  // The name is unique per simulation process and endpoint.
+  std::string name = "/esi-cosim-" + std::to_string(getpid()) + "-" +
+                     std::to_string(epId);
+  std::string error;
+  ShmChannel *shm = ep->attachShm(name, error);
+  if (!shm) {
+    ep->returnForUse();
+    KJ_FAIL_REQUIRE("Could not create shared memory", error.c_str());
+  }
+
+  auto results = ctxt.getResults();
+  results.setIface(EsiDpiEndpoint<AnyPointer, AnyPointer>::Client(
+      kj::heap<EndpointServer>(*ep, *timer)));
+  auto desc = results.initShm();
+  desc.setName(shm->getName());
+  desc.setCapacity(shm->getCapacity());
+  desc.setSendSlotSize(shm->getToSimSlotSize());
+  desc.setRecvSlotSize(shm->getToClientSlotSize());
   return kj::READY_NOW;
 }
 
 /// ----- RpcServer definitions.
 
-RpcServer::RpcServer() : mainThread(nullptr), stopSig(false) {}
+RpcServer::RpcServer() : stopSig(false) {}
 RpcServer::~RpcServer() { stop(); }
 
-/// Write the port number to a file. Necessary when we allow 'EzRpcServer' to
-/// select its own port. We can't use stdout/stderr because the flushing
+/// Write the port number to a file. Necessary when we allow the system to
+/// select the port. We can't use stdout/stderr because the flushing
 /// semantics are undefined (as in `flush()` doesn't work on all simulators).
 static void writePort(uint16_t port) {
   // "cosim.cfg" since we may want to include other info in the future.
@@ -183,17 +292,45 @@ static void writePort(uint16_t port) {
   fclose(fd);
 }
 
-void RpcServer::mainLoop(uint16_t port) {
-  capnp::EzRpcServer rpcServer(kj::heap<CosimServer>(endpoints),
-                               /* bindAddress */ "*", port);
-  auto &waitScope = rpcServer.getWaitScope();
-  // If port is 0, ExRpcSever selects one and we have to wait to get the port.
-  if (port == 0) {
-    auto portPromise = rpcServer.getPort();
-    port = portPromise.wait(waitScope);
+/// Create a socket listening on all addresses on the specified port, or on a
+/// port picked by the system if it is 0. Set `port` to the actual port. Return
+/// -1 on failure.
+static int listenOnPort(uint16_t &port) {
+  int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  if (fd < 0) {
+    fprintf(stderr, "[COSIM] socket() failed: %s\n", strerror(errno));
+    return -1;
   }
-  writePort(port);
-  printf("[COSIM] Listening on port: %u\n", (unsigned int)port);
+  int zero = 0, one = 1;
+  // Accept IPv4 connections as well.
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  socklen_t addrLen = sizeof(addr);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), addrLen) != 0 ||
+      listen(fd, SOMAXCONN) != 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &addrLen) != 0) {
+    fprintf(stderr, "[COSIM] Could not listen on port %u: %s\n",
+            (unsigned int)port, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  port = ntohs(addr.sin6_port);
+  return fd;
+}
+
+void RpcServer::mainLoop(int listenFd, uint16_t port) {
+  auto cosimServer = kj::heap<CosimServer>(endpoints);
+  CosimServer &cosimServerRef = *cosimServer;
+  capnp::EzRpcServer rpcServer(kj::mv(cosimServer), listenFd, port);
+  cosimServerRef.setTimer(rpcServer.getIoProvider().getTimer());
+  auto &waitScope = rpcServer.getWaitScope();
 
   // OK, this is uber hacky, but it unblocks me and isn't _too_ inefficient. The
   // problem is that I can't figure out how read the stop signal from libkj
@@ -212,22 +349,36 @@ void RpcServer::mainLoop(uint16_t port) {
 }
 
 /// Start the server if not already started.
-void RpcServer::run(uint16_t port) {
+void RpcServer::run(uint16_t port, unsigned numThreads) {
   Lock g(m);
-  if (mainThread == nullptr) {
-    mainThread = new std::thread(&RpcServer::mainLoop, this, port);
-  } else {
+  if (!threads.empty()) {
     fprintf(stderr, "Warning: cannot Run() RPC server more than once!");
+    return;
+  }
+
+  int listenFd = listenOnPort(port);
+  if (listenFd < 0)
+    return;
+  writePort(port);
+  printf("[COSIM] Listening on port: %u with %u threads\n",
+         (unsigned int)port, numThreads);
+
+  // Every thread accepts connections on its own copy of the socket, and the
+  // system hands each connection to one of them.
+  for (unsigned i = 0; i < std::max(numThreads, 1u); ++i) {
+    int fd = i == 0 ? listenFd : dup(listenFd);
+    threads.emplace_back(&RpcServer::mainLoop, this, fd, port);
   }
 }
 
-/// Signal the RPC server thread to stop. Wait for it to exit.
+/// Signal the RPC server threads to stop. Wait for them to exit.
 void RpcServer::stop() {
   Lock g(m);
-  if (mainThread == nullptr) {
+  if (threads.empty()) {
     fprintf(stderr, "RpcServer not Run()\n");
   } else if (!stopSig) {
     stopSig = true;
-    mainThread->join();
+    for (auto &thread : threads)
+      thread.join();
   }
 }
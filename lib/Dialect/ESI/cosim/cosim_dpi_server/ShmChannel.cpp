@@ -0,0 +1,169 @@
+//===- ShmChannel.cpp - Cosim shared-memory transport -----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Definitions for the shared-memory transport. The memory is a POSIX shared
+// memory object, and blocked clients are woken with a futex, so the transport
+// is only available on Linux.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/ESI/cosim/ShmChannel.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#ifdef __linux__
+#include <climits>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace circt::esi::cosim;
+
+/// Round `value` up to a multiple of `align`, which is a power of two.
+static size_t alignTo(size_t value, size_t align) {
+  return (value + align - 1) & ~(align - 1);
+}
+
+/// Initialize a ring at the specified address.
+static void initRing(void *address, uint32_t capacity, uint32_t slotSize) {
+  auto *ring = new (address) ShmRing();
+  ring->head.store(0, std::memory_order_relaxed);
+  ring->tail.store(0, std::memory_order_relaxed);
+  ring->waiters.store(0, std::memory_order_relaxed);
+  ring->capacity = capacity;
+  ring->slotSize = slotSize;
+  ring->slotStride = alignTo(sizeof(uint32_t) + slotSize, 8);
+  ring->slotsOffset = alignTo(sizeof(ShmRing), 64);
+}
+
+/// Compute the total size of a ring, laid out as in `initRing`.
+static size_t getRingSize(uint32_t capacity, uint32_t slotSize) {
+  return alignTo(sizeof(ShmRing), 64) +
+         (size_t)capacity * alignTo(sizeof(uint32_t) + slotSize, 8);
+}
+
+std::unique_ptr<ShmChannel>
+ShmChannel::create(const std::string &name, uint32_t capacity,
+                   uint32_t toSimSlotSize, uint32_t toClientSlotSize,
+                   std::string &error) {
+#ifdef __linux__
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+    error = "capacity must be a power of two";
+    return nullptr;
+  }
+
+  size_t toSimOffset = alignTo(sizeof(ShmHeader), 64);
+  size_t toClientOffset =
+      alignTo(toSimOffset + getRingSize(capacity, toSimSlotSize), 64);
+  size_t totalSize = toClientOffset + getRingSize(capacity, toClientSlotSize);
+
+  // Remove any stale object left behind by a crashed simulation.
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    error = std::string("shm_open failed: ") + strerror(errno);
+    return nullptr;
+  }
+  if (ftruncate(fd, totalSize) != 0) {
+    error = std::string("ftruncate failed: ") + strerror(errno);
+    close(fd);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+  void *memory =
+      mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED) {
+    error = std::string("mmap failed: ") + strerror(errno);
+    shm_unlink(name.c_str());
+    return nullptr;
+  }
+
+  auto *bytes = static_cast<uint8_t *>(memory);
+  initRing(bytes + toSimOffset, capacity, toSimSlotSize);
+  initRing(bytes + toClientOffset, capacity, toClientSlotSize);
+  auto *header = new (memory) ShmHeader();
+  header->toSimOffset = toSimOffset;
+  header->toClientOffset = toClientOffset;
+  header->totalSize = totalSize;
+  header->version = ShmHeader::versionValue;
+  // Clients check the magic value last, so publish it last.
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = ShmHeader::magicValue;
+
+  return std::unique_ptr<ShmChannel>(new ShmChannel(name, memory, totalSize));
+#else
+  error = "shared memory transport is only supported on Linux";
+  return nullptr;
+#endif
+}
+
+ShmChannel::ShmChannel(std::string name, void *memory, size_t size)
+    : name(std::move(name)), memory(memory), size(size) {
+  auto *header = static_cast<ShmHeader *>(memory);
+  auto *bytes = static_cast<uint8_t *>(memory);
+  toSim = reinterpret_cast<ShmRing *>(bytes + header->toSimOffset);
+  toClient = reinterpret_cast<ShmRing *>(bytes + header->toClientOffset);
+}
+
+ShmChannel::~ShmChannel() {
+#ifdef __linux__
+  munmap(memory, size);
+  shm_unlink(name.c_str());
+#endif
+}
+
+bool ShmChannel::peekMessageToSim(const uint8_t *&data, size_t &msgSize) {
+  uint32_t h = toSim->head.load(std::memory_order_relaxed);
+  if (h == toSim->tail.load(std::memory_order_acquire))
+    return false;
+  uint8_t *slot = getSlot(toSim, h);
+  uint32_t slotMsgSize;
+  memcpy(&slotMsgSize, slot, sizeof(uint32_t));
+  // Don't trust the client to stay within the slot.
+  msgSize = std::min(slotMsgSize, toSim->slotSize);
+  data = slot + sizeof(uint32_t);
+  return true;
+}
+
+void ShmChannel::popMessageToSim() {
+  uint32_t h = toSim->head.load(std::memory_order_relaxed);
+  toSim->head.store(h + 1, std::memory_order_release);
+}
+
+uint8_t *ShmChannel::getMessageToClientSlot(size_t msgSize) {
+  if (msgSize > toClient->slotSize)
+    return nullptr;
+  uint32_t t = toClient->tail.load(std::memory_order_relaxed);
+  if (t - toClient->head.load(std::memory_order_acquire) ==
+      toClient->capacity)
+    return nullptr;
+  return getSlot(toClient, t) + sizeof(uint32_t);
+}
+
+void ShmChannel::publishMessageToClient(size_t msgSize) {
+  uint32_t t = toClient->tail.load(std::memory_order_relaxed);
+  uint32_t slotMsgSize = msgSize;
+  memcpy(getSlot(toClient, t), &slotMsgSize, sizeof(uint32_t));
+  toClient->tail.store(t + 1, std::memory_order_release);
+
+  // Pairs with the fence a client executes between setting `waiters` and
+  // re-checking `tail` before it blocks.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+#ifdef __linux__
+  if (toClient->waiters.load(std::memory_order_relaxed))
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&toClient->tail),
+            FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
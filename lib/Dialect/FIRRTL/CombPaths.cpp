@@ -0,0 +1,555 @@
+//===- CombPaths.cpp - Combinational paths analysis -------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the FIRRTL CombPathsAnalysis.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/FIRRTL/CombPaths.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include <variant>
+
+using namespace circt;
+using namespace firrtl;
+
+//===----------------------------------------------------------------------===//
+// Node class
+//===----------------------------------------------------------------------===//
+
+using CombPathsMap = llvm::StringMap<ModuleCombPaths>;
+
+namespace {
+/// The graph context containing a pointer to the combinational paths of the
+/// modules visited so far, and the values the dummy source node points to.
+struct NodeContext {
+  CombPathsMap *map;
+  ArrayRef<Value> roots;
+
+  explicit NodeContext(CombPathsMap *map, ArrayRef<Value> roots)
+      : map(map), roots(roots) {}
+};
+} // namespace
+
+namespace {
+/// The node class of combinational graph.
+struct Node {
+  Value value;
+  NodeContext *context;
+
+  explicit Node(Value value = nullptr, NodeContext *context = nullptr)
+      : value(value), context(context) {}
+
+  bool operator==(const Node &rhs) const { return value == rhs.value; }
+  bool operator!=(const Node &rhs) const { return !(*this == rhs); }
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// ChildIterator class
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// This is a child iterator class for FIRRTL values. The base iterator is the
+/// `use_iterator` of a value. On top of the `use_iterator`, uses which are
+/// 'dest`s of connect ops and uses whose owner has no results are filtered out.
+class ChildIterator
+    : llvm::iterator_facade_base<ChildIterator, std::forward_iterator_tag,
+                                 Value> {
+  void skipToNextValidChild() {
+    auto isChild = [&]() {
+      if (auto connect = dyn_cast<ConnectOp>(childIt->getOwner()))
+        return childIt->get() == connect.src();
+      return childIt->getOwner()->getNumResults() > 0;
+    };
+    while (childIt != childEnd && !isChild())
+      ++childIt;
+  }
+
+public:
+  ChildIterator() = default;
+  explicit ChildIterator(Value v, bool end = false)
+      : childEnd(v.use_end()), childIt(end ? childEnd : v.use_begin()) {
+    skipToNextValidChild();
+  }
+
+  /// The iterator is empty or at the end.
+  bool isAtEnd() { return childIt == nullptr || childIt == childEnd; }
+
+  using llvm::iterator_facade_base<ChildIterator, std::forward_iterator_tag,
+                                   Value>::operator++;
+  ChildIterator &operator++() {
+    assert(!isAtEnd() && "incrementing the end iterator");
+    ++childIt;
+    skipToNextValidChild();
+    return *this;
+  }
+
+  Value operator*() {
+    assert(!isAtEnd() && "dereferencing the end iterator");
+    if (auto connect = dyn_cast<ConnectOp>(childIt->getOwner()))
+      return connect.dest();
+    return childIt->getOwner()->getResult(0);
+  }
+
+  bool operator==(const ChildIterator &rhs) const {
+    return childIt == rhs.childIt;
+  }
+  bool operator!=(const ChildIterator &rhs) const { return !(*this == rhs); }
+
+private:
+  Value::use_iterator childEnd;
+  Value::use_iterator childIt;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// NodeIterator class
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The default node iterator.
+class NodeIterator
+    : public llvm::iterator_facade_base<NodeIterator, std::forward_iterator_tag,
+                                        Node> {
+public:
+  explicit NodeIterator(Node node, bool end = false)
+      : node(node), child(ChildIterator(node.value, end)) {}
+
+  using llvm::iterator_facade_base<NodeIterator, std::forward_iterator_tag,
+                                   Node>::operator++;
+  NodeIterator &operator++() { return ++child, *this; }
+  Node operator*() { return Node(*child, node.context); }
+
+  bool operator==(const NodeIterator &rhs) const { return child == rhs.child; }
+  bool operator!=(const NodeIterator &rhs) const { return !(*this == rhs); }
+
+  Value getValue() { return node.value; }
+  CombPathsMap *getCombPathsMap() {
+    assert(node.context && "invalid node context");
+    return node.context->map;
+  }
+
+private:
+  Node node;
+
+protected:
+  ChildIterator child;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// InstanceNodeIterator class
+//===----------------------------------------------------------------------===//
+
+namespace {
+class InstanceNodeIterator : public NodeIterator {
+  /// Skip instance ports with not child.
+  void skipToNextValidPort() {
+    ChildIterator newChild;
+    while (portIt != portEnd) {
+      newChild = ChildIterator(instance.getResult(*portIt));
+      if (newChild.isAtEnd())
+        ++portIt;
+      else
+        break;
+    }
+    child = portIt == portEnd ? ChildIterator() : newChild;
+  }
+
+public:
+  explicit InstanceNodeIterator(InstanceOp instance, Node node,
+                                bool end = false)
+      : NodeIterator(node, true), instance(instance) {
+    assert(instance == getValue().getDefiningOp<InstanceOp>() &&
+           "instance must be the defining op of the node value");
+    if (end)
+      return;
+
+    // Query the combinational paths between IOs of the current instance. The
+    // referenced module has already been visited, as modules are visited in
+    // post order.
+    auto &combPaths = (*getCombPathsMap())[instance.moduleName()];
+    auto &ports =
+        combPaths.paths[getValue().cast<OpResult>().getResultNumber()];
+
+    portEnd = ports.end();
+    portIt = ports.begin();
+    skipToNextValidPort();
+  }
+
+  InstanceNodeIterator &operator++() {
+    if (!child.isAtEnd())
+      ++child;
+    if (child.isAtEnd()) {
+      ++portIt;
+      skipToNextValidPort();
+    }
+    return *this;
+  }
+
+private:
+  InstanceOp instance;
+  SmallVectorImpl<size_t>::iterator portEnd;
+  SmallVectorImpl<size_t>::iterator portIt;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// SubfieldNodeIterator class
+//===----------------------------------------------------------------------===//
+
+namespace {
+class SubfieldNodeIterator : public NodeIterator {
+public:
+  explicit SubfieldNodeIterator(SubfieldOp subfield, Node node,
+                                bool end = false)
+      : NodeIterator(node, true) {
+    assert(subfield == node.value.getDefiningOp<SubfieldOp>() &&
+           "subfield must be the defining op of the node value");
+    if (end)
+      return;
+
+    auto memory = subfield.input().getDefiningOp<MemOp>();
+    if (!memory) {
+      subfield->emitOpError("input must be a port of a MemOp, please run "
+                            "-firrtl-lower-types first");
+      return;
+    }
+
+    if (memory.readLatency() != 0)
+      return;
+
+    auto portKind =
+        memory.getPortKind(subfield.input().cast<OpResult>().getResultNumber());
+    auto subfieldIndex = subfield.fieldIndex();
+    // Combinational path exists only when the current subfield is `addr`.
+    if (!(portKind == MemOp::PortKind::Read &&
+          subfieldIndex == (unsigned)ReadPortSubfield::addr) &&
+        !(portKind == MemOp::PortKind::ReadWrite &&
+          subfieldIndex == (unsigned)ReadWritePortSubfield::addr))
+      return;
+
+    // Only `data` or `rdata` subfield is combinationally connected to `addr`
+    // subfield. Find the corresponding subfield op.
+    for (auto user : subfield.input().getUsers()) {
+      auto currentSubfield = dyn_cast<SubfieldOp>(user);
+      if (!currentSubfield) {
+        user->emitOpError("MemOp must be used by SubfieldOp, please run "
+                          "-firrtl-lower-types first");
+        return;
+      }
+
+      auto index = currentSubfield.fieldIndex();
+      if ((portKind == MemOp::PortKind::Read &&
+           index == (unsigned)ReadPortSubfield::data) ||
+          (portKind == MemOp::PortKind::ReadWrite &&
+           index == (unsigned)ReadWritePortSubfield::rdata)) {
+        child = ChildIterator(currentSubfield.result());
+        return;
+      }
+    }
+  }
+
+  SubfieldNodeIterator &operator++() {
+    if (!child.isAtEnd())
+      ++child;
+    if (child.isAtEnd())
+      child = ChildIterator();
+    return *this;
+  }
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// DummySourceNodeIterator class
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A dummy source node iterator on the root values of the node context, which
+/// are the `dest`s of all connect ops and the input ports of the module.
+class DummySourceNodeIterator
+    : public llvm::iterator_facade_base<DummySourceNodeIterator,
+                                        std::forward_iterator_tag, Node> {
+public:
+  explicit DummySourceNodeIterator(Node node, bool end = false)
+      : node(node), root(end ? node.context->roots.end()
+                             : node.context->roots.begin()) {}
+
+  using llvm::iterator_facade_base<DummySourceNodeIterator,
+                                   std::forward_iterator_tag, Node>::operator++;
+  DummySourceNodeIterator &operator++() {
+    assert(root != node.context->roots.end() &&
+           "incrementing the end iterator");
+    return ++root, *this;
+  }
+  Node operator*() {
+    assert(root != node.context->roots.end() &&
+           "dereferencing the end iterator");
+    return Node(*root, node.context);
+  }
+
+  bool operator==(const DummySourceNodeIterator &rhs) const {
+    return root == rhs.root;
+  }
+  bool operator!=(const DummySourceNodeIterator &rhs) const {
+    return !(*this == rhs);
+  }
+
+private:
+  Node node;
+  ArrayRef<Value>::iterator root;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// CombGraphIterator class
+//===----------------------------------------------------------------------===//
+
+namespace {
+class CombGraphIterator
+    : public llvm::iterator_facade_base<CombGraphIterator,
+                                        std::forward_iterator_tag, Node> {
+  using variant_iterator =
+      std::variant<NodeIterator, InstanceNodeIterator, SubfieldNodeIterator,
+                   DummySourceNodeIterator>;
+
+public:
+  explicit CombGraphIterator(Node node, bool end = false)
+      : impl(dispatchConstructor(node, end)) {}
+
+  variant_iterator dispatchConstructor(Node node, bool end) {
+    if (!node.value)
+      return DummySourceNodeIterator(node, end);
+
+    auto defOp = node.value.getDefiningOp();
+    if (!defOp)
+      return NodeIterator(node, end);
+
+    return TypeSwitch<Operation *, variant_iterator>(defOp)
+        .Case<InstanceOp>([&](InstanceOp instance) {
+          return InstanceNodeIterator(instance, node, end);
+        })
+        .Case<SubfieldOp>([&](SubfieldOp subfield) {
+          return SubfieldNodeIterator(subfield, node, end);
+        })
+        // The children of reg or regreset op are not iterated.
+        .Case<RegOp, RegResetOp>([&](auto) { return NodeIterator(node, true); })
+        .Default([&](auto) { return NodeIterator(node, end); });
+  }
+
+  using llvm::iterator_facade_base<CombGraphIterator, std::forward_iterator_tag,
+                                   Node>::operator++;
+  CombGraphIterator &operator++() {
+    switch (impl.index()) {
+    case 0:
+      return ++std::get<NodeIterator>(impl), *this;
+    case 1:
+      return ++std::get<InstanceNodeIterator>(impl), *this;
+    case 2:
+      return ++std::get<SubfieldNodeIterator>(impl), *this;
+    case 3:
+      return ++std::get<DummySourceNodeIterator>(impl), *this;
+    default:
+      return llvm_unreachable("invalid iterator variant"), *this;
+    }
+  }
+
+  Node operator*() {
+    switch (impl.index()) {
+    case 0:
+      return *std::get<NodeIterator>(impl);
+    case 1:
+      return *std::get<InstanceNodeIterator>(impl);
+    case 2:
+      return *std::get<SubfieldNodeIterator>(impl);
+    case 3:
+      return *std::get<DummySourceNodeIterator>(impl);
+    default:
+      return llvm_unreachable("invalid iterator variant"), Node();
+    }
+  }
+
+  bool operator==(const CombGraphIterator &rhs) const {
+    return impl == rhs.impl;
+  }
+  bool operator!=(const CombGraphIterator &rhs) const {
+    return !(*this == rhs);
+  }
+
+private:
+  variant_iterator impl;
+};
+} // namespace
+
+//===----------------------------------------------------------------------===//
+// DenseMapInfo on Node
+//===----------------------------------------------------------------------===//
+
+namespace llvm {
+template <>
+struct DenseMapInfo<Node> {
+  static Node getEmptyKey() {
+    auto pointer = llvm::DenseMapInfo<void *>::getEmptyKey();
+    return Node(Value::getFromOpaquePointer(pointer));
+  }
+  static Node getTombstoneKey() {
+    auto pointer = llvm::DenseMapInfo<void *>::getTombstoneKey();
+    return Node(Value::getFromOpaquePointer(pointer));
+  }
+
+  static unsigned getHashValue(const Node &node) {
+    return mlir::hash_value(node.value);
+  }
+  static bool isEqual(const Node &lhs, const Node &rhs) { return lhs == rhs; }
+};
+} // namespace llvm
+
+//===----------------------------------------------------------------------===//
+// GraphTraits on Node
+//===----------------------------------------------------------------------===//
+
+namespace llvm {
+template <>
+struct GraphTraits<Node> {
+  using NodeRef = Node;
+  using ChildIteratorType = CombGraphIterator;
+
+  static NodeRef getEntryNode(NodeRef node) { return node; }
+
+  static inline ChildIteratorType child_begin(NodeRef node) {
+    return ChildIteratorType(node);
+  }
+  static inline ChildIteratorType child_end(NodeRef node) {
+    return ChildIteratorType(node, /*end=*/true);
+  }
+};
+} // namespace llvm
+
+//===----------------------------------------------------------------------===//
+// CombPathsAnalysis
+//===----------------------------------------------------------------------===//
+
+bool ModuleCombPaths::hasPath(StringRef input, StringRef output) const {
+  for (size_t i = 0, e = portNames.size(); i != e; ++i) {
+    if (portNames[i].getValue() != input)
+      continue;
+    for (auto port : paths[i])
+      if (portNames[port].getValue() == output)
+        return true;
+  }
+  return false;
+}
+
+CombPathsAnalysis::CombPathsAnalysis(Operation *circuit) {
+  InstanceGraph instanceGraph(circuit);
+  analyze(instanceGraph);
+}
+
+CombPathsAnalysis::CombPathsAnalysis(Operation *circuit,
+                                     InstanceGraph &instanceGraph) {
+  analyze(instanceGraph);
+}
+
+/// This constructs a local graph for each module to detect combinational
+/// cycles. To capture the cross-module combinational cycles, the combinational
+/// paths between IOs of its subinstances are inlined into the graph of a
+/// module, using the summaries of the modules visited before it.
+///
+/// The combinational paths of a module are computed in the same SCC traversal
+/// that detects the cycles. The traversal visits the SCCs of the graph in post
+/// order, such that the set of output ports reachable from an SCC is the union
+/// of the sets of its successor SCCs. This visits every node and edge of the
+/// module once, rather than once for every input port.
+void CombPathsAnalysis::analyze(InstanceGraph &instanceGraph) {
+  // Traverse modules in a post order to make sure the combinational paths
+  // between IOs of a module have been detected and recorded before we handle
+  // its parent modules.
+  for (auto node : llvm::post_order<InstanceGraph *>(&instanceGraph)) {
+    if (auto module = dyn_cast<FModuleOp>(node->getModule())) {
+      auto ports = module.getPorts();
+      SmallVector<bool, 8> directionVec;
+      for (auto &port : ports)
+        directionVec.push_back(port.isOutput());
+
+      // As FIRRTL module is an SSA region, all cycles must contain at least
+      // one connect op. Thus we introduce a dummy source node to iterate on
+      // the `dest`s of all connect ops in the module. The input ports are
+      // added such that the paths starting at them are visited as well.
+      SmallVector<Value> roots;
+      for (auto connect : module.getOps<ConnectOp>())
+        roots.push_back(connect.dest());
+      for (unsigned i = 0, e = ports.size(); i != e; ++i)
+        if (!directionVec[i])
+          roots.push_back(module.getPortArgument(i));
+      NodeContext context(&modules, roots);
+      auto dummyNode = Node(nullptr, &context);
+
+      // The SCC each node belongs to, and the output ports reachable from
+      // each SCC.
+      DenseMap<Value, unsigned> sccIndices;
+      std::vector<llvm::SmallBitVector> sccOutputs;
+
+      // Traversing SCCs in the combinational graph to detect cycles.
+      using SCCIterator = llvm::scc_iterator<Node>;
+      for (auto combSCC = SCCIterator::begin(dummyNode); !combSCC.isAtEnd();
+           ++combSCC) {
+        if (combSCC.hasCycle()) {
+          CombCycle cycle{module.getLoc(), {}};
+          for (auto node : *combSCC)
+            cycle.valueLocs.push_back(node.value.getLoc());
+          cycles.push_back(std::move(cycle));
+        }
+
+        // Gather the output ports reachable from this SCC. Successors are
+        // either in this SCC or in one that has already been visited.
+        unsigned index = sccOutputs.size();
+        llvm::SmallBitVector outputs(ports.size());
+        for (auto node : *combSCC)
+          if (node.value)
+            sccIndices.insert({node.value, index});
+        for (auto node : *combSCC) {
+          if (!node.value)
+            continue;
+          if (auto output = node.value.dyn_cast<BlockArgument>())
+            if (directionVec[output.getArgNumber()])
+              outputs.set(output.getArgNumber());
+          for (auto child : llvm::children<Node>(node)) {
+            auto childIndex = sccIndices.lookup(child.value);
+            if (childIndex != index)
+              outputs |= sccOutputs[childIndex];
+          }
+        }
+        sccOutputs.push_back(std::move(outputs));
+      }
+
+      // Record all combinational paths.
+      auto &combPaths = modules[module.getName()];
+      for (unsigned i = 0, e = ports.size(); i != e; ++i) {
+        combPaths.portNames.push_back(ports[i].name);
+        SmallVector<size_t, 2> outputVec;
+        if (!directionVec[i]) {
+          auto &outputs =
+              sccOutputs[sccIndices.lookup(module.getPortArgument(i))];
+          for (auto output : outputs.set_bits())
+            outputVec.push_back(output);
+        }
+        combPaths.paths.push_back(outputVec);
+      }
+    } else if (auto extModule = dyn_cast<FExtModuleOp>(node->getModule())) {
+      // TODO: Handle FExtModuleOp with `ExtModulePathAnnotation`s.
+      auto &combPaths = modules[extModule.getName()];
+      for (auto &port : extModule.getPorts())
+        combPaths.portNames.push_back(port.name);
+      combPaths.paths.resize(extModule.getNumArguments());
+    }
+  }
+}
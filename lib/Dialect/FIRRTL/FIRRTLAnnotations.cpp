@@ -16,7 +16,6 @@
 #include "mlir/IR/FunctionImplementation.h"
 #include "mlir/IR/Operation.h"
 
-using mlir::function_like_impl::getArgAttrDict;
 using mlir::function_like_impl::setAllArgAttrDicts;
 
 using namespace circt;
@@ -205,7 +204,102 @@ AnnotationSet::applyToPortDictionaryAttr(ArrayRef<NamedAttribute> attrs) const {
                                    false, {});
 }
 
+//===----------------------------------------------------------------------===//
+// AnnotationClassCache
+//===----------------------------------------------------------------------===//
+
+/// Return the class of an annotation of an annotation array, or null if it has
+/// none.
+static StringAttr getAnnotationClass(Attribute annotation) {
+  DictionaryAttr annotDict;
+  if (auto dict = annotation.dyn_cast<DictionaryAttr>())
+    annotDict = dict;
+  else
+    annotDict = annotation.cast<SubAnnotationAttr>().getAnnotations();
+  return annotDict.getAs<StringAttr>("class");
+}
+
+detail::AnnotationClassCache::AnnotationClassCache() {
+  classBitsCopies.push_back(std::make_unique<ClassBits>());
+  classBits = classBitsCopies.back().get();
+}
+
+Optional<bool> detail::AnnotationClassCache::hasClass(ArrayAttr annotations,
+                                                      StringRef className) {
+  // Summarize the array first, this may give the class a bit.
+  auto summary = getSummary(annotations);
+  if (auto bit = getClassBit(className))
+    return (summary.classes & bit) != 0;
+  if (!summary.hasOtherClasses)
+    return false;
+  return {};
+}
+
+detail::AnnotationClassSummary
+detail::AnnotationClassCache::getSummary(ArrayAttr annotations) {
+  auto &shard = shards[llvm::hash_value(annotations.getAsOpaquePointer()) %
+                       numShards];
+  {
+    llvm::sys::SmartScopedReader<true> lock(shard.mutex);
+    auto it = shard.summaries.find(annotations);
+    if (it != shard.summaries.end())
+      return it->second;
+  }
+
+  // Register the classes of the array before its summary is published, so
+  // that the summaries account for every class which has a bit.
+  auto summary = summarize(annotations);
+  llvm::sys::SmartScopedWriter<true> lock(shard.mutex);
+  shard.summaries.try_emplace(annotations, summary);
+  return summary;
+}
+
+detail::AnnotationClassSummary
+detail::AnnotationClassCache::summarize(ArrayAttr annotations) {
+  AnnotationClassSummary summary;
+  for (auto annotation : annotations) {
+    auto annotClass = getAnnotationClass(annotation);
+    if (!annotClass)
+      continue;
+    auto bit = getClassBit(annotClass.getValue());
+    if (!bit) {
+      llvm::sys::SmartScopedLock<true> lock(classBitsMutex);
+      auto *current = classBits.load(std::memory_order_relaxed);
+      bit = current->lookup(annotClass.getValue());
+      if (!bit && current->size() < 64) {
+        bit = uint64_t(1) << current->size();
+        classBitsCopies.push_back(std::make_unique<ClassBits>(*current));
+        classBitsCopies.back()->insert({annotClass.getValue(), bit});
+        classBits.store(classBitsCopies.back().get(),
+                        std::memory_order_release);
+      }
+    }
+    if (bit)
+      summary.classes |= bit;
+    else
+      summary.hasOtherClasses = true;
+  }
+  return summary;
+}
+
+uint64_t detail::AnnotationClassCache::getClassBit(StringRef className) const {
+  return classBits.load(std::memory_order_acquire)->lookup(className);
+}
+
+//===----------------------------------------------------------------------===//
+// AnnotationSet queries
+//===----------------------------------------------------------------------===//
+
+Optional<bool> AnnotationSet::lookupAnnotationClass(StringRef className) const {
+  auto *dialect = getContext()->getLoadedDialect<FIRRTLDialect>();
+  if (!dialect)
+    return {};
+  return dialect->getAnnotationClassCache().hasClass(annotations, className);
+}
+
 DictionaryAttr AnnotationSet::getAnnotationImpl(StringAttr className) const {
+  if (lookupAnnotationClass(className.getValue()) == false)
+    return {};
   for (auto annotation : annotations) {
     DictionaryAttr annotDict;
     if (auto dict = annotation.dyn_cast<DictionaryAttr>())
@@ -220,6 +314,8 @@ DictionaryAttr AnnotationSet::getAnnotationImpl(StringAttr className) const {
 }
 
 DictionaryAttr AnnotationSet::getAnnotationImpl(StringRef className) const {
+  if (lookupAnnotationClass(className) == false)
+    return {};
   for (auto annotation : annotations) {
     DictionaryAttr annotDict;
     if (auto dict = annotation.dyn_cast<DictionaryAttr>())
@@ -235,10 +331,14 @@ DictionaryAttr AnnotationSet::getAnnotationImpl(StringRef className) const {
 }
 
 bool AnnotationSet::hasAnnotationImpl(StringAttr className) const {
+  if (auto known = lookupAnnotationClass(className.getValue()))
+    return *known;
   return getAnnotationImpl(className) != DictionaryAttr();
 }
 
 bool AnnotationSet::hasAnnotationImpl(StringRef className) const {
+  if (auto known = lookupAnnotationClass(className))
+    return *known;
   return getAnnotationImpl(className) != DictionaryAttr();
 }
 
@@ -367,42 +467,63 @@ bool AnnotationSet::removeAnnotations(Operation *op, StringRef className) {
 bool AnnotationSet::removePortAnnotations(
     Operation *module,
     llvm::function_ref<bool(unsigned, Annotation)> predicate) {
-  // We need to reserve some space to gather the remaining attributes, without
-  // the removed ones.
-  SmallVector<DictionaryAttr, 8> filteredArgAttrs;
-  FunctionType moduleF = mlir::function_like_impl::getFunctionType(module);
-  filteredArgAttrs.reserve(moduleF.getNumInputs());
-
-  // Filter the annotations on each argument.
-  bool changed = false;
-  for (unsigned argNum = 0, argNumEnd = moduleF.getNumInputs();
-       argNum < argNumEnd; ++argNum) {
-    auto annos = AnnotationSet::forPort(module, argNum);
-
-    // Fast path if there are no annotations that we could possibly remove.
-    if (annos.empty()) {
-      filteredArgAttrs.push_back(getArgAttrDict(module, argNum));
-      continue;
-    }
+  PortAnnotationsBuilder portAnnos(module);
+  portAnnos.removeAnnotations(predicate);
+  return portAnnos.applyToModule();
+}
 
-    // Go through all annotations on this port and extract the interesting
-    // ones. If any modifications were done, keep a reduced set of attributes
-    // around for the port, otherwise just stick with the existing ones.
-    bool argChanged = annos.removeAnnotations(
-        [&](Annotation anno) { return predicate(argNum, anno); });
-    if (argChanged) {
-      changed = true;
-      filteredArgAttrs.push_back(
-          annos.applyToPortDictionaryAttr(getArgAttrDict(module, argNum)));
-    } else {
-      filteredArgAttrs.push_back(getArgAttrDict(module, argNum));
-    }
+//===----------------------------------------------------------------------===//
+// PortAnnotationsBuilder
+//===----------------------------------------------------------------------===//
+
+PortAnnotationsBuilder::PortAnnotationsBuilder(Operation *module)
+    : module(module) {
+  auto *context = module->getContext();
+  auto numPorts =
+      mlir::function_like_impl::getFunctionType(module).getNumInputs();
+  auto argAttrs = module->getAttrOfType<ArrayAttr>(
+      mlir::function_like_impl::getArgDictAttrName());
+  auto emptyDict = DictionaryAttr::get(context, {});
+  portAttrs.reserve(numPorts);
+  annotations.reserve(numPorts);
+  for (unsigned portNo = 0; portNo != numPorts; ++portNo) {
+    auto dict = argAttrs ? argAttrs[portNo].cast<DictionaryAttr>() : emptyDict;
+    portAttrs.push_back(dict);
+    annotations.push_back(AnnotationSet(
+        dict.getAs<ArrayAttr>(getDialectAnnotationAttrName()), context));
   }
+}
+
+void PortAnnotationsBuilder::setPortAnnotations(unsigned portNo,
+                                                AnnotationSet portAnnotations) {
+  if (annotations[portNo] == portAnnotations)
+    return;
+  annotations[portNo] = portAnnotations;
+  changed = true;
+}
 
-  // If we have made any changes, apply them to the operation.
-  if (changed)
-    setAllArgAttrDicts(module, filteredArgAttrs);
-  return changed;
+bool PortAnnotationsBuilder::removeAnnotations(
+    llvm::function_ref<bool(unsigned, Annotation)> predicate) {
+  bool anyRemoved = false;
+  for (auto portAnnos : llvm::enumerate(annotations))
+    anyRemoved |= portAnnos.value().removeAnnotations(
+        [&](Annotation anno) { return predicate(portAnnos.index(), anno); });
+  changed |= anyRemoved;
+  return anyRemoved;
+}
+
+bool PortAnnotationsBuilder::applyToModule() {
+  if (!changed)
+    return false;
+  SmallVector<DictionaryAttr, 8> newPortAttrs;
+  newPortAttrs.reserve(annotations.size());
+  for (auto port : llvm::zip(annotations, portAttrs))
+    newPortAttrs.push_back(
+        std::get<0>(port).applyToPortDictionaryAttr(std::get<1>(port)));
+  setAllArgAttrDicts(module, newPortAttrs);
+  portAttrs = std::move(newPortAttrs);
+  changed = false;
+  return true;
 }
 
 //===----------------------------------------------------------------------===//
@@ -88,33 +88,25 @@ std::string circt::firrtl::getFieldName(const FieldRef &fieldRef,
   getDeclName(value, name);
   rootKnown = !name.empty();
 
-  auto type = value.getType();
-  auto localID = fieldRef.getFieldID();
-  while (localID) {
-    if (auto bundleType = type.dyn_cast<BundleType>()) {
-      auto index = bundleType.getIndexForFieldID(localID);
-      // Add the current field string, and recurse into a subfield.
-      auto &element = bundleType.getElements()[index];
+  // Collect the fields from the referenced one up to the root, as their
+  // parent aggregates and indices within them.
+  auto type = value.getType().cast<FIRRTLType>();
+  SmallVector<std::pair<FIRRTLType, unsigned>, 8> path;
+  for (auto localID = fieldRef.getFieldID(); localID;) {
+    auto info = type.getFieldIDInfo(localID);
+    path.push_back({type.getFieldType(info.parentID), info.index});
+    localID = info.parentID;
+  }
+
+  for (auto &field : llvm::reverse(path)) {
+    if (auto bundleType = field.first.dyn_cast<BundleType>()) {
       if (!name.empty())
         name += ".";
-      name += element.name.getValue();
-      // Recurse in to the element type.
-      type = element.type;
-      localID = localID - bundleType.getFieldID(index);
-    } else if (auto vecType = type.dyn_cast<FVectorType>()) {
-      auto index = vecType.getIndexForFieldID(localID);
+      name += bundleType.getElement(field.second).name.getValue();
+    } else {
       name += "[";
-      name += std::to_string(index);
+      name += std::to_string(field.second);
       name += "]";
-      // Recurse in to the element type.
-      type = vecType.getElementType();
-      localID = localID - vecType.getFieldID(index);
-    } else {
-      // If we reach here, the field ref is pointing inside some aggregate type
-      // that isn't a bundle or a vector. If the type is a ground type, then the
-      // localID should be 0 at this point, and we should have broken from the
-      // loop.
-      llvm_unreachable("unsupported type");
     }
   }
 
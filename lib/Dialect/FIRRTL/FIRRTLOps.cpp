@@ -937,6 +937,12 @@ void InstanceOp::build(OpBuilder &builder, OperationState &result,
 
   build(builder, result, newResultTypes, existingInstance->getOperands(),
         existingInstance->getAttrs());
+
+  // Drop the annotations of the erased results as well.
+  SmallVector<Attribute> newPortAnnotations = removeElementsAtIndices(
+      existingInstance.portAnnotations().getValue(), resultsToErase);
+  result.attributes.set("portAnnotations",
+                        builder.getArrayAttr(newPortAnnotations));
 }
 
 ArrayAttr InstanceOp::getPortAnnotation(unsigned portIdx) {
@@ -952,7 +958,8 @@ void InstanceOp::setAllPortAnnotations(ArrayRef<Attribute> annotations) {
                    ArrayAttr::get(getContext(), annotations));
 }
 
-/// Verify the correctness of an InstanceOp.
+/// Verify the correctness of an InstanceOp.  The checks against the referenced
+/// module are done by verifySymbolUses.
 static LogicalResult verifyInstanceOp(InstanceOp instance) {
 
   // Check that this instance is inside a module.
@@ -962,40 +969,55 @@ static LogicalResult verifyInstanceOp(InstanceOp instance) {
     return failure();
   }
 
-  auto *referencedModule = instance.getReferencedModule();
-  if (!referencedModule) {
-    instance.emitOpError("invalid symbol reference");
-    return failure();
-  }
+  if (instance.portAnnotations().size() != instance.getNumResults())
+    return instance.emitOpError("the number of result annotations should be "
+                                "equal to the number of results");
+
+  return success();
+}
+
+/// Verify the instance against the referenced module.  This is called by the
+/// verifier of the circuit with a symbol table shared by all the instances, so
+/// the module lookups are hash lookups rather than scans of the circuit.
+LogicalResult
+InstanceOp::verifySymbolUses(SymbolTableCollection &symbolTable) {
+  auto module = (*this)->getParentOfType<FModuleOp>();
+  if (!module)
+    return success();
+
+  auto *referencedModule =
+      symbolTable.lookupNearestSymbolFrom(*this, moduleNameAttr());
+  if (!referencedModule || !isa<FModuleOp, FExtModuleOp>(referencedModule))
+    return emitOpError("invalid symbol reference");
 
   // Check that this instance doesn't recursively instantiate its wrapping
   // module.
   if (referencedModule == module) {
-    auto diag = instance.emitOpError()
+    auto diag = emitOpError()
                 << "is a recursive instantiation of its containing module";
     diag.attachNote(module.getLoc()) << "containing module declared here";
     return failure();
   }
 
-  SmallVector<ModulePortInfo> modulePorts = getModulePortInfo(referencedModule);
-
   // Check that result types are consistent with the referenced module's ports.
-  size_t numResults = instance.getNumResults();
-  if (numResults != modulePorts.size()) {
-    auto diag = instance.emitOpError()
+  auto portTypes = getModuleType(referencedModule).getInputs();
+  size_t numResults = getNumResults();
+  if (numResults != portTypes.size()) {
+    auto diag = emitOpError()
                 << "has a wrong number of results; expected "
-                << modulePorts.size() << " but got " << numResults;
+                << portTypes.size() << " but got " << numResults;
     diag.attachNote(referencedModule->getLoc())
         << "original module declared here";
     return failure();
   }
 
   for (size_t i = 0; i != numResults; i++) {
-    auto resultType = instance.getResult(i).getType();
-    auto expectedType = modulePorts[i].type;
+    auto resultType = getResult(i).getType();
+    auto expectedType = portTypes[i];
     if (resultType != expectedType) {
-      auto diag = instance.emitOpError()
-                  << "result type for " << modulePorts[i].name << " must be "
+      auto diag = emitOpError()
+                  << "result type for "
+                  << getModulePortName(referencedModule, i) << " must be "
                   << expectedType << ", but got " << resultType;
 
       diag.attachNote(referencedModule->getLoc())
@@ -1004,10 +1026,6 @@ static LogicalResult verifyInstanceOp(InstanceOp instance) {
     }
   }
 
-  if (instance.portAnnotations().size() != instance.getNumResults())
-    return instance.emitOpError("the number of result annotations should be "
-                                "equal to the number of results");
-
   return success();
 }
 
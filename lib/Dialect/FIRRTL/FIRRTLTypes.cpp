@@ -17,6 +17,8 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/ADT/TypeSwitch.h"
 
+#include <atomic>
+
 using namespace circt;
 using namespace firrtl;
 
@@ -411,6 +413,54 @@ std::pair<unsigned, bool> FIRRTLType::rootChildFieldID(unsigned fieldID,
       });
 }
 
+FieldIDInfo FIRRTLType::getFieldIDInfo(unsigned fieldID) {
+  return TypeSwitch<FIRRTLType, FieldIDInfo>(*this)
+      .Case<BundleType, FVectorType>(
+          [&](auto type) { return type.getFieldIDInfo(fieldID); })
+      .Default([&](FIRRTLType type) {
+        assert(fieldID == 0 && "ground types have no fields");
+        return FieldIDInfo{type, 0, 0};
+      });
+}
+
+FIRRTLType FIRRTLType::getFieldType(unsigned fieldID) {
+  return getFieldIDInfo(fieldID).type;
+}
+
+/// Describe the field `fieldID` of an aggregate type by descending into the
+/// element containing it.
+template <typename AggregateType>
+static FieldIDInfo getNestedFieldIDInfo(AggregateType type, unsigned fieldID,
+                                        FIRRTLType elementType) {
+  auto index = type.getIndexForFieldID(fieldID);
+  auto elementID = type.getFieldID(index);
+  if (fieldID == elementID)
+    return {elementType, 0, index};
+  auto info = elementType.getFieldIDInfo(fieldID - elementID);
+  info.parentID += elementID;
+  return info;
+}
+
+/// Fill in the entries of a field table for the fields nested in `type`, the
+/// type of the field `fieldID`.
+static void fillFieldTable(FIRRTLType type, unsigned fieldID,
+                           FieldIDInfo *table) {
+  if (auto bundleType = type.dyn_cast<BundleType>()) {
+    for (auto it : llvm::enumerate(bundleType.getElements())) {
+      auto elementID = fieldID + bundleType.getFieldID(it.index());
+      table[elementID] = {it.value().type, fieldID, unsigned(it.index())};
+      fillFieldTable(it.value().type, elementID, table);
+    }
+  } else if (auto vectorType = type.dyn_cast<FVectorType>()) {
+    auto elementType = vectorType.getElementType();
+    for (unsigned i = 0, e = vectorType.getNumElements(); i != e; ++i) {
+      auto elementID = fieldID + vectorType.getFieldID(i);
+      table[elementID] = {elementType, fieldID, i};
+      fillFieldTable(elementType, elementID, table);
+    }
+  }
+}
+
 /// Helper to implement the equivalence logic for a pair of bundle elements.
 /// Note that the FIRRTL spec requires bundle elements to have the same
 /// orientation, but this only compares their passive types. The FIRRTL dialect
@@ -660,6 +710,13 @@ struct BundleTypeStorage : mlir::TypeStorage {
   SmallVector<unsigned, 4> fieldIDs;
   unsigned maxFieldID;
 
+  ~BundleTypeStorage() { delete[] fieldTable.load(); }
+
+  /// The description of each field ID, built on first use and owned by the
+  /// storage.  Types may be queried from several threads, so it is only
+  /// published once complete.
+  std::atomic<FieldIDInfo *> fieldTable = {nullptr};
+
   /// This holds the bits for the type's recursive properties, and can hold a
   /// pointer to a passive version of the type.
   llvm::PointerIntPair<Type, RecursiveTypeProperties::numBits, unsigned>
@@ -760,6 +817,40 @@ unsigned BundleType::getIndexForFieldID(unsigned fieldID) {
 
 unsigned BundleType::getMaxFieldID() { return getImpl()->maxFieldID; }
 
+/// The largest bundles, by number of nested fields, which keep a field table.
+/// Larger ones are mostly made of large vectors, which are cheap to descend.
+static constexpr unsigned maxFieldTableSize = 4096;
+
+FieldIDInfo BundleType::getFieldIDInfo(unsigned fieldID) {
+  assert(fieldID <= getMaxFieldID() && "invalid field ID");
+  if (fieldID == 0)
+    return {*this, 0, 0};
+
+  // The field IDs of a bundle of ground types are the indices of its elements,
+  // it needs no table.
+  auto *impl = getImpl();
+  if (impl->maxFieldID == impl->elements.size())
+    return {impl->elements[fieldID - 1].type, 0, fieldID - 1};
+
+  auto *table = impl->fieldTable.load(std::memory_order_acquire);
+  if (!table && impl->maxFieldID <= maxFieldTableSize) {
+    auto *newTable = new FieldIDInfo[impl->maxFieldID + 1];
+    newTable[0] = {*this, 0, 0};
+    fillFieldTable(*this, 0, newTable);
+    // Keep the table of another thread if it was first.
+    if (impl->fieldTable.compare_exchange_strong(table, newTable,
+                                                 std::memory_order_acq_rel))
+      table = newTable;
+    else
+      delete[] newTable;
+  }
+  if (table)
+    return table[fieldID];
+
+  return getNestedFieldIDInfo(
+      *this, fieldID, getElements()[getIndexForFieldID(fieldID)].type);
+}
+
 std::pair<unsigned, bool> BundleType::rootChildFieldID(unsigned fieldID,
                                                        unsigned index) {
   auto childRoot = getFieldID(index);
@@ -853,6 +944,13 @@ unsigned FVectorType::getMaxFieldID() {
   return getNumElements() * (getElementType().getMaxFieldID() + 1);
 }
 
+FieldIDInfo FVectorType::getFieldIDInfo(unsigned fieldID) {
+  assert(fieldID <= getMaxFieldID() && "invalid field ID");
+  if (fieldID == 0)
+    return {*this, 0, 0};
+  return getNestedFieldIDInfo(*this, fieldID, getElementType());
+}
+
 std::pair<unsigned, bool> FVectorType::rootChildFieldID(unsigned fieldID,
                                                         unsigned index) {
   auto childRoot = getFieldID(index);
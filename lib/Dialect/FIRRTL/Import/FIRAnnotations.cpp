@@ -16,8 +16,12 @@
 #include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/OperationSupport.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/ConvertUTF.h"
 #include "llvm/Support/JSON.h"
+#include <cmath>
+#include <limits>
 
 namespace json = llvm::json;
 
@@ -155,6 +159,40 @@ static llvm::Optional<std::string> canonicalizeTarget(StringRef target) {
   return llvm::Optional<std::string>(newTarget);
 }
 
+/// Return true if the canonical \p target is non-local, which is unsupported.
+/// This allows instance targets, and disallows anything more deeply nested.
+/// E.g., this is allowing:
+///     ~Foo|Foo/bar:Bar
+/// But, this is disallowing:
+///     ~Foo|Foo/bar:Bar/baz:Baz
+static bool isNonLocalTarget(StringRef target) {
+  return llvm::count_if(target, [](char a) { return a == '/' || a == ':'; }) >
+         2;
+}
+
+/// Return true if the canonical \p target refers to something in the circuit
+/// named by \p circuitTarget.
+static bool isTargetInCircuit(StringRef target, StringRef circuitTarget) {
+  if (target == "~")
+    return true;
+  return circuitTarget == target.take_front(target.find_first_of('|'));
+}
+
+/// Add the annotations collected for each target to \p annotationMap, after
+/// any that are already there.
+static void
+mergeAnnotations(llvm::StringMap<llvm::SmallVector<Attribute>> &newAnnotations,
+                 llvm::StringMap<ArrayAttr> &annotationMap,
+                 MLIRContext *context) {
+  for (auto &entry : newAnnotations) {
+    auto &existing = annotationMap[entry.getKey()];
+    // If multiple annotations on a single object, then append it.
+    if (existing)
+      entry.getValue().append(existing.begin(), existing.end());
+    existing = ArrayAttr::get(context, entry.getValue());
+  }
+}
+
 /// Implements the same behavior as DictionaryAttr::getAs<A> to return the value
 /// of a specific type associated with a key in a dictionary.  However, this is
 /// specialized to print a useful error message, specific to custom annotation
@@ -234,14 +272,8 @@ bool circt::firrtl::fromJSON(json::Value &value, StringRef circuitTarget,
     auto target = canonTargetStr.getValue();
 
     // Allow targets through that are instance targets.  Error on anything which
-    // is actually non-local.  E.g., this is allowing:
-    //     ~Foo|Foo/bar:Bar
-    // But, this is disallowing:
-    //     ~Foo|Foo/bar:Bar/baz:Baz
-    bool unsupported = std::count_if(target.begin(), target.end(), [](char a) {
-                         return a == '/' || a == ':';
-                       }) > 2;
-    if (unsupported) {
+    // is actually non-local.
+    if (isNonLocalTarget(target)) {
       p.field("target").report("unsupported non-local target");
       return {};
     }
@@ -333,12 +365,9 @@ bool circt::firrtl::fromJSON(json::Value &value, StringRef circuitTarget,
       return false;
     StringRef targetStrRef = optTarget.getValue();
 
-    if (targetStrRef != "~") {
-      auto circuitFieldEnd = targetStrRef.find_first_of('|');
-      if (circuitTarget != targetStrRef.take_front(circuitFieldEnd)) {
-        p.report("annotation has invalid circuit name");
-        return false;
-      }
+    if (!isTargetInCircuit(targetStrRef, circuitTarget)) {
+      p.report("annotation has invalid circuit name");
+      return false;
     }
 
     // Build up the Attribute to represent the Annotation and store it in the
@@ -359,15 +388,378 @@ bool circt::firrtl::fromJSON(json::Value &value, StringRef circuitTarget,
   }
 
   // Convert the mutable Annotation map to a SmallVector<ArrayAttr>.
-  for (auto a : mutableAnnotationMap.keys()) {
-    // If multiple annotations on a single object, then append it.
-    if (annotationMap.count(a))
-      for (auto attr : annotationMap[a])
-        mutableAnnotationMap[a].push_back(attr);
+  mergeAnnotations(mutableAnnotationMap, annotationMap, context);
+  return true;
+}
+
+namespace {
+/// A JSON parser that builds the attributes for annotations directly while
+/// reading the text.  This produces the same attributes as `json::parse`
+/// followed by the conversion in `fromJSON`, but never materializes the JSON
+/// document.  It gives up, without reporting anything, on anything that is not
+/// valid JSON or not a valid annotation.
+class AnnotationJSONParser {
+public:
+  AnnotationJSONParser(StringRef text, MLIRContext *context)
+      : context(context), curPtr(text.begin()), endPtr(text.end()) {}
+
+  /// Parse an array of annotations into a Target-keyed map.
+  bool parseAnnotations(
+      StringRef circuitTarget,
+      llvm::StringMap<llvm::SmallVector<Attribute>> &annotations);
+
+  /// Parse a JSON value that makes up the whole text.  Return null if the text
+  /// is anything else.
+  Attribute parseStandaloneValue();
+
+private:
+  void skipWhitespace() {
+    while (curPtr != endPtr && (*curPtr == ' ' || *curPtr == '\t' ||
+                                *curPtr == '\n' || *curPtr == '\r'))
+      ++curPtr;
+  }
+
+  /// Skip whitespace, then consume the specified character if it's next.
+  bool consume(char c) {
+    skipWhitespace();
+    if (curPtr == endPtr || *curPtr != c)
+      return false;
+    ++curPtr;
+    return true;
+  }
+
+  bool parseString(StringRef &result, std::string &storage);
+  bool parseObject(llvm::function_ref<bool(StringRef key)> parseField);
+  Attribute parseValue();
+  Attribute parseNumber();
+  Attribute parseStringValue();
+  bool parseKeyword(StringRef keyword);
+
+  MLIRContext *context;
+  const char *curPtr, *endPtr;
+};
+} // end anonymous namespace
+
+/// Parse a string, whose opening quote has been consumed.  The result refers
+/// to the text if the string has no escapes, and to `storage` otherwise.
+bool AnnotationJSONParser::parseString(StringRef &result,
+                                       std::string &storage) {
+  const char *start = curPtr;
+  while (curPtr != endPtr && *curPtr != '"' && *curPtr != '\\' &&
+         uint8_t(*curPtr) >= 0x20)
+    ++curPtr;
+  if (curPtr == endPtr)
+    return false;
+  if (*curPtr == '"') {
+    result = StringRef(start, curPtr - start);
+    ++curPtr;
+    return true;
+  }
+
+  // Slow path: the string has escapes.
+  storage.assign(start, curPtr);
+  auto parseHex = [&](uint16_t &value) {
+    if (endPtr - curPtr < 4)
+      return false;
+    value = 0;
+    for (unsigned i = 0; i != 4; ++i) {
+      unsigned digit = llvm::hexDigitValue(*curPtr++);
+      if (digit == -1U)
+        return false;
+      value = value << 4 | digit;
+    }
+    return true;
+  };
+  auto appendCodePoint = [&](uint32_t codePoint) {
+    char buffer[4];
+    char *bufferPtr = buffer;
+    const llvm::UTF32 source = codePoint;
+    const llvm::UTF32 *sourcePtr = &source;
+    llvm::ConvertUTF32toUTF8(&sourcePtr, sourcePtr + 1,
+                             reinterpret_cast<llvm::UTF8 **>(&bufferPtr),
+                             reinterpret_cast<llvm::UTF8 *>(buffer + 4),
+                             llvm::strictConversion);
+    storage.append(buffer, bufferPtr);
+  };
+
+  while (curPtr != endPtr) {
+    char c = *curPtr++;
+    if (c == '"') {
+      result = storage;
+      return true;
+    }
+    if (uint8_t(c) < 0x20)
+      return false;
+    if (c != '\\') {
+      storage.push_back(c);
+      continue;
+    }
+    if (curPtr == endPtr)
+      return false;
+    switch (*curPtr++) {
+    case '"':
+      storage.push_back('"');
+      break;
+    case '\\':
+      storage.push_back('\\');
+      break;
+    case '/':
+      storage.push_back('/');
+      break;
+    case 'b':
+      storage.push_back('\b');
+      break;
+    case 'f':
+      storage.push_back('\f');
+      break;
+    case 'n':
+      storage.push_back('\n');
+      break;
+    case 'r':
+      storage.push_back('\r');
+      break;
+    case 't':
+      storage.push_back('\t');
+      break;
+    case 'u': {
+      // Invalid UTF-16 surrogates are replaced by U+FFFD, like json::parse.
+      uint16_t first;
+      if (!parseHex(first))
+        return false;
+      if (first < 0xD800 || first >= 0xE000) {
+        appendCodePoint(first);
+        break;
+      }
+      if (first >= 0xDC00 || endPtr - curPtr < 6 || curPtr[0] != '\\' ||
+          curPtr[1] != 'u') {
+        appendCodePoint(0xFFFD);
+        break;
+      }
+      const char *secondPtr = curPtr;
+      curPtr += 2;
+      uint16_t second;
+      if (!parseHex(second))
+        return false;
+      if (second < 0xDC00 || second >= 0xE000) {
+        // Leave the second escape to be decoded on its own.
+        curPtr = secondPtr;
+        appendCodePoint(0xFFFD);
+        break;
+      }
+      appendCodePoint(0x10000 + ((first - 0xD800) << 10) + (second - 0xDC00));
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return false;
+}
+
+/// Parse the fields of an object, whose opening brace has been consumed,
+/// calling `parseField` to parse the value of each.
+bool AnnotationJSONParser::parseObject(
+    llvm::function_ref<bool(StringRef key)> parseField) {
+  if (consume('}'))
+    return true;
+  std::string storage;
+  do {
+    StringRef key;
+    if (!consume('"') || !parseString(key, storage) || !consume(':'))
+      return false;
+    skipWhitespace();
+    if (!parseField(key))
+      return false;
+  } while (consume(','));
+  return consume('}');
+}
 
-    annotationMap[a] = ArrayAttr::get(context, mutableAnnotationMap[a]);
+Attribute AnnotationJSONParser::parseValue() {
+  if (curPtr == endPtr)
+    return {};
+  switch (*curPtr) {
+  case '"':
+    ++curPtr;
+    return parseStringValue();
+  case '{': {
+    ++curPtr;
+    // Duplicate keys are resolved in favor of the last one, like json::parse.
+    NamedAttrList metadata;
+    if (!parseObject([&](StringRef key) {
+          auto value = parseValue();
+          if (!value)
+            return false;
+          metadata.set(key, value);
+          return true;
+        }))
+      return {};
+    return DictionaryAttr::get(context, metadata);
   }
+  case '[': {
+    ++curPtr;
+    SmallVector<Attribute> metadata;
+    if (!consume(']')) {
+      do {
+        skipWhitespace();
+        auto element = parseValue();
+        if (!element)
+          return {};
+        metadata.push_back(element);
+      } while (consume(','));
+      if (!consume(']'))
+        return {};
+    }
+    return ArrayAttr::get(context, metadata);
+  }
+  case 't':
+    if (!parseKeyword("true"))
+      return {};
+    return BoolAttr::get(context, true);
+  case 'f':
+    if (!parseKeyword("false"))
+      return {};
+    return BoolAttr::get(context, false);
+  case 'n':
+    if (!parseKeyword("null"))
+      return {};
+    return mlir::UnitAttr::get(context);
+  default:
+    return parseNumber();
+  }
+}
 
+/// Parse a string value, whose opening quote has been consumed.
+Attribute AnnotationJSONParser::parseStringValue() {
+  StringRef value;
+  std::string storage;
+  if (!parseString(value, storage))
+    return {};
+
+  // Test to see if this might be quoted JSON (a string that is actually JSON).
+  // Sometimes FIRRTL developers will do this to serialize objects that the
+  // Scala FIRRTL Compiler doesn't know about.
+  if (auto unquotedValue =
+          AnnotationJSONParser(value, context).parseStandaloneValue())
+    return unquotedValue;
+  return StringAttr::get(context, value);
+}
+
+/// Parse a number the same way json::parse does: anything that is an integer
+/// or a floating point number with an integral value in range is an integer.
+Attribute AnnotationJSONParser::parseNumber() {
+  auto isNumberChar = [](char c) {
+    return llvm::isDigit(c) || StringRef("+-.eE").contains(c);
+  };
+  const char *start = curPtr;
+  while (curPtr != endPtr && isNumberChar(*curPtr))
+    ++curPtr;
+  if (curPtr == start)
+    return {};
+
+  // The strto* functions need a null-terminated string.
+  SmallString<24> number(StringRef(start, curPtr - start));
+  char *end;
+  auto integer = std::strtoll(number.c_str(), &end, 10);
+  if (end == number.end())
+    return IntegerAttr::get(IntegerType::get(context, 64), int64_t(integer));
+
+  double value = std::strtod(number.c_str(), &end);
+  if (end != number.end())
+    return {};
+  double integral;
+  if (std::modf(value, &integral) == 0.0 &&
+      integral >= double(std::numeric_limits<int64_t>::min()) &&
+      integral <= double(std::numeric_limits<int64_t>::max()))
+    return IntegerAttr::get(IntegerType::get(context, 64), int64_t(integral));
+  return FloatAttr::get(mlir::FloatType::getF64(context), value);
+}
+
+bool AnnotationJSONParser::parseKeyword(StringRef keyword) {
+  if (!StringRef(curPtr, endPtr - curPtr).startswith(keyword))
+    return false;
+  curPtr += keyword.size();
+  return true;
+}
+
+Attribute AnnotationJSONParser::parseStandaloneValue() {
+  if (!json::isUTF8(StringRef(curPtr, endPtr - curPtr)))
+    return {};
+  skipWhitespace();
+  auto value = parseValue();
+  skipWhitespace();
+  if (curPtr != endPtr)
+    return {};
+  return value;
+}
+
+bool AnnotationJSONParser::parseAnnotations(
+    StringRef circuitTarget,
+    llvm::StringMap<llvm::SmallVector<Attribute>> &annotations) {
+  if (!json::isUTF8(StringRef(curPtr, endPtr - curPtr)) || !consume('['))
+    return false;
+  if (consume(']')) {
+    skipWhitespace();
+    return curPtr == endPtr;
+  }
+
+  do {
+    if (!consume('{'))
+      return false;
+
+    // Collect the fields of the annotation, except for the "target" field: in
+    // the FIRRTL Dialect, the target will be implicitly specified based on
+    // where the attribute is applied.
+    NamedAttrList metadata;
+    std::string targetStorage;
+    Optional<StringRef> rawTarget;
+    if (!parseObject([&](StringRef key) {
+          if (key == "target") {
+            // The target must be a string, which is never quoted JSON.
+            StringRef target;
+            if (!consume('"') || !parseString(target, targetStorage))
+              return false;
+            rawTarget = target;
+            return true;
+          }
+          auto value = parseValue();
+          if (!value)
+            return false;
+          metadata.set(key, value);
+          return true;
+        }))
+      return false;
+
+    // If no "target" field exists, then promote the annotation to a
+    // CircuitTarget annotation.
+    std::string target = "~";
+    if (rawTarget) {
+      auto canonTarget = canonicalizeTarget(*rawTarget);
+      if (!canonTarget || isNonLocalTarget(*canonTarget))
+        return false;
+      target = std::move(*canonTarget);
+    }
+    if (!isTargetInCircuit(target, circuitTarget))
+      return false;
+
+    StringRef targetStrRef =
+        splitAndAppendTarget(metadata, target, context).first;
+    annotations[targetStrRef].push_back(DictionaryAttr::get(context, metadata));
+  } while (consume(','));
+
+  if (!consume(']'))
+    return false;
+  skipWhitespace();
+  return curPtr == endPtr;
+}
+
+bool circt::firrtl::fromJSONText(StringRef text, StringRef circuitTarget,
+                                 llvm::StringMap<ArrayAttr> &annotationMap,
+                                 MLIRContext *context) {
+  llvm::StringMap<llvm::SmallVector<Attribute>> mutableAnnotationMap;
+  if (!AnnotationJSONParser(text, context)
+           .parseAnnotations(circuitTarget, mutableAnnotationMap))
+    return false;
+  mergeAnnotations(mutableAnnotationMap, annotationMap, context);
   return true;
 }
 
@@ -926,14 +1318,6 @@ bool circt::firrtl::scatterCustomAnnotations(
   annotationMap.erase("~");
 
   // Convert the mutable Annotation map to a SmallVector<ArrayAttr>.
-  for (auto a : newAnnotations.keys()) {
-    // If multiple annotations on a single object, then append it.
-    if (annotationMap.count(a))
-      for (auto attr : annotationMap[a])
-        newAnnotations[a].push_back(attr);
-
-    annotationMap[a] = ArrayAttr::get(context, newAnnotations[a]);
-  }
-
+  mergeAnnotations(newAnnotations, annotationMap, context);
   return true;
 }
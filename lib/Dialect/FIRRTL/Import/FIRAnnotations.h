@@ -34,6 +34,14 @@ bool fromJSON(llvm::json::Value &value, StringRef circuitTarget,
               llvm::StringMap<ArrayAttr> &annotationMap, llvm::json::Path path,
               MLIRContext *context);
 
+/// Deserialize FIRRTL Annotations directly from JSON text, without building a
+/// JSON value for the whole document first.  Returns false without reporting
+/// anything if the text is not valid JSON or not valid annotations; use the
+/// overload above to diagnose the problem.
+bool fromJSONText(StringRef text, StringRef circuitTarget,
+                  llvm::StringMap<ArrayAttr> &annotationMap,
+                  MLIRContext *context);
+
 bool scatterCustomAnnotations(llvm::StringMap<ArrayAttr> &annotationMap,
                               MLIRContext *context, unsigned &annotationID,
                               Location loc);
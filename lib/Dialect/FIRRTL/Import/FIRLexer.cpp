@@ -14,9 +14,18 @@
 #include "mlir/IR/Diagnostics.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSwitch.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FIR_LEXER_SIMD_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FIR_LEXER_SIMD_NEON 1
+#endif
+
 using namespace circt;
 using namespace firrtl;
 using llvm::SMLoc;
@@ -143,6 +152,177 @@ std::string FIRToken::getRawStringValue(StringRef spelling) {
   return result;
 }
 
+//===----------------------------------------------------------------------===//
+// Character Scanning
+//===----------------------------------------------------------------------===//
+
+// The lexer spends most of its time skipping indentation and walking over
+// identifiers, both of which are usually long runs of very regular characters
+// in Chisel-generated FIRRTL.  To speed this up, the helpers below classify 16
+// bytes at a time when SSE2 or NEON is available, and fall back to a plain
+// loop otherwise.  A vector is only loaded when 16 bytes are available in the
+// buffer, so these never read outside of it; the scalar loops rely on the nul
+// terminator that llvm::MemoryBuffer guarantees instead.
+
+static bool isHorizontalWS(char c) { return c == ' ' || c == '\t' || c == ','; }
+
+static bool isVerticalWS(char c) {
+  return c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+/// LegalIdChar ::= [a-zA-Z_] | [0-9] | '$' | '-'
+static bool isIdentifierChar(char c) {
+  return llvm::isAlnum(c) || c == '_' || c == '$' || c == '-';
+}
+
+#if defined(FIR_LEXER_SIMD_SSE2) || defined(FIR_LEXER_SIMD_NEON)
+#define FIR_LEXER_SIMD 1
+
+/// The number of bytes classified at once.
+constexpr ptrdiff_t vectorSize = 16;
+
+#ifdef FIR_LEXER_SIMD_SSE2
+/// A mask with one bit per byte of a vector.
+using VectorMask = uint32_t;
+constexpr unsigned maskBitsPerByte = 1;
+constexpr VectorMask fullMask = 0xFFFF;
+
+using Vector = __m128i;
+static Vector load(const char *ptr) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+}
+static Vector equal(Vector v, char c) {
+  return _mm_cmpeq_epi8(v, _mm_set1_epi8(c));
+}
+/// This uses signed comparisons, so it is only valid for ASCII bounds.  Bytes
+/// outside of ASCII compare as negative and are never in range.
+static Vector inRange(Vector v, char lo, char hi) {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+static Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+static VectorMask toMask(Vector v) { return _mm_movemask_epi8(v); }
+#else
+/// NEON has no movemask, so the mask has four bits per byte instead, formed by
+/// narrowing each 16-bit lane of the comparison result.
+using VectorMask = uint64_t;
+constexpr unsigned maskBitsPerByte = 4;
+constexpr VectorMask fullMask = ~VectorMask(0);
+
+using Vector = uint8x16_t;
+static Vector load(const char *ptr) {
+  return vld1q_u8(reinterpret_cast<const uint8_t *>(ptr));
+}
+static Vector equal(Vector v, char c) { return vceqq_u8(v, vdupq_n_u8(c)); }
+static Vector inRange(Vector v, char lo, char hi) {
+  return vandq_u8(vcgeq_u8(v, vdupq_n_u8(lo)), vcleq_u8(v, vdupq_n_u8(hi)));
+}
+static Vector either(Vector a, Vector b) { return vorrq_u8(a, b); }
+static VectorMask toMask(Vector v) {
+  auto narrowed = vshrn_n_u16(vreinterpretq_u16_u8(v), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+#endif
+
+/// Return the index of the first byte whose bit is set in a non-zero mask.
+static unsigned firstByte(VectorMask mask) {
+  return llvm::countTrailingZeros(mask) / maskBitsPerByte;
+}
+
+/// Return the index of the last byte whose bit is set in a non-zero mask.
+static unsigned lastByte(VectorMask mask) {
+  return (sizeof(VectorMask) * 8 - 1 - llvm::countLeadingZeros(mask)) /
+         maskBitsPerByte;
+}
+
+static VectorMask horizontalWSMask(const char *ptr) {
+  auto v = load(ptr);
+  return toMask(either(either(equal(v, ' '), equal(v, '\t')), equal(v, ',')));
+}
+
+static VectorMask whitespaceMask(const char *ptr) {
+  auto v = load(ptr);
+  auto horizontal =
+      either(either(equal(v, ' '), equal(v, '\t')), equal(v, ','));
+  return toMask(either(horizontal, either(equal(v, '\n'), equal(v, '\r'))));
+}
+
+static VectorMask identifierCharMask(const char *ptr) {
+  auto v = load(ptr);
+  auto alnum = either(either(inRange(v, 'a', 'z'), inRange(v, 'A', 'Z')),
+                      inRange(v, '0', '9'));
+  auto other = either(either(equal(v, '_'), equal(v, '$')), equal(v, '-'));
+  return toMask(either(alnum, other));
+}
+
+static VectorMask lineEndMask(const char *ptr) {
+  auto v = load(ptr);
+  return toMask(either(either(equal(v, '\n'), equal(v, '\r')), equal(v, 0)));
+}
+#endif
+
+/// Return a pointer to the first character at or after `ptr` that is not
+/// whitespace.  Nul characters are left for the caller to handle, since they
+/// may be the end of the buffer.
+static const char *skipWhitespace(const char *ptr, const char *end) {
+#ifdef FIR_LEXER_SIMD
+  while (end - ptr >= vectorSize) {
+    if (auto mask = ~whitespaceMask(ptr) & fullMask)
+      return ptr + firstByte(mask);
+    ptr += vectorSize;
+  }
+#endif
+  while (isHorizontalWS(*ptr) || *ptr == '\n' || *ptr == '\r')
+    ++ptr;
+  return ptr;
+}
+
+/// Return a pointer to the first character at or after `ptr` that can't be
+/// part of an identifier.
+static const char *skipIdentifierChars(const char *ptr, const char *end) {
+#ifdef FIR_LEXER_SIMD
+  while (end - ptr >= vectorSize) {
+    if (auto mask = ~identifierCharMask(ptr) & fullMask)
+      return ptr + firstByte(mask);
+    ptr += vectorSize;
+  }
+#endif
+  while (isIdentifierChar(*ptr))
+    ++ptr;
+  return ptr;
+}
+
+/// Return a pointer to the first newline, carriage return, or nul character at
+/// or after `ptr`.
+static const char *findLineEnd(const char *ptr, const char *end) {
+#ifdef FIR_LEXER_SIMD
+  while (end - ptr >= vectorSize) {
+    if (auto mask = lineEndMask(ptr))
+      return ptr + firstByte(mask);
+    ptr += vectorSize;
+  }
+#endif
+  while (*ptr != '\n' && *ptr != '\r' && *ptr != 0)
+    ++ptr;
+  return ptr;
+}
+
+/// Return a pointer to the start of the run of horizontal whitespace that ends
+/// right before `ptr`.
+static const char *skipHorizontalWSBackward(const char *ptr,
+                                            const char *bufStart) {
+#ifdef FIR_LEXER_SIMD
+  while (ptr - bufStart >= vectorSize) {
+    if (auto mask = ~horizontalWSMask(ptr - vectorSize) & fullMask)
+      return ptr - vectorSize + lastByte(mask) + 1;
+    ptr -= vectorSize;
+  }
+#endif
+  while (ptr != bufStart && isHorizontalWS(ptr[-1]))
+    --ptr;
+  return ptr;
+}
+
 //===----------------------------------------------------------------------===//
 // FIRLexer
 //===----------------------------------------------------------------------===//
@@ -184,18 +364,9 @@ FIRToken FIRLexer::emitError(const char *loc, const Twine &message) {
 Optional<unsigned> FIRLexer::getIndentation(const FIRToken &tok) const {
   // Count the number of horizontal whitespace characters before the token.
   auto *bufStart = curBuffer.begin();
-
-  auto isHorizontalWS = [](char c) -> bool {
-    return c == ' ' || c == '\t' || c == ',';
-  };
-  auto isVerticalWS = [](char c) -> bool {
-    return c == '\n' || c == '\r' || c == '\f' || c == '\v';
-  };
-
-  unsigned indent = 0;
-  const auto *ptr = (const char *)tok.getSpelling().data();
-  while (ptr != bufStart && isHorizontalWS(ptr[-1]))
-    --ptr, ++indent;
+  const auto *tokStart = (const char *)tok.getSpelling().data();
+  const auto *ptr = skipHorizontalWSBackward(tokStart, bufStart);
+  unsigned indent = tokStart - ptr;
 
   // If the character we stopped at isn't the start of line, then return none.
   if (ptr != bufStart && !isVerticalWS(ptr[-1]))
@@ -233,7 +404,8 @@ FIRToken FIRLexer::lexTokenImpl() {
     case '\n':
     case '\r':
     case ',':
-      // Handle whitespace.
+      // Handle whitespace.  Indentation is usually a long run of it.
+      curPtr = skipWhitespace(curPtr, curBuffer.end());
       continue;
 
     case '_':
@@ -383,9 +555,7 @@ FIRToken FIRLexer::lexInlineAnnotation(const char *tokStart) {
 ///
 FIRToken FIRLexer::lexIdentifierOrKeyword(const char *tokStart) {
   // Match the rest of the identifier regex: [0-9a-zA-Z_$-]*
-  while (llvm::isAlpha(*curPtr) || llvm::isDigit(*curPtr) || *curPtr == '_' ||
-         *curPtr == '$' || *curPtr == '-')
-    ++curPtr;
+  curPtr = skipIdentifierChars(curPtr, curBuffer.end());
 
   StringRef spelling(tokStart, curPtr - tokStart);
 
@@ -414,6 +584,7 @@ FIRToken FIRLexer::lexIdentifierOrKeyword(const char *tokStart) {
 /// Skip a comment line, starting with a ';' and going to end of line.
 void FIRLexer::skipComment() {
   while (true) {
+    curPtr = findLineEnd(curPtr, curBuffer.end());
     switch (*curPtr++) {
     case '\n':
     case '\r':
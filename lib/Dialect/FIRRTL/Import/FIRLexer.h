@@ -104,7 +104,13 @@ public:
   const llvm::SourceMgr &getSourceMgr() const { return sourceMgr; }
 
   /// Move to the next valid token.
-  void lexToken() { curToken = lexTokenImpl(); }
+  void lexToken() {
+    curToken = lexTokenImpl();
+    ++numTokens;
+  }
+
+  /// Return the number of tokens this lexer has lexed.
+  size_t getNumTokens() const { return numTokens; }
 
   const FIRToken &getToken() const { return curToken; }
 
@@ -117,6 +123,13 @@ public:
   /// Get an opaque pointer into the lexer state that can be restored later.
   FIRLexerCursor getCursor() const;
 
+  /// Move the lexer to the specified position in the buffer and lex the token
+  /// that starts there.  The pointer must be at a token boundary.
+  void resetPointer(const char *newPointer) {
+    curPtr = newPointer;
+    lexToken();
+  }
+
 private:
   FIRToken lexTokenImpl();
 
@@ -146,6 +159,8 @@ private:
   /// This is the next token that hasn't been consumed yet.
   FIRToken curToken;
 
+  size_t numTokens = 0;
+
   FIRLexer(const FIRLexer &) = delete;
   void operator=(const FIRLexer &) = delete;
   friend class FIRLexerCursor;
@@ -29,9 +29,18 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/RWMutex.h"
 #include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
+#include <chrono>
+
+#if LLVM_ON_UNIX
+#include <sys/mman.h>
+#endif
 
 using namespace circt;
 using namespace firrtl;
@@ -89,6 +98,43 @@ namespace {
 /// A set of Target strings.
 using TargetSet = StringSet<llvm::BumpPtrAllocator>;
 
+/// A cache of the StringAttrs created for names, shared by all the threads
+/// parsing module bodies.  Chisel output repeats the same port, field and
+/// temporary names across many modules, and looking them up here first lets
+/// most of them skip the MLIRContext uniquer, which all threads contend on.
+/// The table is sharded by hash and lookups only take a reader lock, so the
+/// threads rarely wait on each other.  The keys are the strings owned by the
+/// attributes themselves, so the table doesn't hold a copy of any name.
+class SharedNameTable {
+public:
+  explicit SharedNameTable(MLIRContext *context) : context(context) {}
+
+  StringAttr get(StringRef name) {
+    auto &shard = shards[llvm::hash_value(name) % numShards];
+    {
+      llvm::sys::SmartScopedReader<true> reader(shard.mutex);
+      auto it = shard.names.find(name);
+      if (it != shard.names.end())
+        return it->second;
+    }
+
+    auto attr = StringAttr::get(context, name);
+    llvm::sys::SmartScopedWriter<true> writer(shard.mutex);
+    shard.names.insert({attr.getValue(), attr});
+    return attr;
+  }
+
+private:
+  static constexpr unsigned numShards = 32;
+  struct Shard {
+    llvm::sys::SmartRWMutex<true> mutex;
+    DenseMap<StringRef, StringAttr> names;
+  };
+
+  MLIRContext *const context;
+  Shard shards[numShards];
+};
+
 /// This class refers to immutable values and annotations maintained globally by
 /// the parser which can be referred to by any active parser, even those running
 /// in parallel.  This is shared by all active parsers.
@@ -102,7 +148,8 @@ struct SharedParserConstants {
         hiIdentifier(Identifier::get("hi", context)),
         amountIdentifier(Identifier::get("amount", context)),
         fieldIndexIdentifier(Identifier::get("fieldIndex", context)),
-        indexIdentifier(Identifier::get("index", context)) {}
+        indexIdentifier(Identifier::get("index", context)),
+        nameTable(context) {}
 
   /// The context we're parsing into.
   MLIRContext *const context;
@@ -121,6 +168,13 @@ struct SharedParserConstants {
   /// not be mutated directly unless the client is the Circuit parser.
   TargetSet targetSet;
 
+  /// The targets of the modules which contain something targeted by an
+  /// annotation, e.g., "~Foo|Bar" for "~Foo|Bar>baz" or "~Foo|Bar/baz:Baz".
+  /// This is built by the Circuit parser once all annotations are imported,
+  /// and lets the module parsers skip the annotation lookup for every
+  /// declaration of a module in which nothing is annotated.
+  llvm::StringSet<> annotatedModules;
+
   /// Cached annotation for DontTouch.
   const DictionaryAttr dontTouchAnnotation;
 
@@ -131,6 +185,9 @@ struct SharedParserConstants {
   const Identifier loIdentifier, hiIdentifier, amountIdentifier;
   const Identifier fieldIndexIdentifier, indexIdentifier;
 
+  /// The names used in the circuit, shared by all parser threads.
+  SharedNameTable nameTable;
+
 private:
   SharedParserConstants(const SharedParserConstants &) = delete;
   void operator=(const SharedParserConstants &) = delete;
@@ -155,6 +212,12 @@ struct FIRParser {
   SharedParserConstants &getConstants() const { return constants; }
   MLIRContext *getContext() const { return constants.context; }
 
+  /// Return the StringAttr for the specified name of a declaration, port or
+  /// field.  Prefer this to StringAttr::get, see SharedNameTable.
+  StringAttr getNameAttr(StringRef name) const {
+    return constants.nameTable.get(name);
+  }
+
   FIRLexer &getLexer() { return lexer; }
 
   /// Return the indentation level of the specified token.
@@ -316,6 +379,10 @@ struct FIRParser {
                       ArrayRef<std::pair<StringAttr, Type>> ports,
                       TargetSet &targetSet);
 
+  /// Return the split annotations of an operation with the specified number of
+  /// ports which has no annotations.
+  std::pair<ArrayAttr, ArrayAttr> getEmptySplitAnnotations(size_t numPorts);
+
   /// Returns true if the annotation list contains the DontTouchAnnotation. This
   /// method is slightly more efficient than other lookup methods, because it
   /// uses a stashed copy of the annotation for lookup.
@@ -397,7 +464,9 @@ public:
   Location getLoc() {
     if (infoLoc.hasValue())
       return infoLoc.getValue();
-    auto result = parser->translateLocation(firLoc);
+    Location result = parser->getConstants().options.ignoreAllLocations
+                          ? UnknownLoc::get(parser->getContext())
+                          : parser->translateLocation(firLoc);
     infoLoc = result;
     return result;
   }
@@ -436,6 +505,12 @@ ParseResult FIRParser::parseOptionalInfoLocator(LocationAttr &result) {
   if (getToken().isNot(FIRToken::fileinfo))
     return success();
 
+  // If we aren't producing locations at all, don't even decode the locator.
+  if (constants.options.ignoreAllLocations) {
+    consumeToken(FIRToken::fileinfo);
+    return success();
+  }
+
   auto loc = getToken().getLoc();
 
   // See if we can parse this token into a File/Line/Column record.  If not,
@@ -573,7 +648,7 @@ ParseResult FIRParser::parseOptionalInfoLocator(LocationAttr &result) {
 ParseResult FIRParser::parseOptionalName(StringAttr &name) {
 
   if (getToken().isNot(FIRToken::colon)) {
-    name = StringAttr::get(getContext(), "");
+    name = getNameAttr("");
     return success();
   }
 
@@ -582,7 +657,7 @@ ParseResult FIRParser::parseOptionalName(StringAttr &name) {
   if (parseId(nameRef, "expected result name"))
     return failure();
 
-  name = StringAttr::get(getContext(), nameRef);
+  name = getNameAttr(nameRef);
 
   return success();
 }
@@ -777,7 +852,7 @@ ParseResult FIRParser::parseId(StringAttr &result, const Twine &message) {
   if (parseId(name, message))
     return failure();
 
-  result = StringAttr::get(getContext(), name);
+  result = getNameAttr(name);
   return success();
 }
 
@@ -869,7 +944,7 @@ ParseResult FIRParser::parseType(FIRRTLType &result, const Twine &message) {
             return failure();
 
           elements.push_back(
-              {StringAttr::get(getContext(), fieldName), isFlipped, type});
+              {getNameAttr(fieldName), isFlipped, type});
           return success();
         }))
       return failure();
@@ -1122,12 +1197,12 @@ ArrayAttr FIRParser::getAnnotations(ArrayRef<Twine> targets, SMLoc loc,
     SmallString<64> targetStr;
     target.toVector(targetStr);
 
-    // Record that we've seen this target.
-    targetSet.insert(targetStr);
-
     // Note: We are not allowed to mutate annotationMap here.  Make sure to only
     // use non-mutating methods like `lookup`, not mutating ones like `am[key]`.
+    // Only record the targets which have annotations, the others are never
+    // checked.
     if (auto result = constants.annotationMap.lookup(targetStr)) {
+      targetSet.insert(targetStr);
       if (!result.empty())
         annotations.append(result.begin(), result.end());
     }
@@ -1147,12 +1222,8 @@ FIRParser::getSplitAnnotations(ArrayRef<Twine> targets, SMLoc loc,
                                TargetSet &targetSet) {
   // Early exit if no annotations exist.  This avoids the cost of constructing
   // strings representing targets if no annotation can possibly exist.
-  if (constants.annotationMap.empty()) {
-    SmallVector<Attribute, 4> portAnnotations(
-        ports.size(), ArrayAttr::get(constants.context, {}));
-    return {constants.emptyArrayAttr,
-            ArrayAttr::get(constants.context, portAnnotations)};
-  }
+  if (constants.annotationMap.empty())
+    return getEmptySplitAnnotations(ports.size());
 
   // Stack the annotations for all targets.
   SmallVector<Attribute, 4> annotations;
@@ -1161,12 +1232,12 @@ FIRParser::getSplitAnnotations(ArrayRef<Twine> targets, SMLoc loc,
     SmallString<64> targetStr;
     target.toVector(targetStr);
 
-    // Record that we've seen this target.
-    targetSet.insert(targetStr);
-
     // Note: We are not allowed to mutate annotationMap here.  Make sure to only
     // use non-mutating methods like `lookup`, not mutating ones like `am[key]`.
+    // Only record the targets which have annotations, the others are never
+    // checked.
     if (auto result = constants.annotationMap.lookup(targetStr)) {
+      targetSet.insert(targetStr);
       if (!result.empty())
         annotations.append(result.begin(), result.end());
     }
@@ -1174,9 +1245,12 @@ FIRParser::getSplitAnnotations(ArrayRef<Twine> targets, SMLoc loc,
 
   if (!annotations.empty())
     return splitAnnotations(annotations, loc, ports);
+  return getEmptySplitAnnotations(ports.size());
+}
 
-  SmallVector<Attribute, 4> portAnnotations(
-      ports.size(), ArrayAttr::get(constants.context, {}));
+std::pair<ArrayAttr, ArrayAttr>
+FIRParser::getEmptySplitAnnotations(size_t numPorts) {
+  SmallVector<Attribute, 4> portAnnotations(numPorts, constants.emptyArrayAttr);
   return {constants.emptyArrayAttr,
           ArrayAttr::get(constants.context, portAnnotations)};
 }
@@ -1191,10 +1265,12 @@ FIRParser::getSplitAnnotations(ArrayRef<Twine> targets, SMLoc loc,
 using UnbundledID = llvm::PointerEmbeddedInt<unsigned, 31>;
 using SymbolValueEntry = llvm::PointerUnion<Value, UnbundledID>;
 
+/// The symbol table is keyed by views of the names rather than copies of them.
+/// Every name declared in a module is either the spelling of a token, which
+/// points into the source buffer, or the name of a port, which is uniqued in
+/// the MLIRContext.  Both outlive the parse of the module body.
 using ModuleSymbolTable =
-    llvm::StringMap<std::pair<SMLoc, SymbolValueEntry>, llvm::BumpPtrAllocator>;
-using ModuleSymbolTableEntry =
-    llvm::StringMapEntry<std::pair<SMLoc, SymbolValueEntry>>;
+    llvm::DenseMap<StringRef, std::pair<SMLoc, SymbolValueEntry>>;
 
 using UnbundledValueEntry = SmallVector<std::pair<Attribute, Value>>;
 using UnbundledValuesList = std::vector<UnbundledValueEntry>;
@@ -1205,17 +1281,28 @@ namespace {
 struct FIRModuleContext : public FIRParser {
   explicit FIRModuleContext(SharedParserConstants &constants, FIRLexer &lexer,
                             std::string moduleTarget)
-      : FIRParser(constants, lexer), moduleTarget(std::move(moduleTarget)) {}
+      : FIRParser(constants, lexer), moduleTarget(std::move(moduleTarget)),
+        hasAnnotations(constants.annotatedModules.count(this->moduleTarget)) {}
 
   /// This is the module target used by annotations referring to this module.
   std::string moduleTarget;
 
+  /// This is true if any annotation targets something in this module.
+  bool hasAnnotations;
+
   // The expression-oriented nature of firrtl syntax produces tons of constant
   // nodes which are obviously redundant.  Instead of literally producing them
   // in the parser, do an implicit CSE to reduce parse time and silliness in the
   // resulting IR.
   llvm::DenseMap<std::pair<Attribute, Type>, Value> constantCache;
 
+  /// Integer literals of up to 64 bits that have already been materialized,
+  /// keyed by their value and by their bit width, declared width and
+  /// signedness packed into one word.  This is checked before anything is
+  /// uniqued, so repeated literals like UInt<1>(0) don't contend on the
+  /// MLIRContext uniquer locks with the other threads parsing in parallel.
+  llvm::DenseMap<std::pair<uint64_t, uint64_t>, Value> literalCache;
+
   /// Add a symbol entry with the specified name, returning failure if the name
   /// is already defined.
   ParseResult addSymbolEntry(StringRef name, SymbolValueEntry entry, SMLoc loc,
@@ -1261,8 +1348,8 @@ struct FIRModuleContext : public FIRParser {
     ~SymbolTableScope() {
       // Mark all entries in this scope as being invalid.  We track validity
       // through the SMLoc field instead of deleting entries.
-      for (auto *entryPtr : scopedDecls)
-        entryPtr->second.first = SMLoc();
+      for (auto name : scopedDecls)
+        moduleContext.symbolTable[name].first = SMLoc();
       moduleContext.currentScopeCollector = prevScopedDecls;
     }
 
@@ -1271,8 +1358,8 @@ struct FIRModuleContext : public FIRParser {
     SymbolTableScope(const SymbolTableScope &) = delete;
 
     FIRModuleContext &moduleContext;
-    std::vector<ModuleSymbolTableEntry *> *prevScopedDecls;
-    std::vector<ModuleSymbolTableEntry *> scopedDecls;
+    std::vector<StringRef> *prevScopedDecls;
+    std::vector<StringRef> scopedDecls;
   };
 
   /// A set of all Annotation Targets found in this module.  This is used to
@@ -1288,7 +1375,7 @@ private:
   /// If non-null, all new entries added to the symbol table are added to this
   /// list.  This allows us to "pop" the entries by resetting them to null when
   /// scope is exited.
-  std::vector<ModuleSymbolTableEntry *> *currentScopeCollector = nullptr;
+  std::vector<StringRef> *currentScopeCollector = nullptr;
 };
 
 } // end anonymous namespace
@@ -1317,7 +1404,7 @@ ParseResult FIRModuleContext::addSymbolEntry(StringRef name,
   // was new to this scope.
   entryIt->second = {loc, entry};
   if (currentScopeCollector && !insertNameIntoGlobalScope)
-    currentScopeCollector->push_back(&*entryIt);
+    currentScopeCollector->push_back(name);
 
   return success();
 }
@@ -1355,7 +1442,7 @@ ParseResult FIRModuleContext::resolveSymbolEntry(Value &result,
     return failure();
   }
 
-  auto fieldAttr = StringAttr::get(getContext(), fieldName);
+  auto fieldAttr = getNameAttr(fieldName);
 
   unsigned unbundledId = entry.get<UnbundledID>() - 1;
   assert(unbundledId < unbundledValues.size());
@@ -1420,9 +1507,10 @@ struct LazyLocationListener : public OpBuilder::Listener {
     if (infoLoc) {
       for (auto opAndSMLoc : subOps)
         opAndSMLoc.first->setLoc(infoLoc);
-    } else {
+    } else if (!parser.getConstants().options.ignoreAllLocations) {
       // If we don't, translate all the individual SMLoc's to Location objects
-      // in the .fir file.
+      // in the .fir file, unless we're dropping locations entirely, in which
+      // case the operations keep the unknown location they were built with.
       for (auto opAndSMLoc : subOps)
         opAndSMLoc.first->setLoc(parser.translateLocation(opAndSMLoc.second));
     }
@@ -1493,6 +1581,27 @@ private:
   /// Return the current modulet target, e.g., "~Foo|Bar".
   StringRef getModuleTarget() { return moduleContext.moduleTarget; }
 
+  /// Return the annotations of the declaration with the specified name in the
+  /// current module.  This forms no target string at all if nothing in the
+  /// module is annotated.
+  ArrayAttr getDeclAnnotations(StringRef id, SMLoc loc, Type type) {
+    if (!moduleContext.hasAnnotations)
+      return getConstants().emptyArrayAttr;
+    return getAnnotations(getModuleTarget() + ">" + id, loc,
+                          moduleContext.targetsInModule, type);
+  }
+
+  /// Return the split annotations of the declaration with the specified
+  /// targets in the current module, see getDeclAnnotations.
+  std::pair<ArrayAttr, ArrayAttr>
+  getSplitDeclAnnotations(ArrayRef<Twine> targets, SMLoc loc,
+                          ArrayRef<std::pair<StringAttr, Type>> ports) {
+    if (!moduleContext.hasAnnotations)
+      return getEmptySplitAnnotations(ports.size());
+    return getSplitAnnotations(targets, loc, ports,
+                               moduleContext.targetsInModule);
+  }
+
   ParseResult parseSimpleStmtImpl(unsigned stmtIndent);
 
   /// Attach invalid values to every element of the value.
@@ -1984,11 +2093,8 @@ ParseResult FIRStmtParser::parseIntegerLiteralExp(Value &result) {
   if (width == 0)
     return emitError(loc, "zero bit constants are not allowed"), failure();
 
-  // Construct an integer attribute of the right width.
-  auto type = IntType::get(builder.getContext(), isSigned, width);
-
   IntegerType::SignednessSemantics signedness;
-  if (type.isSigned()) {
+  if (isSigned) {
     signedness = IntegerType::Signed;
     if (width != -1) {
       // Check for overlow if we are truncating bits.
@@ -2013,6 +2119,21 @@ ParseResult FIRStmtParser::parseIntegerLiteralExp(Value &result) {
     }
   }
 
+  // If we've already seen this literal, reuse it without touching the uniquer.
+  // Only literals that fit in 64 bits are cached, which is nearly all of them.
+  Value *literalEntry = nullptr;
+  if (value.getBitWidth() <= 64) {
+    uint64_t typeKey = uint64_t(value.getBitWidth()) << 33 |
+                       uint64_t(uint32_t(width)) << 1 | isSigned;
+    literalEntry = &moduleContext.literalCache[{value.getZExtValue(), typeKey}];
+    if (*literalEntry) {
+      result = *literalEntry;
+      return success();
+    }
+  }
+
+  // Construct an integer attribute of the right width.
+  auto type = IntType::get(builder.getContext(), isSigned, width);
   Type attrType =
       IntegerType::get(type.getContext(), value.getBitWidth(), signedness);
   auto attr = builder.getIntegerAttr(attrType, value);
@@ -2021,6 +2142,8 @@ ParseResult FIRStmtParser::parseIntegerLiteralExp(Value &result) {
   auto &entry = moduleContext.constantCache[{attr, type}];
   if (entry) {
     // If we already had an entry, reuse it.
+    if (literalEntry)
+      *literalEntry = entry;
     result = entry;
     return success();
   }
@@ -2039,8 +2162,10 @@ ParseResult FIRStmtParser::parseIntegerLiteralExp(Value &result) {
   }
 
   locationProcessor.setLoc(loc);
-  auto op = builder.create<ConstantOp>(type, value);
+  auto op = builder.create<ConstantOp>(type, attr);
   entry = op;
+  if (literalEntry)
+    *literalEntry = op;
   result = op;
 
   if (savedIP.isSet())
@@ -2272,8 +2397,7 @@ ParseResult FIRStmtParser::parseMemPort(MemDirAttr direction) {
                      "memory port should have behavioral memory type");
   auto resultType = memVType.getElementType();
 
-  auto annotations = getAnnotations(getModuleTarget() + ">" + id, startLoc,
-                                    moduleContext.targetsInModule, resultType);
+  auto annotations = getDeclAnnotations(id, startLoc, resultType);
   auto name = hasDontTouch(annotations) ? id : filterUselessName(id);
 
   locationProcessor.setLoc(startLoc);
@@ -2655,10 +2779,10 @@ ParseResult FIRStmtParser::parseInstance() {
   // formats:
   //     ~Foo|Foo>bar
   //     ~Foo|Foo/bar:Bar
-  auto annotations = getSplitAnnotations(
+  auto annotations = getSplitDeclAnnotations(
       {getModuleTarget() + ">" + id,
        getModuleTarget() + "/" + id + ":" + moduleName},
-      startTok.getLoc(), resultNamesAndTypes, moduleContext.targetsInModule);
+      startTok.getLoc(), resultNamesAndTypes);
 
   // Keep the name if a dont touch exist on either the instance or its ports.
   auto dontTouch = hasDontTouch(annotations.first) ||
@@ -2712,9 +2836,7 @@ ParseResult FIRStmtParser::parseCombMem() {
   auto memType = CMemoryType::get(vectorType.getElementType(),
                                   vectorType.getNumElements());
 
-  auto annotations =
-      getAnnotations(getModuleTarget() + ">" + id, startTok.getLoc(),
-                     moduleContext.targetsInModule, type);
+  auto annotations = getDeclAnnotations(id, startTok.getLoc(), type);
   auto name = hasDontTouch(annotations) ? id : filterUselessName(id);
 
   auto result = builder.create<CombMemOp>(memType, name, annotations);
@@ -2750,9 +2872,7 @@ ParseResult FIRStmtParser::parseSeqMem() {
   auto memType = CMemoryType::get(getContext(), vectorType.getElementType(),
                                   vectorType.getNumElements());
 
-  auto annotations =
-      getAnnotations(getModuleTarget() + ">" + id, startTok.getLoc(),
-                     moduleContext.targetsInModule, type);
+  auto annotations = getDeclAnnotations(id, startTok.getLoc(), type);
   auto name = hasDontTouch(annotations) ? id : filterUselessName(id);
 
   auto result = builder.create<SeqMemOp>(memType, ruw, name, annotations);
@@ -2844,13 +2964,13 @@ ParseResult FIRStmtParser::parseMem(unsigned memIndent) {
     StringRef portName;
     if (parseId(portName, "expected port name"))
       return failure();
-    ports.push_back({builder.getStringAttr(portName),
+    ports.push_back({getNameAttr(portName),
                      MemOp::getTypeForPort(depth, type, portKind)});
 
     while (!getIndentation().hasValue()) {
       if (parseId(portName, "expected port name"))
         return failure();
-      ports.push_back({builder.getStringAttr(portName),
+      ports.push_back({getNameAttr(portName),
                        MemOp::getTypeForPort(depth, type, portKind)});
     }
   }
@@ -2878,9 +2998,8 @@ ParseResult FIRStmtParser::parseMem(unsigned memIndent) {
 
   locationProcessor.setLoc(startTok.getLoc());
 
-  auto annotations =
-      getSplitAnnotations(getModuleTarget() + ">" + id, startTok.getLoc(),
-                          ports, moduleContext.targetsInModule);
+  auto annotations = getSplitDeclAnnotations(getModuleTarget() + ">" + id,
+                                             startTok.getLoc(), ports);
 
   // Keep the name if a dont touch exist on either the instance or its ports.
   auto dontTouch = hasDontTouch(annotations.first) ||
@@ -2941,14 +3060,12 @@ ParseResult FIRStmtParser::parseNode() {
     return failure();
   }
 
-  auto annotations =
-      getAnnotations(getModuleTarget() + ">" + id, startTok.getLoc(),
-                     moduleContext.targetsInModule, initializerType);
+  auto annotations = getDeclAnnotations(id, startTok.getLoc(), initializerType);
 
   // Ignore useless names like _T.
   auto name = hasDontTouch(annotations) ? id : filterUselessName(id);
   Value result = builder.create<NodeOp>(initializer.getType(), initializer,
-                                        name, annotations);
+                                        getNameAttr(name), annotations);
   return moduleContext.addSymbolEntry(id, result, startTok.getLoc());
 }
 
@@ -2970,12 +3087,10 @@ ParseResult FIRStmtParser::parseWire() {
 
   locationProcessor.setLoc(startTok.getLoc());
 
-  auto annotations =
-      getAnnotations(getModuleTarget() + ">" + id, startTok.getLoc(),
-                     moduleContext.targetsInModule, type);
+  auto annotations = getDeclAnnotations(id, startTok.getLoc(), type);
   auto name = hasDontTouch(annotations) ? id : filterUselessName(id);
 
-  auto result = builder.create<WireOp>(type, name, annotations);
+  auto result = builder.create<WireOp>(type, getNameAttr(name), annotations);
   return moduleContext.addSymbolEntry(id, result, startTok.getLoc());
 }
 
@@ -3061,17 +3176,15 @@ ParseResult FIRStmtParser::parseRegister(unsigned regIndent) {
 
   locationProcessor.setLoc(startTok.getLoc());
 
-  auto annotations =
-      getAnnotations(getModuleTarget() + ">" + id, startTok.getLoc(),
-                     moduleContext.targetsInModule, type);
+  auto annotations = getDeclAnnotations(id, startTok.getLoc(), type);
   auto name = hasDontTouch(annotations) ? id : filterUselessName(id);
 
   Value result;
   if (resetSignal)
     result = builder.create<RegResetOp>(type, clock, resetSignal, resetValue,
-                                        name, annotations);
+                                        getNameAttr(name), annotations);
   else
-    result = builder.create<RegOp>(type, clock, name, annotations);
+    result = builder.create<RegOp>(type, clock, getNameAttr(name), annotations);
 
   return moduleContext.addSymbolEntry(id, result, startTok.getLoc());
 }
@@ -3080,13 +3193,65 @@ ParseResult FIRStmtParser::parseRegister(unsigned regIndent) {
 // FIRCircuitParser
 //===----------------------------------------------------------------------===//
 
+/// Return true if the text starts with the specified keyword, and the keyword
+/// isn't just the prefix of a longer identifier.
+static bool startsWithKeyword(StringRef text, StringRef keyword) {
+  if (!text.startswith(keyword))
+    return false;
+  if (text.size() == keyword.size())
+    return true;
+  char next = text[keyword.size()];
+  return !llvm::isAlnum(next) && next != '_' && next != '$' && next != '-';
+}
+
+/// Scan the specified text, which must start at the beginning of a line, for
+/// lines whose first token is a 'module' or 'extmodule' keyword indented by
+/// `moduleIndent`, the indentation of the modules of the circuit.  Module
+/// bodies are indented more than their module, and neither strings nor info
+/// locators may span lines, so every such line starts a new module, while a
+/// 'module' name at the start of a statement does not.  The start of the
+/// keyword on each of these lines is appended to the result.
+static void findModuleStarts(StringRef text, unsigned moduleIndent,
+                             std::vector<const char *> &moduleStarts) {
+  while (!text.empty()) {
+    // Skip the indentation, using the same whitespace as getIndentation.
+    StringRef line = text.ltrim(" \t,");
+    if (unsigned(line.data() - text.data()) == moduleIndent &&
+        (startsWithKeyword(line, "module") ||
+         startsWithKeyword(line, "extmodule")))
+      moduleStarts.push_back(line.data());
+
+    auto eol = line.find('\n');
+    if (eol == StringRef::npos)
+      return;
+    text = line.drop_front(eol + 1);
+  }
+}
+
+/// Split the specified text into chunks of roughly `chunkSize` bytes, each of
+/// which starts at the beginning of a line.
+static void splitAtLines(StringRef text, size_t chunkSize,
+                         SmallVectorImpl<StringRef> &chunks) {
+  while (text.size() > chunkSize) {
+    auto eol = text.find('\n', chunkSize);
+    if (eol == StringRef::npos)
+      break;
+    chunks.push_back(text.take_front(eol + 1));
+    text = text.drop_front(eol + 1);
+  }
+  if (!text.empty())
+    chunks.push_back(text);
+}
+
 namespace {
 /// This class implements the outer level of the parser, including things
 /// like circuit and module.
 struct FIRCircuitParser : public FIRParser {
   explicit FIRCircuitParser(SharedParserConstants &state, FIRLexer &lexer,
-                            ModuleOp mlirModule)
-      : FIRParser(state, lexer), mlirModule(mlirModule) {}
+                            ModuleOp mlirModule,
+                            FIRModuleCallback moduleCallback = {})
+      : FIRParser(state, lexer), mlirModule(mlirModule),
+        moduleCallback(moduleCallback) {}
 
   ParseResult parseCircuit(const llvm::MemoryBuffer *annotationsBuf);
 
@@ -3097,6 +3262,18 @@ private:
   ParseResult importAnnotations(SMLoc loc, StringRef circuitTarget,
                                 StringRef annotationsStr);
 
+  /// Import the inline annotations and the annotation file, and find the start
+  /// of every module in the rest of the file.  These are independent of each
+  /// other, so they are done in parallel.
+  ParseResult importAnnotationsAndFindModules(
+      StringRef circuitTarget, SMLoc inlineAnnotationsLoc,
+      StringRef inlineAnnotations, SMLoc annotationsBufLoc,
+      const llvm::MemoryBuffer *annotationsBuf);
+
+  /// Return the start of the first module at or after the specified position,
+  /// or the end of the buffer if there are no more modules.
+  const char *getNextModuleStart(const char *ptr);
+
   ParseResult parseModule(CircuitOp circuit, StringRef circuitTarget,
                           unsigned indent);
 
@@ -3114,11 +3291,30 @@ private:
     TargetSet targetSet;
   };
 
-  ParseResult parseModuleBody(DeferredModuleToParse &deferredModule);
+  ParseResult parseModuleBody(DeferredModuleToParse &deferredModule,
+                              FIRModuleStatistics *statistics);
+
+  /// Return the number of microseconds since the start of the import.
+  uint64_t getMicrosecondsSinceStart() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now() - startTime)
+        .count();
+  }
 
   SmallVector<DeferredModuleToParse, 0> deferredModules;
   ModuleOp mlirModule;
 
+  /// If set, each module is handed to this as soon as its body is parsed.
+  FIRModuleCallback moduleCallback;
+
+  /// The time when the parser started, for the module statistics.
+  const std::chrono::steady_clock::time_point startTime =
+      std::chrono::steady_clock::now();
+
+  /// The position of every 'module' and 'extmodule' keyword that starts a line,
+  /// in order.  This is used to skip over module bodies without lexing them.
+  std::vector<const char *> moduleStarts;
+
   /// A global identifier that can be used to link multiple annotations
   /// together.  This should be incremented on use.
   unsigned annotationID = 0;
@@ -3129,27 +3325,32 @@ private:
 ParseResult FIRCircuitParser::importAnnotations(SMLoc loc,
                                                 StringRef circuitTarget,
                                                 StringRef annotationsStr) {
-
-  auto annotations = json::parse(annotationsStr);
-  if (auto err = annotations.takeError()) {
-    handleAllErrors(std::move(err), [&](const json::ParseError &a) {
-      auto diag = emitError(loc, "Failed to parse JSON Annotations");
-      diag.attachNote() << a.message();
-    });
-    return failure();
-  }
-
-  json::Path::Root root;
+  // Build the annotations straight from the text, which avoids holding the
+  // whole JSON document in memory next to the attributes.  If that fails, go
+  // through a JSON value to diagnose the problem.
   llvm::StringMap<ArrayAttr> thisAnnotationMap;
-  if (!fromJSON(annotations.get(), circuitTarget, thisAnnotationMap, root,
-                getContext())) {
-    auto diag = emitError(loc, "Invalid/unsupported annotation format");
-    std::string jsonErrorMessage =
-        "See inline comments for problem area in JSON:\n";
-    llvm::raw_string_ostream s(jsonErrorMessage);
-    root.printErrorContext(annotations.get(), s);
-    diag.attachNote() << jsonErrorMessage;
-    return failure();
+  if (!fromJSONText(annotationsStr, circuitTarget, thisAnnotationMap,
+                    getContext())) {
+    auto annotations = json::parse(annotationsStr);
+    if (auto err = annotations.takeError()) {
+      handleAllErrors(std::move(err), [&](const json::ParseError &a) {
+        auto diag = emitError(loc, "Failed to parse JSON Annotations");
+        diag.attachNote() << a.message();
+      });
+      return failure();
+    }
+
+    json::Path::Root root;
+    if (!fromJSON(annotations.get(), circuitTarget, thisAnnotationMap, root,
+                  getContext())) {
+      auto diag = emitError(loc, "Invalid/unsupported annotation format");
+      std::string jsonErrorMessage =
+          "See inline comments for problem area in JSON:\n";
+      llvm::raw_string_ostream s(jsonErrorMessage);
+      root.printErrorContext(annotations.get(), s);
+      diag.attachNote() << jsonErrorMessage;
+      return failure();
+    }
   }
 
   if (!scatterCustomAnnotations(thisAnnotationMap, getContext(), annotationID,
@@ -3174,6 +3375,77 @@ ParseResult FIRCircuitParser::importAnnotations(SMLoc loc,
   return success();
 }
 
+ParseResult FIRCircuitParser::importAnnotationsAndFindModules(
+    StringRef circuitTarget, SMLoc inlineAnnotationsLoc,
+    StringRef inlineAnnotations, SMLoc annotationsBufLoc,
+    const llvm::MemoryBuffer *annotationsBuf) {
+  // Split the rest of the file into chunks that can be scanned independently.
+  // The chunks are large to keep the per-task overhead low.
+  const auto &sourceMgr = getLexer().getSourceMgr();
+  const char *bufferEnd =
+      sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())->getBufferEnd();
+  const char *modulesStart = getToken().getLoc().getPointer();
+  SmallVector<StringRef> chunks;
+  splitAtLines(StringRef(modulesStart, bufferEnd - modulesStart),
+               /*chunkSize=*/1 << 20, chunks);
+  std::vector<std::vector<const char *>> chunkModuleStarts(chunks.size());
+
+  // The first module sets the indentation of the others.  If it is not on a
+  // line of its own, parseCircuit reports the error.
+  unsigned moduleIndent = getIndentation().getValueOr(0);
+
+  // Task zero imports the annotations, the others scan one chunk each.  Only
+  // the annotation task translates locations or touches the annotation map.
+  auto anyFailed = mlir::failableParallelForEachN(
+      getContext(), 0, chunks.size() + 1, [&](size_t index) -> LogicalResult {
+        if (index != 0) {
+          findModuleStarts(chunks[index - 1], moduleIndent,
+                           chunkModuleStarts[index - 1]);
+          return success();
+        }
+
+        // Deal with any inline annotations, if they exist.  These are
+        // processed first to place any annotations from an annotation file
+        // *after* the inline annotations.  While arbitrary, this makes the
+        // annotation file have "append" semantics.
+        if (!inlineAnnotations.empty())
+          if (importAnnotations(inlineAnnotationsLoc, circuitTarget,
+                                inlineAnnotations))
+            return failure();
+
+        // Deal with the annotation file if one was specified
+        if (annotationsBuf)
+          if (importAnnotations(annotationsBufLoc, circuitTarget,
+                                annotationsBuf->getBuffer()))
+            return failure();
+
+        // Index the modules which contain annotated declarations.
+        for (auto &entry : getConstants().annotationMap) {
+          StringRef target = entry.getKey();
+          auto moduleEnd = target.find('|');
+          if (moduleEnd == StringRef::npos)
+            continue;
+          moduleEnd = target.find_first_of(">/", moduleEnd);
+          getConstants().annotatedModules.insert(target.take_front(moduleEnd));
+        }
+        return success();
+      });
+  if (failed(anyFailed))
+    return failure();
+
+  for (auto &starts : chunkModuleStarts)
+    moduleStarts.insert(moduleStarts.end(), starts.begin(), starts.end());
+  return success();
+}
+
+const char *FIRCircuitParser::getNextModuleStart(const char *ptr) {
+  auto it = std::lower_bound(moduleStarts.begin(), moduleStarts.end(), ptr);
+  if (it != moduleStarts.end())
+    return *it;
+  const auto &sourceMgr = getLexer().getSourceMgr();
+  return sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())->getBufferEnd();
+}
+
 /// pohwist ::= port*
 /// port     ::= dir id ':' type info? NEWLINE
 /// dir      ::= 'input' | 'output'
@@ -3297,26 +3569,11 @@ ParseResult FIRCircuitParser::parseModule(CircuitOp circuit,
         DeferredModuleToParse{moduleOp, portLocs, getLexer().getCursor(),
                               std::move(moduleTarget), indent, TargetSet()});
 
-    // We're going to defer parsing this module, so just skip tokens until we
-    // get to the next module or the end of the file.
-    while (true) {
-      switch (getToken().getKind()) {
-
-      // End of file or invalid token will be handled by outer level.
-      case FIRToken::eof:
-      case FIRToken::error:
-        return success();
-
-        // If we got to the next module, then we're done.
-      case FIRToken::kw_module:
-      case FIRToken::kw_extmodule:
-        return success();
-
-      default:
-        consumeToken();
-        break;
-      }
-    }
+    // We're going to defer parsing this module, so skip straight to the next
+    // module or the end of the file.  The body is lexed when it is parsed.
+    getLexer().resetPointer(
+        getNextModuleStart(getToken().getLoc().getPointer()));
+    return success();
   }
 
   // Otherwise, handle extmodule specific features like parameters.
@@ -3397,8 +3654,14 @@ ParseResult FIRCircuitParser::parseModule(CircuitOp circuit,
 
 // Parse the body of this module.
 ParseResult
-FIRCircuitParser::parseModuleBody(DeferredModuleToParse &deferredModule) {
+FIRCircuitParser::parseModuleBody(DeferredModuleToParse &deferredModule,
+                                  FIRModuleStatistics *statistics) {
   FModuleOp moduleOp = deferredModule.moduleOp;
+  if (statistics) {
+    statistics->name = moduleOp.getName().str();
+    statistics->threadID = llvm::get_threadid();
+    statistics->startTime = getMicrosecondsSinceStart();
+  }
   auto &portLocs = deferredModule.portLocs;
   auto &moduleTarget = deferredModule.moduleTarget;
 
@@ -3408,6 +3671,7 @@ FIRCircuitParser::parseModuleBody(DeferredModuleToParse &deferredModule) {
 
   // Reset the parser/lexer state back to right after the port list.
   deferredModule.lexerCursor.restore(moduleBodyLexer);
+  const char *bodyStart = moduleBodyLexer.getToken().getLoc().getPointer();
 
   FIRModuleContext moduleContext(getConstants(), moduleBodyLexer,
                                  std::move(moduleTarget));
@@ -3426,9 +3690,36 @@ FIRCircuitParser::parseModuleBody(DeferredModuleToParse &deferredModule) {
 
   FIRStmtParser stmtParser(*moduleOp.getBodyBlock(), moduleContext);
 
-  // Parse the moduleBlock.
+  // Parse the moduleBlock.  The statement parser stops on lexer errors, which
+  // have already been reported, so make sure we don't treat them as success.
   auto result = stmtParser.parseSimpleStmtBlock(deferredModule.indent);
+  auto &endToken = moduleBodyLexer.getToken();
+  if (endToken.is(FIRToken::error))
+    result = failure();
+
+  // The body ends at the next module start found by the outline pass, which
+  // skipped everything up to there.  Anything the body does not extend to
+  // would be lost, like a module which is not indented like the others.
+  const char *endPtr = endToken.getLoc().getPointer();
+  if (succeeded(result) && endToken.isNot(FIRToken::eof) &&
+      endPtr != getNextModuleStart(endPtr)) {
+    if (endToken.isAny(FIRToken::kw_module, FIRToken::kw_extmodule))
+      stmtParser.emitError(
+          "module should have the indentation of the first module");
+    else
+      stmtParser.emitError("unexpected token in circuit");
+    result = failure();
+  }
   deferredModule.targetSet = std::move(moduleContext.targetsInModule);
+
+  if (statistics) {
+    statistics->parseTime =
+        getMicrosecondsSinceStart() - statistics->startTime;
+    statistics->bytes =
+        moduleBodyLexer.getToken().getLoc().getPointer() - bodyStart;
+    statistics->tokens = moduleBodyLexer.getNumTokens();
+    moduleOp.getBodyBlock()->walk([&](Operation *) { ++statistics->ops; });
+  }
   return result;
 }
 
@@ -3460,21 +3751,11 @@ FIRCircuitParser::parseCircuit(const llvm::MemoryBuffer *annotationsBuf) {
 
   std::string circuitTarget = "~" + name.getValue().str();
 
-  // Deal with any inline annotations, if they exist.  These are processed first
-  // to place any annotations from an annotation file *after* the inline
-  // annotations.  While arbitrary, this makes the annotation file have "append"
-  // semantics.
-  if (!inlineAnnotations.empty())
-    if (importAnnotations(inlineAnnotationsLoc, circuitTarget,
-                          inlineAnnotations))
-      return failure();
-
-  // Deal with the annotation file if one was specified
-  if (annotationsBuf) {
-    if (importAnnotations(info.getFIRLoc(), circuitTarget,
-                          annotationsBuf->getBuffer()))
-      return failure();
-  }
+  // Import the annotations while finding where each of the modules start.
+  if (importAnnotationsAndFindModules(circuitTarget, inlineAnnotationsLoc,
+                                      inlineAnnotations, info.getFIRLoc(),
+                                      annotationsBuf))
+    return failure();
 
   OpBuilder b(mlirModule.getBodyRegion());
 
@@ -3532,11 +3813,29 @@ DoneParsing:
   (void)getLexer().translateLocation(info.getFIRLoc());
 
   // Next, parse all the module bodies.
+  auto *allStatistics = getConstants().options.moduleStatistics;
+  if (allStatistics)
+    allStatistics->assign(deferredModules.size(), {});
   auto anyFailed = mlir::failableParallelForEachN(
       getContext(), 0, deferredModules.size(), [&](size_t index) {
-        if (parseModuleBody(deferredModules[index]))
+        auto &deferredModule = deferredModules[index];
+        auto *statistics = allStatistics ? &(*allStatistics)[index] : nullptr;
+        if (parseModuleBody(deferredModule, statistics))
           return failure();
-        return success();
+        if (!moduleCallback && !statistics)
+          return success();
+
+        // Verify the module on its own, to measure how long that takes or to
+        // stream it to the client, which expects valid IR, while the others
+        // are still being parsed.
+        auto verifyStart = getMicrosecondsSinceStart();
+        if (failed(mlir::verify(deferredModule.moduleOp)))
+          return failure();
+        if (statistics)
+          statistics->verifyTime = getMicrosecondsSinceStart() - verifyStart;
+        if (!moduleCallback)
+          return success();
+        return moduleCallback(deferredModule.moduleOp);
       });
   if (failed(anyFailed))
     return failure();
@@ -3569,11 +3868,41 @@ DoneParsing:
 // Driver
 //===----------------------------------------------------------------------===//
 
+/// If the specified buffer is a mapping of the input file, tell the OS that we
+/// are going to read it front to back.  Large .fir files are mapped rather than
+/// read into memory, and all tokens, identifiers, and locators are views into
+/// that mapping: this lets the kernel read ahead aggressively and drop pages
+/// once the lexer has moved past them, which keeps the resident set small.
+static void adviseSequentialAccess(const llvm::MemoryBuffer *buffer) {
+  if (buffer->getBufferKind() != llvm::MemoryBuffer::MemoryBuffer_MMap)
+    return;
+#if LLVM_ON_UNIX && defined(MADV_SEQUENTIAL)
+  // madvise requires a page aligned start address, but the buffer may start
+  // partway into the first page of the mapping.
+  uintptr_t pageSize = llvm::sys::Process::getPageSizeEstimate();
+  auto start = reinterpret_cast<uintptr_t>(buffer->getBufferStart());
+  auto end = reinterpret_cast<uintptr_t>(buffer->getBufferEnd());
+  start &= ~(pageSize - 1);
+
+  // This is purely a hint, so ignore failures.
+  (void)::madvise(reinterpret_cast<void *>(start), end - start,
+                  MADV_SEQUENTIAL);
+#endif
+}
+
 // Parse the specified .fir file into the specified MLIR context.
 OwningModuleRef circt::firrtl::importFIRFile(SourceMgr &sourceMgr,
                                              MLIRContext *context,
                                              FIRParserOptions options) {
+  return importFIRFile(sourceMgr, context, options, {});
+}
+
+OwningModuleRef circt::firrtl::importFIRFile(SourceMgr &sourceMgr,
+                                             MLIRContext *context,
+                                             FIRParserOptions options,
+                                             FIRModuleCallback moduleCallback) {
   auto sourceBuf = sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID());
+  adviseSequentialAccess(sourceBuf);
   const llvm::MemoryBuffer *annotationsBuf = nullptr;
   if (sourceMgr.getNumBuffers() > 1)
     annotationsBuf = sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID() + 1);
@@ -3586,7 +3915,8 @@ OwningModuleRef circt::firrtl::importFIRFile(SourceMgr &sourceMgr,
                           /*column=*/0)));
   SharedParserConstants state(context, options);
   FIRLexer lexer(sourceMgr, context);
-  if (FIRCircuitParser(state, lexer, *module).parseCircuit(annotationsBuf))
+  if (FIRCircuitParser(state, lexer, *module, moduleCallback)
+          .parseCircuit(annotationsBuf))
     return nullptr;
 
   // Make sure the parse module has no other structural problems detected by
@@ -3597,6 +3927,18 @@ OwningModuleRef circt::firrtl::importFIRFile(SourceMgr &sourceMgr,
   return module;
 }
 
+LogicalResult circt::firrtl::lexFIRFile(SourceMgr &sourceMgr,
+                                       MLIRContext *context,
+                                       size_t &numTokens) {
+  FIRLexer lexer(sourceMgr, context);
+  for (numTokens = 0; lexer.getToken().isNot(FIRToken::eof); ++numTokens) {
+    if (lexer.getToken().is(FIRToken::error))
+      return failure();
+    lexer.lexToken();
+  }
+  return success();
+}
+
 void circt::firrtl::registerFromFIRFileTranslation() {
   static mlir::TranslateToMLIRRegistration fromFIR(
       "import-firrtl", [](llvm::SourceMgr &sourceMgr, MLIRContext *context) {
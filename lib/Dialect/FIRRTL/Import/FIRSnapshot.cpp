@@ -0,0 +1,865 @@
+//===- FIRSnapshot.cpp - Binary FIRRTL snapshot format --------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This implements the writer and the reader of the binary snapshot format.
+//
+// A snapshot is the magic number and version, followed by four tables and the
+// operation tree.  All integers are encoded as unsigned LEB128 varints, and
+// everything refers to earlier entries by their index in a table:
+//
+//   snapshot   ::= magic version strings types attributes numValues op
+//   strings    ::= count (length bytes)*
+//   types      ::= count (string)*             // the type in textual form
+//   attributes ::= count (kind payload)*        // see AttributeKind
+//   op         ::= name:string loc:attribute
+//                  numOperands (value type?)*   // type for forward refs only
+//                  numResults (type)*
+//                  dict:attribute
+//                  numSuccessors (block)*
+//                  numRegions region*
+//   region     ::= numBlocks (numArgs (type loc:attribute)*)* (numOps op*)*
+//
+// Values are numbered in the order the reader defines them: the results of an
+// operation, then the arguments of all blocks in each of its regions, then the
+// operations in those blocks.  Types and the attributes without a structural
+// encoding are stored as text and parsed once each, which is cheap since they
+// are uniqued: a design has few distinct types, and most attributes are names,
+// integers, arrays and dictionaries, which are encoded structurally.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/FIRRTL/FIRSnapshot.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/Verifier.h"
+#include "mlir/Parser.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace circt;
+using namespace firrtl;
+
+using llvm::SourceMgr;
+using mlir::CallSiteLoc;
+using mlir::LocationAttr;
+using mlir::NameLoc;
+using mlir::OpaqueLoc;
+using mlir::OperationName;
+using mlir::UnitAttr;
+
+/// The magic number at the start of every snapshot.
+static constexpr StringLiteral snapshotMagic = "FIRSNAP";
+
+/// The version of the format.  Bump this whenever the encoding changes, since
+/// snapshots are only meant to be reloaded by the firtool that wrote them.
+static constexpr uint64_t snapshotVersion = 1;
+
+namespace {
+/// The encoding used for an entry in the attribute table.
+enum class AttributeKind : uint64_t {
+  /// Any other attribute, stored as a string in textual form.
+  Generic,
+  String,
+  Integer,
+  Type,
+  Unit,
+  Array,
+  Dictionary,
+  UnknownLoc,
+  FileLineColLoc,
+  NameLoc,
+  CallSiteLoc,
+  FusedLoc,
+};
+} // end anonymous namespace
+
+bool circt::firrtl::isFIRSnapshot(StringRef buffer) {
+  return buffer.startswith(snapshotMagic);
+}
+
+//===----------------------------------------------------------------------===//
+// Writer
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct SnapshotWriter {
+  void write(Operation *rootOp, raw_ostream &os);
+
+private:
+  unsigned getStringIndex(StringRef string);
+  unsigned getTypeIndex(Type type);
+  unsigned getAttributeIndex(Attribute attr);
+  unsigned getAttributeIndex(Location loc) {
+    return getAttributeIndex(LocationAttr(loc));
+  }
+
+  void numberValues(Operation *op);
+  void writeOp(Operation *op);
+  void writeRegion(Region &region);
+
+  /// Append the specified integer to the output as a varint.
+  static void writeVarInt(std::string &out, uint64_t value) {
+    do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      out.push_back(char(value ? byte | 0x80 : byte));
+    } while (value);
+  }
+
+  /// The encoded tables and the encoded operation tree.
+  std::string stringTable, typeTable, attributeTable, opTree;
+
+  llvm::StringMap<unsigned> strings;
+  DenseMap<Type, unsigned> types;
+  DenseMap<Attribute, unsigned> attributes;
+  unsigned numAttributeEntries = 0;
+
+  /// The number of every value, and the number of values the reader will have
+  /// defined at the point of the operation tree that is being written.
+  DenseMap<Value, unsigned> valueNumbers;
+  unsigned numDefinedValues = 0;
+
+  /// The index of each block in the region being written.
+  DenseMap<Block *, unsigned> blockIndices;
+};
+} // end anonymous namespace
+
+unsigned SnapshotWriter::getStringIndex(StringRef string) {
+  auto it = strings.try_emplace(string, strings.size());
+  if (it.second) {
+    writeVarInt(stringTable, string.size());
+    stringTable += string;
+  }
+  return it.first->second;
+}
+
+unsigned SnapshotWriter::getTypeIndex(Type type) {
+  auto it = types.find(type);
+  if (it != types.end())
+    return it->second;
+
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  type.print(os);
+  writeVarInt(typeTable, getStringIndex(os.str()));
+
+  unsigned index = types.size();
+  types.insert({type, index});
+  return index;
+}
+
+unsigned SnapshotWriter::getAttributeIndex(Attribute attr) {
+  auto it = attributes.find(attr);
+  if (it != attributes.end())
+    return it->second;
+
+  // Encode the attribute, adding any attributes it refers to to the table
+  // first: the reader requires that references only go backwards.
+  std::string entry;
+  auto writeKind = [&](AttributeKind kind) {
+    writeVarInt(entry, uint64_t(kind));
+  };
+
+  auto stringAttr = attr.dyn_cast<StringAttr>();
+  if (stringAttr && stringAttr.getType().isa<NoneType>()) {
+    writeKind(AttributeKind::String);
+    writeVarInt(entry, getStringIndex(stringAttr.getValue()));
+  } else if (auto intAttr = attr.dyn_cast<IntegerAttr>()) {
+    auto value = intAttr.getValue();
+    writeKind(AttributeKind::Integer);
+    writeVarInt(entry, getTypeIndex(intAttr.getType()));
+    writeVarInt(entry, value.getBitWidth());
+    for (unsigned i = 0, e = value.getNumWords(); i != e; ++i)
+      writeVarInt(entry, value.getRawData()[i]);
+  } else if (auto typeAttr = attr.dyn_cast<TypeAttr>()) {
+    writeKind(AttributeKind::Type);
+    writeVarInt(entry, getTypeIndex(typeAttr.getValue()));
+  } else if (attr.isa<UnitAttr>()) {
+    writeKind(AttributeKind::Unit);
+  } else if (auto arrayAttr = attr.dyn_cast<ArrayAttr>()) {
+    SmallVector<unsigned> elements;
+    for (auto element : arrayAttr)
+      elements.push_back(getAttributeIndex(element));
+    writeKind(AttributeKind::Array);
+    writeVarInt(entry, elements.size());
+    for (auto element : elements)
+      writeVarInt(entry, element);
+  } else if (auto dictAttr = attr.dyn_cast<DictionaryAttr>()) {
+    SmallVector<std::pair<unsigned, unsigned>> elements;
+    for (auto namedAttr : dictAttr)
+      elements.push_back({getStringIndex(namedAttr.first.strref()),
+                          getAttributeIndex(namedAttr.second)});
+    writeKind(AttributeKind::Dictionary);
+    writeVarInt(entry, elements.size());
+    for (auto element : elements) {
+      writeVarInt(entry, element.first);
+      writeVarInt(entry, element.second);
+    }
+  } else if (attr.isa<UnknownLoc>()) {
+    writeKind(AttributeKind::UnknownLoc);
+  } else if (auto fileLoc = attr.dyn_cast<FileLineColLoc>()) {
+    writeKind(AttributeKind::FileLineColLoc);
+    writeVarInt(entry, getStringIndex(fileLoc.getFilename()));
+    writeVarInt(entry, fileLoc.getLine());
+    writeVarInt(entry, fileLoc.getColumn());
+  } else if (auto nameLoc = attr.dyn_cast<NameLoc>()) {
+    unsigned child = getAttributeIndex(nameLoc.getChildLoc());
+    writeKind(AttributeKind::NameLoc);
+    writeVarInt(entry, getStringIndex(nameLoc.getName().strref()));
+    writeVarInt(entry, child);
+  } else if (auto callSiteLoc = attr.dyn_cast<CallSiteLoc>()) {
+    unsigned callee = getAttributeIndex(callSiteLoc.getCallee());
+    unsigned caller = getAttributeIndex(callSiteLoc.getCaller());
+    writeKind(AttributeKind::CallSiteLoc);
+    writeVarInt(entry, callee);
+    writeVarInt(entry, caller);
+  } else if (auto fusedLoc = attr.dyn_cast<FusedLoc>()) {
+    SmallVector<unsigned> locs;
+    for (auto loc : fusedLoc.getLocations())
+      locs.push_back(getAttributeIndex(loc));
+    // The metadata is optional, so it is stored off by one.
+    unsigned metadata = 0;
+    if (auto metadataAttr = fusedLoc.getMetadata())
+      metadata = getAttributeIndex(metadataAttr) + 1;
+    writeKind(AttributeKind::FusedLoc);
+    writeVarInt(entry, locs.size());
+    for (auto loc : locs)
+      writeVarInt(entry, loc);
+    writeVarInt(entry, metadata);
+  } else if (auto opaqueLoc = attr.dyn_cast<OpaqueLoc>()) {
+    // Opaque locations point at objects in memory that cannot be serialized.
+    auto index = getAttributeIndex(opaqueLoc.getFallbackLocation());
+    attributes.insert({attr, index});
+    return index;
+  } else {
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    attr.print(os);
+    writeKind(AttributeKind::Generic);
+    writeVarInt(entry, getStringIndex(os.str()));
+  }
+
+  attributeTable += entry;
+  unsigned index = numAttributeEntries++;
+  attributes.insert({attr, index});
+  return index;
+}
+
+/// Number the values defined by the specified operation and everything nested
+/// in it, in the order the reader will define them.
+void SnapshotWriter::numberValues(Operation *op) {
+  for (auto result : op->getResults())
+    valueNumbers.insert({result, valueNumbers.size()});
+  for (auto &region : op->getRegions()) {
+    for (auto &block : region)
+      for (auto arg : block.getArguments())
+        valueNumbers.insert({arg, valueNumbers.size()});
+    for (auto &block : region)
+      for (auto &nestedOp : block)
+        numberValues(&nestedOp);
+  }
+}
+
+void SnapshotWriter::writeOp(Operation *op) {
+  writeVarInt(opTree, getStringIndex(op->getName().getStringRef()));
+  writeVarInt(opTree, getAttributeIndex(op->getLoc()));
+
+  // The reader needs the type of a value that it has not defined yet to create
+  // a placeholder for it.
+  writeVarInt(opTree, op->getNumOperands());
+  for (auto operand : op->getOperands()) {
+    unsigned number = valueNumbers.lookup(operand);
+    writeVarInt(opTree, number);
+    if (number >= numDefinedValues)
+      writeVarInt(opTree, getTypeIndex(operand.getType()));
+  }
+
+  writeVarInt(opTree, op->getNumResults());
+  for (auto type : op->getResultTypes())
+    writeVarInt(opTree, getTypeIndex(type));
+  numDefinedValues += op->getNumResults();
+
+  writeVarInt(opTree, getAttributeIndex(op->getAttrDictionary()));
+
+  writeVarInt(opTree, op->getNumSuccessors());
+  for (auto *successor : op->getSuccessors())
+    writeVarInt(opTree, blockIndices.lookup(successor));
+
+  writeVarInt(opTree, op->getNumRegions());
+  for (auto &region : op->getRegions())
+    writeRegion(region);
+}
+
+void SnapshotWriter::writeRegion(Region &region) {
+  DenseMap<Block *, unsigned> outerBlockIndices;
+  std::swap(blockIndices, outerBlockIndices);
+
+  writeVarInt(opTree, llvm::size(region));
+  for (auto &block : region) {
+    blockIndices.insert({&block, blockIndices.size()});
+    writeVarInt(opTree, block.getNumArguments());
+    for (auto arg : block.getArguments()) {
+      writeVarInt(opTree, getTypeIndex(arg.getType()));
+      writeVarInt(opTree, getAttributeIndex(arg.getLoc()));
+    }
+    numDefinedValues += block.getNumArguments();
+  }
+
+  for (auto &block : region) {
+    writeVarInt(opTree, llvm::size(block));
+    for (auto &op : block)
+      writeOp(&op);
+  }
+
+  std::swap(blockIndices, outerBlockIndices);
+}
+
+void SnapshotWriter::write(Operation *rootOp, raw_ostream &os) {
+  numberValues(rootOp);
+  writeOp(rootOp);
+
+  std::string header;
+  header += snapshotMagic;
+  writeVarInt(header, snapshotVersion);
+  os << header;
+
+  // The tables are written after the fact, since they are filled in while the
+  // operation tree is encoded.  Each is preceded by its number of entries.
+  auto writeTable = [&](size_t count, StringRef table) {
+    std::string countBytes;
+    writeVarInt(countBytes, count);
+    os << countBytes << table;
+  };
+  writeTable(strings.size(), stringTable);
+  writeTable(types.size(), typeTable);
+  writeTable(numAttributeEntries, attributeTable);
+  writeTable(valueNumbers.size(), opTree);
+}
+
+LogicalResult circt::firrtl::writeFIRSnapshot(ModuleOp module,
+                                              raw_ostream &os) {
+  SnapshotWriter().write(module, os);
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Reader
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct SnapshotReader {
+  SnapshotReader(StringRef buffer, Location fileLoc)
+      : context(fileLoc->getContext()), fileLoc(fileLoc),
+        curPtr(buffer.begin()), endPtr(buffer.end()) {}
+
+  ~SnapshotReader() {
+    for (auto &placeholder : placeholders)
+      placeholder.second->destroy();
+  }
+
+  Operation *read();
+
+private:
+  LogicalResult emitError(const Twine &message) {
+    return mlir::emitError(fileLoc, "invalid FIRRTL snapshot: ") << message,
+           failure();
+  }
+
+  LogicalResult readVarInt(uint64_t &result);
+  LogicalResult readIndex(unsigned &result, size_t size, StringRef what);
+  LogicalResult readString(StringRef &result);
+  LogicalResult readType(Type &result);
+  template <typename AttrType = Attribute>
+  LogicalResult readAttribute(AttrType &result);
+  Identifier getIdentifier(unsigned stringIndex);
+
+  LogicalResult readStringTable();
+  LogicalResult readTypeTable();
+  LogicalResult readAttributeTable();
+  LogicalResult readAttributeEntry(Attribute &result);
+
+  LogicalResult readOperand(Value &result);
+  void defineValue(Value value);
+  LogicalResult readOp(Block *parent, ArrayRef<Block *> regionBlocks,
+                       Operation *&result);
+  LogicalResult readRegion(Region &region);
+
+  MLIRContext *context;
+  Location fileLoc;
+  const char *curPtr, *endPtr;
+
+  std::vector<StringRef> strings;
+  std::vector<Type> types;
+  std::vector<Attribute> attributes;
+
+  /// Identifiers and operation names are uniqued in the context, so only look
+  /// up each one once.
+  DenseMap<unsigned, Identifier> identifiers;
+  DenseMap<unsigned, OperationName> opNames;
+
+  /// Every value by its number, the number of values defined so far, and the
+  /// placeholders standing in for the values used before they are defined.
+  std::vector<Value> values;
+  unsigned numDefinedValues = 0;
+  DenseMap<unsigned, Operation *> placeholders;
+};
+} // end anonymous namespace
+
+LogicalResult SnapshotReader::readVarInt(uint64_t &result) {
+  result = 0;
+  for (unsigned shift = 0; curPtr != endPtr && shift < 64; shift += 7) {
+    uint8_t byte = *curPtr++;
+    result |= uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return success();
+  }
+  return emitError("unexpected end of file");
+}
+
+LogicalResult SnapshotReader::readIndex(unsigned &result, size_t size,
+                                        StringRef what) {
+  uint64_t index;
+  if (failed(readVarInt(index)))
+    return failure();
+  if (index >= size)
+    return emitError(Twine(what) + " index out of range");
+  result = index;
+  return success();
+}
+
+LogicalResult SnapshotReader::readString(StringRef &result) {
+  unsigned index;
+  if (failed(readIndex(index, strings.size(), "string")))
+    return failure();
+  result = strings[index];
+  return success();
+}
+
+LogicalResult SnapshotReader::readType(Type &result) {
+  unsigned index;
+  if (failed(readIndex(index, types.size(), "type")))
+    return failure();
+  result = types[index];
+  return success();
+}
+
+template <typename AttrType>
+LogicalResult SnapshotReader::readAttribute(AttrType &result) {
+  unsigned index;
+  if (failed(readIndex(index, attributes.size(), "attribute")))
+    return failure();
+  result = attributes[index].dyn_cast<AttrType>();
+  if (!result)
+    return emitError("attribute has the wrong kind");
+  return success();
+}
+
+Identifier SnapshotReader::getIdentifier(unsigned stringIndex) {
+  auto it = identifiers.find(stringIndex);
+  if (it == identifiers.end())
+    it = identifiers
+             .insert({stringIndex, Identifier::get(strings[stringIndex],
+                                                   context)})
+             .first;
+  return it->second;
+}
+
+LogicalResult SnapshotReader::readStringTable() {
+  uint64_t count;
+  if (failed(readVarInt(count)))
+    return failure();
+  strings.reserve(std::min<uint64_t>(count, endPtr - curPtr));
+  while (count--) {
+    uint64_t length;
+    if (failed(readVarInt(length)))
+      return failure();
+    if (length > uint64_t(endPtr - curPtr))
+      return emitError("unexpected end of file");
+    // The strings are referenced in place, without copying them.
+    strings.push_back(StringRef(curPtr, length));
+    curPtr += length;
+  }
+  return success();
+}
+
+LogicalResult SnapshotReader::readTypeTable() {
+  uint64_t count;
+  if (failed(readVarInt(count)))
+    return failure();
+  types.reserve(std::min<uint64_t>(count, endPtr - curPtr));
+  while (count--) {
+    StringRef text;
+    if (failed(readString(text)))
+      return failure();
+    auto type = mlir::parseType(text, context);
+    if (!type)
+      return emitError("cannot parse type '" + text + "'");
+    types.push_back(type);
+  }
+  return success();
+}
+
+LogicalResult SnapshotReader::readAttributeTable() {
+  uint64_t count;
+  if (failed(readVarInt(count)))
+    return failure();
+  attributes.reserve(std::min<uint64_t>(count, endPtr - curPtr));
+  while (count--) {
+    Attribute attr;
+    if (failed(readAttributeEntry(attr)))
+      return failure();
+    attributes.push_back(attr);
+  }
+  return success();
+}
+
+LogicalResult SnapshotReader::readAttributeEntry(Attribute &result) {
+  uint64_t kind;
+  if (failed(readVarInt(kind)))
+    return failure();
+
+  switch (AttributeKind(kind)) {
+  case AttributeKind::Generic: {
+    StringRef text;
+    if (failed(readString(text)))
+      return failure();
+    result = mlir::parseAttribute(text, context);
+    if (!result)
+      return emitError("cannot parse attribute '" + text + "'");
+    return success();
+  }
+  case AttributeKind::String: {
+    StringRef value;
+    if (failed(readString(value)))
+      return failure();
+    result = StringAttr::get(context, value);
+    return success();
+  }
+  case AttributeKind::Integer: {
+    Type type;
+    uint64_t bitWidth;
+    if (failed(readType(type)) || failed(readVarInt(bitWidth)))
+      return failure();
+    if (!type.isIntOrIndex() || bitWidth > IntegerType::kMaxWidth ||
+        bitWidth != (type.isIndex() ? IndexType::kInternalStorageBitWidth
+                                    : type.getIntOrFloatBitWidth()))
+      return emitError("invalid integer attribute");
+    SmallVector<uint64_t> words(APInt::getNumWords(bitWidth));
+    for (auto &word : words)
+      if (failed(readVarInt(word)))
+        return failure();
+    result = IntegerAttr::get(type, APInt(bitWidth, words));
+    return success();
+  }
+  case AttributeKind::Type: {
+    Type type;
+    if (failed(readType(type)))
+      return failure();
+    result = TypeAttr::get(type);
+    return success();
+  }
+  case AttributeKind::Unit:
+    result = UnitAttr::get(context);
+    return success();
+  case AttributeKind::Array: {
+    uint64_t count;
+    if (failed(readVarInt(count)))
+      return failure();
+    SmallVector<Attribute> elements;
+    while (count--) {
+      Attribute element;
+      if (failed(readAttribute(element)))
+        return failure();
+      elements.push_back(element);
+    }
+    result = ArrayAttr::get(context, elements);
+    return success();
+  }
+  case AttributeKind::Dictionary: {
+    uint64_t count;
+    if (failed(readVarInt(count)))
+      return failure();
+    SmallVector<NamedAttribute> elements;
+    while (count--) {
+      unsigned name;
+      Attribute value;
+      if (failed(readIndex(name, strings.size(), "string")) ||
+          failed(readAttribute(value)))
+        return failure();
+      elements.push_back({getIdentifier(name), value});
+    }
+    result = DictionaryAttr::get(context, elements);
+    return success();
+  }
+  case AttributeKind::UnknownLoc:
+    result = UnknownLoc::get(context);
+    return success();
+  case AttributeKind::FileLineColLoc: {
+    unsigned filename;
+    uint64_t line, column;
+    if (failed(readIndex(filename, strings.size(), "string")) ||
+        failed(readVarInt(line)) || failed(readVarInt(column)))
+      return failure();
+    result = FileLineColLoc::get(getIdentifier(filename), line, column);
+    return success();
+  }
+  case AttributeKind::NameLoc: {
+    unsigned name;
+    LocationAttr child;
+    if (failed(readIndex(name, strings.size(), "string")) ||
+        failed(readAttribute(child)))
+      return failure();
+    result = NameLoc::get(getIdentifier(name), child);
+    return success();
+  }
+  case AttributeKind::CallSiteLoc: {
+    LocationAttr callee, caller;
+    if (failed(readAttribute(callee)) || failed(readAttribute(caller)))
+      return failure();
+    result = CallSiteLoc::get(callee, caller);
+    return success();
+  }
+  case AttributeKind::FusedLoc: {
+    uint64_t count, metadataIndex;
+    if (failed(readVarInt(count)))
+      return failure();
+    SmallVector<Location> locs;
+    while (count--) {
+      LocationAttr loc;
+      if (failed(readAttribute(loc)))
+        return failure();
+      locs.push_back(loc);
+    }
+    if (failed(readVarInt(metadataIndex)))
+      return failure();
+    if (metadataIndex > attributes.size())
+      return emitError("attribute index out of range");
+    Attribute metadata;
+    if (metadataIndex)
+      metadata = attributes[metadataIndex - 1];
+    result = FusedLoc::get(context, locs, metadata);
+    return success();
+  }
+  }
+  return emitError("unknown attribute kind");
+}
+
+LogicalResult SnapshotReader::readOperand(Value &result) {
+  unsigned number;
+  if (failed(readIndex(number, values.size(), "value")))
+    return failure();
+  if (number < numDefinedValues) {
+    result = values[number];
+    return success();
+  }
+
+  // This is a forward reference, which comes with the type of the value.
+  Type type;
+  if (failed(readType(type)))
+    return failure();
+  if (!values[number]) {
+    OperationState state(fileLoc, "firrtl.snapshot_placeholder");
+    state.addTypes(type);
+    auto *placeholder = Operation::create(state);
+    placeholders.insert({number, placeholder});
+    values[number] = placeholder->getResult(0);
+  }
+  result = values[number];
+  return success();
+}
+
+void SnapshotReader::defineValue(Value value) {
+  unsigned number = numDefinedValues++;
+  auto it = placeholders.find(number);
+  if (it != placeholders.end()) {
+    it->second->getResult(0).replaceAllUsesWith(value);
+    it->second->destroy();
+    placeholders.erase(it);
+  }
+  values[number] = value;
+}
+
+LogicalResult SnapshotReader::readOp(Block *parent,
+                                     ArrayRef<Block *> regionBlocks,
+                                     Operation *&result) {
+  unsigned nameIndex;
+  LocationAttr loc;
+  if (failed(readIndex(nameIndex, strings.size(), "string")) ||
+      failed(readAttribute(loc)))
+    return failure();
+
+  auto nameIt = opNames.find(nameIndex);
+  if (nameIt == opNames.end())
+    nameIt = opNames
+                 .insert({nameIndex,
+                          OperationName(strings[nameIndex], context)})
+                 .first;
+  OperationState state(loc, nameIt->second);
+
+  uint64_t numOperands;
+  if (failed(readVarInt(numOperands)))
+    return failure();
+  while (numOperands--) {
+    Value operand;
+    if (failed(readOperand(operand)))
+      return failure();
+    state.operands.push_back(operand);
+  }
+
+  uint64_t numResults;
+  if (failed(readVarInt(numResults)))
+    return failure();
+  if (numResults > values.size() - numDefinedValues)
+    return emitError("value index out of range");
+  while (numResults--) {
+    Type type;
+    if (failed(readType(type)))
+      return failure();
+    state.types.push_back(type);
+  }
+
+  DictionaryAttr attrs;
+  if (failed(readAttribute(attrs)))
+    return failure();
+  state.attributes = NamedAttrList(attrs);
+
+  uint64_t numSuccessors;
+  if (failed(readVarInt(numSuccessors)))
+    return failure();
+  while (numSuccessors--) {
+    unsigned index;
+    if (failed(readIndex(index, regionBlocks.size(), "block")))
+      return failure();
+    state.successors.push_back(regionBlocks[index]);
+  }
+
+  uint64_t numRegions;
+  if (failed(readVarInt(numRegions)))
+    return failure();
+  for (uint64_t i = 0; i != numRegions; ++i)
+    state.addRegion();
+
+  result = Operation::create(state);
+  if (parent)
+    parent->push_back(result);
+  for (auto opResult : result->getResults())
+    defineValue(opResult);
+
+  for (auto &region : result->getRegions())
+    if (failed(readRegion(region)))
+      return failure();
+  return success();
+}
+
+LogicalResult SnapshotReader::readRegion(Region &region) {
+  uint64_t numBlocks;
+  if (failed(readVarInt(numBlocks)))
+    return failure();
+
+  // Create all the blocks up front, so that they can be used as successors.
+  SmallVector<Block *> blocks;
+  while (numBlocks--) {
+    auto *block = new Block();
+    region.push_back(block);
+    blocks.push_back(block);
+
+    uint64_t numArgs;
+    if (failed(readVarInt(numArgs)))
+      return failure();
+    if (numArgs > values.size() - numDefinedValues)
+      return emitError("value index out of range");
+    while (numArgs--) {
+      Type type;
+      LocationAttr loc;
+      if (failed(readType(type)) || failed(readAttribute(loc)))
+        return failure();
+      defineValue(block->addArgument(type, Location(loc)));
+    }
+  }
+
+  for (auto *block : blocks) {
+    uint64_t numOps;
+    if (failed(readVarInt(numOps)))
+      return failure();
+    while (numOps--) {
+      Operation *op;
+      if (failed(readOp(block, blocks, op)))
+        return failure();
+    }
+  }
+  return success();
+}
+
+Operation *SnapshotReader::read() {
+  uint64_t version, numValues;
+  curPtr += snapshotMagic.size();
+  if (failed(readVarInt(version)))
+    return nullptr;
+  if (version != snapshotVersion) {
+    emitError("unsupported version " + Twine(version));
+    return nullptr;
+  }
+
+  if (failed(readStringTable()) || failed(readTypeTable()) ||
+      failed(readAttributeTable()) || failed(readVarInt(numValues)))
+    return nullptr;
+  // Each value takes at least one byte to define.
+  if (numValues > uint64_t(endPtr - curPtr)) {
+    emitError("unexpected end of file");
+    return nullptr;
+  }
+  values.resize(numValues);
+
+  Operation *rootOp = nullptr;
+  if (succeeded(readOp(/*parent=*/nullptr, /*regionBlocks=*/{}, rootOp))) {
+    if (curPtr != endPtr)
+      emitError("unexpected data after the operation tree");
+    else if (!placeholders.empty())
+      emitError("value used but never defined");
+    else
+      return rootOp;
+  }
+
+  // Tear down whatever has been created, dropping the uses between operations
+  // first since they can refer to each other in any order.
+  if (rootOp) {
+    rootOp->dropAllReferences();
+    rootOp->destroy();
+  }
+  return nullptr;
+}
+
+OwningModuleRef circt::firrtl::importFIRSnapshot(SourceMgr &sourceMgr,
+                                                 MLIRContext *context) {
+  auto *sourceBuf = sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID());
+  auto fileLoc = FileLineColLoc::get(
+      context, sourceBuf->getBufferIdentifier(), /*line=*/0, /*column=*/0);
+  if (!isFIRSnapshot(sourceBuf->getBuffer())) {
+    mlir::emitError(fileLoc, "not a FIRRTL snapshot");
+    return {};
+  }
+
+  auto *rootOp = SnapshotReader(sourceBuf->getBuffer(), fileLoc).read();
+  if (!rootOp)
+    return {};
+
+  OwningModuleRef module(dyn_cast<ModuleOp>(rootOp));
+  if (!module) {
+    mlir::emitError(fileLoc, "FIRRTL snapshot does not contain a module");
+    rootOp->destroy();
+    return {};
+  }
+
+  // The snapshot was written from verified IR, but it may have been written by
+  // a different version of the dialects.
+  if (failed(mlir::verify(*module)))
+    return {};
+  return module;
+}
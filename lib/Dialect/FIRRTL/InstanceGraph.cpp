@@ -13,14 +13,21 @@ using namespace firrtl;
 
 InstanceRecord *InstanceGraphNode::recordInstance(InstanceOp instance,
                                                   InstanceGraphNode *target) {
-  moduleInstances.emplace_back(instance, this, target);
-  return &moduleInstances.back();
+  auto *record = new InstanceRecord(instance, this, target);
+  moduleInstances.push_back(record);
+  return record;
 }
 
 void InstanceGraphNode::recordUse(InstanceRecord *record) {
   moduleUses.push_back(record);
 }
 
+void InstanceGraphNode::removeUse(InstanceRecord *record) {
+  auto it = llvm::find(moduleUses, record);
+  assert(it != moduleUses.end() && "instance is not a use of this module");
+  moduleUses.erase(it);
+}
+
 InstanceGraph::InstanceGraph(Operation *operation) {
   auto circuitOp = cast<CircuitOp>(operation);
 
@@ -28,37 +35,22 @@ InstanceGraph::InstanceGraph(Operation *operation) {
   // here is enough to ensure that it is the first one added.
   getOrAddNode(circuitOp.name());
 
-  for (auto &op : *circuitOp.getBody()) {
-    if (auto extModule = dyn_cast<FExtModuleOp>(op)) {
-      auto *currentNode = getOrAddNode(extModule.getName());
-      currentNode->module = extModule;
-    }
-    if (auto module = dyn_cast<FModuleOp>(op)) {
-      auto *currentNode = getOrAddNode(module.getName());
-      currentNode->module = module;
-      // Find all instance operations in the module body.
-      module.body().walk([&](InstanceOp instanceOp) {
-        // Add an edge to indicate that this module instantiates the target.
-        auto *targetNode = getOrAddNode(instanceOp.moduleName());
-        auto *instanceRecord =
-            currentNode->recordInstance(instanceOp, targetNode);
-        targetNode->recordUse(instanceRecord);
-      });
-    }
-  }
+  for (auto &op : *circuitOp.getBody())
+    if (isa<FModuleOp, FExtModuleOp>(op))
+      addModule(&op);
 }
 
 InstanceGraphNode *InstanceGraph::getTopLevelNode() {
-  // The graph always puts the top level module in the array first.
-  if (!nodes.size())
+  // The graph always puts the top level module in the list first.
+  if (nodes.empty())
     return nullptr;
-  return &nodes[0];
+  return &nodes.front();
 }
 
 InstanceGraphNode *InstanceGraph::lookup(StringRef name) {
   auto it = nodeMap.find(name);
   assert(it != nodeMap.end() && "Module not in InstanceGraph!");
-  return &nodes[it->second];
+  return it->second;
 }
 
 InstanceGraphNode *InstanceGraph::lookup(Operation *op) {
@@ -74,18 +66,137 @@ InstanceGraphNode *InstanceGraph::lookup(Operation *op) {
 InstanceGraphNode *InstanceGraph::getOrAddNode(StringRef name) {
   // Try to insert an InstanceGraphNode. If its not inserted, it returns
   // an iterator pointing to the node.
-  auto itAndInserted = nodeMap.try_emplace(name, 0);
-  auto &index = itAndInserted.first->second;
+  auto itAndInserted = nodeMap.try_emplace(name, nullptr);
+  auto &node = itAndInserted.first->second;
   if (itAndInserted.second) {
-    // This is a new node, we have to add an element to the NodeVec.
-    nodes.emplace_back();
-    // Store the node storage index in to the map.
-    index = nodes.size() - 1;
-    return &nodes.back();
+    // This is a new node, we have to add an element to the node list.
+    node = new InstanceGraphNode();
+    nodes.push_back(node);
   }
-  return &nodes[index];
+  return node;
 }
 
 Operation *InstanceGraph::getReferencedModule(InstanceOp op) {
   return lookup(op.moduleName())->getModule();
 }
+
+void InstanceGraph::addInstances(InstanceGraphNode *node) {
+  auto module = dyn_cast<FModuleOp>(node->getModule());
+  if (!module)
+    return;
+  // Find all instance operations in the module body.
+  module.body().walk([&](InstanceOp instanceOp) {
+    // Add an edge to indicate that this module instantiates the target.
+    auto *targetNode = getOrAddNode(instanceOp.moduleName());
+    auto *instanceRecord = node->recordInstance(instanceOp, targetNode);
+    targetNode->recordUse(instanceRecord);
+  });
+}
+
+InstanceGraphNode *InstanceGraph::addModule(Operation *module) {
+  auto name = SymbolTable::getSymbolName(module);
+  auto *node = getOrAddNode(name);
+  assert(!node->module && "module is already in the InstanceGraph");
+  node->module = module;
+  addInstances(node);
+  return node;
+}
+
+void InstanceGraph::erase(InstanceGraphNode *node) {
+  assert(node->moduleUses.empty() && "erasing a module which is still used");
+  assert(node != getTopLevelNode() && "erasing the top level module");
+  for (auto &record : node->moduleInstances)
+    record.target->removeUse(&record);
+  nodeMap.erase(SymbolTable::getSymbolName(node->getModule()));
+  nodes.erase(node);
+}
+
+void InstanceGraph::replaceModule(Operation *oldModule, Operation *newModule) {
+  auto *node = lookup(oldModule);
+  assert(SymbolTable::getSymbolName(oldModule) ==
+             SymbolTable::getSymbolName(newModule) &&
+         "replacement module must have the same name");
+  for (auto &record : node->moduleInstances)
+    record.target->removeUse(&record);
+  node->moduleInstances.clear();
+  node->module = newModule;
+  addInstances(node);
+}
+
+InstanceRecord *InstanceGraph::addInstance(InstanceOp instance) {
+  auto *parentNode = lookup(instance->getParentOfType<FModuleOp>());
+  auto *targetNode = getOrAddNode(instance.moduleName());
+  auto *record = parentNode->recordInstance(instance, targetNode);
+  targetNode->recordUse(record);
+  return record;
+}
+
+InstanceRecord *InstanceGraph::lookupRecord(InstanceOp instance) {
+  auto *parentNode = lookup(instance->getParentOfType<FModuleOp>());
+  for (auto &record : parentNode->moduleInstances)
+    if (record.instance == instance)
+      return &record;
+  llvm_unreachable("instance is not in the InstanceGraph");
+}
+
+void InstanceGraph::removeInstance(InstanceOp instance) {
+  auto *record = lookupRecord(instance);
+  record->target->removeUse(record);
+  record->parent->moduleInstances.erase(record);
+}
+
+void InstanceGraph::retargetInstance(InstanceOp instance) {
+  auto *record = lookupRecord(instance);
+  auto *targetNode = getOrAddNode(instance.moduleName());
+  if (targetNode == record->target)
+    return;
+  record->target->removeUse(record);
+  record->target = targetNode;
+  targetNode->recordUse(record);
+}
+
+ArrayRef<InstancePath> InstancePathCache::getAbsolutePaths(Operation *op) {
+  assert((isa<FModuleOp, FExtModuleOp>(op))); // extra parens makes parser smile
+
+  // If we have reached the circuit root, we're done.
+  if (op == instanceGraph.getTopLevelNode()->getModule()) {
+    static InstancePath empty{};
+    return empty; // array with single empty path
+  }
+
+  // Fast path: hit the cache.
+  auto cached = absolutePathsCache.find(op);
+  if (cached != absolutePathsCache.end())
+    return cached->second;
+
+  // For each instance, collect the instance paths to its parent and append the
+  // instance itself to each.
+  SmallVector<InstancePath, 8> extendedPaths;
+  for (auto inst : instanceGraph[op]->uses()) {
+    auto instPaths = getAbsolutePaths(inst->getParent()->getModule());
+    extendedPaths.reserve(instPaths.size());
+    for (auto path : instPaths) {
+      extendedPaths.push_back(appendInstance(path, inst->getInstance()));
+    }
+  }
+
+  // Move the list of paths into the bump allocator for later quick retrieval.
+  ArrayRef<InstancePath> pathList;
+  if (!extendedPaths.empty()) {
+    auto paths = allocator.Allocate<InstancePath>(extendedPaths.size());
+    std::copy(extendedPaths.begin(), extendedPaths.end(), paths);
+    pathList = ArrayRef<InstancePath>(paths, extendedPaths.size());
+  }
+
+  absolutePathsCache.insert({op, pathList});
+  return pathList;
+}
+
+InstancePath InstancePathCache::appendInstance(InstancePath path,
+                                               InstanceOp inst) {
+  size_t n = path.size() + 1;
+  auto newPath = allocator.Allocate<InstanceOp>(n);
+  std::copy(path.begin(), path.end(), newPath);
+  newPath[path.size()] = inst;
+  return InstancePath(newPath, n);
+}
@@ -15,6 +15,7 @@
 
 #include "PassDetails.h"
 #include "circt/Dialect/FIRRTL/FIRRTLAnnotations.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
 #include "circt/Dialect/FIRRTL/Passes.h"
 #include "circt/Dialect/HW/HWDialect.h"
 #include "circt/Dialect/SV/SVOps.h"
@@ -191,9 +192,12 @@ void BlackBoxReaderPass::runOnOperation() {
                                     context));
   }
 
-  // If nothing has changed we can preseve the analysis.
+  // If nothing has changed we can preseve the analysis.  Otherwise only
+  // verbatim ops were added, so the instance graph is still valid.
   if (!anythingChanged)
     markAllAnalysesPreserved();
+  else
+    markAnalysesPreserved<InstanceGraph>();
 
   // Clean up.
   emittedFiles.clear();
@@ -0,0 +1,262 @@
+//===- Dedup.cpp - FIRRTL module deduplication ------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the FIRRTL module deduplication pass, which merges
+// modules that are structurally identical up to the names and locations of the
+// operations in them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/FIRRTL/FIRRTLAnnotations.h"
+#include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
+#include "circt/Dialect/FIRRTL/Passes.h"
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/Threading.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "firrtl-dedup"
+
+using namespace circt;
+using namespace firrtl;
+
+//===----------------------------------------------------------------------===//
+// Structural Fingerprints
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A structural fingerprint of a module.  This is a flat encoding of the
+/// operations, types, attributes and use-def structure of the module body,
+/// leaving out the names and locations of operations.  Two modules have equal
+/// fingerprints exactly when they are equivalent up to those names, so the
+/// fingerprint serves both as the hash key and for the final comparison.
+struct ModuleFingerprint {
+  SmallVector<uintptr_t, 64> data;
+  llvm::hash_code hash = 0;
+
+  bool operator==(const ModuleFingerprint &other) const {
+    return hash == other.hash && data == other.data;
+  }
+};
+
+/// Builds the fingerprint of a module.  The modules instantiated by the module
+/// are encoded by the module they were deduplicated to, such that instances of
+/// equivalent modules are equivalent.
+class FingerprintBuilder {
+public:
+  FingerprintBuilder(InstanceGraph &instanceGraph,
+                     const DenseMap<Operation *, Operation *> &dedupedModules,
+                     ModuleFingerprint &fingerprint)
+      : instanceGraph(instanceGraph), dedupedModules(dedupedModules),
+        data(fingerprint.data) {}
+
+  void addModule(FModuleOp module);
+
+private:
+  void add(uintptr_t value) { data.push_back(value); }
+  void add(const void *pointer) { add(reinterpret_cast<uintptr_t>(pointer)); }
+  void add(Type type) { add(type.getAsOpaquePointer()); }
+  void add(Attribute attr) { add(attr.getAsOpaquePointer()); }
+  void addValue(Value value);
+  void addOperation(Operation *op);
+  void addBlock(Block &block);
+
+  InstanceGraph &instanceGraph;
+  const DenseMap<Operation *, Operation *> &dedupedModules;
+  SmallVectorImpl<uintptr_t> &data;
+
+  /// The number of each value in the module, in the order they were seen.
+  DenseMap<Value, unsigned> valueNumbers;
+};
+} // end anonymous namespace
+
+void FingerprintBuilder::addValue(Value value) {
+  auto it = valueNumbers.try_emplace(value, valueNumbers.size());
+  add(it.first->second);
+}
+
+void FingerprintBuilder::addBlock(Block &block) {
+  add(block.getNumArguments());
+  for (auto arg : block.getArguments()) {
+    add(arg.getType());
+    addValue(arg);
+  }
+  add(block.getOperations().size());
+  for (auto &op : block)
+    addOperation(&op);
+}
+
+void FingerprintBuilder::addOperation(Operation *op) {
+  add(op->getName().getAsOpaquePointer());
+
+  add(op->getNumOperands());
+  for (auto operand : op->getOperands())
+    addValue(operand);
+
+  add(op->getNumResults());
+  for (auto result : op->getResults()) {
+    add(result.getType());
+    addValue(result);
+  }
+
+  // Names are left out.  Instances are encoded by the module they refer to
+  // after deduplication rather than by the name of the module.
+  auto attrs = op->getAttrs();
+  add(attrs.size());
+  for (auto attr : attrs) {
+    add(attr.first.getAsOpaquePointer());
+    if (attr.first == "name")
+      continue;
+    if (attr.first == "moduleName") {
+      if (auto instance = dyn_cast<InstanceOp>(op)) {
+        auto *target = instanceGraph.getReferencedModule(instance);
+        if (auto *deduped = dedupedModules.lookup(target))
+          target = deduped;
+        add(target);
+        continue;
+      }
+    }
+    add(attr.second);
+  }
+
+  add(op->getNumRegions());
+  for (auto &region : op->getRegions()) {
+    add(region.getBlocks().size());
+    for (auto &block : region)
+      addBlock(block);
+  }
+}
+
+void FingerprintBuilder::addModule(FModuleOp module) {
+  // The ports of the module are part of its interface, so their names are
+  // kept.  Only the name of the module itself is left out.
+  for (auto attr : module->getAttrs()) {
+    if (attr.first == SymbolTable::getSymbolAttrName())
+      continue;
+    add(attr.first.getAsOpaquePointer());
+    add(attr.second);
+  }
+  addBlock(*module.getBodyBlock());
+}
+
+/// Return true if the module, or any of its ports, has annotations.  These
+/// target the specific module, so it cannot be merged with another one.
+static bool hasAnnotations(FModuleOp module) {
+  if (!AnnotationSet(module).empty())
+    return true;
+  for (unsigned i = 0, e = module.getNumArguments(); i != e; ++i)
+    if (!AnnotationSet::forPort(module, i).empty())
+      return true;
+  return false;
+}
+
+//===----------------------------------------------------------------------===//
+// Pass Infrastructure
+//===----------------------------------------------------------------------===//
+
+namespace {
+class DedupPass : public DedupBase<DedupPass> {
+  void runOnOperation() override;
+};
+} // end anonymous namespace
+
+void DedupPass::runOnOperation() {
+  auto circuit = getOperation();
+  auto &instanceGraph = getAnalysis<InstanceGraph>();
+  auto *topModule = instanceGraph.getTopLevelNode()->getModule();
+
+  // Bucket the modules reachable from the top module by their height in the
+  // instance graph.  Equivalent modules instantiate equivalent modules, so they
+  // are always in the same level, and all the modules they instantiate have
+  // been deduplicated by the time a level is processed.
+  std::vector<SmallVector<FModuleOp, 4>> levels;
+  DenseMap<Operation *, unsigned> heights;
+  for (auto *node : llvm::post_order(&instanceGraph)) {
+    unsigned height = 0;
+    for (auto *record : node->instances()) {
+      auto *target = record->getTarget()->getModule();
+      height = std::max(height, heights.lookup(target) + 1);
+    }
+    heights[node->getModule()] = height;
+
+    auto module = dyn_cast<FModuleOp>(node->getModule());
+    if (!module || module == topModule || hasAnnotations(module))
+      continue;
+    if (levels.size() <= height)
+      levels.resize(height + 1);
+    levels[height].push_back(module);
+  }
+
+  // The module each merged module was deduplicated to.
+  DenseMap<Operation *, Operation *> dedupedModules;
+
+  for (auto &level : levels) {
+    // Compute the fingerprints of all the modules in this level in parallel.
+    // The modules they instantiate are in lower levels, which are done.
+    std::vector<ModuleFingerprint> fingerprints(level.size());
+    mlir::parallelForEachN(&getContext(), 0, level.size(), [&](size_t index) {
+      auto &fingerprint = fingerprints[index];
+      FingerprintBuilder(instanceGraph, dedupedModules, fingerprint)
+          .addModule(level[index]);
+      fingerprint.hash = llvm::hash_combine_range(fingerprint.data.begin(),
+                                                  fingerprint.data.end());
+    });
+
+    // Merge every module into the first equivalent module in the level.  The
+    // modules are visited in a deterministic order.
+    DenseMap<size_t, SmallVector<unsigned, 1>> canonicalModules;
+    for (unsigned index = 0, e = level.size(); index != e; ++index) {
+      auto &candidates = canonicalModules[fingerprints[index].hash];
+      auto *canonical = llvm::find_if(candidates, [&](unsigned other) {
+        return fingerprints[other] == fingerprints[index];
+      });
+      if (canonical == candidates.end()) {
+        candidates.push_back(index);
+        continue;
+      }
+      LLVM_DEBUG(llvm::dbgs() << "Deduplicating " << level[index].getName()
+                              << " to " << level[*canonical].getName() << "\n");
+      dedupedModules[level[index]] = level[*canonical];
+    }
+  }
+
+  if (dedupedModules.empty()) {
+    markAllAnalysesPreserved();
+    return;
+  }
+
+  // Point all the instances of merged modules to the module they were merged
+  // into, and delete the merged modules.
+  for (auto &entry : dedupedModules) {
+    auto canonical = cast<FModuleOp>(entry.second);
+    auto moduleName = FlatSymbolRefAttr::get(circuit.getContext(),
+                                             canonical.getName());
+    // Copy the uses, retargeting the instances removes them from the list.
+    auto *node = instanceGraph[entry.first];
+    SmallVector<InstanceRecord *, 4> uses(node->uses_begin(), node->uses_end());
+    for (auto *use : uses) {
+      auto instance = use->getInstance();
+      instance->setAttr("moduleName", moduleName);
+      instanceGraph.retargetInstance(instance);
+    }
+  }
+  for (auto &entry : dedupedModules) {
+    instanceGraph.erase(instanceGraph[entry.first]);
+    entry.first->erase();
+  }
+
+  // The instance graph was updated along with the IR.
+  markAnalysesPreserved<InstanceGraph>();
+}
+
+std::unique_ptr<mlir::Pass> circt::firrtl::createDedupPass() {
+  return std::make_unique<DedupPass>();
+}
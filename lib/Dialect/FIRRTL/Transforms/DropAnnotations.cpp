@@ -0,0 +1,118 @@
+//===- DropAnnotations.cpp - Drop the annotations no longer needed --------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the FIRRTL annotation dropping pass, which removes all
+// the annotations of a circuit except those of the classes it is told to keep.
+// It is meant to run once the passes consuming the annotations ran, so that the
+// rest of the pipeline does not carry them along.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/FIRRTL/FIRRTLAnnotations.h"
+#include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "circt/Dialect/FIRRTL/Passes.h"
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/Threading.h"
+#include "llvm/ADT/StringSet.h"
+#include <atomic>
+
+using namespace circt;
+using namespace firrtl;
+
+namespace {
+struct DropAnnotationsPass : public DropAnnotationsBase<DropAnnotationsPass> {
+  DropAnnotationsPass() = default;
+  DropAnnotationsPass(ArrayRef<std::string> keepClasses) {
+    keep = keepClasses;
+  }
+
+  void runOnOperation() override;
+
+private:
+  bool dropAnnotations(Operation *module);
+  bool dropPortAnnotations(Operation *op);
+
+  /// Return true if the annotation is dropped.
+  bool isDropped(Annotation anno) const {
+    return !keepSet.count(anno.getClass());
+  }
+
+  llvm::StringSet<> keepSet;
+};
+} // end anonymous namespace
+
+/// Drop the annotations of the `portAnnotations` attribute of an instance or a
+/// memory, and return true if any was dropped.
+bool DropAnnotationsPass::dropPortAnnotations(Operation *op) {
+  auto portAnnos = op->getAttrOfType<ArrayAttr>("portAnnotations");
+  if (!portAnnos)
+    return false;
+
+  bool changed = false;
+  SmallVector<Attribute> newPortAnnos;
+  newPortAnnos.reserve(portAnnos.size());
+  for (auto attr : portAnnos) {
+    AnnotationSet annos(attr.cast<ArrayAttr>());
+    changed |= annos.removeAnnotations(
+        [&](Annotation anno) { return isDropped(anno); });
+    newPortAnnos.push_back(annos.getArrayAttr());
+  }
+  if (changed)
+    op->setAttr("portAnnotations",
+                ArrayAttr::get(op->getContext(), newPortAnnos));
+  return changed;
+}
+
+/// Drop the annotations of a module, of its ports and of the operations in it,
+/// and return true if any was dropped.
+bool DropAnnotationsPass::dropAnnotations(Operation *module) {
+  auto pred = [&](Annotation anno) { return isDropped(anno); };
+  bool changed = AnnotationSet::removePortAnnotations(
+      module, [&](unsigned, Annotation anno) { return isDropped(anno); });
+  module->walk([&](Operation *op) {
+    changed |= AnnotationSet::removeAnnotations(op, pred);
+    if (isa<InstanceOp, MemOp>(op))
+      changed |= dropPortAnnotations(op);
+  });
+  return changed;
+}
+
+void DropAnnotationsPass::runOnOperation() {
+  auto circuit = getOperation();
+  for (auto &className : keep)
+    keepSet.insert(className);
+
+  bool anythingChanged = AnnotationSet::removeAnnotations(
+      circuit, [&](Annotation anno) { return isDropped(anno); });
+
+  // Each module only changes its own annotations, so they are dropped in
+  // parallel.
+  SmallVector<Operation *> modules;
+  for (auto &op : *circuit.getBody())
+    if (isa<FModuleOp, FExtModuleOp>(op))
+      modules.push_back(&op);
+  std::atomic<bool> modulesChanged(false);
+  mlir::parallelForEach(&getContext(), modules, [&](Operation *module) {
+    if (dropAnnotations(module))
+      modulesChanged = true;
+  });
+  anythingChanged |= modulesChanged;
+
+  keepSet.clear();
+
+  // If we did not change anything in the circuit mark all analysis as
+  // preserved.
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<mlir::Pass>
+circt::firrtl::createDropAnnotationsPass(ArrayRef<std::string> keep) {
+  return std::make_unique<DropAnnotationsPass>(keep);
+}
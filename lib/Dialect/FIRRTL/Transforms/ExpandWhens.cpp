@@ -26,6 +26,51 @@ using namespace firrtl;
 /// a value to it.
 using ScopeMap = llvm::MapVector<FieldRef, Operation *>;
 
+namespace {
+/// A pool of scope maps, which allows the storage of the maps to be reused
+/// across the scopes of a module and across the modules a pass instance
+/// processes. Every thread runs its own instance of the pass, so the pool does
+/// not need to be synchronized.
+class ScopeMapPool {
+public:
+  /// Get an empty scope map from the pool, or a new one if the pool is empty.
+  ScopeMap *acquire() {
+    if (freeMaps.empty())
+      return new ScopeMap();
+    return freeMaps.pop_back_val();
+  }
+
+  /// Return a scope map to the pool. The map is cleared, but keeps its storage.
+  void release(ScopeMap *scope) {
+    scope->clear();
+    freeMaps.push_back(scope);
+  }
+
+  ScopeMapPool() = default;
+  ScopeMapPool(const ScopeMapPool &) = delete;
+  ScopeMapPool &operator=(const ScopeMapPool &) = delete;
+  ~ScopeMapPool() {
+    for (auto *scope : freeMaps)
+      delete scope;
+  }
+
+private:
+  SmallVector<ScopeMap *, 4> freeMaps;
+};
+
+/// A scope map borrowed from a pool for the lifetime of this object.
+class PooledScopeMap {
+public:
+  PooledScopeMap(ScopeMapPool &pool) : pool(pool), scope(pool.acquire()) {}
+  ~PooledScopeMap() { pool.release(scope); }
+  ScopeMap &operator*() { return *scope; }
+
+private:
+  ScopeMapPool &pool;
+  ScopeMap *scope;
+};
+} // namespace
+
 /// Move all operations from a source block in to a destination block. Leaves
 /// the source block empty.
 static void mergeBlock(Block &destination, Block::iterator insertPoint,
@@ -51,8 +96,12 @@ protected:
   /// for retrieving the responsible connect operation.
   ScopeMap &scope;
 
+  /// The pool from which the scope maps of nested when blocks are drawn.
+  ScopeMapPool &pool;
+
 public:
-  LastConnectResolver(ScopeMap &scope) : scope(scope) {}
+  LastConnectResolver(ScopeMap &scope, ScopeMapPool &pool)
+      : scope(scope), pool(pool) {}
 
   using FIRRTLVisitor<ConcreteT>::visitExpr;
   using FIRRTLVisitor<ConcreteT>::visitDecl;
@@ -293,8 +342,8 @@ namespace {
 class WhenOpVisitor : public LastConnectResolver<WhenOpVisitor> {
 
 public:
-  WhenOpVisitor(ScopeMap &scope, Value condition)
-      : LastConnectResolver<WhenOpVisitor>(scope), condition(condition) {}
+  WhenOpVisitor(ScopeMap &scope, ScopeMapPool &pool, Value condition)
+      : LastConnectResolver<WhenOpVisitor>(scope, pool), condition(condition) {}
 
   using LastConnectResolver<WhenOpVisitor>::visitExpr;
   using LastConnectResolver<WhenOpVisitor>::visitDecl;
@@ -364,24 +413,24 @@ void WhenOpVisitor::visitStmt(WhenOp whenOp) {
   // returns the set of connects in each side of the when op.
 
   // Process the `then` block.
-  ScopeMap thenScope;
+  PooledScopeMap thenScope(pool);
   auto thenCondition = andWithCondition(whenOp, condition);
   auto &thenBlock = whenOp.getThenBlock();
-  WhenOpVisitor(thenScope, thenCondition).process(thenBlock);
+  WhenOpVisitor(*thenScope, pool, thenCondition).process(thenBlock);
   mergeBlock(*parentBlock, Block::iterator(whenOp), thenBlock);
 
   // Process the `else` block.
-  ScopeMap elseScope;
+  PooledScopeMap elseScope(pool);
   if (whenOp.hasElseRegion()) {
     auto notOp = b.createOrFold<NotPrimOp>(whenOp.getLoc(), condition.getType(),
                                            condition);
     Value elseCondition = andWithCondition(whenOp, notOp);
     auto &elseBlock = whenOp.getElseBlock();
-    WhenOpVisitor(elseScope, elseCondition).process(elseBlock);
+    WhenOpVisitor(*elseScope, pool, elseCondition).process(elseBlock);
     mergeBlock(*parentBlock, Block::iterator(whenOp), elseBlock);
   }
 
-  mergeScopes(thenScope, elseScope, condition);
+  mergeScopes(*thenScope, *elseScope, condition);
 
   // Delete the now empty WhenOp.
   whenOp.erase();
@@ -394,7 +443,10 @@ void WhenOpVisitor::visitStmt(WhenOp whenOp) {
 namespace {
 class ModuleVisitor : public LastConnectResolver<ModuleVisitor> {
 public:
-  ModuleVisitor() : LastConnectResolver<ModuleVisitor>(outerScope) {}
+  /// Create a visitor which uses `outerScope` as the outermost scope of the
+  /// module body.
+  ModuleVisitor(ScopeMap &outerScope, ScopeMapPool &pool)
+      : LastConnectResolver<ModuleVisitor>(outerScope, pool) {}
 
   // Unshadow the overloads.
   using LastConnectResolver<ModuleVisitor>::visitExpr;
@@ -411,9 +463,6 @@ public:
   mlir::FailureOr<bool> run(FModuleOp op);
 
 private:
-  /// The outermost scope of the module body.
-  ScopeMap outerScope;
-
   /// Tracks if anything in the IR has changed.
   bool anythingChanged = false;
 };
@@ -428,13 +477,22 @@ mlir::FailureOr<bool> ModuleVisitor::run(FModuleOp module) {
     declareSinks(it.value(), flow);
   }
 
-  // Process the body of the module.
-  for (auto &op : llvm::make_early_inc_range(*module.getBodyBlock())) {
-    dispatchVisitor(&op);
+  // Process the body of the module. In a module without any when blocks, only
+  // the declarations and connects are relevant, and all other operations can
+  // be skipped without dispatching them through the visitor.
+  auto *body = module.getBodyBlock();
+  if (body->getOps<WhenOp>().empty()) {
+    for (auto &op : llvm::make_early_inc_range(*body))
+      if (isa<ConnectOp, PartialConnectOp, WireOp, RegOp, RegResetOp,
+              InstanceOp, MemOp>(op))
+        dispatchVisitor(&op);
+  } else {
+    for (auto &op : llvm::make_early_inc_range(*body))
+      dispatchVisitor(&op);
   }
 
   // Check for any incomplete initialization.
-  for (auto destAndConnect : outerScope) {
+  for (auto destAndConnect : scope) {
     // If there is valid connection to this destination, everything is good.
     auto *connect = std::get<1>(destAndConnect);
     if (connect)
@@ -461,23 +519,23 @@ void ModuleVisitor::visitStmt(WhenOp whenOp) {
   // the set of connects in each side of the when op.
 
   // Process the `then` block.
-  ScopeMap thenScope;
+  PooledScopeMap thenScope(pool);
   auto &thenBlock = whenOp.getThenBlock();
-  WhenOpVisitor(thenScope, condition).process(thenBlock);
+  WhenOpVisitor(*thenScope, pool, condition).process(thenBlock);
   mergeBlock(*parentBlock, Block::iterator(whenOp), thenBlock);
 
   // Process the `else` block.
-  ScopeMap elseScope;
+  PooledScopeMap elseScope(pool);
   if (whenOp.hasElseRegion()) {
     OpBuilder b(whenOp);
     auto notCondition = b.createOrFold<NotPrimOp>(
         whenOp.getLoc(), condition.getType(), condition);
     auto &elseBlock = whenOp.getElseBlock();
-    WhenOpVisitor(elseScope, notCondition).process(elseBlock);
+    WhenOpVisitor(*elseScope, pool, notCondition).process(elseBlock);
     mergeBlock(*parentBlock, Block::iterator(whenOp), elseBlock);
   }
 
-  mergeScopes(thenScope, elseScope, condition);
+  mergeScopes(*thenScope, *elseScope, condition);
 
   // If we are deleting a WhenOp something definitely changed.
   anythingChanged = true;
@@ -491,13 +549,24 @@ void ModuleVisitor::visitStmt(WhenOp whenOp) {
 //===----------------------------------------------------------------------===//
 
 class ExpandWhensPass : public ExpandWhensBase<ExpandWhensPass> {
+public:
+  ExpandWhensPass() = default;
+  // Copies start out with an empty pool of scope maps.
+  ExpandWhensPass(const ExpandWhensPass &other) : ExpandWhensBase(other) {}
+
+private:
   void runOnOperation() override;
+
+  /// The scope maps reused across the modules processed by this instance.
+  ScopeMapPool scopeMapPool;
 };
 
 void ExpandWhensPass::runOnOperation() {
   // Pass returns failure if something went wrong, or a bool indicating whether
   // something changed.
-  auto failureOrChanged = ModuleVisitor().run(getOperation());
+  PooledScopeMap outerScope(scopeMapPool);
+  auto failureOrChanged =
+      ModuleVisitor(*outerScope, scopeMapPool).run(getOperation());
   if (failed(failureOrChanged)) {
     signalPassFailure();
   } else if (!*failureOrChanged) {
@@ -0,0 +1,115 @@
+//===- Fold.cpp - Fold FIRRTL expressions -----------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the Fold pass, which applies the folders of the FIRRTL
+// expressions of a module in a few sweeps over the operations, without the
+// pattern rewrite driver.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/FIRRTL/Passes.h"
+#include "mlir/Transforms/FoldUtils.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "firrtl-fold"
+
+using namespace circt;
+using namespace firrtl;
+
+/// The maximum number of sweeps over a module.  This matches the iteration
+/// limit of the greedy pattern rewrite driver.
+static constexpr unsigned maxSweeps = 10;
+
+/// Return true if the specified operation is a FIRRTL expression.  Expressions
+/// are the operations of the dialect without regions or side effects, which
+/// leaves out the declarations and statements.
+static bool isExpression(Operation *op) {
+  auto *dialect = op->getDialect();
+  return dialect &&
+         dialect->getNamespace() == FIRRTLDialect::getDialectNamespace() &&
+         op->getNumRegions() == 0 &&
+         mlir::MemoryEffectOpInterface::hasNoEffect(op);
+}
+
+namespace {
+struct FoldPass : public FoldBase<FoldPass> {
+  void runOnOperation() override;
+
+private:
+  bool sweep(OperationFolder &folder);
+};
+} // end anonymous namespace
+
+/// Fold all the expressions of the module once, in order, and erase the ones
+/// left unused.  Return true if anything changed.
+bool FoldPass::sweep(OperationFolder &folder) {
+  // A post-order walk visits the operands of an expression before the
+  // expression itself.  The folder hoists the constants it creates to the
+  // start of the module, so they don't need to be visited.
+  std::vector<Operation *> ops;
+  getOperation().walk([&](Operation *op) {
+    if (isExpression(op))
+      ops.push_back(op);
+  });
+
+  DenseSet<Operation *> erasedOps;
+  auto preReplaceAction = [&](Operation *op) { erasedOps.insert(op); };
+  bool changed = false;
+  for (auto *op : ops) {
+    if (erasedOps.count(op))
+      continue;
+    if (isOpTriviallyDead(op)) {
+      folder.notifyRemoval(op);
+      erasedOps.insert(op);
+      op->erase();
+      changed = true;
+      continue;
+    }
+    if (succeeded(folder.tryToFold(op, /*processGeneratedConstants=*/nullptr,
+                                   preReplaceAction)))
+      changed = true;
+  }
+
+  // Folding leaves the operands of the folded expressions unused after they
+  // were visited, delete them in reverse order so that whole dead expression
+  // trees are removed.
+  for (auto *op : llvm::reverse(ops)) {
+    if (erasedOps.count(op) || !isOpTriviallyDead(op))
+      continue;
+    folder.notifyRemoval(op);
+    erasedOps.insert(op);
+    op->erase();
+    changed = true;
+  }
+
+  return changed;
+}
+
+void FoldPass::runOnOperation() {
+  OperationFolder folder(&getContext());
+
+  bool anythingChanged = false;
+  unsigned numSweeps = 0;
+  while (numSweeps != maxSweeps && sweep(folder)) {
+    anythingChanged = true;
+    ++numSweeps;
+  }
+
+  LLVM_DEBUG(llvm::dbgs() << "Folded " << getOperation().getName() << " in "
+                          << numSweeps << " sweeps\n");
+
+  // If we did not change anything in the module mark all analysis as
+  // preserved.
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<mlir::Pass> circt::firrtl::createFoldPass() {
+  return std::make_unique<FoldPass>();
+}
@@ -13,6 +13,7 @@
 #include "PassDetails.h"
 #include "circt/Dialect/FIRRTL/FIRRTLAnnotations.h"
 #include "circt/Dialect/FIRRTL/FIRRTLVisitors.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
 #include "circt/Dialect/FIRRTL/Passes.h"
 #include "circt/Dialect/HW/HWDialect.h"
 #include "circt/Dialect/SV/SVOps.h"
@@ -181,14 +182,19 @@ private:
 
 class GrandCentralVisitor : public FIRRTLVisitor<GrandCentralVisitor> {
 public:
-  GrandCentralVisitor(GrandCentralPass::InterfaceMap &interfaceMap)
-      : interfaceMap(interfaceMap) {}
+  GrandCentralVisitor(GrandCentralPass::InterfaceMap &interfaceMap,
+                      InstanceGraph &instanceGraph)
+      : interfaceMap(interfaceMap), instanceGraph(instanceGraph) {}
 
 private:
   /// Mutable store tracking each element in an interface.  This is indexed by a
   /// "defName" -> "name" tuple.
   GrandCentralPass::InterfaceMap &interfaceMap;
 
+  /// The instance graph of the circuit, used to look up the modules referenced
+  /// by instances without a linear search through the circuit.
+  InstanceGraph &instanceGraph;
+
   /// Helper to handle wires, registers, and nodes.
   void handleRef(Operation *op);
 
@@ -335,29 +341,28 @@ void GrandCentralVisitor::handleRef(mlir::Operation *op) {
 /// Return argument attributes with annotations removed.
 void GrandCentralVisitor::handlePorts(Operation *op) {
 
-  SmallVector<Attribute> newArgAttrs;
+  PortAnnotationsBuilder portAnnos(op);
   auto ports = getModulePortInfo(op);
   for (size_t i = 0, e = ports.size(); i != e; ++i) {
     auto port = ports[i];
     handleRefLike(op, port.annotations, port.type);
-
-    newArgAttrs.push_back(port.annotations.applyToPortDictionaryAttr(
-        DictionaryAttr::get(op->getContext(), {})));
+    portAnnos.setPortAnnotations(i, port.annotations);
   }
 
-  mlir::function_like_impl::setAllArgAttrDicts(op, newArgAttrs);
+  portAnnos.applyToModule();
 }
 
 void GrandCentralVisitor::visitDecl(InstanceOp op) {
 
   // If this instance's underlying module has a "companion" annotation, then
   // move this onto the actual instance op.
-  AnnotationSet annotations(op.getReferencedModule());
+  auto *referencedModule = instanceGraph.getReferencedModule(op);
+  AnnotationSet annotations(referencedModule);
   if (auto anno = annotations.getAnnotation(
           "sifive.enterprise.grandcentral.ViewAnnotation")) {
     auto tpe = anno.getAs<StringAttr>("type");
     if (!tpe) {
-      op.getReferencedModule()->emitOpError(
+      referencedModule->emitOpError(
           "contains a ViewAnnotation that does not contain a \"type\" field");
       failed = true;
       return;
@@ -439,12 +444,13 @@ void GrandCentralPass::runOnOperation() {
   // signal pass failure.  Walk in reverse order so that annotations can be
   // removed from modules after all referring instances have consumed their
   // annotations.
+  auto &instanceGraph = getAnalysis<InstanceGraph>();
   for (auto &op : llvm::reverse(circuitOp.getBody()->getOperations())) {
     // Only process modules or external modules.
     if (!isa<FModuleOp, FExtModuleOp>(op))
       continue;
 
-    GrandCentralVisitor visitor(interfaceMap);
+    GrandCentralVisitor visitor(interfaceMap, instanceGraph);
     visitor.visitModule(&op);
     if (visitor.hasFailed())
       return signalPassFailure();
@@ -558,6 +564,10 @@ void GrandCentralPass::runOnOperation() {
   interfaces.clear();
   interfaceMap.clear();
   interfaceKeys.clear();
+
+  // No modules or instances were added or removed, so the instance graph can
+  // be reused by the Grand Central passes that follow.
+  markAnalysesPreserved<InstanceGraph>();
 }
 
 //===----------------------------------------------------------------------===//
@@ -19,6 +19,7 @@
 #include "circt/Dialect/FIRRTL/Passes.h"
 #include "circt/Dialect/SV/SVOps.h"
 #include "mlir/IR/ImplicitLocOpBuilder.h"
+#include "mlir/IR/Threading.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/TinyPtrVector.h"
@@ -71,9 +72,6 @@ static constexpr const char *internalKeyClass =
 // Utilities
 //===----------------------------------------------------------------------===//
 
-/// An absolute instance path.
-using InstancePath = ArrayRef<InstanceOp>;
-
 template <typename T>
 static T &operator<<(T &os, const InstancePath &path) {
   os << "$root";
@@ -106,27 +104,6 @@ struct TappedValue {
   Annotation anno;
 };
 
-/// A data structure that caches and provides absolute paths to module instances
-/// in the IR.
-struct InstancePaths {
-  /// The instance graph of the IR.
-  InstanceGraph &instanceGraph;
-
-  explicit InstancePaths(InstanceGraph &instanceGraph)
-      : instanceGraph(instanceGraph) {}
-  ArrayRef<InstancePath> getAbsolutePaths(Operation *op);
-
-private:
-  /// An allocator for individual instance paths and entire path lists.
-  llvm::BumpPtrAllocator allocator;
-
-  /// Cached absolute instance paths.
-  DenseMap<Operation *, ArrayRef<InstancePath>> absolutePathsCache;
-
-  /// Append an instance to a path.
-  InstancePath appendInstance(InstancePath path, InstanceOp inst);
-};
-
 /// Necessary information to wire up a port with tapped data or memory location.
 struct PortWiring {
   unsigned portNum;
@@ -134,52 +111,15 @@ struct PortWiring {
   SmallString<16> suffix;
 };
 
-} // namespace
-
-ArrayRef<InstancePath> InstancePaths::getAbsolutePaths(Operation *op) {
-  assert((isa<FModuleOp, FExtModuleOp>(op))); // extra parens makes parser smile
-
-  // If we have reached the circuit root, we're done.
-  if (op == instanceGraph.getTopLevelNode()->getModule()) {
-    static InstancePath empty{};
-    return empty; // array with single empty path
-  }
-
-  // Fast path: hit the cache.
-  auto cached = absolutePathsCache.find(op);
-  if (cached != absolutePathsCache.end())
-    return cached->second;
-
-  // For each instance, collect the instance paths to its parent and append the
-  // instance itself to each.
-  SmallVector<InstancePath, 8> extendedPaths;
-  for (auto inst : instanceGraph[op]->uses()) {
-    auto instPaths = getAbsolutePaths(inst->getParent()->getModule());
-    extendedPaths.reserve(instPaths.size());
-    for (auto path : instPaths) {
-      extendedPaths.push_back(appendInstance(path, inst->getInstance()));
-    }
-  }
-
-  // Move the list of paths into the bump allocator for later quick retrieval.
-  ArrayRef<InstancePath> pathList;
-  if (!extendedPaths.empty()) {
-    auto paths = allocator.Allocate<InstancePath>(extendedPaths.size());
-    std::copy(extendedPaths.begin(), extendedPaths.end(), paths);
-    pathList = ArrayRef<InstancePath>(paths, extendedPaths.size());
-  }
-
-  absolutePathsCache.insert({op, pathList});
-  return pathList;
-}
+/// An implementation module of a black box to be populated with the wiring of
+/// its ports, for the black box instance at the end of `path`.
+struct TapImpl {
+  FModuleOp impl;
+  InstancePath path;
+  ArrayRef<PortWiring> portWiring;
+};
 
-InstancePath InstancePaths::appendInstance(InstancePath path, InstanceOp inst) {
-  size_t n = path.size() + 1;
-  auto newPath = allocator.Allocate<InstanceOp>(n);
-  std::copy(path.begin(), path.end(), newPath);
-  newPath[path.size()] = inst;
-  return InstancePath(newPath, n);
-}
+} // namespace
 
 /// Return a version of `path` that skips all front instances it has in common
 /// with `other`.
@@ -201,6 +141,12 @@ struct Port : std::pair<Operation *, unsigned> {
   operator bool() const { return bool(first); }
 };
 
+/// The taps found in some part of the circuit.
+struct GatheredTaps {
+  SmallVector<std::pair<Key, Port>, 4> ports;
+  SmallVector<std::pair<Key, Operation *>, 4> ops;
+};
+
 // Allow printing of `Key` through `<<`.
 template <typename T>
 static T &operator<<(T &os, Key key) {
@@ -241,24 +187,37 @@ static Key getKey(Annotation anno) {
 
 class GrandCentralTapsPass : public GrandCentralTapsBase<GrandCentralTapsPass> {
   void runOnOperation() override;
-  void gatherAnnotations(Operation *op);
+  void gatherAnnotations(Operation *op, GatheredTaps &taps);
   void processAnnotation(AnnotatedPort &portAnno, AnnotatedExtModule &blackBox,
-                         InstancePaths &instancePaths);
+                         InstancePathCache &instancePaths,
+                         SmallVectorImpl<PortWiring> &portWiring);
+  void populateImpl(TapImpl &tapImpl);
 
   // Helpers to simplify collecting taps on the various things.
-  void gatherTap(Annotation anno, Port port) {
-    auto it = tappedPorts.insert({getKey(anno), port});
-    assert(it.second && "ambiguous tap annotation");
+  static void gatherTap(GatheredTaps &taps, Annotation anno, Port port) {
+    taps.ports.push_back({getKey(anno), port});
+  }
+  static void gatherTap(GatheredTaps &taps, Annotation anno, Operation *op) {
+    taps.ops.push_back({getKey(anno), op});
   }
-  void gatherTap(Annotation anno, Operation *op) {
-    auto it = tappedOps.insert({getKey(anno), op});
-    assert(it.second && "ambiguous tap annotation");
+
+  /// Add the taps gathered in some part of the circuit to the tap maps.
+  void addTaps(GatheredTaps &taps) {
+    for (auto &tap : taps.ports) {
+      auto it = tappedPorts.insert(tap);
+      assert(it.second && "ambiguous tap annotation");
+      (void)it;
+    }
+    for (auto &tap : taps.ops) {
+      auto it = tappedOps.insert(tap);
+      assert(it.second && "ambiguous tap annotation");
+      (void)it;
+    }
   }
 
   DenseMap<Key, Operation *> tappedOps;
   DenseMap<Key, Port> tappedPorts;
   SmallDenseMap<Attribute, unsigned, 2> memPortIdx;
-  SmallVector<PortWiring, 8> portWiring;
 };
 
 void GrandCentralTapsPass::runOnOperation() {
@@ -344,13 +303,25 @@ void GrandCentralTapsPass::runOnOperation() {
   }
 
   // Build a generator for absolute module and instance paths in the design.
-  InstancePaths instancePaths(getAnalysis<InstanceGraph>());
+  InstancePathCache instancePaths(getAnalysis<InstanceGraph>());
 
   // Gather the annotated ports and operations throughout the design that we are
-  // supposed to tap in one way or another.
+  // supposed to tap in one way or another.  The modules are scanned in
+  // parallel, then their taps are added to the tap maps in order.
   tappedPorts.clear();
   tappedOps.clear();
-  circuitOp.walk([&](Operation *op) { gatherAnnotations(op); });
+  SmallVector<Operation *> circuitOps;
+  for (auto &op : *circuitOp.getBody())
+    circuitOps.push_back(&op);
+  std::vector<GatheredTaps> gatheredTaps(circuitOps.size() + 1);
+  mlir::parallelForEachN(
+      &getContext(), 0, circuitOps.size(), [&](size_t index) {
+        circuitOps[index]->walk(
+            [&](Operation *op) { gatherAnnotations(op, gatheredTaps[index]); });
+      });
+  gatherAnnotations(circuitOp, gatheredTaps.back());
+  for (auto &taps : gatheredTaps)
+    addTaps(taps);
 
   LLVM_DEBUG({
     llvm::dbgs() << "Tapped ports:\n";
@@ -363,8 +334,14 @@ void GrandCentralTapsPass::runOnOperation() {
       llvm::dbgs() << "- " << it.first << ": " << *it.second << "\n";
   });
 
-  // Process each black box independently.
-  for (auto blackBox : modules) {
+  // Process each black box independently.  The implementation modules for
+  // all black box instances are created up front, and populated with the
+  // wiring of their ports in parallel below.
+  std::vector<SmallVector<PortWiring, 8>> blackBoxWiring(modules.size());
+  SmallVector<TapImpl, 8> tapImpls;
+  for (auto it : llvm::enumerate(modules)) {
+    auto &blackBox = it.value();
+    auto &portWiring = blackBoxWiring[it.index()];
     LLVM_DEBUG(llvm::dbgs() << "Generating impls for "
                             << blackBox.extModule.getName() << "\n");
 
@@ -378,10 +355,9 @@ void GrandCentralTapsPass::runOnOperation() {
 
     // Go through the port annotations of the tap module and generate a
     // hierarchical path for each.
-    portWiring.clear();
     portWiring.reserve(blackBox.portAnnos.size());
     for (auto portAnno : blackBox.portAnnos) {
-      processAnnotation(portAnno, blackBox, instancePaths);
+      processAnnotation(portAnno, blackBox, instancePaths, portWiring);
     }
 
     LLVM_DEBUG({
@@ -425,45 +401,7 @@ void GrandCentralTapsPass::runOnOperation() {
                  << blackBox.extModule.getName() << " for " << path << ")\n");
       auto impl =
           builder.create<FModuleOp>(name, ports, blackBox.filteredModuleAnnos);
-      builder.setInsertionPointToEnd(impl.getBodyBlock());
-
-      // Connect the output ports to the appropriate tapped object.
-      for (auto port : portWiring) {
-        LLVM_DEBUG(llvm::dbgs() << "- Wiring up port " << port.portNum << "\n");
-        // Determine the shortest hierarchical prefix from this black box
-        // instance to the tapped object.
-        Optional<InstancePath> shortestPrefix;
-        for (auto prefix : port.prefices) {
-          auto relative = stripCommonPrefix(prefix, path);
-          if (!shortestPrefix.hasValue() ||
-              relative.size() < shortestPrefix->size())
-            shortestPrefix = relative;
-        }
-        if (!shortestPrefix.hasValue()) {
-          LLVM_DEBUG(llvm::dbgs() << "  - Has no prefix, skipping\n");
-          continue;
-        }
-        LLVM_DEBUG(llvm::dbgs()
-                   << "  - Shortest prefix " << *shortestPrefix << "\n");
-
-        // Concatenate the prefix into a proper full hierarchical name.
-        SmallString<128> hname;
-        for (auto inst : shortestPrefix.getValue()) {
-          if (!hname.empty())
-            hname += '.';
-          hname += inst.name();
-        }
-        if (!hname.empty())
-          hname += '.';
-        hname += port.suffix;
-        LLVM_DEBUG(llvm::dbgs() << "  - Connecting as " << hname << "\n");
-
-        // Add a verbatim op that assigns this module port.
-        auto arg = impl.getArgument(port.portNum);
-        auto hnameExpr = builder.create<VerbatimExprOp>(
-            arg.getType().cast<FIRRTLType>(), hname);
-        builder.create<ConnectOp>(arg, hnameExpr);
-      }
+      tapImpls.push_back({impl, path, portWiring});
 
       // Switch the instance from the original extmodule to this
       // implementation. CAVEAT: If the same black box data tap module is
@@ -473,20 +411,68 @@ void GrandCentralTapsPass::runOnOperation() {
       path.back()->setAttr("moduleName",
                            builder.getSymbolRefAttr(name.getValue()));
     }
+  }
 
-    // Drop the original black box module.
+  // Connect the output ports of each implementation to the appropriate tapped
+  // object.  All the instance paths have been computed at this point, and each
+  // implementation only creates operations in its own body.
+  mlir::parallelForEachN(&getContext(), 0, tapImpls.size(), [&](size_t index) {
+    populateImpl(tapImpls[index]);
+  });
+
+  // Drop the original black box modules.
+  for (auto &blackBox : modules)
     blackBox.extModule.erase();
+}
+
+/// Connect the ports of a black box implementation to the tapped objects, as
+/// seen from the black box instance at the end of the implementation's path.
+void GrandCentralTapsPass::populateImpl(TapImpl &tapImpl) {
+  auto impl = tapImpl.impl;
+  auto path = tapImpl.path;
+  auto builder = ImplicitLocOpBuilder::atBlockEnd(impl.getLoc(),
+                                                  impl.getBodyBlock());
+
+  for (auto &port : tapImpl.portWiring) {
+    // Determine the shortest hierarchical prefix from this black box instance
+    // to the tapped object.
+    Optional<InstancePath> shortestPrefix;
+    for (auto prefix : port.prefices) {
+      auto relative = stripCommonPrefix(prefix, path);
+      if (!shortestPrefix.hasValue() ||
+          relative.size() < shortestPrefix->size())
+        shortestPrefix = relative;
+    }
+    if (!shortestPrefix.hasValue())
+      continue;
+
+    // Concatenate the prefix into a proper full hierarchical name.
+    SmallString<128> hname;
+    for (auto inst : shortestPrefix.getValue()) {
+      if (!hname.empty())
+        hname += '.';
+      hname += inst.name();
+    }
+    if (!hname.empty())
+      hname += '.';
+    hname += port.suffix;
+
+    // Add a verbatim op that assigns this module port.
+    auto arg = impl.getArgument(port.portNum);
+    auto hnameExpr = builder.create<VerbatimExprOp>(
+        arg.getType().cast<FIRRTLType>(), hname);
+    builder.create<ConnectOp>(arg, hnameExpr);
   }
 }
 
-/// Gather the annotations on ports and operations into the `tappedPorts` and
-/// `tappedOps` maps.
-void GrandCentralTapsPass::gatherAnnotations(Operation *op) {
+/// Gather the annotations on ports and operations into `taps`.
+void GrandCentralTapsPass::gatherAnnotations(Operation *op,
+                                             GatheredTaps &taps) {
   if (isa<FModuleOp, FExtModuleOp>(op)) {
     // Handle port annotations on module/extmodule ops.
     auto gather = [&](unsigned argNum, Annotation anno) {
       if (isReferenceDataTapSource(anno)) {
-        gatherTap(anno, Port{op, argNum});
+        gatherTap(taps, anno, Port{op, argNum});
         return true;
       }
       return false;
@@ -497,7 +483,7 @@ void GrandCentralTapsPass::gatherAnnotations(Operation *op) {
     if (isa<FExtModuleOp>(op)) {
       auto gather = [&](Annotation anno) {
         if (anno.isClass(internalKeyClass)) {
-          gatherTap(anno, op);
+          gatherTap(taps, anno, op);
           return true;
         }
         return false;
@@ -514,16 +500,16 @@ void GrandCentralTapsPass::gatherAnnotations(Operation *op) {
   // with the exact same annotation (hence the asserts).
   AnnotationSet::removeAnnotations(op, [&](Annotation anno) {
     if (anno.isClass(memTapClass) || isReferenceDataTapSource(anno)) {
-      gatherTap(anno, op);
+      gatherTap(taps, anno, op);
       return true;
     }
     return false;
   });
 }
 
-void GrandCentralTapsPass::processAnnotation(AnnotatedPort &portAnno,
-                                             AnnotatedExtModule &blackBox,
-                                             InstancePaths &instancePaths) {
+void GrandCentralTapsPass::processAnnotation(
+    AnnotatedPort &portAnno, AnnotatedExtModule &blackBox,
+    InstancePathCache &instancePaths, SmallVectorImpl<PortWiring> &portWiring) {
   LLVM_DEBUG(llvm::dbgs() << "- Processing port " << portAnno.portNum
                           << " anno " << portAnno.anno.getDict() << "\n");
   auto key = getKey(portAnno.anno);
@@ -161,7 +161,12 @@ private:
 
 namespace {
 struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
+  IMConstPropPass() = default;
+  IMConstPropPass(bool parallelPropagate) {
+    this->parallelPropagate = parallelPropagate;
+  }
   void runOnOperation() override;
+  void propagateInParallel();
   void rewriteModuleBody(FModuleOp module);
 
   /// Returns true if the given block is executable.
@@ -180,7 +185,7 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
     auto &entry = latticeValues[value];
     if (!entry.isOverdefined()) {
       entry.markOverdefined();
-      changedLatticeValueWorklist.push_back(value);
+      getChangedValueWorklist(value).push_back(value);
     }
   }
 
@@ -192,7 +197,7 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
     if (!source.isOverdefined() && AnnotationSet::get(value).hasDontTouch())
       source = LatticeValue::getOverdefined();
     if (valueEntry.mergeIn(source))
-      changedLatticeValueWorklist.push_back(value);
+      getChangedValueWorklist(value).push_back(value);
   }
   void mergeLatticeValue(Value value, LatticeValue source) {
     // Don't even do a map lookup if from has no info in it.
@@ -224,11 +229,25 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
     // If we've changed this value then revisit all the users.
     auto &valueEntry = latticeValues[value];
     if (valueEntry != source) {
-      changedLatticeValueWorklist.push_back(value);
+      getChangedValueWorklist(value).push_back(value);
       valueEntry = source;
     }
   }
 
+  /// Merge information into a value owned by a different module than the one
+  /// whose operation is being visited, e.g. an instance result driven by an
+  /// output port.  When propagating in parallel, the merge is queued on the
+  /// worklist of the visiting module and applied at the next synchronization
+  /// point, so a module never touches another module's lattice values.
+  void mergeCrossModuleLatticeValue(Value localValue, Value value,
+                                    LatticeValue source) {
+    if (!parallelPropagate)
+      return mergeLatticeValue(value, source);
+    if (source.isUnknown())
+      return;
+    getModuleWorklist(localValue).crossModuleMerges.push_back({value, source});
+  }
+
   /// Return the lattice value for the specified SSA value, extended to the
   /// width of the specified destType.  If allowTruncation is true, then this
   /// allows truncating the lattice value to the specified type.
@@ -252,6 +271,30 @@ struct IMConstPropPass : public IMConstPropBase<IMConstPropPass> {
   void visitOperation(Operation *op);
 
 private:
+  /// The per-module state used when propagating in parallel.
+  struct ModuleWorklist {
+    /// Values of this module whose LatticeValue recently changed.
+    SmallVector<Value, 16> changedValues;
+
+    /// Merges into values of other modules, applied at synchronization points.
+    SmallVector<std::pair<Value, LatticeValue>, 4> crossModuleMerges;
+  };
+
+  /// Return the worklist of the module owning the specified value.  Only valid
+  /// when propagating in parallel.
+  ModuleWorklist &getModuleWorklist(Value value) {
+    auto it = moduleWorklistIndices.find(value.getParentBlock());
+    assert(it != moduleWorklistIndices.end() && "value not in a live module");
+    return moduleWorklists[it->second];
+  }
+
+  /// Return the worklist that changes to the specified value are recorded on.
+  SmallVectorImpl<Value> &getChangedValueWorklist(Value value) {
+    if (!parallelPropagate)
+      return changedLatticeValueWorklist;
+    return getModuleWorklist(value).changedValues;
+  }
+
   /// This is the current instance graph for the Circuit.
   InstanceGraph *instanceGraph = nullptr;
 
@@ -272,6 +315,12 @@ private:
   /// ports.
   DenseMap<BlockArgument, llvm::TinyPtrVector<Value>>
       resultPortToInstanceResultMapping;
+
+  /// The worklists of the executable modules, in the order they were found,
+  /// and the index of each one keyed by the module body block.  These are
+  /// only populated when propagating in parallel.
+  SmallVector<ModuleWorklist, 8> moduleWorklists;
+  DenseMap<Block *, unsigned> moduleWorklistIndices;
 };
 } // end anonymous namespace
 
@@ -299,11 +348,15 @@ void IMConstPropPass::runOnOperation() {
   }
 
   // If a value changed lattice state then reprocess any of its users.
-  while (!changedLatticeValueWorklist.empty()) {
-    Value changedVal = changedLatticeValueWorklist.pop_back_val();
-    for (Operation *user : changedVal.getUsers()) {
-      if (isBlockExecutable(user->getBlock()))
-        visitOperation(user);
+  if (parallelPropagate) {
+    propagateInParallel();
+  } else {
+    while (!changedLatticeValueWorklist.empty()) {
+      Value changedVal = changedLatticeValueWorklist.pop_back_val();
+      for (Operation *user : changedVal.getUsers()) {
+        if (isBlockExecutable(user->getBlock()))
+          visitOperation(user);
+      }
     }
   }
 
@@ -317,6 +370,59 @@ void IMConstPropPass::runOnOperation() {
   latticeValues.clear();
   executableBlocks.clear();
   resultPortToInstanceResultMapping.clear();
+  moduleWorklists.clear();
+  moduleWorklistIndices.clear();
+}
+
+/// Run the lattice propagation with one worklist per module, draining the
+/// worklists of all modules with pending work in parallel.  The values of a
+/// module and its instance results are only updated by the thread processing
+/// that module; merges into the ports of instantiated modules and into the
+/// instance results of parent modules are queued, and applied serially once
+/// every module has converged locally.  This repeats until no module has any
+/// pending work.
+void IMConstPropPass::propagateInParallel() {
+  // Create a lattice entry for every value in the live modules up front, so
+  // that the lattice map is never modified while modules run concurrently.
+  for (auto &entry : moduleWorklistIndices) {
+    Block *body = entry.first;
+    for (auto arg : body->getArguments())
+      latticeValues.try_emplace(arg);
+    for (auto &op : *body)
+      for (auto result : op.getResults())
+        latticeValues.try_emplace(result);
+  }
+
+  auto *context = getOperation().getContext();
+  SmallVector<ModuleWorklist *, 8> pendingWorklists;
+  while (true) {
+    pendingWorklists.clear();
+    for (auto &worklist : moduleWorklists)
+      if (!worklist.changedValues.empty())
+        pendingWorklists.push_back(&worklist);
+    if (pendingWorklists.empty())
+      break;
+
+    mlir::parallelForEach(
+        context, pendingWorklists, [&](ModuleWorklist *worklist) {
+          auto &changedValues = worklist->changedValues;
+          while (!changedValues.empty()) {
+            Value changedVal = changedValues.pop_back_val();
+            for (Operation *user : changedVal.getUsers()) {
+              if (isBlockExecutable(user->getBlock()))
+                visitOperation(user);
+            }
+          }
+        });
+
+    // Apply the queued cross-module merges in a deterministic order.  This
+    // populates the worklists for the next round.
+    for (auto &worklist : moduleWorklists) {
+      for (auto &merge : worklist.crossModuleMerges)
+        mergeLatticeValue(merge.first, merge.second);
+      worklist.crossModuleMerges.clear();
+    }
+  }
 }
 
 /// Return the lattice value for the specified SSA value, extended to the width
@@ -366,6 +472,11 @@ void IMConstPropPass::markBlockExecutable(Block *block) {
   if (!executableBlocks.insert(block).second)
     return; // Already executable.
 
+  if (parallelPropagate) {
+    moduleWorklistIndices.insert({block, moduleWorklists.size()});
+    moduleWorklists.emplace_back();
+  }
+
   for (auto &op : *block) {
 
     // Handle each of the special operations in the firrtl dialect.
@@ -502,9 +613,11 @@ void IMConstPropPass::visitConnect(ConnectOp connect) {
   // Driving result ports propagates the value to each instance using the
   // module.
   if (auto blockArg = connect.dest().dyn_cast<BlockArgument>()) {
-    if (!AnnotationSet::get(blockArg).hasDontTouch())
-      for (auto userOfResultPort : resultPortToInstanceResultMapping[blockArg])
-        mergeLatticeValue(userOfResultPort, srcValue);
+    auto it = resultPortToInstanceResultMapping.find(blockArg);
+    if (it != resultPortToInstanceResultMapping.end() &&
+        !AnnotationSet::get(blockArg).hasDontTouch())
+      for (auto userOfResultPort : it->second)
+        mergeCrossModuleLatticeValue(blockArg, userOfResultPort, srcValue);
     // Output ports are wire-like and may have users.
     mergeLatticeValue(connect.dest(), srcValue);
     return;
@@ -529,7 +642,7 @@ void IMConstPropPass::visitConnect(ConnectOp connect) {
 
     BlockArgument modulePortVal =
         module.getPortArgument(dest.getResultNumber());
-    return mergeLatticeValue(modulePortVal, srcValue);
+    return mergeCrossModuleLatticeValue(dest, modulePortVal, srcValue);
   }
 
   // Driving a memory result is ignored because these are always treated as
@@ -724,6 +837,7 @@ void IMConstPropPass::rewriteModuleBody(FModuleOp module) {
   }
 }
 
-std::unique_ptr<mlir::Pass> circt::firrtl::createIMConstPropPass() {
-  return std::make_unique<IMConstPropPass>();
+std::unique_ptr<mlir::Pass>
+circt::firrtl::createIMConstPropPass(bool parallelPropagate) {
+  return std::make_unique<IMConstPropPass>(parallelPropagate);
 }
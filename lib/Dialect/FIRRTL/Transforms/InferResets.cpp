@@ -18,6 +18,7 @@
 #include "circt/Support/FieldRef.h"
 #include "mlir/IR/ImplicitLocOpBuilder.h"
 #include "llvm/ADT/EquivalenceClasses.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/TinyPtrVector.h"
 #include "llvm/ADT/TypeSwitch.h"
@@ -431,6 +432,7 @@ struct InferResetsPass : public InferResetsBase<InferResetsPass> {
   void buildDomains(FModuleOp module, const InstancePath &instPath,
                     Value parentReset, InstanceGraph &instGraph,
                     unsigned indent = 0);
+  void buildDomainsFromSummaries(FModuleOp top, InstanceGraph &instGraph);
 
   void determineImpl();
   void determineImpl(FModuleOp module, ResetDomain &domain);
@@ -478,6 +480,11 @@ struct InferResetsPass : public InferResetsBase<InferResetsPass> {
   /// the vector for a module contains multiple elements.
   MapVector<FModuleOp, SmallVector<std::pair<ResetDomain, InstancePath>, 1>>
       domains;
+
+  /// The instance graph of the circuit, used to resolve instances to the
+  /// modules they instantiate without going through the circuit's symbol
+  /// table.
+  InstanceGraph *instanceGraph = nullptr;
 };
 } // namespace
 
@@ -487,9 +494,12 @@ void InferResetsPass::runOnOperation() {
   resetDrives.clear();
   annotatedResets.clear();
   domains.clear();
+  instanceGraph = nullptr;
 }
 
 void InferResetsPass::runOnOperationInner() {
+  instanceGraph = &getAnalysis<InstanceGraph>();
+
   // Trace the uninferred reset networks throughout the design.
   traceResets(getOperation());
 
@@ -635,7 +645,7 @@ void InferResetsPass::traceResets(CircuitOp circuit) {
 /// instance's port values with the target module's port values.
 void InferResetsPass::traceResets(InstanceOp inst) {
   // Lookup the referenced module. Nothing to do if its an extmodule.
-  auto module = dyn_cast<FModuleOp>(inst.getReferencedModule());
+  auto module = dyn_cast<FModuleOp>(instanceGraph->getReferencedModule(inst));
   if (!module)
     return;
   LLVM_DEBUG(llvm::dbgs() << "Visiting instance " << inst.name() << "\n");
@@ -863,8 +873,8 @@ LogicalResult InferResetsPass::updateReset(ResetNetwork net, ResetKind kind) {
       if (auto blockArg = value.dyn_cast<BlockArgument>())
         moduleWorklist.insert(blockArg.getOwner()->getParentOp());
       if (auto instOp = value.getDefiningOp<InstanceOp>())
-        if (auto extmodule =
-                dyn_cast<FExtModuleOp>(instOp.getReferencedModule()))
+        if (auto extmodule = dyn_cast<FExtModuleOp>(
+                instanceGraph->getReferencedModule(instOp)))
           extmoduleWorklist.insert({extmodule, instOp});
     }
   }
@@ -1139,14 +1149,17 @@ LogicalResult InferResetsPass::buildDomains(CircuitOp circuit) {
       llvm::dbgs() << "\n===----- Build async reset domains -----===\n\n");
 
   // Gather the domains.
-  auto instGraph = getAnalysis<InstanceGraph>();
+  auto &instGraph = *instanceGraph;
   auto module = dyn_cast<FModuleOp>(instGraph.getTopLevelNode()->getModule());
   if (!module) {
     LLVM_DEBUG(llvm::dbgs()
                << "Skipping circuit because main module is no `firrtl.module`");
     return success();
   }
-  buildDomains(module, InstancePath{}, Value{}, instGraph);
+  if (summarizeModules)
+    buildDomainsFromSummaries(module, instGraph);
+  else
+    buildDomains(module, InstancePath{}, Value{}, instGraph);
 
   // Report any domain conflicts among the modules.
   bool anyFailed = false;
@@ -1236,6 +1249,55 @@ void InferResetsPass::buildDomains(FModuleOp module,
   }
 }
 
+/// Gather the reset domains of the modules in the design, visiting each module
+/// only once instead of once for every instance path leading to it. Modules are
+/// visited in topological order, such that all domains a module may inherit
+/// from its parents are known before the module itself is visited. The domains
+/// found are the same as with `buildDomains`, but each domain conflict is
+/// reported with the first instance path found for it in this order.
+void InferResetsPass::buildDomainsFromSummaries(FModuleOp top,
+                                                InstanceGraph &instGraph) {
+  auto addDomain = [&](FModuleOp module, Value parentReset,
+                       const InstancePath &instPath) {
+    ResetDomain domain(parentReset);
+    auto it = annotatedResets.find(module);
+    if (it != annotatedResets.end()) {
+      domain.isTop = true;
+      domain.reset = it->second;
+    }
+    auto &entries = domains[module];
+    if (llvm::all_of(entries,
+                     [&](const auto &entry) { return entry.first != domain; }))
+      entries.push_back({domain, instPath});
+  };
+  addDomain(top, Value{}, InstancePath{});
+
+  std::vector<InstanceGraphNode *> order(
+      llvm::po_begin<InstanceGraph *>(&instGraph),
+      llvm::po_end<InstanceGraph *>(&instGraph));
+  for (auto *node : llvm::reverse(order)) {
+    auto module = dyn_cast<FModuleOp>(node->getModule());
+    if (!module)
+      continue;
+    LLVM_DEBUG(llvm::dbgs() << "Visiting " << module.getName() << "\n");
+
+    // The domains of this module are complete at this point. Hand each of them
+    // down to the instantiated modules. The entries are copied since adding
+    // domains to a child may grow the domains map.
+    auto entries = domains.lookup(module);
+    for (auto record : node->instances()) {
+      auto submodule = dyn_cast<FModuleOp>(record->getTarget()->getModule());
+      if (!submodule)
+        continue;
+      for (auto &entry : entries) {
+        InstancePath childPath = entry.second;
+        childPath.push_back(record->getInstance());
+        addDomain(submodule, entry.first.reset, childPath);
+      }
+    }
+  }
+}
+
 /// Determine how the reset for each module shall be implemented.
 void InferResetsPass::determineImpl() {
   LLVM_DEBUG(
@@ -1401,7 +1463,8 @@ void InferResetsPass::implementAsyncReset(Operation *op, FModuleOp module,
     // Lookup the reset domain of the instantiated module. If there is no reset
     // domain associated with that module, or the module is explicitly marked as
     // being in no domain, simply skip.
-    auto refModule = dyn_cast<FModuleOp>(instOp.getReferencedModule());
+    auto refModule =
+        dyn_cast<FModuleOp>(instanceGraph->getReferencedModule(instOp));
     if (!refModule)
       return;
     auto domainIt = domains.find(refModule);
@@ -16,15 +16,25 @@
 #include "circt/Dialect/FIRRTL/FIRRTLVisitors.h"
 #include "circt/Dialect/FIRRTL/Passes.h"
 #include "circt/Support/FieldRef.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Support/FileUtilities.h"
 #include "llvm/ADT/APSInt.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/EquivalenceClasses.h"
 #include "llvm/ADT/GraphTraits.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SCCIterator.h"
 #include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/ToolOutputFile.h"
+#include "llvm/Support/raw_sha1_ostream.h"
 
 #define DEBUG_TYPE "infer-widths"
 
@@ -608,7 +618,8 @@ public:
   }
 
   void dumpConstraints(llvm::raw_ostream &os);
-  LogicalResult solve();
+  LogicalResult solve(MLIRContext *parallelContext = nullptr,
+                      bool compact = false);
 
   using ContextInfo = DenseMap<Expr *, llvm::SmallSetVector<FieldRef, 1>>;
   const ContextInfo &getContextInfo() const { return info; }
@@ -656,6 +667,9 @@ private:
   ConstraintSolver &operator=(const ConstraintSolver &) = delete;
 
   bool emitUninferredWidthError(VarExpr *var);
+  void emitUnbreakableCycleError(VarExpr *var);
+  void solveInParallel(MLIRContext *context);
+  void solveCompact();
 
   LinIneq checkCycles(VarExpr *var, Expr *expr,
                       SmallPtrSetImpl<Expr *> &seenVars,
@@ -899,8 +913,12 @@ static ExprSolution solveExpr(Expr *expr, SmallPtrSetImpl<Expr *> &seenVars,
 
 /// Solve the constraint problem. This is a very simple implementation that
 /// does not fully solve the problem if there are weird dependency cycles
-/// present.
-LogicalResult ConstraintSolver::solve() {
+/// present. If `parallelContext` is non-null, independent parts of the
+/// constraint graph are checked and solved concurrently on the context's
+/// thread pool. Otherwise, if `compact` is set, the constraints are solved on a
+/// compact copy of the expressions.
+LogicalResult ConstraintSolver::solve(MLIRContext *parallelContext,
+                                      bool compact) {
   LLVM_DEBUG({
     llvm::dbgs() << "\n===----- Constraints -----===\n\n";
     dumpConstraints(llvm::dbgs());
@@ -912,6 +930,43 @@ LogicalResult ConstraintSolver::solve() {
   SmallPtrSet<Expr *, 16> seenVars;
   bool anyFailed = false;
 
+  // The cycle check does not modify the expressions, which allows all
+  // variables to be checked concurrently. Only the unsatisfiable ones are
+  // revisited afterwards to report them in a deterministic order.
+  if (parallelContext) {
+    std::vector<VarExpr *> vars;
+    for (auto *expr : exprs)
+      if (auto *var = dyn_cast<VarExpr>(expr))
+        if (var->constraint)
+          vars.push_back(var);
+    std::vector<char> unbreakable(vars.size(), false);
+    mlir::parallelForEachN(parallelContext, 0, vars.size(), [&](size_t i) {
+      SmallPtrSet<Expr *, 16> threadSeenVars;
+      threadSeenVars.insert(vars[i]);
+      auto ineq = checkCycles(vars[i], vars[i]->constraint, threadSeenVars);
+      unbreakable[i] = !ineq.sat();
+    });
+    for (size_t i = 0, e = vars.size(); i != e; ++i) {
+      if (!unbreakable[i])
+        continue;
+      anyFailed = true;
+      emitUnbreakableCycleError(vars[i]);
+    }
+    if (anyFailed)
+      return failure();
+
+    LLVM_DEBUG(llvm::dbgs() << "\n===----- Solving constraints -----===\n\n");
+    solveInParallel(parallelContext);
+
+    // Complain about variables that are unconstrained or could not be solved,
+    // in the order in which they were created.
+    for (auto *expr : exprs)
+      if (auto *var = dyn_cast<VarExpr>(expr))
+        if (!var->solution && emitUninferredWidthError(var))
+          anyFailed = true;
+    return failure(anyFailed);
+  }
+
   for (auto *expr : exprs) {
     // Only work on variables.
     auto *var = dyn_cast<VarExpr>(expr);
@@ -945,20 +1000,7 @@ LogicalResult ConstraintSolver::solve() {
     LLVM_DEBUG(llvm::dbgs()
                << "  = UNBREAKABLE since " << ineq << " unsatisfiable\n");
     anyFailed = true;
-    for (auto fieldRef : info.find(var)->second) {
-      // Depending on whether this value stems from an operation or not, create
-      // an appropriate diagnostic identifying the value.
-      auto op = fieldRef.getDefiningOp();
-      auto diag = op ? op->emitOpError()
-                     : mlir::emitError(fieldRef.getValue().getLoc())
-                           << "value ";
-      diag << "is constrained to be wider than itself";
-
-      // Re-run the cycle checking, but this time reporting into the diagnostic.
-      seenVars.insert(var);
-      checkCycles(var, var->constraint, seenVars, &diag);
-      seenVars.clear();
-    }
+    emitUnbreakableCycleError(var);
   }
 
   // If there were cycles, return now to avoid complaining to the user about
@@ -966,6 +1008,16 @@ LogicalResult ConstraintSolver::solve() {
   if (anyFailed)
     return failure();
 
+  if (compact) {
+    LLVM_DEBUG(llvm::dbgs() << "\n===----- Solving constraints -----===\n\n");
+    solveCompact();
+    for (auto *expr : exprs)
+      if (auto *var = dyn_cast<VarExpr>(expr))
+        if (!var->solution && emitUninferredWidthError(var))
+          anyFailed = true;
+    return failure(anyFailed);
+  }
+
   // Iterate over the constraint variables and solve each.
   LLVM_DEBUG(llvm::dbgs() << "\n===----- Solving constraints -----===\n\n");
   for (auto *expr : exprs) {
@@ -1010,6 +1062,221 @@ LogicalResult ConstraintSolver::solve() {
   return failure(anyFailed);
 }
 
+/// Solve the constraint problem by condensing the expression graph into its
+/// strongly-connected components. The components are grouped into levels such
+/// that each component only depends on components in lower levels. Since the
+/// components in a level are independent of each other, they are solved
+/// concurrently, one level after the other.
+void ConstraintSolver::solveInParallel(MLIRContext *context) {
+  // The SCC iterator visits the components in post-order, i.e. after all the
+  // components they depend on. This allows the level of each component to be
+  // determined in the same sweep.
+  std::vector<Expr *> sccExprs;
+  std::vector<size_t> sccStarts;
+  std::vector<unsigned> sccLevels;
+  std::vector<std::vector<unsigned>> levels;
+  DenseMap<Expr *, unsigned> sccIndices;
+  for (auto it = llvm::scc_begin(static_cast<Expr *>(&root)); !it.isAtEnd();
+       ++it) {
+    unsigned index = sccLevels.size();
+    for (auto *expr : *it)
+      sccIndices.insert({expr, index});
+    unsigned level = 0;
+    for (auto *expr : *it) {
+      for (auto *operand : llvm::make_range(expr->begin(), expr->end())) {
+        unsigned operandIndex = sccIndices.lookup(operand);
+        if (operandIndex != index)
+          level = std::max(level, sccLevels[operandIndex] + 1);
+      }
+    }
+    sccLevels.push_back(level);
+    if (levels.size() <= level)
+      levels.resize(level + 1);
+    levels[level].push_back(index);
+
+    // Known expressions are trivially solved and the root does not need a
+    // solution, so there is no need to keep track of them.
+    sccStarts.push_back(sccExprs.size());
+    for (auto *expr : *it)
+      if (!isa<KnownExpr, RootExpr>(expr))
+        sccExprs.push_back(expr);
+  }
+  sccStarts.push_back(sccExprs.size());
+  LLVM_DEBUG(llvm::dbgs() << "- Found " << sccLevels.size()
+                          << " components in " << levels.size()
+                          << " levels\n");
+
+  auto solveComponent = [&](unsigned index) {
+    auto component = ArrayRef<Expr *>(sccExprs).slice(
+        sccStarts[index], sccStarts[index + 1] - sccStarts[index]);
+    SmallPtrSet<Expr *, 16> seenVars;
+    for (auto *expr : component) {
+      auto *var = dyn_cast<VarExpr>(expr);
+      if (!var || !var->constraint)
+        continue;
+      seenVars.insert(var);
+      auto solution = solveExpr(var->constraint, seenVars);
+      seenVars.clear();
+      if (solution.first && *solution.first < 0)
+        solution.first = 0;
+      var->solution = solution.first;
+    }
+
+    // Memoize the remaining expressions in the component now that all of its
+    // variables are known. Components in higher levels only ever read these
+    // solutions, which keeps the concurrently solved components from writing
+    // to shared expressions.
+    for (auto *expr : component)
+      if (!isa<VarExpr>(expr) && !expr->solution)
+        solveExpr(expr, seenVars);
+  };
+  for (auto &level : levels)
+    mlir::parallelForEach(context, level.begin(), level.end(), solveComponent);
+}
+
+/// The operand index used for absent operands in `CompactExprs`.
+static constexpr uint32_t noOperand = ~0u;
+
+namespace {
+/// A compact copy of the constraint expressions, where every expression is
+/// identified by its index in the solver's expression list and its opcode,
+/// operands, and solution are stored in separate dense arrays. Solving on this
+/// representation walks contiguous arrays instead of chasing the pointers
+/// between the individually allocated `Expr` nodes.
+struct CompactExprs {
+  explicit CompactExprs(ArrayRef<Expr *> exprs);
+  ExprSolution solve(uint32_t index);
+
+  std::vector<uint8_t> kinds;
+  std::vector<uint32_t> lhs;
+  std::vector<uint32_t> rhs;
+  std::vector<int32_t> solutions;
+  /// Which entries of `solutions` are valid.
+  llvm::BitVector solved;
+  /// Which variables are currently being solved, to break recursions.
+  llvm::BitVector seenVars;
+};
+} // namespace
+
+CompactExprs::CompactExprs(ArrayRef<Expr *> exprs)
+    : kinds(exprs.size()), lhs(exprs.size(), noOperand),
+      rhs(exprs.size(), noOperand), solutions(exprs.size()),
+      solved(exprs.size()), seenVars(exprs.size()) {
+  DenseMap<Expr *, uint32_t> indices;
+  indices.reserve(exprs.size());
+  for (auto it : llvm::enumerate(exprs))
+    indices.insert({it.value(), it.index()});
+  auto indexOf = [&](Expr *expr) { return indices.lookup(expr); };
+
+  for (auto it : llvm::enumerate(exprs)) {
+    auto index = it.index();
+    auto *expr = it.value();
+    kinds[index] = static_cast<uint8_t>(expr->kind);
+    if (expr->solution) {
+      solutions[index] = *expr->solution;
+      solved.set(index);
+    }
+    // All expressions in the list have at most two operands.
+    auto operand = expr->begin(), end = expr->end();
+    if (operand != end)
+      lhs[index] = indexOf(*operand++);
+    if (operand != end)
+      rhs[index] = indexOf(*operand);
+  }
+}
+
+/// Compute the value of the expression at `index`. This mirrors `solveExpr`,
+/// which it replaces when solving on the compact representation.
+ExprSolution CompactExprs::solve(uint32_t index) {
+  if (solved.test(index))
+    return {solutions[index], false};
+
+  ExprSolution solution = {llvm::None, false};
+  switch (static_cast<Expr::Kind>(kinds[index])) {
+  case Expr::Kind::Var:
+    // Unconstrained variables produce no solution, and recursions are ignored
+    // when computing the parent.
+    if (lhs[index] == noOperand)
+      return {llvm::None, false};
+    if (seenVars.test(index))
+      return {llvm::None, true};
+    seenVars.set(index);
+    solution = solve(lhs[index]);
+    seenVars.reset(index);
+    // Constrain variables >= 0.
+    if (solution.first && *solution.first < 0)
+      solution.first = 0;
+    break;
+  case Expr::Kind::Id:
+    solution = solve(lhs[index]);
+    break;
+  case Expr::Kind::Pow:
+    solution = computeUnary(solve(lhs[index]),
+                            [](int32_t arg) { return 1 << arg; });
+    break;
+  case Expr::Kind::Add:
+    solution = computeBinary(
+        solve(lhs[index]), solve(rhs[index]),
+        [](int32_t lhs, int32_t rhs) { return lhs + rhs; });
+    break;
+  case Expr::Kind::Max:
+    solution = computeBinary(
+        solve(lhs[index]), solve(rhs[index]),
+        [](int32_t lhs, int32_t rhs) { return std::max(lhs, rhs); });
+    break;
+  case Expr::Kind::Min:
+    solution = computeBinary(
+        solve(lhs[index]), solve(rhs[index]),
+        [](int32_t lhs, int32_t rhs) { return std::min(lhs, rhs); });
+    break;
+  default:
+    break;
+  }
+
+  // Memoize the result.
+  if (solution.first && !solution.second) {
+    solutions[index] = *solution.first;
+    solved.set(index);
+  }
+  return solution;
+}
+
+/// Solve the constraint problem on a compact copy of the expressions, and store
+/// the solutions back into the expressions afterwards.
+void ConstraintSolver::solveCompact() {
+  CompactExprs compact(exprs);
+  for (uint32_t index = 0, e = exprs.size(); index != e; ++index) {
+    auto *var = dyn_cast<VarExpr>(exprs[index]);
+    if (!var || compact.lhs[index] == noOperand)
+      continue;
+    compact.seenVars.set(index);
+    auto solution = compact.solve(compact.lhs[index]);
+    compact.seenVars.reset(index);
+
+    // Constrain variables >= 0.
+    if (solution.first && *solution.first < 0)
+      solution.first = 0;
+    LLVM_DEBUG({
+      if (solution.first)
+        llvm::dbgs() << "- Solved " << *var << " = " << *solution.first << " ("
+                     << (solution.second ? "cycle broken" : "unique") << ")\n";
+      else
+        llvm::dbgs() << "- UNSOLVED " << *var << "\n";
+    });
+
+    // Like the pointer-based solver, keep the variable's solution even if a
+    // cycle had to be broken to compute it.
+    if (solution.first) {
+      compact.solutions[index] = *solution.first;
+      compact.solved.set(index);
+    }
+  }
+
+  for (uint32_t index = 0, e = exprs.size(); index != e; ++index)
+    if (compact.solved.test(index))
+      exprs[index]->solution = compact.solutions[index];
+}
+
 // Emits the diagnostic to inform the user about an uninferred width in the
 // design. Returns true if an error was reported, false otherwise. The latter
 // occurs if the unconstrained variable is for an InvalidValueOp, which we
@@ -1059,6 +1326,259 @@ bool ConstraintSolver::emitUninferredWidthError(VarExpr *var) {
   return true;
 }
 
+/// Emits the diagnostic to inform the user about a variable that is constrained
+/// to be wider than itself, with notes attached for each part of the cycle.
+void ConstraintSolver::emitUnbreakableCycleError(VarExpr *var) {
+  SmallPtrSet<Expr *, 16> seenVars;
+  for (auto fieldRef : info.find(var)->second) {
+    // Depending on whether this value stems from an operation or not, create
+    // an appropriate diagnostic identifying the value.
+    auto op = fieldRef.getDefiningOp();
+    auto diag = op ? op->emitOpError()
+                   : mlir::emitError(fieldRef.getValue().getLoc()) << "value ";
+    diag << "is constrained to be wider than itself";
+
+    // Re-run the cycle checking, but this time reporting into the diagnostic.
+    seenVars.insert(var);
+    checkCycles(var, var->constraint, seenVars, &diag);
+    seenVars.clear();
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Incremental Inference Cache
+//===----------------------------------------------------------------------===//
+
+/// Check if a type contains any FIRRTL type with uninferred widths.
+static bool hasUninferredWidth(Type type) {
+  if (auto ftype = type.dyn_cast<FIRRTLType>())
+    return ftype.hasUninferredWidth();
+  return false;
+}
+
+/// Call `callback` with the field ID and width of every ground field in a type,
+/// in the order in which `InferenceMapping::declareVars` visits them.
+static void
+forEachGroundField(FIRRTLType type,
+                   llvm::function_ref<void(unsigned, int32_t)> callback) {
+  unsigned fieldID = 0;
+  std::function<void(FIRRTLType)> visit = [&](FIRRTLType type) {
+    if (auto bundleType = type.dyn_cast<BundleType>()) {
+      fieldID++;
+      for (auto &element : bundleType.getElements())
+        visit(element.type);
+    } else if (auto vecType = type.dyn_cast<FVectorType>()) {
+      fieldID++;
+      auto save = fieldID;
+      visit(vecType.getElementType());
+      fieldID = save + vecType.getMaxFieldID();
+    } else {
+      callback(fieldID++, type.getBitWidthOrSentinel());
+    }
+  };
+  visit(type);
+}
+
+/// Call `callback` for every value in a module whose type contains uninferred
+/// widths: the ports first, followed by the operation results in pre-order.
+static void forEachUninferredValue(FModuleOp module,
+                                   llvm::function_ref<void(Value)> callback) {
+  for (auto arg : module.getArguments())
+    if (hasUninferredWidth(arg.getType()))
+      callback(arg);
+  module.walk<WalkOrder::PreOrder>([&](Operation *op) {
+    for (auto result : op->getResults())
+      if (hasUninferredWidth(result.getType()))
+        callback(result);
+  });
+}
+
+namespace {
+
+/// A side cache of the widths solved in a previous run of the pass. Since
+/// constraints only cross module boundaries through instance ports with
+/// uninferred widths, the modules connected through such ports form
+/// independent groups. A group whose modules are all unchanged since the cache
+/// was written reuses the cached widths instead of being mapped and solved
+/// again.
+///
+/// The cache is a JSON file with an entry for each module, holding a hash of
+/// the module's group and the widths of all its uninferred fields in the order
+/// of `forEachUninferredValue` and `forEachGroundField`.
+class InferenceCache {
+public:
+  /// Read the cache file, if it exists, and determine which modules of the
+  /// circuit can reuse their cached widths.
+  void load(StringRef path, CircuitOp circuit);
+
+  /// Write the widths of all modules in the circuit to the cache file.
+  /// `getSolution` provides the solved width of a field, or -1 if the field
+  /// has not been inferred.
+  LogicalResult save(StringRef path, CircuitOp circuit,
+                     llvm::function_ref<int32_t(FieldRef)> getSolution);
+
+  /// Return the cached widths for a module, or null if it must be solved.
+  const std::vector<int32_t> *lookup(Operation *module) const {
+    auto it = reusableWidths.find(module);
+    return it != reusableWidths.end() ? &it->second : nullptr;
+  }
+
+private:
+  /// The hash of the group each module belongs to.
+  DenseMap<Operation *, std::string> groupHashes;
+
+  /// The cached widths of all modules whose group is unchanged.
+  DenseMap<Operation *, std::vector<int32_t>> reusableWidths;
+};
+
+} // namespace
+
+/// Compute a hash of a module's contents, which covers all the types and
+/// attributes relevant to width inference.
+static std::string computeModuleHash(FModuleOp module) {
+  llvm::raw_sha1_ostream os;
+  module->print(os, OpPrintingFlags().printGenericOpForm().useLocalScope());
+  return toHex(os.sha1());
+}
+
+void InferenceCache::load(StringRef path, CircuitOp circuit) {
+  // Group the modules that share constraints through instance ports.
+  llvm::EquivalenceClasses<Operation *> groups;
+  DenseMap<Operation *, std::string> moduleHashes;
+  for (auto module : circuit.getBody()->getOps<FModuleOp>()) {
+    groups.insert(module);
+    moduleHashes.insert({module, computeModuleHash(module)});
+    module.walk([&](InstanceOp instance) {
+      auto refdModule = dyn_cast<FModuleOp>(instance.getReferencedModule());
+      if (!refdModule)
+        return;
+      if (llvm::any_of(instance->getResultTypes(), hasUninferredWidth))
+        groups.unionSets(module, refdModule);
+    });
+  }
+
+  // Combine the module hashes into a hash for each group, in a fixed order.
+  for (auto it = groups.begin(), e = groups.end(); it != e; ++it) {
+    if (!it->isLeader())
+      continue;
+    SmallVector<FModuleOp> members;
+    for (auto member = groups.member_begin(it); member != groups.member_end();
+         ++member)
+      members.push_back(cast<FModuleOp>(*member));
+    llvm::sort(members, [](FModuleOp a, FModuleOp b) {
+      return a.getName() < b.getName();
+    });
+    llvm::raw_sha1_ostream os;
+    for (auto member : members)
+      os << member.getName() << ':' << moduleHashes[member] << '\n';
+    auto hash = toHex(os.sha1());
+    for (auto member : members)
+      groupHashes.insert({member, hash});
+  }
+
+  // Read the widths of the previous run, if there are any. A missing or
+  // unreadable cache simply causes all modules to be solved again.
+  if (!llvm::sys::fs::exists(path))
+    return;
+  std::string errorMessage;
+  auto input = mlir::openInputFile(path, &errorMessage);
+  if (!input) {
+    mlir::emitWarning(circuit.getLoc())
+        << "ignoring width inference cache: " << errorMessage;
+    return;
+  }
+  auto json = llvm::json::parse(input->getBuffer());
+  if (!json) {
+    mlir::emitWarning(circuit.getLoc())
+        << "ignoring malformed width inference cache '" << path
+        << "': " << llvm::toString(json.takeError());
+    return;
+  }
+  auto *root = json->getAsObject();
+  auto *entries = root ? root->getObject("modules") : nullptr;
+  if (!entries || root->getInteger("version") != 1)
+    return;
+
+  struct CachedModule {
+    StringRef groupHash;
+    std::vector<int32_t> widths;
+  };
+  DenseMap<Operation *, CachedModule> cachedModules;
+  for (auto &entry : *entries) {
+    auto *module = circuit.lookupSymbol(entry.first);
+    auto *object = entry.second.getAsObject();
+    if (!module || !object)
+      continue;
+    auto groupHash = object->getString("group");
+    auto *widths = object->getArray("widths");
+    if (!groupHash || !widths)
+      continue;
+    CachedModule cached;
+    cached.groupHash = *groupHash;
+    for (auto &width : *widths)
+      cached.widths.push_back(width.getAsInteger().getValueOr(-1));
+    cachedModules.insert({module, std::move(cached)});
+  }
+
+  // Only reuse the widths of groups where every module matches the cache.
+  for (auto it = groups.begin(), e = groups.end(); it != e; ++it) {
+    if (!it->isLeader())
+      continue;
+    bool unchanged = llvm::all_of(
+        llvm::make_range(groups.member_begin(it), groups.member_end()),
+        [&](Operation *member) {
+          auto cached = cachedModules.find(member);
+          return cached != cachedModules.end() &&
+                 cached->second.groupHash == groupHashes[member];
+        });
+    if (!unchanged)
+      continue;
+    for (auto member = groups.member_begin(it); member != groups.member_end();
+         ++member) {
+      LLVM_DEBUG(llvm::dbgs() << "Reusing cached widths for module '"
+                              << cast<FModuleOp>(*member).getName() << "'\n");
+      reusableWidths.insert(
+          {*member, std::move(cachedModules[*member].widths)});
+    }
+  }
+}
+
+LogicalResult
+InferenceCache::save(StringRef path, CircuitOp circuit,
+                     llvm::function_ref<int32_t(FieldRef)> getSolution) {
+  std::string errorMessage;
+  auto output = mlir::openOutputFile(path, &errorMessage);
+  if (!output) {
+    mlir::emitError(circuit.getLoc())
+        << "cannot write width inference cache: " << errorMessage;
+    return failure();
+  }
+
+  llvm::json::OStream json(output->os());
+  json.object([&] {
+    json.attribute("version", 1);
+    json.attributeObject("modules", [&] {
+      for (auto module : circuit.getBody()->getOps<FModuleOp>()) {
+        json.attributeObject(module.getName(), [&] {
+          json.attribute("group", groupHashes.lookup(module));
+          json.attributeArray("widths", [&] {
+            forEachUninferredValue(module, [&](Value value) {
+              forEachGroundField(value.getType().cast<FIRRTLType>(),
+                                 [&](unsigned fieldID, int32_t width) {
+                                   if (width == -1)
+                                     json.value(getSolution(
+                                         FieldRef(value, fieldID)));
+                                 });
+            });
+          });
+        });
+      }
+    });
+  });
+  output->keep();
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // Inference Constraint Problem Mapping
 //===----------------------------------------------------------------------===//
@@ -1069,7 +1589,9 @@ namespace {
 /// variables and constraints to be solved later.
 class InferenceMapping {
 public:
-  InferenceMapping(ConstraintSolver &solver) : solver(solver) {}
+  InferenceMapping(ConstraintSolver &solver,
+                   const InferenceCache *cache = nullptr)
+      : solver(solver), cache(cache) {}
 
   LogicalResult map(CircuitOp op);
   LogicalResult mapOperation(Operation *op);
@@ -1086,6 +1608,10 @@ public:
   /// non-aggregate.
   Expr *declareVar(FIRRTLType type, Location loc);
 
+  /// Declare the widths of a value in a module that reuses cached widths. The
+  /// uninferred widths are consumed from the front of `widths`.
+  void declareCachedVars(Value value, ArrayRef<int32_t> &widths);
+
   /// Constrain the value "larger" to be greater than or equal to "smaller".
   /// These may be aggregate values. This is used for regular connects.
   void constrainTypes(Value larger, Value smaller);
@@ -1131,6 +1657,13 @@ private:
   /// The constraint solver into which we emit variables and constraints.
   ConstraintSolver &solver;
 
+  /// The cache of widths solved in a previous run, if any.
+  const InferenceCache *cache;
+
+  /// The cached widths of modules that are not solved again, which remain
+  /// after their ports have been declared.
+  DenseMap<Operation *, ArrayRef<int32_t>> cachedWidths;
+
   /// The constraint exprs for each result type of an operation.
   DenseMap<FieldRef, Expr *> opExprs;
 
@@ -1141,19 +1674,20 @@ private:
 
 } // namespace
 
-/// Check if a type contains any FIRRTL type with uninferred widths.
-static bool hasUninferredWidth(Type type) {
-  if (auto ftype = type.dyn_cast<FIRRTLType>())
-    return ftype.hasUninferredWidth();
-  return false;
-}
-
 LogicalResult InferenceMapping::map(CircuitOp op) {
   LLVM_DEBUG(llvm::dbgs()
              << "\n===----- Mapping ops to constraint exprs -----===\n\n");
 
   // Ensure we have constraint variables established for all module ports.
   op.walk<WalkOrder::PostOrder>([&](FModuleOp module) {
+    // Modules that reuse cached widths have their ports declared as known.
+    if (auto *widths = cache ? cache->lookup(module) : nullptr) {
+      ArrayRef<int32_t> remaining = *widths;
+      for (auto arg : module.getArguments())
+        declareCachedVars(arg, remaining);
+      cachedWidths.insert({module, remaining});
+      return WalkResult::skip();
+    }
     for (auto arg : module.getArguments()) {
       solver.setCurrentContextInfo(FieldRef(arg, 0));
       declareVars(arg, module.getLoc());
@@ -1186,6 +1720,18 @@ LogicalResult InferenceMapping::map(CircuitOp op) {
     }
     allModulesSkipped = false;
 
+    // Modules that reuse cached widths do not contribute any constraints. They
+    // only need their results declared as known for the type update.
+    auto cached = cachedWidths.find(module);
+    if (cached != cachedWidths.end()) {
+      module.walk<WalkOrder::PreOrder>([&](Operation *op) {
+        for (auto result : op->getResults())
+          if (hasUninferredWidth(result.getType()))
+            declareCachedVars(result, cached->second);
+      });
+      return WalkResult::skip();
+    }
+
     // Go through operations in the module, creating type variables for results,
     // and generating constraints.
     auto result = module.getBody().walk(
@@ -1532,6 +2078,24 @@ void InferenceMapping::declareVars(Value value, Location loc) {
   declare(ftype);
 }
 
+void InferenceMapping::declareCachedVars(Value value,
+                                         ArrayRef<int32_t> &widths) {
+  forEachGroundField(
+      value.getType().cast<FIRRTLType>(), [&](unsigned fieldID, int32_t width) {
+        if (width == -1) {
+          // Fields that did not get a width in the previous run are left
+          // without an expression, just like unsolved variables.
+          if (widths.empty())
+            return;
+          width = widths.front();
+          widths = widths.drop_front();
+          if (width < 0)
+            return;
+        }
+        setExpr(FieldRef(value, fieldID), solver.known(width));
+      });
+}
+
 /// Establishes constraints to ensure the sizes in the `larger` type are greater
 /// than or equal to the sizes in the `smaller` type. Types have to be
 /// compatible in the sense that they may only differ in the presence or absence
@@ -1980,14 +2544,24 @@ struct DenseMapInfo<InternedSlot<T>> {
 
 namespace {
 class InferWidthsPass : public InferWidthsBase<InferWidthsPass> {
+public:
+  InferWidthsPass(bool parallelSolve, StringRef cacheFile) {
+    this->parallelSolve = parallelSolve;
+    this->cacheFile = cacheFile.str();
+  }
   void runOnOperation() override;
 };
 } // namespace
 
 void InferWidthsPass::runOnOperation() {
+  // Determine which modules can reuse the widths of a previous run.
+  InferenceCache cache;
+  if (!cacheFile.empty())
+    cache.load(cacheFile, getOperation());
+
   // Collect variables and constraints
   ConstraintSolver solver;
-  InferenceMapping mapping(solver);
+  InferenceMapping mapping(solver, &cache);
   if (failed(mapping.map(getOperation()))) {
     signalPassFailure();
     return;
@@ -1998,16 +2572,31 @@ void InferWidthsPass::runOnOperation() {
   }
 
   // Solve the constraints.
-  if (failed(solver.solve())) {
+  if (failed(solver.solve(parallelSolve ? &getContext() : nullptr,
+                          compactSolve))) {
     signalPassFailure();
     return;
   }
 
+  // Record the solution for the next run, while the types still carry the
+  // uninferred widths that identify the fields in the cache.
+  if (!cacheFile.empty()) {
+    auto getSolution = [&](FieldRef fieldRef) -> int32_t {
+      auto *expr = mapping.getExprOrNull(fieldRef);
+      return expr && expr->solution ? *expr->solution : -1;
+    };
+    if (failed(cache.save(cacheFile, getOperation(), getSolution))) {
+      signalPassFailure();
+      return;
+    }
+  }
+
   // Update the types with the inferred widths.
   if (failed(InferenceTypeUpdate(mapping).update(getOperation())))
     signalPassFailure();
 }
 
-std::unique_ptr<mlir::Pass> circt::firrtl::createInferWidthsPass() {
-  return std::make_unique<InferWidthsPass>();
+std::unique_ptr<mlir::Pass>
+circt::firrtl::createInferWidthsPass(bool parallelSolve, StringRef cacheFile) {
+  return std::make_unique<InferWidthsPass>(parallelSolve, cacheFile);
 }
@@ -36,6 +36,7 @@
 #include "mlir/IR/ImplicitLocOpBuilder.h"
 #include "mlir/IR/Threading.h"
 #include "llvm/ADT/APSInt.h"
+#include "llvm/Support/RWMutex.h"
 #include <deque>
 
 using namespace circt;
@@ -98,6 +99,51 @@ static bool peelType(Type type, SmallVectorImpl<FlatBundleFieldEntry> &fields) {
       .Default([](auto op) { return false; });
 }
 
+namespace {
+/// This caches the peeled fields of every type lowered so far, so that the
+/// fields of a type are computed once no matter how many values of that type
+/// get lowered.  This is shared by all the module lowerings running in
+/// parallel.
+class PeeledTypeCache {
+public:
+  /// Peel one layer of the specified type into its fields, see `peelType`.
+  /// The returned fields are owned by the cache and stay valid as long as it
+  /// lives.
+  bool getFields(Type type, ArrayRef<FlatBundleFieldEntry> &fields) {
+    {
+      llvm::sys::SmartScopedReader<true> reader(mutex);
+      auto it = cache.find(type);
+      if (it != cache.end())
+        return unpack(it->second.get(), fields);
+    }
+
+    // Peel the type outside of the lock, another thread may race to add the
+    // same type but its fields are identical.
+    auto entry = std::make_unique<SmallVector<FlatBundleFieldEntry, 4>>();
+    if (!peelType(type, *entry))
+      entry.reset();
+
+    llvm::sys::SmartScopedWriter<true> writer(mutex);
+    auto &slot = cache.try_emplace(type, std::move(entry)).first->second;
+    return unpack(slot.get(), fields);
+  }
+
+private:
+  static bool unpack(SmallVectorImpl<FlatBundleFieldEntry> *entry,
+                     ArrayRef<FlatBundleFieldEntry> &fields) {
+    if (!entry)
+      return false;
+    fields = *entry;
+    return true;
+  }
+
+  llvm::sys::SmartRWMutex<true> mutex;
+
+  /// The fields of each aggregate type.  Non-aggregate types map to null.
+  DenseMap<Type, std::unique_ptr<SmallVector<FlatBundleFieldEntry, 4>>> cache;
+};
+} // end anonymous namespace
+
 /// Return if something is not a normal subaccess.  Non-normal includes
 /// zero-length vectors and constant indexes (which are really subindexes).
 static bool isNotSubAccess(Operation *op) {
@@ -128,7 +174,7 @@ static SmallVector<Operation *> getSAWritePath(Operation *op) {
 /// with "target" key, that do not match the field suffix.
 static ArrayAttr filterAnnotations(MLIRContext *ctxt, ArrayAttr annotations,
                                    FIRRTLType srcType,
-                                   FlatBundleFieldEntry field) {
+                                   const FlatBundleFieldEntry &field) {
   SmallVector<Attribute> retval;
   if (!annotations || annotations.empty())
     return ArrayAttr::get(ctxt, retval);
@@ -161,7 +207,7 @@ static ArrayAttr filterAnnotations(MLIRContext *ctxt, ArrayAttr annotations,
 }
 
 static MemOp cloneMemWithNewType(ImplicitLocOpBuilder *b, MemOp op,
-                                 FlatBundleFieldEntry field) {
+                                 const FlatBundleFieldEntry &field) {
   SmallVector<Type, 8> ports;
   SmallVector<Attribute, 8> portNames;
 
@@ -229,7 +275,8 @@ static MemOp cloneMemWithNewType(ImplicitLocOpBuilder *b, MemOp op,
 namespace {
 struct TypeLoweringVisitor : public FIRRTLVisitor<TypeLoweringVisitor> {
 
-  TypeLoweringVisitor(MLIRContext *context) : context(context) {}
+  TypeLoweringVisitor(MLIRContext *context, PeeledTypeCache &typeCache)
+      : context(context), typeCache(typeCache) {}
   using FIRRTLVisitor<TypeLoweringVisitor>::visitDecl;
   using FIRRTLVisitor<TypeLoweringVisitor>::visitExpr;
   using FIRRTLVisitor<TypeLoweringVisitor>::visitStmt;
@@ -245,7 +292,7 @@ struct TypeLoweringVisitor : public FIRRTLVisitor<TypeLoweringVisitor> {
       SmallVectorImpl<Value> &lowering);
   std::pair<Value, firrtl::ModulePortInfo>
   addArg(Operation *module, unsigned insertPt, FIRRTLType srcType,
-         FlatBundleFieldEntry field, ModulePortInfo &oldArg);
+         const FlatBundleFieldEntry &field, ModulePortInfo &oldArg);
 
   // Helpers to manage state.
   void visitDecl(FExtModuleOp op);
@@ -270,13 +317,21 @@ private:
   void lowerBlock(Block *);
   void lowerSAWritePath(Operation *, ArrayRef<Operation *> writePath);
   void lowerProducer(Operation *op,
-                     llvm::function_ref<Operation *(FlatBundleFieldEntry,
-                                                    StringRef, ArrayAttr)>
+                     llvm::function_ref<Operation *(
+                         const FlatBundleFieldEntry &, StringRef, ArrayAttr)>
                          clone);
   Value getSubWhatever(Value val, size_t index);
 
+  /// Peel one layer of an aggregate type, using the shared type cache.
+  bool peelType(Type type, ArrayRef<FlatBundleFieldEntry> &fields) {
+    return typeCache.getFields(type, fields);
+  }
+
   MLIRContext *context;
 
+  /// The peeled fields of each type, shared by all modules being lowered.
+  PeeledTypeCache &typeCache;
+
   /// The builder is set and maintained in the main loop.
   ImplicitLocOpBuilder *builder;
 
@@ -339,11 +394,12 @@ void TypeLoweringVisitor::lowerBlock(Block *block) {
 
 void TypeLoweringVisitor::lowerProducer(
     Operation *op,
-    llvm::function_ref<Operation *(FlatBundleFieldEntry, StringRef, ArrayAttr)>
+    llvm::function_ref<Operation *(const FlatBundleFieldEntry &, StringRef,
+                                   ArrayAttr)>
         clone) {
   // If this is not a bundle, there is nothing to do.
   auto srcType = op->getResult(0).getType().cast<FIRRTLType>();
-  SmallVector<FlatBundleFieldEntry, 8> fieldTypes;
+  ArrayRef<FlatBundleFieldEntry> fieldTypes;
   if (!peelType(srcType, fieldTypes))
     return;
 
@@ -356,7 +412,7 @@ void TypeLoweringVisitor::lowerProducer(
   auto baseNameLen = loweredName.size();
   auto oldAnno = op->getAttr("annotations").dyn_cast_or_null<ArrayAttr>();
 
-  for (auto field : fieldTypes) {
+  for (auto &field : fieldTypes) {
     if (!loweredName.empty()) {
       loweredName.resize(baseNameLen);
       loweredName += field.suffix;
@@ -402,7 +458,8 @@ void TypeLoweringVisitor::lowerModule(Operation *op) {
 // possibly with a new suffix appended.
 std::pair<Value, firrtl::ModulePortInfo>
 TypeLoweringVisitor::addArg(Operation *module, unsigned insertPt,
-                            FIRRTLType srcType, FlatBundleFieldEntry field,
+                            FIRRTLType srcType,
+                            const FlatBundleFieldEntry &field,
                             ModulePortInfo &oldArg) {
   Value newValue;
   if (auto mod = dyn_cast<FModuleOp>(module)) {
@@ -435,7 +492,7 @@ bool TypeLoweringVisitor::lowerArg(
     SmallVectorImpl<Value> &lowering) {
 
   // Flatten any bundle types.
-  SmallVector<FlatBundleFieldEntry> fieldTypes;
+  ArrayRef<FlatBundleFieldEntry> fieldTypes;
   auto srcType = newArgs[argIndex].first.type.cast<FIRRTLType>();
   if (!peelType(srcType, fieldTypes))
     return false;
@@ -495,7 +552,7 @@ void TypeLoweringVisitor::visitStmt(ConnectOp op) {
     return;
 
   // Attempt to get the bundle types.
-  SmallVector<FlatBundleFieldEntry> fields;
+  ArrayRef<FlatBundleFieldEntry> fields;
   if (!peelType(op.dest().getType(), fields))
     return;
 
@@ -517,7 +574,7 @@ void TypeLoweringVisitor::visitStmt(PartialConnectOp op) {
   if (processSAPath(op))
     return;
 
-  SmallVector<FlatBundleFieldEntry> srcFields, destFields;
+  ArrayRef<FlatBundleFieldEntry> srcFields, destFields;
   peelType(op.src().getType(), srcFields);
   bool dValid = peelType(op.dest().getType(), destFields);
 
@@ -617,7 +674,7 @@ void TypeLoweringVisitor::visitStmt(WhenOp op) {
 /// element in a memory's data type.
 void TypeLoweringVisitor::visitDecl(MemOp op) {
   // Attempt to get the bundle types.
-  SmallVector<FlatBundleFieldEntry> fields;
+  ArrayRef<FlatBundleFieldEntry> fields;
   if (!peelType(op.getDataType(), fields))
     return;
 
@@ -636,7 +693,7 @@ void TypeLoweringVisitor::visitDecl(MemOp op) {
   }
 
   // Memory for each field
-  for (auto field : fields)
+  for (auto &field : fields)
     newMemories.push_back(cloneMemWithNewType(builder, op, field));
 
   // Hook up the new memories to the wires the old memory was replaced with.
@@ -651,7 +708,7 @@ void TypeLoweringVisitor::visitDecl(MemOp op) {
       // go both directions, depending on the port direction.
       if (name == "data" || name == "mask" || name == "wdata" ||
           name == "wmask" || name == "rdata") {
-        for (auto field : fields) {
+        for (auto &field : fields) {
           auto realOldField = getSubWhatever(oldField, field.index);
           auto newField = getSubWhatever(
               newMemories[field.index].getResult(index), fieldIndex);
@@ -814,7 +871,7 @@ void TypeLoweringVisitor::visitDecl(FModuleOp module) {
 
 /// Lower a wire op with a bundle to multiple non-bundled wires.
 void TypeLoweringVisitor::visitDecl(WireOp op) {
-  auto clone = [&](FlatBundleFieldEntry field, StringRef name,
+  auto clone = [&](const FlatBundleFieldEntry &field, StringRef name,
                    ArrayAttr attrs) -> Operation * {
     return builder->create<WireOp>(field.type, name, attrs);
   };
@@ -823,7 +880,7 @@ void TypeLoweringVisitor::visitDecl(WireOp op) {
 
 /// Lower a reg op with a bundle to multiple non-bundled regs.
 void TypeLoweringVisitor::visitDecl(RegOp op) {
-  auto clone = [&](FlatBundleFieldEntry field, StringRef name,
+  auto clone = [&](const FlatBundleFieldEntry &field, StringRef name,
                    ArrayAttr attrs) -> Operation * {
     return builder->create<RegOp>(field.type, op.clockVal(), name, attrs);
   };
@@ -832,7 +889,7 @@ void TypeLoweringVisitor::visitDecl(RegOp op) {
 
 /// Lower a reg op with a bundle to multiple non-bundled regs.
 void TypeLoweringVisitor::visitDecl(RegResetOp op) {
-  auto clone = [&](FlatBundleFieldEntry field, StringRef name,
+  auto clone = [&](const FlatBundleFieldEntry &field, StringRef name,
                    ArrayAttr attrs) -> Operation * {
     auto resetVal = getSubWhatever(op.resetValue(), field.index);
     return builder->create<RegResetOp>(field.type, op.clockVal(),
@@ -843,7 +900,7 @@ void TypeLoweringVisitor::visitDecl(RegResetOp op) {
 
 /// Lower a wire op with a bundle to multiple non-bundled wires.
 void TypeLoweringVisitor::visitDecl(NodeOp op) {
-  auto clone = [&](FlatBundleFieldEntry field, StringRef name,
+  auto clone = [&](const FlatBundleFieldEntry &field, StringRef name,
                    ArrayAttr attrs) -> Operation * {
     auto input = getSubWhatever(op.input(), field.index);
     return builder->create<NodeOp>(field.type, input, name, attrs);
@@ -853,7 +910,7 @@ void TypeLoweringVisitor::visitDecl(NodeOp op) {
 
 /// Lower an InvalidValue op with a bundle to multiple non-bundled InvalidOps.
 void TypeLoweringVisitor::visitExpr(InvalidValueOp op) {
-  auto clone = [&](FlatBundleFieldEntry field, StringRef name,
+  auto clone = [&](const FlatBundleFieldEntry &field, StringRef name,
                    ArrayAttr attrs) -> Operation * {
     return builder->create<InvalidValueOp>(field.type);
   };
@@ -862,7 +919,7 @@ void TypeLoweringVisitor::visitExpr(InvalidValueOp op) {
 
 // Expand muxes of aggregates
 void TypeLoweringVisitor::visitExpr(MuxPrimOp op) {
-  auto clone = [&](FlatBundleFieldEntry field, StringRef name,
+  auto clone = [&](const FlatBundleFieldEntry &field, StringRef name,
                    ArrayAttr attrs) -> Operation * {
     auto high = getSubWhatever(op.high(), field.index);
     auto low = getSubWhatever(op.low(), field.index);
@@ -873,7 +930,7 @@ void TypeLoweringVisitor::visitExpr(MuxPrimOp op) {
 
 // Expand AsPassivePrimOp of aggregates
 void TypeLoweringVisitor::visitExpr(AsPassivePrimOp op) {
-  auto clone = [&](FlatBundleFieldEntry field, StringRef name,
+  auto clone = [&](const FlatBundleFieldEntry &field, StringRef name,
                    ArrayAttr attrs) -> Operation * {
     auto input = getSubWhatever(op.input(), field.index);
     return builder->create<AsPassivePrimOp>(field.type, input);
@@ -894,14 +951,14 @@ void TypeLoweringVisitor::visitDecl(InstanceOp op) {
     auto srcType = op.getType(i).cast<FIRRTLType>();
 
     // Flatten any nested bundle types the usual way.
-    SmallVector<FlatBundleFieldEntry, 8> fieldTypes;
+    ArrayRef<FlatBundleFieldEntry> fieldTypes;
     if (!peelType(srcType, fieldTypes)) {
       resultTypes.push_back(srcType);
       newPortAnno.push_back(oldPortAnno[i]);
     } else {
       skip = false;
       // Store the flat type for the new bundle type.
-      for (auto field : fieldTypes) {
+      for (auto &field : fieldTypes) {
         resultTypes.push_back(field.type);
         newPortAnno.push_back(filterAnnotations(
             context, oldPortAnno[i].dyn_cast_or_null<ArrayAttr>(), srcType,
@@ -993,8 +1050,9 @@ void LowerTypesPass::runOnOperation() {
   llvm::for_each(getOperation().getBody()->getOperations(),
                  [&](Operation &op) { ops.push_back(&op); });
 
+  PeeledTypeCache typeCache;
   mlir::parallelForEachN(&getContext(), 0, ops.size(), [&](auto index) {
-    TypeLoweringVisitor(&getContext()).lowerModule(ops[index]);
+    TypeLoweringVisitor(&getContext(), typeCache).lowerModule(ops[index]);
   });
 }
 
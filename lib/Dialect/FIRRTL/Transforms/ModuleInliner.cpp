@@ -15,9 +15,12 @@
 #include "circt/Dialect/FIRRTL/FIRRTLOps.h"
 #include "circt/Dialect/FIRRTL/FIRRTLTypes.h"
 #include "circt/Dialect/FIRRTL/FIRRTLVisitors.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
 #include "circt/Dialect/FIRRTL/Passes.h"
 #include "circt/Support/LLVM.h"
 #include "mlir/IR/BlockAndValueMapping.h"
+#include "mlir/IR/Threading.h"
+#include "llvm/ADT/PostOrderIterator.h"
 
 using namespace circt;
 using namespace firrtl;
@@ -27,19 +30,24 @@ using namespace firrtl;
 //===----------------------------------------------------------------------===//
 
 /// If this operation or any child operation has a name, add the prefix to that
-/// operation's name.
-static void rename(StringRef prefix, Operation *op) {
+/// operation's name.  The name buffer starts with the prefix, which is the
+/// first `prefixSize` characters, and is reused to build every new name.
+static void rename(SmallVectorImpl<char> &name, size_t prefixSize,
+                   Operation *op) {
   llvm::TypeSwitch<Operation *>(op)
       .Case<CombMemOp, InstanceOp, MemOp, MemoryPortOp, NodeOp, RegOp,
             RegResetOp, SeqMemOp, WireOp>([&](auto op) {
-        op.nameAttr(
-            StringAttr::get(op.getContext(), (prefix + op.name()).str()));
+        auto opName = op.name();
+        name.resize(prefixSize);
+        name.append(opName.begin(), opName.end());
+        op.nameAttr(StringAttr::get(op.getContext(),
+                                    StringRef(name.data(), name.size())));
       });
   // Recursively rename any child operations.
   for (auto &region : op->getRegions())
     for (auto &block : region)
       for (auto &op : block)
-        rename(prefix, &op);
+        rename(name, prefixSize, &op);
 }
 
 /// Clone an operation, mapping used values and results with the mapper, and
@@ -48,7 +56,8 @@ static void rename(StringRef prefix, Operation *op) {
 static void cloneAndRename(StringRef prefix, OpBuilder &b,
                            BlockAndValueMapping &mapper, Operation &op) {
   auto newOp = b.clone(op, mapper);
-  rename(prefix, newOp);
+  SmallString<64> name(prefix);
+  rename(name, prefix.size(), newOp);
 }
 
 /// This function is used before inlining a module, to handle the conversion
@@ -90,27 +99,42 @@ static void mapResultsToWires(BlockAndValueMapping &mapper,
 
 /// Inlines, flattens, and removes dead modules in a circuit.
 ///
-/// The inliner works in a top down fashion, starting from the top level module,
-/// and inlines every possible instance. With this method of recursive top-down
-/// inlining, each operation will be cloned directly to its final location.
+/// The inliner works in a bottom up fashion.  The modules reachable from the
+/// top level module are bucketed by their height in the instance graph, and
+/// all the modules of a level are processed in parallel once every level below
+/// is complete.  Processing a module inlines every possible instance in it, or
+/// every instance if the module is flattened.  Since the modules it
+/// instantiates are already processed, their bodies have all of their own
+/// inlined instances expanded, and only have to be cloned one level deep.
 ///
-/// The inliner uses a worklist to track which modules need to be processed.
-/// When an instance op is not inlined, the referenced module is added to the
-/// worklist. When the inliner is complete, it deletes every un-processed
-/// module: either all instances of the module were inlined, or it was not
-/// reachable from the top level module.
+/// When the inliner is complete, it deletes every module which is no longer
+/// instantiated from the top level module: either all instances of the module
+/// were inlined, or it was not reachable from the top level module.
 ///
 /// During the inlining process, every cloned operation with a name must be
-/// prefixed with the instance's name. The top-down process means that we know
-/// the entire desired prefix when we clone an operation, and can set the name
-/// attribute once. This means that we will not create any intermediate name
-/// attributes (which will be interned by the compiler), and helps keep down the
-/// total memory usage.
+/// prefixed with the instance's name.  Modules which are only reachable through
+/// inlined instances are processed as well, which creates a name attribute for
+/// each level of inlining.  These are cheap to create, since the prefixed name
+/// is built in a reused buffer before it is interned.
+///
+/// Optionally, small modules which are not annotated can also be selected for
+/// inlining by a simple cost model before the inliner runs, see
+/// `selectAutoInlinedModules`.
 namespace {
 class Inliner {
 public:
   /// Initialize the inliner to run on this circuit.
-  Inliner(CircuitOp circuit);
+  Inliner(CircuitOp circuit, InstanceGraph &instanceGraph);
+
+  /// Select modules to inline which are not annotated for inlining.  Modules
+  /// are visited bottom-up, so the size of a module includes the bodies of any
+  /// modules which will be inlined into it.  A module is selected if a copy of
+  /// it costs at most `maxSize` operations, with one operation discounted for
+  /// each of its input ports driven by a constant at an instance site, if it
+  /// has at most `maxInstances` instances, and if the operations added to the
+  /// circuit by inlining it fit in what is left of `growthBudget`.
+  void selectAutoInlinedModules(unsigned maxSize, unsigned maxInstances,
+                                unsigned growthBudget);
 
   /// Run the inliner.
   void run();
@@ -140,18 +164,20 @@ private:
   /// Inline any instances in the module which were marked for inlining.
   void inlineInstances(FModuleOp module);
 
+  /// Delete every module which is not instantiated from the top level module.
+  void deleteDeadModules();
+
   CircuitOp circuit;
   MLIRContext *context;
 
+  /// The instance graph of the circuit, before any inlining.
+  InstanceGraph &instanceGraph;
+
   // A symbol table with references to each module in a circuit.
   SymbolTable symbolTable;
 
-  /// The set of live modules.  Anything not recorded in this set will be
-  /// removed by dead code elimination.
-  DenseSet<Operation *> liveModules;
-
-  /// Worklist of modules to process for inlining or flattening.
-  SmallVector<FModuleOp, 16> worklist;
+  /// The modules selected for inlining by the cost model.
+  DenseSet<Operation *> autoInlinedModules;
 };
 } // namespace
 
@@ -160,7 +186,98 @@ bool Inliner::shouldFlatten(Operation *op) {
 }
 
 bool Inliner::shouldInline(Operation *op) {
-  return AnnotationSet(op).hasAnnotation("firrtl.passes.InlineAnnotation");
+  return autoInlinedModules.count(op) ||
+         AnnotationSet(op).hasAnnotation("firrtl.passes.InlineAnnotation");
+}
+
+/// Return true if any port of the module has an annotation.  These would be
+/// dropped when the ports are turned into wires.
+static bool hasPortAnnotations(FModuleOp module) {
+  for (size_t i = 0, e = module.getNumArguments(); i != e; ++i)
+    if (!AnnotationSet::forPort(module, i).empty())
+      return true;
+  return false;
+}
+
+/// Count the input ports of the instance which are driven by a constant.  Each
+/// one is an opportunity to constant fold the body of the module once it is
+/// inlined.
+static unsigned countConstantDrivenInputs(InstanceOp instance) {
+  unsigned count = 0;
+  for (auto result : instance.getResults()) {
+    for (auto *user : result.getUsers()) {
+      auto connect = dyn_cast<ConnectOp>(user);
+      if (connect && connect.dest() == result &&
+          isa_and_nonnull<ConstantOp, SpecialConstantOp>(
+              connect.src().getDefiningOp()))
+        ++count;
+    }
+  }
+  return count;
+}
+
+void Inliner::selectAutoInlinedModules(unsigned maxSize, unsigned maxInstances,
+                                       unsigned growthBudget) {
+  // The number of operations that a copy of the module adds to its parent,
+  // including the wires for its ports, for every module which will be inlined.
+  DenseMap<Operation *, unsigned> inlinedCosts;
+  int64_t remainingBudget = growthBudget;
+  auto *topModule = circuit.getMainModule();
+
+  for (auto *node : llvm::post_order(&instanceGraph)) {
+    auto module = dyn_cast<FModuleOp>(node->getModule());
+    if (!module)
+      continue;
+
+    // Measure the module.  An instance of a module which will be inlined costs
+    // as much as the body replacing it.
+    unsigned size = 0;
+    module.getBodyBlock()->walk([&](Operation *op) {
+      if (auto instance = dyn_cast<InstanceOp>(op)) {
+        auto it =
+            inlinedCosts.find(instanceGraph.getReferencedModule(instance));
+        if (it != inlinedCosts.end()) {
+          size += it->second;
+          return;
+        }
+      }
+      ++size;
+    });
+    unsigned cost = size + module.getNumArguments();
+
+    // Modules annotated for inlining are inlined regardless of their cost.
+    if (shouldInline(module)) {
+      inlinedCosts[module] = cost;
+      continue;
+    }
+
+    // Leave alone the top module, and any module with annotations which may
+    // not survive inlining.
+    if (module == topModule || !AnnotationSet(module).empty() ||
+        hasPortAnnotations(module))
+      continue;
+
+    unsigned numInstances = 0;
+    unsigned constantInputs = 0;
+    for (auto *use : node->uses()) {
+      ++numInstances;
+      constantInputs += countConstantDrivenInputs(use->getInstance());
+    }
+    if (numInstances == 0 || numInstances > maxInstances ||
+        cost > maxSize + constantInputs)
+      continue;
+
+    // Each instance is replaced by a copy of the body and the wires for its
+    // ports, and the module itself is deleted.
+    int64_t growth = int64_t(numInstances) * (cost - 1) - int64_t(size);
+    if (growth > remainingBudget)
+      continue;
+    if (growth > 0)
+      remainingBudget -= growth;
+
+    autoInlinedModules.insert(module);
+    inlinedCosts[module] = cost;
+  }
 }
 
 void Inliner::flattenInto(StringRef prefix, OpBuilder &b,
@@ -173,11 +290,10 @@ void Inliner::flattenInto(StringRef prefix, OpBuilder &b,
       continue;
     }
 
-    // If its not a regular module we can't inline it. Mark is as live.
-    auto module = symbolTable.lookup(instance.moduleName());
-    auto target = dyn_cast<FModuleOp>(module);
+    // If its not a regular module we can't inline it.
+    auto target =
+        dyn_cast<FModuleOp>(symbolTable.lookup(instance.moduleName()));
     if (!target) {
-      liveModules.insert(module);
       cloneAndRename(prefix, b, mapper, op);
       continue;
     }
@@ -199,13 +315,11 @@ void Inliner::flattenInstances(FModuleOp module) {
     if (!instance)
       continue;
 
-    // If its not a regular module we can't inline it. Mark is as live.
-    auto module = symbolTable.lookup(instance.moduleName());
-    auto target = dyn_cast<FModuleOp>(module);
-    if (!target) {
-      liveModules.insert(module);
+    // If its not a regular module we can't inline it.
+    auto target =
+        dyn_cast<FModuleOp>(symbolTable.lookup(instance.moduleName()));
+    if (!target)
       continue;
-    }
 
     // Create the wire mapping for results + ports. We RAUW the results instead
     // of mapping them.
@@ -234,20 +348,11 @@ void Inliner::inlineInto(StringRef prefix, OpBuilder &b,
       continue;
     }
 
-    // If its not a regular module we can't inline it. Mark is as live.
-    auto module = symbolTable.lookup(instance.moduleName());
-    auto target = dyn_cast<FModuleOp>(module);
-    if (!target) {
-      liveModules.insert(module);
-      cloneAndRename(prefix, b, mapper, op);
-      continue;
-    }
-
-    // If we aren't inlining the target, add it to the work list.
-    if (!shouldInline(target)) {
-      if (liveModules.insert(target).second) {
-        worklist.push_back(target);
-      }
+    // If its not a regular module we can't inline it.  If we aren't inlining
+    // the target, keep the instance.
+    auto target =
+        dyn_cast<FModuleOp>(symbolTable.lookup(instance.moduleName()));
+    if (!target || !shouldInline(target)) {
       cloneAndRename(prefix, b, mapper, op);
       continue;
     }
@@ -273,21 +378,12 @@ void Inliner::inlineInstances(FModuleOp module) {
     if (!instance)
       continue;
 
-    // If its not a regular module we can't inline it. Mark is as live.
-    auto module = symbolTable.lookup(instance.moduleName());
-    auto target = dyn_cast<FModuleOp>(module);
-    if (!target) {
-      liveModules.insert(module);
-      continue;
-    }
-
-    // If we aren't inlining the target, add it to the work list.
-    if (!shouldInline(target)) {
-      if (liveModules.insert(target).second) {
-        worklist.push_back(target);
-      }
+    // If its not a regular module we can't inline it.  If we aren't inlining
+    // the target, keep the instance.
+    auto target =
+        dyn_cast<FModuleOp>(symbolTable.lookup(instance.moduleName()));
+    if (!target || !shouldInline(target))
       continue;
-    }
 
     // Create the wire mapping for results + ports. We RAUW the results instead
     // of mapping them.
@@ -310,32 +406,68 @@ void Inliner::inlineInstances(FModuleOp module) {
   }
 }
 
-Inliner::Inliner(CircuitOp circuit)
-    : circuit(circuit), context(circuit.getContext()), symbolTable(circuit) {}
+Inliner::Inliner(CircuitOp circuit, InstanceGraph &instanceGraph)
+    : circuit(circuit), context(circuit.getContext()),
+      instanceGraph(instanceGraph), symbolTable(circuit) {}
 
 void Inliner::run() {
-  auto topModule = circuit.getMainModule();
-  // Mark the top module as live, so it doesn't get deleted.
-  liveModules.insert(topModule);
+  // Bucket the modules reachable from the top module by their height in the
+  // instance graph.  Every module is in a higher level than all the modules it
+  // instantiates.
+  std::vector<SmallVector<FModuleOp, 4>> levels;
+  DenseMap<Operation *, unsigned> heights;
+  for (auto *node : llvm::post_order(&instanceGraph)) {
+    unsigned height = 0;
+    for (auto *record : node->instances()) {
+      auto *target = record->getTarget()->getModule();
+      height = std::max(height, heights.lookup(target) + 1);
+    }
+    heights[node->getModule()] = height;
 
-  // If the top module is not a regular module, there is nothing to do.
-  if (auto fmodule = dyn_cast<FModuleOp>(topModule))
-    worklist.push_back(fmodule);
+    if (auto module = dyn_cast<FModuleOp>(node->getModule())) {
+      if (levels.size() <= height)
+        levels.resize(height + 1);
+      levels[height].push_back(module);
+    }
+  }
 
   // If the module is marked for flattening, flatten it. Otherwise, inline
-  // every instance marked to be inlined.
+  // every instance marked to be inlined.  A module only reads the bodies of
+  // the modules in lower levels, which are complete.
+  for (auto &level : levels) {
+    mlir::parallelForEach(context, level, [&](FModuleOp module) {
+      if (shouldFlatten(module)) {
+        flattenInstances(module);
+        return;
+      }
+      inlineInstances(module);
+
+      // Delete the flatten annotations. Any module with the inline annotation
+      // will be deleted, as there won't be any remaining instances of it.
+      AnnotationSet(module).removeAnnotationsWithClass(
+          "firrtl.transforms.FlattenAnnotation");
+    });
+  }
+
+  deleteDeadModules();
+}
+
+void Inliner::deleteDeadModules() {
+  // Mark the top module and everything it still instantiates as live.
+  DenseSet<Operation *> liveModules;
+  SmallVector<Operation *, 16> worklist;
+  auto *topModule = circuit.getMainModule();
+  liveModules.insert(topModule);
+  worklist.push_back(topModule);
   while (!worklist.empty()) {
-    auto module = worklist.pop_back_val();
-    if (shouldFlatten(module)) {
-      flattenInstances(module);
+    auto module = dyn_cast<FModuleOp>(worklist.pop_back_val());
+    if (!module)
       continue;
-    }
-    inlineInstances(module);
-
-    // Delete the flatten annotations. Any module with the inline annotation
-    // will be deleted, as there won't be any remaining instances of it.
-    AnnotationSet(module).removeAnnotationsWithClass(
-        "firrtl.transforms.FlattenAnnotation");
+    module.walk([&](InstanceOp instance) {
+      auto *target = symbolTable.lookup(instance.moduleName());
+      if (liveModules.insert(target).second)
+        worklist.push_back(target);
+    });
   }
 
   // Delete all unreferenced modules.
@@ -351,13 +483,21 @@ void Inliner::run() {
 
 namespace {
 class InlinerPass : public InlinerBase<InlinerPass> {
+public:
+  InlinerPass() = default;
+  InlinerPass(bool autoInline) { this->autoInline = autoInline; }
+
+private:
   void runOnOperation() override {
-    Inliner inliner(getOperation());
+    Inliner inliner(getOperation(), getAnalysis<InstanceGraph>());
+    if (autoInline)
+      inliner.selectAutoInlinedModules(autoInlineSize, autoInlineInstances,
+                                       autoInlineBudget);
     inliner.run();
   }
 };
 } // namespace
 
-std::unique_ptr<mlir::Pass> circt::firrtl::createInlinerPass() {
-  return std::make_unique<InlinerPass>();
+std::unique_ptr<mlir::Pass> circt::firrtl::createInlinerPass(bool autoInline) {
+  return std::make_unique<InlinerPass>(autoInline);
 }
@@ -0,0 +1,60 @@
+//===- PrintCombPaths.cpp - Print the combinational paths -------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//===----------------------------------------------------------------------===//
+//
+// Print the combinational paths between the ports of each module, as found by
+// the CombPathsAnalysis.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/FIRRTL/CombPaths.h"
+#include "circt/Dialect/FIRRTL/Passes.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace circt;
+using namespace firrtl;
+
+namespace {
+struct PrintCombPathsPass : public PrintCombPathsBase<PrintCombPathsPass> {
+  PrintCombPathsPass(raw_ostream &os) : os(os) {}
+  void runOnOperation() override {
+    auto &combPaths = getAnalysis<CombPathsAnalysis>();
+    for (auto &op : *getOperation().getBody()) {
+      if (auto module = dyn_cast<FModuleOp>(op))
+        printPaths(combPaths, module.getName(), module.getPorts());
+      else if (auto extModule = dyn_cast<FExtModuleOp>(op))
+        printPaths(combPaths, extModule.getName(), extModule.getPorts());
+    }
+    markAllAnalysesPreserved();
+  }
+
+  /// Print the input ports of a module, each with the output ports it reaches.
+  void printPaths(const CombPathsAnalysis &combPaths, StringRef moduleName,
+                  SmallVector<ModulePortInfo> ports) {
+    auto *paths = combPaths.lookup(moduleName);
+    if (!paths)
+      return;
+    os << "module " << moduleName << ":\n";
+    for (auto &input : ports) {
+      if (input.isOutput())
+        continue;
+      os << "  " << input.getName() << " ->";
+      for (auto &output : ports)
+        if (output.isOutput() &&
+            paths->hasPath(input.getName(), output.getName()))
+          os << " " << output.getName();
+      os << "\n";
+    }
+  }
+
+  raw_ostream &os;
+};
+} // end anonymous namespace
+
+std::unique_ptr<mlir::Pass> circt::firrtl::createPrintCombPathsPass() {
+  return std::make_unique<PrintCombPathsPass>(llvm::errs());
+}
@@ -0,0 +1,259 @@
+//===- RemoveUnusedPorts.cpp - Remove dead and constant ports ---*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the FIRRTL unused port removal pass, which removes the
+// ports of internal modules that are unused or always constant, and updates
+// all their instances. It is meant to run after IMConstProp, which leaves the
+// constant ports of modules unused, but doesn't remove them.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetails.h"
+#include "circt/Dialect/FIRRTL/FIRRTLAnnotations.h"
+#include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
+#include "circt/Dialect/FIRRTL/Passes.h"
+#include "circt/Support/LLVM.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/Threading.h"
+
+using namespace circt;
+using namespace firrtl;
+
+namespace {
+/// The ports removed from a module. A port driven by the same constant in all
+/// instances, or driving a constant, is replaced by that constant on the other
+/// side of the module boundary before it is removed.
+struct PortRemoval {
+  FModuleOp module;
+  SmallVector<InstanceOp> instances;
+  /// The indices of the removed ports, in increasing order.
+  SmallVector<unsigned> ports;
+  /// The constants replacing the removed input ports within the module.
+  SmallVector<std::pair<unsigned, Attribute>> inputConstants;
+  /// The constants replacing the removed output ports in the instances.
+  SmallVector<std::pair<unsigned, Attribute>> outputConstants;
+};
+
+struct RemoveUnusedPortsPass
+    : public RemoveUnusedPortsBase<RemoveUnusedPortsPass> {
+  void runOnOperation() override;
+
+private:
+  bool analyzePort(PortRemoval &removal, unsigned port);
+  void rewriteModule(PortRemoval &removal);
+  void rewriteInstances(FModuleOp module);
+
+  /// Return true if `value` is only connected to, and return the connects.
+  static bool getConnectsTo(Value value, SmallVectorImpl<ConnectOp> &connects);
+  /// Return the constant that is the only value connected to `value`, or null.
+  static Attribute getConnectedConstant(Value value);
+
+  /// The removal of each module whose ports change.
+  DenseMap<Operation *, PortRemoval *> removals;
+  InstanceGraph *instanceGraph = nullptr;
+};
+} // end anonymous namespace
+
+bool RemoveUnusedPortsPass::getConnectsTo(
+    Value value, SmallVectorImpl<ConnectOp> &connects) {
+  for (auto &use : value.getUses()) {
+    auto connect = dyn_cast<ConnectOp>(use.getOwner());
+    if (!connect || use.getOperandNumber() != 0)
+      return false;
+    connects.push_back(connect);
+  }
+  return true;
+}
+
+Attribute RemoveUnusedPortsPass::getConnectedConstant(Value value) {
+  SmallVector<ConnectOp, 1> connects;
+  if (!getConnectsTo(value, connects) || connects.size() != 1)
+    return {};
+  auto src = connects[0].src();
+  Attribute constant;
+  if (src.getType() != value.getType() ||
+      !matchPattern(src, m_Constant(&constant)))
+    return {};
+  return constant;
+}
+
+/// Decide whether a port of a module is removed, and with which constant. This
+/// only reads the module and the instances of it.
+bool RemoveUnusedPortsPass::analyzePort(PortRemoval &removal, unsigned port) {
+  auto module = removal.module;
+  auto arg = module.getArgument(port);
+  auto type = arg.getType().cast<FIRRTLType>();
+  if (!type.isGround() || type.isa<AnalogType>() ||
+      !AnnotationSet::get(arg).empty())
+    return false;
+  if (llvm::any_of(removal.instances, [&](InstanceOp instance) {
+        return !instance.getPortAnnotation(port).empty();
+      }))
+    return false;
+
+  SmallVector<ConnectOp, 4> connects;
+  if (getModulePortDirection(module, port) == Direction::Output) {
+    // The module may only drive the port.
+    if (!getConnectsTo(arg, connects))
+      return false;
+    bool isUsed = llvm::any_of(removal.instances, [&](InstanceOp instance) {
+      return !instance.getResult(port).use_empty();
+    });
+    if (!isUsed)
+      return true;
+    auto constant = getConnectedConstant(arg);
+    if (!constant)
+      return false;
+    removal.outputConstants.push_back({port, constant});
+    return true;
+  }
+
+  // The instances may only drive the port.
+  Attribute constant;
+  for (auto instance : removal.instances) {
+    auto result = instance.getResult(port);
+    if (!getConnectsTo(result, connects))
+      return false;
+    auto instanceConstant = getConnectedConstant(result);
+    if (!instanceConstant || (constant && constant != instanceConstant)) {
+      constant = {};
+      break;
+    }
+    constant = instanceConstant;
+  }
+  if (constant) {
+    removal.inputConstants.push_back({port, constant});
+    return true;
+  }
+  if (!arg.use_empty())
+    return false;
+  // The connects of the remaining instances are checked too, since any use
+  // of the port other than a connect to it keeps it.
+  return llvm::all_of(removal.instances, [&](InstanceOp instance) {
+    return getConnectsTo(instance.getResult(port), connects);
+  });
+}
+
+/// Replace the removed input ports of a module with their constants, drop the
+/// connects to its removed output ports, and remove the ports.
+void RemoveUnusedPortsPass::rewriteModule(PortRemoval &removal) {
+  auto module = removal.module;
+  auto builder = OpBuilder::atBlockBegin(module.getBodyBlock());
+  for (auto &entry : removal.inputConstants) {
+    auto arg = module.getArgument(entry.first);
+    auto *constant = module->getDialect()->materializeConstant(
+        builder, entry.second, arg.getType(), arg.getLoc());
+    arg.replaceAllUsesWith(constant->getResult(0));
+  }
+  for (auto port : removal.ports) {
+    auto arg = module.getArgument(port);
+    for (auto *user : llvm::make_early_inc_range(arg.getUsers()))
+      user->erase();
+  }
+  module.erasePorts(removal.ports);
+}
+
+/// Update the instances in a module of the modules whose ports were removed.
+void RemoveUnusedPortsPass::rewriteInstances(FModuleOp module) {
+  SmallVector<InstanceOp> instances;
+  module.walk([&](InstanceOp instance) { instances.push_back(instance); });
+
+  OpBuilder builder(module.getContext());
+  for (auto instance : instances) {
+    auto *removal =
+        removals.lookup(instanceGraph->getReferencedModule(instance));
+    if (!removal)
+      continue;
+
+    builder.setInsertionPoint(instance);
+    for (auto &entry : removal->outputConstants) {
+      auto result = instance.getResult(entry.first);
+      auto *constant = module->getDialect()->materializeConstant(
+          builder, entry.second, result.getType(), instance.getLoc());
+      result.replaceAllUsesWith(constant->getResult(0));
+    }
+    for (auto port : removal->ports) {
+      auto result = instance.getResult(port);
+      for (auto *user : llvm::make_early_inc_range(result.getUsers()))
+        user->erase();
+    }
+
+    auto newInstance = builder.create<InstanceOp>(instance, removal->ports);
+    unsigned newIndex = 0;
+    for (unsigned i = 0, e = instance.getNumResults(); i != e; ++i) {
+      if (llvm::is_contained(removal->ports, i))
+        continue;
+      instance.getResult(i).replaceAllUsesWith(
+          newInstance.getResult(newIndex++));
+    }
+    instance.erase();
+  }
+}
+
+void RemoveUnusedPortsPass::runOnOperation() {
+  auto circuit = getOperation();
+  instanceGraph = &getAnalysis<InstanceGraph>();
+
+  // The ports of the main module are the interface of the circuit, so only the
+  // instantiated modules below it are candidates.
+  std::vector<PortRemoval> candidates;
+  auto *mainModule = circuit.getMainModule();
+  for (auto module : circuit.getBody()->getOps<FModuleOp>()) {
+    if (module.getOperation() == mainModule)
+      continue;
+    auto *node = instanceGraph->lookup(module);
+    if (node->uses_begin() == node->uses_end())
+      continue;
+    PortRemoval removal;
+    removal.module = module;
+    for (auto *use : node->uses())
+      removal.instances.push_back(use->getInstance());
+    candidates.push_back(std::move(removal));
+  }
+
+  // Decide on the ports of all modules before any of them changes.
+  auto *context = &getContext();
+  mlir::parallelForEach(context, candidates, [&](PortRemoval &removal) {
+    for (unsigned i = 0, e = removal.module.getNumArguments(); i != e; ++i)
+      if (analyzePort(removal, i))
+        removal.ports.push_back(i);
+  });
+
+  for (auto &removal : candidates)
+    if (!removal.ports.empty())
+      removals.insert({removal.module, &removal});
+  if (removals.empty()) {
+    markAllAnalysesPreserved();
+    return;
+  }
+
+  // Each module is only changed by one thread: first the modules whose ports
+  // are removed, then the modules instantiating them.
+  mlir::parallelForEach(context, candidates, [&](PortRemoval &removal) {
+    if (!removal.ports.empty())
+      rewriteModule(removal);
+  });
+  SmallVector<FModuleOp> parents;
+  for (auto *node : *instanceGraph) {
+    auto parent = dyn_cast<FModuleOp>(node->getModule());
+    if (parent && llvm::any_of(node->instances(), [&](InstanceRecord *record) {
+          return removals.count(record->getTarget()->getModule());
+        }))
+      parents.push_back(parent);
+  }
+  mlir::parallelForEach(context, parents,
+                        [&](FModuleOp parent) { rewriteInstances(parent); });
+
+  removals.clear();
+  instanceGraph = nullptr;
+}
+
+std::unique_ptr<mlir::Pass> circt::firrtl::createRemoveUnusedPortsPass() {
+  return std::make_unique<RemoveUnusedPortsPass>();
+}
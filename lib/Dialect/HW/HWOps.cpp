@@ -12,6 +12,7 @@
 
 #include "circt/Dialect/HW/HWOps.h"
 #include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWSymCache.h"
 #include "circt/Dialect/HW/HWVisitors.h"
 #include "mlir/IR/Builders.h"
 #include "mlir/IR/FunctionImplementation.h"
@@ -660,6 +661,13 @@ Operation *InstanceOp::getReferencedModule() {
   return topLevelModuleOp.lookupSymbol(moduleName());
 }
 
+Operation *InstanceOp::getReferencedModule(const HWSymbolCache *cache) {
+  if (cache)
+    if (auto *result = cache->getDefinition(moduleNameAttr()))
+      return result;
+  return getReferencedModule();
+}
+
 // Helper function to verify instance op types
 static LogicalResult verifyInstanceOpTypes(InstanceOp op,
                                            Operation *referencedModule) {
@@ -724,18 +732,23 @@ static LogicalResult verifyInstanceOpTypes(InstanceOp op,
   return success();
 }
 
-static LogicalResult verifyInstanceOp(InstanceOp op) {
-  auto referencedModule = op.getReferencedModule();
+/// Verify the instance against the referenced module.  This is called by the
+/// verifier of the enclosing symbol table with a symbol table shared by all the
+/// instances, so the module lookups are hash lookups rather than scans of the
+/// top level module.
+LogicalResult
+InstanceOp::verifySymbolUses(SymbolTableCollection &symbolTable) {
+  auto *referencedModule =
+      symbolTable.lookupNearestSymbolFrom(*this, moduleNameAttr());
   if (referencedModule == nullptr)
-    return op.emitError("Cannot find module definition '")
-           << op.moduleName() << "'";
+    return emitError("Cannot find module definition '") << moduleName() << "'";
 
   // If the referenced module is internal, check that input and result types are
   // consistent with the referenced module.
   if (!isa<HWModuleOp>(referencedModule))
     return success();
 
-  return verifyInstanceOpTypes(op, referencedModule);
+  return verifyInstanceOpTypes(*this, referencedModule);
 }
 
 StringAttr InstanceOp::getResultName(size_t idx) {
@@ -27,6 +27,95 @@ using namespace circt;
 using namespace circt::hw;
 using namespace circt::hw::detail;
 
+//===----------------------------------------------------------------------===//
+// Type Storage
+//===----------------------------------------------------------------------===//
+
+namespace circt {
+namespace hw {
+namespace detail {
+bool operator==(const FieldInfo &a, const FieldInfo &b);
+llvm::hash_code hash_value(const FieldInfo &fi);
+
+/// Storage for ArrayType and UnpackedArrayType.  The bit width of the array is
+/// computed once when the type is created, since it is queried very often.
+template <typename ConcreteStorage>
+struct ArrayTypeStorageBase : public mlir::TypeStorage {
+  using KeyTy = std::tuple<mlir::Type, size_t>;
+
+  ArrayTypeStorageBase(mlir::Type elementType, size_t size)
+      : elementType(elementType), size(size) {
+    bitWidth = getBitWidth(elementType);
+    if (bitWidth >= 0)
+      bitWidth *= size;
+  }
+
+  bool operator==(const KeyTy &key) const {
+    return key == KeyTy(elementType, size);
+  }
+
+  static llvm::hash_code hashKey(const KeyTy &key) {
+    return llvm::hash_combine(std::get<0>(key), std::get<1>(key));
+  }
+
+  static ConcreteStorage *construct(mlir::TypeStorageAllocator &allocator,
+                                    const KeyTy &key) {
+    return new (allocator.allocate<ConcreteStorage>())
+        ConcreteStorage(std::get<0>(key), std::get<1>(key));
+  }
+
+  mlir::Type elementType;
+  size_t size;
+  int64_t bitWidth;
+};
+
+struct ArrayTypeStorage : public ArrayTypeStorageBase<ArrayTypeStorage> {
+  using ArrayTypeStorageBase::ArrayTypeStorageBase;
+};
+
+struct UnpackedArrayTypeStorage
+    : public ArrayTypeStorageBase<UnpackedArrayTypeStorage> {
+  using ArrayTypeStorageBase::ArrayTypeStorageBase;
+};
+
+/// Storage for StructType, which also caches the bit width of the struct.
+struct StructTypeStorage : public mlir::TypeStorage {
+  using KeyTy = ArrayRef<FieldInfo>;
+
+  StructTypeStorage(ArrayRef<FieldInfo> elements) : elements(elements) {
+    bitWidth = 0;
+    for (auto &field : elements) {
+      int64_t fieldWidth = getBitWidth(field.type);
+      if (fieldWidth < 0) {
+        bitWidth = fieldWidth;
+        break;
+      }
+      bitWidth += fieldWidth;
+    }
+  }
+
+  bool operator==(const KeyTy &key) const { return key == elements; }
+
+  static llvm::hash_code hashKey(const KeyTy &key) {
+    return llvm::hash_combine_range(key.begin(), key.end());
+  }
+
+  static StructTypeStorage *construct(mlir::TypeStorageAllocator &allocator,
+                                      const KeyTy &key) {
+    SmallVector<FieldInfo, 4> elements;
+    for (auto &field : key)
+      elements.push_back(field.allocateInto(allocator));
+    return new (allocator.allocate<StructTypeStorage>())
+        StructTypeStorage(allocator.copyInto(ArrayRef<FieldInfo>(elements)));
+  }
+
+  ArrayRef<FieldInfo> elements;
+  int64_t bitWidth;
+};
+} // namespace detail
+} // namespace hw
+} // namespace circt
+
 #define GET_TYPEDEF_CLASSES
 #include "circt/Dialect/HW/HWTypes.cpp.inc"
 
@@ -34,6 +123,14 @@ FieldInfo FieldInfo::allocateInto(mlir::TypeStorageAllocator &alloc) const {
   return FieldInfo{alloc.copyInto(name), type};
 }
 
+int64_t ArrayType::getCachedBitWidth() const { return getImpl()->bitWidth; }
+
+int64_t UnpackedArrayType::getCachedBitWidth() const {
+  return getImpl()->bitWidth;
+}
+
+int64_t StructType::getCachedBitWidth() const { return getImpl()->bitWidth; }
+
 //===----------------------------------------------------------------------===//
 // Type Helpers
 //===----------------------------------------------------------------------===/
@@ -93,22 +190,8 @@ int64_t circt::hw::getBitWidth(mlir::Type type) {
   return llvm::TypeSwitch<::mlir::Type, size_t>(type)
       .Case<IntegerType>(
           [](IntegerType t) { return t.getIntOrFloatBitWidth(); })
-      .Case<ArrayType, UnpackedArrayType>([](auto a) {
-        int64_t elementBitWidth = getBitWidth(a.getElementType());
-        if (elementBitWidth < 0)
-          return elementBitWidth;
-        return (int64_t)a.getSize() * elementBitWidth;
-      })
-      .Case<StructType>([](StructType s) {
-        int64_t total = 0;
-        for (auto field : s.getElements()) {
-          int64_t fieldSize = getBitWidth(field.type);
-          if (fieldSize < 0)
-            return fieldSize;
-          total += fieldSize;
-        }
-        return total;
-      })
+      .Case<ArrayType, UnpackedArrayType, StructType>(
+          [](auto a) { return a.getCachedBitWidth(); })
       .Case<UnionType>([](UnionType u) {
         int64_t maxSize = 0;
         for (auto field : u.getElements()) {
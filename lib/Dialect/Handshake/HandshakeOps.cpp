@@ -66,10 +66,14 @@ std::vector<llvm::Any>
 fetchValues(ArrayRef<mlir::Value> values,
             llvm::DenseMap<mlir::Value, llvm::Any> &valueMap) {
   std::vector<llvm::Any> ins;
+  ins.reserve(values.size());
   for (auto &value : values) {
-    assert(valueMap[value].hasValue());
-    ins.push_back(valueMap[value]);
-    valueMap.erase(value);
+    // The values are consumed, so they can be moved out of the map rather
+    // than copied, which would copy the boxed value.
+    auto it = valueMap.find(value);
+    assert(it != valueMap.end() && it->second.hasValue());
+    ins.push_back(std::move(it->second));
+    valueMap.erase(it);
   }
   return ins;
 }
@@ -79,7 +83,7 @@ void storeValues(std::vector<llvm::Any> &values, ArrayRef<mlir::Value> outs,
                  llvm::DenseMap<mlir::Value, llvm::Any> &valueMap) {
   assert(values.size() == outs.size());
   for (unsigned long i = 0; i < outs.size(); ++i)
-    valueMap[outs[i]] = values[i];
+    valueMap[outs[i]] = std::move(values[i]);
 }
 
 // Update the time map after the execution
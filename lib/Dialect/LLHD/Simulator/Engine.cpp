@@ -12,27 +12,58 @@
 
 #include "State.h"
 #include "Trace.h"
+#include "signals-runtime-wrappers.h"
 
 #include "circt/Conversion/LLHDToLLVM/LLHDToLLVM.h"
 #include "circt/Dialect/LLHD/Simulator/Engine.h"
 
 #include "mlir/ExecutionEngine/ExecutionEngine.h"
 #include "mlir/IR/Builders.h"
-
+#include "mlir/IR/Threading.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/TargetSelect.h"
 
+#include <atomic>
+#include <chrono>
+
+using namespace circt;
+using namespace circt::llhd;
 using namespace circt::llhd::sim;
 
 Engine::Engine(
     llvm::raw_ostream &out, ModuleOp module,
     llvm::function_ref<mlir::LogicalResult(mlir::ModuleOp)> mlirTransformer,
     llvm::function_ref<llvm::Error(llvm::Module *)> llvmTransformer,
-    std::string root, int mode, ArrayRef<StringRef> sharedLibPaths)
-    : out(out), root(root), traceMode(mode) {
-  state = std::make_unique<State>();
+    std::string root, int mode, ArrayRef<StringRef> sharedLibPaths,
+    bool useTimingWheel, StringRef designLibPath, bool levelize)
+    : out(out), root(root), traceMode(mode), useTimingWheel(useTimingWheel) {
+  state = std::make_unique<State>(useTimingWheel);
   state->root = root + '.' + root;
 
   buildLayout(module);
+  if (levelize)
+    levelizeCombinational(module);
+  this->module = module;
+
+  // A precompiled design already has the explicit root instance and all the
+  // units lowered, so there is nothing left to compile.
+  if (!designLibPath.empty()) {
+    std::string errorMessage;
+    designLib = llvm::sys::DynamicLibrary::getPermanentLibrary(
+        designLibPath.str().c_str(), &errorMessage);
+    if (!designLib.isValid()) {
+      llvm::errs() << "failed to load the design library " << designLibPath
+                   << ": " << errorMessage << "\n";
+      exit(EXIT_FAILURE);
+    }
+    return;
+  }
 
   auto rootEntity = module.lookupSymbol<EntityOp>(root);
 
@@ -48,8 +79,6 @@ Engine::Engine(
     exit(EXIT_FAILURE);
   }
 
-  this->module = module;
-
   llvm::InitializeNativeTarget();
   llvm::InitializeNativeTargetAsmPrinter();
 
@@ -62,24 +91,315 @@ Engine::Engine(
 
 Engine::~Engine() = default;
 
+llvm::Expected<void (*)(void **)> Engine::lookup(StringRef name) {
+  if (engine)
+    return engine->lookup(name);
+
+  // The ExecutionEngine prefixes the packed wrappers it generates.
+  auto wrapperName = ("_mlir_" + name).str();
+  auto *symbol = designLib.getAddressOfSymbol(wrapperName.c_str());
+  if (!symbol)
+    return llvm::make_error<llvm::StringError>(
+        "symbol not found: " + wrapperName, llvm::inconvertibleErrorCode());
+  return reinterpret_cast<void (*)(void **)>(symbol);
+}
+
+bool Engine::dumpToObjectFile(StringRef filename) {
+  if (!engine) {
+    llvm::errs() << "the design was loaded precompiled\n";
+    return false;
+  }
+
+  // The JIT compiles the whole module the first time a symbol is looked up,
+  // which fills the object cache.
+  auto init = engine->lookup("llhd_init");
+  if (!init) {
+    llvm::errs() << "failed to compile the design: "
+                 << llvm::toString(init.takeError()) << "\n";
+    return false;
+  }
+  engine->dumpToObjectFile(filename);
+  return true;
+}
+
 void Engine::dumpStateLayout() { state->dumpLayout(); }
 
 void Engine::dumpStateSignalTriggers() { state->dumpSignalTriggers(); }
 
-int Engine::simulate(int n, uint64_t maxTime) {
-  assert(engine && "engine not found");
+/// Apply a drive at bit `offset` of a signal value of `width` bits, where the
+/// width is at most 64 bits, and return the updated value.
+static uint64_t applyDrive(uint64_t value, const APInt &drive, unsigned offset,
+                           unsigned width) {
+  if (drive.getBitWidth() >= width)
+    return drive.getRawData()[0] & llvm::maskTrailingOnes<uint64_t>(width);
+  uint64_t mask = llvm::maskTrailingOnes<uint64_t>(drive.getBitWidth())
+                  << offset;
+  return (value & ~mask) | ((drive.getRawData()[0] << offset) & mask);
+}
+
+/// Apply a drive at bit `offset` of the signal value of `width` bits stored in
+/// `value`, one byte at a time.
+static void applyDrive(uint8_t *value, const APInt &drive, unsigned offset,
+                       unsigned width) {
+  if (drive.getBitWidth() >= width) {
+    std::memcpy(value, drive.getRawData(), width / 8);
+    return;
+  }
+  for (unsigned bit = 0, e = drive.getBitWidth(); bit < e;) {
+    unsigned pos = offset + bit;
+    unsigned shift = pos % 8;
+    unsigned numBits = std::min(8 - shift, e - bit);
+    uint8_t mask = llvm::maskTrailingOnes<uint8_t>(numBits) << shift;
+    uint8_t bits = drive.extractBitsAsZExtValue(numBits, bit) << shift;
+    value[pos / 8] = (value[pos / 8] & ~mask) | bits;
+    bit += numBits;
+  }
+}
+
+/// Return the range of bytes of a signal value of `size` bytes that a drive at
+/// bit `offset` writes to.
+static std::pair<size_t, size_t> getDrivenBytes(unsigned offset,
+                                                const APInt &drive,
+                                                size_t size) {
+  if (drive.getBitWidth() >= size * 8)
+    return {0, size};
+  return {offset / 8, std::min<size_t>(
+                          size, llvm::divideCeil(offset + drive.getBitWidth(),
+                                                 8))};
+}
+
+/// Add the instances sensitive to a change of the specified signal to the
+/// wakeup queue.
+static void addTriggers(State &state, const Signal &sig,
+                        llvm::BitVector &wakeupQueue) {
+  for (size_t t = 0, te = sig.triggers.size(); t < te; ++t) {
+    auto inst = sig.triggers[t];
+    // Skip if the process is not currently sensible to the signal.
+    if (!state.instances[inst].isEntity) {
+      if (state.instances[inst].procState->senses[sig.triggerSenses[t]] == 0)
+        continue;
+
+      // Invalidate scheduled wakeup
+      state.instances[inst].expectedWakeup = Time();
+    }
+    wakeupQueue.set(inst);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// SimulationStats
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Counters of the work done by a simulation.
+struct SimulationStats {
+  /// Time one in this many runs of each instance.
+  static constexpr int64_t runSamplePeriod = 64;
+  /// Record the size of the queue once every this many cycles.
+  static constexpr int queueSamplePeriod = 1024;
+
+  SimulationStats(size_t numInstances)
+      : wakeups(numInstances), sampledRuns(numInstances),
+        sampledNanoseconds(numInstances) {}
+
+  /// Record the cycle processing the given slot.
+  void addCycle(int cycle, const Slot &slot, const UpdateQueue &queue);
+
+  /// Record the wakeup of an instance. Return true if its run is sampled.
+  bool addWakeup(unsigned inst) {
+    return wakeups[inst]++ % runSamplePeriod == 0;
+  }
+
+  /// Record the duration of a sampled run of an instance.
+  void addSampledRun(unsigned inst, std::chrono::steady_clock::duration d) {
+    ++sampledRuns[inst];
+    sampledNanoseconds[inst] +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+  }
+
+  /// Write the counters as JSON.
+  void write(llvm::raw_ostream &os, State &state, int cycles);
+
+  // The number of slots and signal changes processed.
+  int64_t numSlots = 0, numChanges = 0, maxChanges = 0;
+  // The number of real-time steps, and of delta and epsilon cycles in them.
+  int64_t numTimeSteps = 0, deltaCycles = 0, maxDeltaCycles = 0;
+  uint64_t lastRealTime = 0;
+  // The wakeups of each instance, and the runs of it that were timed.
+  std::vector<int64_t> wakeups, sampledRuns, sampledNanoseconds;
+  // The number of pending events at sampled cycles.
+  std::vector<std::pair<int, int64_t>> queueSizes;
+};
+} // namespace
+
+void SimulationStats::addCycle(int cycle, const Slot &slot,
+                               const UpdateQueue &queue) {
+  ++numSlots;
+  numChanges += slot.changesSize;
+  maxChanges = std::max<int64_t>(maxChanges, slot.changesSize);
+
+  if (numTimeSteps == 0 || slot.time.time != lastRealTime) {
+    ++numTimeSteps;
+    deltaCycles = 0;
+    lastRealTime = slot.time.time;
+  }
+  maxDeltaCycles = std::max(maxDeltaCycles, ++deltaCycles);
+
+  if (cycle % queueSamplePeriod == 0)
+    queueSizes.push_back({cycle, queue.events});
+}
+
+void SimulationStats::write(llvm::raw_ostream &os, State &state, int cycles) {
+  llvm::json::OStream json(os, /*IndentSize=*/2);
+  json.object([&] {
+    json.attribute("cycles", cycles);
+    json.attribute("finalTime", state.time.dump());
+    json.attributeObject("slots", [&] {
+      json.attribute("count", numSlots);
+      json.attribute("changes", numChanges);
+      json.attribute("maxChanges", maxChanges);
+    });
+    json.attributeObject("timeSteps", [&] {
+      json.attribute("count", numTimeSteps);
+      json.attribute("maxCycles", maxDeltaCycles);
+    });
+    json.attributeArray("queueSizes", [&] {
+      for (auto &sample : queueSizes)
+        json.array([&] {
+          json.value(sample.first);
+          json.value(sample.second);
+        });
+    });
+    json.attributeArray("instances", [&] {
+      for (size_t i = 0, e = state.instances.size(); i < e; ++i)
+        json.object([&] {
+          json.attribute("path", state.instances[i].path);
+          json.attribute("unit", state.instances[i].unit);
+          json.attribute("wakeups", wakeups[i]);
+          json.attribute("sampledRuns", sampledRuns[i]);
+          json.attribute("sampledNanoseconds", sampledNanoseconds[i]);
+        });
+    });
+  });
+  os << "\n";
+}
+
+//===----------------------------------------------------------------------===//
+// Engine
+//===----------------------------------------------------------------------===//
+
+void Engine::runInstance(std::unique_ptr<State> &state, unsigned index) {
+  auto &inst = state->instances[index];
+  auto signalTable = inst.sensitivityList.data();
+
+  // Gather the instance arguments for unit invocation.
+  SmallVector<void *, 3> args;
+  if (inst.isEntity)
+    args.assign({&state, &inst.entityState, &signalTable});
+  else {
+    args.assign({&state, &inst.procState, &signalTable});
+  }
+  // Run the unit.
+  (*inst.unitFPtr)(args.data());
+}
+
+void Engine::runInstances(std::unique_ptr<State> &state,
+                          const llvm::BitVector &wakeupQueue) {
+  SmallVector<unsigned, 8> batch;
+  SmallVector<void *, 8> instStates, sigTables;
+  auto it = wakeupQueue.set_bits_begin(), end = wakeupQueue.set_bits_end();
+  while (it != end) {
+    // Gather the instances of the same unit that follow each other.
+    batch.clear();
+    auto unitFPtr = state->instances[*it].unitFPtr;
+    for (; it != end && state->instances[*it].unitFPtr == unitFPtr; ++it)
+      batch.push_back(*it);
+
+    auto batchFPtr = state->instances[batch.front()].batchFPtr;
+    if (batch.size() == 1 || !batchFPtr) {
+      for (auto i : batch)
+        runInstance(state, i);
+      continue;
+    }
+
+    instStates.clear();
+    sigTables.clear();
+    for (auto i : batch) {
+      auto &inst = state->instances[i];
+      if (inst.isEntity)
+        instStates.push_back(inst.entityState.get());
+      else
+        instStates.push_back(inst.procState.get());
+      sigTables.push_back(inst.sensitivityList.data());
+    }
+
+    // Run the unit for all the instances of the batch.
+    auto instStatesPtr = instStates.data();
+    auto sigTablesPtr = sigTables.data();
+    int64_t size = batch.size();
+    SmallVector<void *, 4> args(
+        {&state, &instStatesPtr, &sigTablesPtr, &size});
+    (*batchFPtr)(args.data());
+  }
+}
+
+std::unique_ptr<State> Engine::createState() const {
+  return state->cloneLayout(useTimingWheel);
+}
+
+int Engine::simulate(int n, uint64_t maxTime, bool parallel,
+                     StringRef restoreFile, StringRef checkpointFile,
+                     StringRef statsFile) {
+  return simulate(state, out, n, maxTime, parallel, restoreFile,
+                  checkpointFile, statsFile);
+}
+
+int Engine::simulateConcurrently(
+    unsigned count, llvm::function_ref<llvm::raw_ostream &(unsigned)> getOutput,
+    int n, uint64_t maxTime, bool parallel, StringRef restoreFile) {
+  std::atomic<bool> anyFailed(false);
+  mlir::parallelForEachN(module.getContext(), 0, count, [&](size_t i) {
+    auto runState = createState();
+    if (simulate(runState, getOutput(i), n, maxTime, parallel, restoreFile,
+                 /*checkpointFile=*/{}, /*statsFile=*/{}) < 0)
+      anyFailed = true;
+  });
+  return anyFailed ? -1 : 0;
+}
+
+int Engine::simulate(std::unique_ptr<State> &state, llvm::raw_ostream &out,
+                     int n, uint64_t maxTime, bool parallel,
+                     StringRef restoreFile, StringRef checkpointFile,
+                     StringRef statsFile) {
+  assert((engine || designLib.isValid()) && "engine not found");
   assert(state && "state not found");
 
   auto tm = static_cast<TraceMode>(traceMode);
-  Trace trace(state, out, tm);
+  Trace trace(state, out, tm, traceFilter);
 
   SmallVector<void *, 1> arg({&state});
   // Initialize tbe simulation state.
-  auto invocationResult = engine->invokePacked("llhd_init", arg);
-  if (invocationResult) {
-    llvm::errs() << "Failed invocation of llhd_init: " << invocationResult;
+  auto init = lookup("llhd_init");
+  if (!init) {
+    llvm::errs() << "Failed invocation of llhd_init: "
+                 << llvm::toString(init.takeError()) << "\n";
     return -1;
   }
+  (*init)(arg.data());
+
+  // Keep all the signal values close together now that they are initialized.
+  state->packSignalValues();
+
+  // Restore the simulation from a checkpoint. It contains the pending events,
+  // so the simulation carries on without running all the instances first.
+  bool isRestored = !restoreFile.empty();
+  if (isRestored) {
+    auto buffer = llvm::MemoryBuffer::getFile(restoreFile);
+    if (!buffer || !state->restoreCheckpoint((*buffer)->getBuffer())) {
+      llvm::errs() << "Failed to restore checkpoint " << restoreFile << "\n";
+      return -1;
+    }
+  }
 
   if (traceMode >= 0) {
     // Add changes for all the signals' initial values.
@@ -89,28 +409,68 @@ int Engine::simulate(int n, uint64_t maxTime) {
   }
 
   // Add a dummy event to get the simulation started.
-  state->queue.push_back(Slot(Time()));
-  ++state->queue.events;
+  if (!isRestored)
+    state->queue->getOrCreateSlot(Time());
 
-  // Keep track of the instances that need to wakeup.
-  llvm::SmallVector<unsigned, 8> wakeupQueue;
+  // Keep track of the instances that need to wakeup. The instances are run in
+  // order, once per cycle.
+  llvm::BitVector wakeupQueue(state->instances.size());
+
+  // The initial value of the wide signal being updated.
+  llvm::SmallVector<uint8_t, 64> initialValue;
+
+  // The instances woken up in a cycle and the events they spawn, when running
+  // them in parallel.
+  llvm::SmallVector<unsigned, 8> woken;
+  std::vector<DeferredEvents> deferred;
+
+  // The drives of the statically scheduled instance being evaluated.
+  DeferredEvents staticDrives;
+
+  // The events of the instances run in a cycle, when running them in order.
+  DeferredEvents deferredEvents;
+
+  // The counters of the simulation, if they are requested.
+  std::unique_ptr<SimulationStats> stats;
+  if (!statsFile.empty())
+    stats = std::make_unique<SimulationStats>(state->instances.size());
+
+  // Run an instance, timing a sample of the runs when collecting statistics.
+  auto run = [&](unsigned i) {
+    if (!stats || !stats->addWakeup(i)) {
+      runInstance(state, i);
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    runInstance(state, i);
+    stats->addSampledRun(i, std::chrono::steady_clock::now() - start);
+  };
 
   // Add all instances to the wakeup queue for the first run and add the jitted
   // function pointers to all of the instances to make them readily available.
   for (size_t i = 0, e = state->instances.size(); i < e; ++i) {
-    wakeupQueue.push_back(i);
+    if (!isRestored)
+      wakeupQueue.set(i);
     auto &inst = state->instances[i];
-    auto expectedFPtr = engine->lookup(inst.unit);
+    auto expectedFPtr = lookup(inst.unit);
     if (!expectedFPtr) {
+      llvm::consumeError(expectedFPtr.takeError());
       llvm::errs() << "Could not lookup " << inst.unit << "!\n";
       return -1;
     }
     inst.unitFPtr = *expectedFPtr;
+
+    // Designs compiled before batched units were introduced do not have them.
+    auto expectedBatchFPtr = lookup(inst.unit + "_batch");
+    if (expectedBatchFPtr)
+      inst.batchFPtr = *expectedBatchFPtr;
+    else
+      llvm::consumeError(expectedBatchFPtr.takeError());
   }
 
   int cycle = 0;
-  while (state->queue.events > 0) {
-    const auto &pop = state->queue.top();
+  while (state->queue->events > 0) {
+    const auto &pop = state->queue->top();
 
     // Interrupt the simulation if a stop condition is met.
     if ((n > 0 && cycle >= n) || (maxTime > 0 && pop.time.time > maxTime)) {
@@ -119,6 +479,8 @@ int Engine::simulate(int n, uint64_t maxTime) {
 
     // Update the simulation time.
     state->time = pop.time;
+    if (stats)
+      stats->addCycle(cycle, pop, *state->queue);
 
     if (traceMode >= 0)
       trace.flush();
@@ -128,50 +490,48 @@ int Engine::simulate(int n, uint64_t maxTime) {
     while (i < e) {
       const auto sigIndex = pop.changes[i].first;
       const auto &curr = state->signals[sigIndex];
-      APInt buff(
-          curr.size * 8,
-          llvm::makeArrayRef(reinterpret_cast<uint64_t *>(curr.value.get()),
-                             llvm::divideCeil(curr.size, 8)));
-
-      // Apply the changes to the buffer until we reach the next signal.
-      while (i < e && pop.changes[i].first == sigIndex) {
-        const auto &change = pop.buffers[pop.changes[i].second];
-        const auto offset = change.first;
-        const auto &drive = change.second;
-        if (drive.getBitWidth() < buff.getBitWidth())
-          buff.insertBits(drive, offset);
-        else
-          buff = drive;
-
-        ++i;
-      }
+      auto *value = curr.value;
+      unsigned width = curr.size * 8;
+
+      // Apply the changes to the signal value until we reach the next signal.
+      // Values of up to 64 bits are updated as a single word, wider ones in
+      // place, keeping a copy of the initial value.
+      if (width <= 64) {
+        uint64_t initial = loadWord(value, curr.size);
+        uint64_t updated = initial;
+        for (; i < e && pop.changes[i].first == sigIndex; ++i) {
+          const auto &change = pop.buffers[pop.changes[i].second];
+          updated = applyDrive(updated, change.second, change.first, width);
+        }
 
-      // Skip if the updated signal value is equal to the initial value.
-      if (std::memcmp(curr.value.get(), buff.getRawData(), curr.size) == 0)
-        continue;
+        // Skip if the updated signal value is equal to the initial value.
+        if (updated == initial)
+          continue;
+        storeWord(value, updated, curr.size);
+      } else {
+        // Only copy the bytes the changes write to, such that the drive of an
+        // element of a large memory does not copy all of it.
+        size_t lo = curr.size, hi = 0;
+        for (size_t j = i; j < e && pop.changes[j].first == sigIndex; ++j) {
+          const auto &change = pop.buffers[pop.changes[j].second];
+          auto bytes = getDrivenBytes(change.first, change.second, curr.size);
+          lo = std::min(lo, bytes.first);
+          hi = std::max(hi, bytes.second);
+        }
+        initialValue.assign(value + lo, value + hi);
+        for (; i < e && pop.changes[i].first == sigIndex; ++i) {
+          const auto &change = pop.buffers[pop.changes[i].second];
+          applyDrive(value, change.second, change.first, width);
+        }
 
-      // Apply the signal update.
-      std::memcpy(curr.value.get(), buff.getRawData(), curr.size);
+        // Skip if the updated signal value is equal to the initial value.
+        if (lo >= hi ||
+            std::memcmp(value + lo, initialValue.data(), hi - lo) == 0)
+          continue;
+      }
 
       // Add sensitive instances.
-      for (auto inst : curr.triggers) {
-        // Skip if the process is not currently sensible to the signal.
-        if (!state->instances[inst].isEntity) {
-          const auto &sensList = state->instances[inst].sensitivityList;
-          auto it = std::find_if(sensList.begin(), sensList.end(),
-                                 [sigIndex](const SignalDetail &sig) {
-                                   return sig.globalIndex == sigIndex;
-                                 });
-          if (sensList.end() != it &&
-              state->instances[inst].procState->senses[it - sensList.begin()] ==
-                  0)
-            continue;
-
-          // Invalidate scheduled wakeup
-          state->instances[inst].expectedWakeup = Time();
-        }
-        wakeupQueue.push_back(inst);
-      }
+      addTriggers(*state, curr, wakeupQueue);
 
       // Dump the updated signal.
       if (traceMode >= 0)
@@ -181,33 +541,86 @@ int Engine::simulate(int n, uint64_t maxTime) {
     // Add scheduled process resumes to the wakeup queue.
     for (auto inst : pop.scheduled) {
       if (state->time == state->instances[inst].expectedWakeup)
-        wakeupQueue.push_back(inst);
+        wakeupQueue.set(inst);
     }
 
-    state->queue.pop();
+    state->queue->pop();
 
-    std::sort(wakeupQueue.begin(), wakeupQueue.end());
-    wakeupQueue.erase(std::unique(wakeupQueue.begin(), wakeupQueue.end()),
-                      wakeupQueue.end());
+    // Evaluate the statically scheduled instances that were woken up first, in
+    // topological order, such that the instances they wake up in turn come
+    // later in the same sweep. Their drives take effect right away.
+    for (auto i : staticSchedule) {
+      if (!wakeupQueue.test(i))
+        continue;
+      wakeupQueue.reset(i);
+      setDeferredEvents(&staticDrives);
+      run(i);
+      setDeferredEvents(nullptr);
+      staticDrives.applyDrives(
+          [&](unsigned sigIndex, int bitOffset, const APInt &drive) {
+            auto &sig = state->signals[sigIndex];
+            if (sig.size <= 8) {
+              auto initial = loadWord(sig.value, sig.size);
+              auto updated =
+                  applyDrive(initial, drive, bitOffset, sig.size * 8);
+              if (updated == initial)
+                return;
+              storeWord(sig.value, updated, sig.size);
+            } else {
+              auto bytes = getDrivenBytes(bitOffset, drive, sig.size);
+              initialValue.assign(sig.value + bytes.first,
+                                  sig.value + bytes.second);
+              applyDrive(sig.value, drive, bitOffset, sig.size * 8);
+              if (std::memcmp(sig.value + bytes.first, initialValue.data(),
+                              initialValue.size()) == 0)
+                return;
+            }
+            addTriggers(*state, sig, wakeupQueue);
+            if (traceMode >= 0)
+              trace.addChange(sigIndex);
+          });
+      // The instance is sensitive to the signals it drives, but does not
+      // depend on them.
+      wakeupQueue.reset(i);
+    }
 
     // Run the instances present in the wakeup queue.
-    for (auto i : wakeupQueue) {
-      auto &inst = state->instances[i];
-      auto signalTable = inst.sensitivityList.data();
-
-      // Gather the instance arguments for unit invocation.
-      SmallVector<void *, 3> args;
-      if (inst.isEntity)
-        args.assign({&state, &inst.entityState, &signalTable});
-      else {
-        args.assign({&state, &inst.procState, &signalTable});
+    if (parallel) {
+      // The instances only observe the signal values of this cycle, and the
+      // events they spawn are deferred until they all ran, so they can run in
+      // any order. The events are added to the queue in the order of the
+      // instances, which keeps the simulation deterministic.
+      woken.assign(wakeupQueue.set_bits_begin(), wakeupQueue.set_bits_end());
+      if (stats)
+        for (auto i : woken)
+          stats->addWakeup(i);
+      if (deferred.size() < woken.size())
+        deferred.resize(woken.size());
+      mlir::parallelForEachN(module.getContext(), 0, woken.size(),
+                             [&](size_t i) {
+                               setDeferredEvents(&deferred[i]);
+                               runInstance(state, woken[i]);
+                               setDeferredEvents(nullptr);
+                             });
+      for (size_t i = 0, e = woken.size(); i < e; ++i)
+        deferred[i].flush(*state);
+    } else {
+      // Buffer the events of all the instances, and add them to the queue in
+      // bulk once they ran. When collecting statistics, the instances run one
+      // by one so that their runs can be timed.
+      setDeferredEvents(&deferredEvents);
+      if (stats) {
+        for (auto i : wakeupQueue.set_bits())
+          run(i);
+      } else {
+        runInstances(state, wakeupQueue);
       }
-      // Run the unit.
-      (*inst.unitFPtr)(args.data());
+      setDeferredEvents(nullptr);
+      deferredEvents.flush(*state);
     }
 
     // Clear wakeup queue.
-    wakeupQueue.clear();
+    wakeupQueue.reset();
     ++cycle;
   }
 
@@ -216,14 +629,120 @@ int Engine::simulate(int n, uint64_t maxTime) {
     trace.flush(/*force=*/true);
   }
 
+  // Save the state the simulation stopped in, including the pending events.
+  if (!checkpointFile.empty()) {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(checkpointFile, ec);
+    if (ec) {
+      llvm::errs() << "Failed to write checkpoint " << checkpointFile << ": "
+                   << ec.message() << "\n";
+      return -1;
+    }
+    state->saveCheckpoint(os);
+  }
+
+  if (stats) {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(statsFile, ec);
+    if (ec) {
+      llvm::errs() << "Failed to write statistics " << statsFile << ": "
+                   << ec.message() << "\n";
+      return -1;
+    }
+    stats->write(os, *state, cycle);
+  }
+
   llvm::errs() << "Finished at " << state->time.dump() << " (" << cycle
                << " cycles)\n";
   return 0;
 }
 
+namespace {
+/// Where an argument of an instance comes from in the entity creating it.
+struct ArgSource {
+  enum Kind { None, Argument, Signal } kind = None;
+  /// The number of the argument, or of the signal among those of the entity.
+  unsigned index = 0;
+};
+
+/// The signals and instances an entity creates, in the order of its body.
+/// This only depends on the entity, so all its instances share it.
+struct EntityLayout {
+  struct Item {
+    /// The name of the signal or of the instance.
+    std::string name;
+    /// The unit of an instance, or null for a signal.
+    Operation *unit = nullptr;
+    std::string callee;
+    llvm::SmallVector<ArgSource, 4> args;
+  };
+  std::vector<Item> items;
+};
+} // namespace
+
+/// The layouts of the entities of the design, built when an entity is first
+/// instantiated.
+struct Engine::LayoutCache {
+  LayoutCache(ModuleOp module) : symbolTable(module) {}
+
+  /// Return the layout of `entity`.
+  const EntityLayout &get(EntityOp entity);
+
+  SymbolTable symbolTable;
+  llvm::DenseMap<Operation *, std::unique_ptr<EntityLayout>> layouts;
+};
+
+const EntityLayout &Engine::LayoutCache::get(EntityOp entity) {
+  auto &layout = layouts[entity.getOperation()];
+  if (layout)
+    return *layout;
+  layout = std::make_unique<EntityLayout>();
+
+  // A signal passed to an instance is the first one of the entity with its
+  // name, if it is defined before the instance.
+  llvm::DenseMap<Operation *, unsigned> sigIndices;
+  llvm::StringMap<unsigned> firstSigIndices;
+  entity.walk([&](Operation *op) {
+    if (auto sig = dyn_cast<SigOp>(op)) {
+      unsigned index = sigIndices.size();
+      sigIndices.insert({op, index});
+      firstSigIndices.insert({sig.name(), index});
+      layout->items.push_back({sig.name().str(), nullptr, {}, {}});
+      return;
+    }
+    auto inst = dyn_cast<InstOp>(op);
+    if (!inst)
+      return;
+    auto *unit = symbolTable.lookup(inst.callee());
+    if (!unit)
+      return;
+
+    EntityLayout::Item item;
+    item.name = inst.name().str();
+    item.unit = unit;
+    item.callee = inst.callee().str();
+    llvm::SmallVector<Value, 8> args;
+    args.insert(args.end(), inst.inputs().begin(), inst.inputs().end());
+    args.insert(args.end(), inst.outputs().begin(), inst.outputs().end());
+    for (auto arg : args) {
+      ArgSource source;
+      if (auto blockArg = arg.dyn_cast<BlockArgument>()) {
+        source = {ArgSource::Argument, blockArg.getArgNumber()};
+      } else if (auto sig = dyn_cast<SigOp>(arg.getDefiningOp())) {
+        if (sigIndices.count(sig.getOperation()))
+          source = {ArgSource::Signal, firstSigIndices.lookup(sig.name())};
+      }
+      item.args.push_back(source);
+    }
+    layout->items.push_back(std::move(item));
+  });
+  return *layout;
+}
+
 void Engine::buildLayout(ModuleOp module) {
   // Start from the root entity.
-  auto rootEntity = module.lookupSymbol<EntityOp>(root);
+  LayoutCache cache(module);
+  auto rootEntity = cache.symbolTable.lookup<EntityOp>(root);
   assert(rootEntity && "root entity not found!");
 
   // Build root instance, the parent and instance names are the same for the
@@ -233,87 +752,207 @@ void Engine::buildLayout(ModuleOp module) {
   rootInst.path = root;
 
   // Recursively walk the units starting at root.
-  walkEntity(rootEntity, rootInst);
+  walkEntity(rootEntity, rootInst, cache);
 
   // The root is always an instance.
   rootInst.isEntity = true;
   // Store the root instance.
   state->instances.push_back(std::move(rootInst));
 
-  // Add triggers to signals.
+  // Add triggers to signals, along with the first entry of the signal in the
+  // sensitivity list of the instance, which holds its sense.
+  llvm::DenseMap<uint64_t, unsigned> firstEntries;
   for (size_t i = 0, e = state->instances.size(); i < e; ++i) {
     auto &inst = state->instances[i];
-    for (auto trigger : inst.sensitivityList) {
-      state->signals[trigger.globalIndex].triggers.push_back(i);
+    firstEntries.clear();
+    for (size_t j = 0, je = inst.sensitivityList.size(); j < je; ++j) {
+      auto globalIndex = inst.sensitivityList[j].globalIndex;
+      auto &sig = state->signals[globalIndex];
+      sig.triggers.push_back(i);
+      sig.triggerSenses.push_back(
+          firstEntries.insert({globalIndex, j}).first->second);
     }
   }
 }
 
-void Engine::walkEntity(EntityOp entity, Instance &child) {
+/// Return the index in the sensitivity list of an entity instance of the signal
+/// that `value` is a part of, where `sigIndices` numbers the signals defined by
+/// the entity, or -1 if the signal is not known.
+static int
+getSignalEntry(Value value,
+               const llvm::DenseMap<Operation *, unsigned> &sigIndices,
+               unsigned numArgs) {
+  while (true) {
+    if (auto blockArg = value.dyn_cast<BlockArgument>())
+      return blockArg.getArgNumber();
+    auto *op = value.getDefiningOp();
+    if (isa<SigOp>(op))
+      return numArgs + sigIndices.lookup(op);
+    // Look through the operations selecting a part of a signal.
+    if (op->getNumOperands() == 0 ||
+        !op->getOperand(0).getType().isa<SigType>())
+      return -1;
+    value = op->getOperand(0);
+  }
+}
+
+/// Return true if the drive only has a delta or epsilon delay.
+static bool hasZeroTimeDelay(DrvOp drv) {
+  auto constOp = drv.time().getDefiningOp<ConstOp>();
+  if (!constOp)
+    return false;
+  auto time = constOp.value().dyn_cast<TimeAttr>();
+  return time && time.getTime() == 0;
+}
+
+namespace {
+/// The entries of the sensitivity list of the instances of a combinational
+/// entity, which are the same for all of them.
+struct CombinationalEntity {
+  unsigned numEntries;
+  llvm::SmallVector<int, 4> drivenEntries;
+};
+} // namespace
+
+/// Return the entries an instance of `entity` drives if the entity is
+/// combinational, or None. An entity is combinational if it has no registers,
+/// instances or connections, all of its drives have no real time delay, and it
+/// does not probe the signals it drives.
+static Optional<CombinationalEntity> analyzeCombinational(EntityOp entity) {
+  llvm::DenseMap<Operation *, unsigned> sigIndices;
+  bool combinational = true;
   entity.walk([&](Operation *op) {
-    assert(op);
+    if (isa<SigOp>(op))
+      sigIndices.insert({op, sigIndices.size()});
+    else if (isa<RegOp, InstOp, ConnectOp>(op))
+      combinational = false;
+    else if (auto drv = dyn_cast<DrvOp>(op))
+      combinational &= hasZeroTimeDelay(drv);
+  });
+  if (!combinational)
+    return llvm::None;
+
+  unsigned numArgs = entity.getNumArguments();
+  CombinationalEntity result;
+  result.numEntries = numArgs + sigIndices.size();
+  llvm::SmallVector<int, 4> probedEntries;
+  entity.walk([&](Operation *op) {
+    if (auto prb = dyn_cast<PrbOp>(op))
+      probedEntries.push_back(
+          getSignalEntry(prb.signal(), sigIndices, numArgs));
+    else if (auto drv = dyn_cast<DrvOp>(op))
+      result.drivenEntries.push_back(
+          getSignalEntry(drv.signal(), sigIndices, numArgs));
+  });
+  if (llvm::is_contained(result.drivenEntries, -1) ||
+      llvm::any_of(result.drivenEntries, [&](int entry) {
+        return llvm::is_contained(probedEntries, entry) ||
+               llvm::is_contained(probedEntries, -1);
+      }))
+    return llvm::None;
+  return result;
+}
 
+void Engine::levelizeCombinational(ModuleOp module) {
+  // Find the combinational entity instances, along with the signals they
+  // drive. Each entity is analyzed once for all its instances.
+  auto numInstances = state->instances.size();
+  std::vector<llvm::SmallVector<uint64_t, 4>> drivenSignals(numInstances);
+  llvm::BitVector isCombinational(numInstances);
+  SymbolTable symbolTable(module);
+  llvm::StringMap<Optional<CombinationalEntity>> entities;
+  for (size_t i = 0; i < numInstances; ++i) {
+    auto &inst = state->instances[i];
+    if (!inst.isEntity)
+      continue;
+    auto it = entities.find(inst.unit);
+    if (it == entities.end()) {
+      Optional<CombinationalEntity> analysis;
+      if (auto entity = symbolTable.lookup<EntityOp>(inst.unit))
+        analysis = analyzeCombinational(entity);
+      it = entities.insert({inst.unit, std::move(analysis)}).first;
+    }
+    auto &analysis = it->second;
+    if (!analysis || inst.sensitivityList.size() != analysis->numEntries)
+      continue;
+
+    for (auto entry : analysis->drivenEntries)
+      drivenSignals[i].push_back(inst.sensitivityList[entry].globalIndex);
+    isCombinational.set(i);
+  }
+
+  // Order the combinational instances topologically, such that an instance
+  // comes after the ones driving the signals it is sensitive to. The instances
+  // in or after a combinational loop are left to the event queue.
+  std::vector<llvm::SmallVector<unsigned, 4>> successors(numInstances);
+  std::vector<unsigned> numPredecessors(numInstances, 0);
+  for (auto i : isCombinational.set_bits()) {
+    for (auto sigIndex : drivenSignals[i]) {
+      for (auto succ : state->signals[sigIndex].triggers) {
+        if (succ == i || !isCombinational.test(succ) ||
+            llvm::is_contained(successors[i], succ))
+          continue;
+        successors[i].push_back(succ);
+        ++numPredecessors[succ];
+      }
+    }
+  }
+  for (auto i : isCombinational.set_bits())
+    if (numPredecessors[i] == 0)
+      staticSchedule.push_back(i);
+  for (size_t next = 0; next < staticSchedule.size(); ++next)
+    for (auto succ : successors[staticSchedule[next]])
+      if (--numPredecessors[succ] == 0)
+        staticSchedule.push_back(succ);
+}
+
+void Engine::walkEntity(EntityOp entity, Instance &child,
+                        LayoutCache &cache) {
+  // The entry of each signal of the entity in the sensitivity list.
+  llvm::SmallVector<unsigned, 8> sigEntries;
+  for (auto &item : cache.get(entity).items) {
     // Add a signal to the signal table.
-    if (auto sig = dyn_cast<SigOp>(op)) {
-      uint64_t index = state->addSignal(sig.name().str(), child.name);
+    if (!item.unit) {
+      uint64_t index = state->addSignal(item.name, child.name);
+      sigEntries.push_back(child.sensitivityList.size());
       child.sensitivityList.push_back(
           SignalDetail({nullptr, 0, child.sensitivityList.size(), index}));
+      continue;
     }
 
-    // Build (recursive) instance layout.
-    if (auto inst = dyn_cast<InstOp>(op)) {
-      // Skip self-recursion.
-      if (inst.callee() == child.name)
-        return;
-      if (auto e =
-              op->getParentOfType<ModuleOp>().lookupSymbol(inst.callee())) {
-        Instance newChild(child.unit + '.' + inst.name().str());
-        newChild.unit = inst.callee().str();
-        newChild.nArgs = inst.getNumOperands();
-        newChild.path = child.path + "/" + inst.name().str();
-
-        // Add instance arguments to sensitivity list. The first nArgs signals
-        // in the sensitivity list represent the unit's arguments, while the
-        // following ones represent the unit-defined signals.
-        llvm::SmallVector<Value, 8> args;
-        args.insert(args.end(), inst.inputs().begin(), inst.inputs().end());
-        args.insert(args.end(), inst.outputs().begin(), inst.outputs().end());
-
-        for (size_t i = 0, e = args.size(); i < e; ++i) {
-          // The signal comes from an instance's argument.
-          if (auto blockArg = args[i].dyn_cast<BlockArgument>()) {
-            auto detail = child.sensitivityList[blockArg.getArgNumber()];
-            detail.instIndex = i;
-            newChild.sensitivityList.push_back(detail);
-          } else if (auto sig = dyn_cast<SigOp>(args[i].getDefiningOp())) {
-            // The signal comes from one of the instance's owned signals.
-            auto it = std::find_if(
-                child.sensitivityList.begin(), child.sensitivityList.end(),
-                [&](SignalDetail &detail) {
-                  return state->signals[detail.globalIndex].name ==
-                             sig.name() &&
-                         state->signals[detail.globalIndex].owner == child.name;
-                });
-            if (it != child.sensitivityList.end()) {
-              auto detail = *it;
-              detail.instIndex = i;
-              newChild.sensitivityList.push_back(detail);
-            }
-          }
-        }
-
-        // Recursively walk a new entity, otherwise it is a process and cannot
-        // define new signals or instances.
-        if (auto ent = dyn_cast<EntityOp>(e)) {
-          newChild.isEntity = true;
-          walkEntity(ent, newChild);
-        } else {
-          newChild.isEntity = false;
-        }
+    // Build (recursive) instance layout, skipping self-recursion.
+    if (item.callee == child.name)
+      continue;
+    Instance newChild(child.unit + '.' + item.name);
+    newChild.unit = item.callee;
+    newChild.nArgs = item.args.size();
+    newChild.path = child.path + "/" + item.name;
+
+    // Add instance arguments to sensitivity list. The first nArgs signals in
+    // the sensitivity list represent the unit's arguments, while the following
+    // ones represent the unit-defined signals.
+    for (size_t i = 0, e = item.args.size(); i < e; ++i) {
+      auto &source = item.args[i];
+      if (source.kind == ArgSource::None)
+        continue;
+      auto entry = source.kind == ArgSource::Argument
+                       ? source.index
+                       : sigEntries[source.index];
+      auto detail = child.sensitivityList[entry];
+      detail.instIndex = i;
+      newChild.sensitivityList.push_back(detail);
+    }
 
-        // Store the created instance.
-        state->instances.push_back(std::move(newChild));
-      }
+    // Recursively walk a new entity, otherwise it is a process and cannot
+    // define new signals or instances.
+    if (auto ent = dyn_cast<EntityOp>(item.unit)) {
+      newChild.isEntity = true;
+      walkEntity(ent, newChild, cache);
+    } else {
+      newChild.isEntity = false;
     }
-  });
+
+    // Store the created instance.
+    state->instances.push_back(std::move(newChild));
+  }
 }
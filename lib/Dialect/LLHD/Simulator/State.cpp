@@ -13,7 +13,9 @@
 
 #include "State.h"
 
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <string>
@@ -66,7 +68,7 @@ Signal::Signal(std::string name, std::string owner, uint8_t *value,
 bool Signal::operator==(const Signal &rhs) const {
   if (owner != rhs.owner || name != rhs.name || size != rhs.size)
     return false;
-  return std::memcmp(value.get(), rhs.value.get(), size);
+  return std::memcmp(value, rhs.value, size);
 }
 
 bool Signal::operator<(const Signal &rhs) const {
@@ -82,7 +84,7 @@ std::string Signal::dump() {
   raw_string_ostream ss(ret);
   ss << "0x";
   for (int i = size - 1; i >= 0; --i) {
-    ss << format_hex_no_prefix(static_cast<int>(value.get()[i]), 2);
+    ss << format_hex_no_prefix(static_cast<int>(value[i]), 2);
   }
   return ss.str();
 }
@@ -90,7 +92,7 @@ std::string Signal::dump() {
 std::string Signal::dump(unsigned elemIndex) {
   assert(elements.size() > 0 && "the signal type has to be tuple or array!");
   auto elemSize = elements[elemIndex].second;
-  auto ptr = value.get() + elements[elemIndex].first;
+  auto ptr = value + elements[elemIndex].first;
   std::string ret;
   raw_string_ostream ss(ret);
   ss << "0x";
@@ -109,20 +111,21 @@ bool Slot::operator>(const Slot &rhs) const { return rhs.time < time; }
 
 void Slot::insertChange(int index, int bitOffset, uint8_t *bytes,
                         unsigned width) {
-  // Get the amount of 64 bit words required to store the value in an APInt.
-  auto size = llvm::divideCeil(width, 64);
+  // Values of up to 64 bits are read as a single word, wider ones as the
+  // amount of 64 bit words required to store the value in an APInt.
+  APInt value =
+      width <= 64
+          ? APInt(width, loadWord(bytes, llvm::divideCeil(width, 8)))
+          : APInt(width, makeArrayRef(reinterpret_cast<uint64_t *>(bytes),
+                                      llvm::divideCeil(width, 64)));
 
   if (changesSize >= buffers.size()) {
     // Create a new change buffer if we don't have any unused one available for
     // reuse.
-    buffers.push_back(std::make_pair(
-        bitOffset,
-        APInt(width, makeArrayRef(reinterpret_cast<uint64_t *>(bytes), size))));
+    buffers.push_back(std::make_pair(bitOffset, std::move(value)));
   } else {
     // Reuse the first available buffer.
-    buffers[changesSize] = std::make_pair(
-        bitOffset,
-        APInt(width, makeArrayRef(reinterpret_cast<uint64_t *>(bytes), size)));
+    buffers[changesSize] = std::make_pair(bitOffset, std::move(value));
   }
 
   // Map the signal index to the change buffer so we can retrieve
@@ -147,67 +150,42 @@ void UpdateQueue::insertOrUpdate(Time time, unsigned inst) {
   slot.insertChange(inst);
 }
 
-Slot &UpdateQueue::getOrCreateSlot(Time time) {
-  auto &top = begin()[topSlot];
-
-  // Directly add to top slot.
-  if (!top.unused && time == top.time) {
-    return top;
-  }
+const Slot &UpdateQueue::top() {
+  // Sort the changes of the top slot such that all changes to the same signal
+  // are in succession.
+  auto &top = slots[getTopSlot()];
+  llvm::sort(top.changes.begin(), top.changes.begin() + top.changesSize);
+  return top;
+}
 
-  // We need to search through the queue for an existing slot only if we're
-  // spawning an event later than the top slot. Adding to an existing slot
-  // scheduled earlier than the top slot should never happens, as then it should
-  // be the top.
-  if (events > 0 && top.time < time) {
-    for (size_t i = 0, e = size(); i < e; ++i) {
-      if (time == begin()[i].time) {
-        return begin()[i];
-      }
-    }
-  }
+unsigned UpdateQueue::allocateSlot(Time time) {
+  ++events;
 
   // Spawn new event using an existing slot.
   if (!unused.empty()) {
     auto firstUnused = unused.pop_back_val();
-    auto &newSlot = begin()[firstUnused];
+    auto &newSlot = slots[firstUnused];
     newSlot.unused = false;
     newSlot.time = time;
-
-    // Update the top of the queue either if it is currently unused or the new
-    // timestamp is earlier than it.
-    if (top.unused || time < top.time)
-      topSlot = firstUnused;
-
-    ++events;
-    return newSlot;
+    return firstUnused;
   }
 
   // We do not have pre-allocated slots available, generate a new one.
-  push_back(Slot(time));
-
-  // Update the top of the queue either if it is currently unused or the new
-  // timestamp is earlier than it.
-  if (top.unused || time < top.time)
-    topSlot = size() - 1;
-
-  ++events;
-  return back();
+  slots.push_back(Slot(time));
+  return slots.size() - 1;
 }
 
-const Slot &UpdateQueue::top() {
-  assert(topSlot < size() && "top is pointing out of bounds!");
-
-  // Sort the changes of the top slot such that all changes to the same signal
-  // are in succession.
-  auto &top = begin()[topSlot];
-  llvm::sort(top.changes.begin(), top.changes.begin() + top.changesSize);
-  return top;
+void UpdateQueue::getPendingSlots(
+    llvm::SmallVectorImpl<const Slot *> &result) const {
+  for (auto &slot : slots) {
+    if (!slot.unused)
+      result.push_back(&slot);
+  }
 }
 
-void UpdateQueue::pop() {
+void UpdateQueue::releaseSlot(unsigned index) {
   // Reset internal structures and decrease the event counter.
-  auto &curr = begin()[topSlot];
+  auto &curr = slots[index];
   curr.unused = true;
   curr.changesSize = 0;
   curr.scheduled.clear();
@@ -216,40 +194,266 @@ void UpdateQueue::pop() {
   --events;
 
   // Add to unused slots list for easy retrieval.
-  unused.push_back(topSlot);
+  unused.push_back(index);
+}
+
+//===----------------------------------------------------------------------===//
+// SlotListQueue
+//===----------------------------------------------------------------------===//
+
+Slot &SlotListQueue::getOrCreateSlot(Time time) {
+  if (events > 0) {
+    auto &top = slots[topSlot];
+
+    // Directly add to top slot.
+    if (time == top.time)
+      return top;
+
+    // We need to search through the queue for an existing slot only if we're
+    // spawning an event later than the top slot. Adding to an existing slot
+    // scheduled earlier than the top slot should never happens, as then it
+    // should be the top.
+    if (top.time < time) {
+      for (auto &slot : slots) {
+        if (!slot.unused && time == slot.time)
+          return slot;
+      }
+    }
+  }
+
+  auto index = allocateSlot(time);
+
+  // Update the top of the queue either if it was empty or the new timestamp is
+  // earlier than it.
+  if (events == 1 || time < slots[topSlot].time)
+    topSlot = index;
+  return slots[index];
+}
+
+unsigned SlotListQueue::getTopSlot() {
+  assert(topSlot < slots.size() && "top is pointing out of bounds!");
+  return topSlot;
+}
+
+void SlotListQueue::pop() {
+  releaseSlot(topSlot);
 
   // Update the current top of the queue.
   topSlot = std::distance(
-      begin(),
-      std::min_element(begin(), end(), [](const auto &a, const auto &b) {
-        // a is "smaller" than b if either a's timestamp is earlier than b's, or
-        // b is unused (i.e. b has no actual meaning).
-        return !a.unused && (a < b || b.unused);
-      }));
+      slots.begin(),
+      std::min_element(slots.begin(), slots.end(),
+                       [](const auto &a, const auto &b) {
+                         // a is "smaller" than b if either a's timestamp is
+                         // earlier than b's, or b is unused (i.e. b has no
+                         // actual meaning).
+                         return !a.unused && (a < b || b.unused);
+                       }));
+}
+
+//===----------------------------------------------------------------------===//
+// TimingWheelQueue
+//===----------------------------------------------------------------------===//
+
+Slot &TimingWheelQueue::getOrCreateSlot(Time time) {
+  assert(currentTime <= time.time && "cannot schedule an event in the past");
+
+  // Events at the current real time go to the sorted sub-queue.
+  if (time.time == currentTime) {
+    auto it = llvm::lower_bound(current, time, [&](unsigned index, Time t) {
+      return t < slots[index].time;
+    });
+    if (it != current.end() && slots[*it].time == time)
+      return slots[*it];
+    auto index = allocateSlot(time);
+    current.insert(it, index);
+    return slots[index];
+  }
+
+  // Otherwise look for a slot in the bucket of the wheel the time belongs to.
+  // The buckets of the lowest level only hold a single real time.
+  auto level = llvm::Log2_64(time.time ^ currentTime) / bitsPerLevel;
+  auto &bucket =
+      wheel[level][(time.time >> (level * bitsPerLevel)) & (numBuckets - 1)];
+  for (auto index : bucket) {
+    if (slots[index].time == time)
+      return slots[index];
+  }
+  auto index = allocateSlot(time);
+  bucket.push_back(index);
+  ++levelSizes[level];
+  return slots[index];
+}
+
+void TimingWheelQueue::insertIntoWheel(unsigned index) {
+  auto time = slots[index].time.time;
+  auto level = llvm::Log2_64(time ^ currentTime) / bitsPerLevel;
+  wheel[level][(time >> (level * bitsPerLevel)) & (numBuckets - 1)].push_back(
+      index);
+  ++levelSizes[level];
+}
+
+void TimingWheelQueue::advance() {
+  for (unsigned level = 0; level < numLevels; ++level) {
+    if (levelSizes[level] == 0)
+      continue;
+
+    // The slots of a level differ from the current real time in the digit of
+    // the level, and are later, so only the buckets after the current digit
+    // can be used.
+    auto shift = level * bitsPerLevel;
+    auto digit = (currentTime >> shift) & (numBuckets - 1);
+    for (auto i = digit + 1; i < numBuckets; ++i) {
+      if (wheel[level][i].empty())
+        continue;
+
+      // Advance to the earliest real time of the bucket, and cascade its slots
+      // down to the lower levels and the current sub-queue.
+      auto bucket = std::move(wheel[level][i]);
+      wheel[level][i].clear();
+      levelSizes[level] -= bucket.size();
+      currentTime = slots[bucket.front()].time.time;
+      for (auto index : bucket)
+        currentTime = std::min(currentTime, slots[index].time.time);
+
+      for (auto index : bucket) {
+        if (slots[index].time.time == currentTime)
+          current.push_back(index);
+        else
+          insertIntoWheel(index);
+      }
+      llvm::sort(current, [&](unsigned a, unsigned b) {
+        return slots[b].time < slots[a].time;
+      });
+      return;
+    }
+  }
+}
+
+unsigned TimingWheelQueue::getTopSlot() {
+  if (current.empty())
+    advance();
+  assert(!current.empty() && "the event queue is empty");
+  return current.back();
+}
+
+void TimingWheelQueue::pop() { releaseSlot(current.pop_back_val()); }
+
+//===----------------------------------------------------------------------===//
+// DeferredEvents
+//===----------------------------------------------------------------------===//
+
+void DeferredEvents::insertOrUpdate(Time time, int index, int bitOffset,
+                                    uint8_t *bytes, unsigned width) {
+  // Copy the value, as the driver reuses its buffer once the drive returns.
+  // Only the bytes of the value are read, the rest of the last word is zero.
+  auto wordIndex = words.size();
+  events.push_back({time, static_cast<unsigned>(index), bitOffset, width,
+                    static_cast<unsigned>(wordIndex), false});
+  if (width <= 64) {
+    words.push_back(loadWord(bytes, llvm::divideCeil(width, 8)));
+    return;
+  }
+  words.resize(wordIndex + llvm::divideCeil(width, 64));
+  std::memcpy(words.data() + wordIndex, bytes, llvm::divideCeil(width, 8));
+}
+
+void DeferredEvents::pushQueue(Time time, unsigned inst) {
+  events.push_back({time, inst, 0, 0, 0, true});
+}
+
+void DeferredEvents::flush(State &state) {
+  // Consecutive drives are mostly at the same time, so only look up the slot
+  // when the time changes. Wakeups can create slots, which moves them.
+  Slot *slot = nullptr;
+  Time slotTime;
+  for (auto &event : events) {
+    if (event.isWakeup) {
+      state.pushQueue(event.time, event.index);
+      slot = nullptr;
+      continue;
+    }
+    if (!slot || !(slotTime == event.time)) {
+      slot = &state.queue->getOrCreateSlot(event.time);
+      slotTime = event.time;
+    }
+    slot->insertChange(
+        event.index, event.bitOffset,
+        reinterpret_cast<uint8_t *>(words.data() + event.wordIndex),
+        event.width);
+  }
+  events.clear();
+  words.clear();
+}
+
+void DeferredEvents::applyDrives(
+    function_ref<void(unsigned, int, const APInt &)> fn) {
+  for (auto &event : events) {
+    assert(!event.isWakeup && "cannot apply a wakeup right away");
+    auto numWords = divideCeil(event.width, 64);
+    fn(event.index, event.bitOffset,
+       APInt(event.width, makeArrayRef(words.data() + event.wordIndex,
+                                       numWords)));
+  }
+  events.clear();
+  words.clear();
 }
 
 //===----------------------------------------------------------------------===//
 // State
 //===----------------------------------------------------------------------===//
 
+State::State(bool useTimingWheel) {
+  if (useTimingWheel)
+    queue = std::make_unique<TimingWheelQueue>();
+  else
+    queue = std::make_unique<SlotListQueue>();
+}
+
 State::~State() {
   for (auto &inst : instances) {
     if (inst.procState) {
       std::free(inst.procState->senses);
     }
   }
+  for (auto *value : initialValues)
+    std::free(value);
+  if (mappedSignalValues.base())
+    llvm::sys::Memory::releaseMappedMemory(mappedSignalValues);
+}
+
+std::unique_ptr<State> State::cloneLayout(bool useTimingWheel) const {
+  auto clone = std::make_unique<State>(useTimingWheel);
+  clone->root = root;
+  for (auto &inst : instances) {
+    Instance newInst(inst.name);
+    newInst.path = inst.path;
+    newInst.unit = inst.unit;
+    newInst.isEntity = inst.isEntity;
+    newInst.nArgs = inst.nArgs;
+    newInst.sensitivityList = inst.sensitivityList;
+    for (auto &detail : newInst.sensitivityList)
+      detail.value = nullptr;
+    clone->instances.push_back(std::move(newInst));
+  }
+  for (auto &sig : signals) {
+    Signal newSig(sig.name, sig.owner);
+    newSig.triggers = sig.triggers;
+    newSig.triggerSenses = sig.triggerSenses;
+    clone->signals.push_back(std::move(newSig));
+  }
+  return clone;
 }
 
 Slot State::popQueue() {
-  assert(!queue.empty() && "the event queue is empty");
-  Slot pop = queue.top();
-  queue.pop();
+  assert(!queue->empty() && "the event queue is empty");
+  Slot pop = queue->top();
+  queue->pop();
   return pop;
 }
 
 void State::pushQueue(Time t, unsigned inst) {
   Time newTime = time + t;
-  queue.insertOrUpdate(newTime, inst);
+  queue->insertOrUpdate(newTime, inst);
   instances[inst].expectedWakeup = newTime;
 }
 
@@ -269,12 +473,14 @@ int State::addSignal(std::string name, std::string owner) {
   return signals.size() - 1;
 }
 
-void State::addProcPtr(std::string name, ProcState *procStatePtr) {
+void State::addProcPtr(std::string name, ProcState *procStatePtr,
+                       uint64_t size) {
   auto it = getInstanceIterator(name);
 
   // Store instance index in process state.
   procStatePtr->inst = it - instances.begin();
   (*it).procState = std::unique_ptr<ProcState>(procStatePtr);
+  (*it).stateSize = size;
 }
 
 int State::addSignalData(int index, std::string owner, uint8_t *value,
@@ -285,15 +491,16 @@ int State::addSignalData(int index, std::string owner, uint8_t *value,
   auto &sig = signals[globalIdx];
 
   // Add pointer and size to global signal table entry.
-  sig.value = std::unique_ptr<uint8_t>(value);
+  sig.value = value;
   sig.size = size;
+  initialValues.push_back(value);
 
   // Add the value pointer to the signal detail struct for each instance this
   // signal appears in.
   for (auto inst : signals[globalIdx].triggers) {
     for (auto &detail : instances[inst].sensitivityList) {
       if (detail.globalIndex == globalIdx) {
-        detail.value = sig.value.get();
+        detail.value = sig.value;
       }
     }
   }
@@ -304,6 +511,72 @@ void State::addSignalElement(unsigned index, unsigned offset, unsigned size) {
   signals[index].elements.push_back(std::make_pair(offset, size));
 }
 
+/// The size in bytes from which the signal value arena is mapped from
+/// anonymous memory rather than allocated on the heap.
+static constexpr size_t mappedArenaThreshold = 1 << 20;
+
+/// Copy `size` bytes from `src` to the zero-initialized `dst`, skipping the
+/// words that are zero such that the pages they are in are not touched.
+static void copyNonZeroBytes(uint8_t *dst, const uint8_t *src, size_t size) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, src + i, sizeof(word));
+    if (word)
+      std::memcpy(dst + i, &word, sizeof(word));
+  }
+  for (; i < size; ++i)
+    if (src[i])
+      dst[i] = src[i];
+}
+
+void State::packSignalValues() {
+  // Compute the offset of each value in the arena, in words.
+  llvm::SmallVector<size_t, 0> offsets;
+  offsets.reserve(signals.size());
+  size_t numWords = 0;
+  for (auto &sig : signals) {
+    offsets.push_back(numWords);
+    numWords += 2 * llvm::divideCeil(sig.size, 8);
+  }
+
+  // Map large arenas from anonymous memory, which the system zero-fills on
+  // first access. Only the pages holding non-zero initial values are written
+  // here, the others are materialized by the first drive to them.
+  uint64_t *words = nullptr;
+  if (numWords * sizeof(uint64_t) >= mappedArenaThreshold) {
+    std::error_code ec;
+    mappedSignalValues = llvm::sys::Memory::allocateMappedMemory(
+        numWords * sizeof(uint64_t), nullptr,
+        llvm::sys::Memory::MF_READ | llvm::sys::Memory::MF_WRITE, ec);
+    if (!ec)
+      words = static_cast<uint64_t *>(mappedSignalValues.base());
+  }
+  if (!words) {
+    signalValueStorage.assign(numWords, 0);
+    words = signalValueStorage.data();
+  }
+  signalValues = llvm::MutableArrayRef<uint64_t>(words, numWords);
+
+  for (size_t i = 0, e = signals.size(); i < e; ++i) {
+    auto &sig = signals[i];
+    auto *value = reinterpret_cast<uint8_t *>(&signalValues[offsets[i]]);
+    if (sig.value)
+      copyNonZeroBytes(value, sig.value, sig.size);
+    sig.value = value;
+  }
+
+  for (auto *value : initialValues)
+    std::free(value);
+  initialValues.clear();
+
+  // Point the signal details of all the instances to the new values.
+  for (auto &inst : instances) {
+    for (auto &detail : inst.sensitivityList)
+      detail.value = signals[detail.globalIndex].value;
+  }
+}
+
 void State::dumpSignal(llvm::raw_ostream &out, int index) {
   auto &sig = signals[index];
   for (auto inst : sig.triggers) {
@@ -338,3 +611,171 @@ void State::dumpSignalTriggers() {
   }
   llvm::errs() << "::----------------------------------------------::\n";
 }
+
+//===----------------------------------------------------------------------===//
+// Checkpoints
+//===----------------------------------------------------------------------===//
+
+/// The magic number and version at the start of a checkpoint.
+static constexpr char checkpointMagic[8] = {'L', 'L', 'H', 'D',
+                                            'C', 'K', 'P', '1'};
+
+namespace {
+/// Writes the fields of a checkpoint in the byte order of the host.
+struct CheckpointWriter {
+  CheckpointWriter(raw_ostream &os) : os(os) {}
+
+  void write(const void *data, size_t size) {
+    os.write(reinterpret_cast<const char *>(data), size);
+  }
+  void write(uint64_t value) { write(&value, sizeof(value)); }
+  void write(const Time &time) {
+    write(time.time);
+    write(time.delta);
+    write(time.eps);
+  }
+
+  raw_ostream &os;
+};
+
+/// Reads the fields of a checkpoint, failing once the data is exhausted.
+struct CheckpointReader {
+  CheckpointReader(StringRef data) : data(data) {}
+
+  bool read(void *result, size_t size) {
+    if (data.size() < size)
+      return false;
+    std::memcpy(result, data.data(), size);
+    data = data.drop_front(size);
+    return true;
+  }
+  bool read(uint64_t &value) { return read(&value, sizeof(value)); }
+  bool read(Time &time) {
+    return read(time.time) && read(time.delta) && read(time.eps);
+  }
+  /// Read a value and check that it is the expected one.
+  bool expect(uint64_t expected) {
+    uint64_t value;
+    return read(value) && value == expected;
+  }
+
+  StringRef data;
+};
+} // end anonymous namespace
+
+void State::saveCheckpoint(raw_ostream &os) {
+  CheckpointWriter writer(os);
+  writer.write(checkpointMagic, sizeof(checkpointMagic));
+  writer.write(time);
+
+  // The signal values are all in the arena.
+  writer.write(signals.size());
+  writer.write(signalValues.size());
+  writer.write(signalValues.data(), signalValues.size() * sizeof(uint64_t));
+
+  // The process and entity states. The senses of a process are stored out of
+  // its state, and the pointer to them is not saved.
+  writer.write(instances.size());
+  for (auto &inst : instances) {
+    writer.write(inst.expectedWakeup);
+    writer.write(inst.stateSize);
+    if (inst.procState) {
+      writer.write(inst.procState.get(), inst.stateSize);
+      writer.write(inst.procState->senses, inst.nArgs);
+    } else if (inst.entityState) {
+      writer.write(inst.entityState.get(), inst.stateSize);
+    }
+  }
+
+  // The pending events, ordered by time. The changes of a slot are saved in
+  // the order they were inserted, which is the order of their buffers.
+  SmallVector<const Slot *, 16> pending;
+  queue->getPendingSlots(pending);
+  llvm::sort(pending, [](const Slot *a, const Slot *b) { return *a < *b; });
+  writer.write(pending.size());
+  for (auto *slot : pending) {
+    writer.write(slot->time);
+    SmallVector<unsigned, 32> bufferSignals(slot->changesSize);
+    for (size_t i = 0; i < slot->changesSize; ++i)
+      bufferSignals[slot->changes[i].second] = slot->changes[i].first;
+    writer.write(slot->changesSize);
+    for (size_t i = 0; i < slot->changesSize; ++i) {
+      auto &buffer = slot->buffers[i];
+      writer.write(bufferSignals[i]);
+      writer.write(buffer.first);
+      writer.write(buffer.second.getBitWidth());
+      writer.write(buffer.second.getRawData(),
+                   buffer.second.getNumWords() * sizeof(uint64_t));
+    }
+    writer.write(slot->scheduled.size());
+    for (auto inst : slot->scheduled)
+      writer.write(inst);
+  }
+}
+
+bool State::restoreCheckpoint(StringRef data) {
+  CheckpointReader reader(data);
+  char magic[sizeof(checkpointMagic)];
+  if (!reader.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, checkpointMagic, sizeof(magic)) != 0 ||
+      !reader.read(time))
+    return false;
+
+  if (!reader.expect(signals.size()) || !reader.expect(signalValues.size()) ||
+      !reader.read(signalValues.data(),
+                   signalValues.size() * sizeof(uint64_t)))
+    return false;
+
+  if (!reader.expect(instances.size()))
+    return false;
+  for (auto &inst : instances) {
+    if (!reader.read(inst.expectedWakeup) || !reader.expect(inst.stateSize))
+      return false;
+    if (inst.procState) {
+      // Keep the index of the instance and the pointer to the senses.
+      auto *procState = inst.procState.get();
+      auto *senses = procState->senses;
+      if (!reader.read(procState, inst.stateSize))
+        return false;
+      procState->senses = senses;
+      if (!reader.read(senses, inst.nArgs))
+        return false;
+    } else if (inst.entityState) {
+      if (!reader.read(inst.entityState.get(), inst.stateSize))
+        return false;
+    }
+  }
+
+  uint64_t numSlots;
+  if (!reader.read(numSlots))
+    return false;
+  SmallVector<uint64_t, 4> words;
+  for (uint64_t i = 0; i < numSlots; ++i) {
+    Time slotTime;
+    uint64_t numChanges;
+    if (!reader.read(slotTime) || !reader.read(numChanges))
+      return false;
+    auto &slot = queue->getOrCreateSlot(slotTime);
+    for (uint64_t j = 0; j < numChanges; ++j) {
+      uint64_t sigIndex, bitOffset, width;
+      if (!reader.read(sigIndex) || !reader.read(bitOffset) ||
+          !reader.read(width) || sigIndex >= signals.size() || width == 0)
+        return false;
+      words.resize(llvm::divideCeil(width, 64));
+      if (!reader.read(words.data(), words.size() * sizeof(uint64_t)))
+        return false;
+      slot.insertChange(sigIndex, bitOffset,
+                        reinterpret_cast<uint8_t *>(words.data()), width);
+    }
+    uint64_t numScheduled;
+    if (!reader.read(numScheduled))
+      return false;
+    for (uint64_t j = 0; j < numScheduled; ++j) {
+      uint64_t inst;
+      if (!reader.read(inst) || inst >= instances.size())
+        return false;
+      slot.insertChange(inst);
+    }
+  }
+  return reader.data.empty();
+}
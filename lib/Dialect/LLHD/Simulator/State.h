@@ -15,9 +15,12 @@
 #define CIRCT_DIALECT_LLHD_SIMULATOR_STATE_H
 
 #include "llvm/ADT/APInt.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Memory.h"
 
+#include <cstring>
 #include <map>
 #include <queue>
 
@@ -56,6 +59,58 @@ struct Time {
 private:
 };
 
+/// Load a native integer of type `T` from `bytes`.
+template <typename T>
+inline uint64_t loadNative(const uint8_t *bytes) {
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+/// Store the low bits of `word` to `bytes` as a native integer of type `T`.
+template <typename T>
+inline void storeNative(uint8_t *bytes, uint64_t word) {
+  T value = word;
+  std::memcpy(bytes, &value, sizeof(T));
+}
+
+/// Load a value of `size` bytes, at most 8, as a word. Most signals are 1, 8,
+/// 16, 32 or 64 bits wide, which are loaded as a native integer, rather than
+/// copied byte by byte.
+inline uint64_t loadWord(const uint8_t *bytes, unsigned size) {
+  switch (size) {
+  case 1:
+    return loadNative<uint8_t>(bytes);
+  case 2:
+    return loadNative<uint16_t>(bytes);
+  case 4:
+    return loadNative<uint32_t>(bytes);
+  case 8:
+    return loadNative<uint64_t>(bytes);
+  default: {
+    uint64_t word = 0;
+    std::memcpy(&word, bytes, size);
+    return word;
+  }
+  }
+}
+
+/// Store the low `size` bytes of `word`, at most 8, to `bytes`.
+inline void storeWord(uint8_t *bytes, uint64_t word, unsigned size) {
+  switch (size) {
+  case 1:
+    return storeNative<uint8_t>(bytes, word);
+  case 2:
+    return storeNative<uint16_t>(bytes, word);
+  case 4:
+    return storeNative<uint32_t>(bytes, word);
+  case 8:
+    return storeNative<uint64_t>(bytes, word);
+  default:
+    std::memcpy(bytes, &word, size);
+  }
+}
+
 /// Detail structure that can be easily accessed by the lowered code.
 struct SignalDetail {
   uint8_t *value;
@@ -97,8 +152,12 @@ struct Signal {
   std::string owner;
   // The list of instances this signal triggers.
   std::vector<unsigned> triggers;
+  // The index of the sense of this signal in each of the triggered instances.
+  std::vector<unsigned> triggerSenses;
   uint64_t size;
-  std::unique_ptr<uint8_t> value;
+  // The value of the signal, which points into the value arena of the state
+  // once the values are packed.
+  uint8_t *value;
   std::vector<std::pair<unsigned, unsigned>> elements;
 };
 
@@ -133,13 +192,14 @@ struct Slot {
   bool unused = false;
 };
 
-/// This is equivalent to and std::priorityQueue<Slot> ordered using the greater
-/// operator, which adds an insertion method to add changes to a slot.
-class UpdateQueue : public llvm::SmallVector<Slot, 8> {
-  unsigned topSlot = 0;
-  llvm::SmallVector<unsigned, 4> unused;
-
+/// The interface of the simulator's event queue. This is equivalent to a
+/// std::priority_queue<Slot> ordered using the greater operator, which adds
+/// an insertion method to add changes to a slot. The slots are owned by the
+/// queue and reused once popped.
+class UpdateQueue {
 public:
+  virtual ~UpdateQueue() = default;
+
   /// Check wheter a slot for the given time already exists. If that's the case,
   /// add the new change to it, else create a new slot and push it to the queue.
   void insertOrUpdate(Time time, int index, int bitOffset, uint8_t *bytes,
@@ -153,7 +213,7 @@ public:
   /// Return a reference to a slot with the given timestamp. If such a slot
   /// already exists, a reference to it will be returned. Otherwise a reference
   /// to a fresh slot is returned.
-  Slot &getOrCreateSlot(Time time);
+  virtual Slot &getOrCreateSlot(Time time) = 0;
 
   /// Get a reference to the current top of the queue (the earliest event
   /// available).
@@ -161,9 +221,123 @@ public:
 
   /// Pop the current top of the queue. This marks the current top slot as
   /// unused and resets its internal structures such that they can be reused.
-  void pop();
+  virtual void pop() = 0;
+
+  /// Return true if there are no events in the queue.
+  bool empty() const { return events == 0; }
+
+  /// Add the slots currently in the queue to `result`, in no particular
+  /// order.
+  void getPendingSlots(llvm::SmallVectorImpl<const Slot *> &result) const;
 
   unsigned events = 0;
+
+protected:
+  /// Return the index of the slot at the top of the queue.
+  virtual unsigned getTopSlot() = 0;
+
+  /// Return the index of a fresh slot for the given time, reusing an unused
+  /// slot if there is one.
+  unsigned allocateSlot(Time time);
+
+  /// Reset the internal structures of a slot and mark it as unused.
+  void releaseSlot(unsigned index);
+
+  llvm::SmallVector<Slot, 8> slots;
+  llvm::SmallVector<unsigned, 4> unused;
+};
+
+/// An event queue which keeps the slots in a flat list. Looking up a slot
+/// and popping the top of the queue are linear in the number of slots.
+class SlotListQueue : public UpdateQueue {
+  unsigned topSlot = 0;
+
+public:
+  Slot &getOrCreateSlot(Time time) override;
+  void pop() override;
+
+protected:
+  unsigned getTopSlot() override;
+};
+
+/// An event queue which keeps the slots of the current real time in a sorted
+/// sub-queue, and the slots of later real times in a hierarchical timing
+/// wheel. Each level of the wheel has a bucket per value of one digit of the
+/// real time, and a slot is kept at the level of the most significant digit in
+/// which its real time differs from the current one. Inserting a slot takes
+/// constant time, and finding the next real time only cascades the slots of
+/// the earliest non-empty bucket down to the lower levels.
+class TimingWheelQueue : public UpdateQueue {
+  static constexpr unsigned bitsPerLevel = 8;
+  static constexpr unsigned numBuckets = 1 << bitsPerLevel;
+  static constexpr unsigned numLevels = 64 / bitsPerLevel;
+
+public:
+  Slot &getOrCreateSlot(Time time) override;
+  void pop() override;
+
+protected:
+  unsigned getTopSlot() override;
+
+private:
+  /// Add a slot later than the current real time to the wheel.
+  void insertIntoWheel(unsigned index);
+
+  /// Advance the current real time to the earliest slot in the wheel, and
+  /// move the slots of that real time to the current sub-queue.
+  void advance();
+
+  /// The real time of the slots in the current sub-queue.
+  uint64_t currentTime = 0;
+
+  /// The slots of the current real time, sorted by decreasing time such that
+  /// the top of the queue is the last one.
+  llvm::SmallVector<unsigned, 8> current;
+
+  /// The buckets of each level of the wheel, and the number of slots kept in
+  /// each level.
+  llvm::SmallVector<unsigned, 2> wheel[numLevels][numBuckets];
+  unsigned levelSizes[numLevels] = {};
+};
+
+struct State;
+
+/// The events spawned by instances, buffered until they are added to the queue
+/// in bulk. While the instances woken up in a cycle run in parallel, each one
+/// has its own buffer; the events of all the instances are added to the queue
+/// once they all ran, in the order of the instances, such that the queue ends
+/// up the same as if the instances ran one after the other.
+class DeferredEvents {
+  struct Event {
+    Time time;
+    // The signal index for drives, the instance for wakeups.
+    unsigned index;
+    int bitOffset;
+    unsigned width;
+    // The first word of the driven value in `words`.
+    unsigned wordIndex;
+    bool isWakeup;
+  };
+
+  llvm::SmallVector<Event, 4> events;
+  llvm::SmallVector<uint64_t, 8> words;
+
+public:
+  /// Defer the drive of a signal at the given absolute time.
+  void insertOrUpdate(Time time, int index, int bitOffset, uint8_t *bytes,
+                      unsigned width);
+
+  /// Defer the wakeup of an instance after the given amount of time.
+  void pushQueue(Time time, unsigned inst);
+
+  /// Add the deferred events to the queue of the state, and clear them.
+  void flush(State &state);
+
+  /// Call `fn` with the signal index, bit offset and value of each deferred
+  /// drive, ignoring their time, and clear the events. There must be no
+  /// deferred wakeups.
+  void applyDrives(
+      llvm::function_ref<void(unsigned, int, const llvm::APInt &)> fn);
 };
 
 /// State structure for process persistence across suspension.
@@ -193,21 +367,32 @@ struct Instance {
   llvm::SmallVector<SignalDetail, 0> sensitivityList;
   std::unique_ptr<ProcState> procState;
   std::unique_ptr<uint8_t> entityState;
+  // The size of the process or entity state in bytes.
+  uint64_t stateSize = 0;
   Time expectedWakeup;
   // A pointer to the base unit jitted function.
   void (*unitFPtr)(void **);
+  // A pointer to the jitted function running the base unit for a batch of
+  // instances, if there is one.
+  void (*batchFPtr)(void **) = nullptr;
 };
 
 /// The simulator's state. It contains the current simulation time, signal
 /// values and the event queue.
 struct State {
-  /// Construct a new empty (at 0 time) state.
-  State() = default;
+  /// Construct a new empty (at 0 time) state. The event queue is a timing
+  /// wheel if `useTimingWheel` is set, a slot list otherwise.
+  State(bool useTimingWheel = false);
 
   /// State destructor, ensures all malloc'd regions stored in the state are
   /// correctly free'd.
   ~State();
 
+  /// Create a new state with the same instances and signals as this one, but
+  /// none of their values. It is initialized by running `llhd_init` on it,
+  /// independently of this state.
+  std::unique_ptr<State> cloneLayout(bool useTimingWheel) const;
+
   /// Pop the head of the queue and update the simulation time.
   Slot popQueue();
 
@@ -227,8 +412,25 @@ struct State {
 
   void addSignalElement(unsigned, unsigned, unsigned);
 
-  /// Add a pointer to the process persistence state to a process instance.
-  void addProcPtr(std::string name, ProcState *procStatePtr);
+  /// Move the values of all the signals into a single contiguous arena, and
+  /// free the buffers they were initialized in. Each value is 8-byte aligned
+  /// and padded to twice its size, like the initial buffers.
+  void packSignalValues();
+
+  /// Write the current time, the signal values, the pending events and the
+  /// state of all the instances to a binary checkpoint. The values persisted
+  /// by processes across suspension are saved as is, so the checkpoint is only
+  /// meaningful for the same design on the same host.
+  void saveCheckpoint(llvm::raw_ostream &os);
+
+  /// Restore a checkpoint of the same design, once the state is initialized
+  /// and its signal values are packed. Return false if the checkpoint is
+  /// malformed or doesn't match the layout of the design.
+  bool restoreCheckpoint(llvm::StringRef data);
+
+  /// Add a pointer to the process persistence state, of `size` bytes, to a
+  /// process instance.
+  void addProcPtr(std::string name, ProcState *procStatePtr, uint64_t size);
 
   /// Dump a signal to the out stream. One entry is added for every instance
   /// the signal appears in.
@@ -244,7 +446,19 @@ struct State {
   std::string root;
   llvm::SmallVector<Instance, 0> instances;
   llvm::SmallVector<Signal, 0> signals;
-  UpdateQueue queue;
+  std::unique_ptr<UpdateQueue> queue;
+
+  /// The arena holding the values of all the signals, once packed.
+  llvm::MutableArrayRef<uint64_t> signalValues;
+
+  /// The storage of the arena. Large arenas are mapped from anonymous memory,
+  /// such that the pages of large memories that are never written are never
+  /// materialized; smaller ones live in a vector.
+  std::vector<uint64_t> signalValueStorage;
+  llvm::sys::MemoryBlock mappedSignalValues;
+
+  /// The buffers the signal values were initialized in, until they are packed.
+  llvm::SmallVector<uint8_t *, 0> initialValues;
 };
 
 } // namespace sim
@@ -13,28 +13,228 @@
 
 #include "Trace.h"
 
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/GlobPattern.h"
 #include "llvm/Support/raw_ostream.h"
 
 #include <regex>
 
 using namespace circt::llhd::sim;
 
+/// The number of logs the simulation may hand over before waiting for the
+/// writer thread to catch up.
+static constexpr size_t maxQueuedLogs = 64;
+
 Trace::Trace(std::unique_ptr<State> const &state, llvm::raw_ostream &out,
-             TraceMode mode)
-    : out(out), state(state), mode(mode) {
+             TraceMode mode, const TraceFilter &filter)
+    : out(out), state(state), mode(mode), filter(filter) {
+  std::vector<llvm::GlobPattern> patterns;
+  for (auto &pattern : filter.patterns) {
+    auto glob = llvm::GlobPattern::create(pattern);
+    if (!glob) {
+      llvm::errs() << "Invalid trace filter " << pattern << ": "
+                   << llvm::toString(glob.takeError()) << "\n";
+      exit(EXIT_FAILURE);
+    }
+    patterns.push_back(std::move(*glob));
+  }
+  auto isMatched = [&](unsigned inst, const Signal &sig) {
+    if (patterns.empty())
+      return true;
+    auto name = state->instances[inst].path + '/' + sig.name;
+    return llvm::any_of(patterns, [&](llvm::GlobPattern &pattern) {
+      return pattern.match(name);
+    });
+  };
+
   auto root = state->root;
-  for (auto &sig : state->signals) {
-    if (mode != full && mode != merged && sig.owner != root) {
-      isTraced.push_back(false);
+  auto rootInst = state->instances.size() - 1;
+  for (size_t i = 0, e = state->signals.size(); i < e; ++i) {
+    auto &sig = state->signals[i];
+    bool traced = true;
+    if (mode != full && mode != merged && mode != vcd && sig.owner != root) {
+      traced = false;
     } else if (mode == namedOnly &&
                std::regex_match(sig.name, std::regex("(sig)?[0-9]*"))) {
-      isTraced.push_back(false);
-    } else {
-      isTraced.push_back(true);
+      traced = false;
+    }
+
+    // The full formats write the changes of the signal in all the instances
+    // it is connected to, the others only in the root instance.
+    llvm::SmallVector<unsigned, 1> insts;
+    if (traced) {
+      if (mode == full || mode == merged || mode == vcd) {
+        for (auto inst : sig.triggers)
+          if (isMatched(inst, sig))
+            insts.push_back(inst);
+      } else if (isMatched(rootInst, sig)) {
+        insts.push_back(rootInst);
+      }
     }
+    isTraced.push_back(!insts.empty());
+    tracedInstances.push_back(std::move(insts));
+    valueOffsets.push_back(values.size());
+    values.resize(values.size() + sig.size);
+
+    if (!filter.trigger.empty())
+      for (auto inst : sig.triggers)
+        if (state->instances[inst].path + '/' + sig.name == filter.trigger)
+          triggerIndex = i;
+  }
+  if (!filter.trigger.empty() && triggerIndex < 0) {
+    llvm::errs() << "Trace trigger " << filter.trigger << " not found\n";
+    exit(EXIT_FAILURE);
   }
 }
 
+Trace::~Trace() {
+  if (!writer.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    isDone = true;
+  }
+  queueChanged.notify_all();
+  writer.join();
+}
+
+//===----------------------------------------------------------------------===//
+// Change logging methods
+//===----------------------------------------------------------------------===//
+
+void Trace::addChange(unsigned sigIndex) {
+  lastChangeTime = state->time;
+  if (lastChangeTime.time < filter.startTime ||
+      lastChangeTime.time > filter.stopTime)
+    return;
+
+  // The initial values are added at time zero, they do not trigger the
+  // capture.
+  if (static_cast<int>(sigIndex) == triggerIndex && !lastChangeTime.isZero())
+    triggerChanged = true;
+
+  // The earlier changes were not traced, so add the values of all the signals
+  // on the first change in the window.
+  if (!windowStarted) {
+    windowStarted = true;
+    if (!lastChangeTime.isZero()) {
+      for (size_t i = 0, e = state->signals.size(); i < e; ++i)
+        addTracedChange(i);
+      return;
+    }
+  }
+  addTracedChange(sigIndex);
+}
+
+void Trace::addTracedChange(unsigned sigIndex) {
+  if (!isTraced[sigIndex])
+    return;
+  auto &sig = state->signals[sigIndex];
+  pending.signals.push_back(sigIndex);
+  pending.values.insert(pending.values.end(), sig.value, sig.value + sig.size);
+}
+
+void Trace::flush(bool force) {
+  // The merged formats write the changes once the real time advances. A log
+  // without changes only matters to start the VCD trace at the end.
+  bool isStepDone = mode == full || mode == reduced ||
+                    state->time.time > lastChangeTime.time;
+  if ((isStepDone && !pending.signals.empty()) || force)
+    submit();
+}
+
+void Trace::submit() {
+  pending.time = lastChangeTime;
+  pending.triggerChanged = triggerChanged;
+
+  std::unique_lock<std::mutex> lock(queueMutex);
+  if (!writer.joinable())
+    writer = std::thread([this] { runWriter(); });
+  // Bound the memory held by the logs when the writer falls behind.
+  queueChanged.wait(lock, [&] { return queue.size() < maxQueuedLogs; });
+  queue.push_back(std::move(pending));
+  pending = ChangeLog();
+  if (!freeLogs.empty()) {
+    pending = std::move(freeLogs.back());
+    freeLogs.pop_back();
+  }
+  lock.unlock();
+  queueChanged.notify_all();
+}
+
+//===----------------------------------------------------------------------===//
+// Writer thread methods
+//===----------------------------------------------------------------------===//
+
+void Trace::runWriter() {
+  std::unique_lock<std::mutex> lock(queueMutex);
+  while (true) {
+    queueChanged.wait(lock, [&] { return isDone || !queue.empty(); });
+    if (queue.empty())
+      return;
+    auto log = std::move(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    queueChanged.notify_all();
+
+    write(log);
+    log.signals.clear();
+    log.values.clear();
+    lock.lock();
+    freeLogs.push_back(std::move(log));
+  }
+}
+
+void Trace::write(const ChangeLog &log) {
+  currentTime = log.time;
+  isTriggered = log.triggerChanged;
+
+  // Replay the changes in order, updating the values they are dumped from.
+  auto *value = log.values.data();
+  for (auto sigIndex : log.signals) {
+    auto size = state->signals[sigIndex].size;
+    std::memcpy(values.data() + valueOffsets[sigIndex], value, size);
+    value += size;
+
+    if (mode == full || mode == reduced) {
+      // Add a change for each instance the signal is traced in.
+      for (auto inst : tracedInstances[sigIndex]) {
+        pushAllChanges(inst, sigIndex);
+      }
+    } else if (mode == merged || mode == mergedReduce || mode == namedOnly) {
+      addChangeMerged(sigIndex);
+    } else if (mode == vcd) {
+      addChangeVCD(sigIndex);
+    }
+  }
+
+  if (mode == full || mode == reduced)
+    flushFull();
+  else if (mode == merged || mode == mergedReduce || mode == namedOnly)
+    flushMerged();
+  else if (mode == vcd)
+    flushVCD();
+}
+
+std::string Trace::dumpValue(unsigned sigIndex, int elem) {
+  auto &sig = state->signals[sigIndex];
+  auto *value = values.data() + valueOffsets[sigIndex];
+  auto size = sig.size;
+  if (elem >= 0) {
+    value += sig.elements[elem].first;
+    size = sig.elements[elem].second;
+  }
+  std::string ret;
+  llvm::raw_string_ostream ss(ret);
+  ss << "0x";
+  for (auto i = size; i > 0; --i)
+    ss << llvm::format_hex_no_prefix(value[i - 1], 2);
+  return ss.str();
+}
+
 //===----------------------------------------------------------------------===//
 // Changes gathering methods
 //===----------------------------------------------------------------------===//
@@ -51,10 +251,10 @@ void Trace::pushChange(unsigned inst, unsigned sigIndex, int elem = -1) {
     // Add element index to the hierarchical path.
     ss << '[' << elem << ']';
     // Get element value dump.
-    valueDump = sig.dump(elem);
+    valueDump = dumpValue(sigIndex, elem);
   } else {
     // Get signal value dump.
-    valueDump = sig.dump();
+    valueDump = dumpValue(sigIndex);
   }
 
   // Check wheter we have an actual change from last value.
@@ -78,39 +278,30 @@ void Trace::pushAllChanges(unsigned inst, unsigned sigIndex) {
   }
 }
 
-void Trace::addChange(unsigned sigIndex) {
-  currentTime = state->time;
-  if (isTraced[sigIndex]) {
-    if (mode == full) {
-      auto &sig = state->signals[sigIndex];
-      // Add a change for each connected instance.
-      for (auto inst : sig.triggers) {
-        pushAllChanges(inst, sigIndex);
-      }
-    } else if (mode == reduced) {
-      // The root is always the last instance in the instances list.
-      pushAllChanges(state->instances.size() - 1, sigIndex);
-    } else if (mode == merged || mode == mergedReduce || mode == namedOnly) {
-      addChangeMerged(sigIndex);
-    }
-  }
-}
-
 void Trace::addChangeMerged(unsigned sigIndex) {
   auto &sig = state->signals[sigIndex];
   if (sig.elements.size() > 0) {
     // Add a change for all sub-elements
     for (size_t i = 0, e = sig.elements.size(); i < e; ++i) {
-      auto valueDump = sig.dump(i);
+      auto valueDump = dumpValue(sigIndex, i);
       mergedChanges[std::make_pair(sigIndex, i)] = valueDump;
     }
   } else {
     // Add one change for the whole signal.
-    auto valueDump = sig.dump();
+    auto valueDump = dumpValue(sigIndex);
     mergedChanges[std::make_pair(sigIndex, -1)] = valueDump;
   }
 }
 
+void Trace::addChangeVCD(unsigned sigIndex) {
+  if (isVCDChanged.empty())
+    isVCDChanged.resize(state->signals.size());
+  if (isVCDChanged[sigIndex])
+    return;
+  isVCDChanged[sigIndex] = true;
+  vcdChanges.push_back(sigIndex);
+}
+
 //===----------------------------------------------------------------------===//
 // Flush methods
 //===----------------------------------------------------------------------===//
@@ -123,12 +314,39 @@ void Trace::sortChanges() {
             });
 }
 
-void Trace::flush(bool force) {
-  if (mode == full || mode == reduced)
-    flushFull();
-  else if (mode == merged || mode == mergedReduce || mode == namedOnly)
-    if (state->time.time > currentTime.time || force)
-      flushMerged();
+llvm::raw_ostream &Trace::beginStep() {
+  if (triggerIndex < 0)
+    return out;
+  stepStream.flush();
+  step.clear();
+  return stepStream;
+}
+
+void Trace::endStep() {
+  if (triggerIndex < 0)
+    return;
+  stepStream.flush();
+
+  // Keep the last steps until the trigger changes, then write them along with
+  // the steps that follow.
+  if (!captureTriggered && !isTriggered) {
+    capturedSteps.push_back(step);
+    if (capturedSteps.size() > filter.captureSteps)
+      capturedSteps.pop_front();
+    return;
+  }
+  if (!captureTriggered) {
+    captureTriggered = true;
+    for (auto &captured : capturedSteps)
+      out << captured;
+    capturedSteps.clear();
+    out << step;
+    return;
+  }
+  if (stepsAfterTrigger < filter.captureSteps) {
+    ++stepsAfterTrigger;
+    out << step;
+  }
 }
 
 void Trace::flushFull() {
@@ -136,9 +354,11 @@ void Trace::flushFull() {
     sortChanges();
 
     auto timeDump = currentTime.dump();
+    auto &os = beginStep();
     for (auto change : changes) {
-      out << timeDump << "  " << change.first << "  " << change.second << "\n";
+      os << timeDump << "  " << change.first << "  " << change.second << "\n";
     }
+    endStep();
     changes.clear();
   }
 }
@@ -148,17 +368,9 @@ void Trace::flushMerged() {
   for (auto elem : mergedChanges) {
     auto sigIndex = elem.first.first;
     auto sigElem = elem.first.second;
-    auto &sig = state->signals[sigIndex];
-    auto change = elem.second;
-
-    if (mode == merged) {
-      // Add the changes for all connected instances.
-      for (auto inst : sig.triggers) {
-        pushChange(inst, sigIndex, sigElem);
-      }
-    } else {
-      // The root is always the last instance in the instances list.
-      pushChange(state->instances.size() - 1, sigIndex, sigElem);
+    // Add the changes for all the instances the signal is traced in.
+    for (auto inst : tracedInstances[sigIndex]) {
+      pushChange(inst, sigIndex, sigElem);
     }
   }
 
@@ -166,11 +378,136 @@ void Trace::flushMerged() {
     sortChanges();
 
     // Flush the changes to output stream.
-    out << currentTime.time << "ps\n";
+    auto &os = beginStep();
+    os << currentTime.time << "ps\n";
     for (auto change : changes) {
-      out << "  " << change.first << "  " << change.second << "\n";
+      os << "  " << change.first << "  " << change.second << "\n";
     }
+    endStep();
     mergedChanges.clear();
     changes.clear();
   }
 }
+
+/// Write the identifier of the VCD variable with the given index, using the
+/// printable ASCII characters as digits.
+static void writeVCDIdentifier(llvm::raw_ostream &out, unsigned index) {
+  do {
+    out << static_cast<char>('!' + index % 94);
+    index /= 94;
+  } while (index);
+}
+
+void Trace::writeVCDHeader() {
+  // Create a variable for each signal, or each element of a structured signal.
+  for (size_t i = 0, e = state->signals.size(); i < e; ++i) {
+    auto &sig = state->signals[i];
+    firstVCDVariables.push_back(vcdVariables.size());
+    auto addVariable = [&](unsigned offset, unsigned size) {
+      vcdVariables.push_back({static_cast<unsigned>(i), offset, size,
+                              static_cast<unsigned>(vcdLastValues.size())});
+      vcdLastValues.resize(vcdLastValues.size() + size);
+    };
+    if (sig.elements.empty())
+      addVariable(0, sig.size);
+    for (auto &elem : sig.elements)
+      addVariable(elem.first, elem.second);
+  }
+  firstVCDVariables.push_back(vcdVariables.size());
+
+  // Sort the instances by their hierarchical path, such that the instances in
+  // the same scope are next to each other.
+  std::vector<std::pair<llvm::SmallVector<llvm::StringRef, 4>, unsigned>>
+      scopes;
+  for (size_t i = 0, e = state->instances.size(); i < e; ++i) {
+    llvm::SmallVector<llvm::StringRef, 4> path;
+    llvm::SplitString(state->instances[i].path, path, "/");
+    scopes.push_back(std::make_pair(std::move(path), i));
+  }
+  std::sort(scopes.begin(), scopes.end());
+
+  out << "$timescale 1ps $end\n";
+  llvm::SmallVector<llvm::StringRef, 4> openScopes;
+  for (auto &scope : scopes) {
+    // Close the scopes that are not part of the path of the instance, and open
+    // the new ones.
+    auto &path = scope.first;
+    size_t common = 0;
+    while (common < openScopes.size() && common < path.size() &&
+           openScopes[common] == path[common])
+      ++common;
+    while (openScopes.size() > common) {
+      out << "$upscope $end\n";
+      openScopes.pop_back();
+    }
+    while (openScopes.size() < path.size()) {
+      out << "$scope module " << path[openScopes.size()] << " $end\n";
+      openScopes.push_back(path[openScopes.size()]);
+    }
+
+    // Declare the signals of the instance, once each.
+    llvm::SmallDenseSet<uint64_t, 8> declared;
+    for (auto &detail : state->instances[scope.second].sensitivityList) {
+      auto sigIndex = detail.globalIndex;
+      if (!llvm::is_contained(tracedInstances[sigIndex], scope.second) ||
+          !declared.insert(sigIndex).second)
+        continue;
+      auto &sig = state->signals[sigIndex];
+      for (auto v = firstVCDVariables[sigIndex],
+                e = firstVCDVariables[sigIndex + 1];
+           v < e; ++v) {
+        out << "$var wire " << vcdVariables[v].size * 8 << ' ';
+        writeVCDIdentifier(out, v);
+        out << ' ' << sig.name;
+        if (!sig.elements.empty())
+          out << '_' << v - firstVCDVariables[sigIndex];
+        out << " $end\n";
+      }
+    }
+  }
+  for (size_t i = 0, e = openScopes.size(); i < e; ++i)
+    out << "$upscope $end\n";
+  out << "$enddefinitions $end\n";
+}
+
+void Trace::flushVCD() {
+  if (!vcdStarted)
+    writeVCDHeader();
+
+  // Dump the variables of the changed signals whose value differs from the
+  // last dumped one, or all of them for the initial values.
+  std::sort(vcdChanges.begin(), vcdChanges.end());
+  bool isTimeDumped = false;
+  llvm::SmallString<64> line;
+  for (auto sigIndex : vcdChanges) {
+    isVCDChanged[sigIndex] = false;
+    auto *sigValue = values.data() + valueOffsets[sigIndex];
+    for (auto v = firstVCDVariables[sigIndex],
+              e = firstVCDVariables[sigIndex + 1];
+         v < e; ++v) {
+      auto &var = vcdVariables[v];
+      auto *value = sigValue + var.offset;
+      auto *last = &vcdLastValues[var.lastOffset];
+      if (vcdStarted && std::memcmp(value, last, var.size) == 0)
+        continue;
+      std::memcpy(last, value, var.size);
+
+      if (!isTimeDumped) {
+        out << '#' << currentTime.time << '\n';
+        isTimeDumped = true;
+      }
+
+      // Dump the bits from the most significant one.
+      line.assign("b");
+      for (unsigned byte = var.size; byte > 0; --byte)
+        for (unsigned bit = 8; bit > 0; --bit)
+          line.push_back((value[byte - 1] >> (bit - 1)) & 1 ? '1' : '0');
+      line.push_back(' ');
+      out << line;
+      writeVCDIdentifier(out, v);
+      out << '\n';
+    }
+  }
+  vcdChanges.clear();
+  vcdStarted = true;
+}
@@ -18,27 +18,91 @@
 #define CIRCT_DIALECT_LLHD_SIMULATOR_TRACE_H
 
 #include "State.h"
+#include "circt/Dialect/LLHD/Simulator/Engine.h"
+#include "llvm/Support/raw_ostream.h"
 
+#include <condition_variable>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 
-namespace llvm {
-class raw_ostream;
-} // namespace llvm
-
 namespace circt {
 namespace llhd {
 namespace sim {
 
-enum TraceMode { full, reduced, merged, mergedReduce, namedOnly };
+enum TraceMode { full, reduced, merged, mergedReduce, namedOnly, vcd };
 
+/// The trace is written by a background thread, so that formatting and writing
+/// it does not stall the simulation. The simulation thread only copies the
+/// values of the changed signals to a log of changes, which is handed to the
+/// writer thread at each flush. The writer formats the changes against its own
+/// copy of the signal values, in the order they were logged.
 class Trace {
   llvm::raw_ostream &out;
   std::unique_ptr<State> const &state;
   TraceMode mode;
-  Time currentTime;
+  const TraceFilter &filter;
   // Each entry defines if the respective signal is active for tracing.
   std::vector<bool> isTraced;
+  // The instances each signal is traced in, for the formats that write the
+  // hierarchical names of the signals.
+  std::vector<llvm::SmallVector<unsigned, 1>> tracedInstances;
+  // The index of the signal triggering the capture, or -1 if there is none.
+  int triggerIndex = -1;
+
+  // The changes logged between two flushes, in order.
+  struct ChangeLog {
+    Time time;
+    // Whether the trigger changed since the start of the simulation.
+    bool triggerChanged = false;
+    // The index of each changed signal, and its value when it changed.
+    std::vector<unsigned> signals;
+    std::vector<uint8_t> values;
+  };
+
+  //===--------------------------------------------------------------------===//
+  // State of the simulation thread.
+  //===--------------------------------------------------------------------===//
+
+  // The time of the last change.
+  Time lastChangeTime;
+  // Whether the values of all the traced signals were added at the start of
+  // the time window.
+  bool windowStarted = false;
+  bool triggerChanged = false;
+  ChangeLog pending;
+
+  //===--------------------------------------------------------------------===//
+  // State shared with the writer thread.
+  //===--------------------------------------------------------------------===//
+
+  // The logs waiting to be written, and the written ones kept for reuse.
+  std::deque<ChangeLog> queue;
+  std::vector<ChangeLog> freeLogs;
+  bool isDone = false;
+  std::mutex queueMutex;
+  std::condition_variable queueChanged;
+  std::thread writer;
+
+  //===--------------------------------------------------------------------===//
+  // State of the writer thread.
+  //===--------------------------------------------------------------------===//
+
+  Time currentTime;
+  // The value of each signal as of the change being written, and the offset
+  // of each signal in it.
+  std::vector<uint8_t> values;
+  std::vector<size_t> valueOffsets;
+  bool isTriggered = false;
+  bool captureTriggered = false;
+  // The last trace steps written before the trigger changed, oldest first.
+  std::deque<std::string> capturedSteps;
+  // The number of steps written since the trigger changed.
+  unsigned stepsAfterTrigger = 0;
+  std::string step;
+  llvm::raw_string_ostream stepStream{step};
   // Buffer of changes ready to be flushed.
   std::vector<std::pair<std::string, std::string>> changes;
   // Buffer of changes for the merged formats.
@@ -46,6 +110,39 @@ class Trace {
   // Buffer of last dumped change for each signal.
   std::map<std::pair<std::string, int>, std::string> lastValue;
 
+  // A variable of the VCD format, for a signal or one of its elements.
+  struct VCDVariable {
+    unsigned sigIndex;
+    unsigned offset;
+    unsigned size;
+    // The offset of the last dumped value of the variable in vcdLastValues.
+    unsigned lastOffset;
+  };
+  std::vector<VCDVariable> vcdVariables;
+  // The first VCD variable of each signal, followed by the number of
+  // variables.
+  std::vector<unsigned> firstVCDVariables;
+  // The last dumped value of each VCD variable.
+  std::vector<uint8_t> vcdLastValues;
+  // The signals changed since the last VCD flush.
+  std::vector<unsigned> vcdChanges;
+  std::vector<bool> isVCDChanged;
+  bool vcdStarted = false;
+
+  /// Log the current value of a signal if it is traced.
+  void addTracedChange(unsigned sigIndex);
+  /// Hand the logged changes to the writer thread, starting it if needed.
+  void submit();
+
+  /// Write the logs handed over until the trace is destroyed.
+  void runWriter();
+  /// Write the changes of one log, then flush them.
+  void write(const ChangeLog &log);
+
+  /// Return the value of a signal, or of one of its elements, in hexadecimal
+  /// format.
+  std::string dumpValue(unsigned sigIndex, int elem = -1);
+
   /// Push one change to the changes vector.
   void pushChange(unsigned inst, unsigned sigIndex, int elem);
   /// Push one change for each element of a signal if it is of a structured
@@ -55,6 +152,15 @@ class Trace {
   /// Add a merged change to the change buffer.
   void addChangeMerged(unsigned);
 
+  /// Record a change for the VCD format.
+  void addChangeVCD(unsigned);
+
+  /// Return the stream to write a step of the trace to. The step is done once
+  /// endStep is called.
+  llvm::raw_ostream &beginStep();
+  /// Write the step of the trace out, or keep it for the capture.
+  void endStep();
+
   /// Sorts the changes buffer lexicographically wrt. the hierarchical paths.
   void sortChanges();
 
@@ -63,9 +169,18 @@ class Trace {
   // Flush the changes buffer to the output stream with merged format.
   void flushMerged();
 
+  /// Write the VCD header, declaring a variable for each signal, or each
+  /// element of a structured signal, in the scope of every instance it
+  /// appears in.
+  void writeVCDHeader();
+  /// Dump the signals changed since the last flush in VCD format.
+  void flushVCD();
+
 public:
   Trace(std::unique_ptr<State> const &state, llvm::raw_ostream &out,
-        TraceMode mode);
+        TraceMode mode, const TraceFilter &filter);
+  /// Wait for the writer thread to write the flushed changes.
+  ~Trace();
 
   /// Add a value change to the trace changes buffer.
   void addChange(unsigned);
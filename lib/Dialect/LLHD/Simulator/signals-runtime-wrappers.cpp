@@ -18,6 +18,12 @@
 using namespace llvm;
 using namespace circt::llhd::sim;
 
+/// The events spawned by the instance running on this thread, if they are
+/// deferred.
+static thread_local DeferredEvents *deferredEvents = nullptr;
+
+void setDeferredEvents(DeferredEvents *events) { deferredEvents = events; }
+
 //===----------------------------------------------------------------------===//
 // Runtime interface
 //===----------------------------------------------------------------------===//
@@ -41,16 +47,19 @@ void addSigStructElement(State *state, unsigned index, unsigned offset,
   state->addSignalElement(index, offset, size);
 }
 
-void allocProc(State *state, char *owner, ProcState *procState) {
+void allocProc(State *state, char *owner, ProcState *procState,
+               int64_t size) {
   assert(state && "alloc_proc: state not found");
   std::string sOwner(owner);
-  state->addProcPtr(sOwner, procState);
+  state->addProcPtr(sOwner, procState, size);
 }
 
-void allocEntity(State *state, char *owner, uint8_t *entityState) {
+void allocEntity(State *state, char *owner, uint8_t *entityState,
+                 int64_t size) {
   assert(state && "alloc_entity: state not found");
   auto it = state->getInstanceIterator(owner);
   (*it).entityState = std::unique_ptr<uint8_t>(entityState);
+  (*it).stateSize = size;
 }
 
 void driveSignal(State *state, SignalDetail *detail, uint8_t *value,
@@ -61,11 +70,17 @@ void driveSignal(State *state, SignalDetail *detail, uint8_t *value,
   auto offset = detail->offset;
 
   int bitOffset =
-      (detail->value - state->signals[globalIndex].value.get()) * 8 + offset;
+      (detail->value - state->signals[globalIndex].value) * 8 + offset;
 
   // Spawn a new event.
-  state->queue.insertOrUpdate(state->time + Time(time, delta, eps), globalIndex,
-                              bitOffset, value, width);
+  auto eventTime = state->time + Time(time, delta, eps);
+  if (deferredEvents) {
+    deferredEvents->insertOrUpdate(eventTime, globalIndex, bitOffset, value,
+                                   width);
+    return;
+  }
+  state->queue->insertOrUpdate(eventTime, globalIndex, bitOffset, value,
+                               width);
 }
 
 void llhdSuspend(State *state, ProcState *procState, int time, int delta,
@@ -73,6 +88,9 @@ void llhdSuspend(State *state, ProcState *procState, int time, int delta,
   // Add a new scheduled wake up if a time is specified.
   if (time || delta || eps) {
     Time sTime(time, delta, eps);
-    state->pushQueue(sTime, procState->inst);
+    if (deferredEvents)
+      deferredEvents->pushQueue(sTime, procState->inst);
+    else
+      state->pushQueue(sTime, procState->inst);
   }
 }
@@ -15,6 +15,11 @@
 
 #include "State.h"
 
+/// Defer the events spawned on this thread to `events`, or stop deferring them
+/// if it is null. This is used by the engine to add the events to the queue in
+/// bulk, and to run instances in parallel.
+void setDeferredEvents(circt::llhd::sim::DeferredEvents *events);
+
 extern "C" {
 
 //===----------------------------------------------------------------------===//
@@ -36,13 +41,13 @@ void addSigArrayElements(circt::llhd::sim::State *state, unsigned index,
 void addSigStructElement(circt::llhd::sim::State *state, unsigned index,
                          unsigned offset, unsigned size);
 
-/// Add allocated constructs to a process instance.
+/// Add allocated constructs, of `size` bytes, to a process instance.
 void allocProc(circt::llhd::sim::State *state, char *owner,
-               circt::llhd::sim::ProcState *procState);
+               circt::llhd::sim::ProcState *procState, int64_t size);
 
-/// Add allocated entity state to the given instance.
+/// Add allocated entity state, of `size` bytes, to the given instance.
 void allocEntity(circt::llhd::sim::State *state, char *owner,
-                 uint8_t *entityState);
+                 uint8_t *entityState, int64_t size);
 
 /// Drive a value onto a signal.
 void driveSignal(circt::llhd::sim::State *state,
@@ -25,62 +25,82 @@ struct ProcessLoweringPass
   void runOnOperation() override;
 };
 
-void ProcessLoweringPass::runOnOperation() {
-  ModuleOp module = getOperation();
+/// Check that the process can be lowered to an entity. If `emitErrors` is
+/// false, no diagnostics are emitted, and the processes whose lowering would
+/// not preserve their simulation behavior are rejected as well.
+static LogicalResult checkProcess(llhd::ProcOp op, bool emitErrors) {
+  auto fail = [&](Operation *at, const Twine &message) {
+    if (emitErrors)
+      at->emitOpError(message);
+    return failure();
+  };
 
-  WalkResult result = module.walk([](llhd::ProcOp op) -> WalkResult {
-    // Check invariants
-    size_t numBlocks = op.body().getBlocks().size();
-    if (numBlocks == 1) {
-      if (!isa<llhd::HaltOp>(op.body().back().getTerminator())) {
-        return op.emitOpError("Process-lowering: Entry block is required to be "
-                              "terminated by a HaltOp from the LLHD dialect.");
-      }
-    } else if (numBlocks == 2) {
-      Block &first = op.body().front();
-      Block &last = op.body().back();
-      if (last.getArguments().size() != 0) {
-        return op.emitOpError(
-            "Process-lowering: The second block (containing the "
-            "llhd.wait) is not allowed to have arguments.");
-      }
-      if (!isa<mlir::BranchOp>(first.getTerminator())) {
-        return op.emitOpError(
-            "Process-lowering: The first block has to be terminated "
-            "by a BranchOp from the standard dialect.");
+  size_t numBlocks = op.body().getBlocks().size();
+  if (numBlocks == 1) {
+    if (!isa<llhd::HaltOp>(op.body().back().getTerminator())) {
+      return fail(op, "Process-lowering: Entry block is required to be "
+                      "terminated by a HaltOp from the LLHD dialect.");
+    }
+    // A process that halts runs once, while an entity runs again whenever its
+    // inputs change.
+    if (!emitErrors && !op.body().front().getOps<llhd::PrbOp>().empty())
+      return failure();
+  } else if (numBlocks == 2) {
+    Block &first = op.body().front();
+    Block &last = op.body().back();
+    if (last.getArguments().size() != 0) {
+      return fail(op, "Process-lowering: The second block (containing the "
+                      "llhd.wait) is not allowed to have arguments.");
+    }
+    if (!isa<mlir::BranchOp>(first.getTerminator())) {
+      return fail(op, "Process-lowering: The first block has to be terminated "
+                      "by a BranchOp from the standard dialect.");
+    }
+    // The operations of the entry block only run once in the process, but on
+    // every change of the inputs in the entity.
+    if (!emitErrors && &first.front() != first.getTerminator())
+      return failure();
+    if (auto wait = dyn_cast<llhd::WaitOp>(last.getTerminator())) {
+      // No optional time argument is allowed
+      if (wait.time()) {
+        return fail(wait,
+                    "Process-lowering: llhd.wait terminators with optional "
+                    "time argument cannot be lowered to structural LLHD.");
       }
-      if (auto wait = dyn_cast<llhd::WaitOp>(last.getTerminator())) {
-        // No optional time argument is allowed
-        if (wait.time()) {
-          return wait.emitOpError(
-              "Process-lowering: llhd.wait terminators with optional time "
-              "argument cannot be lowered to structural LLHD.");
+      // Every probed signal has to occur in the observed signals list in
+      // the wait instruction
+      WalkResult result = op.walk([&](llhd::PrbOp prbOp) -> WalkResult {
+        if (!llvm::is_contained(wait.obs(), prbOp.signal())) {
+          return fail(wait,
+                      "Process-lowering: The wait terminator is required to "
+                      "have all probed signals as arguments!");
         }
-        // Every probed signal has to occur in the observed signals list in
-        // the wait instruction
-        WalkResult result = op.walk([&wait](llhd::PrbOp prbOp) -> WalkResult {
-          if (!llvm::is_contained(wait.obs(), prbOp.signal())) {
-            return wait.emitOpError(
-                "Process-lowering: The wait terminator is required to have "
-                "all probed signals as arguments!");
-          }
-          return WalkResult::advance();
-        });
-        if (result.wasInterrupted()) {
-          return result;
-        }
-      } else {
-        return op.emitOpError(
-            "Process-lowering: The second block must be terminated by "
-            "a WaitOp from the LLHD dialect.");
-      }
+        return WalkResult::advance();
+      });
+      if (result.wasInterrupted())
+        return failure();
     } else {
-      return op.emitOpError(
-          "Process-lowering only supports processes with either one basic "
-          "block terminated by a llhd.halt operation or two basic blocks where "
-          "the first one contains a std.br terminator and the second one "
-          "is terminated by a llhd.wait operation.");
+      return fail(op, "Process-lowering: The second block must be terminated "
+                      "by a WaitOp from the LLHD dialect.");
     }
+  } else {
+    return fail(
+        op,
+        "Process-lowering only supports processes with either one basic "
+        "block terminated by a llhd.halt operation or two basic blocks where "
+        "the first one contains a std.br terminator and the second one "
+        "is terminated by a llhd.wait operation.");
+  }
+  return success();
+}
+
+void ProcessLoweringPass::runOnOperation() {
+  ModuleOp module = getOperation();
+
+  WalkResult result = module.walk([&](llhd::ProcOp op) -> WalkResult {
+    // Check invariants
+    if (failed(checkProcess(op, !skipUnsupported)))
+      return skipUnsupported ? WalkResult::advance() : WalkResult::interrupt();
 
     OpBuilder builder(op);
 
@@ -133,6 +153,8 @@ void ProcessLoweringPass::runOnOperation() {
 } // namespace
 
 std::unique_ptr<OperationPass<ModuleOp>>
-circt::llhd::createProcessLoweringPass() {
-  return std::make_unique<ProcessLoweringPass>();
+circt::llhd::createProcessLoweringPass(bool skipUnsupported) {
+  auto pass = std::make_unique<ProcessLoweringPass>();
+  pass->skipUnsupported = skipUnsupported;
+  return pass;
 }
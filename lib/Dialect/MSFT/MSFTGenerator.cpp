@@ -8,6 +8,7 @@
 
 #include "circt/Dialect/MSFT/MSFTDialect.h"
 
+#include "mlir/IR/BuiltinTypes.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassRegistry.h"
@@ -32,13 +33,39 @@ public:
     generators[generatorName][parameters] = cb;
   }
 
-  LogicalResult runOnOperation(mlir::Operation *op, GeneratorSet generatorSet);
+  /// Select the generator to run on the specified op. Set `name` and `gen` to
+  /// its name and callback.
+  LogicalResult selectGenerator(mlir::Operation *op, GeneratorSet generatorSet,
+                                StringRef &name, GeneratorCallback &gen);
 };
 
+/// The replacement built by a generator, recorded so that it can be rebuilt
+/// for other operations with the same attributes.
+struct GeneratedOp {
+  OperationName name;
+  /// The operands of the replacement, as indices into the operands of the
+  /// generated operation.
+  SmallVector<unsigned, 4> operandIndices;
+  SmallVector<Type, 4> resultTypes;
+  DictionaryAttr attrs;
+  /// The number of times the replacement was rebuilt, used to give each
+  /// rebuilt replacement a unique name.
+  unsigned numRebuilt = 0;
+};
+
+/// Generators are memoized by the name of the generated operation and the name
+/// of the generator which ran on it, as well as the attributes (including the
+/// parameters) and the operand and result types of the operation.
+using GeneratorKey =
+    std::pair<OperationName, std::pair<StringRef, std::pair<Attribute, Type>>>;
+using GeneratorCache = DenseMap<GeneratorKey, GeneratedOp>;
+
 } // namespace
 
-LogicalResult OpGenerator::runOnOperation(mlir::Operation *op,
-                                          GeneratorSet generatorSet) {
+LogicalResult OpGenerator::selectGenerator(mlir::Operation *op,
+                                           GeneratorSet generatorSet,
+                                           StringRef &name,
+                                           GeneratorCallback &gen) {
   if (generators.size() == 0)
     return failure();
   if (generators.size() > 1 && generatorSet.size() < 1)
@@ -47,15 +74,16 @@ LogicalResult OpGenerator::runOnOperation(mlir::Operation *op,
 
   // Check if any of the generators were selected in the generator set. If more
   // than one candidate is present in the generator set, raise an error.
-  GeneratorCallback gen;
   Attribute parameters = op->getAttr("parameters");
   for (auto &generatorPair : generators) {
     if (generatorSet.contains(generatorPair.first())) {
       if (gen)
         return op->emitError("multiple generators selected");
       auto callbackPair = generatorPair.second.find(parameters);
-      if (callbackPair != generatorPair.second.end())
+      if (callbackPair != generatorPair.second.end()) {
+        name = generatorPair.first();
         gen = callbackPair->second;
+      }
     }
   }
 
@@ -63,36 +91,115 @@ LogicalResult OpGenerator::runOnOperation(mlir::Operation *op,
   // generator, default to using that. Otherwise raise an error.
   if (!gen) {
     if (generators.size() == 1) {
-      auto generatorMap = generators.begin()->second;
+      auto &generatorMap = generators.begin()->second;
       auto callbackPair = generatorMap.find(parameters);
-      if (callbackPair != generatorMap.end())
+      if (callbackPair != generatorMap.end()) {
+        name = generators.begin()->first();
         gen = callbackPair->second;
-    } else {
-      return op->emitError("unable to select a generator");
+      }
     }
+    if (!gen)
+      return op->emitError("unable to select a generator");
   }
-
-  mlir::IRRewriter rewriter(op->getContext());
-  Operation *replacement = gen(op);
-  if (replacement == nullptr)
-    return op->emitError("Failed generator on ") << op->getName();
-  replacement->setLoc(op->getLoc());
-  rewriter.replaceOp(op, replacement->getResults());
   return success();
 }
 
+/// Record the replacement built for the specified op, if it can be rebuilt for
+/// other operations: it must not have regions or successors, and each of its
+/// operands must be exactly one operand of the op. An operand passed to the op
+/// more than once does not tell which of its positions the replacement uses.
+static Optional<GeneratedOp> recordReplacement(Operation *op,
+                                               Operation *replacement) {
+  if (replacement->getNumRegions() != 0 ||
+      replacement->getNumSuccessors() != 0)
+    return {};
+  GeneratedOp generated{replacement->getName(), {}, {}, {}};
+  auto operands = op->getOperands();
+  for (auto operand : replacement->getOperands()) {
+    auto it = llvm::find(operands, operand);
+    if (it == operands.end() || llvm::count(operands, operand) != 1)
+      return {};
+    generated.operandIndices.push_back(it - operands.begin());
+  }
+  generated.resultTypes.append(replacement->result_type_begin(),
+                               replacement->result_type_end());
+  generated.attrs = replacement->getAttrDictionary();
+  return generated;
+}
+
+/// Rebuild a recorded replacement for the specified op. The symbol of the
+/// recorded replacement is dropped and its name is made unique, since both
+/// would otherwise be duplicated.
+static Operation *rebuildReplacement(Operation *op, GeneratedOp &generated) {
+  OperationState state(op->getLoc(), generated.name);
+  for (auto index : generated.operandIndices)
+    state.addOperands(op->getOperand(index));
+  state.addTypes(generated.resultTypes);
+  ++generated.numRebuilt;
+  for (auto attr : generated.attrs) {
+    StringRef attrName = attr.first.strref();
+    if (attrName == "sym_name" || attrName == "inner_sym")
+      continue;
+    auto name = attr.second.dyn_cast<StringAttr>();
+    if (name && (attrName == "instanceName" || attrName == "name")) {
+      state.addAttribute(attr.first,
+                         StringAttr::get(op->getContext(),
+                                         name.getValue() + "_" +
+                                             Twine(generated.numRebuilt)));
+      continue;
+    }
+    state.addAttribute(attr.first, attr.second);
+  }
+  OpBuilder builder(op);
+  return builder.createOperation(state);
+}
+
 namespace circt {
 namespace msft {
 namespace detail {
 struct Generators {
   llvm::StringMap<OpGenerator> registeredOpGenerators;
 
-  LogicalResult runOnOperation(mlir::Operation *op, GeneratorSet generatorSet) {
+  /// Run the selected generator on the specified op and replace it. If `cache`
+  /// is not null, look up the replacement in it first, and record the new
+  /// replacement in it if the generator had to run.
+  LogicalResult runOnOperation(mlir::Operation *op, GeneratorSet generatorSet,
+                               GeneratorCache *cache) {
     StringRef opName = op->getName().getStringRef();
     auto opGenerator = registeredOpGenerators.find(opName);
     if (opGenerator == registeredOpGenerators.end())
       return success(); // If we don't have a generator registered, just return.
-    return opGenerator->second.runOnOperation(op, generatorSet);
+
+    StringRef generatorName;
+    GeneratorCallback gen;
+    if (failed(opGenerator->second.selectGenerator(op, generatorSet,
+                                                   generatorName, gen)))
+      return failure();
+
+    auto signature = FunctionType::get(op->getContext(), op->getOperandTypes(),
+                                       op->getResultTypes());
+    GeneratorKey key{op->getName(),
+                     {generatorName, {op->getAttrDictionary(), signature}}};
+    Operation *replacement = nullptr;
+    if (cache) {
+      auto it = cache->find(key);
+      if (it != cache->end())
+        replacement = rebuildReplacement(op, it->second);
+    }
+
+    if (!replacement) {
+      replacement = gen(op);
+      if (replacement == nullptr)
+        return op->emitError("Failed generator on ") << op->getName();
+      replacement->setLoc(op->getLoc());
+      if (cache)
+        if (auto generated = recordReplacement(op, replacement))
+          cache->insert({key, *generated});
+    }
+
+    mlir::IRRewriter rewriter(op->getContext());
+    rewriter.replaceOp(op, replacement->getResults());
+    return success();
   }
 };
 } // namespace detail
@@ -130,9 +237,14 @@ void RunGeneratorsPass::runOnOperation() {
   if (!msft)
     return;
 
+  // The replacements built for each operation name, generator and set of
+  // attributes. Generators are called serially since they build the modules
+  // they instantiate in the top-level module.
+  GeneratorCache cache;
   Operation *top = getOperation();
-  top->walk([this, msft, generatorSet](Operation *op) {
-    if (failed(msft->generators->runOnOperation(op, generatorSet)))
+  top->walk([&](Operation *op) {
+    if (failed(msft->generators->runOnOperation(op, generatorSet,
+                                                memoize ? &cache : nullptr)))
       signalPassFailure();
   });
 }
@@ -0,0 +1,126 @@
+//===- PlacementDB.cpp - Database of device placements --------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/MSFT/PlacementDB.h"
+#include "circt/Dialect/HW/HWOps.h"
+
+using namespace circt;
+using namespace msft;
+
+LogicalResult PlacementDB::addPlacement(PhysLocationAttr loc,
+                                        PlacedInstance inst) {
+  auto &nums = columns[loc.getX()][loc.getY()];
+  auto it = nums.try_emplace(loc.getNum(), Placement{loc, inst});
+  if (it.second) {
+    ++numPlacements;
+    return success();
+  }
+
+  auto diag = inst.op->emitError("Could not apply placement ")
+              << loc << ". Position already occupied by "
+              << it.first->second.inst.subpath;
+  diag.attachNote(it.first->second.inst.op->getLoc())
+      << "Location already occupied by this op";
+  return failure();
+}
+
+/// Return the instance path of an instance inside the module at `path`.
+static InstanceIDAttr appendInstance(InstanceIDAttr path, StringRef instName,
+                                     MLIRContext *ctxt) {
+  if (!path)
+    return SymbolRefAttr::get(ctxt, instName);
+  SmallVector<FlatSymbolRefAttr, 8> nested(path.getNestedReferences());
+  nested.push_back(SymbolRefAttr::get(ctxt, instName));
+  return SymbolRefAttr::get(ctxt, path.getRootReference(), nested);
+}
+
+LogicalResult PlacementDB::addModulePlacements(Operation *module,
+                                               InstanceIDAttr path,
+                                               size_t &numAdded) {
+  bool anyFailed = false;
+  auto addAttrPlacement = [&](Operation *op, StringRef attrKey,
+                              Attribute attr) {
+    auto loc = attr.dyn_cast_or_null<PhysLocationAttr>();
+    if (!loc || !attrKey.startswith_insensitive("loc:"))
+      return;
+    if (failed(addPlacement(loc, {path, attrKey.substr(4), op})))
+      anyFailed = true;
+    else
+      ++numAdded;
+  };
+
+  module->walk([&](Operation *op) {
+    for (NamedAttribute attr : op->getAttrs()) {
+      addAttrPlacement(op, attr.first, attr.second);
+      // Instance-specific placements only apply within an instance.
+      if (auto instSwitch = attr.second.dyn_cast<SwitchInstanceAttr>())
+        if (path)
+          addAttrPlacement(op, attr.first, instSwitch.lookup(path));
+    }
+
+    // Descend into the modules instantiated here. Extern modules have no
+    // placements.
+    auto inst = dyn_cast<hw::InstanceOp>(op);
+    if (!inst)
+      return;
+    auto mod = dyn_cast_or_null<hw::HWModuleOp>(inst.getReferencedModule());
+    if (!mod)
+      return;
+    auto instPath =
+        appendInstance(path, inst.instanceName(), inst.getContext());
+    if (failed(addModulePlacements(mod, instPath, numAdded)))
+      anyFailed = true;
+  });
+  return failure(anyFailed);
+}
+
+mlir::FailureOr<size_t> PlacementDB::addDesignPlacements() {
+  size_t numAdded = 0;
+  if (failed(addModulePlacements(top, {}, numAdded)))
+    return failure();
+  return numAdded;
+}
+
+Optional<PlacementDB::PlacedInstance>
+PlacementDB::getInstanceAt(PhysLocationAttr loc) const {
+  auto column = columns.find(loc.getX());
+  if (column == columns.end())
+    return {};
+  auto row = column->second.find(loc.getY());
+  if (row == column->second.end())
+    return {};
+  auto placement = row->second.find(loc.getNum());
+  if (placement == row->second.end())
+    return {};
+  return placement->second.inst;
+}
+
+void PlacementDB::walkPlacements(PlacementCallback callback,
+                                 Optional<Region> bounds) const {
+  if (bounds && (bounds->xMin > bounds->xMax || bounds->yMin > bounds->yMax))
+    return;
+  auto columnBegin = bounds ? columns.lower_bound(bounds->xMin)
+                            : columns.begin();
+  auto columnEnd = bounds ? columns.upper_bound(bounds->xMax) : columns.end();
+  for (auto column = columnBegin; column != columnEnd; ++column) {
+    const RowMap &rows = column->second;
+    auto rowBegin = bounds ? rows.lower_bound(bounds->yMin) : rows.begin();
+    auto rowEnd = bounds ? rows.upper_bound(bounds->yMax) : rows.end();
+    for (auto row = rowBegin; row != rowEnd; ++row) {
+      // The numbers of a location are few, sort them to walk them in order.
+      SmallVector<uint64_t, 4> nums;
+      for (auto &placement : row->second)
+        nums.push_back(placement.first);
+      llvm::sort(nums);
+      for (auto num : nums) {
+        const Placement &placement = row->second.find(num)->second;
+        callback(placement.loc, placement.inst);
+      }
+    }
+  }
+}
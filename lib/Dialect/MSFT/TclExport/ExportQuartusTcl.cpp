@@ -14,11 +14,14 @@
 #include "circt/Dialect/MSFT/ExportTcl.h"
 #include "circt/Dialect/MSFT/MSFTAttributes.h"
 #include "circt/Support/LLVM.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Translation.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <atomic>
+
 using namespace circt;
 using namespace hw;
 using namespace msft;
@@ -28,6 +31,7 @@ using namespace msft;
 namespace {
 /// Utility struct to assist in output and track other relevent state which are
 /// not specific to the entity hierarchy (global WRT to the entity hierarchy).
+/// There is one per emitted procedure.
 struct TclOutputState {
   TclOutputState(llvm::raw_ostream &os) : os(os) {}
 
@@ -48,10 +52,14 @@ namespace {
 /// particular instance in the module-instance hierarchy.
 struct Entity {
   Entity(TclOutputState &s)
-      : s(s), parent(nullptr), insideEmittedModule(false) {}
+      : s(s), parent(nullptr), insideEmittedModule(false) {
+    path = (name() + "|").str();
+  }
   Entity(Entity *parent, InstanceOp inst, bool insideEmittedModule)
       : s(parent->s), parent(parent), inst(inst),
-        insideEmittedModule(insideEmittedModule) {}
+        insideEmittedModule(insideEmittedModule) {
+    path = (parent->path + name() + "|").str();
+  }
 
   /// Return the entity inside this instance.
   Optional<Entity> enter(InstanceOp inst);
@@ -67,6 +75,11 @@ struct Entity {
 
   StringSet<> emittedAttrKeys;
 
+  /// The entity hierarchy of this entity, including the trailing separator.
+  /// It is built once from the path of the parent, so it doesn't have to be
+  /// recomputed for every location emitted in this entity.
+  std::string path;
+
   StringRef name() {
     if (inst == nullptr)
       return "$parent";
@@ -153,12 +166,7 @@ LogicalResult Entity::emit(Operation *op, StringRef attrKey,
   return success();
 }
 
-void Entity::emitPath() {
-  if (parent)
-    parent->emitPath();
-  // Names are separated by '|'.
-  s.os << name() << "|";
-}
+void Entity::emitPath() { s.os << path; }
 
 static LogicalResult emitAttr(Entity &entity, Operation *op, StringRef key,
                               Attribute attr) {
@@ -218,18 +226,28 @@ static LogicalResult exportTcl(Entity &entity, Operation *op) {
 /// level for the entire design.
 LogicalResult circt::msft::exportQuartusTcl(ModuleOp module,
                                             llvm::raw_ostream &os) {
-  TclOutputState state(os);
-
-  for (auto &op : module.getBody()->getOperations()) {
-    auto hwMod = dyn_cast<HWModuleOp>(op);
-    if (!hwMod)
-      continue;
-    os << "proc " << hwMod.getName() << "_config { parent } {\n";
+  SmallVector<HWModuleOp, 0> hwMods(module.getOps<HWModuleOp>());
+
+  // Emit the procedure of each module into its own buffer, in parallel if the
+  // context enables it, then write out the buffers in order.  The procedures
+  // don't share any state, so this produces the same output as emitting them
+  // serially.
+  std::vector<std::string> buffers(hwMods.size());
+  std::atomic<bool> encounteredError(false);
+  mlir::parallelForEachN(module.getContext(), 0, hwMods.size(), [&](size_t i) {
+    llvm::raw_string_ostream bufferOS(buffers[i]);
+    TclOutputState state(bufferOS);
+    bufferOS << "proc " << hwMods[i].getName() << "_config { parent } {\n";
     Entity entity(state);
-    if (failed(exportTcl(entity, hwMod)))
-      return failure();
-    os << "}\n\n";
-  }
+    if (failed(exportTcl(entity, hwMods[i])))
+      encounteredError = true;
+    bufferOS << "}\n\n";
+  });
+  if (encounteredError)
+    return failure();
+
+  for (auto &buffer : buffers)
+    os << buffer;
   return success();
 }
 
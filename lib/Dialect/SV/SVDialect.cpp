@@ -21,6 +21,8 @@
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/ManagedStatic.h"
 
+#include <array>
+
 using namespace circt;
 using namespace circt::sv;
 
@@ -47,23 +49,49 @@ void SVDialect::initialize() {
 // Name conflict resolution
 //===----------------------------------------------------------------------===//
 
-/// Return a StringSet that contains all of the reserved names (e.g. Verilog
-/// keywords) that we need to avoid for fear of name conflicts.
+namespace {
+/// The set of reserved names (e.g. Verilog keywords) that we need to avoid for
+/// fear of name conflicts.
+struct ReservedWordSet {
+  StringSet<> words;
+
+  /// The length of the longest reserved word.
+  size_t maxLength = 0;
+
+  /// Whether any reserved word starts with each character.  Most names start
+  /// with a character no reserved word does, such as the `_` of generated
+  /// names like `_T_42`, and are ruled out without a hash table lookup.
+  std::array<bool, 256> isFirstChar = {};
+
+  /// Return true if the name is a reserved word.
+  bool count(StringRef name) const {
+    if (name.empty() || name.size() > maxLength ||
+        !isFirstChar[(unsigned char)name.front()])
+      return false;
+    return words.count(name);
+  }
+};
+
+/// Return a ReservedWordSet that contains all of the reserved names.
 struct ReservedWordsCreator {
   static void *call() {
-    auto set = std::make_unique<StringSet<>>();
+    auto set = std::make_unique<ReservedWordSet>();
     static const char *const reservedWords[] = {
 #include "ReservedWords.def"
     };
-    for (auto *word : reservedWords)
-      set->insert(word);
+    for (StringRef word : reservedWords) {
+      set->words.insert(word);
+      set->maxLength = std::max(set->maxLength, word.size());
+      set->isFirstChar[(unsigned char)word.front()] = true;
+    }
     return set.release();
   }
 };
+} // end anonymous namespace
 
-/// A StringSet that contains all of the reserved names (e.g., Verilog and VHDL
+/// A set that contains all of the reserved names (e.g., Verilog and VHDL
 /// keywords) that we need to avoid to prevent naming conflicts.
-static llvm::ManagedStatic<StringSet<>, ReservedWordsCreator> reservedWords;
+static llvm::ManagedStatic<ReservedWordSet, ReservedWordsCreator> reservedWords;
 
 /// Given string \p origName, generate a new name if it conflicts with any
 /// keyword or any other name in the set \p recordNames. Use the int \p
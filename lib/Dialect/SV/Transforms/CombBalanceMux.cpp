@@ -0,0 +1,190 @@
+//===- CombBalanceMux.cpp - Balance priority chains of muxes --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass restructures the priority chains of muxes that the lowering of
+// nested FIRRTL `when`s produces, `mux(c1, a1, mux(c2, a2, ... default))`, so
+// that the depth of the logic grows logarithmically with the length of the
+// chain instead of linearly.  Chains whose conditions compare one value with
+// distinct constants are exclusive and become a parallel AND-OR selection;
+// other chains become a balanced tree of muxes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/SV/SVPasses.h"
+#include "mlir/IR/Builders.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "comb-balance-mux"
+
+using namespace circt;
+using namespace comb;
+
+namespace {
+/// One link of a priority chain: the value selected when `cond` is true and
+/// the conditions of all the earlier links are false.
+struct ChainEntry {
+  Value cond;
+  Value value;
+};
+} // end anonymous namespace
+
+/// Return the mux continuing the chain on the false side of `mux`, or null.
+static MuxOp getNextLink(MuxOp mux) {
+  auto next = mux.falseValue().getDefiningOp<MuxOp>();
+  if (!next || !next->hasOneUse())
+    return {};
+  return next;
+}
+
+/// Return true if the specified mux is the start of a chain rather than one of
+/// its links.
+static bool isChainRoot(MuxOp mux) {
+  if (!mux->hasOneUse())
+    return true;
+  auto user = dyn_cast<MuxOp>(*mux->user_begin());
+  return !user || user.falseValue() != mux.getResult() ||
+         user.cond() == mux.getResult();
+}
+
+/// Return true if at most one of the conditions of the chain can be true, that
+/// is if they all compare the same value for equality with distinct constants.
+static bool areExclusive(ArrayRef<ChainEntry> chain) {
+  Value index;
+  DenseSet<Attribute> constants;
+  for (auto &entry : chain) {
+    auto cmp = entry.cond.getDefiningOp<ICmpOp>();
+    if (!cmp || cmp.predicate() != ICmpPredicate::eq)
+      return false;
+    if (index && cmp.lhs() != index)
+      return false;
+    index = cmp.lhs();
+    auto cst = cmp.rhs().getDefiningOp<hw::ConstantOp>();
+    if (!cst || !constants.insert(cst.valueAttr()).second)
+      return false;
+  }
+  return true;
+}
+
+/// Return the OR of the conditions of the specified entries.
+static Value buildAnyCondition(OpBuilder &builder, Location loc,
+                               ArrayRef<ChainEntry> chain) {
+  if (chain.size() == 1)
+    return chain[0].cond;
+  SmallVector<Value, 8> conds;
+  for (auto &entry : chain)
+    conds.push_back(entry.cond);
+  return builder.create<OrOp>(loc, builder.getI1Type(), conds);
+}
+
+/// Build a balanced tree of muxes selecting the value of the first entry whose
+/// condition is true, or `otherwise`.  The first half of the chain is selected
+/// if any of its conditions is true, in which case the condition of its last
+/// entry doesn't need to be checked.
+static Value buildBalancedTree(OpBuilder &builder, Location loc,
+                               ArrayRef<ChainEntry> chain, Value otherwise) {
+  if (chain.size() < 3) {
+    for (auto &entry : llvm::reverse(chain))
+      otherwise =
+          builder.create<MuxOp>(loc, entry.cond, entry.value, otherwise);
+    return otherwise;
+  }
+
+  auto front = chain.take_front(chain.size() / 2);
+  auto back = chain.drop_front(front.size());
+  auto anyFront = buildAnyCondition(builder, loc, front);
+  auto frontValue = buildBalancedTree(builder, loc, front.drop_back(),
+                                      front.back().value);
+  auto backValue = buildBalancedTree(builder, loc, back, otherwise);
+  return builder.create<MuxOp>(loc, anyFront, frontValue, backValue);
+}
+
+/// Build the OR of the values of the entries masked by their exclusive
+/// conditions, and of `otherwise` masked by none of them being true.
+static Value buildOneHotSelect(OpBuilder &builder, Location loc,
+                               ArrayRef<ChainEntry> chain, Value otherwise) {
+  auto type = otherwise.getType().cast<IntegerType>();
+  Value zero = builder.create<hw::ConstantOp>(loc, APInt(type.getWidth(), 0));
+  SmallVector<Value, 8> terms;
+  for (auto &entry : chain)
+    terms.push_back(builder.create<MuxOp>(loc, entry.cond, entry.value, zero));
+  auto any = buildAnyCondition(builder, loc, chain);
+  terms.push_back(builder.create<MuxOp>(loc, any, zero, otherwise));
+  return builder.create<OrOp>(loc, type, terms);
+}
+
+//===----------------------------------------------------------------------===//
+// CombBalanceMuxPass
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct CombBalanceMuxPass : public sv::CombBalanceMuxBase<CombBalanceMuxPass> {
+  void runOnOperation() override;
+
+private:
+  bool balanceChain(MuxOp root);
+};
+} // end anonymous namespace
+
+/// Restructure the chain starting at the specified mux if it is long enough,
+/// and return true if it was.
+bool CombBalanceMuxPass::balanceChain(MuxOp root) {
+  SmallVector<MuxOp, 8> links;
+  SmallVector<ChainEntry, 8> chain;
+  for (auto mux = root; mux; mux = getNextLink(mux)) {
+    links.push_back(mux);
+    chain.push_back({mux.cond(), mux.trueValue()});
+  }
+  if (chain.size() < minChainLength)
+    return false;
+
+  SmallVector<Location, 8> locations;
+  for (auto mux : links)
+    locations.push_back(mux.getLoc());
+  OpBuilder builder(root);
+  auto loc = builder.getFusedLoc(locations);
+  auto otherwise = links.back().falseValue();
+
+  Value result;
+  if (otherwise.getType().isa<IntegerType>() && areExclusive(chain))
+    result = buildOneHotSelect(builder, loc, chain, otherwise);
+  else
+    result = buildBalancedTree(builder, loc, chain, otherwise);
+
+  LLVM_DEBUG(llvm::dbgs() << "Balancing a chain of " << chain.size()
+                          << " muxes at " << root.getLoc() << "\n");
+  root.getResult().replaceAllUsesWith(result);
+  for (auto mux : links)
+    mux.erase();
+  return true;
+}
+
+void CombBalanceMuxPass::runOnOperation() {
+  // Collect the roots first, since balancing a chain erases its links.
+  SmallVector<MuxOp> roots;
+  getOperation().walk([&](MuxOp mux) {
+    if (isChainRoot(mux) && getNextLink(mux))
+      roots.push_back(mux);
+  });
+
+  bool anythingChanged = false;
+  for (auto root : roots)
+    anythingChanged |= balanceChain(root);
+
+  // If we did not change anything in the module mark all analysis as
+  // preserved.
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<Pass> circt::sv::createCombBalanceMuxPass() {
+  return std::make_unique<CombBalanceMuxPass>();
+}
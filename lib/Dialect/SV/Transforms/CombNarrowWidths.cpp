@@ -0,0 +1,273 @@
+//===- CombNarrowWidths.cpp - Demanded bits narrowing of Comb logic -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass computes which bits of each integer value in a hw.module are
+// demanded by the rest of the module, and narrows Comb operations to the bits
+// that are.  The canonicalizer performs similar narrowing, but only for an
+// operation whose users are all extracts; this pass looks through whole
+// expression trees.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/SV/SVPasses.h"
+#include "mlir/IR/Builders.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "comb-narrow-widths"
+
+using namespace circt;
+using namespace comb;
+
+/// Return true if the specified operation belongs to the Comb dialect.
+static bool isCombOp(Operation *op) {
+  return op->getDialect() && op->getDialect()->getNamespace() ==
+                                 CombDialect::getDialectNamespace();
+}
+
+/// Return the bits up to the most significant bit demanded in `bits`.  This is
+/// what arithmetic operations demand of their operands, since carries only
+/// propagate from low to high bits.
+static APInt getLowBitsUpToMSB(const APInt &bits) {
+  return APInt::getLowBitsSet(bits.getBitWidth(), bits.getActiveBits());
+}
+
+//===----------------------------------------------------------------------===//
+// Demanded Bits Analysis
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A backward dataflow analysis computing the bits of each integer value that
+/// may affect anything observable in the module: ports, instances, and any
+/// operation outside of the Comb dialect.
+class DemandedBitsAnalysis {
+public:
+  DemandedBitsAnalysis(hw::HWModuleOp module);
+
+  /// Return the demanded bits of the specified integer value.
+  APInt getDemandedBits(Value value) const {
+    auto it = demandedBits.find(value);
+    if (it != demandedBits.end())
+      return it->second;
+    return APInt(value.getType().getIntOrFloatBitWidth(), 0);
+  }
+
+private:
+  void addDemandedBits(Value value, const APInt &bits);
+  void addAllDemandedBits(Value value);
+  void visitOperation(Operation *op);
+
+  DenseMap<Value, APInt> demandedBits;
+
+  /// The Comb operations whose result demand has grown.
+  SmallVector<Operation *, 16> worklist;
+};
+} // end anonymous namespace
+
+DemandedBitsAnalysis::DemandedBitsAnalysis(hw::HWModuleOp module) {
+  // Everything outside of the Comb dialect is observable, so it demands all the
+  // bits of its operands.
+  module.walk([&](Operation *op) {
+    if (isCombOp(op))
+      return;
+    for (auto operand : op->getOperands())
+      addAllDemandedBits(operand);
+  });
+
+  while (!worklist.empty())
+    visitOperation(worklist.pop_back_val());
+}
+
+void DemandedBitsAnalysis::addDemandedBits(Value value, const APInt &bits) {
+  if (!value.getType().isa<IntegerType>() || bits.isNullValue())
+    return;
+  auto it = demandedBits.try_emplace(value, APInt(bits.getBitWidth(), 0)).first;
+  auto newBits = it->second | bits;
+  if (newBits == it->second)
+    return;
+  it->second = newBits;
+  if (auto *op = value.getDefiningOp())
+    if (isCombOp(op))
+      worklist.push_back(op);
+}
+
+void DemandedBitsAnalysis::addAllDemandedBits(Value value) {
+  if (auto type = value.getType().dyn_cast<IntegerType>())
+    addDemandedBits(value, APInt::getAllOnesValue(type.getWidth()));
+}
+
+/// Propagate the demanded bits of the result of a Comb operation to its
+/// operands.
+void DemandedBitsAnalysis::visitOperation(Operation *op) {
+  if (op->getNumResults() != 1 ||
+      !op->getResult(0).getType().isa<IntegerType>()) {
+    for (auto operand : op->getOperands())
+      addAllDemandedBits(operand);
+    return;
+  }
+  auto bits = getDemandedBits(op->getResult(0));
+
+  // Bitwise operations demand the same bits of their operands.
+  if (isa<AndOp, OrOp, XorOp>(op)) {
+    for (auto operand : op->getOperands())
+      addDemandedBits(operand, bits);
+    return;
+  }
+
+  // Arithmetic operations demand the bits up to the most significant one.
+  if (isa<AddOp, SubOp, MulOp>(op)) {
+    auto lowBits = getLowBitsUpToMSB(bits);
+    for (auto operand : op->getOperands())
+      addDemandedBits(operand, lowBits);
+    return;
+  }
+
+  if (auto muxOp = dyn_cast<MuxOp>(op)) {
+    addAllDemandedBits(muxOp.cond());
+    addDemandedBits(muxOp.trueValue(), bits);
+    addDemandedBits(muxOp.falseValue(), bits);
+    return;
+  }
+
+  // The operands of a concat are laid out from the most significant bit.
+  if (auto concatOp = dyn_cast<ConcatOp>(op)) {
+    unsigned offset = bits.getBitWidth();
+    for (auto operand : concatOp.getOperands()) {
+      unsigned width = operand.getType().getIntOrFloatBitWidth();
+      offset -= width;
+      addDemandedBits(operand, bits.extractBits(width, offset));
+    }
+    return;
+  }
+
+  if (auto extractOp = dyn_cast<ExtractOp>(op)) {
+    auto inputWidth = extractOp.input().getType().getIntOrFloatBitWidth();
+    addDemandedBits(extractOp.input(),
+                    bits.zext(inputWidth).shl(extractOp.lowBit()));
+    return;
+  }
+
+  // Otherwise all the bits of the operands are demanded.
+  for (auto operand : op->getOperands())
+    addAllDemandedBits(operand);
+}
+
+//===----------------------------------------------------------------------===//
+// CombNarrowWidthsPass
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct CombNarrowWidthsPass
+    : public sv::CombNarrowWidthsBase<CombNarrowWidthsPass> {
+  void runOnOperation() override;
+
+private:
+  bool narrowOperation(Operation *op, const APInt &bits);
+};
+} // end anonymous namespace
+
+/// Narrow the specified operation to the range of demanded bits in `bits`,
+/// padding the result with zeros.  Return true if the operation was replaced.
+bool CombNarrowWidthsPass::narrowOperation(Operation *op, const APInt &bits) {
+  unsigned width = bits.getBitWidth();
+  bool isBitwise = isa<AndOp, OrOp, XorOp, MuxOp>(op);
+  if (!isBitwise && !isa<AddOp, SubOp, MulOp>(op))
+    return false;
+
+  // Bitwise operations can drop undemanded bits on both sides, arithmetic
+  // operations only the high ones.
+  unsigned lowBit = isBitwise ? bits.countTrailingZeros() : 0;
+  unsigned highBit = bits.getActiveBits();
+  unsigned narrowWidth = highBit - lowBit;
+  if (narrowWidth == width)
+    return false;
+
+  OpBuilder builder(op);
+  auto loc = op->getLoc();
+  auto narrowType = builder.getIntegerType(narrowWidth);
+  auto extract = [&](Value value) -> Value {
+    return builder.create<ExtractOp>(loc, narrowType, value, lowBit);
+  };
+
+  Value narrowed;
+  if (auto muxOp = dyn_cast<MuxOp>(op)) {
+    narrowed =
+        builder.create<MuxOp>(loc, muxOp.cond(), extract(muxOp.trueValue()),
+                              extract(muxOp.falseValue()));
+  } else {
+    SmallVector<Value, 4> operands;
+    for (auto operand : op->getOperands())
+      operands.push_back(extract(operand));
+    OperationState state(loc, op->getName());
+    state.addOperands(operands);
+    state.addTypes(narrowType);
+    state.addAttributes(op->getAttrs());
+    narrowed = builder.createOperation(state)->getResult(0);
+  }
+
+  // The undemanded bits of the result can be anything, use zeros.
+  SmallVector<Value, 3> resultParts;
+  if (highBit != width)
+    resultParts.push_back(
+        builder.create<hw::ConstantOp>(loc, APInt(width - highBit, 0)));
+  resultParts.push_back(narrowed);
+  if (lowBit != 0)
+    resultParts.push_back(
+        builder.create<hw::ConstantOp>(loc, APInt(lowBit, 0)));
+  Value result = resultParts.front();
+  if (resultParts.size() != 1)
+    result = builder.create<ConcatOp>(loc, resultParts);
+  op->getResult(0).replaceAllUsesWith(result);
+  op->erase();
+  return true;
+}
+
+void CombNarrowWidthsPass::runOnOperation() {
+  auto module = getOperation();
+  DemandedBitsAnalysis analysis(module);
+
+  SmallVector<Operation *, 16> ops;
+  module.walk([&](Operation *op) {
+    if (isCombOp(op) && op->getNumResults() == 1 && !op->use_empty() &&
+        op->getResult(0).getType().isa<IntegerType>())
+      ops.push_back(op);
+  });
+
+  bool anythingChanged = false;
+  for (auto *op : ops) {
+    auto bits = analysis.getDemandedBits(op->getResult(0));
+
+    // If none of the bits are demanded, the value doesn't matter.
+    if (bits.isNullValue()) {
+      OpBuilder builder(op);
+      auto zero = builder.create<hw::ConstantOp>(op->getLoc(),
+                                                 APInt(bits.getBitWidth(), 0));
+      op->getResult(0).replaceAllUsesWith(zero);
+      op->erase();
+      anythingChanged = true;
+      continue;
+    }
+
+    if (narrowOperation(op, bits)) {
+      LLVM_DEBUG(llvm::dbgs() << "Narrowed to bits " << bits.getActiveBits()
+                              << " of " << bits.getBitWidth() << "\n");
+      anythingChanged = true;
+    }
+  }
+
+  // If we did not change anything in the module mark all analysis as
+  // preserved.
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<Pass> circt::sv::createCombNarrowWidthsPass() {
+  return std::make_unique<CombNarrowWidthsPass>();
+}
@@ -0,0 +1,232 @@
+//===- CombSimplify.cpp - Bulk Comb simplification ------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass applies the folders and canonicalization patterns of the Comb
+// dialect to hw.module bodies.  Unlike the greedy pattern rewrite driver used
+// by canonicalize, it does not maintain a worklist of all the operations in the
+// module: it sweeps over the operations in order, so that the operands of an
+// operation have been simplified by the time it is visited, and only the
+// operations created by a rewrite are processed right away.  Afterwards, the
+// duplicate constants of the module are merged into a single pool at the start
+// of the module body.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/SV/SVPasses.h"
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/Rewrite/FrozenRewritePatternSet.h"
+#include "mlir/Rewrite/PatternApplicator.h"
+#include "mlir/Transforms/FoldUtils.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "comb-simplify"
+
+using namespace circt;
+
+/// The maximum number of sweeps over a module.  This matches the iteration
+/// limit of the greedy pattern rewrite driver.
+static constexpr unsigned maxSweeps = 10;
+
+/// Return true if the specified operation belongs to the Comb dialect.
+static bool isCombOp(Operation *op) {
+  return op->getDialect() && op->getDialect()->getNamespace() ==
+                                 comb::CombDialect::getDialectNamespace();
+}
+
+//===----------------------------------------------------------------------===//
+// SweepRewriter
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The rewriter used for the patterns applied during a sweep.  It keeps track
+/// of the operations created by a rewrite, which are simplified right after
+/// the operation that was rewritten, and of the operations that were erased,
+/// which the sweep skips.
+struct SweepRewriter : public PatternRewriter {
+  SweepRewriter(MLIRContext *context, OperationFolder &folder)
+      : PatternRewriter(context), folder(folder) {}
+
+  void notifyOperationInserted(Operation *op) override {
+    // The storage of an erased operation may be reused.
+    erasedOps.erase(op);
+    createdOps.push_back(op);
+  }
+
+  void notifyOperationRemoved(Operation *op) override {
+    folder.notifyRemoval(op);
+    erasedOps.insert(op);
+  }
+
+  OperationFolder &folder;
+  SmallVector<Operation *, 4> createdOps;
+  DenseSet<Operation *> erasedOps;
+};
+} // end anonymous namespace
+
+//===----------------------------------------------------------------------===//
+// CombSimplifyPass
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct CombSimplifyPass : public sv::CombSimplifyBase<CombSimplifyPass> {
+  LogicalResult initialize(MLIRContext *context) override;
+  void runOnOperation() override;
+
+private:
+  bool uniqueConstants();
+  bool sweep(PatternApplicator &applicator, OperationFolder &folder);
+  bool simplify(Operation *op, PatternApplicator &applicator,
+                OperationFolder &folder, SweepRewriter &rewriter);
+
+  FrozenRewritePatternSet patterns;
+};
+} // end anonymous namespace
+
+LogicalResult CombSimplifyPass::initialize(MLIRContext *context) {
+  RewritePatternSet owningPatterns(context);
+  for (auto *op : context->getRegisteredOperations())
+    if (op->dialect.getNamespace() == comb::CombDialect::getDialectNamespace())
+      op->getCanonicalizationPatterns(owningPatterns, context);
+  patterns = FrozenRewritePatternSet(std::move(owningPatterns));
+  return success();
+}
+
+/// Erase the specified operation if it is dead, otherwise fold it or apply the
+/// first matching pattern to it.  Return true if the operation was changed,
+/// replaced or erased.
+bool CombSimplifyPass::simplify(Operation *op, PatternApplicator &applicator,
+                                OperationFolder &folder,
+                                SweepRewriter &rewriter) {
+  if (isOpTriviallyDead(op)) {
+    rewriter.eraseOp(op);
+    return true;
+  }
+  if (!isCombOp(op))
+    return false;
+
+  // The folder hoists the constants it creates to the start of the region, so
+  // they don't need to be visited.
+  auto preReplaceAction = [&](Operation *op) { rewriter.erasedOps.insert(op); };
+  if (succeeded(folder.tryToFold(op, /*processGeneratedConstants=*/nullptr,
+                                 preReplaceAction)))
+    return true;
+
+  rewriter.setInsertionPoint(op);
+  return succeeded(applicator.matchAndRewrite(op, rewriter));
+}
+
+/// Simplify all the Comb operations of the module once, in order.  Return true
+/// if anything changed.
+bool CombSimplifyPass::sweep(PatternApplicator &applicator,
+                             OperationFolder &folder) {
+  // Number the operations to visit up front.  New operations are visited as
+  // they are created, and erased ones are skipped.  A post-order walk visits
+  // the operands of most operations before the operation itself, except for
+  // backedges in graph regions.  Constants are only visited to delete the ones
+  // that are no longer used.
+  std::vector<Operation *> ops;
+  getOperation().walk([&](Operation *op) {
+    if (isCombOp(op) || isa<hw::ConstantOp>(op))
+      ops.push_back(op);
+  });
+
+  SweepRewriter rewriter(&getContext(), folder);
+  bool changed = false;
+  for (auto *op : ops) {
+    if (rewriter.erasedOps.count(op))
+      continue;
+    if (!simplify(op, applicator, folder, rewriter))
+      continue;
+    changed = true;
+
+    // Simplify the operations created by the rewrite, and the ones they may
+    // create in turn.
+    while (!rewriter.createdOps.empty()) {
+      auto *newOp = rewriter.createdOps.pop_back_val();
+      if (!rewriter.erasedOps.count(newOp))
+        simplify(newOp, applicator, folder, rewriter);
+    }
+  }
+
+  // Rewrites can leave operations dead after they were visited, delete them in
+  // reverse order so that whole dead expression trees are removed.
+  for (auto *op : llvm::reverse(ops)) {
+    if (rewriter.erasedOps.count(op) || !isOpTriviallyDead(op))
+      continue;
+    rewriter.eraseOp(op);
+    changed = true;
+  }
+
+  return changed;
+}
+
+/// Merge the constants of the module that have the same value, and move them
+/// to the start of the module body in the order they were first seen.  Return
+/// true if anything changed.
+bool CombSimplifyPass::uniqueConstants() {
+  auto *body = getOperation().getBodyBlock();
+
+  // The value attributes are uniqued by the context, so they are a cheap key.
+  DenseMap<Attribute, hw::ConstantOp> pool;
+  SmallVector<hw::ConstantOp, 16> uniqueOps;
+  bool changed = false;
+  getOperation().walk([&](hw::ConstantOp op) {
+    auto it = pool.try_emplace(op.valueAttr(), op);
+    if (it.second) {
+      uniqueOps.push_back(op);
+      return;
+    }
+    op.replaceAllUsesWith(it.first->second.getResult());
+    op.erase();
+    changed = true;
+  });
+
+  // The body is a graph region, so the constants can be used from anywhere in
+  // the module once they are at the start of it.  The terminator is never a
+  // constant, so the insertion point never reaches the end of the body.
+  auto insertPt = body->begin();
+  for (auto op : uniqueOps) {
+    if (&*insertPt == op) {
+      ++insertPt;
+      continue;
+    }
+    op->moveBefore(body, insertPt);
+    changed = true;
+  }
+  return changed;
+}
+
+void CombSimplifyPass::runOnOperation() {
+  PatternApplicator applicator(patterns);
+  applicator.applyDefaultCostModel();
+  OperationFolder folder(&getContext());
+
+  bool anythingChanged = false;
+  unsigned numSweeps = 0;
+  while (numSweeps != maxSweeps && sweep(applicator, folder)) {
+    anythingChanged = true;
+    ++numSweeps;
+  }
+  if (uniqueConstants())
+    anythingChanged = true;
+
+  LLVM_DEBUG(llvm::dbgs() << "Simplified " << getOperation().getName()
+                          << " in " << numSweeps << " sweeps\n");
+
+  // If we did not change anything in the module mark all analysis as
+  // preserved.
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<Pass> circt::sv::createCombSimplifyPass() {
+  return std::make_unique<CombSimplifyPass>();
+}
@@ -0,0 +1,194 @@
+//===- CombStructuralHash.cpp - Structural hashing of Comb logic ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass merges structurally equivalent Comb expressions in the graph region
+// of hw.module bodies.  Unlike the generic CSE pass, it treats the operands of
+// commutative operations as unordered and looks through nested associative
+// operations, so `and(a, b)`, `and(b, a)` and `and(and(b, a))` all share a
+// single node.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/SV/SVPasses.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "comb-structural-hash"
+
+using namespace circt;
+
+/// The maximum number of operands of a flattened associative operation.  This
+/// bounds the cost of hashing long chains of operations.
+static constexpr unsigned maxFlattenedOperands = 32;
+
+/// Return true if the specified operation can be merged with structurally
+/// equivalent ones.
+static bool isHashable(Operation *op) {
+  if (isa<hw::ConstantOp>(op))
+    return true;
+  return op->getDialect() &&
+         op->getDialect()->getNamespace() ==
+             comb::CombDialect::getDialectNamespace() &&
+         op->getNumRegions() == 0 && op->getNumResults() == 1 &&
+         mlir::MemoryEffectOpInterface::hasNoEffect(op);
+}
+
+/// Return true if nested operations of the same kind as the specified one can
+/// be flattened into it without changing its value.
+static bool isAssociative(Operation *op) {
+  return isa<comb::AndOp, comb::OrOp, comb::XorOp, comb::AddOp, comb::MulOp,
+             comb::ConcatOp>(op);
+}
+
+//===----------------------------------------------------------------------===//
+// Structural Keys
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The structural identity of an operation: its name, attributes and result
+/// type, along with its operands after flattening and sorting them.
+struct StructuralKey {
+  Operation *op;
+  SmallVector<Value, 4> operands;
+  llvm::hash_code hash = 0;
+
+  bool operator==(const StructuralKey &other) const {
+    return hash == other.hash && operands == other.operands &&
+           op->getName() == other.op->getName() &&
+           op->getAttrDictionary() == other.op->getAttrDictionary() &&
+           op->getResult(0).getType() == other.op->getResult(0).getType();
+  }
+};
+
+/// The table of structurally unique operations in a block.
+class StructuralHashTable {
+public:
+  StructuralHashTable(Block &block);
+
+  /// Return the unique operation equivalent to the specified one, or record
+  /// the operation as the unique one if there is none yet.
+  Operation *getOrInsert(Operation *op);
+
+private:
+  void addOperands(Operation *op, ValueRange operands,
+                   SmallVectorImpl<Value> &result);
+
+  /// The number of each value in the block, used to sort the operands of
+  /// commutative operations deterministically.
+  DenseMap<Value, unsigned> valueNumbers;
+
+  /// The key of each unique operation, and the unique operations by hash.
+  std::vector<StructuralKey> keys;
+  DenseMap<Operation *, unsigned> keyIndices;
+  DenseMap<size_t, SmallVector<unsigned, 1>> buckets;
+};
+} // end anonymous namespace
+
+StructuralHashTable::StructuralHashTable(Block &block) {
+  for (auto arg : block.getArguments())
+    valueNumbers.insert({arg, valueNumbers.size()});
+  for (auto &op : block)
+    for (auto result : op.getResults())
+      valueNumbers.insert({result, valueNumbers.size()});
+}
+
+/// Add the operands of `op` to `result`, replacing the ones defined by unique
+/// operations of the same kind by their own flattened operands.
+void StructuralHashTable::addOperands(Operation *op, ValueRange operands,
+                                      SmallVectorImpl<Value> &result) {
+  for (auto operand : operands) {
+    auto *defOp = operand.getDefiningOp();
+    if (defOp && defOp->getName() == op->getName() &&
+        defOp->getAttrDictionary() == op->getAttrDictionary()) {
+      auto it = keyIndices.find(defOp);
+      if (it != keyIndices.end()) {
+        auto &nested = keys[it->second].operands;
+        if (result.size() + nested.size() + operands.size() <=
+            maxFlattenedOperands) {
+          result.append(nested.begin(), nested.end());
+          continue;
+        }
+      }
+    }
+    result.push_back(operand);
+  }
+}
+
+Operation *StructuralHashTable::getOrInsert(Operation *op) {
+  StructuralKey key;
+  key.op = op;
+  if (isAssociative(op))
+    addOperands(op, op->getOperands(), key.operands);
+  else
+    key.operands.append(op->operand_begin(), op->operand_end());
+
+  if (op->hasTrait<OpTrait::IsCommutative>())
+    llvm::sort(key.operands, [&](Value lhs, Value rhs) {
+      return valueNumbers.lookup(lhs) < valueNumbers.lookup(rhs);
+    });
+
+  key.hash = llvm::hash_combine(
+      op->getName().getAsOpaquePointer(),
+      op->getAttrDictionary().getAsOpaquePointer(),
+      op->getResult(0).getType().getAsOpaquePointer(),
+      llvm::hash_combine_range(key.operands.begin(), key.operands.end()));
+
+  auto &candidates = buckets[key.hash];
+  for (auto index : candidates)
+    if (keys[index] == key)
+      return keys[index].op;
+
+  candidates.push_back(keys.size());
+  keyIndices.insert({op, keys.size()});
+  keys.push_back(std::move(key));
+  return op;
+}
+
+//===----------------------------------------------------------------------===//
+// CombStructuralHashPass
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct CombStructuralHashPass
+    : public sv::CombStructuralHashBase<CombStructuralHashPass> {
+  void runOnOperation() override;
+};
+} // end anonymous namespace
+
+void CombStructuralHashPass::runOnOperation() {
+  auto *body = getOperation().getBodyBlock();
+  StructuralHashTable table(*body);
+
+  // Merge every operation into the first equivalent one in the block.  The
+  // users of a merged operation are visited after it, so they are keyed on the
+  // unique operation.
+  bool anythingChanged = false;
+  for (auto &op : llvm::make_early_inc_range(*body)) {
+    if (!isHashable(&op))
+      continue;
+    auto *unique = table.getOrInsert(&op);
+    if (unique == &op)
+      continue;
+    LLVM_DEBUG(llvm::dbgs() << "Merging " << op << " into " << *unique << "\n");
+    op.replaceAllUsesWith(unique);
+    op.erase();
+    anythingChanged = true;
+  }
+
+  // If we did not change anything in the module mark all analysis as
+  // preserved.
+  if (!anythingChanged)
+    markAllAnalysesPreserved();
+}
+
+std::unique_ptr<Pass> circt::sv::createCombStructuralHashPass() {
+  return std::make_unique<CombStructuralHashPass>();
+}
@@ -15,6 +15,10 @@
 #include "circt/Dialect/HW/HWOps.h"
 #include "circt/Dialect/SV/SVPasses.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Threading.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
@@ -29,13 +33,30 @@ using namespace hw;
 
 namespace {
 
+/// A call to the generator program for one generated module.
+struct GeneratorCallout {
+  HWModuleGeneratedOp generatedModuleOp;
+
+  /// The command line of the generator, starting with the executable.
+  SmallVector<std::string> args;
+
+  /// The first line of the output of the generator, once it has run.
+  std::string output;
+
+  /// The error to report on the generated module if the call failed.
+  std::string error;
+};
+
 struct HWGeneratorCalloutPass
     : public sv::HWGeneratorCalloutPassBase<HWGeneratorCalloutPass> {
   void runOnOperation() override;
 
-  void processGenerator(HWModuleGeneratedOp generatedModuleOp,
-                        StringRef generatorExe,
-                        ArrayRef<StringRef> extraGeneratorArgs);
+  Optional<GeneratorCallout>
+  prepareCallout(HWModuleGeneratedOp generatedModuleOp, StringRef generatorExe,
+                 ArrayRef<StringRef> extraGeneratorArgs);
+  void runCallout(GeneratorCallout &callout, StringRef exeDigest,
+                  StringRef workingDir);
+  void finishCallout(GeneratorCallout &callout);
 };
 } // end anonymous namespace
 
@@ -58,27 +79,63 @@ void HWGeneratorCalloutPass::runOnOperation() {
                    execPath + "'");
     return;
   }
-  for (auto &op : llvm::make_early_inc_range(root.getBody()->getOperations())) {
-    if (auto generator = dyn_cast<HWModuleGeneratedOp>(op))
-      processGenerator(generator, *generatorExe, extraGeneratorArgs);
+
+  // Gather the command lines of the generator for all the generated modules.
+  SmallVector<GeneratorCallout> callouts;
+  for (auto generator : root.getBody()->getOps<HWModuleGeneratedOp>())
+    if (auto callout =
+            prepareCallout(generator, *generatorExe, extraGeneratorArgs))
+      callouts.push_back(std::move(*callout));
+
+  // The outputs in the cache are keyed by the contents of the executable, so
+  // that they are not reused once the generator has changed, and by the
+  // working directory, which relative paths written by the generator are in.
+  std::string exeDigest;
+  SmallString<128> workingDir;
+  if (!genCacheDir.empty()) {
+    if (auto digest = llvm::sys::fs::md5_contents(*generatorExe))
+      exeDigest = digest->digest().str().str();
+    else
+      root.emitWarning("cannot read '" + *generatorExe +
+                       "', the generator cache is disabled");
+    if (llvm::sys::fs::current_path(workingDir))
+      exeDigest.clear();
   }
+
+  // Run the generator for each module. The calls are independent of each
+  // other, so they run in parallel if the context enables it, with at most as
+  // many processes as there are threads in the context's thread pool.
+  mlir::parallelForEachN(
+      &getContext(), 0, callouts.size(),
+      [&](size_t index) {
+        runCallout(callouts[index], exeDigest, workingDir);
+      });
+
+  // Replace the generated modules, in order, now that all outputs are known.
+  for (auto &callout : callouts)
+    finishCallout(callout);
 }
 
-void HWGeneratorCalloutPass::processGenerator(
+/// Build the command line of the generator for the specified generated module.
+/// Return None if the module is not to be generated with this generator, or
+/// if its attributes cannot be passed to the generator.
+Optional<GeneratorCallout> HWGeneratorCalloutPass::prepareCallout(
     HWModuleGeneratedOp generatedModuleOp, StringRef generatorExe,
     ArrayRef<StringRef> extraGeneratorArgs) {
   // Get the corresponding schema associated with this generated op.
   auto genSchema =
       dyn_cast<HWGeneratorSchemaOp>(generatedModuleOp.getGeneratorKindOp());
   if (!genSchema)
-    return;
+    return None;
 
   // Ignore the generator op if the schema does not match the user specified
   // schema name from command line "-schema-name"
   if (genSchema.descriptor().str() != schemaName)
-    return;
+    return None;
 
-  SmallVector<std::string> generatorArgs;
+  GeneratorCallout callout;
+  callout.generatedModuleOp = generatedModuleOp;
+  auto &generatorArgs = callout.args;
   // First argument should be the executable name.
   generatorArgs.push_back(generatorExe.str());
   for (auto o : extraGeneratorArgs)
@@ -110,11 +167,129 @@ void HWGeneratorCalloutPass::processGenerator(
           " value specified on the rtl.module.generated operation is not "
           "handled, "
           "only integer and string types supported.");
-      return;
+      return None;
     }
   }
+  return callout;
+}
+
+/// Split the output of a generator into the words which may name the files it
+/// generated.
+static void splitOutputWords(StringRef output,
+                             SmallVectorImpl<StringRef> &words) {
+  llvm::SplitString(output, words, ", \t");
+}
+
+/// Return the path of the copy of the file named by the word at `index` of the
+/// output, in a cache entry.
+static SmallString<128> getCachedFilePath(StringRef entry, size_t index) {
+  SmallString<128> path(entry);
+  llvm::sys::path::append(path, "files", std::to_string(index));
+  return path;
+}
+
+/// Reuse the output of a callout stored in the cache entry `entry`, and put
+/// back the files the generator wrote, which may have been removed or never
+/// written to this location. Return false if there is no usable entry.
+static bool restoreCallout(StringRef entry, GeneratorCallout &callout) {
+  SmallString<128> outputPath(entry);
+  llvm::sys::path::append(outputPath, "output");
+  auto output = llvm::MemoryBuffer::getFile(outputPath);
+  if (!output)
+    return false;
+
+  SmallVector<StringRef> words;
+  splitOutputWords((*output)->getBuffer(), words);
+  for (auto word : llvm::enumerate(words)) {
+    // Only the words naming a generated file have a copy.
+    auto copy = llvm::MemoryBuffer::getFile(
+        getCachedFilePath(entry, word.index()));
+    if (!copy)
+      continue;
+    if (auto existing = llvm::MemoryBuffer::getFile(word.value()))
+      if ((*existing)->getBuffer() == (*copy)->getBuffer())
+        continue;
+    if (auto error = llvm::writeFileAtomically(
+            (word.value() + ".tmp%%%%%%%%").str(), word.value(),
+            (*copy)->getBuffer())) {
+      llvm::consumeError(std::move(error));
+      return false;
+    }
+  }
+  callout.output = (*output)->getBuffer().str();
+  return true;
+}
+
+/// Store the output of a callout in the cache entry `entry`, along with a copy
+/// of each file named in it. Failing to do so is not an error, the generator
+/// will just run again next time. The entry is staged aside and moved into
+/// place once complete, so that concurrent compilations never read a partial
+/// entry.
+static void storeCallout(StringRef entry, const GeneratorCallout &callout) {
+  SmallString<128> staging;
+  llvm::sys::fs::createUniquePath(Twine(entry) + "-%%%%%%%%", staging,
+                                  /*MakeAbsolute=*/false);
+  SmallString<128> filesDir(staging);
+  llvm::sys::path::append(filesDir, "files");
+  if (llvm::sys::fs::create_directories(filesDir))
+    return;
+
+  SmallString<128> outputPath(staging);
+  llvm::sys::path::append(outputPath, "output");
+  std::error_code error;
+  {
+    llvm::raw_fd_ostream os(outputPath, error);
+    if (!error)
+      os << callout.output;
+  }
+
+  SmallVector<StringRef> words;
+  splitOutputWords(callout.output, words);
+  for (auto word : llvm::enumerate(words)) {
+    if (error)
+      break;
+    if (llvm::sys::fs::is_regular_file(word.value()))
+      error = llvm::sys::fs::copy_file(
+          word.value(), getCachedFilePath(staging, word.index()));
+  }
+
+  // Another compilation may have stored the same entry in the meantime, keep
+  // theirs.
+  if (error || llvm::sys::fs::rename(staging, entry))
+    (void)llvm::sys::fs::remove_directories(staging);
+}
+
+/// Run the generator for a callout, or reuse its output from a previous run if
+/// it is in the cache. This runs in parallel with other callouts, so it only
+/// records the output or the error in the callout instead of touching the IR.
+void HWGeneratorCalloutPass::runCallout(GeneratorCallout &callout,
+                                        StringRef exeDigest,
+                                        StringRef workingDir) {
+  auto generatorExe = callout.args.front();
+
+  // The cache entry of a callout is named after the digest of the executable,
+  // of the working directory and of the arguments passed to it.
+  SmallString<128> cachePath;
+  if (!exeDigest.empty()) {
+    llvm::MD5 hasher;
+    hasher.update(exeDigest);
+    hasher.update(workingDir);
+    hasher.update(StringRef("\0", 1));
+    for (auto &arg : ArrayRef<std::string>(callout.args).drop_front()) {
+      hasher.update(arg);
+      hasher.update(StringRef("\0", 1));
+    }
+    llvm::MD5::MD5Result digest;
+    hasher.final(digest);
+    cachePath = genCacheDir;
+    llvm::sys::path::append(cachePath, digest.digest());
+
+    if (restoreCallout(cachePath, callout))
+      return;
+  }
+
   SmallVector<StringRef> generatorArgStrRef;
-  for (const std::string &a : generatorArgs)
+  for (const std::string &a : callout.args)
     generatorArgStrRef.push_back(a);
 
   std::string errMsg;
@@ -124,7 +299,7 @@ void HWGeneratorCalloutPass::processGenerator(
   // Default error code is 0.
   std::error_code ok;
   if (errCode != ok) {
-    generatedModuleOp.emitError("cannot generate a unique temporary file name");
+    callout.error = "cannot generate a unique temporary file name";
     return;
   }
   Optional<StringRef> redirects[] = {None, StringRef(genExecOutFileName), None};
@@ -134,27 +309,42 @@ void HWGeneratorCalloutPass::processGenerator(
       /*SecondsToWait=*/0, /*MemoryLimit=*/0, &errMsg);
 
   if (result != 0) {
-    generatedModuleOp.emitError("execution of '" + generatorExe + "' failed");
+    callout.error = "execution of '" + generatorExe + "' failed";
     return;
   }
 
   auto bufferRead = llvm::MemoryBuffer::getFile(genExecOutFileName);
   if (!bufferRead || !*bufferRead) {
-    generatedModuleOp.emitError("execution of '" + generatorExe +
-                                "' did not produce any output file named '" +
-                                genExecOutFileName + "'");
+    callout.error = "execution of '" + generatorExe +
+                    "' did not produce any output file named '" +
+                    genExecOutFileName.str().str() + "'";
     return;
   }
 
   // Only extract the first line from the output.
-  auto fileContent = (*bufferRead)->getBuffer().split('\n').first.str();
+  callout.output = (*bufferRead)->getBuffer().split('\n').first.str();
+  (void)llvm::sys::fs::remove(genExecOutFileName);
+
+  if (!cachePath.empty())
+    storeCallout(cachePath, callout);
+}
+
+/// Replace the generated module of a callout with an external module, whose
+/// definition is in the files listed in the output of the generator.
+void HWGeneratorCalloutPass::finishCallout(GeneratorCallout &callout) {
+  auto generatedModuleOp = callout.generatedModuleOp;
+  if (!callout.error.empty()) {
+    generatedModuleOp.emitError(callout.error);
+    return;
+  }
+
   OpBuilder builder(generatedModuleOp);
   auto extMod = builder.create<hw::HWModuleExternOp>(
       generatedModuleOp.getLoc(), generatedModuleOp.getVerilogModuleNameAttr(),
       generatedModuleOp.getPorts());
   // Attach an attribute to which file the definition of the external
   // module exists in.
-  extMod->setAttr("filenames", builder.getStringAttr(fileContent));
+  extMod->setAttr("filenames", builder.getStringAttr(callout.output));
   generatedModuleOp.erase();
 }
 
@@ -16,6 +16,8 @@
 #include "PassDetail.h"
 #include "circt/Dialect/HW/HWOps.h"
 #include "circt/Dialect/SV/SVPasses.h"
+#include "mlir/IR/Threading.h"
+#include <atomic>
 
 using namespace circt;
 
@@ -95,15 +97,23 @@ namespace {
 struct HWCleanupPass : public sv::HWCleanupBase<HWCleanupPass> {
   void runOnOperation() override;
 
-  void runOnRegionsInOp(Operation &op);
-  void runOnGraphRegion(Region &region, bool shallow);
-  void runOnProceduralRegion(Region &region, bool shallow);
+  using OpList = SmallVectorImpl<Operation *>;
+
+  void runOnRegionsInOp(Operation &op, OpList &opsToErase);
+  void runOnGraphRegion(Region &region, bool shallow, OpList &opsToErase);
+  void runOnProceduralRegion(Region &region, bool shallow,
+                             OpList &opsToErase);
+  void revisitRegionsIn(DenseSet<Operation *> &opsToRevisitRegionsIn,
+                        bool isProcedural, OpList &opsToErase);
 
 private:
-  /// Inline all regions from the second operation into the first and delete the
-  /// second operation.
+  /// Inline all regions from the second operation into the first and unlink
+  /// the second operation.  Erasing an operation drops its operand uses, which
+  /// may belong to values shared with regions that are being simplified
+  /// concurrently, so the actual erasure is deferred to the caller.
   void mergeOperationsIntoFrom(Operation *op1, Operation *op2,
-                               DenseSet<Operation *> &opsToRevisitRegionsIn) {
+                               DenseSet<Operation *> &opsToRevisitRegionsIn,
+                               OpList &opsToErase) {
     assert(op1 != op2 && "Cannot merge an op into itself");
     for (size_t i = 0, e = op1->getNumRegions(); i != e; ++i)
       mergeRegions(&op1->getRegion(i), &op2->getRegion(i));
@@ -111,11 +121,12 @@ private:
     // Remember that we need to revisit op1 because it changed.
     opsToRevisitRegionsIn.erase(op2);
     opsToRevisitRegionsIn.insert(op1);
-    op2->erase();
+    op2->remove();
+    opsToErase.push_back(op2);
     anythingChanged = true;
   }
 
-  bool anythingChanged;
+  std::atomic<bool> anythingChanged;
 };
 } // end anonymous namespace
 
@@ -123,7 +134,10 @@ void HWCleanupPass::runOnOperation() {
   // Keeps track if anything changed during this pass, used to determine if
   // the analyses were preserved.
   anythingChanged = false;
-  runOnGraphRegion(getOperation().getBody(), /*shallow=*/false);
+  SmallVector<Operation *, 8> opsToErase;
+  runOnGraphRegion(getOperation().getBody(), /*shallow=*/false, opsToErase);
+  for (auto *op : opsToErase)
+    op->erase();
 
   // If we did not change anything in the graph mark all analysis as
   // preserved.
@@ -133,19 +147,45 @@ void HWCleanupPass::runOnOperation() {
 
 /// Recursively process all of the regions in the specified op, dispatching to
 /// graph or procedural processing as appropriate.
-void HWCleanupPass::runOnRegionsInOp(Operation &op) {
+void HWCleanupPass::runOnRegionsInOp(Operation &op, OpList &opsToErase) {
   if (op.hasTrait<sv::ProceduralRegion>()) {
     for (auto &region : op.getRegions())
-      runOnProceduralRegion(region, /*shallow=*/false);
+      runOnProceduralRegion(region, /*shallow=*/false, opsToErase);
   } else {
     for (auto &region : op.getRegions())
-      runOnGraphRegion(region, /*shallow=*/false);
+      runOnGraphRegion(region, /*shallow=*/false, opsToErase);
   }
 }
 
+/// Reprocess the regions of the merged operations because this may have
+/// uncovered other simplifications.  The operations are all in the same block,
+/// so their regions are disjoint and can be processed in parallel.  The order
+/// of visitation doesn't matter, and the operations unlinked by each task are
+/// appended to `opsToErase` in a deterministic order.
+void HWCleanupPass::revisitRegionsIn(
+    DenseSet<Operation *> &opsToRevisitRegionsIn, bool isProcedural,
+    OpList &opsToErase) {
+  if (opsToRevisitRegionsIn.empty())
+    return;
+  SmallVector<Operation *, 8> ops(opsToRevisitRegionsIn.begin(),
+                                  opsToRevisitRegionsIn.end());
+  std::vector<SmallVector<Operation *, 2>> opsToEraseByOp(ops.size());
+  mlir::parallelForEachN(&getContext(), 0, ops.size(), [&](size_t i) {
+    for (auto &region : ops[i]->getRegions()) {
+      if (isProcedural)
+        runOnProceduralRegion(region, /*shallow=*/true, opsToEraseByOp[i]);
+      else
+        runOnGraphRegion(region, /*shallow=*/true, opsToEraseByOp[i]);
+    }
+  });
+  for (auto &list : opsToEraseByOp)
+    opsToErase.append(list.begin(), list.end());
+}
+
 /// Run simplifications on the specified graph region.  If shallow is true, then
 /// we only look at the specified region, we don't recurse into subregions.
-void HWCleanupPass::runOnGraphRegion(Region &region, bool shallow) {
+void HWCleanupPass::runOnGraphRegion(Region &region, bool shallow,
+                                     OpList &opsToErase) {
   if (region.getBlocks().size() != 1)
     return;
   Block &body = region.front();
@@ -166,7 +206,7 @@ void HWCleanupPass::runOnGraphRegion(Region &region, bool shallow) {
   for (Operation &op : llvm::make_early_inc_range(body)) {
     // Recursively process any regions in the op before we visit it.
     if (!shallow && op.getNumRegions() != 0)
-      runOnRegionsInOp(op);
+      runOnRegionsInOp(op, opsToErase);
     // Merge alwaysff and always operations by hashing them to check to see if
     // we've already encountered one.  If so, merge them and reprocess the body.
     if (isa<sv::AlwaysOp, sv::AlwaysFFOp>(op)) {
@@ -175,7 +215,8 @@ void HWCleanupPass::runOnGraphRegion(Region &region, bool shallow) {
       if (itAndInserted.second)
         continue;
       auto *existingAlways = *itAndInserted.first;
-      mergeOperationsIntoFrom(&op, existingAlways, opsToRevisitRegionsIn);
+      mergeOperationsIntoFrom(&op, existingAlways, opsToRevisitRegionsIn,
+                              opsToErase);
 
       *itAndInserted.first = &op;
       continue;
@@ -185,7 +226,8 @@ void HWCleanupPass::runOnGraphRegion(Region &region, bool shallow) {
     if (auto ifdefOp = dyn_cast<sv::IfDefOp>(op)) {
       auto *&entry = ifdefOps[ifdefOp.condAttr()];
       if (entry)
-        mergeOperationsIntoFrom(ifdefOp, entry, opsToRevisitRegionsIn);
+        mergeOperationsIntoFrom(ifdefOp, entry, opsToRevisitRegionsIn,
+                                opsToErase);
 
       entry = ifdefOp;
       continue;
@@ -194,8 +236,8 @@ void HWCleanupPass::runOnGraphRegion(Region &region, bool shallow) {
     // Merge initial ops anywhere in the module.
     if (auto initialOp = dyn_cast<sv::InitialOp>(op)) {
       if (initialOpSeen)
-        mergeOperationsIntoFrom(initialOp, initialOpSeen,
-                                opsToRevisitRegionsIn);
+        mergeOperationsIntoFrom(initialOp, initialOpSeen, opsToRevisitRegionsIn,
+                                opsToErase);
       initialOpSeen = initialOp;
       continue;
     }
@@ -204,26 +246,21 @@ void HWCleanupPass::runOnGraphRegion(Region &region, bool shallow) {
     if (auto alwaysComb = dyn_cast<sv::AlwaysCombOp>(op)) {
       if (alwaysCombOpSeen)
         mergeOperationsIntoFrom(alwaysComb, alwaysCombOpSeen,
-                                opsToRevisitRegionsIn);
+                                opsToRevisitRegionsIn, opsToErase);
       alwaysCombOpSeen = alwaysComb;
       continue;
     }
   }
 
   // Reprocess the merged body because this may have uncovered other
-  // simplifications.  Note that iterating over a set is generally not a stable
-  // thing to do, but this is a parallel operation whose order of visitation
-  // doesn't matter.
-  // TODO: This could be a parallel for-each loop.
-  for (auto *op : opsToRevisitRegionsIn) {
-    for (auto &reg : op->getRegions())
-      runOnGraphRegion(reg, /*shallow=*/true);
-  }
+  // simplifications.
+  revisitRegionsIn(opsToRevisitRegionsIn, /*isProcedural=*/false, opsToErase);
 }
 
 /// Run simplifications on the specified procedural region.  If shallow is true,
 /// then we only look at the specified region, we don't recurse into subregions.
-void HWCleanupPass::runOnProceduralRegion(Region &region, bool shallow) {
+void HWCleanupPass::runOnProceduralRegion(Region &region, bool shallow,
+                                          OpList &opsToErase) {
   if (region.getBlocks().size() != 1)
     return;
   Block &body = region.front();
@@ -237,7 +274,7 @@ void HWCleanupPass::runOnProceduralRegion(Region &region, bool shallow) {
   for (Operation &op : llvm::make_early_inc_range(body)) {
     // Recursively process any regions in the op before we visit it.
     if (!shallow && op.getNumRegions() != 0)
-      runOnRegionsInOp(op);
+      runOnRegionsInOp(op, opsToErase);
 
     // Merge procedural ifdefs with neighbors in the procedural region.
     if (auto ifdef = dyn_cast<sv::IfDefProceduralOp>(op)) {
@@ -246,7 +283,8 @@ void HWCleanupPass::runOnProceduralRegion(Region &region, bool shallow) {
         if (ifdef.cond() == prevIfDef.cond()) {
           // We know that there are no side effective operations between the
           // two, so merge the first one into this one.
-          mergeOperationsIntoFrom(ifdef, prevIfDef, opsToRevisitRegionsIn);
+          mergeOperationsIntoFrom(ifdef, prevIfDef, opsToRevisitRegionsIn,
+                                  opsToErase);
         }
       }
     }
@@ -257,7 +295,8 @@ void HWCleanupPass::runOnProceduralRegion(Region &region, bool shallow) {
         if (ifop.cond() == prevIf.cond()) {
           // We know that there are no side effective operations between the
           // two, so merge the first one into this one.
-          mergeOperationsIntoFrom(ifop, prevIf, opsToRevisitRegionsIn);
+          mergeOperationsIntoFrom(ifop, prevIf, opsToRevisitRegionsIn,
+                                  opsToErase);
         }
       }
     }
@@ -268,14 +307,8 @@ void HWCleanupPass::runOnProceduralRegion(Region &region, bool shallow) {
   }
 
   // Reprocess the merged body because this may have uncovered other
-  // simplifications.  Note that iterating over a set is generally not a stable
-  // thing to do, but this is a parallel operation whose order of visitation
-  // doesn't matter.
-  // TODO: This could be a parallel for-each loop.
-  for (auto *op : opsToRevisitRegionsIn) {
-    for (auto &region : op->getRegions())
-      runOnProceduralRegion(region, /*shallow=*/true);
-  }
+  // simplifications.
+  revisitRegionsIn(opsToRevisitRegionsIn, /*isProcedural=*/true, opsToErase);
 }
 
 std::unique_ptr<Pass> circt::sv::createHWCleanupPass() {
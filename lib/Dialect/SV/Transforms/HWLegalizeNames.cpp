@@ -14,6 +14,8 @@
 #include "PassDetail.h"
 #include "circt/Dialect/HW/HWOps.h"
 #include "circt/Dialect/SV/SVPasses.h"
+#include "mlir/IR/Threading.h"
+#include <atomic>
 
 using namespace circt;
 using namespace sv;
@@ -61,7 +63,7 @@ struct HWLegalizeNamesPass
   void runOnOperation() override;
 
 private:
-  bool anythingChanged;
+  std::atomic<bool> anythingChanged;
 
   void runOnModule(hw::HWModuleOp module);
   void runOnInterface(sv::InterfaceOp intf, mlir::SymbolUserMap &symbolUsers);
@@ -105,10 +107,12 @@ void HWLegalizeNamesPass::runOnOperation() {
     anythingChanged = true;
   }
 
-  // Rename individual operations.
+  // Rename individual operations.  Renaming interface signals updates their
+  // users throughout the design, so that is done serially here.
+  SmallVector<HWModuleOp> modules;
   for (auto &op : *root.getBody()) {
     if (auto module = dyn_cast<HWModuleOp>(op)) {
-      runOnModule(module);
+      modules.push_back(module);
     } else if (auto intf = dyn_cast<InterfaceOp>(op)) {
       runOnInterface(intf, symbolUsers);
     } else if (auto extMod = dyn_cast<HWModuleExternOp>(op)) {
@@ -119,12 +123,19 @@ void HWLegalizeNamesPass::runOnOperation() {
     }
   }
 
+  // The ports and the names inside of a module are independent of all other
+  // modules, so the modules are legalized in parallel.
+  mlir::parallelForEach(&getContext(), modules.begin(), modules.end(),
+                        [&](HWModuleOp module) { runOnModule(module); });
+
   // If we did not change anything in the graph mark all analysis as
   // preserved.
   if (!anythingChanged)
     markAllAnalysesPreserved();
 }
 
+/// Legalize the names of the ports of the module and of the declarations in it.
+/// This is run on multiple modules in parallel.
 void HWLegalizeNamesPass::runOnModule(hw::HWModuleOp module) {
   NameCollisionResolver nameResolver;
 
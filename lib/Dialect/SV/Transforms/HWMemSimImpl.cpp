@@ -16,6 +16,10 @@
 #include "circt/Dialect/HW/HWOps.h"
 #include "circt/Dialect/SV/SVPasses.h"
 #include "mlir/IR/ImplicitLocOpBuilder.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/ADT/StringSwitch.h"
+#include <map>
+#include <tuple>
 
 using namespace circt;
 
@@ -33,15 +37,80 @@ struct FirMemory {
   size_t readLatency;
   size_t writeLatency;
   size_t readUnderWrite;
+
+  bool operator<(const FirMemory &rhs) const {
+    return std::tie(numReadPorts, numWritePorts, numReadWritePorts, dataWidth,
+                    depth, readLatency, writeLatency, readUnderWrite) <
+           std::tie(rhs.numReadPorts, rhs.numWritePorts, rhs.numReadWritePorts,
+                    rhs.dataWidth, rhs.depth, rhs.readLatency,
+                    rhs.writeLatency, rhs.readUnderWrite);
+  }
+};
+
+/// The signature of a generated memory module, and the name of the module
+/// implementing it.  Generated modules with the same memory parameters and
+/// the same signature are implemented by a single module.
+struct MemImpl {
+  Type type;
+  Attribute argNames;
+  Attribute resultNames;
+  Attribute verilogName;
+  bool sparse;
+  bool singleProcess;
+  StringAttr implName;
+};
+
+/// The kinds of simulation models the pass can generate.
+enum class MemModel { Behavioral, SingleProcess, Sparse };
+
+/// This collects the clocked logic of a memory model. The logic is either put
+/// in one always_ff block per port, or gathered in a single always_ff block
+/// of the clock shared by all the ports. A single process lets simulators such
+/// as Verilator schedule the whole memory at once, rather than evaluating and
+/// ordering a block per port and per pipeline stage.
+class ClockedLogic {
+public:
+  ClockedLogic(ImplicitLocOpBuilder &b, Value sharedClock)
+      : b(b), sharedClock(sharedClock) {}
+
+  /// Add logic running on the positive edge of the specified clock.
+  void add(Value clock, std::function<void()> body) {
+    if (!sharedClock) {
+      b.create<sv::AlwaysFFOp>(sv::EventControl::AtPosEdge, clock, body);
+      return;
+    }
+    bodies.push_back(std::move(body));
+  }
+
+  /// Create the shared process, if the logic goes into a single one.
+  void finalize() {
+    if (!sharedClock || bodies.empty())
+      return;
+    b.create<sv::AlwaysFFOp>(sv::EventControl::AtPosEdge, sharedClock, [&]() {
+      for (auto &body : bodies)
+        body();
+    });
+  }
+
+private:
+  ImplicitLocOpBuilder &b;
+  Value sharedClock;
+  SmallVector<std::function<void()>> bodies;
 };
 } // end anonymous namespace
 
 namespace {
 struct HWMemSimImplPass : public sv::HWMemSimImplBase<HWMemSimImplPass> {
+  HWMemSimImplPass() = default;
+  HWMemSimImplPass(StringRef model, unsigned sparseDepth) {
+    this->model = model.str();
+    this->sparseDepth = sparseDepth;
+  }
   void runOnOperation() override;
 
 private:
-  void generateMemory(hw::HWModuleOp op, FirMemory mem);
+  void generateMemory(hw::HWModuleOp op, FirMemory mem, bool sparse,
+                      bool singleProcess);
 };
 } // end anonymous namespace
 
@@ -60,8 +129,21 @@ static FirMemory analyzeMemOp(hw::HWModuleGeneratedOp op) {
   return mem;
 }
 
-static Value addPipelineStages(ImplicitLocOpBuilder &b, size_t stages,
-                               Value clock, Value data) {
+/// Return the indices of the clock arguments of a generated memory module.
+static SmallVector<unsigned> getClockArgs(const FirMemory &mem) {
+  SmallVector<unsigned> clocks;
+  unsigned arg = 0;
+  for (size_t i = 0; i < mem.numReadPorts; ++i, arg += 3)
+    clocks.push_back(arg);
+  for (size_t i = 0; i < mem.numReadWritePorts; ++i, arg += 6)
+    clocks.push_back(arg);
+  for (size_t i = 0; i < mem.numWritePorts; ++i, arg += 5)
+    clocks.push_back(arg);
+  return clocks;
+}
+
+static Value addPipelineStages(ImplicitLocOpBuilder &b, ClockedLogic &logic,
+                               size_t stages, Value clock, Value data) {
   if (!stages)
     return data;
 
@@ -69,22 +151,57 @@ static Value addPipelineStages(ImplicitLocOpBuilder &b, size_t stages,
     auto reg = b.create<sv::RegOp>(data.getType());
 
     // pipeline stage
-    b.create<sv::AlwaysFFOp>(sv::EventControl::AtPosEdge, clock,
-                             [&]() { b.create<sv::PAssignOp>(reg, data); });
+    logic.add(clock, [&b, reg, data]() { b.create<sv::PAssignOp>(reg, data); });
     data = b.create<sv::ReadInOutOp>(reg);
   }
 
   return data;
 }
 
-void HWMemSimImplPass::generateMemory(hw::HWModuleOp op, FirMemory mem) {
+void HWMemSimImplPass::generateMemory(hw::HWModuleOp op, FirMemory mem,
+                                      bool sparse, bool singleProcess) {
   ImplicitLocOpBuilder b(UnknownLoc::get(&getContext()), op.getBody());
-
-  // Create a register for the memory.
   auto dataType = b.getIntegerType(mem.dataWidth);
-  Value reg =
-      b.create<sv::RegOp>(hw::UnpackedArrayType::get(dataType, mem.depth),
-                          b.getStringAttr("Memory"));
+
+  // Create the storage of the memory. The sparse model stores the written
+  // words in an associative array indexed by address, so that simulating a
+  // very deep memory only costs the words actually used. There is no SV
+  // dialect type for associative arrays, hence the verbatim accesses, which
+  // name the array after the symbol of the memory module.
+  // Every port has its address as its third argument.
+  auto addrWidth = op.body().getArgument(2).getType().getIntOrFloatBitWidth();
+  // A memory without address or data bits has nothing to gain from the sparse
+  // model, and the associative array cannot be declared with an empty range.
+  if (addrWidth == 0 || mem.dataWidth == 0)
+    sparse = false;
+  StringRef memName = op.getName();
+  Value reg;
+  if (sparse) {
+    b.create<sv::VerbatimOp>("reg [" + Twine(mem.dataWidth - 1) + ":0] " +
+                             memName + " [bit [" + Twine(addrWidth - 1) +
+                             ":0]];");
+  } else {
+    reg = b.create<sv::RegOp>(hw::UnpackedArrayType::get(dataType, mem.depth),
+                              b.getStringAttr("Memory"));
+  }
+  auto readMemory = [&](Value addr) -> Value {
+    if (sparse)
+      return b.create<sv::VerbatimExprOp>(
+          dataType, b.getStringAttr(memName + "[{{0}}]"), ValueRange{addr});
+    return b.create<sv::ReadInOutOp>(
+        b.create<sv::ArrayIndexInOutOp>(reg, addr));
+  };
+  auto writeMemory = [&](Value addr, Value data) {
+    if (sparse)
+      b.create<sv::VerbatimOp>(b.getStringAttr(memName + "[{{0}}] <= {{1}};"),
+                               ValueRange{addr, data});
+    else
+      b.create<sv::PAssignOp>(b.create<sv::ArrayIndexInOutOp>(reg, addr),
+                              data);
+  };
+
+  ClockedLogic logic(b,
+                     singleProcess ? op.body().getArgument(0) : Value());
 
   SmallVector<Value, 4> outputs;
 
@@ -94,12 +211,11 @@ void HWMemSimImplPass::generateMemory(hw::HWModuleOp op, FirMemory mem) {
     Value en = op.body().getArgument(inArg++);
     Value addr = op.body().getArgument(inArg++);
     // Add pipeline stages
-    en = addPipelineStages(b, mem.readLatency, clock, en);
-    addr = addPipelineStages(b, mem.readLatency, clock, addr);
+    en = addPipelineStages(b, logic, mem.readLatency, clock, en);
+    addr = addPipelineStages(b, logic, mem.readLatency, clock, addr);
 
     // Read Logic
-    Value ren =
-        b.create<sv::ReadInOutOp>(b.create<sv::ArrayIndexInOutOp>(reg, addr));
+    Value ren = readMemory(addr);
     Value x = b.create<sv::ConstantXOp>(dataType);
 
     Value rdata = b.create<comb::MuxOp>(en, ren, x);
@@ -116,19 +232,21 @@ void HWMemSimImplPass::generateMemory(hw::HWModuleOp op, FirMemory mem) {
     Value wdata = op.body().getArgument(inArg++);
 
     // Add pipeline stages
-    en = addPipelineStages(b, numStages, clock, en);
-    addr = addPipelineStages(b, numStages, clock, addr);
-    wmode = addPipelineStages(b, numStages, clock, wmode);
-    wmask = addPipelineStages(b, numStages, clock, wmask);
-    wdata = addPipelineStages(b, numStages, clock, wdata);
+    en = addPipelineStages(b, logic, numStages, clock, en);
+    addr = addPipelineStages(b, logic, numStages, clock, addr);
+    wmode = addPipelineStages(b, logic, numStages, clock, wmode);
+    wmask = addPipelineStages(b, logic, numStages, clock, wmask);
+    wdata = addPipelineStages(b, logic, numStages, clock, wdata);
 
     // wire to store read result
     auto rWire = b.create<sv::WireOp>(wdata.getType());
     Value rdata = b.create<sv::ReadInOutOp>(rWire);
 
     // RW logic
-    b.create<sv::AlwaysFFOp>(sv::EventControl::AtPosEdge, clock, [&]() {
-      auto slot = b.create<sv::ArrayIndexInOutOp>(reg, addr);
+    logic.add(clock, [&, addr, en, wmode, wmask, wdata, rWire]() {
+      Value slot;
+      if (!sparse)
+        slot = b.create<sv::ArrayIndexInOutOp>(reg, addr);
       auto rcond = b.createOrFold<comb::AndOp>(
           en, b.createOrFold<comb::ICmpOp>(
                   comb::ICmpPredicate::eq, wmode,
@@ -138,10 +256,18 @@ void HWMemSimImplPass::generateMemory(hw::HWModuleOp op, FirMemory mem) {
 
       b.create<sv::PAssignOp>(rWire, b.create<sv::ConstantXOp>(dataType));
       b.create<sv::IfOp>(
-          wcond, [&]() { b.create<sv::PAssignOp>(slot, wdata); },
+          wcond,
+          [&]() {
+            if (sparse)
+              writeMemory(addr, wdata);
+            else
+              b.create<sv::PAssignOp>(slot, wdata);
+          },
           [&]() {
             b.create<sv::IfOp>(rcond, [&]() {
-              b.create<sv::PAssignOp>(rWire, b.create<sv::ReadInOutOp>(slot));
+              Value rdata = sparse ? readMemory(addr)
+                                   : Value(b.create<sv::ReadInOutOp>(slot));
+              b.create<sv::PAssignOp>(rWire, rdata);
             });
           });
     });
@@ -156,21 +282,20 @@ void HWMemSimImplPass::generateMemory(hw::HWModuleOp op, FirMemory mem) {
     Value wmask = op.body().getArgument(inArg++);
     Value wdata = op.body().getArgument(inArg++);
     // Add pipeline stages
-    en = addPipelineStages(b, numStages, clock, en);
-    addr = addPipelineStages(b, numStages, clock, addr);
-    wmask = addPipelineStages(b, numStages, clock, wmask);
-    wdata = addPipelineStages(b, numStages, clock, wdata);
+    en = addPipelineStages(b, logic, numStages, clock, en);
+    addr = addPipelineStages(b, logic, numStages, clock, addr);
+    wmask = addPipelineStages(b, logic, numStages, clock, wmask);
+    wdata = addPipelineStages(b, logic, numStages, clock, wdata);
 
     // Write logic
-    b.create<sv::AlwaysFFOp>(sv::EventControl::AtPosEdge, clock, [&]() {
+    logic.add(clock, [&, en, addr, wmask, wdata]() {
       auto wcond = b.createOrFold<comb::AndOp>(en, wmask);
-      b.create<sv::IfOp>(wcond, [&]() {
-        auto slot = b.create<sv::ArrayIndexInOutOp>(reg, addr);
-        b.create<sv::PAssignOp>(slot, wdata);
-      });
+      b.create<sv::IfOp>(wcond, [&]() { writeMemory(addr, wdata); });
     });
   }
 
+  logic.finalize();
+
   auto outputOp = op.getBodyBlock()->getTerminator();
   outputOp->setOperands(outputs);
 }
@@ -178,9 +303,47 @@ void HWMemSimImplPass::generateMemory(hw::HWModuleOp op, FirMemory mem) {
 void HWMemSimImplPass::runOnOperation() {
   auto topModule = getOperation().getBody();
 
-  SmallVector<hw::HWModuleGeneratedOp> toErase;
+  auto memModel = llvm::StringSwitch<Optional<MemModel>>(model)
+                      .Case("behavioral", MemModel::Behavioral)
+                      .Case("single-process", MemModel::SingleProcess)
+                      .Case("sparse", MemModel::Sparse)
+                      .Default(llvm::None);
+  if (!memModel) {
+    getOperation().emitError() << "unknown memory model '" << model << "'";
+    return signalPassFailure();
+  }
+
+  // Combining the ports of a memory into a single process is only correct if
+  // every instance drives all the clocks of the memory with the same value.
+  // Record the modules which have an instance driving distinct clocks.
+  llvm::StringMap<SmallVector<unsigned>> clockArgs;
+  llvm::StringSet<> multiClockModules;
+  if (*memModel != MemModel::Behavioral) {
+    for (auto op : topModule->getOps<hw::HWModuleGeneratedOp>()) {
+      auto name =
+          op->getAttrOfType<StringAttr>(SymbolTable::getSymbolAttrName());
+      clockArgs[name.getValue()] = getClockArgs(analyzeMemOp(op));
+    }
+    getOperation().walk([&](hw::InstanceOp inst) {
+      auto it = clockArgs.find(inst.moduleName());
+      if (it == clockArgs.end() || it->second.empty())
+        return;
+      auto inputs = inst.inputs();
+      Value clock = inputs[it->second.front()];
+      if (llvm::any_of(it->second, [&](unsigned arg) {
+            return inputs[arg] != clock;
+          }))
+        multiClockModules.insert(inst.moduleName());
+    });
+  }
+
   bool anythingChanged = false;
 
+  // The memories implemented so far, and the generated modules which are
+  // replaced by the implementation of an identical memory.
+  std::map<FirMemory, SmallVector<MemImpl, 1>> memImpls;
+  llvm::StringMap<StringAttr> replacedModules;
+
   for (auto op : llvm::make_early_inc_range(
            topModule->getOps<hw::HWModuleGeneratedOp>())) {
     auto oldModule = cast<hw::HWModuleGeneratedOp>(op);
@@ -190,21 +353,61 @@ void HWMemSimImplPass::runOnOperation() {
 
     if (genOp.descriptor() == "FIRRTL_Memory") {
       auto mem = analyzeMemOp(oldModule);
+      auto nameAttr = oldModule->getAttrOfType<StringAttr>(
+          SymbolTable::getSymbolAttrName());
+      anythingChanged = true;
+
+      bool sparse = *memModel == MemModel::Sparse ||
+                    (sparseDepth && mem.depth >= sparseDepth);
+      bool singleProcess = *memModel != MemModel::Behavioral &&
+                           !multiClockModules.count(nameAttr.getValue());
+
+      // If an identical memory has already been implemented, use it instead.
+      MemImpl impl = {oldModule.getType(),
+                      oldModule.argNamesAttr(),
+                      oldModule.resultNamesAttr(),
+                      oldModule.verilogNameAttr(),
+                      sparse,
+                      singleProcess,
+                      nameAttr};
+      auto &impls = memImpls[mem];
+      auto *existing = llvm::find_if(impls, [&](const MemImpl &other) {
+        return impl.type == other.type && impl.argNames == other.argNames &&
+               impl.resultNames == other.resultNames &&
+               impl.verilogName == other.verilogName &&
+               impl.sparse == other.sparse &&
+               impl.singleProcess == other.singleProcess;
+      });
+      if (existing != impls.end()) {
+        replacedModules[nameAttr.getValue()] = existing->implName;
+        oldModule.erase();
+        continue;
+      }
+      impls.push_back(impl);
 
       OpBuilder builder(oldModule);
-      auto nameAttr = builder.getStringAttr(oldModule.getName());
       auto newModule = builder.create<hw::HWModuleOp>(
           oldModule.getLoc(), nameAttr, oldModule.getPorts());
-      generateMemory(newModule, mem);
+      generateMemory(newModule, mem, sparse, singleProcess);
       oldModule.erase();
-      anythingChanged = true;
     }
   }
 
+  // Point the instances of replaced memories to the shared implementation.
+  if (!replacedModules.empty()) {
+    getOperation().walk([&](hw::InstanceOp inst) {
+      auto it = replacedModules.find(inst.moduleName());
+      if (it != replacedModules.end())
+        inst->setAttr("moduleName", FlatSymbolRefAttr::get(
+                                        &getContext(), it->second.getValue()));
+    });
+  }
+
   if (!anythingChanged)
     markAllAnalysesPreserved();
 }
 
-std::unique_ptr<Pass> circt::sv::createHWMemSimImplPass() {
-  return std::make_unique<HWMemSimImplPass>();
+std::unique_ptr<Pass> circt::sv::createHWMemSimImplPass(StringRef model,
+                                                        unsigned sparseDepth) {
+  return std::make_unique<HWMemSimImplPass>(model, sparseDepth);
 }
@@ -38,6 +38,12 @@ private:
   bool prettifyUnaryOperator(Operation *op);
   void sinkOrCloneOpToUses(Operation *op);
   void sinkExpression(Operation *op);
+  void computeBlockDepths(Block &block, unsigned depth);
+
+  /// The depth of each block in the region tree of the module, where the body
+  /// of the module has depth zero.  Sinking moves operations but never changes
+  /// the region tree, so this is computed once per module.
+  DenseMap<Block *, unsigned> blockDepths;
 
   bool anythingChanged;
 };
@@ -151,15 +157,13 @@ bool PrettifyVerilogPass::prettifyUnaryOperator(Operation *op) {
   return true;
 }
 
-// Return the depth of the specified block in the region tree, stopping at
-// 'topBlock'.
-static unsigned getBlockDepth(Block *block, Block *topBlock) {
-  unsigned result = 0;
-  while (block != topBlock) {
-    block = block->getParentOp()->getBlock();
-    ++result;
-  }
-  return result;
+/// Record the depth of the specified block and of all the blocks nested in it.
+void PrettifyVerilogPass::computeBlockDepths(Block &block, unsigned depth) {
+  blockDepths[&block] = depth;
+  for (auto &op : block)
+    for (auto &region : op.getRegions())
+      for (auto &regionBlock : region)
+        computeBlockDepths(regionBlock, depth + 1);
 }
 
 /// This method is called on expressions to see if we can sink them down the
@@ -180,11 +184,14 @@ void PrettifyVerilogPass::sinkExpression(Operation *op) {
     return;
   }
 
-  // Find the nearest common ancestor of all the users.
+  // Find the nearest common ancestor of all the users.  The users are all
+  // nested in the block of the op, so the depths relative to it are found by
+  // subtracting its own depth.
+  unsigned curOpBlockDepth = blockDepths.lookup(curOpBlock);
   auto userIt = op->user_begin();
   Block *ncaBlock = userIt->getBlock();
   ++userIt;
-  unsigned ncaBlockDepth = getBlockDepth(ncaBlock, curOpBlock);
+  unsigned ncaBlockDepth = blockDepths.lookup(ncaBlock) - curOpBlockDepth;
   if (ncaBlockDepth == 0)
     return; // Have a user in the current block.
 
@@ -197,7 +204,7 @@ void PrettifyVerilogPass::sinkExpression(Operation *op) {
 
     // Get the region depth of the user block so we can march up the region tree
     // to a common ancestor.
-    unsigned userBlockDepth = getBlockDepth(userBlock, curOpBlock);
+    unsigned userBlockDepth = blockDepths.lookup(userBlock) - curOpBlockDepth;
     while (userBlock != ncaBlock) {
       if (ncaBlockDepth < userBlockDepth) {
         userBlock = userBlock->getParentOp()->getBlock();
@@ -280,6 +287,9 @@ void PrettifyVerilogPass::runOnOperation() {
   // the analyses were preserved.
   anythingChanged = false;
 
+  blockDepths.clear();
+  computeBlockDepths(*getOperation().getBodyBlock(), 0);
+
   // Walk the operations in post-order, transforming any that are interesting.
   processPostOrder(*getOperation().getBodyBlock());
 
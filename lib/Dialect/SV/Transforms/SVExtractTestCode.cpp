@@ -29,99 +29,117 @@ using namespace sv;
 // StubExternalModules Helpers
 //===----------------------------------------------------------------------===//
 
-// Reimplemented from SliceAnalysis to use a worklist rather than recursion and
-// non-insert ordered set.
-static void getBackwardSliceSimple(Operation *rootOp,
-                                   SmallPtrSetImpl<Operation *> &backwardSlice,
-                                   std::function<bool(Operation *)> filter) {
-  SmallVector<Operation *> worklist;
-  worklist.push_back(rootOp);
-
-  while (!worklist.empty()) {
-    Operation *op = worklist.back();
-    worklist.pop_back();
-
-    if (!op || op->hasTrait<mlir::OpTrait::IsIsolatedFromAbove>())
-      continue;
+/// A bitmask of the groups of roots an operation is part of the slice of.
+using GroupMask = uint8_t;
+static constexpr unsigned maxGroups = sizeof(GroupMask) * 8;
+
+/// Return true if the dataflow into the specified operation should be part of
+/// the slice.  Slices stop at state and instances.
+static bool isInDataflowSlice(Operation *op) {
+  return !op->hasTrait<mlir::OpTrait::IsIsolatedFromAbove>() &&
+         !isa<sv::ReadInOutOp, hw::InstanceOp, sv::PAssignOp, sv::BPAssignOp>(
+             op);
+}
 
-    // Evaluate whether we should keep this def.
-    // This is useful in particular to implement scoping; i.e. return the
-    // transitive backwardSlice in the current scope.
-    if (filter && !filter(op))
-      continue;
+// Aggressively mark operations to be moved to the new module.  This leaves
+// maximum flexibility for optimization after removal of the nodes from the
+// old module.  The clone set of each group of roots includes the roots, the
+// dataflow into them, the operations whose blocks contain any of those, and
+// the dataflow into the latter.
+//
+// The clone sets of all the groups are computed at once: every operation in
+// the module gets a dense ID and a bitmask of the groups whose slice it is in,
+// so that logic shared by many roots is only visited once per group.
+static void
+computeCloneSets(hw::HWModuleOp module,
+                 ArrayRef<SmallPtrSet<Operation *, 8>> roots,
+                 SmallVectorImpl<SmallPtrSet<Operation *, 16>> &cloneSets) {
+  assert(roots.size() <= maxGroups && "too many groups of roots");
+  DenseMap<Operation *, unsigned> opIDs;
+  std::vector<Operation *> ops;
+  module.walk([&](Operation *op) {
+    opIDs.insert({op, ops.size()});
+    ops.push_back(op);
+  });
+  std::vector<GroupMask> dataflowMasks(ops.size()), blockMasks(ops.size());
 
-    for (auto en : llvm::enumerate(op->getOperands())) {
-      auto operand = en.value();
+  // Propagate the groups in `mask` backward through the dataflow.
+  SmallVector<std::pair<Operation *, GroupMask>> worklist;
+  auto addOperands = [&](Operation *op, GroupMask mask) {
+    for (auto operand : op->getOperands()) {
       if (auto *definingOp = operand.getDefiningOp()) {
-        if (backwardSlice.count(definingOp) == 0)
-          worklist.push_back(definingOp);
+        worklist.push_back({definingOp, mask});
       } else if (auto blockArg = operand.dyn_cast<BlockArgument>()) {
-        Block *block = blockArg.getOwner();
-        Operation *parentOp = block->getParentOp();
+        Operation *parentOp = blockArg.getOwner()->getParentOp();
         // TODO: determine whether we want to recurse backward into the other
         // blocks of parentOp, which are not technically backward unless they
         // flow into us. For now, just bail.
         assert(parentOp->getNumRegions() == 1 &&
                parentOp->getRegion(0).getBlocks().size() == 1);
-        if (backwardSlice.count(parentOp) == 0)
-          worklist.push_back(parentOp);
+        worklist.push_back({parentOp, mask});
       } else {
         llvm_unreachable("No definingOp and not a block argument.");
       }
     }
-
-    backwardSlice.insert(op);
-  }
-
-  // Don't insert the top level operation, we just queried on it and don't
-  // want it in the results.
-  backwardSlice.erase(rootOp);
-}
-
-// Compute the dataflow for a set of ops.
-static void dataflowSlice(SmallPtrSetImpl<Operation *> &ops,
-                          SmallPtrSetImpl<Operation *> &results) {
-  for (auto op : ops) {
-    getBackwardSliceSimple(op, results, [](Operation *testOp) -> bool {
-      return !isa<sv::ReadInOutOp>(testOp) && !isa<hw::InstanceOp>(testOp) &&
-             !isa<sv::PAssignOp>(testOp) && !isa<sv::BPAssignOp>(testOp);
-    });
-  }
-}
-
-// Compute the ops defining the blocks a set of ops are in.
-static void blockSlice(SmallPtrSetImpl<Operation *> &ops,
-                       SmallPtrSetImpl<Operation *> &blocks) {
-  for (auto op : ops) {
-    while (!isa<hw::HWModuleOp>(op->getParentOp())) {
-      op = op->getParentOp();
-      blocks.insert(op);
+  };
+  auto sliceDataflow = [&]() {
+    while (!worklist.empty()) {
+      Operation *op;
+      GroupMask mask;
+      std::tie(op, mask) = worklist.pop_back_val();
+      if (!isInDataflowSlice(op))
+        continue;
+      auto &opMask = dataflowMasks[opIDs.lookup(op)];
+      GroupMask newMask = mask & ~opMask;
+      if (!newMask)
+        continue;
+      opMask |= newMask;
+      addOperands(op, newMask);
+    }
+  };
+
+  // Mark the operations containing `op` up to the module.  The ancestors of a
+  // marked operation are marked as well, so we can stop at the first one that
+  // already has all the groups.
+  auto sliceBlocks = [&](Operation *op, GroupMask mask) {
+    for (Operation *parentOp = op->getParentOp();
+         !isa<hw::HWModuleOp>(parentOp); parentOp = parentOp->getParentOp()) {
+      auto &parentMask = blockMasks[opIDs.lookup(parentOp)];
+      if ((parentMask & mask) == mask)
+        break;
+      parentMask |= mask;
+    }
+  };
+
+  // Get the dataflow for the roots.
+  std::vector<GroupMask> rootMasks(ops.size());
+  for (auto group : llvm::enumerate(roots)) {
+    GroupMask mask = 1 << group.index();
+    for (auto *root : group.value()) {
+      rootMasks[opIDs.lookup(root)] |= mask;
+      if (isInDataflowSlice(root))
+        addOperands(root, mask);
     }
   }
-}
-
-// Aggressively mark operations to be moved to the new module.  This leaves
-// maximum flexibility for optimization after removal of the nodes from the
-// old module.
-static SmallPtrSet<Operation *, 16>
-computeCloneSet(SmallPtrSetImpl<Operation *> &roots) {
-  SmallPtrSet<Operation *, 16> results;
-  // Get Dataflow for roots
-  dataflowSlice(roots, results);
-
-  // Get Blocks
-  SmallPtrSet<Operation *, 8> blocks;
-  blockSlice(roots, blocks);
-  blockSlice(results, blocks);
-
-  // Make sure dataflow to block args (if conds, etc) is included
-  dataflowSlice(blocks, results);
-
-  // include the blocks and roots to clone
-  results.insert(roots.begin(), roots.end());
-  results.insert(blocks.begin(), blocks.end());
-
-  return results;
+  sliceDataflow();
+
+  // Get the blocks of the roots and their dataflow, and make sure the dataflow
+  // to block arguments (if conds, etc) is included.
+  for (size_t id = 0, e = ops.size(); id != e; ++id)
+    if (GroupMask mask = rootMasks[id] | dataflowMasks[id])
+      sliceBlocks(ops[id], mask);
+  for (size_t id = 0, e = ops.size(); id != e; ++id)
+    if (blockMasks[id] && isInDataflowSlice(ops[id]))
+      addOperands(ops[id], blockMasks[id]);
+  sliceDataflow();
+
+  cloneSets.resize(roots.size());
+  for (size_t id = 0, e = ops.size(); id != e; ++id) {
+    GroupMask mask = rootMasks[id] | dataflowMasks[id] | blockMasks[id];
+    for (unsigned group = 0; mask; ++group, mask >>= 1)
+      if (mask & 1)
+        cloneSets[group].insert(ops[id]);
+  }
 }
 
 StringRef getNameForPort(Value val, ArrayAttr modulePorts) {
@@ -260,14 +278,8 @@ struct SVExtractTestCodeImplPass
   void runOnOperation() override;
 
 private:
-  void doModule(hw::HWModuleOp module, std::function<bool(Operation *)> fn,
-                StringRef suffix) {
-    // Find Operations of interest.
-    SmallPtrSet<Operation *, 8> roots;
-    module->walk([&fn, &roots](Operation *op) {
-      if (fn(op))
-        roots.insert(op);
-    });
+  void doModule(hw::HWModuleOp module, SmallPtrSetImpl<Operation *> &roots,
+                SmallPtrSetImpl<Operation *> &opsToClone, StringRef suffix) {
     // No Ops?  No problem.
     if (roots.empty())
       return;
@@ -285,8 +297,6 @@ private:
         break;
       }
 
-    // Find the data-flow and structural ops to clone.  Result includes roots.
-    auto opsToClone = computeCloneSet(roots);
     // Find the dataflow into the clone set
     SetVector<Value> inputs;
     for (auto op : opsToClone)
@@ -314,16 +324,28 @@ void SVExtractTestCodeImplPass::runOnOperation() {
   auto *topLevelModule = getOperation().getBody();
   for (auto &op : topLevelModule->getOperations())
     if (auto rtlmod = dyn_cast<hw::HWModuleOp>(op)) {
-      // Extract two sets of ops to different modules
-      auto isAssert = [](Operation *op) -> bool {
-        return isa<AssertOp>(op) || isa<FinishOp>(op) || isa<FWriteOp>(op);
-      };
-      auto isAssume = [](Operation *op) -> bool { return isa<AssumeOp>(op); };
-      auto isCover = [](Operation *op) -> bool { return isa<CoverOp>(op); };
-
-      doModule(rtlmod, isAssert, "_assert");
-      doModule(rtlmod, isAssume, "_assume");
-      doModule(rtlmod, isCover, "_cover");
+      // Extract three sets of ops to different modules.  Find the operations
+      // of interest.
+      enum { Assert, Assume, Cover, NumGroups };
+      SmallPtrSet<Operation *, 8> roots[NumGroups];
+      rtlmod->walk([&](Operation *op) {
+        if (isa<AssertOp, FinishOp, FWriteOp>(op))
+          roots[Assert].insert(op);
+        else if (isa<AssumeOp>(op))
+          roots[Assume].insert(op);
+        else if (isa<CoverOp>(op))
+          roots[Cover].insert(op);
+      });
+
+      // Find the data-flow and structural ops to clone for all of them at
+      // once.  The results include the roots.  Extracting a set only erases
+      // its roots, which are never part of the other sets.
+      SmallVector<SmallPtrSet<Operation *, 16>, NumGroups> opsToClone;
+      computeCloneSets(rtlmod, roots, opsToClone);
+
+      doModule(rtlmod, roots[Assert], opsToClone[Assert], "_assert");
+      doModule(rtlmod, roots[Assume], opsToClone[Assume], "_assume");
+      doModule(rtlmod, roots[Cover], opsToClone[Cover], "_cover");
     }
 }
 
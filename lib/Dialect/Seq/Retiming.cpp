@@ -0,0 +1,444 @@
+//===- Retiming.cpp - Retime the registers of a module --------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements register retiming for `seq.compreg`, after Leiserson and
+// Saxe, "Retiming Synchronous Circuitry", Algorithmica 6, 1991.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/Seq/SeqOps.h"
+#include "circt/Scheduling/Problems.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+
+#define DEBUG_TYPE "seq-retime"
+
+using namespace mlir;
+using namespace circt;
+using namespace seq;
+
+using llvm::dbgs;
+
+namespace circt {
+namespace seq {
+#define GEN_PASS_CLASSES
+#include "circt/Dialect/Seq/SeqPasses.h.inc"
+} // namespace seq
+} // namespace circt
+
+/// Estimate the delay of a combinational operation, in gate delays. Wiring is
+/// free, bitwise operations and multiplexers cost one gate, and carry chains,
+/// comparators and shifters grow logarithmically with their width.
+static unsigned getDelay(Operation *op) {
+  auto logDelay = [](Value value) {
+    unsigned width = value.getType().getIntOrFloatBitWidth();
+    return llvm::Log2_32_Ceil(std::max(width, 1U)) + 1;
+  };
+  return TypeSwitch<Operation *, unsigned>(op)
+      .Case<comb::ExtractOp, comb::ConcatOp, comb::SExtOp>(
+          [](auto) { return 0U; })
+      .Case<comb::AndOp, comb::OrOp, comb::XorOp, comb::MuxOp>(
+          [](auto) { return 1U; })
+      .Case<comb::AddOp, comb::SubOp, comb::ShlOp, comb::ShrUOp, comb::ShrSOp>(
+          [&](auto) { return logDelay(op->getResult(0)); })
+      .Case<comb::ICmpOp, comb::ParityOp>(
+          [&](auto) { return logDelay(op->getOperand(0)); })
+      .Case<comb::MulOp>([&](auto) { return 2 * logDelay(op->getResult(0)); })
+      .Case<comb::DivUOp, comb::DivSOp, comb::ModUOp, comb::ModSOp>([&](auto) {
+        return op->getResult(0).getType().getIntOrFloatBitWidth();
+      })
+      .Default([](Operation *) { return 1U; });
+}
+
+namespace {
+
+/// The retiming graph of a module. Node 0 is the environment of the
+/// combinational logic, i.e. the ports, constants aside, and the operations
+/// which are not retimed. It is represented by the terminator of the module.
+/// The other nodes are the `comb` operations of the module body. The weight of
+/// an edge is the number of retimed registers on the connection.
+///
+/// A retiming assigns a lag to every node. The number of registers on an edge
+/// after retiming is `weight + lag[dst] - lag[src]`, and the retiming is legal
+/// if none is negative. Paths from the environment back to it keep their
+/// number of registers, so the latency of the module is unchanged.
+class RetimingGraph {
+public:
+  explicit RetimingGraph(hw::HWModuleOp module)
+      : module(module), problem(module) {}
+
+  /// Build the graph and the scheduling problem. Return failure if there is
+  /// nothing to retime, or if the module has a combinational cycle.
+  LogicalResult build();
+
+  /// Return the clock period of the module before retiming.
+  unsigned getPeriod() const { return period; }
+  /// Return the largest delay of a node, a lower bound for the clock period.
+  unsigned getMaxDelay() const {
+    return *std::max_element(delays.begin(), delays.end());
+  }
+
+  /// Compute a legal retiming with a clock period of at most \p target with
+  /// the FEAS algorithm. Return false if there is none.
+  bool retime(unsigned target, SmallVectorImpl<int> &lags);
+
+  /// Store the retiming in the scheduling problem, and check its legality.
+  LogicalResult verify(ArrayRef<int> lags);
+
+  /// Move the registers of the module according to the retiming.
+  void apply(ArrayRef<int> lags);
+
+private:
+  struct Edge {
+    unsigned src, dst;
+    unsigned weight;
+  };
+
+  /// A use of a value, possibly through retimed registers, which is rewritten
+  /// once the module is retimed.
+  struct Use {
+    OpOperand *operand;
+    Value source;
+    unsigned src, dst;
+    unsigned weight;
+    bool isConstant;
+  };
+
+  int getRetimedWeight(const Edge &edge, ArrayRef<int> lags) const {
+    return int(edge.weight) + lags[edge.dst] - lags[edge.src];
+  }
+
+  /// Return the value delayed by a chain of retimed registers to produce
+  /// \p value, and the length of the chain. Fail on a cycle of registers.
+  Optional<std::pair<Value, unsigned>> trace(Value value);
+
+  /// Compute the time at which the output of every node settles, in the
+  /// combinational logic left by the retiming. The environment launches its
+  /// values at time 0. Return false if this logic has a cycle.
+  bool computeArrivalTimes(ArrayRef<int> lags,
+                           SmallVectorImpl<unsigned> &arrival);
+
+  /// Increase the lags of the destinations of edges with a negative number of
+  /// registers, until the retiming is legal. Return false if it cannot be.
+  bool legalize(SmallVectorImpl<int> &lags);
+
+  hw::HWModuleOp module;
+  scheduling::CyclicProblem problem;
+
+  Value clock;
+  llvm::SetVector<Operation *> registers;
+
+  SmallVector<Operation *> nodes;
+  DenseMap<Operation *, unsigned> nodeIds;
+  SmallVector<unsigned> delays;
+
+  /// The edges, sorted by source. The edges leaving node `i` are
+  /// `edgeBegin[i]`, ..., `edgeBegin[i+1]-1`.
+  SmallVector<Edge> edges;
+  SmallVector<unsigned> edgeBegin;
+
+  SmallVector<Use> uses;
+  unsigned period = 0;
+};
+
+} // end anonymous namespace
+
+Optional<std::pair<Value, unsigned>> RetimingGraph::trace(Value value) {
+  unsigned weight = 0;
+  while (auto reg = value.getDefiningOp<CompRegOp>()) {
+    if (!registers.count(reg))
+      break;
+    if (++weight > registers.size())
+      return llvm::None;
+    value = reg.input();
+  }
+  return std::make_pair(value, weight);
+}
+
+LogicalResult RetimingGraph::build() {
+  Block *body = module.getBodyBlock();
+
+  // Only registers without a reset on a single clock are retimed.
+  for (auto reg : body->getOps<CompRegOp>()) {
+    if (reg.reset())
+      continue;
+    if (!clock)
+      clock = reg.clk();
+    if (reg.clk() == clock)
+      registers.insert(reg);
+  }
+  if (registers.empty())
+    return failure();
+
+  auto *combDialect =
+      module.getContext()->getLoadedDialect<comb::CombDialect>();
+  nodes.push_back(body->getTerminator());
+  delays.push_back(0);
+  for (auto &op : *body) {
+    if (!combDialect || op.getDialect() != combDialect)
+      continue;
+    nodeIds[&op] = nodes.size();
+    nodes.push_back(&op);
+    delays.push_back(getDelay(&op));
+  }
+
+  auto opr = problem.getOrInsertOperatorType("comb");
+  problem.setLatency(opr, 0);
+  for (auto *node : nodes) {
+    problem.insertOperation(node);
+    problem.setLinkedOperatorType(node, opr);
+  }
+
+  // Collect the uses of the node results and of the retimed registers. The
+  // operands of the registers are part of the chains being traced.
+  auto result = body->walk([&](Operation *op) {
+    if (registers.count(op))
+      return WalkResult::advance();
+    unsigned dst = nodeIds.lookup(op);
+    for (auto &operand : op->getOpOperands()) {
+      auto traced = trace(operand.get());
+      if (!traced)
+        return WalkResult::interrupt();
+      Value source = traced->first;
+      unsigned weight = traced->second;
+      auto *sourceOp = source.getDefiningOp();
+      bool isConstant = sourceOp && sourceOp->hasTrait<OpTrait::ConstantLike>();
+      unsigned src = sourceOp ? nodeIds.lookup(sourceOp) : 0;
+      uses.push_back({&operand, source, src, dst, weight, isConstant});
+      if (isConstant || (src == 0 && dst == 0))
+        continue;
+      edges.push_back({src, dst, weight});
+
+      // Def-use dependences between registered operations are implicit in the
+      // problem. Parallel connections are constrained by the fewest registers.
+      if (src == dst ||
+          (weight == 0 && op == nodes[dst] && sourceOp == nodes[src]))
+        continue;
+      scheduling::Problem::Dependence dep(nodes[src], nodes[dst]);
+      (void)problem.insertDependence(dep);
+      auto distance = problem.getDistance(dep);
+      if (!distance || weight < *distance)
+        problem.setDistance(dep, weight);
+    }
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    return failure();
+
+  llvm::stable_sort(edges, [](const Edge &lhs, const Edge &rhs) {
+    return lhs.src < rhs.src;
+  });
+  edgeBegin.assign(nodes.size() + 1, 0);
+  for (auto &edge : edges)
+    ++edgeBegin[edge.src + 1];
+  for (unsigned i = 0, e = nodes.size(); i < e; ++i)
+    edgeBegin[i + 1] += edgeBegin[i];
+
+  if (failed(problem.check()))
+    return failure();
+
+  SmallVector<int> lags(nodes.size(), 0);
+  SmallVector<unsigned> arrival;
+  if (!computeArrivalTimes(lags, arrival))
+    return failure();
+  period = *std::max_element(arrival.begin(), arrival.end());
+
+  LLVM_DEBUG(dbgs() << "Retiming " << registers.size() << " registers over "
+                    << nodes.size() << " nodes and " << edges.size()
+                    << " edges, period " << period << "\n");
+  return success();
+}
+
+bool RetimingGraph::computeArrivalTimes(ArrayRef<int> lags,
+                                        SmallVectorImpl<unsigned> &arrival) {
+  unsigned numNodes = nodes.size();
+
+  // Visit the combinational logic in topological order. The edges leaving the
+  // environment start a new path, so they are not part of it.
+  SmallVector<unsigned> numPreds(numNodes, 0);
+  for (auto &edge : llvm::makeArrayRef(edges).drop_front(edgeBegin[1]))
+    if (getRetimedWeight(edge, lags) == 0)
+      ++numPreds[edge.dst];
+
+  arrival.assign(numNodes, 0);
+  SmallVector<unsigned> worklist;
+  for (unsigned i = 0; i < numNodes; ++i)
+    if (numPreds[i] == 0)
+      worklist.push_back(i);
+
+  unsigned numVisited = 0;
+  while (!worklist.empty()) {
+    unsigned node = worklist.pop_back_val();
+    ++numVisited;
+    arrival[node] += delays[node];
+    if (node == 0)
+      continue;
+    for (unsigned e = edgeBegin[node], end = edgeBegin[node + 1]; e != end;
+         ++e) {
+      auto &edge = edges[e];
+      if (getRetimedWeight(edge, lags) != 0)
+        continue;
+      arrival[edge.dst] = std::max(arrival[edge.dst], arrival[node]);
+      if (--numPreds[edge.dst] == 0)
+        worklist.push_back(edge.dst);
+    }
+  }
+  return numVisited == numNodes;
+}
+
+bool RetimingGraph::legalize(SmallVectorImpl<int> &lags) {
+  unsigned numNodes = nodes.size();
+  SmallVector<unsigned> worklist;
+  for (unsigned i = 0; i < numNodes; ++i)
+    worklist.push_back(i);
+  llvm::BitVector isQueued(numNodes, true);
+
+  // Lags only increase, so a node increased more often than there are nodes is
+  // on a cycle which cannot be made legal.
+  SmallVector<unsigned> numUpdates(numNodes, 0);
+  while (!worklist.empty()) {
+    unsigned src = worklist.pop_back_val();
+    isQueued.reset(src);
+    for (unsigned e = edgeBegin[src], end = edgeBegin[src + 1]; e != end;
+         ++e) {
+      auto &edge = edges[e];
+      int weight = getRetimedWeight(edge, lags);
+      if (weight >= 0)
+        continue;
+      lags[edge.dst] -= weight;
+      if (++numUpdates[edge.dst] > numNodes)
+        return false;
+      if (!isQueued.test(edge.dst)) {
+        isQueued.set(edge.dst);
+        worklist.push_back(edge.dst);
+      }
+    }
+  }
+  return true;
+}
+
+bool RetimingGraph::retime(unsigned target, SmallVectorImpl<int> &lags) {
+  unsigned numNodes = nodes.size();
+  lags.assign(numNodes, 0);
+
+  // Delay every node whose output settles too late by one more register, and
+  // restore legality, until the period is met. If a retiming exists, this
+  // converges within as many rounds as there are nodes.
+  SmallVector<unsigned> arrival;
+  for (unsigned round = 0; round <= numNodes; ++round) {
+    if (!computeArrivalTimes(lags, arrival))
+      return false;
+    bool isMet = true;
+    for (unsigned i = 0; i < numNodes; ++i) {
+      if (arrival[i] > target) {
+        ++lags[i];
+        isMet = false;
+      }
+    }
+    if (isMet)
+      return true;
+    if (!legalize(lags))
+      return false;
+  }
+  return false;
+}
+
+LogicalResult RetimingGraph::verify(ArrayRef<int> lags) {
+  int minLag = *std::min_element(lags.begin(), lags.end());
+  for (unsigned i = 0, e = nodes.size(); i < e; ++i)
+    problem.setStartTime(nodes[i], lags[i] - minLag);
+  problem.setInitiationInterval(1);
+  return problem.verify();
+}
+
+void RetimingGraph::apply(ArrayRef<int> lags) {
+  // Registers are shared by all the uses of a value with the same delay.
+  auto builder = OpBuilder::atBlockTerminator(module.getBodyBlock());
+  DenseMap<Value, SmallVector<Value, 2>> chains;
+  auto getDelayed = [&](Value value, unsigned weight) {
+    auto &chain = chains[value];
+    if (chain.empty())
+      chain.push_back(value);
+    while (chain.size() <= weight)
+      chain.push_back(builder.create<CompRegOp>(value.getLoc(),
+                                                value.getType(), chain.back(),
+                                                clock, Value(), Value()));
+    return chain[weight];
+  };
+
+  for (auto &use : uses) {
+    int weight = use.weight;
+    if (!use.isConstant)
+      weight += lags[use.dst] - lags[use.src];
+    assert(weight >= 0 && "retiming must be legal");
+    if (weight == 0 && use.weight == 0)
+      continue;
+    use.operand->set(getDelayed(use.source, weight));
+  }
+
+  // The remaining uses of the old registers are the chains between them.
+  for (auto *reg : registers)
+    reg->dropAllReferences();
+  for (auto *reg : registers)
+    reg->erase();
+}
+
+namespace {
+struct SeqRetimingPass : public RetimingBase<SeqRetimingPass> {
+  void runOnOperation() override;
+};
+} // end anonymous namespace
+
+void SeqRetimingPass::runOnOperation() {
+  RetimingGraph graph(getOperation());
+  if (failed(graph.build()))
+    return markAllAnalysesPreserved();
+
+  SmallVector<int> lags;
+  if (clockPeriod) {
+    if (!graph.retime(clockPeriod, lags)) {
+      getOperation().emitError()
+          << "cannot retime to a clock period of " << clockPeriod;
+      return signalPassFailure();
+    }
+  } else {
+    // Feasibility is monotone in the period, and the module meets its current
+    // period without retiming, so binary search for the smallest one.
+    unsigned minPeriod = graph.getMaxDelay(), maxPeriod = graph.getPeriod();
+    bool isRetimed = false;
+    SmallVector<int> candidate;
+    while (minPeriod < maxPeriod) {
+      unsigned target = minPeriod + (maxPeriod - minPeriod) / 2;
+      if (graph.retime(target, candidate)) {
+        maxPeriod = target;
+        lags = candidate;
+        isRetimed = true;
+      } else {
+        minPeriod = target + 1;
+      }
+    }
+    if (!isRetimed)
+      return markAllAnalysesPreserved();
+    LLVM_DEBUG(dbgs() << "Retimed to period " << maxPeriod << "\n");
+  }
+
+  if (failed(graph.verify(lags)))
+    return signalPassFailure();
+  graph.apply(lags);
+}
+
+std::unique_ptr<Pass> circt::seq::createSeqRetimingPass() {
+  return std::make_unique<SeqRetimingPass>();
+}
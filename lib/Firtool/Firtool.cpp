@@ -0,0 +1,305 @@
+//===- Firtool.cpp - The firtool lowering pipeline ------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Firtool/Firtool.h"
+#include "circt/Conversion/Passes.h"
+#include "circt/Dialect/Comb/CombDialect.h"
+#include "circt/Dialect/FIRRTL/FIRRTLDialect.h"
+#include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "circt/Dialect/FIRRTL/Passes.h"
+#include "circt/Dialect/HW/HWDialect.h"
+#include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/SV/SVDialect.h"
+#include "circt/Dialect/SV/SVOps.h"
+#include "circt/Dialect/SV/SVPasses.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <atomic>
+#include <numeric>
+
+using namespace mlir;
+using namespace circt;
+using namespace firtool;
+
+/// Create a simple canonicalizer pass.
+static std::unique_ptr<Pass> createSimpleCanonicalizerPass() {
+  mlir::GreedyRewriteConfig config;
+  config.useTopDownTraversal = true;
+  config.enableRegionSimplification = false;
+  return mlir::createCanonicalizerPass(config);
+}
+
+void firtool::populateFIRRTLToHWPasses(PassManager &pm,
+                                       const FirtoolOptions &options) {
+  bool disableOptimization = options.disableOptimization;
+
+  // Every nested module pipeline between two circuit passes is a barrier which
+  // waits for the slowest module, so module passes are grouped into as few
+  // nested pipelines as the circuit passes around them allow. When whens are
+  // expanded, CSE runs in the same sweep over the modules instead of in one of
+  // its own up front.
+  bool expandWhensPipeline = options.lowerTypes && options.expandWhens;
+  if (!disableOptimization && !expandWhensPipeline) {
+    pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>().addPass(
+        createCSEPass());
+  }
+
+  // Width inference creates canonicalization opportunities.
+  if (options.inferWidths)
+    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createInferWidthsPass(
+        options.parallelInferWidths, options.inferWidthsCache));
+
+  if (options.inferResets)
+    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createInferResetsPass());
+
+  // Folding once the widths are known shrinks the IR that the type lowering
+  // and when expansion then have to process.
+  if (options.earlyFold && !disableOptimization)
+    pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>().addPass(
+        firrtl::createFoldPass());
+
+  // The input mlir file could be firrtl dialect so we might need to clean
+  // things up.
+  if (options.lowerTypes) {
+    pm.addNestedPass<firrtl::CircuitOp>(firrtl::createLowerFIRRTLTypesPass());
+    // Only enable expand whens if lower types is also enabled.
+    if (expandWhensPipeline) {
+      auto &modulePM = pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>();
+      modulePM.addPass(firrtl::createExpandWhensPass());
+      if (!disableOptimization)
+        modulePM.addPass(createCSEPass());
+    }
+  }
+
+  if (options.checkCombCycles)
+    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createCheckCombCyclesPass());
+
+  // If we parsed a FIRRTL file and have optimizations enabled, clean it up.
+  if (!disableOptimization)
+    pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>().addPass(
+        createSimpleCanonicalizerPass());
+
+  if (options.inliner)
+    pm.nest<firrtl::CircuitOp>().addPass(
+        firrtl::createInlinerPass(options.autoInline));
+
+  if (options.imconstprop.getValueOr(!disableOptimization))
+    pm.nest<firrtl::CircuitOp>().addPass(
+        firrtl::createIMConstPropPass(options.parallelIMConstProp));
+
+  if (options.removeUnusedPorts && !disableOptimization)
+    pm.nest<firrtl::CircuitOp>().addPass(
+        firrtl::createRemoveUnusedPortsPass());
+
+  if (options.dedup)
+    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createDedupPass());
+
+  if (options.blackBoxMemory)
+    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createBlackBoxMemoryPass());
+
+  // Read black box source files into the IR.
+  StringRef blackBoxRoot = options.blackBoxRoot;
+  pm.nest<firrtl::CircuitOp>().addPass(firrtl::createBlackBoxReaderPass(
+      blackBoxRoot, options.blackBoxResourceRoot.empty()
+                        ? blackBoxRoot
+                        : StringRef(options.blackBoxResourceRoot)));
+
+  if (options.grandCentral) {
+    auto &circuitPM = pm.nest<firrtl::CircuitOp>();
+    circuitPM.addPass(firrtl::createGrandCentralPass());
+    circuitPM.addPass(firrtl::createGrandCentralTapsPass());
+  }
+
+  // Only the annotations read by the lowering to HW are left past this point,
+  // so that the canonicalizer and the lowering do not carry the others along.
+  if (options.reduceMemory && options.lowersToHW() &&
+      !options.warnOnUnprocessedAnnotations)
+    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createDropAnnotationsPass(
+        {"firrtl.transforms.DontTouchAnnotation",
+         "sifive.enterprise.firrtl.ExtractAssertionsAnnotation",
+         "sifive.enterprise.firrtl.ExtractAssumptionsAnnotation",
+         "sifive.enterprise.firrtl.ExtractCoverageAnnotation"}));
+
+  // The above passes, IMConstProp in particular, introduce additional
+  // canonicalization opportunities that we should pick up here before we
+  // proceed to output-specific pipelines.
+  if (!disableOptimization)
+    pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>().addPass(
+        createSimpleCanonicalizerPass());
+
+  // Lower if we are going to verilog or if lowering was specifically requested.
+  if (!options.lowersToHW())
+    return;
+
+  pm.addPass(createLowerFIRRTLToHWPass(options.warnOnUnprocessedAnnotations));
+  pm.addPass(sv::createHWMemSimImplPass(options.memoryModel,
+                                        options.sparseMemoryDepth));
+
+  if (options.extractTestCode)
+    pm.addPass(sv::createSVExtractTestCodePass());
+
+  // Legalize the module names if we're going to verilog.  This is done before
+  // the optimizer so that the per-module passes of the cleanup form a single
+  // nested pipeline: each module then runs through all of them in one parallel
+  // sweep, instead of the whole design going through each pass in turn.
+  if (options.emitVerilog)
+    pm.addPass(sv::createHWLegalizeNamesPass());
+}
+
+void firtool::populateHWCleanupPasses(PassManager &pm,
+                                      const FirtoolOptions &options) {
+  // If enabled, run the optimizer, and tidy up the IR to improve verilog
+  // emission quality.
+  if (!options.lowersToHW() || options.disableOptimization)
+    return;
+
+  auto &modulePM = pm.nest<hw::HWModuleOp>();
+  modulePM.addPass(sv::createHWCleanupPass());
+  modulePM.addPass(createCSEPass());
+  modulePM.addPass(createSimpleCanonicalizerPass());
+  if (options.balanceMuxChains)
+    modulePM.addPass(sv::createCombBalanceMuxPass());
+  if (options.emitVerilog)
+    modulePM.addPass(sv::createPrettifyVerilogPass());
+}
+
+//===----------------------------------------------------------------------===//
+// Sharded HW cleanup
+//===----------------------------------------------------------------------===//
+
+/// Print `op` on its own, with its locations.
+static void printWithLocations(Operation *op, raw_ostream &os) {
+  op->print(os, OpPrintingFlags().enableDebugInfo().useLocalScope());
+  os << '\n';
+}
+
+LogicalResult firtool::runShardedHWCleanup(ModuleOp module,
+                                           const FirtoolOptions &options,
+                                           unsigned numShards) {
+  if (!options.lowersToHW() || options.disableOptimization)
+    return success();
+  auto *context = module.getContext();
+
+  // Every shard holds all the declarations, such as the external modules, and
+  // an external module in place of each module of another shard that it
+  // instantiates. The binds refer to the inside of modules and stay out.
+  SmallVector<hw::HWModuleOp> modules;
+  std::string declarations;
+  llvm::raw_string_ostream declarationsStream(declarations);
+  for (auto &op : *module.getBody()) {
+    if (auto mod = dyn_cast<hw::HWModuleOp>(op))
+      modules.push_back(mod);
+    else if (!isa<sv::BindOp, sv::BindInterfaceOp>(op))
+      printWithLocations(&op, declarationsStream);
+  }
+  declarationsStream.flush();
+  numShards = std::min<size_t>(numShards, modules.size());
+  if (numShards < 2) {
+    PassManager pm(context);
+    populateHWCleanupPasses(pm, options);
+    return pm.run(module);
+  }
+
+  auto scratch = ModuleOp::create(module.getLoc());
+  auto builder = OpBuilder::atBlockBegin(scratch.getBody());
+  llvm::StringMap<size_t> moduleIndices;
+  for (size_t i = 0, e = modules.size(); i != e; ++i) {
+    auto mod = modules[i];
+    moduleIndices[mod.getName()] = i;
+    builder.create<hw::HWModuleExternOp>(
+        mod.getLoc(), builder.getStringAttr(mod.getName()), mod.getPorts());
+  }
+  SmallVector<Operation *> stubOps;
+  for (auto &op : *scratch.getBody())
+    stubOps.push_back(&op);
+
+  // Assign the heaviest remaining module to the least loaded shard.
+  SmallVector<size_t> weights(modules.size(), 0);
+  mlir::parallelForEachN(context, 0, modules.size(), [&](size_t i) {
+    modules[i].walk([&](Operation *) { ++weights[i]; });
+  });
+  SmallVector<size_t> order(modules.size());
+  std::iota(order.begin(), order.end(), 0);
+  llvm::stable_sort(
+      order, [&](size_t a, size_t b) { return weights[a] > weights[b]; });
+  SmallVector<size_t> loads(numShards, 0);
+  SmallVector<unsigned> moduleShards(modules.size());
+  for (auto i : order) {
+    auto shard = std::min_element(loads.begin(), loads.end()) - loads.begin();
+    moduleShards[i] = shard;
+    loads[shard] += weights[i];
+  }
+
+  // Run the cleanup of each shard in a context of its own, which uniques the
+  // attributes and types of the shard without contending with the others,
+  // and import the result back.
+  std::vector<OwningModuleRef> results(numShards);
+  std::atomic<bool> anyFailed(false);
+  std::string moduleHeader;
+  llvm::raw_string_ostream moduleHeaderStream(moduleHeader);
+  moduleHeaderStream << "module";
+  if (!module->getAttrs().empty())
+    moduleHeaderStream << " attributes " << module->getAttrDictionary();
+  moduleHeaderStream << " {\n";
+  moduleHeaderStream.flush();
+  mlir::parallelForEachN(context, 0, numShards, [&](size_t shard) {
+    std::string text = moduleHeader + declarations;
+    llvm::raw_string_ostream os(text);
+    llvm::SmallDenseSet<size_t, 8> stubbed;
+    for (size_t i = 0, e = modules.size(); i != e; ++i) {
+      if (moduleShards[i] != shard)
+        continue;
+      printWithLocations(modules[i], os);
+      modules[i].walk([&](hw::InstanceOp inst) {
+        auto it = moduleIndices.find(inst.moduleName());
+        if (it != moduleIndices.end() && moduleShards[it->second] != shard &&
+            stubbed.insert(it->second).second)
+          printWithLocations(stubOps[it->second], os);
+      });
+    }
+    os << "}\n";
+
+    MLIRContext shardContext;
+    shardContext.disableMultithreading();
+    shardContext.loadDialect<firrtl::FIRRTLDialect, hw::HWDialect,
+                             comb::CombDialect, sv::SVDialect>();
+    auto shardModule = parseSourceString(os.str(), &shardContext);
+    PassManager pm(&shardContext);
+    populateHWCleanupPasses(pm, options);
+    if (!shardModule || failed(pm.run(*shardModule))) {
+      anyFailed = true;
+      return;
+    }
+
+    std::string result;
+    llvm::raw_string_ostream resultStream(result);
+    shardModule->print(resultStream, OpPrintingFlags().enableDebugInfo());
+    results[shard] = parseSourceString(resultStream.str(), context);
+    if (!results[shard])
+      anyFailed = true;
+  });
+  scratch.erase();
+  if (anyFailed)
+    return failure();
+
+  // Replace the modules by their cleaned up version.
+  for (auto &result : results) {
+    for (auto mod : llvm::make_early_inc_range(
+             result->getBody()->getOps<hw::HWModuleOp>())) {
+      auto original = modules[moduleIndices.lookup(mod.getName())];
+      mod->moveBefore(original);
+      original.erase();
+    }
+  }
+  return success();
+}
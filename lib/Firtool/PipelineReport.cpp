@@ -0,0 +1,154 @@
+//===- PipelineReport.cpp - Measure the passes of a pipeline --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Firtool/PipelineReport.h"
+#include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "mlir/Pass/Pass.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/Process.h"
+
+#if LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
+
+using namespace mlir;
+using namespace circt;
+using namespace firtool;
+
+/// Return the peak resident set size of the process in bytes, or 0 if the host
+/// doesn't report it.
+static int64_t getPeakRSS() {
+#if LLVM_ON_UNIX
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024;
+#endif
+#else
+  return 0;
+#endif
+}
+
+/// Return the number of operations in `op`, itself included.
+static size_t countOps(Operation *op) {
+  size_t numOps = 0;
+  op->walk([&](Operation *) { ++numOps; });
+  return numOps;
+}
+
+bool PipelineReportInstrumentation::isMeasuredIndividually(Operation *op) {
+  return !op->getParentOp() || isa<firrtl::CircuitOp>(op);
+}
+
+std::chrono::nanoseconds PipelineReportInstrumentation::getCPUTime() {
+  llvm::sys::TimePoint<> elapsed;
+  std::chrono::nanoseconds user, system;
+  llvm::sys::Process::GetTimeUsage(elapsed, user, system);
+  return user + system;
+}
+
+StringRef PipelineReportInstrumentation::getPassName(Pass *pass) {
+  // Only the adaptors running nested pipelines have no argument.
+  return pass->getArgument().empty() ? "pipeline" : pass->getArgument();
+}
+
+void PipelineReportInstrumentation::runBeforePass(Pass *pass, Operation *op) {
+  auto numOps = countOps(op);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!isMeasuredIndividually(op)) {
+    if (running.empty())
+      return;
+    auto &record = records[running.back().first];
+    auto &nested = record.nested[{getPassName(pass), op->getName()}];
+    nested.opsBefore += numOps;
+    nestedStarts[{pass, op}] = Clock::now();
+    return;
+  }
+
+  PassRecord record;
+  record.pass = getPassName(pass).str();
+  record.op = op->getName().getStringRef().str();
+  record.depth = running.size();
+  record.opsBefore = numOps;
+  records.push_back(std::move(record));
+  running.push_back(
+      {records.size() - 1, Start{Clock::now(), getCPUTime(), getPeakRSS()}});
+}
+
+void PipelineReportInstrumentation::finishPass(Pass *pass, Operation *op,
+                                               bool failed) {
+  auto now = Clock::now();
+  auto numOps = countOps(op);
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!isMeasuredIndividually(op)) {
+    auto start = nestedStarts.find({pass, op});
+    if (start == nestedStarts.end())
+      return;
+    auto &record = records[running.back().first];
+    auto &nested = record.nested[{getPassName(pass), op->getName()}];
+    ++nested.runs;
+    nested.timeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                         now - start->second)
+                         .count();
+    nested.opsAfter += numOps;
+    nestedStarts.erase(start);
+    return;
+  }
+
+  auto &start = running.back().second;
+  auto &record = records[running.back().first];
+  record.failed = failed;
+  record.wallTimeUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(now -
+                                                            start.wallTime)
+          .count();
+  record.cpuTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                         getCPUTime() - start.cpuTime)
+                         .count();
+  record.peakRSSDelta = getPeakRSS() - start.peakRSS;
+  record.opsAfter = numOps;
+  running.pop_back();
+}
+
+void PipelineReportInstrumentation::writeJSON(raw_ostream &os) {
+  llvm::json::OStream json(os, /*IndentSize=*/2);
+  json.array([&] {
+    for (auto &record : records)
+      json.object([&] {
+        json.attribute("pass", record.pass);
+        json.attribute("op", record.op);
+        json.attribute("depth", int64_t(record.depth));
+        if (record.failed)
+          json.attribute("failed", true);
+        json.attribute("wallTimeUs", record.wallTimeUs);
+        json.attribute("cpuTimeUs", record.cpuTimeUs);
+        json.attribute("peakRSSDeltaBytes", record.peakRSSDelta);
+        json.attribute("opsBefore", int64_t(record.opsBefore));
+        json.attribute("opsAfter", int64_t(record.opsAfter));
+        if (record.nested.empty())
+          return;
+        json.attributeArray("nested", [&] {
+          for (auto &it : record.nested)
+            json.object([&] {
+              auto &nested = it.second;
+              json.attribute("pass", it.first.first);
+              json.attribute("op", it.first.second.getStringRef());
+              json.attribute("runs", int64_t(nested.runs));
+              json.attribute("timeUs", nested.timeUs);
+              json.attribute("opsBefore", int64_t(nested.opsBefore));
+              json.attribute("opsAfter", int64_t(nested.opsAfter));
+            });
+        });
+      });
+  });
+  os << "\n";
+}
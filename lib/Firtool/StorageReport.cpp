@@ -0,0 +1,345 @@
+//===- StorageReport.cpp - Measure the attributes and types ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Firtool/StorageReport.h"
+#include "circt/Dialect/FIRRTL/FIRRTLTypes.h"
+#include "circt/Dialect/HW/HWTypes.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Operation.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/JSON.h"
+
+using namespace mlir;
+using namespace circt;
+using namespace firtool;
+
+/// The estimated size of the storage of any attribute or type, and of its
+/// entry in the uniquer of the MLIRContext.
+static constexpr size_t storageOverhead = 32;
+
+/// The longest text printed for one of the largest attributes or types.
+static constexpr size_t maxPrintedLength = 200;
+
+void StorageReport::collect(Operation *op) {
+  op->walk([&](Operation *nestedOp) {
+    addAttribute(nestedOp->getLoc());
+    addAttribute(nestedOp->getAttrDictionary());
+    for (auto type : nestedOp->getResultTypes())
+      addType(type);
+    for (auto &region : nestedOp->getRegions())
+      for (auto &block : region)
+        for (auto arg : block.getArguments()) {
+          addType(arg.getType());
+          addAttribute(arg.getLoc());
+        }
+    drain();
+  });
+}
+
+void StorageReport::addAttribute(Attribute attr) {
+  if (!attr || attributes.count(attr))
+    return;
+  auto bytes = estimateBytes(attr);
+  attributes.insert({attr, bytes});
+  auto &kind = getKind(attr);
+  ++kind.count;
+  kind.bytes += bytes;
+  attributeWorklist.push_back(attr);
+}
+
+void StorageReport::addType(Type type) {
+  if (!type || types.count(type))
+    return;
+  auto bytes = estimateBytes(type);
+  types.insert({type, bytes});
+  auto &kind = getKind(type);
+  ++kind.count;
+  kind.bytes += bytes;
+  typeWorklist.push_back(type);
+}
+
+/// Add the attributes and types held by the ones added so far, until there
+/// are no new ones.
+void StorageReport::drain() {
+  while (!attributeWorklist.empty() || !typeWorklist.empty()) {
+    while (!attributeWorklist.empty()) {
+      auto attr = attributeWorklist.pop_back_val();
+      addType(attr.getType());
+      if (auto arrayAttr = attr.dyn_cast<ArrayAttr>()) {
+        for (auto element : arrayAttr)
+          addAttribute(element);
+      } else if (auto dictAttr = attr.dyn_cast<DictionaryAttr>()) {
+        for (auto namedAttr : dictAttr)
+          addAttribute(namedAttr.second);
+      } else if (auto typeAttr = attr.dyn_cast<TypeAttr>()) {
+        addType(typeAttr.getValue());
+      } else if (auto symbolAttr = attr.dyn_cast<SymbolRefAttr>()) {
+        for (auto nested : symbolAttr.getNestedReferences())
+          addAttribute(nested);
+      } else if (auto nameLoc = attr.dyn_cast<NameLoc>()) {
+        addAttribute(nameLoc.getChildLoc());
+      } else if (auto callSiteLoc = attr.dyn_cast<CallSiteLoc>()) {
+        addAttribute(callSiteLoc.getCallee());
+        addAttribute(callSiteLoc.getCaller());
+      } else if (auto fusedLoc = attr.dyn_cast<FusedLoc>()) {
+        for (auto loc : fusedLoc.getLocations())
+          addAttribute(loc);
+        addAttribute(fusedLoc.getMetadata());
+      } else if (auto opaqueLoc = attr.dyn_cast<OpaqueLoc>()) {
+        addAttribute(opaqueLoc.getFallbackLocation());
+      }
+    }
+
+    while (!typeWorklist.empty()) {
+      auto type = typeWorklist.pop_back_val();
+      if (auto functionType = type.dyn_cast<FunctionType>()) {
+        for (auto input : functionType.getInputs())
+          addType(input);
+        for (auto result : functionType.getResults())
+          addType(result);
+      } else if (auto tupleType = type.dyn_cast<TupleType>()) {
+        for (auto element : tupleType.getTypes())
+          addType(element);
+      } else if (auto shapedType = type.dyn_cast<ShapedType>()) {
+        addType(shapedType.getElementType());
+      } else if (auto bundleType = type.dyn_cast<firrtl::BundleType>()) {
+        for (auto &element : bundleType.getElements()) {
+          addAttribute(element.name);
+          addType(element.type);
+        }
+      } else if (auto vectorType = type.dyn_cast<firrtl::FVectorType>()) {
+        addType(vectorType.getElementType());
+      } else if (auto arrayType = type.dyn_cast<hw::ArrayType>()) {
+        addType(arrayType.getElementType());
+      } else if (auto arrayType = type.dyn_cast<hw::UnpackedArrayType>()) {
+        addType(arrayType.getElementType());
+      } else if (auto inoutType = type.dyn_cast<hw::InOutType>()) {
+        addType(inoutType.getElementType());
+      } else if (auto structType = type.dyn_cast<hw::StructType>()) {
+        for (auto &field : structType.getElements())
+          addType(field.type);
+      } else if (auto unionType = type.dyn_cast<hw::UnionType>()) {
+        for (auto &field : unionType.getElements())
+          addType(field.type);
+      } else if (auto aliasType = type.dyn_cast<hw::TypeAliasType>()) {
+        addAttribute(aliasType.getRef());
+        addType(aliasType.getInnerType());
+        addType(aliasType.getCanonicalType());
+      }
+    }
+  }
+}
+
+/// Return the name of the kind of a builtin attribute, or an empty string for
+/// the ones of other dialects.
+static StringRef getBuiltinKindName(Attribute attr) {
+  return TypeSwitch<Attribute, StringRef>(attr)
+      .Case<StringAttr>([](auto) { return "string"; })
+      .Case<IntegerAttr>([](auto) { return "integer"; })
+      .Case<FloatAttr>([](auto) { return "float"; })
+      .Case<ArrayAttr>([](auto) { return "array"; })
+      .Case<DictionaryAttr>([](auto) { return "dictionary"; })
+      .Case<TypeAttr>([](auto) { return "type"; })
+      .Case<SymbolRefAttr>([](auto) { return "symbol_ref"; })
+      .Case<UnitAttr>([](auto) { return "unit"; })
+      .Case<ElementsAttr>([](auto) { return "elements"; })
+      .Case<FileLineColLoc>([](auto) { return "loc.file_line_col"; })
+      .Case<NameLoc>([](auto) { return "loc.name"; })
+      .Case<CallSiteLoc>([](auto) { return "loc.callsite"; })
+      .Case<FusedLoc>([](auto) { return "loc.fused"; })
+      .Case<OpaqueLoc>([](auto) { return "loc.opaque"; })
+      .Case<UnknownLoc>([](auto) { return "loc.unknown"; })
+      .Default([](auto) { return ""; });
+}
+
+static StringRef getBuiltinKindName(Type type) {
+  return TypeSwitch<Type, StringRef>(type)
+      .Case<IntegerType>([](auto) { return "integer"; })
+      .Case<IndexType>([](auto) { return "index"; })
+      .Case<FloatType>([](auto) { return "float"; })
+      .Case<FunctionType>([](auto) { return "function"; })
+      .Case<TupleType>([](auto) { return "tuple"; })
+      .Case<ShapedType>([](auto) { return "shaped"; })
+      .Case<NoneType>([](auto) { return "none"; })
+      .Default([](auto) { return ""; });
+}
+
+/// Return the mnemonic of an attribute or type of a dialect, from its text,
+/// e.g. "uint" for "!firrtl.uint<8>".
+static std::string getPrintedKindName(StringRef text) {
+  text = text.ltrim("#!");
+  auto dot = text.find('.');
+  if (dot != StringRef::npos)
+    text = text.drop_front(dot + 1);
+  text = text.take_while([](char c) { return llvm::isAlnum(c) || c == '_'; });
+  return text.empty() ? "unknown" : text.str();
+}
+
+/// Print `value`, shortened to maxPrintedLength characters.
+template <typename T>
+static std::string printShortened(T value) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  value.print(os);
+  os.flush();
+  if (text.size() > maxPrintedLength) {
+    text.resize(maxPrintedLength);
+    text += "...";
+  }
+  return text;
+}
+
+StorageReport::KindRecord &StorageReport::getKind(Attribute attr) {
+  auto dialect = attr.getDialect().getNamespace();
+  auto &name = kindNames[attr.getTypeID()];
+  if (name.empty()) {
+    name = getBuiltinKindName(attr).str();
+    if (name.empty())
+      name = getPrintedKindName(printShortened(attr));
+  }
+  auto &kind = kinds[("#" + dialect + "." + name).str()];
+  if (kind.kind.empty()) {
+    kind.dialect = dialect.str();
+    kind.kind = name;
+  }
+  return kind;
+}
+
+StorageReport::KindRecord &StorageReport::getKind(Type type) {
+  auto dialect = type.getDialect().getNamespace();
+  auto &name = kindNames[type.getTypeID()];
+  if (name.empty()) {
+    name = getBuiltinKindName(type).str();
+    if (name.empty())
+      name = getPrintedKindName(printShortened(type));
+  }
+  auto &kind = kinds[("!" + dialect + "." + name).str()];
+  if (kind.kind.empty()) {
+    kind.dialect = dialect.str();
+    kind.kind = name;
+    kind.isType = true;
+  }
+  return kind;
+}
+
+size_t StorageReport::estimateBytes(Attribute attr) {
+  auto payload =
+      TypeSwitch<Attribute, size_t>(attr)
+          .Case<StringAttr>(
+              [](auto attr) { return attr.getValue().size() + 1; })
+          .Case<IntegerAttr>([](auto attr) {
+            auto value = attr.getValue();
+            auto words = value.getNumWords();
+            return sizeof(APInt) + (words > 1 ? words * sizeof(uint64_t) : 0);
+          })
+          .Case<ArrayAttr>(
+              [](auto attr) { return attr.size() * sizeof(Attribute); })
+          .Case<DictionaryAttr>(
+              [](auto attr) { return attr.size() * sizeof(NamedAttribute); })
+          .Case<SymbolRefAttr>([](auto attr) {
+            return (attr.getNestedReferences().size() + 1) * sizeof(Attribute);
+          })
+          .Case<DenseElementsAttr>(
+              [](auto attr) { return attr.getRawData().size(); })
+          .Case<FusedLoc>([](auto attr) {
+            return (attr.getLocations().size() + 1) * sizeof(Attribute);
+          })
+          .Default([](auto) { return 2 * sizeof(void *); });
+  return storageOverhead + payload;
+}
+
+size_t StorageReport::estimateBytes(Type type) {
+  auto payload =
+      TypeSwitch<Type, size_t>(type)
+          .Case<FunctionType>([](auto type) {
+            return (type.getNumInputs() + type.getNumResults()) * sizeof(Type);
+          })
+          .Case<TupleType>([](auto type) { return type.size() * sizeof(Type); })
+          .Case<firrtl::BundleType>([](auto type) {
+            // Bundles also cache their passive type and properties.
+            return type.getNumElements() *
+                       sizeof(firrtl::BundleType::BundleElement) +
+                   2 * sizeof(void *);
+          })
+          .Case<hw::StructType, hw::UnionType>([](auto type) {
+            size_t bytes = 0;
+            for (auto &field : type.getElements())
+              bytes += sizeof(field) + field.name.size();
+            return bytes;
+          })
+          .Default([](auto) { return 2 * sizeof(void *); });
+  return storageOverhead + payload;
+}
+
+/// Return the `numLargest` entries of `sizes` with the most bytes, largest
+/// first.
+template <typename T>
+static std::vector<std::pair<T, size_t>>
+getLargest(const llvm::MapVector<T, size_t> &sizes, unsigned numLargest) {
+  std::vector<std::pair<T, size_t>> largest(sizes.begin(), sizes.end());
+  auto middle = largest.begin() + std::min<size_t>(numLargest, largest.size());
+  std::partial_sort(largest.begin(), middle, largest.end(),
+                    [](const auto &lhs, const auto &rhs) {
+                      return lhs.second > rhs.second;
+                    });
+  largest.erase(middle, largest.end());
+  return largest;
+}
+
+void StorageReport::writeJSON(llvm::json::OStream &json,
+                              unsigned numLargest) const {
+  auto sumBytes = [](const auto &sizes) {
+    size_t bytes = 0;
+    for (auto &entry : sizes)
+      bytes += entry.second;
+    return int64_t(bytes);
+  };
+
+  std::vector<const KindRecord *> sortedKinds;
+  for (auto &entry : kinds)
+    sortedKinds.push_back(&entry.second);
+  llvm::sort(sortedKinds, [](const KindRecord *lhs, const KindRecord *rhs) {
+    if (lhs->bytes != rhs->bytes)
+      return lhs->bytes > rhs->bytes;
+    return std::tie(lhs->dialect, lhs->kind, lhs->isType) <
+           std::tie(rhs->dialect, rhs->kind, rhs->isType);
+  });
+
+  json.attribute("attributes", int64_t(attributes.size()));
+  json.attribute("attributeBytes", sumBytes(attributes));
+  json.attribute("types", int64_t(types.size()));
+  json.attribute("typeBytes", sumBytes(types));
+  json.attributeArray("kinds", [&] {
+    for (auto *kind : sortedKinds)
+      json.object([&] {
+        json.attribute("dialect", kind->dialect);
+        json.attribute("kind", kind->kind);
+        json.attribute("category", kind->isType ? "type" : "attribute");
+        json.attribute("count", int64_t(kind->count));
+        json.attribute("bytes", int64_t(kind->bytes));
+      });
+  });
+  json.attributeArray("largestAttributes", [&] {
+    for (auto &entry : getLargest(attributes, numLargest))
+      json.object([&] {
+        json.attribute("bytes", int64_t(entry.second));
+        json.attribute("value", printShortened(entry.first));
+      });
+  });
+  json.attributeArray("largestTypes", [&] {
+    for (auto &entry : getLargest(types, numLargest))
+      json.object([&] {
+        json.attribute("bytes", int64_t(entry.second));
+        json.attribute("value", printShortened(entry.first));
+      });
+  });
+}
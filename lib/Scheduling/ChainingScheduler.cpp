@@ -0,0 +1,103 @@
+//===- ChainingScheduler.cpp - Delay-aware list scheduler -----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of an as-soon-as-possible list scheduler for acyclic chaining
+// problems, which packs combinational operators into time steps according to
+// their physical delays.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Scheduling/Algorithms.h"
+
+#include "mlir/IR/Operation.h"
+
+using namespace circt;
+using namespace circt::scheduling;
+
+LogicalResult scheduling::scheduleChaining(ChainingProblem &prob) {
+  auto cycleTime = prob.getCycleTime();
+  auto allOps = prob.getOperations();
+  // Keep track of ops that don't have a start time yet
+  llvm::SmallVector<Operation *> unscheduledOps;
+  unscheduledOps.insert(unscheduledOps.begin(), allOps.begin(), allOps.end());
+
+  // As in the ASAP scheduler, we may need multiple attempts if the problem's
+  // operation list is not in a topological order w.r.t. the dependence graph.
+  while (!unscheduledOps.empty()) {
+    unsigned numUnscheduledBefore = unscheduledOps.size();
+
+    llvm::SmallVector<Operation *> worklist;
+    worklist.insert(worklist.begin(), unscheduledOps.rbegin(),
+                    unscheduledOps.rend());
+    unscheduledOps.clear();
+
+    while (!worklist.empty()) {
+      Operation *op = worklist.pop_back_val();
+
+      // Compute the earliest time step in which all predecessors' results are
+      // available, and the point in it at which the ones that become available
+      // in this time step are valid.
+      unsigned startTime = 0;
+      float startTimeInCycle = 0;
+      bool startTimeIsValid = true;
+      for (auto &dep : prob.getDependences(op)) {
+        Operation *pred = dep.getSource();
+        auto predStart = prob.getStartTime(pred);
+        if (!predStart) {
+          // pred is not yet scheduled, give up and try again later
+          startTimeIsValid = false;
+          break;
+        }
+
+        auto predOpr = *prob.getLinkedOperatorType(pred);
+        unsigned predLatency = *prob.getLatency(predOpr);
+        unsigned predEnd = *predStart + predLatency;
+
+        // Auxiliary dependences only order the operations, they don't
+        // transport values.
+        float predValid = 0;
+        if (dep.isDefUse()) {
+          predValid = *prob.getOutgoingDelay(predOpr);
+          if (predLatency == 0)
+            predValid += *prob.getStartTimeInCycle(pred);
+        }
+
+        if (predEnd > startTime) {
+          startTime = predEnd;
+          startTimeInCycle = predValid;
+        } else if (predEnd == startTime) {
+          startTimeInCycle = std::max(startTimeInCycle, predValid);
+        }
+      }
+
+      if (!startTimeIsValid) {
+        unscheduledOps.push_back(op);
+        continue;
+      }
+
+      // Break the chain if the operation would not fit into the time step. Its
+      // operands are then registered, and valid at the beginning of the next
+      // one.
+      float incomingDelay =
+          *prob.getIncomingDelay(*prob.getLinkedOperatorType(op));
+      if (cycleTime && startTimeInCycle + incomingDelay > *cycleTime) {
+        ++startTime;
+        startTimeInCycle = 0;
+      }
+
+      prob.setStartTime(op, startTime);
+      prob.setStartTimeInCycle(op, startTimeInCycle);
+    }
+
+    // Fail if no progress was made during this attempt
+    if (numUnscheduledBefore == unscheduledOps.size())
+      return prob.getContainingOp()->emitError() << "dependence cycle detected";
+  }
+
+  return success();
+}
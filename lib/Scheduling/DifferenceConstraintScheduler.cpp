@@ -0,0 +1,361 @@
+//===- DifferenceConstraintScheduler.cpp - Sparse longest path scheduler --===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of a scheduler for resource-free problems that exploits their
+// structure as systems of difference constraints.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Scheduling/Algorithms.h"
+
+#include "mlir/IR/Operation.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "difference-constraint-scheduler"
+
+using namespace circt;
+using namespace circt::scheduling;
+
+using llvm::dbgs;
+
+namespace {
+
+/// This class solves resource-free scheduling problems with a label-correcting
+/// longest path algorithm on their constraint graph.
+///
+/// Every precedence constraint of such a problem has the form
+///   startTime[dst] >= startTime[src] + latency[src] - II * distance
+/// i.e. it is a difference constraint. The system is feasible iff the graph
+/// with one node per operation and one edge of weight
+/// `latency[src] - II * distance` per dependence has no positive cycle, in
+/// which case the longest paths from a virtual source connected to every node
+/// with weight 0 are the component-wise smallest solution. This minimizes the
+/// start time of every operation, and in particular of the last operation, so
+/// the solution is optimal for the objective of the simplex schedulers.
+///
+/// The graph is stored in compressed sparse row form, so memory is linear in
+/// the number of operations and dependences, and each round of the algorithm
+/// only visits the edges leaving nodes whose start time changed.
+class DifferenceConstraintScheduler {
+public:
+  explicit DifferenceConstraintScheduler(Problem &prob) : prob(prob) {}
+
+  /// Build the constraint graph. Distances are taken from \p cyclicProb if it
+  /// is non-null, otherwise they are zero.
+  void buildGraph(CyclicProblem *cyclicProb);
+
+  /// Compute the longest paths for the given initiation interval. Return
+  /// failure if the graph has a positive cycle.
+  LogicalResult computeStartTimes(int64_t initiationInterval);
+
+  /// Recompute the longest paths for the given initiation interval, starting
+  /// from the start times stored in the problem, which must be the solution
+  /// before the constraints of \p changedOps were modified. Only the changed
+  /// operations and their transitive successors are recomputed. Return failure
+  /// if the graph has a positive cycle.
+  LogicalResult recomputeStartTimes(int64_t initiationInterval,
+                                    ArrayRef<Operation *> changedOps);
+
+  /// Return an initiation interval that is feasible if any is.
+  int64_t getMaxInitiationInterval() const;
+
+  void storeStartTimes();
+
+private:
+  LogicalResult propagate(int64_t initiationInterval,
+                          ArrayRef<unsigned> initialNodes);
+
+  Problem &prob;
+  DenseMap<Operation *, unsigned> opIds;
+
+  /// The edges leaving node `i` are `edgeBegin[i]`, ..., `edgeBegin[i+1]-1`.
+  SmallVector<unsigned> edgeBegin;
+  SmallVector<unsigned> edgeDst;
+  SmallVector<int64_t> edgeLatency;
+  SmallVector<int64_t> edgeDistance;
+
+  SmallVector<int64_t> startTimes;
+};
+
+} // anonymous namespace
+
+void DifferenceConstraintScheduler::buildGraph(CyclicProblem *cyclicProb) {
+  auto &ops = prob.getOperations();
+  unsigned nOps = ops.size();
+  for (unsigned i = 0; i < nOps; ++i)
+    opIds[ops[i]] = i;
+
+  // Collect the edges, which the problem provides per destination, and bucket
+  // them by source.
+  struct Edge {
+    unsigned src, dst;
+    int64_t latency, distance;
+  };
+  SmallVector<Edge> edges;
+  edgeBegin.assign(nOps + 1, 0);
+  for (unsigned dst = 0; dst < nOps; ++dst) {
+    for (auto &dep : prob.getDependences(ops[dst])) {
+      Operation *src = dep.getSource();
+      int64_t latency = *prob.getLatency(*prob.getLinkedOperatorType(src));
+      int64_t distance = 0;
+      if (cyclicProb)
+        distance = cyclicProb->getDistance(dep).getValueOr(0);
+      edges.push_back({opIds[src], dst, latency, distance});
+      ++edgeBegin[opIds[src] + 1];
+    }
+  }
+  for (unsigned i = 0; i < nOps; ++i)
+    edgeBegin[i + 1] += edgeBegin[i];
+
+  SmallVector<unsigned> nextEdge(edgeBegin.begin(), edgeBegin.end() - 1);
+  edgeDst.resize(edges.size());
+  edgeLatency.resize(edges.size());
+  edgeDistance.resize(edges.size());
+  for (auto &edge : edges) {
+    unsigned index = nextEdge[edge.src]++;
+    edgeDst[index] = edge.dst;
+    edgeLatency[index] = edge.latency;
+    edgeDistance[index] = edge.distance;
+  }
+}
+
+LogicalResult
+DifferenceConstraintScheduler::computeStartTimes(int64_t initiationInterval) {
+  unsigned nOps = prob.getOperations().size();
+  startTimes.assign(nOps, 0);
+  SmallVector<unsigned> allNodes(nOps);
+  for (unsigned i = 0; i < nOps; ++i)
+    allNodes[i] = i;
+  return propagate(initiationInterval, allNodes);
+}
+
+LogicalResult DifferenceConstraintScheduler::recomputeStartTimes(
+    int64_t initiationInterval, ArrayRef<Operation *> changedOps) {
+  auto &ops = prob.getOperations();
+  unsigned nOps = ops.size();
+
+  // Operations without a start time are new, and thus changed.
+  llvm::BitVector isAffected(nOps);
+  SmallVector<unsigned> worklist;
+  for (auto *op : changedOps) {
+    auto it = opIds.find(op);
+    if (it != opIds.end() && !isAffected.test(it->second)) {
+      isAffected.set(it->second);
+      worklist.push_back(it->second);
+    }
+  }
+  startTimes.resize(nOps);
+  for (unsigned i = 0; i < nOps; ++i) {
+    if (auto startTime = prob.getStartTime(ops[i])) {
+      startTimes[i] = *startTime;
+    } else if (!isAffected.test(i)) {
+      isAffected.set(i);
+      worklist.push_back(i);
+    }
+  }
+
+  // The start times of the other operations only depend on unchanged
+  // constraints, so they are still the smallest solution.
+  while (!worklist.empty()) {
+    unsigned src = worklist.pop_back_val();
+    for (unsigned e = edgeBegin[src], end = edgeBegin[src + 1]; e != end; ++e) {
+      if (!isAffected.test(edgeDst[e])) {
+        isAffected.set(edgeDst[e]);
+        worklist.push_back(edgeDst[e]);
+      }
+    }
+  }
+
+  // Restart the affected operations from zero, and propagate the start times
+  // of their unaffected predecessors into them.
+  llvm::BitVector isInitial(isAffected);
+  for (unsigned src = 0; src < nOps; ++src) {
+    if (isAffected.test(src)) {
+      startTimes[src] = 0;
+      continue;
+    }
+    for (unsigned e = edgeBegin[src], end = edgeBegin[src + 1]; e != end; ++e)
+      if (isAffected.test(edgeDst[e]))
+        isInitial.set(src);
+  }
+  SmallVector<unsigned> initialNodes(isInitial.set_bits_begin(),
+                                     isInitial.set_bits_end());
+
+  LLVM_DEBUG(dbgs() << "Rescheduling " << isAffected.count() << " of " << nOps
+                    << " operations\n");
+  return propagate(initiationInterval, initialNodes);
+}
+
+LogicalResult
+DifferenceConstraintScheduler::propagate(int64_t initiationInterval,
+                                         ArrayRef<unsigned> initialNodes) {
+  unsigned nOps = prob.getOperations().size();
+  if (nOps == 0)
+    return success();
+
+  // The number of edges on the path along which each start time was last
+  // increased. A path with `nOps` edges visits some node twice, with a larger
+  // start time the second time, and thus contains a positive cycle.
+  SmallVector<unsigned> pathLengths(nOps, 0);
+
+  // Every node is queued at most once at a time, so the queue is a ring buffer
+  // of `nOps` entries. When solving from scratch, it initially holds all nodes
+  // in the order of the problem, which usually is a topological order.
+  SmallVector<unsigned> queue(nOps);
+  llvm::BitVector isQueued(nOps);
+  for (unsigned i = 0, e = initialNodes.size(); i < e; ++i) {
+    queue[i] = initialNodes[i];
+    isQueued.set(initialNodes[i]);
+  }
+  unsigned head = 0, numQueued = initialNodes.size();
+
+  while (numQueued != 0) {
+    unsigned src = queue[head];
+    head = (head + 1) % nOps;
+    --numQueued;
+    isQueued.reset(src);
+
+    for (unsigned e = edgeBegin[src], end = edgeBegin[src + 1]; e != end; ++e) {
+      unsigned dst = edgeDst[e];
+      int64_t startTime = startTimes[src] + edgeLatency[e] -
+                          initiationInterval * edgeDistance[e];
+      if (startTime <= startTimes[dst])
+        continue;
+      startTimes[dst] = startTime;
+      pathLengths[dst] = pathLengths[src] + 1;
+      if (pathLengths[dst] >= nOps)
+        return failure();
+      if (!isQueued.test(dst)) {
+        queue[(head + numQueued) % nOps] = dst;
+        ++numQueued;
+        isQueued.set(dst);
+      }
+    }
+  }
+
+  return success();
+}
+
+int64_t DifferenceConstraintScheduler::getMaxInitiationInterval() const {
+  // Every cycle with a non-zero distance has a non-positive weight once the
+  // II is at least the sum of all latencies.
+  int64_t sum = 1;
+  for (auto latency : edgeLatency)
+    sum += latency;
+  return sum;
+}
+
+void DifferenceConstraintScheduler::storeStartTimes() {
+  auto &ops = prob.getOperations();
+  for (unsigned i = 0, e = ops.size(); i < e; ++i)
+    prob.setStartTime(ops[i], startTimes[i]);
+}
+
+//===----------------------------------------------------------------------===//
+// Public API
+//===----------------------------------------------------------------------===//
+
+LogicalResult scheduling::scheduleDifferenceConstraints(Problem &prob) {
+  DifferenceConstraintScheduler scheduler(prob);
+  scheduler.buildGraph(/*cyclicProb=*/nullptr);
+  if (failed(scheduler.computeStartTimes(/*initiationInterval=*/0)))
+    return prob.getContainingOp()->emitError() << "problem is infeasible";
+
+  scheduler.storeStartTimes();
+  return success();
+}
+
+LogicalResult
+scheduling::rescheduleDifferenceConstraints(Problem &prob,
+                                            ArrayRef<Operation *> changedOps) {
+  DifferenceConstraintScheduler scheduler(prob);
+  scheduler.buildGraph(/*cyclicProb=*/nullptr);
+  if (failed(scheduler.recomputeStartTimes(/*initiationInterval=*/0,
+                                           changedOps)))
+    return prob.getContainingOp()->emitError() << "problem is infeasible";
+
+  scheduler.storeStartTimes();
+  return success();
+}
+
+LogicalResult scheduling::scheduleDifferenceConstraints(CyclicProblem &prob) {
+  DifferenceConstraintScheduler scheduler(prob);
+  scheduler.buildGraph(&prob);
+
+  // Feasibility is monotone in the II, so binary search for the smallest
+  // feasible one.
+  int64_t maxII = scheduler.getMaxInitiationInterval();
+  if (failed(scheduler.computeStartTimes(maxII)))
+    return prob.getContainingOp()->emitError() << "problem is infeasible";
+  int64_t minII = 1;
+  while (minII < maxII) {
+    int64_t ii = minII + (maxII - minII) / 2;
+    if (succeeded(scheduler.computeStartTimes(ii)))
+      maxII = ii;
+    else
+      minII = ii + 1;
+  }
+
+  LLVM_DEBUG(dbgs() << "Smallest feasible II = " << maxII << '\n');
+
+  bool feasible = succeeded(scheduler.computeStartTimes(maxII));
+  assert(feasible && "smallest feasible II must be feasible");
+  (void)feasible;
+  prob.setInitiationInterval(maxII);
+  scheduler.storeStartTimes();
+  return success();
+}
+
+LogicalResult
+scheduling::rescheduleDifferenceConstraints(CyclicProblem &prob,
+                                            ArrayRef<Operation *> changedOps) {
+  auto previousII = prob.getInitiationInterval();
+  if (!previousII || *previousII == 0)
+    return scheduleDifferenceConstraints(prob);
+
+  DifferenceConstraintScheduler scheduler(prob);
+  scheduler.buildGraph(&prob);
+
+  // The start times can only be reused for the previous II. If it is still
+  // feasible, only the next smaller II needs to be checked from scratch to
+  // know whether it is still the smallest one.
+  int64_t minII, maxII;
+  if (succeeded(scheduler.recomputeStartTimes(*previousII, changedOps))) {
+    scheduler.storeStartTimes();
+    if (*previousII == 1 ||
+        failed(scheduler.computeStartTimes(*previousII - 1)))
+      return success();
+    minII = 1;
+    maxII = *previousII - 1;
+  } else {
+    minII = *previousII + 1;
+    maxII = std::max(minII, scheduler.getMaxInitiationInterval());
+    if (failed(scheduler.computeStartTimes(maxII)))
+      return prob.getContainingOp()->emitError() << "problem is infeasible";
+  }
+
+  while (minII < maxII) {
+    int64_t ii = minII + (maxII - minII) / 2;
+    if (succeeded(scheduler.computeStartTimes(ii)))
+      maxII = ii;
+    else
+      minII = ii + 1;
+  }
+
+  LLVM_DEBUG(dbgs() << "Smallest feasible II = " << maxII << '\n');
+
+  bool feasible = succeeded(scheduler.computeStartTimes(maxII));
+  assert(feasible && "smallest feasible II must be feasible");
+  (void)feasible;
+  prob.setInitiationInterval(maxII);
+  scheduler.storeStartTimes();
+  return success();
+}
@@ -0,0 +1,397 @@
+//===- ListSchedulers.cpp - Resource-constrained list schedulers ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of priority-based list schedulers for problems with limited
+// operator types.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Scheduling/Algorithms.h"
+
+#include "mlir/IR/Operation.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Debug.h"
+
+#include <queue>
+
+#define DEBUG_TYPE "list-schedulers"
+
+using namespace circt;
+using namespace circt::scheduling;
+
+using llvm::dbgs;
+
+namespace {
+
+/// The dependence graph of a problem. Operations are identified by their index
+/// in the problem's operation list.
+struct DependenceGraph {
+  struct Edge {
+    unsigned node;
+    /// The latency of the source of the dependence.
+    unsigned latency;
+    unsigned distance;
+  };
+
+  SmallVector<SmallVector<Edge, 2>> preds;
+  SmallVector<SmallVector<Edge, 2>> succs;
+  SmallVector<unsigned> latencies;
+
+  /// Build the graph. Distances are taken from \p cyclicProb if it is
+  /// non-null, otherwise they are zero.
+  void build(Problem &prob, CyclicProblem *cyclicProb);
+
+  /// Compute the length of the longest path of distance-0 dependences from
+  /// each operation to a sink, including the operation's own latency. This is
+  /// the critical-path priority of the operation. Fails if the distance-0
+  /// dependences contain a cycle.
+  LogicalResult computeHeights(SmallVectorImpl<unsigned> &heights);
+};
+
+} // anonymous namespace
+
+void DependenceGraph::build(Problem &prob, CyclicProblem *cyclicProb) {
+  auto &ops = prob.getOperations();
+  unsigned nOps = ops.size();
+  DenseMap<Operation *, unsigned> opIds;
+  latencies.resize(nOps);
+  for (unsigned i = 0; i < nOps; ++i) {
+    opIds[ops[i]] = i;
+    latencies[i] = *prob.getLatency(*prob.getLinkedOperatorType(ops[i]));
+  }
+
+  preds.resize(nOps);
+  succs.resize(nOps);
+  for (unsigned dst = 0; dst < nOps; ++dst) {
+    for (auto &dep : prob.getDependences(ops[dst])) {
+      unsigned src = opIds[dep.getSource()];
+      unsigned distance = 0;
+      if (cyclicProb)
+        distance = cyclicProb->getDistance(dep).getValueOr(0);
+      preds[dst].push_back({src, latencies[src], distance});
+      succs[src].push_back({dst, latencies[src], distance});
+    }
+  }
+}
+
+LogicalResult
+DependenceGraph::computeHeights(SmallVectorImpl<unsigned> &heights) {
+  unsigned nOps = latencies.size();
+  heights.assign(nOps, 0);
+
+  // Visit the operations in reverse topological order, starting at the ones
+  // without distance-0 successors.
+  SmallVector<unsigned> nUnvisitedSuccs(nOps, 0);
+  SmallVector<unsigned> worklist;
+  for (unsigned i = 0; i < nOps; ++i) {
+    for (auto &succ : succs[i])
+      if (succ.distance == 0)
+        ++nUnvisitedSuccs[i];
+    if (nUnvisitedSuccs[i] == 0)
+      worklist.push_back(i);
+  }
+
+  unsigned nVisited = 0;
+  while (!worklist.empty()) {
+    unsigned op = worklist.pop_back_val();
+    ++nVisited;
+    unsigned maxSuccHeight = 0;
+    for (auto &succ : succs[op])
+      if (succ.distance == 0)
+        maxSuccHeight = std::max(maxSuccHeight, heights[succ.node]);
+    heights[op] = latencies[op] + maxSuccHeight;
+
+    for (auto &pred : preds[op])
+      if (pred.distance == 0 && --nUnvisitedSuccs[pred.node] == 0)
+        worklist.push_back(pred.node);
+  }
+
+  return success(nVisited == nOps);
+}
+
+/// Return the limit of the operator type used by \p op, or 0 if it is not
+/// limited.
+static unsigned getLimit(SharedPipelinedOperatorsProblem &prob, Operation *op) {
+  return prob.getLimit(*prob.getLinkedOperatorType(op)).getValueOr(0);
+}
+
+//===----------------------------------------------------------------------===//
+// List scheduler
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// Tracks the number of operations that use a limited operator type in each
+/// time step. The next time step with an available operator instance is found
+/// in nearly constant amortized time, by linking each fully used time step to
+/// the next one, like in a disjoint-set forest.
+class ReservationTable {
+public:
+  explicit ReservationTable(unsigned limit) : limit(limit) {}
+
+  /// Return the first time step, starting at \p timeStep, with an available
+  /// operator instance.
+  unsigned findAvailableTimeStep(unsigned timeStep) {
+    grow(timeStep);
+    while (next[timeStep] != timeStep) {
+      // Path halving.
+      next[timeStep] = next[next[timeStep]];
+      timeStep = next[timeStep];
+    }
+    return timeStep;
+  }
+
+  /// Use an operator instance in the available \p timeStep.
+  void reserve(unsigned timeStep) {
+    grow(timeStep + 1);
+    if (++usage[timeStep] == limit)
+      next[timeStep] = timeStep + 1;
+  }
+
+private:
+  void grow(unsigned timeStep) {
+    while (next.size() <= timeStep) {
+      next.push_back(next.size());
+      usage.push_back(0);
+    }
+  }
+
+  unsigned limit;
+  SmallVector<unsigned> next;
+  SmallVector<unsigned> usage;
+};
+
+} // anonymous namespace
+
+LogicalResult scheduling::scheduleList(SharedPipelinedOperatorsProblem &prob) {
+  DependenceGraph graph;
+  graph.build(prob, /*cyclicProb=*/nullptr);
+
+  SmallVector<unsigned> heights;
+  if (failed(graph.computeHeights(heights)))
+    return prob.getContainingOp()->emitError() << "dependence cycle detected";
+
+  auto &ops = prob.getOperations();
+  unsigned nOps = ops.size();
+
+  // Ready operations are scheduled in order of decreasing height, ties are
+  // broken by the order of the operations in the problem.
+  auto hasLowerPriority = [&](unsigned a, unsigned b) {
+    return heights[a] < heights[b] || (heights[a] == heights[b] && a > b);
+  };
+  std::priority_queue<unsigned, std::vector<unsigned>,
+                      decltype(hasLowerPriority)>
+      readyOps(hasLowerPriority);
+
+  SmallVector<unsigned> nUnscheduledPreds(nOps);
+  SmallVector<unsigned> earliestStartTimes(nOps, 0);
+  for (unsigned i = 0; i < nOps; ++i) {
+    nUnscheduledPreds[i] = graph.preds[i].size();
+    if (nUnscheduledPreds[i] == 0)
+      readyOps.push(i);
+  }
+
+  DenseMap<Problem::OperatorType, ReservationTable> reservationTables;
+  while (!readyOps.empty()) {
+    unsigned i = readyOps.top();
+    readyOps.pop();
+
+    // Delay the operation until an instance of its operator type is available.
+    unsigned startTime = earliestStartTimes[i];
+    if (unsigned limit = getLimit(prob, ops[i])) {
+      auto opr = *prob.getLinkedOperatorType(ops[i]);
+      auto &table =
+          reservationTables.try_emplace(opr, ReservationTable(limit))
+              .first->second;
+      startTime = table.findAvailableTimeStep(startTime);
+      table.reserve(startTime);
+    }
+    prob.setStartTime(ops[i], startTime);
+
+    for (auto &succ : graph.succs[i]) {
+      earliestStartTimes[succ.node] = std::max(earliestStartTimes[succ.node],
+                                               startTime + succ.latency);
+      if (--nUnscheduledPreds[succ.node] == 0)
+        readyOps.push(succ.node);
+    }
+  }
+
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Iterative modulo scheduler
+//===----------------------------------------------------------------------===//
+
+namespace {
+
+/// This class implements iterative modulo scheduling, as described in:
+///   B. R. Rau, "Iterative Modulo Scheduling: An Algorithm For Software
+///   Pipelining Loops", MICRO 27, 1994.
+///
+/// For a candidate II, operations are scheduled in order of decreasing height
+/// into a modulo reservation table. An operation that finds no available slot
+/// displaces the operation using its slot, and scheduled successors whose
+/// dependences it violates are unscheduled as well. The attempt fails once a
+/// budget of scheduling steps is exhausted.
+class IterativeModuloScheduler {
+public:
+  IterativeModuloScheduler(ModuloProblem &prob, DependenceGraph &graph,
+                           ArrayRef<unsigned> heights)
+      : prob(prob), graph(graph), heights(heights) {}
+
+  /// Try to find a schedule for the initiation interval \p ii, and store it in
+  /// the problem if successful.
+  LogicalResult schedule(unsigned ii);
+
+private:
+  /// The number of scheduling steps per operation before an attempt fails.
+  static constexpr unsigned budgetRatio = 6;
+
+  ModuloProblem &prob;
+  DependenceGraph &graph;
+  ArrayRef<unsigned> heights;
+};
+
+} // anonymous namespace
+
+LogicalResult IterativeModuloScheduler::schedule(unsigned ii) {
+  auto &ops = prob.getOperations();
+  unsigned nOps = ops.size();
+
+  // The modulo reservation table holds the operations using each limited
+  // operator type, per congruence class.
+  DenseMap<Problem::OperatorType, SmallVector<SmallVector<unsigned, 2>>> mrt;
+  SmallVector<unsigned> limits(nOps);
+  SmallVector<SmallVector<SmallVector<unsigned, 2>> *> tables(nOps, nullptr);
+  for (unsigned i = 0; i < nOps; ++i) {
+    limits[i] = getLimit(prob, ops[i]);
+    if (limits[i] != 0)
+      mrt[*prob.getLinkedOperatorType(ops[i])].resize(ii);
+  }
+  // Inserting into the map may move its entries, so the pointers to the
+  // tables are only taken once all of them are in it.
+  for (unsigned i = 0; i < nOps; ++i)
+    if (limits[i] != 0)
+      tables[i] = &mrt.find(*prob.getLinkedOperatorType(ops[i]))->second;
+
+  auto hasLowerPriority = [&](unsigned a, unsigned b) {
+    return heights[a] < heights[b] || (heights[a] == heights[b] && a > b);
+  };
+  std::priority_queue<unsigned, std::vector<unsigned>,
+                      decltype(hasLowerPriority)>
+      unscheduledOps(hasLowerPriority);
+  for (unsigned i = 0; i < nOps; ++i)
+    unscheduledOps.push(i);
+
+  // Start times are -1 while an operation is unscheduled.
+  SmallVector<int64_t> startTimes(nOps, -1);
+  SmallVector<int64_t> lastStartTimes(nOps, -1);
+
+  auto isAvailable = [&](unsigned i, int64_t startTime) {
+    return !tables[i] || (*tables[i])[startTime % ii].size() < limits[i];
+  };
+  auto unschedule = [&](unsigned i) {
+    if (startTimes[i] < 0)
+      return;
+    if (tables[i])
+      llvm::erase_value((*tables[i])[startTimes[i] % ii], i);
+    startTimes[i] = -1;
+    unscheduledOps.push(i);
+  };
+
+  unsigned budget = budgetRatio * nOps;
+  while (!unscheduledOps.empty()) {
+    if (budget-- == 0)
+      return failure();
+    unsigned i = unscheduledOps.top();
+    unscheduledOps.pop();
+
+    int64_t earliestStartTime = 0;
+    for (auto &pred : graph.preds[i])
+      if (pred.node != i && startTimes[pred.node] >= 0)
+        earliestStartTime = std::max<int64_t>(
+            earliestStartTime, startTimes[pred.node] + pred.latency -
+                                   int64_t(ii) * pred.distance);
+
+    // Look for an available slot in the next II time steps. If there is none,
+    // make progress by not reusing the previous start time of the operation.
+    int64_t startTime = -1;
+    for (int64_t t = earliestStartTime; t < earliestStartTime + ii; ++t) {
+      if (isAvailable(i, t)) {
+        startTime = t;
+        break;
+      }
+    }
+    if (startTime < 0) {
+      startTime = earliestStartTime;
+      if (lastStartTimes[i] >= earliestStartTime)
+        startTime = lastStartTimes[i] + 1;
+      if (!isAvailable(i, startTime))
+        unschedule((*tables[i])[startTime % ii].front());
+    }
+
+    // Unschedule the successors whose dependences are now violated.
+    for (auto &succ : graph.succs[i])
+      if (succ.node != i && startTimes[succ.node] >= 0 &&
+          startTimes[succ.node] <
+              startTime + succ.latency - int64_t(ii) * succ.distance)
+        unschedule(succ.node);
+
+    startTimes[i] = startTime;
+    lastStartTimes[i] = startTime;
+    if (tables[i])
+      (*tables[i])[startTime % ii].push_back(i);
+  }
+
+  for (unsigned i = 0; i < nOps; ++i)
+    prob.setStartTime(ops[i], startTimes[i]);
+  prob.setInitiationInterval(ii);
+  return success();
+}
+
+LogicalResult scheduling::scheduleModulo(ModuloProblem &prob) {
+  // The recurrence-constrained minimum II is the smallest II of the
+  // resource-free problem.
+  if (failed(scheduleDifferenceConstraints(static_cast<CyclicProblem &>(prob))))
+    return failure();
+  unsigned minII = *prob.getInitiationInterval();
+
+  DependenceGraph graph;
+  graph.build(prob, &prob);
+  SmallVector<unsigned> heights;
+  if (failed(graph.computeHeights(heights)))
+    return prob.getContainingOp()->emitError() << "dependence cycle detected";
+
+  // The resource-constrained minimum II is reached when a limited operator
+  // type is used in every congruence class.
+  auto &ops = prob.getOperations();
+  DenseMap<Problem::OperatorType, unsigned> nOpsPerOperatorType;
+  for (auto *op : ops)
+    ++nOpsPerOperatorType[*prob.getLinkedOperatorType(op)];
+  for (auto &kv : nOpsPerOperatorType)
+    if (unsigned limit = prob.getLimit(kv.first).getValueOr(0))
+      minII = std::max(minII, (kv.second + limit - 1) / limit);
+
+  // Sequential execution of all operations is always feasible.
+  unsigned maxII = minII + ops.size();
+  for (unsigned latency : graph.latencies)
+    maxII += latency;
+
+  IterativeModuloScheduler scheduler(prob, graph, heights);
+  for (unsigned ii = minII; ii <= maxII; ++ii) {
+    if (succeeded(scheduler.schedule(ii))) {
+      LLVM_DEBUG(dbgs() << "Modulo scheduled with II = " << ii
+                        << " (minimum II = " << minII << ")\n");
+      return success();
+    }
+  }
+
+  return prob.getContainingOp()->emitError() << "problem is infeasible";
+}
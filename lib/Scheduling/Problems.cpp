@@ -44,6 +44,18 @@ LogicalResult Problem::insertDependence(Dependence dep) {
   return success();
 }
 
+LogicalResult Problem::removeDependence(Dependence dep) {
+  if (!dep.isAuxiliary())
+    return failure();
+
+  auto it = auxDependences.find(dep.getDestination());
+  if (it == auxDependences.end() || !it->second.remove(dep.getSource()))
+    return failure();
+  if (it->second.empty())
+    auxDependences.erase(it);
+  return success();
+}
+
 Problem::OperatorType Problem::getOrInsertOperatorType(StringRef name) {
   auto opr = OperatorType::get(name, containingOp->getContext());
   operatorTypes.insert(opr);
@@ -213,6 +225,135 @@ SharedPipelinedOperatorsProblem::verifyOperatorType(OperatorType opr) {
   return success();
 }
 
+//===----------------------------------------------------------------------===//
+// ModuloProblem
+//===----------------------------------------------------------------------===//
+
+LogicalResult ModuloProblem::verifyOperatorType(OperatorType opr) {
+  auto limit = getLimit(opr);
+  if (!limit || *limit == 0)
+    return success();
+
+  // The operator types are verified before the problem itself.
+  if (!getInitiationInterval() || *getInitiationInterval() == 0)
+    return getContainingOp()->emitError("Invalid initiation interval");
+
+  unsigned ii = *getInitiationInterval();
+  llvm::SmallDenseMap<unsigned, unsigned> nOpsPerCongruenceClass;
+  for (auto *op : getOperations())
+    if (opr == *getLinkedOperatorType(op))
+      ++nOpsPerCongruenceClass[*getStartTime(op) % ii];
+
+  for (auto &kv : nOpsPerCongruenceClass)
+    if (kv.second > *limit)
+      return getContainingOp()->emitError()
+             << "Operator type '" << opr << "' is oversubscribed."
+             << "\n  congruence class: " << kv.first
+             << "\n  #operations: " << kv.second << "\n  limit: " << *limit;
+
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// ChainingProblem
+//===----------------------------------------------------------------------===//
+
+LogicalResult ChainingProblem::checkOperatorType(OperatorType opr) {
+  if (failed(Problem::checkOperatorType(opr)))
+    return failure();
+
+  auto incomingDelay = getIncomingDelay(opr);
+  auto outgoingDelay = getOutgoingDelay(opr);
+  if (!incomingDelay || !outgoingDelay)
+    return getContainingOp()->emitError()
+           << "Missing delays for operator type '" << opr << "'";
+
+  if (*incomingDelay < 0 || *outgoingDelay < 0)
+    return getContainingOp()->emitError()
+           << "Negative delays for operator type '" << opr << "'";
+
+  if (*getLatency(opr) == 0 && *incomingDelay != *outgoingDelay)
+    return getContainingOp()->emitError()
+           << "Incoming & outgoing delay must be equal for zero-latency "
+              "operator type '"
+           << opr << "'";
+
+  auto cycleTime = getCycleTime();
+  if (cycleTime && (*incomingDelay > *cycleTime || *outgoingDelay > *cycleTime))
+    return getContainingOp()->emitError()
+           << "Delays of operator type '" << opr << "' exceed the cycle time";
+
+  return success();
+}
+
+LogicalResult ChainingProblem::checkProblem() {
+  if (failed(Problem::checkProblem()))
+    return failure();
+
+  auto cycleTime = getCycleTime();
+  if (cycleTime && *cycleTime <= 0)
+    return getContainingOp()->emitError("Invalid cycle time");
+  return success();
+}
+
+LogicalResult ChainingProblem::verifyOperation(Operation *op) {
+  if (failed(Problem::verifyOperation(op)))
+    return failure();
+
+  auto stInCycle = getStartTimeInCycle(op);
+  if (!stInCycle || *stInCycle < 0)
+    return op->emitError("Operation has no non-negative start time in cycle");
+
+  // The operands must be registered, or the result be valid, within the start
+  // time step.
+  auto cycleTime = getCycleTime();
+  float inDelay = *getIncomingDelay(*getLinkedOperatorType(op));
+  if (cycleTime && *stInCycle + inDelay > *cycleTime)
+    return op->emitError()
+           << "Operation exceeds the cycle time."
+           << "\n  start time in cycle: " << *stInCycle
+           << "\n  incoming delay: " << inDelay
+           << "\n  cycle time: " << *cycleTime;
+
+  return success();
+}
+
+LogicalResult ChainingProblem::verifyDependence(Dependence dep) {
+  if (failed(Problem::verifyDependence(dep)))
+    return failure();
+
+  // Auxiliary dependences do not transport values.
+  if (dep.isAuxiliary())
+    return success();
+
+  Operation *i = dep.getSource();
+  Operation *j = dep.getDestination();
+
+  auto oprI = *getLinkedOperatorType(i);
+  unsigned stI = *getStartTime(i);
+  unsigned latI = *getLatency(oprI);
+  unsigned stJ = *getStartTime(j);
+
+  // If i's result is available in an earlier time step than j's start time, it
+  // is registered and thus valid at the beginning of j's start time step.
+  if (stI + latI < stJ)
+    return success();
+
+  // Otherwise, the result is only valid after i's outgoing delay, which starts
+  // when i does if i is combinational.
+  float validI = *getOutgoingDelay(oprI);
+  if (latI == 0)
+    validI += *getStartTimeInCycle(i);
+  float stInCycleJ = *getStartTimeInCycle(j);
+  if (validI > stInCycleJ)
+    return getContainingOp()->emitError()
+           << "Precedence violated in cycle " << stJ << " for dependence."
+           << "\n  from: " << *i << ", result valid at z=" << validI
+           << "\n  to:   " << *j << ", starts at z=" << stInCycleJ;
+
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // Dependence
 //===----------------------------------------------------------------------===//
@@ -12,8 +12,15 @@
 
 #include "circt/Scheduling/Algorithms.h"
 
+#include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
 #include "mlir/Pass/Pass.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/Process.h"
+
+#include <chrono>
+#include <random>
 
 using namespace mlir;
 using namespace circt;
@@ -45,6 +52,19 @@ parseArrayOfDicts(ArrayAttr attr, StringRef key) {
   return result;
 }
 
+static SmallVector<std::pair<llvm::StringRef, float>>
+parseArrayOfDictsWithFloats(ArrayAttr attr, StringRef key) {
+  SmallVector<std::pair<llvm::StringRef, float>> result;
+  for (auto dictAttr : attr.getAsRange<DictionaryAttr>()) {
+    auto name = dictAttr.getAs<StringAttr>("name");
+    auto value = dictAttr.getAs<FloatAttr>(key);
+    if (name && value)
+      result.push_back(
+          std::make_pair(name.getValue(), value.getValueAsDouble()));
+  }
+  return result;
+}
+
 static void constructProblem(Problem &prob, FuncOp func) {
   // set up catch-all operator type with unit latency
   auto unitOpr = prob.getOrInsertOperatorType("unit");
@@ -103,10 +123,8 @@ static void constructCyclicProblem(CyclicProblem &prob, FuncOp func) {
   }
 }
 
-static void constructSPOProblem(SharedPipelinedOperatorsProblem &prob,
-                                FuncOp func) {
-  constructProblem(prob, func);
-
+static void constructLimits(SharedPipelinedOperatorsProblem &prob,
+                            FuncOp func) {
   // parse operator type info (again) to extract optional operator limit
   if (auto attr = func->getAttrOfType<ArrayAttr>("operatortypes")) {
     for (auto &elem : parseArrayOfDicts(attr, "limit")) {
@@ -116,6 +134,86 @@ static void constructSPOProblem(SharedPipelinedOperatorsProblem &prob,
   }
 }
 
+static void constructChainingProblem(ChainingProblem &prob, FuncOp func) {
+  constructProblem(prob, func);
+
+  // the catch-all operator type has no delays
+  auto unitOpr = prob.getOrInsertOperatorType("unit");
+  prob.setIncomingDelay(unitOpr, 0);
+  prob.setOutgoingDelay(unitOpr, 0);
+
+  // parse operator type info (again) to extract the physical delays
+  if (auto attr = func->getAttrOfType<ArrayAttr>("operatortypes")) {
+    for (auto &elem : parseArrayOfDictsWithFloats(attr, "incdelay")) {
+      auto opr = prob.getOrInsertOperatorType(std::get<0>(elem));
+      prob.setIncomingDelay(opr, std::get<1>(elem));
+    }
+    for (auto &elem : parseArrayOfDictsWithFloats(attr, "outdelay")) {
+      auto opr = prob.getOrInsertOperatorType(std::get<0>(elem));
+      prob.setOutgoingDelay(opr, std::get<1>(elem));
+    }
+  }
+
+  if (auto attr = func->getAttrOfType<FloatAttr>("cycletime"))
+    prob.setCycleTime(attr.getValueAsDouble());
+}
+
+static void constructSPOProblem(SharedPipelinedOperatorsProblem &prob,
+                                FuncOp func) {
+  constructProblem(prob, func);
+  constructLimits(prob, func);
+}
+
+static void constructModuloProblem(ModuloProblem &prob, FuncOp func) {
+  constructCyclicProblem(prob, func);
+  constructLimits(prob, func);
+}
+
+/// Apply the incremental changes encoded in the test case to a solved problem,
+/// and collect the operations whose constraints changed. Distances of added
+/// auxiliary dependences are set in \p cyclicProb if it is non-null. Return
+/// true if the test case has any changes.
+static bool applyChanges(Problem &prob, FuncOp func,
+                         SmallVectorImpl<Operation *> &changedOps,
+                         CyclicProblem *cyclicProb = nullptr) {
+  bool hasChanges = false;
+  auto &ops = prob.getOperations();
+  if (auto attr = func->getAttrOfType<ArrayAttr>("removedauxdeps")) {
+    hasChanges = true;
+    for (auto &elemArr : parseArrayOfArrays(attr)) {
+      auto res = prob.removeDependence(
+          std::make_pair(ops[elemArr[0]], ops[elemArr[1]]));
+      assert(succeeded(res));
+      (void)res;
+      changedOps.push_back(ops[elemArr[1]]);
+    }
+  }
+  if (auto attr = func->getAttrOfType<ArrayAttr>("addedauxdeps")) {
+    hasChanges = true;
+    for (auto &elemArr : parseArrayOfArrays(attr)) {
+      Operation *from = ops[elemArr[0]];
+      Operation *to = ops[elemArr[1]];
+      auto res = prob.insertDependence(std::make_pair(from, to));
+      assert(succeeded(res));
+      (void)res;
+      if (cyclicProb && elemArr.size() >= 3)
+        cyclicProb->setDistance(std::make_pair(from, to), elemArr[2]);
+      changedOps.push_back(to);
+    }
+  }
+  if (auto attr = func->getAttrOfType<ArrayAttr>("changedlatencies")) {
+    hasChanges = true;
+    for (auto &elem : parseArrayOfDicts(attr, "latency")) {
+      auto opr = prob.getOrInsertOperatorType(std::get<0>(elem));
+      prob.setLatency(opr, std::get<1>(elem));
+      for (auto *op : ops)
+        if (*prob.getLinkedOperatorType(op) == opr)
+          changedOps.push_back(op);
+    }
+  }
+  return hasChanges;
+}
+
 static void emitSchedule(Problem &prob, StringRef attrName,
                          OpBuilder &builder) {
   for (auto *op : prob.getOperations()) {
@@ -226,6 +324,43 @@ void TestSPOProblemPass::runOnFunction() {
   }
 }
 
+//===----------------------------------------------------------------------===//
+// ChainingProblem
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct TestChainingProblemPass
+    : public PassWrapper<TestChainingProblemPass, FunctionPass> {
+  void runOnFunction() override;
+};
+} // namespace
+
+void TestChainingProblemPass::runOnFunction() {
+  auto func = getFunction();
+
+  ChainingProblem prob(func);
+  constructChainingProblem(prob, func);
+
+  if (failed(prob.check())) {
+    func->emitError("problem check failed");
+    return signalPassFailure();
+  }
+
+  // get schedule from the test case
+  for (auto *op : prob.getOperations()) {
+    if (auto startTimeAttr = op->getAttrOfType<IntegerAttr>("problemStartTime"))
+      prob.setStartTime(op, startTimeAttr.getInt());
+    if (auto startTimeInCycleAttr =
+            op->getAttrOfType<FloatAttr>("problemStartTimeInCycle"))
+      prob.setStartTimeInCycle(op, startTimeInCycleAttr.getValueAsDouble());
+  }
+
+  if (failed(prob.verify())) {
+    func->emitError("problem verification failed");
+    return signalPassFailure();
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // ASAPScheduler
 //===----------------------------------------------------------------------===//
@@ -315,6 +450,472 @@ void TestSimplexSchedulerPass::runOnFunction() {
   emitSchedule(prob, "simplexStartTime", builder);
 }
 
+//===----------------------------------------------------------------------===//
+// DifferenceConstraintScheduler
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct TestDifferenceConstraintSchedulerPass
+    : public PassWrapper<TestDifferenceConstraintSchedulerPass, FunctionPass> {
+  TestDifferenceConstraintSchedulerPass() = default;
+  TestDifferenceConstraintSchedulerPass(
+      const TestDifferenceConstraintSchedulerPass &) {}
+  Option<bool> acyclicMode{*this, "acyclic"};
+  void runOnFunction() override;
+};
+} // anonymous namespace
+
+void TestDifferenceConstraintSchedulerPass::runOnFunction() {
+  auto func = getFunction();
+  OpBuilder builder(func.getContext());
+
+  if (acyclicMode) {
+    Problem prob(func);
+    constructProblem(prob, func);
+    assert(succeeded(prob.check()));
+
+    if (failed(scheduleDifferenceConstraints(prob))) {
+      func->emitError("scheduling failed");
+      return signalPassFailure();
+    }
+
+    SmallVector<Operation *> changedOps;
+    if (applyChanges(prob, func, changedOps) &&
+        failed(rescheduleDifferenceConstraints(prob, changedOps))) {
+      func->emitError("rescheduling failed");
+      return signalPassFailure();
+    }
+
+    if (failed(prob.verify())) {
+      func->emitError("schedule verification failed");
+      return signalPassFailure();
+    }
+
+    emitSchedule(prob, "dcStartTime", builder);
+    return;
+  }
+
+  CyclicProblem prob(func);
+  constructCyclicProblem(prob, func);
+  assert(succeeded(prob.check()));
+
+  if (failed(scheduleDifferenceConstraints(prob))) {
+    func->emitError("scheduling failed");
+    return signalPassFailure();
+  }
+
+  SmallVector<Operation *> changedOps;
+  if (applyChanges(prob, func, changedOps, &prob) &&
+      failed(rescheduleDifferenceConstraints(prob, changedOps))) {
+    func->emitError("rescheduling failed");
+    return signalPassFailure();
+  }
+
+  if (failed(prob.verify())) {
+    func->emitError("schedule verification failed");
+    return signalPassFailure();
+  }
+
+  func->setAttr("dcInitiationInterval",
+                builder.getI32IntegerAttr(*prob.getInitiationInterval()));
+  emitSchedule(prob, "dcStartTime", builder);
+}
+
+//===----------------------------------------------------------------------===//
+// ListScheduler
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct TestListSchedulerPass
+    : public PassWrapper<TestListSchedulerPass, FunctionPass> {
+  void runOnFunction() override;
+};
+} // anonymous namespace
+
+void TestListSchedulerPass::runOnFunction() {
+  auto func = getFunction();
+  SharedPipelinedOperatorsProblem prob(func);
+  constructSPOProblem(prob, func);
+  assert(succeeded(prob.check()));
+
+  if (failed(scheduleList(prob))) {
+    func->emitError("scheduling failed");
+    return signalPassFailure();
+  }
+
+  if (failed(prob.verify())) {
+    func->emitError("schedule verification failed");
+    return signalPassFailure();
+  }
+
+  OpBuilder builder(func.getContext());
+  emitSchedule(prob, "listStartTime", builder);
+}
+
+//===----------------------------------------------------------------------===//
+// ChainingScheduler
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct TestChainingSchedulerPass
+    : public PassWrapper<TestChainingSchedulerPass, FunctionPass> {
+  void runOnFunction() override;
+};
+} // anonymous namespace
+
+void TestChainingSchedulerPass::runOnFunction() {
+  auto func = getFunction();
+  ChainingProblem prob(func);
+  constructChainingProblem(prob, func);
+  assert(succeeded(prob.check()));
+
+  if (failed(scheduleChaining(prob))) {
+    func->emitError("scheduling failed");
+    return signalPassFailure();
+  }
+
+  if (failed(prob.verify())) {
+    func->emitError("schedule verification failed");
+    return signalPassFailure();
+  }
+
+  OpBuilder builder(func.getContext());
+  emitSchedule(prob, "chainingStartTime", builder);
+  for (auto *op : prob.getOperations())
+    op->setAttr("chainingStartTimeInCycle",
+                builder.getF32FloatAttr(*prob.getStartTimeInCycle(op)));
+}
+
+//===----------------------------------------------------------------------===//
+// ModuloScheduler
+//===----------------------------------------------------------------------===//
+
+namespace {
+struct TestModuloSchedulerPass
+    : public PassWrapper<TestModuloSchedulerPass, FunctionPass> {
+  void runOnFunction() override;
+};
+} // anonymous namespace
+
+void TestModuloSchedulerPass::runOnFunction() {
+  auto func = getFunction();
+  ModuloProblem prob(func);
+  constructModuloProblem(prob, func);
+  assert(succeeded(prob.check()));
+
+  if (failed(scheduleModulo(prob))) {
+    func->emitError("scheduling failed");
+    return signalPassFailure();
+  }
+
+  if (failed(prob.verify())) {
+    func->emitError("schedule verification failed");
+    return signalPassFailure();
+  }
+
+  OpBuilder builder(func.getContext());
+  func->setAttr("moduloInitiationInterval",
+                builder.getI32IntegerAttr(*prob.getInitiationInterval()));
+  emitSchedule(prob, "moduloStartTime", builder);
+}
+
+//===----------------------------------------------------------------------===//
+// Benchmark
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// An operator type of the synthetic benchmark problems. A limit of zero means
+/// that the operator type is not shared.
+struct BenchmarkOperatorType {
+  const char *name;
+  unsigned latency;
+  unsigned limit;
+};
+} // anonymous namespace
+
+static const BenchmarkOperatorType benchmarkOperatorTypes[] = {
+    {"add", 1, 0}, {"mul", 3, 2}, {"mem", 2, 1}, {"div", 8, 1}};
+
+namespace {
+/// Generates a synthetic scheduling problem of a given size. The operations are
+/// constants in a scratch function, so all dependences are auxiliary ones. Each
+/// operation depends on up to `maxDeps` of the `window` operations before it,
+/// and the operations without successors feed the terminator, which is thus
+/// the last operation of the schedule. Recurrences are loop-carried
+/// dependences to one of the `window` operations before the source. The graph
+/// is generated once, so all the schedulers run on the same problem.
+class BenchmarkGenerator {
+public:
+  BenchmarkGenerator(MLIRContext *ctx, unsigned size, unsigned maxDeps,
+                     unsigned window, bool withRecurrences, unsigned seed);
+  ~BenchmarkGenerator() { func.erase(); }
+
+  void constructProblem(Problem &prob);
+  void constructCyclicProblem(CyclicProblem &prob);
+  void constructLimits(SharedPipelinedOperatorsProblem &prob);
+
+  FuncOp getFunction() { return func; }
+  Operation *getLastOp() { return func.getBlocks().front().getTerminator(); }
+
+private:
+  FuncOp func;
+  SmallVector<Operation *> ops;
+  SmallVector<unsigned> oprIndices;
+  SmallVector<std::pair<unsigned, unsigned>> deps;
+  SmallVector<std::tuple<unsigned, unsigned, unsigned>> recurrences;
+};
+} // anonymous namespace
+
+BenchmarkGenerator::BenchmarkGenerator(MLIRContext *ctx, unsigned size,
+                                       unsigned maxDeps, unsigned window,
+                                       bool withRecurrences, unsigned seed) {
+  OpBuilder builder(ctx);
+  auto loc = builder.getUnknownLoc();
+  func = FuncOp::create(loc, "benchmark", builder.getFunctionType({}, {}));
+  builder.setInsertionPointToStart(func.addEntryBlock());
+
+  std::mt19937 rng(seed);
+  auto random = [&](unsigned lo, unsigned hi) {
+    return std::uniform_int_distribution<unsigned>(lo, hi)(rng);
+  };
+
+  SmallVector<bool> hasSuccessors(size, false);
+  for (unsigned i = 0; i < size; ++i) {
+    ops.push_back(builder.create<ConstantIndexOp>(loc, i));
+    oprIndices.push_back(
+        random(0, llvm::array_lengthof(benchmarkOperatorTypes) - 1));
+    if (i == 0)
+      continue;
+    unsigned reach = std::min(window, i);
+    for (unsigned n = random(0, std::min(maxDeps, i)); n != 0; --n) {
+      unsigned src = i - random(1, reach);
+      deps.emplace_back(src, i);
+      hasSuccessors[src] = true;
+    }
+    // About one in twenty operations closes a recurrence.
+    if (withRecurrences && random(0, 19) == 0)
+      recurrences.emplace_back(i, i - random(1, reach), random(1, 3));
+  }
+  builder.create<ReturnOp>(loc);
+
+  for (unsigned i = 0; i < size; ++i)
+    if (!hasSuccessors[i])
+      deps.emplace_back(i, size);
+}
+
+void BenchmarkGenerator::constructProblem(Problem &prob) {
+  SmallVector<OperatorType> oprs;
+  for (auto &benchOpr : benchmarkOperatorTypes) {
+    oprs.push_back(prob.getOrInsertOperatorType(benchOpr.name));
+    prob.setLatency(oprs.back(), benchOpr.latency);
+  }
+  auto sinkOpr = prob.getOrInsertOperatorType("sink");
+  prob.setLatency(sinkOpr, 0);
+
+  for (unsigned i = 0, e = ops.size(); i < e; ++i) {
+    prob.insertOperation(ops[i]);
+    prob.setLinkedOperatorType(ops[i], oprs[oprIndices[i]]);
+  }
+  auto *lastOp = getLastOp();
+  prob.insertOperation(lastOp);
+  prob.setLinkedOperatorType(lastOp, sinkOpr);
+
+  auto getOp = [&](unsigned i) { return i == ops.size() ? lastOp : ops[i]; };
+  for (auto &dep : deps) {
+    auto res = prob.insertDependence(
+        std::make_pair(getOp(dep.first), getOp(dep.second)));
+    assert(succeeded(res));
+    (void)res;
+  }
+}
+
+void BenchmarkGenerator::constructCyclicProblem(CyclicProblem &prob) {
+  constructProblem(prob);
+  for (auto &rec : recurrences) {
+    auto dep = std::make_pair(ops[std::get<0>(rec)], ops[std::get<1>(rec)]);
+    auto res = prob.insertDependence(dep);
+    assert(succeeded(res));
+    (void)res;
+    prob.setDistance(dep, std::get<2>(rec));
+  }
+}
+
+void BenchmarkGenerator::constructLimits(
+    SharedPipelinedOperatorsProblem &prob) {
+  for (auto &benchOpr : benchmarkOperatorTypes)
+    if (benchOpr.limit)
+      prob.setLimit(prob.getOrInsertOperatorType(benchOpr.name),
+                    benchOpr.limit);
+}
+
+/// The format of the rows of the benchmark report.
+static const char *const benchmarkRowFormat =
+    "{0,-10} {1,8} {2,-10} {3,-7} {4,10} {5,10} {6,8} {7,4}\n";
+
+static Optional<unsigned> getInitiationInterval(Problem &) {
+  return llvm::None;
+}
+
+static Optional<unsigned> getInitiationInterval(CyclicProblem &prob) {
+  return prob.getInitiationInterval();
+}
+
+/// Construct a fresh problem with \p construct, solve it with \p solve, and
+/// print one row of the benchmark report. The memory is the growth of the heap
+/// from before the construction to after the solve, i.e. what the problem and
+/// its solution hold, excluding the scheduler's temporary data structures.
+template <typename ProblemT>
+static void runBenchmark(raw_ostream &os, StringRef kind, unsigned size,
+                         StringRef scheduler, BenchmarkGenerator &gen,
+                         function_ref<void(ProblemT &)> construct,
+                         function_ref<LogicalResult(ProblemT &)> solve) {
+  size_t memoryBefore = llvm::sys::Process::GetMallocUsage();
+  ProblemT prob(gen.getFunction());
+  construct(prob);
+  assert(succeeded(prob.check()));
+
+  auto startTime = std::chrono::steady_clock::now();
+  auto result = solve(prob);
+  auto endTime = std::chrono::steady_clock::now();
+  size_t memoryAfter = llvm::sys::Process::GetMallocUsage();
+
+  StringRef status = "ok";
+  if (failed(result))
+    status = "failed";
+  else if (failed(prob.verify()))
+    status = "invalid";
+
+  std::string length = "-", ii = "-";
+  if (status == "ok") {
+    unsigned maxEndTime = 0;
+    for (auto *op : prob.getOperations())
+      maxEndTime = std::max(
+          maxEndTime, *prob.getStartTime(op) +
+                          *prob.getLatency(*prob.getLinkedOperatorType(op)));
+    length = std::to_string(maxEndTime);
+    if (auto initiationInterval = getInitiationInterval(prob))
+      ii = std::to_string(*initiationInterval);
+  }
+
+  auto timeUs =
+      std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime)
+          .count();
+  size_t memoryKiB =
+      memoryAfter > memoryBefore ? (memoryAfter - memoryBefore) / 1024 : 0;
+  os << llvm::formatv(benchmarkRowFormat, kind, size, scheduler, status, timeUs,
+                      memoryKiB, length, ii);
+}
+
+namespace {
+/// Runs the schedulers on synthetic problems of increasing size, and reports
+/// for each one the solve time in microseconds, the memory in KiB, and the
+/// quality of the schedule, i.e. its length and initiation interval. The
+/// input module is left untouched.
+struct TestSchedulingBenchmarkPass
+    : public PassWrapper<TestSchedulingBenchmarkPass, OperationPass<ModuleOp>> {
+  TestSchedulingBenchmarkPass() = default;
+  TestSchedulingBenchmarkPass(const TestSchedulingBenchmarkPass &) {}
+  ListOption<unsigned> sizes{
+      *this, "sizes", llvm::cl::desc("Problem sizes, in operations"),
+      llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated};
+  ListOption<std::string> kinds{
+      *this, "kinds",
+      llvm::cl::desc("Problem kinds: dag, recurrence and/or shared"),
+      llvm::cl::ZeroOrMore, llvm::cl::MiscFlags::CommaSeparated};
+  Option<unsigned> maxDeps{*this, "max-deps",
+                           llvm::cl::desc("Maximum dependences per operation"),
+                           llvm::cl::init(3)};
+  Option<unsigned> window{
+      *this, "window",
+      llvm::cl::desc("Maximum distance between dependent operations"),
+      llvm::cl::init(32)};
+  Option<unsigned> maxSimplexSize{
+      *this, "max-simplex-size",
+      llvm::cl::desc("Largest problem to run the simplex schedulers on"),
+      llvm::cl::init(2000)};
+  Option<unsigned> seed{*this, "seed", llvm::cl::desc("Random seed"),
+                        llvm::cl::init(1)};
+  void getDependentDialects(DialectRegistry &registry) const override {
+    registry.insert<StandardOpsDialect>();
+  }
+  void runOnOperation() override;
+};
+} // anonymous namespace
+
+void TestSchedulingBenchmarkPass::runOnOperation() {
+  SmallVector<unsigned> problemSizes(sizes.begin(), sizes.end());
+  if (problemSizes.empty())
+    problemSizes = {100, 1000, 10000};
+  SmallVector<std::string> problemKinds(kinds.begin(), kinds.end());
+  if (problemKinds.empty())
+    problemKinds = {"dag", "recurrence", "shared"};
+
+  auto &os = llvm::outs();
+  os << llvm::formatv(benchmarkRowFormat, "kind", "size", "scheduler",
+                      "status", "time(us)", "mem(KiB)", "length", "ii");
+
+  for (auto &kind : problemKinds) {
+    if (kind != "dag" && kind != "recurrence" && kind != "shared") {
+      getOperation().emitError("unknown benchmark kind '") << kind << "'";
+      return signalPassFailure();
+    }
+
+    for (unsigned size : problemSizes) {
+      BenchmarkGenerator gen(&getContext(), size, maxDeps, window,
+                             /*withRecurrences=*/kind == "recurrence", seed);
+      auto *lastOp = gen.getLastOp();
+      bool runSimplex = size <= maxSimplexSize;
+
+      if (kind == "dag") {
+        auto construct = [&](Problem &prob) { gen.constructProblem(prob); };
+        runBenchmark<Problem>(os, kind, size, "asap", gen, construct,
+                              [](Problem &prob) { return scheduleASAP(prob); });
+        if (runSimplex)
+          runBenchmark<Problem>(os, kind, size, "simplex", gen, construct,
+                                [&](Problem &prob) {
+                                  return scheduleSimplex(prob, lastOp);
+                                });
+        runBenchmark<Problem>(os, kind, size, "dc", gen, construct,
+                              [](Problem &prob) {
+                                return scheduleDifferenceConstraints(prob);
+                              });
+      } else if (kind == "recurrence") {
+        auto construct = [&](CyclicProblem &prob) {
+          gen.constructCyclicProblem(prob);
+        };
+        if (runSimplex)
+          runBenchmark<CyclicProblem>(os, kind, size, "simplex", gen, construct,
+                                      [&](CyclicProblem &prob) {
+                                        return scheduleSimplex(prob, lastOp);
+                                      });
+        runBenchmark<CyclicProblem>(
+            os, kind, size, "dc", gen, construct, [](CyclicProblem &prob) {
+              return scheduleDifferenceConstraints(prob);
+            });
+      } else {
+        runBenchmark<SharedPipelinedOperatorsProblem>(
+            os, kind, size, "list", gen,
+            [&](SharedPipelinedOperatorsProblem &prob) {
+              gen.constructProblem(prob);
+              gen.constructLimits(prob);
+            },
+            [](SharedPipelinedOperatorsProblem &prob) {
+              return scheduleList(prob);
+            });
+        runBenchmark<ModuloProblem>(
+            os, kind, size, "modulo", gen,
+            [&](ModuloProblem &prob) {
+              gen.constructProblem(prob);
+              gen.constructLimits(prob);
+            },
+            [](ModuloProblem &prob) { return scheduleModulo(prob); });
+      }
+    }
+  }
+
+  markAllAnalysesPreserved();
+}
+
 //===----------------------------------------------------------------------===//
 // Pass registration
 //===----------------------------------------------------------------------===//
@@ -330,11 +931,28 @@ void registerSchedulingTestPasses() {
   PassRegistration<TestSPOProblemPass> spoTester(
       "test-spo-problem", "Import a solution for the shared, pipelined "
                           "operators problem encoded as attributes");
+  PassRegistration<TestChainingProblemPass> chainingTester(
+      "test-chaining-problem",
+      "Import a solution for the chaining problem encoded as attributes");
   PassRegistration<TestASAPSchedulerPass> asapTester(
       "test-asap-scheduler", "Emit ASAP scheduler's solution as attributes");
   PassRegistration<TestSimplexSchedulerPass> simplexTester(
       "test-simplex-scheduler",
       "Emit simplex scheduler's solution as attributes");
+  PassRegistration<TestDifferenceConstraintSchedulerPass> dcTester(
+      "test-difference-constraint-scheduler",
+      "Emit difference constraint scheduler's solution as attributes");
+  PassRegistration<TestListSchedulerPass> listTester(
+      "test-list-scheduler", "Emit list scheduler's solution as attributes");
+  PassRegistration<TestChainingSchedulerPass> chainingSchedulerTester(
+      "test-chaining-scheduler",
+      "Emit chaining scheduler's solution as attributes");
+  PassRegistration<TestModuloSchedulerPass> moduloTester(
+      "test-modulo-scheduler",
+      "Emit modulo scheduler's solution as attributes");
+  PassRegistration<TestSchedulingBenchmarkPass> benchmarkTester(
+      "test-scheduling-benchmark",
+      "Report the schedulers' performance on synthetic problems");
 }
 } // namespace test
 } // namespace circt
@@ -16,16 +16,66 @@
 
 using namespace circt;
 
-Backedge::Backedge(mlir::Operation *op) : value(op->getResult(0)) {}
+Backedge::Backedge(mlir::Operation *op, BackedgeBuilder *bulk)
+    : edge(op->getResult(0)), value(edge), bulk(bulk) {}
 
 void Backedge::setValue(mlir::Value newValue) {
   assert(value.getType() == newValue.getType());
+  if (bulk) {
+    // The backedge may have been assigned another backedge, so its value is
+    // not enough to tell whether it was assigned.
+    bool inserted = bulk->replacements.insert({edge, newValue}).second;
+    (void)inserted;
+    assert(inserted && "Backedge assigned twice in bulk mode");
+    value = newValue;
+    return;
+  }
   for (auto &use : value.getUses())
     use.set(newValue);
   value = newValue;
 }
 
+void BackedgeBuilder::resolve() {
+  for (auto &replacement :
+       llvm::make_range(replacements.begin() + numResolved,
+                        replacements.end())) {
+    // A backedge may be assigned another backedge, which is resolved to its
+    // own value. The backedges along the way are pointed to the final value,
+    // so that each chain is only followed once. A chain longer than the number
+    // of backedges goes around a cycle.
+    SmallVector<Value *, 4> chain;
+    Value newValue = replacement.second;
+    bool isCycle = false;
+    for (auto it = replacements.find(newValue); it != replacements.end();
+         it = replacements.find(newValue)) {
+      if (chain.size() == replacements.size()) {
+        isCycle = true;
+        break;
+      }
+      chain.push_back(&it->second);
+      newValue = it->second;
+    }
+    assert(!isCycle && "Backedges assigned each other in a cycle");
+    if (!isCycle) {
+      replacement.second = newValue;
+      for (Value *link : chain)
+        *link = newValue;
+    }
+    replacement.first.replaceAllUsesWith(newValue);
+  }
+  numResolved = replacements.size();
+}
+
 BackedgeBuilder::~BackedgeBuilder() {
+  if (arena) {
+    resolve();
+    for (Operation &op : *arena) {
+      (void)op;
+      assert(op.use_empty() && "Backedge still in use");
+    }
+    return;
+  }
+
   for (Operation *op : edges) {
     auto users = op->getUsers();
     assert(users.empty() && "Backedge still in use");
@@ -38,17 +88,29 @@ BackedgeBuilder::~BackedgeBuilder() {
 
 Backedge::operator mlir::Value() { return value; }
 
-BackedgeBuilder::BackedgeBuilder(OpBuilder &builder, Location loc)
-    : builder(builder), rewriter(nullptr), loc(loc) {
+BackedgeBuilder::BackedgeBuilder(OpBuilder &builder, Location loc, bool bulk)
+    : builder(builder), rewriter(nullptr), loc(loc),
+      opName("TemporaryBackedge", loc.getContext()) {
   loc.getContext()->allowUnregisteredDialects();
+  if (bulk)
+    arena = std::make_unique<Block>();
 }
-BackedgeBuilder::BackedgeBuilder(PatternRewriter &rewriter, Location loc)
-    : builder(rewriter), rewriter(&rewriter), loc(loc) {
+BackedgeBuilder::BackedgeBuilder(PatternRewriter &rewriter, Location loc,
+                                 bool bulk)
+    : builder(rewriter), rewriter(&rewriter), loc(loc),
+      opName("TemporaryBackedge", loc.getContext()) {
   loc.getContext()->allowUnregisteredDialects();
+  if (bulk)
+    arena = std::make_unique<Block>();
 }
 Backedge BackedgeBuilder::get(Type t) {
-  OperationState s(loc, "TemporaryBackedge");
+  OperationState s(loc, opName);
   s.addTypes(t);
+  if (arena) {
+    auto op = Operation::create(s);
+    arena->push_back(op);
+    return Backedge(op, this);
+  }
   auto op = builder.createOperation(s);
   edges.push_back(op);
   return Backedge(op);
@@ -43,6 +43,17 @@ void LoweringOptions::parse(StringRef text, ErrorHandlerT errorHandler) {
       useAlwaysFF = true;
     } else if (option == "exprInEventControl") {
       allowExprInEventControl = true;
+    } else if (option == "emissionReport") {
+      emitEmissionReport = true;
+    } else if (option == "mergeAlways") {
+      mergeAlwaysBlocks = true;
+    } else if (option.startswith("profile=")) {
+      option = option.drop_front(strlen("profile="));
+      if (option == "simulation")
+        applySimulationProfile();
+      else
+        errorHandler(llvm::Twine("unknown lowering profile \'") + option +
+                     "\'");
     } else if (option.startswith("emittedLineLength=")) {
       option = option.drop_front(strlen("emittedLineLength="));
       if (option.getAsInteger(10, emittedLineLength)) {
@@ -65,6 +76,10 @@ std::string LoweringOptions::toString() const {
     options += "exprInEventControl,";
   if (emittedLineLength != 90)
     options += "emittedLineLength=" + std::to_string(emittedLineLength) + ',';
+  if (emitEmissionReport)
+    options += "emissionReport,";
+  if (mergeAlwaysBlocks)
+    options += "mergeAlways,";
 
   // Remove a trailing comma if present.
   if (!options.empty()) {
@@ -74,6 +89,14 @@ std::string LoweringOptions::toString() const {
   return options;
 }
 
+void LoweringOptions::applySimulationProfile() {
+  // Fewer, larger processes are cheaper to schedule for simulators.
+  mergeAlwaysBlocks = true;
+  // Simulators don't need the clocks to be simple wires, and spilling them
+  // adds a continuous assignment per process.
+  allowExprInEventControl = true;
+}
+
 void LoweringOptions::setAsAttribute(ModuleOp module) {
   module->setAttr("circt.loweringOptions",
                   StringAttr::get(module.getContext(), toString()));
@@ -0,0 +1,120 @@
+//===- ThreadingOptions.cpp - CIRCT Threading Options ---------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Command line options which control the threads of the tools and their
+// support.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Support/ThreadingOptions.h"
+#include "circt/Support/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace circt;
+
+//===----------------------------------------------------------------------===//
+// Thread Affinity
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A set of CPUs, parsed from a comma separated list of CPU numbers and ranges
+/// of CPU numbers such as "0-3,8".
+struct CPUSet {
+  SmallVector<unsigned, 16> cpus;
+};
+
+struct CPUSetParser : public llvm::cl::parser<CPUSet> {
+  CPUSetParser(llvm::cl::Option &option) : llvm::cl::parser<CPUSet>(option) {}
+
+  bool parse(llvm::cl::Option &option, StringRef argName, StringRef argValue,
+             CPUSet &value) {
+    SmallVector<StringRef, 8> ranges;
+    argValue.split(ranges, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+    for (auto range : ranges) {
+      unsigned first, last;
+      auto bounds = range.split('-');
+      if (bounds.first.trim().getAsInteger(10, first))
+        return option.error("invalid CPU '" + bounds.first + "'");
+      last = first;
+      if (!bounds.second.empty() &&
+          bounds.second.trim().getAsInteger(10, last))
+        return option.error("invalid CPU '" + bounds.second + "'");
+      if (last < first)
+        return option.error("invalid CPU range '" + range + "'");
+      for (unsigned cpu = first; cpu <= last; ++cpu)
+        value.cpus.push_back(cpu);
+    }
+    if (value.cpus.empty())
+      return option.error("no CPUs specified");
+    return false;
+  }
+};
+} // namespace
+
+/// Restrict the process to the specified CPUs. The threads created afterwards
+/// inherit the affinity, and the default number of threads follows it.
+static void setThreadAffinity(const CPUSet &set) {
+#ifdef __linux__
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  for (auto cpu : set.cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      llvm::errs() << "warning: ignoring CPU " << cpu
+                   << " beyond the supported range\n";
+      continue;
+    }
+    CPU_SET(cpu, &mask);
+  }
+  if (sched_setaffinity(0, sizeof(mask), &mask))
+    llvm::errs() << "warning: cannot set the thread affinity\n";
+#else
+  llvm::errs() << "warning: -thread-affinity is not supported on this host\n";
+#endif
+}
+
+//===----------------------------------------------------------------------===//
+// Command Line Options
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// Commandline arguments for the threads.  Used to dynamically register the
+/// command line arguments in multiple tools.
+struct ThreadingCLOptions {
+  llvm::cl::opt<unsigned> threads{
+      "threads",
+      llvm::cl::desc("Run parallel loops on at most this many threads, 0 for "
+                     "one per available core"),
+      llvm::cl::value_desc("n"), llvm::cl::init(0),
+      llvm::cl::callback(
+          [](const unsigned &numThreads) { setNumThreads(numThreads); })};
+
+  llvm::cl::opt<CPUSet, false, CPUSetParser> threadAffinity{
+      "thread-affinity",
+      llvm::cl::desc("Run on the listed CPUs only, e.g. \"0-7,16-23\""),
+      llvm::cl::value_desc("cpus"),
+      llvm::cl::cb<void, const CPUSet &>(setThreadAffinity)};
+};
+} // namespace
+
+/// The staticly initialized command line options.
+static llvm::ManagedStatic<ThreadingCLOptions> clOptions;
+
+void circt::registerThreadingCLOptions() { *clOptions; }
+
+void circt::setNumThreads(unsigned numThreads) {
+  llvm::parallel::strategy = llvm::hardware_concurrency(numThreads);
+}
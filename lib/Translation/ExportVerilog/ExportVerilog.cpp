@@ -14,6 +14,7 @@
 #include "circt/Dialect/Comb/CombDialect.h"
 #include "circt/Dialect/Comb/CombVisitors.h"
 #include "circt/Dialect/HW/HWOps.h"
+#include "circt/Dialect/HW/HWSymCache.h"
 #include "circt/Dialect/HW/HWTypes.h"
 #include "circt/Dialect/HW/HWVisitors.h"
 #include "circt/Dialect/SV/SVAttributes.h"
@@ -28,13 +29,18 @@
 #include "mlir/Translation.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SaveAndRestore.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
+#include <chrono>
+#include <mutex>
 
 using namespace circt;
 
@@ -373,56 +379,20 @@ enum VerilogPrecedence {
 };
 } // end anonymous namespace
 
-/// Pull any FileLineCol locs out of the specified location and add it to the
-/// specified set.
+/// Pull any FileLineCol locs out of the specified location and add them to the
+/// specified vector.
 static void collectFileLineColLocs(Location loc,
-                                   SmallPtrSet<Attribute, 8> &locationSet) {
+                                   SmallVectorImpl<FileLineColLoc> &locs) {
   if (auto fileLoc = loc.dyn_cast<FileLineColLoc>())
-    locationSet.insert(fileLoc);
+    locs.push_back(fileLoc);
 
   if (auto fusedLoc = loc.dyn_cast<FusedLoc>())
     for (auto loc : fusedLoc.getLocations())
-      collectFileLineColLocs(loc, locationSet);
+      collectFileLineColLocs(loc, locs);
 }
 
-/// Return the location information as a (potentially empty) string.
-static std::string
-getLocationInfoAsString(const SmallPtrSet<Operation *, 8> &ops) {
-  std::string resultStr;
-  llvm::raw_string_ostream sstr(resultStr);
-
-  // Multiple operations may come from the same location or may not have useful
-  // location info.  Unique it now.
-  SmallPtrSet<Attribute, 8> locationSet;
-  for (auto *op : ops)
-    collectFileLineColLocs(op->getLoc(), locationSet);
-
-  auto printLoc = [&](FileLineColLoc loc) {
-    sstr << loc.getFilename();
-    if (auto line = loc.getLine()) {
-      sstr << ':' << line;
-      if (auto col = loc.getColumn())
-        sstr << ':' << col;
-    }
-  };
-
-  // Fast pass some common cases.
-  switch (locationSet.size()) {
-  case 1:
-    printLoc((*locationSet.begin()).cast<FileLineColLoc>());
-    LLVM_FALLTHROUGH;
-  case 0:
-    return sstr.str();
-  default:
-    break;
-  }
-
-  // Sort the entries.
-  SmallVector<FileLineColLoc, 8> locVector;
-  locVector.reserve(locationSet.size());
-  for (auto loc : locationSet)
-    locVector.push_back(loc.cast<FileLineColLoc>());
-
+/// Sort the locations by filename, line and column, and remove duplicates.
+static void sortAndUniqueLocs(SmallVectorImpl<FileLineColLoc> &locVector) {
   llvm::array_pod_sort(
       locVector.begin(), locVector.end(),
       [](const FileLineColLoc *lhs, const FileLineColLoc *rhs) -> int {
@@ -430,9 +400,17 @@ getLocationInfoAsString(const SmallPtrSet<Operation *, 8> &ops) {
           return fn;
         if (lhs->getLine() != rhs->getLine())
           return lhs->getLine() < rhs->getLine() ? -1 : 1;
-        return lhs->getColumn() < rhs->getColumn() ? -1 : 1;
+        if (lhs->getColumn() != rhs->getColumn())
+          return lhs->getColumn() < rhs->getColumn() ? -1 : 1;
+        return 0;
       });
+  locVector.erase(std::unique(locVector.begin(), locVector.end()),
+                  locVector.end());
+}
 
+/// Print sorted and uniqued locations.
+static void printFileLineColLocs(ArrayRef<FileLineColLoc> locVector,
+                                 raw_ostream &sstr) {
   // The entries are sorted by filename, line, col.  Try to merge together
   // entries to reduce verbosity on the column info.
   StringRef lastFileName;
@@ -474,7 +452,78 @@ getLocationInfoAsString(const SmallPtrSet<Operation *, 8> &ops) {
     }
     sstr << '}';
   }
+}
+
+namespace {
+/// This formats the location information of the emitted statements.  The
+/// FileLineCol locs of each location are collected, sorted and uniqued only
+/// once, and so is the information of the statements which come from a single
+/// location, which most do.  Every emitter state has its own cache, so it is
+/// only used by one thread.
+class LocationInfoCache {
+public:
+  /// Return the location information of the specified operations as a
+  /// (potentially empty) string.  This is valid until the next call.
+  StringRef get(const SmallPtrSet<Operation *, 8> &ops);
+
+private:
+  ArrayRef<FileLineColLoc> getFileLineColLocs(Location loc);
+
+  DenseMap<Location, SmallVector<FileLineColLoc, 1>> fileLineColLocs;
+  DenseMap<Location, std::string> singleLocationInfo;
+  std::string mergedLocationInfo;
+};
+} // end anonymous namespace
+
+ArrayRef<FileLineColLoc> LocationInfoCache::getFileLineColLocs(Location loc) {
+  auto it = fileLineColLocs.find(loc);
+  if (it != fileLineColLocs.end())
+    return it->second;
+
+  SmallVector<FileLineColLoc, 1> locs;
+  collectFileLineColLocs(loc, locs);
+  sortAndUniqueLocs(locs);
+  return fileLineColLocs.insert({loc, std::move(locs)}).first->second;
+}
+
+StringRef LocationInfoCache::get(const SmallPtrSet<Operation *, 8> &ops) {
+  Optional<Location> loc;
+  bool hasSingleLocation = true;
+  for (auto *op : ops) {
+    if (!loc) {
+      loc = op->getLoc();
+    } else if (*loc != op->getLoc()) {
+      hasSingleLocation = false;
+      break;
+    }
+  }
+  if (!loc)
+    return {};
+
+  if (hasSingleLocation) {
+    auto it = singleLocationInfo.find(*loc);
+    if (it == singleLocationInfo.end()) {
+      std::string info;
+      llvm::raw_string_ostream sstr(info);
+      printFileLineColLocs(getFileLineColLocs(*loc), sstr);
+      sstr.flush();
+      it = singleLocationInfo.insert({*loc, std::move(info)}).first;
+    }
+    return it->second;
+  }
 
+  // Multiple operations may come from the same location or may not have useful
+  // location info.  Unique it now.
+  SmallVector<FileLineColLoc, 8> locVector;
+  for (auto *op : ops) {
+    auto opLocs = getFileLineColLocs(op->getLoc());
+    locVector.append(opLocs.begin(), opLocs.end());
+  }
+  sortAndUniqueLocs(locVector);
+
+  mergedLocationInfo.clear();
+  llvm::raw_string_ostream sstr(mergedLocationInfo);
+  printFileLineColLocs(locVector, sstr);
   return sstr.str();
 }
 
@@ -494,6 +543,30 @@ static void appendPossiblyAbsolutePath(SmallVectorImpl<char> &base,
   }
 }
 
+/// Write `contents` to the file at `path`, unless the file already holds
+/// exactly these contents.  Leaving unchanged files untouched preserves their
+/// modification time, such that re-running the compiler on the same design
+/// does not invalidate downstream incremental builds.  Returns failure and
+/// sets `errorMessage` if the file cannot be written.
+static LogicalResult writeFileIfChanged(StringRef path, StringRef contents,
+                                        std::string &errorMessage) {
+  // Only read the existing file if its size matches, which rules out most
+  // changed files without touching their contents.
+  uint64_t existingSize;
+  if (!llvm::sys::fs::file_size(path, existingSize) &&
+      existingSize == contents.size())
+    if (auto existing = llvm::MemoryBuffer::getFile(path))
+      if ((*existing)->getBuffer() == contents)
+        return success();
+
+  auto output = mlir::openOutputFile(path, &errorMessage);
+  if (!output)
+    return failure();
+  output->os() << contents;
+  output->keep();
+  return success();
+}
+
 //===----------------------------------------------------------------------===//
 // VerilogEmitter
 //===----------------------------------------------------------------------===//
@@ -509,12 +582,26 @@ public:
   /// The emitter options which control verilog emission.
   LoweringOptions options;
 
+  /// The symbols of the top-level module, used to resolve instances to the
+  /// modules they reference.  This is null when a module is emitted on its
+  /// own, in which case symbols are looked up in the parent module.
+  const HWSymbolCache *symbolCache = nullptr;
+
   /// The stream to emit to.
   raw_ostream &os;
 
   bool encounteredError = false;
   unsigned currentIndent = 0;
 
+  /// The number of temporaries created for expressions, and the number of
+  /// texts with substitutions emitted.  These are only used for the emission
+  /// report.
+  size_t numTemporaries = 0;
+  size_t numTextSubstitutions = 0;
+
+  /// The location information of the statements emitted so far.
+  LocationInfoCache locationInfo;
+
 private:
   VerilogEmitterState(const VerilogEmitterState &) = delete;
   void operator=(const VerilogEmitterState &) = delete;
@@ -662,7 +749,7 @@ public:
   /// aggregate it together and print a pretty comment specifying where the
   /// operations came from.  In any case, print a newline.
   void emitLocationInfoAndNewLine(const SmallPtrSet<Operation *, 8> &ops) {
-    auto locInfo = getLocationInfoAsString(ops);
+    auto locInfo = state.locationInfo.get(ops);
     if (!locInfo.empty())
       os << "\t// " << locInfo;
     os << '\n';
@@ -680,6 +767,8 @@ private:
 void EmitterBase::emitTextWithSubstitutions(
     StringRef string, Operation *op,
     std::function<void(Value)> operandEmitter) {
+  ++state.numTextSubstitutions;
+
   // Perform operand substitions as we emit the line string.  We turn {{42}}
   // into the value of operand 42.
 
@@ -906,6 +995,7 @@ private:
   SubExprInfo visitTypeOp(ArrayGetOp op);
   SubExprInfo visitTypeOp(ArrayCreateOp op);
   SubExprInfo visitTypeOp(ArrayConcatOp op);
+  void emitAggregateOperand(Value operand);
   SubExprInfo visitTypeOp(StructCreateOp op);
   SubExprInfo visitTypeOp(StructExtractOp op);
   SubExprInfo visitTypeOp(StructInjectOp op);
@@ -1037,6 +1127,7 @@ void ExprEmitter::retroactivelyEmitExpressionIntoTemporary(Operation *op) {
 
   emitter.outOfLineExpressions.insert(op);
   names.addName(op->getResult(0), "_tmp");
+  ++state.numTemporaries;
 
   // Remember that this subexpr needs to be emitted independently.
   tooLargeSubExpressions.push_back(op);
@@ -1187,9 +1278,8 @@ SubExprInfo ExprEmitter::visitComb(ConcatOp op) {
   }
 
   os << '{';
-  llvm::interleaveComma(op.getOperands(), os, [&](Value v) {
-    emitSubExpr(v, LowestPrecedence, OOLBinary);
-  });
+  llvm::interleaveComma(op.getOperands(), os,
+                        [&](Value v) { emitAggregateOperand(v); });
 
   os << '}';
   return {Symbol, IsUnsigned};
@@ -1337,11 +1427,31 @@ SubExprInfo ExprEmitter::visitTypeOp(ArrayGetOp op) {
 }
 
 // Syntax from: section 5.11 "Array literals".
+/// Emit an operand of a concatenation or array.  Large tables such as ROM
+/// contents consist mostly of constants, which are printed directly here
+/// instead of going through emitSubExpr.  This produces the same output, as
+/// long as the constant is short enough not to be split into a temporary.
+void ExprEmitter::emitAggregateOperand(Value operand) {
+  auto constant = operand.getDefiningOp<ConstantOp>();
+  if (constant && !emitter.outOfLineExpressions.count(constant)) {
+    // The width, the "'h" and one hex digit per four bits.
+    unsigned width = constant.getType().getWidth();
+    size_t maxLength = llvm::utostr(width).size() + 2 + (width + 3) / 4;
+    if (maxLength <= std::max(state.options.emittedLineLength / 2, 10U)) {
+      signPreference = NoRequirement;
+      visitTypeOp(constant);
+      emittedExprs.insert(constant);
+      return;
+    }
+  }
+  emitSubExpr(operand, LowestPrecedence, OOLBinary);
+}
+
 SubExprInfo ExprEmitter::visitTypeOp(ArrayCreateOp op) {
   os << '{';
   llvm::interleaveComma(op.inputs(), os, [&](Value operand) {
     os << "{";
-    emitSubExpr(operand, LowestPrecedence, OOLBinary);
+    emitAggregateOperand(operand);
     os << "}";
   });
   os << '}';
@@ -1572,30 +1682,88 @@ private:
 };
 } // namespace
 
+/// Blocks with at least this many operations are analyzed in parallel by the
+/// NameCollector.  Smaller blocks are not worth the overhead.
+static constexpr size_t parallelNameCollectionThreshold = 1024;
+
+namespace {
+/// What the NameCollector needs to know about an operation, which can be
+/// computed independently for each operation.
+struct NameCollectorOpInfo {
+  /// Whether this is an expression emitted inline into its users.
+  bool isEmittedInline = false;
+  /// The packed type string of each result which is declared, or empty.
+  SmallVector<SmallString<8>, 1> typeStrings;
+};
+} // namespace
+
+/// Compute the inlining decision and the declared type strings of an operation.
+static void analyzeForNameCollection(Operation &op, bool isBlockProcedural,
+                                     NameCollectorOpInfo &info) {
+  bool isExpr = isVerilogExpression(&op);
+  if (isExpr) {
+    // Dead expressions don't need to be analyzed.
+    if (op.use_empty())
+      return;
+    info.isEmittedInline = isExpressionEmittedInline(&op);
+    // Only procedural blocks emit declarations for out-of-line expressions.
+    if (info.isEmittedInline || !isBlockProcedural)
+      return;
+  }
+
+  info.typeStrings.resize(op.getNumResults());
+  for (auto result : op.getResults()) {
+    if (isExpr && result.use_empty())
+      continue;
+    // Convert the port's type to a string.
+    llvm::raw_svector_ostream stringStream(
+        info.typeStrings[result.getResultNumber()]);
+    printPackedType(stripUnpackedTypes(result.getType()), stringStream, &op);
+  }
+}
+
 void NameCollector::collectNames(Block &block) {
   bool isBlockProcedural = block.getParentOp()->hasTrait<ProceduralRegion>();
 
-  SmallString<32> nameTmp;
+  // Analyze the operations up front.  This is the expensive part of collecting
+  // names, it scans the users of each expression and prints the declared
+  // types, and is done in parallel for large blocks.  The names are assigned
+  // below in the order of the block, so the output does not depend on this.
+  SmallVector<Operation *, 0> ops;
+  ops.reserve(block.getOperations().size());
+  for (auto &op : block)
+    if (!isa<InstanceOp, InterfaceInstanceOp>(op))
+      ops.push_back(&op);
+  std::vector<NameCollectorOpInfo> opInfos(ops.size());
+  auto analyze = [&](size_t index) {
+    analyzeForNameCollection(*ops[index], isBlockProcedural, opInfos[index]);
+  };
+  if (ops.size() >= parallelNameCollectionThreshold)
+    mlir::parallelForEachN(block.getParentOp()->getContext(), 0, ops.size(),
+                           analyze);
+  else
+    for (size_t index = 0, e = ops.size(); index != e; ++index)
+      analyze(index);
 
   // Loop over all of the results of all of the ops.  Anything that defines a
-  // value needs to be noticed.
-  for (auto &op : block) {
+  // value needs to be noticed.  Instances and interface instances are handled
+  // in prepareHWModule.
+  for (size_t index = 0, e = ops.size(); index != e; ++index) {
+    auto &op = *ops[index];
+    auto &info = opInfos[index];
     bool isExpr = isVerilogExpression(&op);
 
-    // Instances and interface instances are handled in prepareHWModule
-    if (isa<InstanceOp, InterfaceInstanceOp>(op))
-      continue;
-
     for (auto result : op.getResults()) {
       // If this is an expression emitted inline or unused, it doesn't need a
       // name.
       if (isExpr) {
         // If this expression is dead, or can be emitted inline, ignore it.
-        if (result.use_empty() || isExpressionEmittedInline(&op))
+        if (result.use_empty() || info.isEmittedInline)
           continue;
 
         // Remember that this expression should be emitted out of line.
-        moduleEmitter.outOfLineExpressions.insert(&op);
+        if (moduleEmitter.outOfLineExpressions.insert(&op).second)
+          ++moduleEmitter.state.numTemporaries;
       }
 
       // Otherwise, it must be an expression or a declaration like a
@@ -1615,19 +1783,12 @@ void NameCollector::collectNames(Block &block) {
       }
 
       // Emit this value.
-      valuesToEmit.push_back(ValuesToEmitRecord{result, {}});
-      auto &typeString = valuesToEmit.back().typeString;
+      auto &typeString = info.typeStrings[result.getResultNumber()];
+      maxTypeWidth = std::max(typeString.size(), maxTypeWidth);
+      valuesToEmit.push_back(ValuesToEmitRecord{result, std::move(typeString)});
 
       maxDeclNameWidth =
           std::max(getVerilogDeclWord(&op).size(), maxDeclNameWidth);
-
-      // Convert the port's type to a string and measure it.
-      {
-        llvm::raw_svector_ostream stringStream(typeString);
-        printPackedType(stripUnpackedTypes(result.getType()), stringStream,
-                        &op);
-      }
-      maxTypeWidth = std::max(typeString.size(), maxTypeWidth);
     }
 
     // Recursively process any regions under the op iff this is a procedural
@@ -1821,6 +1982,20 @@ private:
   /// 'begin' block, used to emit variable declarations.
   size_t blockDeclarationInsertPointIndex = 0;
   size_t numStatementsEmitted = 0;
+
+  /// Declarations of temporaries in the current 'begin' block.  These are
+  /// inserted at blockDeclarationInsertPointIndex all at once when the block is
+  /// done, rather than shifting the rest of the block for each of them.
+  SmallString<64> pendingBlockDeclarations;
+
+public:
+  /// Insert the pending declarations of temporaries into the current block.
+  void flushBlockDeclarations() {
+    outBuffer.insert(outBuffer.begin() + blockDeclarationInsertPointIndex,
+                     pendingBlockDeclarations.begin(),
+                     pendingBlockDeclarations.end());
+    pendingBlockDeclarations.clear();
+  }
 };
 
 } // end anonymous namespace
@@ -1860,18 +2035,17 @@ void StmtEmitter::emitExpression(Value exp,
 
   // If we are working on a procedural statement, we need to emit the
   // declarations for each variable separately from the assignments to them.
-  // We do this after inserting the assign statements because we don't want to
-  // invalidate the index.
+  // They are emitted at the end of the buffer, and then set aside until they
+  // are inserted at the top of the block by flushBlockDeclarations.
   if (tooLargeSubExpressions[0]->getParentOp()->hasTrait<ProceduralRegion>()) {
-    thisStmt.assign(outBuffer.begin() + blockDeclarationInsertPointIndex,
-                    outBuffer.end());
-    outBuffer.resize(blockDeclarationInsertPointIndex);
+    size_t declarationsBeginningIndex = outBuffer.size();
     for (auto *expr : tooLargeSubExpressions) {
       if (!emitDeclarationForTemporary(expr))
         os << ";\n";
     }
-    blockDeclarationInsertPointIndex = outBuffer.size();
-    outBuffer.append(thisStmt.begin(), thisStmt.end());
+    pendingBlockDeclarations.append(
+        outBuffer.begin() + declarationsBeginningIndex, outBuffer.end());
+    outBuffer.resize(declarationsBeginningIndex);
   }
 }
 
@@ -2227,11 +2401,17 @@ void StmtEmitter::emitBlockAsStatement(Block *block,
   emitLocationInfoAndNewLine(locationOps);
 
   // Change the blockDeclarationInsertPointIndex for the statements in this
-  // block.
-  llvm::SaveAndRestore<size_t> X(blockDeclarationInsertPointIndex,
-                                 outBuffer.size());
+  // block, and collect the declarations of its temporaries separately.
   auto numEmittedBefore = getNumStatementsEmitted();
-  emitStatementBlock(*block);
+  {
+    llvm::SaveAndRestore<size_t> X(blockDeclarationInsertPointIndex,
+                                   outBuffer.size());
+    SmallString<64> outerBlockDeclarations;
+    std::swap(outerBlockDeclarations, pendingBlockDeclarations);
+    emitStatementBlock(*block);
+    flushBlockDeclarations();
+    std::swap(outerBlockDeclarations, pendingBlockDeclarations);
+  }
 
   // If we emitted exactly one statement, then we are done.
   if (getNumStatementsEmitted() - numEmittedBefore == 1)
@@ -2448,7 +2628,7 @@ LogicalResult StmtEmitter::visitStmt(InstanceOp op) {
   SmallPtrSet<Operation *, 8> ops;
   ops.insert(op);
 
-  auto *moduleOp = op.getReferencedModule();
+  auto *moduleOp = op.getReferencedModule(state.symbolCache);
   assert(moduleOp && "Invalid IR");
 
   // Use the specified name or the symbol name as appropriate.
@@ -2772,13 +2952,17 @@ void StmtEmitter::emitStatementBlock(Block &body) {
 
 void ModuleEmitter::emitStatement(Operation *op, ModuleNameManager &names) {
   SmallString<128> outputBuffer;
-  StmtEmitter(*this, outputBuffer, names).emitStatement(op);
+  StmtEmitter stmtEmitter(*this, outputBuffer, names);
+  stmtEmitter.emitStatement(op);
+  stmtEmitter.flushBlockDeclarations();
   os << outputBuffer;
 }
 
 void ModuleEmitter::emitStatementBlock(Block &body, ModuleNameManager &names) {
   SmallString<128> outputBuffer;
-  StmtEmitter(*this, outputBuffer, names).emitStatementBlock(body);
+  StmtEmitter stmtEmitter(*this, outputBuffer, names);
+  stmtEmitter.emitStatementBlock(body);
+  stmtEmitter.flushBlockDeclarations();
   os << outputBuffer;
 }
 
@@ -2811,7 +2995,7 @@ void ModuleEmitter::emitBind(BindOp op) {
   auto parentVerilogName = getVerilogModuleNameAttr(parentMod);
   verifyModuleName(op, parentVerilogName);
 
-  Operation *childMod = inst.getReferencedModule();
+  Operation *childMod = inst.getReferencedModule(state.symbolCache);
   auto childVerilogName = getVerilogModuleNameAttr(childMod);
   verifyModuleName(op, childVerilogName);
 
@@ -3303,11 +3487,35 @@ struct RootEmitterBase {
   // Emitter options extracted from the top-level module.
   LoweringOptions options;
 
-  explicit RootEmitterBase(ModuleOp rootOp) : rootOp(rootOp), options(rootOp) {}
+  /// The symbols defined in the top-level module, shared by all the emitters.
+  /// It is only read once built, so modules can be emitted in parallel.
+  HWSymbolCache symbolCache;
+
+  /// What the emission report records about each module.
+  struct ModuleEmissionStats {
+    size_t bytes = 0;
+    size_t lines = 0;
+    size_t numTemporaries = 0;
+    size_t numTextSubstitutions = 0;
+    int64_t timeUs = 0;
+  };
+
+  /// The emission statistics of each module, if the emission report is
+  /// enabled.  Modules may be emitted in parallel, so this is guarded by
+  /// `statsMutex`.
+  llvm::DenseMap<Operation *, ModuleEmissionStats> moduleStats;
+  std::mutex statsMutex;
+
+  explicit RootEmitterBase(ModuleOp rootOp)
+      : rootOp(rootOp), options(rootOp), symbolCache(rootOp) {}
   void prepareAllModules();
   void gatherFiles(bool separateModules);
+  void collectFileOps(const FileInfo &fileInfo,
+                      SmallVectorImpl<Operation *> &ops);
   void emitFile(const FileInfo &fileInfo, VerilogEmitterState &state);
   void emitOperation(VerilogEmitterState &state, Operation *op);
+  void emitModuleWithStats(VerilogEmitterState &state, HWModuleOp op);
+  void writeEmissionReport(llvm::raw_ostream &os);
 };
 
 } // namespace
@@ -3326,10 +3534,36 @@ static void rewriteAddWithNegativeConstant(comb::AddOp add,
     rhsCst.erase();
 }
 
+/// Merge the always_ff blocks of a graph region which have the same clock and
+/// reset into the last of them.  The merged processes are emitted in their
+/// original order, and values used by the earlier bodies dominate the last one.
+static void mergeAlwaysFFBlocks(Block &block) {
+  DenseMap<std::pair<Value, Value>, AlwaysFFOp> lastAlways;
+  for (auto always : llvm::make_early_inc_range(block.getOps<AlwaysFFOp>())) {
+    auto &prev = lastAlways[{always.clock(), always.reset()}];
+    if (prev && prev.clockEdge() == always.clockEdge() &&
+        prev.resetStyle() == always.resetStyle() &&
+        prev.resetEdge() == always.resetEdge()) {
+      auto &body = always.getBodyBlock()->getOperations();
+      body.splice(body.begin(), prev.getBodyBlock()->getOperations());
+      if (always.reset()) {
+        auto &reset = always.getResetBlock()->getOperations();
+        reset.splice(reset.begin(), prev.getResetBlock()->getOperations());
+      }
+      prev.erase();
+    }
+    prev = always;
+  }
+}
+
 /// For each module we emit, do a prepass over the structure, pre-lowering and
 /// otherwise rewriting operations we don't want to emit.
 static void prepareHWModule(Block &block, ModuleNameManager &names,
                             const LoweringOptions &options) {
+  if (options.mergeAlwaysBlocks &&
+      !block.getParentOp()->hasTrait<ProceduralRegion>())
+    mergeAlwaysFFBlocks(block);
+
   for (Block::iterator opIterator = block.begin(), e = block.end();
        opIterator != e;) {
     auto &op = *opIterator++;
@@ -3587,10 +3821,10 @@ void RootEmitterBase::gatherFiles(bool separateModules) {
   }
 }
 
-/// Emit the operations in a `FileInfo` to an output stream. This handles the
-/// correct interpolation of replicated operations.
-void RootEmitterBase::emitFile(const FileInfo &file,
-                               VerilogEmitterState &state) {
+/// Collect the operations in a `FileInfo` in the order they are emitted. This
+/// handles the correct interpolation of replicated operations.
+void RootEmitterBase::collectFileOps(const FileInfo &file,
+                                     SmallVectorImpl<Operation *> &ops) {
   size_t lastReplicatedOp = 0;
 
   // Emit each operation in the file preceded by the replicated ops not yet
@@ -3601,17 +3835,26 @@ void RootEmitterBase::emitFile(const FileInfo &file,
     if (file.emitReplicatedOps)
       for (; lastReplicatedOp < std::min(opInfo.position, replicatedOps.size());
            ++lastReplicatedOp)
-        emitOperation(state, replicatedOps[lastReplicatedOp]);
+        ops.push_back(replicatedOps[lastReplicatedOp]);
 
     // Emit the operation itself.
-    emitOperation(state, opInfo.op);
+    ops.push_back(opInfo.op);
   }
 
   // Emit the replicated per-file operations after the last operation (if
   // enabled).
   if (file.emitReplicatedOps)
     for (; lastReplicatedOp < replicatedOps.size(); lastReplicatedOp++)
-      emitOperation(state, replicatedOps[lastReplicatedOp]);
+      ops.push_back(replicatedOps[lastReplicatedOp]);
+}
+
+/// Emit the operations in a `FileInfo` to an output stream.
+void RootEmitterBase::emitFile(const FileInfo &file,
+                               VerilogEmitterState &state) {
+  SmallVector<Operation *, 16> ops;
+  collectFileOps(file, ops);
+  for (auto *op : ops)
+    emitOperation(state, op);
 
   if (state.encounteredError)
     encounteredError = true;
@@ -3620,7 +3863,10 @@ void RootEmitterBase::emitFile(const FileInfo &file,
 void RootEmitterBase::emitOperation(VerilogEmitterState &state, Operation *op) {
   TypeSwitch<Operation *>(op)
       .Case<HWModuleOp>([&](auto op) {
-        ModuleEmitter(state).emitHWModule(op, legalizedNames[op]);
+        if (options.emitEmissionReport)
+          emitModuleWithStats(state, op);
+        else
+          ModuleEmitter(state).emitHWModule(op, legalizedNames[op]);
       })
       .Case<HWModuleExternOp>(
           [&](auto op) { ModuleEmitter(state).emitHWExternModule(op); })
@@ -3643,6 +3889,63 @@ void RootEmitterBase::emitOperation(VerilogEmitterState &state, Operation *op) {
       });
 }
 
+/// Emit a module and record its emission statistics for the emission report.
+void RootEmitterBase::emitModuleWithStats(VerilogEmitterState &state,
+                                          HWModuleOp op) {
+  // Emit the module into a separate buffer, so that we can measure it.
+  std::string buffer;
+  llvm::raw_string_ostream bufferOS(buffer);
+  VerilogEmitterState moduleState(bufferOS);
+  moduleState.options = state.options;
+  moduleState.symbolCache = state.symbolCache;
+  moduleState.currentIndent = state.currentIndent;
+
+  auto startTime = std::chrono::steady_clock::now();
+  ModuleEmitter(moduleState).emitHWModule(op, legalizedNames[op]);
+  bufferOS.flush();
+  auto endTime = std::chrono::steady_clock::now();
+
+  state.os << buffer;
+  if (moduleState.encounteredError)
+    state.encounteredError = true;
+
+  ModuleEmissionStats stats;
+  stats.bytes = buffer.size();
+  stats.lines = StringRef(buffer).count('\n');
+  stats.numTemporaries = moduleState.numTemporaries;
+  stats.numTextSubstitutions = moduleState.numTextSubstitutions;
+  stats.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                     endTime - startTime)
+                     .count();
+
+  std::lock_guard<std::mutex> lock(statsMutex);
+  moduleStats[op] = stats;
+}
+
+/// Write the emission statistics of all modules as a JSON array, in the order
+/// of the modules in the MLIR module.
+void RootEmitterBase::writeEmissionReport(llvm::raw_ostream &os) {
+  llvm::json::OStream json(os, /*IndentSize=*/2);
+  json.array([&] {
+    for (auto module : rootOp.getBody()->getOps<HWModuleOp>()) {
+      auto it = moduleStats.find(module);
+      if (it == moduleStats.end())
+        continue;
+      auto &stats = it->second;
+      json.object([&] {
+        json.attribute("module", module.getName());
+        json.attribute("bytes", int64_t(stats.bytes));
+        json.attribute("lines", int64_t(stats.lines));
+        json.attribute("temporaries", int64_t(stats.numTemporaries));
+        json.attribute("textSubstitutions",
+                       int64_t(stats.numTextSubstitutions));
+        json.attribute("timeUs", stats.timeUs);
+      });
+    }
+  });
+  os << "\n";
+}
+
 //===----------------------------------------------------------------------===//
 // Unified Emitter
 //===----------------------------------------------------------------------===//
@@ -3664,18 +3967,41 @@ struct UnifiedEmitter : public RootEmitterBase {
 
 void UnifiedEmitter::emitMLIRModule() {
   gatherFiles(false);
-  VerilogEmitterState state(os);
-  state.options = options;
-
-  // Emit the main file. This is a container for anything not explicitly split
-  // out into a separate file.
-  emitFile(rootFile, state);
 
-  // Emit the separate files.
+  // Collect the operations of the main file, which is a container for anything
+  // not explicitly split out into a separate file, followed by the separate
+  // files.  Remember at which operation each separate file starts.
+  SmallVector<Operation *, 0> ops;
+  SmallVector<std::pair<size_t, Identifier>, 4> fileStarts;
+  collectFileOps(rootFile, ops);
   for (const auto &it : files) {
-    state.os << "\n// ----- 8< ----- FILE \"" << it.first
-             << "\" ----- 8< -----\n\n";
-    emitFile(it.second, state);
+    fileStarts.push_back({ops.size(), it.first});
+    collectFileOps(it.second, ops);
+  }
+
+  // Emit each operation into its own buffer, in parallel if the context
+  // enables it.  Top-level operations are emitted without any indentation, so
+  // the buffers don't depend on each other.
+  std::vector<std::string> buffers(ops.size());
+  mlir::parallelForEachN(rootOp->getContext(), 0, ops.size(), [&](size_t i) {
+    llvm::raw_string_ostream bufferOS(buffers[i]);
+    VerilogEmitterState state(bufferOS);
+    state.options = options;
+    state.symbolCache = &symbolCache;
+    emitOperation(state, ops[i]);
+    if (state.encounteredError)
+      encounteredError = true;
+  });
+
+  // Write out the buffers in order, with a separator before each separate
+  // file.  This produces the same output as emitting everything serially.
+  auto *nextFile = fileStarts.begin();
+  for (size_t i = 0, e = ops.size(); i <= e; ++i) {
+    for (; nextFile != fileStarts.end() && nextFile->first == i; ++nextFile)
+      os << "\n// ----- 8< ----- FILE \"" << nextFile->second
+         << "\" ----- 8< -----\n\n";
+    if (i != e)
+      os << buffers[i];
   }
 }
 
@@ -3702,41 +4028,52 @@ struct SplitEmitter : public RootEmitterBase {
 void SplitEmitter::emitMLIRModule() {
   gatherFiles(true);
 
+  // Create all the output directories up front.  Many files usually share a
+  // directory, so this avoids checking the same directories over and over
+  // again from every worker, which is slow on network file systems.
+  llvm::StringSet<> outputDirs;
+  for (auto &it : files) {
+    SmallString<128> outputFilename(dirname);
+    appendPossiblyAbsolutePath(outputFilename, it.first.strref());
+    auto outputDir = llvm::sys::path::parent_path(outputFilename);
+    if (!outputDirs.insert(outputDir).second)
+      continue;
+    std::error_code error = llvm::sys::fs::create_directories(outputDir);
+    if (error) {
+      mlir::emitError(it.second.ops[0].op->getLoc(),
+                      "cannot create output directory \"" + outputDir +
+                          "\": " + error.message());
+      encounteredError = true;
+    }
+  }
+
   // Run in parallel if context enables it.
   mlir::parallelForEach(rootOp->getContext(), files.begin(), files.end(),
                         [&](auto &it) { createFile(it.first, it.second); });
 }
 
 void SplitEmitter::createFile(Identifier fileName, FileInfo &file) {
-  // Determine the output path from the output directory and filename.
+  // Determine the output path from the output directory and filename.  The
+  // output directory has already been created by `emitMLIRModule`.
   SmallString<128> outputFilename(dirname);
   appendPossiblyAbsolutePath(outputFilename, fileName.strref());
-  auto outputDir = llvm::sys::path::parent_path(outputFilename);
-
-  // Create the output directory if needed.
-  std::error_code error = llvm::sys::fs::create_directories(outputDir);
-  if (error) {
-    mlir::emitError(file.ops[0].op->getLoc(),
-                    "cannot create output directory \"" + outputDir +
-                        "\": " + error.message());
-    encounteredError = true;
-  }
 
-  // Open the output file.
+  // Emit the file into a buffer, copying the global options into the
+  // individual module state.
+  std::string contents;
+  llvm::raw_string_ostream os(contents);
+  VerilogEmitterState state(os);
+  state.options = options;
+  state.symbolCache = &symbolCache;
+  emitFile(file, state);
+  os.flush();
+
+  // Write the output file, leaving it alone if it is unchanged.
   std::string errorMessage;
-  auto output = mlir::openOutputFile(outputFilename, &errorMessage);
-  if (!output) {
+  if (failed(writeFileIfChanged(outputFilename, contents, errorMessage))) {
     encounteredError = true;
     llvm::errs() << errorMessage << "\n";
-    return;
   }
-
-  // Emit the file, copying the global options into the individual module
-  // state.
-  VerilogEmitterState state(output->os());
-  state.options = options;
-  emitFile(file, state);
-  output->keep();
 }
 
 //===----------------------------------------------------------------------===//
@@ -3750,6 +4087,20 @@ LogicalResult circt::exportVerilog(ModuleOp module, llvm::raw_ostream &os) {
   return failure(emitter.encounteredError);
 }
 
+LogicalResult circt::exportVerilogModule(HWModuleOp module,
+                                        llvm::raw_ostream &os) {
+  LoweringOptions options(module->getParentOfType<ModuleOp>());
+  ModuleNameManager names;
+  prepareHWModule(*module.getBodyBlock(), names, options);
+  if (names.hadError())
+    return failure();
+
+  VerilogEmitterState state(os);
+  state.options = options;
+  ModuleEmitter(state).emitHWModule(module, names);
+  return failure(state.encounteredError);
+}
+
 LogicalResult circt::exportSplitVerilog(ModuleOp module, StringRef dirname) {
   SplitEmitter emitter(dirname, module);
   emitter.prepareAllModules();
@@ -3759,18 +4110,35 @@ LogicalResult circt::exportSplitVerilog(ModuleOp module, StringRef dirname) {
   SmallString<128> filelistPath(dirname);
   llvm::sys::path::append(filelistPath, "filelist.f");
 
+  std::string filelist;
+  llvm::raw_string_ostream os(filelist);
+  for (const auto &it : emitter.files) {
+    if (it.second.addToFilelist)
+      os << it.first << "\n";
+  }
+  os.flush();
+
   std::string errorMessage;
-  auto output = mlir::openOutputFile(filelistPath, &errorMessage);
-  if (!output) {
+  if (failed(writeFileIfChanged(filelistPath, filelist, errorMessage))) {
     module->emitError(errorMessage);
     return failure();
   }
 
-  for (const auto &it : emitter.files) {
-    if (it.second.addToFilelist)
-      output->os() << it.first << "\n";
+  // Write the emission report next to the file list if requested.
+  if (emitter.options.emitEmissionReport) {
+    SmallString<128> reportPath(dirname);
+    llvm::sys::path::append(reportPath, "emission-report.json");
+
+    std::string report;
+    llvm::raw_string_ostream reportOS(report);
+    emitter.writeEmissionReport(reportOS);
+    reportOS.flush();
+
+    if (failed(writeFileIfChanged(reportPath, report, errorMessage))) {
+      module->emitError(errorMessage);
+      return failure();
+    }
   }
-  output->keep();
 
   return failure(emitter.encounteredError);
 }
@@ -11,8 +11,13 @@
  */
 
 #include "mlir-c/IR.h"
+#include "circt-c/Dialect/Comb.h"
+#include "circt-c/Dialect/FIRRTL.h"
 #include "circt-c/Dialect/HW.h"
+#include "circt-c/Dialect/SV.h"
 #include "circt-c/Dialect/Seq.h"
+#include "circt-c/ExportVerilog.h"
+#include "circt-c/Firtool.h"
 #include "mlir-c/AffineExpr.h"
 #include "mlir-c/AffineMap.h"
 #include "mlir-c/BuiltinTypes.h"
@@ -123,6 +128,58 @@ int testHWTypes() {
   return 0;
 }
 
+void printToStderr(MlirStringRef str, void *userData) {
+  (void)userData;
+  fwrite(str.data, 1, str.length, stderr);
+}
+
+int testFirtoolPipeline() {
+  MlirContext ctx = mlirContextCreate();
+  mlirDialectHandleRegisterDialect(mlirGetDialectHandle__firrtl__(), ctx);
+  mlirDialectHandleRegisterDialect(mlirGetDialectHandle__hw__(), ctx);
+  mlirDialectHandleRegisterDialect(mlirGetDialectHandle__comb__(), ctx);
+  mlirDialectHandleRegisterDialect(mlirGetDialectHandle__sv__(), ctx);
+
+  MlirModule module = mlirModuleCreateParse(
+      ctx, mlirStringRefCreateFromCString(
+               "firrtl.circuit \"Top\" {\n"
+               "  firrtl.module @Top(in %in: !firrtl.uint<8>,\n"
+               "                    out %out: !firrtl.uint<8>) {\n"
+               "    firrtl.connect %out, %in : !firrtl.uint<8>, "
+               "!firrtl.uint<8>\n"
+               "  }\n"
+               "}\n"));
+  if (mlirModuleIsNull(module))
+    return 1;
+
+  if (mlirLogicalResultIsSuccess(circtFirtoolSetLoweringOptions(
+          module, mlirStringRefCreateFromCString("noSuchOption"))))
+    return 2;
+  if (mlirLogicalResultIsFailure(circtFirtoolSetLoweringOptions(
+          module, mlirStringRefCreateFromCString("alwaysFF"))))
+    return 3;
+
+  MlirPassManager pm = mlirPassManagerCreate(ctx);
+  CirctFirtoolOptions options = circtFirtoolOptionsCreateDefault();
+  circtFirtoolOptionsSetEmitVerilog(options, true);
+  circtFirtoolPopulatePipeline(pm, options);
+  circtFirtoolOptionsDestroy(options);
+  CirctPipelineReport report = circtPassManagerAddPipelineReport(pm);
+
+  if (mlirLogicalResultIsFailure(mlirPassManagerRun(pm, module)))
+    return 4;
+  circtPipelineReportPrintJSON(report, printToStderr, NULL);
+  mlirPassManagerDestroy(pm);
+
+  if (mlirLogicalResultIsFailure(
+          mlirExportVerilog(module, printToStderr, NULL)))
+    return 5;
+
+  mlirModuleDestroy(module);
+  mlirContextDestroy(ctx);
+  return 0;
+}
+
 int main() {
   fprintf(stderr, "@registration\n");
   int errcode = registerOnlyHW();
@@ -132,11 +189,21 @@ int main() {
   errcode = testHWTypes();
   fprintf(stderr, "%d\n", errcode);
 
+  fprintf(stderr, "@firtool\n");
+  errcode = testFirtoolPipeline();
+  fprintf(stderr, "%d\n", errcode);
+
   // clang-format off
   // CHECK-LABEL: @registration
   // CHECK: 0
   // CHECK-LABEL: @hwtypes
   // CHECK: 0
+  // CHECK-LABEL: @firtool
+  // CHECK: error: unknown style option 'noSuchOption'
+  // CHECK: "pass": "lower-firrtl-to-hw"
+  // CHECK: module Top(
+  // CHECK: assign out = in;
+  // CHECK: 0
   // clang-format on
 
   return 0;
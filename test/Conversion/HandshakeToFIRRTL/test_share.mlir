@@ -0,0 +1,20 @@
+// RUN: circt-opt -lower-handshake-to-firrtl="shared-ops=std.muli" %s | FileCheck %s
+
+// CHECK-LABEL: firrtl.module @std_muli_2ins_1outs_ui64(
+
+// CHECK-LABEL: firrtl.module @std_muli_2ins_1outs_ui64_shared2(
+// CHECK:   firrtl.instance @std_muli_2ins_1outs_ui64
+// CHECK:   %validReg0 = firrtl.regreset
+// CHECK:   %dataReg0 = firrtl.regreset
+// CHECK:   %validReg1 = firrtl.regreset
+// CHECK:   %dataReg1 = firrtl.regreset
+// CHECK: }
+
+// CHECK-LABEL: firrtl.module @test_share(
+handshake.func @test_share(%arg0: index, %arg1: index, %arg2: index, %arg3: index, %arg4: none, ...) -> (index, index, none) {
+  // CHECK: firrtl.instance @std_muli_2ins_1outs_ui64_shared2
+  // CHECK-NOT: firrtl.instance @std_muli_2ins_1outs_ui64
+  %0 = muli %arg0, %arg1 : index
+  %1 = muli %arg2, %arg3 : index
+  handshake.return %0, %1, %arg4 : index, index, none
+}
@@ -36,6 +36,26 @@
 // CHECK:           llvm.return
 // CHECK:         }
 
+// CHECK-LABEL:   llvm.func @Foo_batch(
+// CHECK-SAME:                         %[[STATE:[^:]*]]: !llvm.ptr<i8>, %[[STATES:[^:]*]]: !llvm.ptr<ptr<struct<()>>>, %[[TABLES:[^:]*]]: !llvm.ptr<ptr<struct<(ptr<i8>, i64, i64, i64)>>>, %[[N:[^:]*]]: i64) {
+// CHECK:           %[[ZERO:.*]] = llvm.mlir.constant(0 : i64) : i64
+// CHECK:           llvm.br ^[[HEADER:bb[0-9]+]](%[[ZERO]] : i64)
+// CHECK:         ^[[HEADER]](%[[I:[^:]*]]: i64):
+// CHECK:           %[[CMP:.*]] = llvm.icmp "slt" %[[I]], %[[N]] : i64
+// CHECK:           llvm.cond_br %[[CMP]], ^[[LOOP:bb[0-9]+]], ^[[EXIT:bb[0-9]+]]
+// CHECK:         ^[[LOOP]]:
+// CHECK:           %[[STATE_PTR:.*]] = llvm.getelementptr %[[STATES]]{{\[}}%[[I]]]
+// CHECK:           %[[INST_STATE:.*]] = llvm.load %[[STATE_PTR]]
+// CHECK:           %[[TABLE_PTR:.*]] = llvm.getelementptr %[[TABLES]]{{\[}}%[[I]]]
+// CHECK:           %[[TABLE:.*]] = llvm.load %[[TABLE_PTR]]
+// CHECK:           llvm.call @Foo(%[[STATE]], %[[INST_STATE]], %[[TABLE]])
+// CHECK:           %[[ONE:.*]] = llvm.mlir.constant(1 : i64) : i64
+// CHECK:           %[[NEXT:.*]] = llvm.add %[[I]], %[[ONE]] : i64
+// CHECK:           llvm.br ^[[HEADER]](%[[NEXT]] : i64)
+// CHECK:         ^[[EXIT]]:
+// CHECK:           llvm.return
+// CHECK:         }
+
 llhd.entity @Foo () -> () {
   %0 = llhd.const 0 : i1
   %toggle = llhd.sig "toggle" %0 : i1
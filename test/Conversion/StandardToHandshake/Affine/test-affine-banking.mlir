@@ -0,0 +1,53 @@
+// RUN: circt-opt %s -create-dataflow=max-memory-banks=2 -split-input-file | FileCheck %s
+
+// Even and odd elements are accessed separately, so the memref is partitioned
+// cyclically.
+
+func @cyclic () -> () {
+  %A = memref.alloc() : memref<8xf32>
+  affine.for %i = 0 to 4 {
+    %0 = affine.load %A[2 * %i] : memref<8xf32>
+    affine.store %0, %A[2 * %i + 1] : memref<8xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: handshake.func @cyclic
+// CHECK-DAG: "handshake.memory"(%{{.*}}) {id = 0 : i32, ld_count = 1 : i32, lsq = false, st_count = 0 : i32, type = memref<4xf32>}
+// CHECK-DAG: "handshake.memory"(%{{.*}}, %{{.*}}) {id = 1 : i32, ld_count = 0 : i32, lsq = false, st_count = 1 : i32, type = memref<4xf32>}
+// CHECK-NOT: memref<8xf32>
+
+// -----
+
+// The two halves of the memref are accessed separately, so the memref is
+// partitioned in blocks.
+
+func @block () -> () {
+  %A = memref.alloc() : memref<8xf32>
+  affine.for %i = 0 to 4 {
+    %0 = affine.load %A[%i] : memref<8xf32>
+    affine.store %0, %A[%i + 4] : memref<8xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: handshake.func @block
+// CHECK-DAG: "handshake.memory"(%{{.*}}) {id = 0 : i32, ld_count = 1 : i32, lsq = false, st_count = 0 : i32, type = memref<4xf32>}
+// CHECK-DAG: "handshake.memory"(%{{.*}}, %{{.*}}) {id = 1 : i32, ld_count = 0 : i32, lsq = false, st_count = 1 : i32, type = memref<4xf32>}
+// CHECK-NOT: memref<8xf32>
+
+// -----
+
+// Both accesses can reach any element, so the memref is not partitioned.
+
+func @unbanked (%j : index) -> () {
+  %A = memref.alloc() : memref<8xf32>
+  affine.for %i = 0 to 8 {
+    %0 = affine.load %A[%i] : memref<8xf32>
+    affine.store %0, %A[%j] : memref<8xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: handshake.func @unbanked
+// CHECK: "handshake.memory"({{.*}}) {id = 0 : i32, ld_count = 1 : i32, lsq = false, st_count = 1 : i32, type = memref<8xf32>}
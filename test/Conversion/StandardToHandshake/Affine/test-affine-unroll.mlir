@@ -0,0 +1,37 @@
+// RUN: circt-opt %s -create-dataflow=loop-unroll-factor=2 -split-input-file | FileCheck %s
+// RUN: circt-opt %s -create-dataflow="loop-unroll-factor=2 max-memory-banks=2" -split-input-file | FileCheck %s -check-prefix=BANKS
+
+// Both unrolled iterations access memory in the same loop body, which steps by
+// two.
+
+func @unroll (%A : memref<8xf32>) -> () {
+  affine.for %i = 0 to 8 {
+    %0 = affine.load %A[%i] : memref<8xf32>
+    affine.store %0, %A[%i] : memref<8xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: handshake.func @unroll
+// CHECK: "handshake.memory"({{.*}}) {id = 0 : i32, ld_count = 2 : i32, lsq = false, st_count = 2 : i32, type = memref<8xf32>}
+// CHECK: "handshake.constant"({{.*}}) {value = 2 : index} : (none) -> index
+// CHECK-NOT: affine.apply
+
+// -----
+
+// The unrolled iterations access the even and odd elements of the local
+// memrefs, which are partitioned cyclically.
+
+func @unroll_banked () -> () {
+  %A = memref.alloc() : memref<8xf32>
+  %B = memref.alloc() : memref<8xf32>
+  affine.for %i = 0 to 8 {
+    %0 = affine.load %A[%i] : memref<8xf32>
+    affine.store %0, %B[%i] : memref<8xf32>
+  }
+  return
+}
+
+// BANKS-LABEL: handshake.func @unroll_banked
+// BANKS-COUNT-4: "handshake.memory"({{.*}}type = memref<4xf32>}
+// BANKS-NOT: memref<8xf32>
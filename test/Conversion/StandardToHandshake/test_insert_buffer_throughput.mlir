@@ -0,0 +1,19 @@
+// RUN: circt-opt -handshake-insert-buffer=strategies=throughput %s | FileCheck %s
+
+module {
+  // The direct path to the join has to hold the tokens that wait for the two
+  // sequential buffers on the other path.
+  // CHECK-LABEL: handshake.func @reconvergent
+  handshake.func @reconvergent(%arg0: none, ...) -> none {
+    // CHECK:      %[[FORK:.*]]:2 = "handshake.fork"
+    // CHECK-NEXT: %[[SEQ0:.*]] = "handshake.buffer"(%[[FORK]]#0) {control = true, sequential = true, slots = 1 : i32}
+    // CHECK-NEXT: %[[SEQ1:.*]] = "handshake.buffer"(%[[SEQ0]]) {control = true, sequential = true, slots = 1 : i32}
+    // CHECK-NEXT: %[[SLACK:.*]] = "handshake.buffer"(%[[FORK]]#1) {control = true, sequential = false, slots = 2 : i32}
+    // CHECK-NEXT: "handshake.join"(%[[SEQ1]], %[[SLACK]])
+    %0:2 = "handshake.fork"(%arg0) {control = true} : (none) -> (none, none)
+    %1 = "handshake.buffer"(%0#0) {control = true, sequential = true, slots = 1 : i32} : (none) -> none
+    %2 = "handshake.buffer"(%1) {control = true, sequential = true, slots = 1 : i32} : (none) -> none
+    %3 = "handshake.join"(%2, %0#1) {control = true} : (none, none) -> none
+    handshake.return %3 : none
+  }
+}
@@ -0,0 +1,34 @@
+// RUN: circt-opt -canonicalize-dataflow %s | FileCheck %s
+
+// CHECK-LABEL: handshake.func @fork_tree(
+// CHECK-SAME:      %[[ARG0:.*]]: index, %[[ARG1:.*]]: none, ...) -> (index, index, index, none) {
+// CHECK-NEXT:    %[[FORK:.*]]:3 = "handshake.fork"(%[[ARG0]]) {control = false} : (index) -> (index, index, index)
+// CHECK-NEXT:    handshake.return %[[FORK]]#0, %[[FORK]]#1, %[[FORK]]#2, %[[ARG1]] : index, index, index, none
+handshake.func @fork_tree(%arg0: index, %arg1: none, ...) -> (index, index, index, none) {
+  %0:3 = "handshake.fork"(%arg0) {control = false} : (index) -> (index, index, index)
+  %1:2 = "handshake.fork"(%0#1) {control = false} : (index) -> (index, index)
+  "handshake.sink"(%0#2) : (index) -> ()
+  handshake.return %0#0, %1#0, %1#1, %arg1 : index, index, index, none
+}
+
+// CHECK-LABEL: handshake.func @single_use(
+// CHECK-SAME:      %[[ARG0:.*]]: index, %[[ARG1:.*]]: none, ...) -> (index, none) {
+// CHECK-NEXT:    handshake.return %[[ARG0]], %[[ARG1]] : index, none
+handshake.func @single_use(%arg0: index, %arg1: none, ...) -> (index, none) {
+  %0:3 = "handshake.fork"(%arg0) {control = false} : (index) -> (index, index, index)
+  %1:2 = "handshake.fork"(%0#2) {control = false} : (index) -> (index, index)
+  "handshake.sink"(%0#0) : (index) -> ()
+  "handshake.sink"(%1#1) : (index) -> ()
+  handshake.return %1#0, %arg1 : index, none
+}
+
+// CHECK-LABEL: handshake.func @sunk_fork(
+// CHECK-SAME:      %[[ARG0:.*]]: index, %[[ARG1:.*]]: none, ...) -> none {
+// CHECK-NEXT:    "handshake.sink"(%[[ARG0]]) : (index) -> ()
+// CHECK-NEXT:    handshake.return %[[ARG1]] : none
+handshake.func @sunk_fork(%arg0: index, %arg1: none, ...) -> none {
+  %0:2 = "handshake.fork"(%arg0) {control = false} : (index) -> (index, index)
+  "handshake.sink"(%0#0) : (index) -> ()
+  "handshake.sink"(%0#1) : (index) -> ()
+  handshake.return %arg1 : none
+}
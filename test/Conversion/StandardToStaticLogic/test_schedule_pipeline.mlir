@@ -0,0 +1,44 @@
+// RUN: circt-opt -create-pipeline -schedule-pipeline %s | FileCheck %s
+
+// CHECK-LABEL: func @chain(
+// CHECK:         "staticlogic.pipeline"(%{{.*}}, %{{.*}}, %{{.*}}) ( {
+// CHECK:         ^bb0(%[[A:.*]]: index, %[[B:.*]]: index, %[[C:.*]]: index):
+// CHECK:           %c1 = constant 1 : index
+// CHECK:           %[[ADD:.*]] = addi %[[A]], %[[B]] : index
+// CHECK:           br ^bb1(%[[ADD]], %[[C]] : index, index)
+// CHECK:         ^bb1(%[[ADD_REG:.*]]: index, %[[C_REG:.*]]: index):
+// CHECK:           %[[MUL:.*]] = muli %[[ADD_REG]], %[[C_REG]] : index
+// CHECK:           br ^bb2(%[[MUL]] : index)
+// CHECK:         ^bb2(%[[MUL_REG:.*]]: index):
+// CHECK:           %[[SUB:.*]] = subi %[[MUL_REG]], %c1 : index
+// CHECK:           br ^bb3(%[[SUB]] : index)
+// CHECK:         ^bb3(%[[SUB_REG:.*]]: index):
+// CHECK:           "staticlogic.return"(%[[SUB_REG]]) : (index) -> ()
+// CHECK:         }) : (index, index, index) -> index
+func @chain(%a: index, %b: index, %c: index) -> index {
+  %c1 = constant 1 : index
+  %0 = addi %a, %b : index
+  %1 = muli %0, %c : index
+  %2 = subi %1, %c1 : index
+  return %2 : index
+}
+
+// Operations whose results are unused still end before the return.
+// CHECK-LABEL: func @unused(
+// CHECK:         ^bb0(%[[A:.*]]: index, %[[B:.*]]: index):
+// CHECK:           %[[ADD:.*]] = addi %[[A]], %[[B]] : index
+// CHECK:           br ^bb1(%[[ADD]] : index)
+// CHECK:         ^bb1(%[[ADD_REG1:.*]]: index):
+// CHECK:           %[[MUL:.*]] = muli %[[ADD_REG1]], %[[ADD_REG1]] : index
+// CHECK:           br ^bb2(%[[ADD_REG1]], %[[MUL]] : index, index)
+// CHECK:         ^bb2(%[[ADD_REG2:.*]]: index, %[[MUL_REG:.*]]: index):
+// CHECK:           muli %[[MUL_REG]], %[[MUL_REG]] : index
+// CHECK:           br ^bb3(%[[ADD_REG2]] : index)
+// CHECK:         ^bb3(%[[ADD_REG3:.*]]: index):
+// CHECK:           "staticlogic.return"(%[[ADD_REG3]]) : (index) -> ()
+func @unused(%a: index, %b: index) -> index {
+  %0 = addi %a, %b : index
+  %1 = muli %0, %0 : index
+  %2 = muli %1, %1 : index
+  return %0 : index
+}
@@ -1,4 +1,5 @@
 // RUN: circt-opt -pass-pipeline='calyx.program(calyx.component(calyx-compile-control))' %s | FileCheck %s
+// RUN: circt-opt -pass-pipeline='calyx.program(calyx.component(calyx-compile-control{fsm-encoding=one-hot}))' %s | FileCheck %s --check-prefix=ONEHOT
 
 calyx.program {
   calyx.component @Z(%go : i1, %reset : i1, %clk : i1) -> (%flag :i1, %done: i1) {
@@ -6,7 +7,25 @@ calyx.program {
     calyx.control {}
   }
 
+  // ONEHOT-LABEL: calyx.component @main
   calyx.component @main(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    // ONEHOT: %fsm.in, %fsm.write_en, %fsm.clk, %fsm.reset, %fsm.out, %fsm.done = calyx.register "fsm" : i2
+    // ONEHOT: %[[ONEHOT_GROUP_A_FSM_BEGIN:.+]] = hw.constant 0 : i2
+    // ONEHOT: %[[ONEHOT_IS_GROUP_A_STATE:.+]] = comb.icmp eq %fsm.out, %[[ONEHOT_GROUP_A_FSM_BEGIN]] : i2
+    // ONEHOT: calyx.group @A {
+    // ONEHOT: %[[ONEHOT_IS_GROUP_B_STATE:.+]] = comb.extract %fsm.out from 0 : (i2) -> i1
+    // ONEHOT: calyx.group @B {
+    // ONEHOT: %[[ONEHOT_FSM_STEP_1:.+]] = hw.constant 1 : i2
+    // ONEHOT: %[[ONEHOT_FSM_STEP_2:.+]] = hw.constant -2 : i2
+    // ONEHOT: %[[ONEHOT_IS_FINAL_STATE:.+]] = comb.extract %fsm.out from 1 : (i2) -> i1
+    // ONEHOT-LABEL: calyx.group @seq {
+    // ONEHOT-NEXT:    calyx.assign %fsm.in = %[[ONEHOT_FSM_STEP_1]], {{.+}} ? : i2
+    // ONEHOT-NEXT:    calyx.assign %fsm.write_en = {{.+}} ? : i1
+    // ONEHOT-NEXT:    calyx.assign %fsm.in = %[[ONEHOT_FSM_STEP_2]], {{.+}} ? : i2
+    // ONEHOT-NEXT:    calyx.assign %fsm.write_en = {{.+}} ? : i1
+    // ONEHOT-NEXT:    calyx.group_done {{.+}}, %[[ONEHOT_IS_FINAL_STATE]] ? : i1
+    // ONEHOT: calyx.assign %fsm.in = {{.+}}, %[[ONEHOT_IS_FINAL_STATE]] ? : i2
+
     // CHECK:  %fsm.in, %fsm.write_en, %fsm.clk, %fsm.reset, %fsm.out, %fsm.done = calyx.register "fsm" : i2
     %z.go, %z.reset, %z.clk, %z.flag, %z.done = calyx.instance "z" @Z : i1, i1, i1, i1, i1
     calyx.wires {
@@ -63,4 +82,297 @@ calyx.program {
       }
     }
   }
+
+  // CHECK-LABEL: calyx.component @ParTest
+  calyx.component @ParTest(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    // CHECK:  %pd_B.in, %pd_B.write_en, %pd_B.clk, %pd_B.reset, %pd_B.out, %pd_B.done = calyx.register "pd_B" : i1
+    // CHECK:  %pd_A.in, %pd_A.write_en, %pd_A.clk, %pd_A.reset, %pd_A.out, %pd_A.done = calyx.register "pd_A" : i1
+    %z.go, %z.reset, %z.clk, %z.flag, %z.done = calyx.instance "z" @Z : i1, i1, i1, i1, i1
+    %y.go, %y.reset, %y.clk, %y.flag, %y.done = calyx.instance "y" @Z : i1, i1, i1, i1, i1
+    calyx.wires {
+      %undef = calyx.undef : i1
+      // CHECK: %[[SIGNAL_ON:.+]] = hw.constant true
+      // CHECK: %[[A_NOT_RECORDED:.+]] = comb.xor %pd_A.out, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[A_NOT_DONE:.+]] = comb.xor %z.done, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[A_GO_GUARD:.+]] = comb.and %[[A_NOT_RECORDED]], %[[A_NOT_DONE]] : i1
+      // CHECK: calyx.group @A {
+      // CHECK-NEXT: %A.go = calyx.group_go %[[SIGNAL_ON]], %[[A_GO_GUARD]] ? : i1
+      calyx.group @A {
+        %A.go = calyx.group_go %undef : i1
+        calyx.assign %z.go = %go, %A.go ? : i1
+        calyx.group_done %z.done : i1
+      }
+      // CHECK: %[[B_NOT_RECORDED:.+]] = comb.xor %pd_B.out, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[B_NOT_DONE:.+]] = comb.xor %y.done, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[B_GO_GUARD:.+]] = comb.and %[[B_NOT_RECORDED]], %[[B_NOT_DONE]] : i1
+      // CHECK: calyx.group @B {
+      // CHECK-NEXT: %B.go = calyx.group_go %[[SIGNAL_ON]], %[[B_GO_GUARD]] ? : i1
+      calyx.group @B {
+        %B.go = calyx.group_go %undef : i1
+        calyx.assign %y.go = %go, %B.go ? : i1
+        calyx.group_done %y.done : i1
+      }
+
+      // CHECK: %[[PAR_DONE:.+]] = comb.and %pd_A.out, %pd_B.out : i1
+      // CHECK-LABEL: calyx.group @par {
+      // CHECK-NEXT:    calyx.assign %pd_A.in = %[[SIGNAL_ON]], %z.done ? : i1
+      // CHECK-NEXT:    calyx.assign %pd_A.write_en = %[[SIGNAL_ON]], %z.done ? : i1
+      // CHECK-NEXT:    calyx.assign %pd_B.in = %[[SIGNAL_ON]], %y.done ? : i1
+      // CHECK-NEXT:    calyx.assign %pd_B.write_en = %[[SIGNAL_ON]], %y.done ? : i1
+      // CHECK-NEXT:    calyx.group_done %[[SIGNAL_ON]], %[[PAR_DONE]] ? : i1
+
+      // CHECK: %[[SIGNAL_OFF:.+]] = hw.constant false
+      // CHECK: calyx.assign %pd_A.in = %[[SIGNAL_OFF]], %[[PAR_DONE]] ? : i1
+      // CHECK: calyx.assign %pd_A.write_en = %[[SIGNAL_ON]], %[[PAR_DONE]] ? : i1
+      // CHECK: calyx.assign %pd_B.in = %[[SIGNAL_OFF]], %[[PAR_DONE]] ? : i1
+      // CHECK: calyx.assign %pd_B.write_en = %[[SIGNAL_ON]], %[[PAR_DONE]] ? : i1
+    }
+
+    // CHECK-LABEL: calyx.control {
+    // CHECK-NEXT:    calyx.enable @par {compiledGroups = [@A, @B]}
+    // CHECK-NEXT:  }
+    calyx.control {
+      calyx.par {
+        calyx.enable @A
+        calyx.enable @B
+      }
+    }
+  }
+
+  // CHECK-LABEL: calyx.component @NestedTest
+  calyx.component @NestedTest(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    %z.go, %z.reset, %z.clk, %z.flag, %z.done = calyx.instance "z" @Z : i1, i1, i1, i1, i1
+    %y.go, %y.reset, %y.clk, %y.flag, %y.done = calyx.instance "y" @Z : i1, i1, i1, i1, i1
+    calyx.wires {
+      %undef = calyx.undef : i1
+      calyx.group @A {
+        %A.go = calyx.group_go %undef : i1
+        calyx.assign %z.go = %go, %A.go ? : i1
+        calyx.group_done %z.done : i1
+      }
+      calyx.group @B {
+        %B.go = calyx.group_go %undef : i1
+        calyx.assign %z.go = %go, %B.go ? : i1
+        calyx.group_done %z.done : i1
+      }
+      calyx.group @C {
+        %C.go = calyx.group_go %undef : i1
+        calyx.assign %y.go = %go, %C.go ? : i1
+        calyx.group_done %y.done : i1
+      }
+
+      // The groups run by the Seq group are also guarded by its go signal, so
+      // they are moved after it is defined.
+      // CHECK-LABEL: calyx.group @C {
+      // CHECK: %[[SEQ_NOT_RECORDED:.+]] = comb.xor %pd_seq.out, %{{.+}} : i1
+      // CHECK: %[[SEQ_GO_GUARD:.+]] = comb.and %[[SEQ_NOT_RECORDED]], %{{.+}} : i1
+      // CHECK: %[[A_GO_GUARD:.+]] = comb.and %{{.+}}, %[[SEQ_GO_GUARD]] : i1
+      // CHECK-NEXT: calyx.group @A {
+      // CHECK-NEXT:   %A.go = calyx.group_go %{{.+}}, %[[A_GO_GUARD]] ? : i1
+      // CHECK: %[[B_GO_GUARD:.+]] = comb.and %{{.+}}, %[[SEQ_GO_GUARD]] : i1
+      // CHECK-NEXT: calyx.group @B {
+      // CHECK-NEXT:   %B.go = calyx.group_go %{{.+}}, %[[B_GO_GUARD]] ? : i1
+      // CHECK: calyx.group @seq {
+      // CHECK-NEXT:   %seq.go = calyx.group_go %{{.+}}, %[[SEQ_GO_GUARD]] ? : i1
+      // CHECK-NEXT:   %{{.+}} = comb.and %{{.+}}, %seq.go : i1
+      // CHECK: calyx.group @par {
+    }
+
+    // CHECK-LABEL: calyx.control {
+    // CHECK-NEXT:    calyx.enable @par {compiledGroups = [@seq, @C]}
+    // CHECK-NEXT:  }
+    calyx.control {
+      calyx.par {
+        calyx.seq {
+          calyx.enable @A
+          calyx.enable @B
+        }
+        calyx.enable @C
+      }
+    }
+  }
+
+  // CHECK-LABEL: calyx.component @IfTest
+  calyx.component @IfTest(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    // CHECK:  %cond_stored.in, %cond_stored.write_en, %cond_stored.clk, %cond_stored.reset, %cond_stored.out, %cond_stored.done = calyx.register "cond_stored" : i1
+    // CHECK:  %cond_computed.in, %cond_computed.write_en, %cond_computed.clk, %cond_computed.reset, %cond_computed.out, %cond_computed.done = calyx.register "cond_computed" : i1
+    %z.go, %z.reset, %z.clk, %z.flag, %z.done = calyx.instance "z" @Z : i1, i1, i1, i1, i1
+    %y.go, %y.reset, %y.clk, %y.flag, %y.done = calyx.instance "y" @Z : i1, i1, i1, i1, i1
+    calyx.wires {
+      %undef = calyx.undef : i1
+      // CHECK: %[[SIGNAL_ON:.+]] = hw.constant true
+      // CHECK: %[[NOT_COMPUTED:.+]] = comb.xor %cond_computed.out, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[COND_NOT_DONE:.+]] = comb.xor %z.done, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[COND_GO_GUARD:.+]] = comb.and %[[NOT_COMPUTED]], %[[COND_NOT_DONE]] : i1
+      // CHECK: %[[COND_DONE_GUARD:.+]] = comb.and %[[NOT_COMPUTED]], %z.done : i1
+      // CHECK: calyx.group @Cond {
+      // CHECK-NEXT: %Cond.go = calyx.group_go %[[SIGNAL_ON]], %[[COND_GO_GUARD]] ? : i1
+      calyx.group @Cond {
+        %Cond.go = calyx.group_go %undef : i1
+        calyx.assign %z.go = %go, %Cond.go ? : i1
+        calyx.group_done %z.done : i1
+      }
+      // CHECK: %[[IS_THEN:.+]] = comb.and %cond_computed.out, %cond_stored.out : i1
+      // CHECK: %[[THEN_NOT_DONE:.+]] = comb.xor %y.done, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[THEN_GO_GUARD:.+]] = comb.and %[[IS_THEN]], %[[THEN_NOT_DONE]] : i1
+      // CHECK: calyx.group @A {
+      // CHECK-NEXT: %A.go = calyx.group_go %[[SIGNAL_ON]], %[[THEN_GO_GUARD]] ? : i1
+      calyx.group @A {
+        %A.go = calyx.group_go %undef : i1
+        calyx.assign %y.go = %go, %A.go ? : i1
+        calyx.group_done %y.done : i1
+      }
+      // CHECK: %[[NOT_STORED:.+]] = comb.xor %cond_stored.out, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[IS_ELSE:.+]] = comb.and %cond_computed.out, %[[NOT_STORED]] : i1
+      // CHECK: %[[ELSE_NOT_DONE:.+]] = comb.xor %y.flag, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[ELSE_GO_GUARD:.+]] = comb.and %[[IS_ELSE]], %[[ELSE_NOT_DONE]] : i1
+      // CHECK: calyx.group @B {
+      // CHECK-NEXT: %B.go = calyx.group_go %[[SIGNAL_ON]], %[[ELSE_GO_GUARD]] ? : i1
+      calyx.group @B {
+        %B.go = calyx.group_go %undef : i1
+        calyx.assign %y.go = %go, %B.go ? : i1
+        calyx.group_done %y.flag : i1
+      }
+
+      // CHECK: %[[THEN_TAKEN:.+]] = comb.and %cond_stored.out, %y.done : i1
+      // CHECK: %[[ELSE_TAKEN:.+]] = comb.and %[[NOT_STORED]], %y.flag : i1
+      // CHECK: %[[BRANCH_DONE:.+]] = comb.or %[[THEN_TAKEN]], %[[ELSE_TAKEN]] : i1
+      // CHECK: %[[IF_DONE:.+]] = comb.and %cond_computed.out, %[[BRANCH_DONE]] : i1
+      // CHECK-LABEL: calyx.group @if {
+      // CHECK-NEXT:    calyx.assign %cond_computed.in = %[[SIGNAL_ON]], %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_computed.write_en = %[[SIGNAL_ON]], %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_stored.in = %z.flag, %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_stored.write_en = %[[SIGNAL_ON]], %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.group_done %[[SIGNAL_ON]], %[[IF_DONE]] ? : i1
+
+      // CHECK: %[[SIGNAL_OFF:.+]] = hw.constant false
+      // CHECK: calyx.assign %cond_computed.in = %[[SIGNAL_OFF]], %[[IF_DONE]] ? : i1
+      // CHECK: calyx.assign %cond_computed.write_en = %[[SIGNAL_ON]], %[[IF_DONE]] ? : i1
+    }
+
+    // CHECK-LABEL: calyx.control {
+    // CHECK-NEXT:    calyx.enable @if {compiledGroups = [@Cond, @A, @B]}
+    // CHECK-NEXT:  }
+    calyx.control {
+      calyx.if %z.flag with @Cond {
+        calyx.enable @A
+      } else {
+        calyx.enable @B
+      }
+    }
+  }
+
+  // CHECK-LABEL: calyx.component @WhileTest
+  calyx.component @WhileTest(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    %z.go, %z.reset, %z.clk, %z.flag, %z.done = calyx.instance "z" @Z : i1, i1, i1, i1, i1
+    %y.go, %y.reset, %y.clk, %y.flag, %y.done = calyx.instance "y" @Z : i1, i1, i1, i1, i1
+    calyx.wires {
+      %undef = calyx.undef : i1
+      // CHECK: %[[SIGNAL_ON:.+]] = hw.constant true
+      // CHECK: %[[SIGNAL_OFF:.+]] = hw.constant false
+      // CHECK: %[[NOT_COMPUTED:.+]] = comb.xor %cond_computed.out, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[COND_DONE_GUARD:.+]] = comb.and %[[NOT_COMPUTED]], %z.done : i1
+      // CHECK: calyx.group @Cond {
+      calyx.group @Cond {
+        %Cond.go = calyx.group_go %undef : i1
+        calyx.assign %z.go = %go, %Cond.go ? : i1
+        calyx.group_done %z.done : i1
+      }
+      // CHECK: %[[IS_BODY:.+]] = comb.and %cond_computed.out, %cond_stored.out : i1
+      // CHECK: %[[BODY_NOT_DONE:.+]] = comb.xor %y.done, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[BODY_GO_GUARD:.+]] = comb.and %[[IS_BODY]], %[[BODY_NOT_DONE]] : i1
+      // CHECK: calyx.group @A {
+      // CHECK-NEXT: %A.go = calyx.group_go %[[SIGNAL_ON]], %[[BODY_GO_GUARD]] ? : i1
+      calyx.group @A {
+        %A.go = calyx.group_go %undef : i1
+        calyx.assign %y.go = %go, %A.go ? : i1
+        calyx.group_done %y.done : i1
+      }
+
+      // CHECK: %[[BODY_DONE_GUARD:.+]] = comb.and %[[IS_BODY]], %y.done : i1
+      // CHECK: %[[NOT_STORED:.+]] = comb.xor %cond_stored.out, %[[SIGNAL_ON]] : i1
+      // CHECK: %[[WHILE_DONE:.+]] = comb.and %cond_computed.out, %[[NOT_STORED]] : i1
+      // CHECK-LABEL: calyx.group @while {
+      // CHECK-NEXT:    calyx.assign %cond_computed.in = %[[SIGNAL_ON]], %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_computed.write_en = %[[SIGNAL_ON]], %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_stored.in = %z.flag, %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_stored.write_en = %[[SIGNAL_ON]], %[[COND_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_computed.in = %[[SIGNAL_OFF]], %[[BODY_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.assign %cond_computed.write_en = %[[SIGNAL_ON]], %[[BODY_DONE_GUARD]] ? : i1
+      // CHECK-NEXT:    calyx.group_done %[[SIGNAL_ON]], %[[WHILE_DONE]] ? : i1
+
+      // CHECK: calyx.assign %cond_computed.in = %[[SIGNAL_OFF]], %[[WHILE_DONE]] ? : i1
+      // CHECK: calyx.assign %cond_computed.write_en = %[[SIGNAL_ON]], %[[WHILE_DONE]] ? : i1
+    }
+
+    // CHECK-LABEL: calyx.control {
+    // CHECK-NEXT:    calyx.enable @while {compiledGroups = [@Cond, @A]}
+    // CHECK-NEXT:  }
+    calyx.control {
+      calyx.while %z.flag with @Cond {
+        calyx.enable @A
+      }
+    }
+  }
+
+  // CHECK-LABEL: calyx.component @StaticSeqTest
+  calyx.component @StaticSeqTest(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    // CHECK:  %counter.in, %counter.write_en, %counter.clk, %counter.reset, %counter.out, %counter.done = calyx.register "counter" : i2
+    %r.in, %r.write_en, %r.clk, %r.reset, %r.out, %r.done = calyx.register "r" : i8, i1, i1, i1, i8, i1
+    %z.go, %z.reset, %z.clk, %z.flag, %z.done = calyx.instance "z" @Z : i1, i1, i1, i1, i1
+    calyx.wires {
+      %undef = calyx.undef : i1
+      %c1_i1 = hw.constant true
+      %c1_i8 = hw.constant 1 : i8
+      // CHECK: %[[SIGNAL_ON:.+]] = hw.constant true
+      // CHECK: %[[A_START:.+]] = hw.constant 0 : i2
+      // CHECK: %[[A_GO_GUARD:.+]] = comb.icmp eq %counter.out, %[[A_START]] : i2
+      // CHECK: calyx.group @A {
+      // CHECK-NEXT: %A.go = calyx.group_go %[[SIGNAL_ON]], %[[A_GO_GUARD]] ? : i1
+      calyx.group @A {
+        %A.go = calyx.group_go %undef : i1
+        calyx.assign %r.in = %c1_i8, %A.go ? : i8
+        calyx.assign %r.write_en = %c1_i1, %A.go ? : i1
+        calyx.group_done %r.done : i1
+      } {static = 1 : i64}
+
+      // CHECK: %[[B_START:.+]] = hw.constant 1 : i2
+      // CHECK: %[[B_END:.+]] = hw.constant -1 : i2
+      // CHECK: %[[B_STARTED:.+]] = comb.icmp uge %counter.out, %[[B_START]] : i2
+      // CHECK: %[[B_NOT_ENDED:.+]] = comb.icmp ult %counter.out, %[[B_END]] : i2
+      // CHECK: %[[B_GO_GUARD:.+]] = comb.and %[[B_STARTED]], %[[B_NOT_ENDED]] : i1
+      // CHECK: calyx.group @B {
+      // CHECK-NEXT: %B.go = calyx.group_go %[[SIGNAL_ON]], %[[B_GO_GUARD]] ? : i1
+      calyx.group @B {
+        %B.go = calyx.group_go %undef : i1
+        calyx.assign %z.go = %go, %B.go ? : i1
+        calyx.group_done %z.done : i1
+      } {static = 2 : i64}
+
+      // CHECK: %[[FINAL_CYCLE:.+]] = hw.constant -1 : i2
+      // CHECK: %[[SEQ_DONE:.+]] = comb.icmp eq %counter.out, %[[FINAL_CYCLE]] : i2
+      // CHECK: %[[SEQ_NOT_DONE:.+]] = comb.xor %[[SEQ_DONE]], %[[SIGNAL_ON]] : i1
+      // CHECK: %[[STEP:.+]] = hw.constant 1 : i2
+      // CHECK: %[[NEXT_CYCLE:.+]] = comb.add %counter.out, %[[STEP]] : i2
+      // CHECK-LABEL: calyx.group @seq {
+      // CHECK-NEXT:    calyx.assign %counter.in = %[[NEXT_CYCLE]], %[[SEQ_NOT_DONE]] ? : i2
+      // CHECK-NEXT:    calyx.assign %counter.write_en = %[[SIGNAL_ON]], %[[SEQ_NOT_DONE]] ? : i1
+      // CHECK-NEXT:    calyx.group_done %[[SIGNAL_ON]], %[[SEQ_DONE]] ? : i1
+      // CHECK-NEXT:  } {static = 3 : i64}
+
+      // CHECK: %[[COUNTER_RESET:.+]] = hw.constant 0 : i2
+      // CHECK: calyx.assign %counter.in = %[[COUNTER_RESET]], %[[SEQ_DONE]] ? : i2
+      // CHECK: calyx.assign %counter.write_en = %[[SIGNAL_ON]], %[[SEQ_DONE]] ? : i1
+    }
+
+    // CHECK-LABEL: calyx.control {
+    // CHECK-NEXT:    calyx.enable @seq {compiledGroups = [@A, @B]}
+    // CHECK-NEXT:  }
+    calyx.control {
+      calyx.seq {
+        calyx.enable @A
+        calyx.enable @B
+      }
+    }
+  }
 }
@@ -0,0 +1,70 @@
+// RUN: circt-opt -pass-pipeline='calyx.program(calyx.component(calyx-infer-static-latency))' %s | FileCheck %s
+
+calyx.program {
+  calyx.component @Z(%go : i1, %reset : i1, %clk : i1) -> (%flag :i1, %done: i1) {
+    calyx.wires {}
+    calyx.control {}
+  }
+
+  // CHECK-LABEL: calyx.component @main
+  calyx.component @main(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    %r.in, %r.write_en, %r.clk, %r.reset, %r.out, %r.done = calyx.register "r" : i8, i1, i1, i1, i8, i1
+    %z.go, %z.reset, %z.clk, %z.flag, %z.done = calyx.instance "z" @Z : i1, i1, i1, i1, i1
+    calyx.wires {
+      %c1_i1 = hw.constant true
+      %c1_i8 = hw.constant 1 : i8
+
+      // A group writing a register is done in a single cycle.
+      // CHECK-LABEL: calyx.group @Write {
+      // CHECK:       } {static = 1 : i64}
+      calyx.group @Write {
+        calyx.assign %r.in = %c1_i8 : i8
+        calyx.assign %r.write_en = %c1_i1 : i1
+        calyx.group_done %r.done : i1
+      }
+
+      // The go signal of the group is allowed to guard the write.
+      // CHECK-LABEL: calyx.group @WriteWithGo {
+      // CHECK:       } {static = 1 : i64}
+      calyx.group @WriteWithGo {
+        %WriteWithGo.go = calyx.group_go %c1_i1 : i1
+        calyx.assign %r.in = %c1_i8, %WriteWithGo.go ? : i8
+        calyx.assign %r.write_en = %c1_i1, %WriteWithGo.go ? : i1
+        calyx.group_done %r.done : i1
+      }
+
+      // CHECK-LABEL: calyx.group @ConditionalWrite {
+      // CHECK-NOT:   static
+      // CHECK:       calyx.group @Instance {
+      calyx.group @ConditionalWrite {
+        calyx.assign %r.in = %c1_i8 : i8
+        calyx.assign %r.write_en = %c1_i1, %z.flag ? : i1
+        calyx.group_done %r.done : i1
+      }
+
+      // CHECK-NOT:   static
+      // CHECK:       calyx.group @GuardedDone {
+      calyx.group @Instance {
+        calyx.assign %z.go = %go : i1
+        calyx.group_done %z.done : i1
+      }
+
+      // CHECK-NOT:   static
+      // CHECK-LABEL: calyx.control
+      calyx.group @GuardedDone {
+        calyx.assign %r.in = %c1_i8 : i8
+        calyx.assign %r.write_en = %c1_i1 : i1
+        calyx.group_done %r.done, %z.flag ? : i1
+      }
+    }
+    calyx.control {
+      calyx.seq {
+        calyx.enable @Write
+        calyx.enable @WriteWithGo
+        calyx.enable @ConditionalWrite
+        calyx.enable @Instance
+        calyx.enable @GuardedDone
+      }
+    }
+  }
+}
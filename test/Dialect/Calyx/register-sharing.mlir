@@ -0,0 +1,92 @@
+// RUN: circt-opt -pass-pipeline='calyx.program(calyx.component(calyx-register-sharing))' %s | FileCheck %s
+
+calyx.program {
+  // CHECK-LABEL: calyx.component @main
+  calyx.component @main(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    // CHECK:      calyx.register "r0"
+    // CHECK-NEXT: calyx.register "r1"
+    // CHECK-NEXT: calyx.register "acc"
+    // CHECK-NOT:  calyx.register
+    %r0.in, %r0.write_en, %r0.clk, %r0.reset, %r0.out, %r0.done = calyx.register "r0" : i8, i1, i1, i1, i8, i1
+    %r1.in, %r1.write_en, %r1.clk, %r1.reset, %r1.out, %r1.done = calyx.register "r1" : i8, i1, i1, i1, i8, i1
+    %r2.in, %r2.write_en, %r2.clk, %r2.reset, %r2.out, %r2.done = calyx.register "r2" : i8, i1, i1, i1, i8, i1
+    %r3.in, %r3.write_en, %r3.clk, %r3.reset, %r3.out, %r3.done = calyx.register "r3" : i8, i1, i1, i1, i8, i1
+    %p0.in, %p0.write_en, %p0.clk, %p0.reset, %p0.out, %p0.done = calyx.register "p0" : i8, i1, i1, i1, i8, i1
+    %p1.in, %p1.write_en, %p1.clk, %p1.reset, %p1.out, %p1.done = calyx.register "p1" : i8, i1, i1, i1, i8, i1
+    %acc.in, %acc.write_en, %acc.clk, %acc.reset, %acc.out, %acc.done = calyx.register "acc" : i8, i1, i1, i1, i8, i1
+    calyx.wires {
+      %c1_i1 = hw.constant true
+      %c0_i8 = hw.constant 0 : i8
+
+      // The accumulator is read before it is written, so it keeps its value
+      // across executions of the component and is not shared.
+      calyx.group @Accumulate {
+        calyx.assign %acc.in = %acc.out : i8
+        calyx.assign %acc.write_en = %c1_i1 : i1
+        calyx.group_done %acc.done : i1
+      }
+      calyx.group @G0 {
+        calyx.assign %r0.in = %c0_i8 : i8
+        calyx.assign %r0.write_en = %c1_i1 : i1
+        calyx.group_done %r0.done : i1
+      }
+      calyx.group @G1 {
+        calyx.assign %r1.in = %r0.out : i8
+        calyx.assign %r1.write_en = %c1_i1 : i1
+        calyx.group_done %r1.done : i1
+      }
+
+      // r0 is no longer live, so r2 shares it.
+      // CHECK-LABEL: calyx.group @G2 {
+      // CHECK-NEXT:    calyx.assign %r0.in = %r1.out : i8
+      // CHECK-NEXT:    calyx.assign %r0.write_en = %{{.+}} : i1
+      // CHECK-NEXT:    calyx.group_done %r0.done : i1
+      calyx.group @G2 {
+        calyx.assign %r2.in = %r1.out : i8
+        calyx.assign %r2.write_en = %c1_i1 : i1
+        calyx.group_done %r2.done : i1
+      }
+
+      // r1 is no longer live, so r3 shares it.
+      // CHECK-LABEL: calyx.group @G3 {
+      // CHECK-NEXT:    calyx.assign %r1.in = %r0.out : i8
+      // CHECK-NEXT:    calyx.assign %r1.write_en = %{{.+}} : i1
+      // CHECK-NEXT:    calyx.group_done %r1.done : i1
+      calyx.group @G3 {
+        calyx.assign %r3.in = %r2.out : i8
+        calyx.assign %r3.write_en = %c1_i1 : i1
+        calyx.group_done %r3.done : i1
+      }
+
+      // The registers of groups running in parallel are not shared with each
+      // other.
+      // CHECK-LABEL: calyx.group @P0 {
+      // CHECK-NEXT:    calyx.assign %r0.in = %{{.+}} : i8
+      calyx.group @P0 {
+        calyx.assign %p0.in = %c0_i8 : i8
+        calyx.assign %p0.write_en = %c1_i1 : i1
+        calyx.group_done %p0.done : i1
+      }
+      // CHECK-LABEL: calyx.group @P1 {
+      // CHECK-NEXT:    calyx.assign %r1.in = %{{.+}} : i8
+      calyx.group @P1 {
+        calyx.assign %p1.in = %c0_i8 : i8
+        calyx.assign %p1.write_en = %c1_i1 : i1
+        calyx.group_done %p1.done : i1
+      }
+    }
+    calyx.control {
+      calyx.seq {
+        calyx.enable @Accumulate
+        calyx.enable @G0
+        calyx.enable @G1
+        calyx.enable @G2
+        calyx.enable @G3
+        calyx.par {
+          calyx.enable @P0
+          calyx.enable @P1
+        }
+      }
+    }
+  }
+}
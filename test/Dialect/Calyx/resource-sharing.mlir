@@ -0,0 +1,92 @@
+// RUN: circt-opt -pass-pipeline='calyx.program(calyx.component(calyx-resource-sharing))' %s | FileCheck %s
+
+calyx.program {
+  calyx.component @Add(%left: i8, %right: i8, %go: i1, %clk: i1, %reset: i1) -> (%out: i8, %done: i1) {
+    calyx.wires {}
+    calyx.control {}
+  }
+
+  calyx.component @Counter(%go: i1, %clk: i1, %reset: i1) -> (%out: i8, %done: i1) {
+    %r.in, %r.write_en, %r.clk, %r.reset, %r.out, %r.done = calyx.register "r" : i8, i1, i1, i1, i8, i1
+    calyx.wires {}
+    calyx.control {}
+  }
+
+  // CHECK-LABEL: calyx.component @main
+  calyx.component @main(%go : i1, %reset : i1, %clk : i1) -> (%done: i1) {
+    // CHECK:      calyx.instance "a0" @Add
+    // CHECK-NEXT: calyx.instance "a3" @Add
+    // CHECK-NEXT: calyx.instance "c0" @Counter
+    // CHECK-NEXT: calyx.instance "c1" @Counter
+    // CHECK-NOT:  calyx.instance
+    %r.in, %r.write_en, %r.clk, %r.reset, %r.out, %r.done = calyx.register "r" : i8, i1, i1, i1, i8, i1
+    %a0.left, %a0.right, %a0.go, %a0.clk, %a0.reset, %a0.out, %a0.done = calyx.instance "a0" @Add : i8, i8, i1, i1, i1, i8, i1
+    %a1.left, %a1.right, %a1.go, %a1.clk, %a1.reset, %a1.out, %a1.done = calyx.instance "a1" @Add : i8, i8, i1, i1, i1, i8, i1
+    %a2.left, %a2.right, %a2.go, %a2.clk, %a2.reset, %a2.out, %a2.done = calyx.instance "a2" @Add : i8, i8, i1, i1, i1, i8, i1
+    %a3.left, %a3.right, %a3.go, %a3.clk, %a3.reset, %a3.out, %a3.done = calyx.instance "a3" @Add : i8, i8, i1, i1, i1, i8, i1
+    %c0.go, %c0.clk, %c0.reset, %c0.out, %c0.done = calyx.instance "c0" @Counter : i1, i1, i1, i8, i1
+    %c1.go, %c1.clk, %c1.reset, %c1.out, %c1.done = calyx.instance "c1" @Counter : i1, i1, i1, i8, i1
+    calyx.wires {
+      %c1_i1 = hw.constant true
+      calyx.group @G0 {
+        calyx.assign %a0.left = %r.out : i8
+        calyx.assign %a0.right = %r.out : i8
+        calyx.assign %r.in = %a0.out : i8
+        calyx.assign %r.write_en = %c1_i1 : i1
+        calyx.group_done %r.done : i1
+      }
+
+      // CHECK-LABEL: calyx.group @G1 {
+      // CHECK-NEXT:    calyx.assign %a0.left = %r.out : i8
+      // CHECK-NEXT:    calyx.assign %a0.right = %r.out : i8
+      // CHECK-NEXT:    calyx.assign %r.in = %a0.out : i8
+      calyx.group @G1 {
+        calyx.assign %a1.left = %r.out : i8
+        calyx.assign %a1.right = %r.out : i8
+        calyx.assign %r.in = %a1.out : i8
+        calyx.assign %r.write_en = %c1_i1 : i1
+        calyx.group_done %r.done : i1
+      }
+
+      // a2 and a3 are used in parallel, so only a2 is shared with a0.
+      // CHECK-LABEL: calyx.group @G2 {
+      // CHECK-NEXT:    calyx.assign %a0.left = %r.out : i8
+      calyx.group @G2 {
+        calyx.assign %a2.left = %r.out : i8
+        calyx.assign %a2.right = %r.out : i8
+        calyx.assign %r.in = %a2.out : i8
+        calyx.assign %r.write_en = %c1_i1 : i1
+        calyx.group_done %r.done : i1
+      }
+      // CHECK-LABEL: calyx.group @G3 {
+      // CHECK-NEXT:    calyx.assign %a3.left = %r.out : i8
+      calyx.group @G3 {
+        calyx.assign %a3.left = %r.out : i8
+        calyx.assign %a3.right = %r.out : i8
+        calyx.group_done %a3.done : i1
+      }
+
+      // Instances of components with state are not shared.
+      calyx.group @C0 {
+        calyx.assign %c0.go = %c1_i1 : i1
+        calyx.group_done %c0.done : i1
+      }
+      calyx.group @C1 {
+        calyx.assign %c1.go = %c1_i1 : i1
+        calyx.group_done %c1.done : i1
+      }
+    }
+    calyx.control {
+      calyx.seq {
+        calyx.enable @G0
+        calyx.enable @G1
+        calyx.par {
+          calyx.enable @G2
+          calyx.enable @G3
+        }
+        calyx.enable @C0
+        calyx.enable @C1
+      }
+    }
+  }
+}
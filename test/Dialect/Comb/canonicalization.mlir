@@ -778,6 +778,22 @@ hw.module @combine_icmp_compare_known_bits0(%thing: i4) -> (%a: i1) {
   // CHECK: }
 }
 
+// A bit of a mux is only known when it is known, and equal, on both sides.
+// CHECK-LABEL: hw.module @combine_icmp_compare_known_bits_mux
+hw.module @combine_icmp_compare_known_bits_mux(%c: i1, %x: i1, %y: i1) -> (%a: i1) {
+  %true = hw.constant true
+  %false = hw.constant false
+  %0 = comb.concat %x, %false : (i1, i1) -> i2
+  %1 = comb.concat %true, %y : (i1, i1) -> i2
+  %2 = comb.mux %c, %0, %1 : i2
+  %c1 = hw.constant 1 : i2
+  %3 = comb.icmp eq %2, %c1 : i2
+  hw.output %3 : i1
+
+  // CHECK: comb.icmp eq
+  // CHECK-NOT: hw.output %false
+}
+
 // CHECK-LABEL: hw.module @not_icmp
 hw.module @not_icmp(%a: i3, %b: i4, %c: i1) -> (%x: i1, %y: i1) {
   %true = hw.constant true
@@ -0,0 +1,76 @@
+// RUN: circt-opt %s --esi-analyze-channels=report=true -split-input-file -verify-diagnostics
+
+hw.module.extern @Sender(%clk: i1) -> (%x: !esi.channel<i4>)
+hw.module.extern @Reciever(%a: !esi.channel<i4>)
+
+hw.module @pipeline(%clk: i1, %rstn: i1) {
+  %chan = hw.instance "sender" @Sender(%clk) : (i1) -> !esi.channel<i4>
+  %stages = esi.buffer %clk, %rstn, %chan { stages = 4 } : i4
+  // expected-remark @+1 {{channel latency: 5 cycles, throughput: at most 1.00 tokens/cycle (0% bubbles)}}
+  %fifo = esi.buffer %clk, %rstn, %stages { impl = "fifo", depth = 64 } : i4
+  hw.instance "recv" @Reciever(%fifo) : (!esi.channel<i4>) -> ()
+}
+
+// -----
+
+hw.module @deadlock(%clk: i1, %rstn: i1) {
+  // expected-warning @+1 {{channel loop has no buffering and deadlocks}}
+  %chan, %ready = esi.wrap.vr %data, %valid : i4
+  // expected-note @+2 {{part of the loop}}
+  // expected-remark @+1 {{channel latency: 0 cycles, throughput: at most 0.00 tokens/cycle (100% bubbles)}}
+  %data, %valid = esi.unwrap.vr %chan, %ready : i4
+}
+
+// -----
+
+hw.module @combLoop(%clk: i1, %rstn: i1) {
+  // expected-warning @+1 {{channel loop has no pipeline stage, so its valid path is combinational}}
+  %chan, %ready = esi.wrap.vr %data, %valid : i4
+  // expected-note @+1 {{part of the loop}}
+  %skid = esi.buffer %clk, %rstn, %chan { impl = "skid" } : i4
+  // expected-note @+2 {{part of the loop}}
+  // expected-remark @+1 {{channel latency: 0 cycles, throughput: at most 1.00 tokens/cycle (0% bubbles)}}
+  %data, %valid = esi.unwrap.vr %skid, %ready : i4
+}
+
+// -----
+
+hw.module @underbufferedLoop(%clk: i1, %rstn: i1) {
+  %c1 = hw.constant 1 : i4
+  // expected-warning @+1 {{channel loop is underbuffered: 2 slots over 2 cycles of latency sustain at most 0.50 tokens/cycle}}
+  %chan, %ready = esi.wrap.vr %next, %valid : i4
+  // expected-note @+1 {{part of the loop}}
+  %buf = esi.buffer %clk, %rstn, %chan { impl = "elastic", depth = 1 } : i4
+  // expected-note @+2 {{part of the loop}}
+  // expected-remark @+1 {{channel latency: 2 cycles, throughput: at most 0.50 tokens/cycle (50% bubbles)}}
+  %data, %valid = esi.unwrap.vr %buf, %ready : i4
+  %next = comb.add %data, %c1 : i4
+}
+
+// -----
+
+hw.module.extern @Reciever(%a: !esi.channel<i4>)
+
+hw.module @reconvergent(%clk: i1, %rstn: i1, %in: !esi.channel<i4>) {
+  // expected-note @+2 {{the paths fork here}}
+  // expected-remark @+1 {{channel latency: 0 cycles, throughput: at most 1.00 tokens/cycle (0% bubbles)}}
+  %data, %valid = esi.unwrap.vr %in, %ready : i4
+  %ready = comb.and %longReady, %shortReady : i1
+
+  %long, %longReady = esi.wrap.vr %data, %valid : i4
+  %longBuf = esi.buffer %clk, %rstn, %long { stages = 8 } : i4
+  // expected-remark @+1 {{channel latency: 8 cycles, throughput: at most 1.00 tokens/cycle (0% bubbles)}}
+  %longData, %longValid = esi.unwrap.vr %longBuf, %joinReady : i4
+
+  %short, %shortReady = esi.wrap.vr %data, %valid : i4
+  %shortBuf = esi.buffer %clk, %rstn, %short { stages = 1 } : i4
+  // expected-remark @+1 {{channel latency: 1 cycles, throughput: at most 1.00 tokens/cycle (0% bubbles)}}
+  %shortData, %shortValid = esi.unwrap.vr %shortBuf, %joinReady : i4
+
+  %sum = comb.add %longData, %shortData : i4
+  %joinValid = comb.and %longValid, %shortValid : i1
+  // expected-warning @+2 {{reconvergent channels are underbuffered: paths of 1 to 8 cycles of latency with as few as 2 slots sustain at most 0.33 tokens/cycle}}
+  // expected-remark @+1 {{channel latency: 8 cycles, throughput: at most 0.33 tokens/cycle (67% bubbles)}}
+  %join, %joinReady = esi.wrap.vr %sum, %joinValid : i4
+  hw.instance "recv" @Reciever(%join) : (!esi.channel<i4>) -> ()
+}
@@ -1,6 +1,8 @@
 // REQUIRES: capnp
 // RUN: circt-opt %s -verify-diagnostics | circt-opt -verify-diagnostics | FileCheck %s
 // RUN: circt-opt %s --lower-esi-ports --lower-esi-to-hw -verify-diagnostics | circt-opt -verify-diagnostics | FileCheck --check-prefix=COSIM %s
+// RUN: circt-opt %s --lower-esi-ports --lower-esi-to-hw=cosim-poll-on-pending=true -verify-diagnostics | FileCheck --check-prefix=PENDING %s
+// RUN: circt-opt %s --lower-esi-ports --lower-esi-to-hw=cosim-packed=true -verify-diagnostics | FileCheck --check-prefix=PACKED %s
 // Disable the SV test : circt-opt %s --lower-esi-ports --lower-esi-to-hw | circt-translate --export-verilog | FileCheck --check-prefix=SV %s
 // RUN: circt-translate %s -export-esi-capnp -verify-diagnostics | FileCheck --check-prefix=CAPNP %s
 
@@ -42,6 +44,14 @@ hw.module @top(%clk:i1, %rstn:i1) -> () {
   // CAPNP: open @1 [S, T] (iface :EsiDpiInterfaceDesc) -> (iface :EsiDpiEndpoint(S, T));
 
   // COSIM: hw.instance "TestEP" @Cosim_Endpoint(%clk, %rstn, %{{.+}}, %{{.+}}, %{{.+}}) {parameters = {ENDPOINT_ID = 1 : i32, RECV_TYPE_ID = 10578209918096690139 : ui64, RECV_TYPE_SIZE_BITS = 128 : i32, SEND_TYPE_ID = 11229133067582987457 : ui64, SEND_TYPE_SIZE_BITS = 128 : i32}} : (i1, i1, i1, i1, !hw.array<128xi1>) -> (i1, !hw.array<128xi1>, i1)
+  // PENDING: hw.instance "TestEP" @Cosim_Endpoint(%clk, %rstn, %{{.+}}, %{{.+}}, %{{.+}}) {parameters = {ENDPOINT_ID = 1 : i32, POLL_ON_PENDING = true, RECV_TYPE_ID = 10578209918096690139 : ui64,
+
+  // PACKED: [[SEND:%.+]] = hw.bitcast %{{.+}} : (si14) -> !hw.array<14xi1>
+  // PACKED: hw.instance "TestEP" @Cosim_Endpoint(%clk, %rstn, %{{.+}}, %{{.+}}, [[SEND]]) {parameters = {ENDPOINT_ID = 1 : i32, PACKED = true, RECV_TYPE_ID = 10578209918096690139 : ui64, RECV_TYPE_SIZE_BITS = 32 : i32, SEND_TYPE_ID = 11229133067582987457 : ui64, SEND_TYPE_SIZE_BITS = 14 : i32}} : (i1, i1, i1, i1, !hw.array<14xi1>) -> (i1, !hw.array<32xi1>, i1)
+  // PACKED: hw.bitcast %{{.+}} : (!hw.array<32xi1>) -> i32
+  // PACKED: hw.instance "ArrTestEP" @Cosim_Endpoint({{.+}} -> (i1, !hw.array<256xi1>, i1)
+  // PACKED-NOT: hw.module @encode
+  // PACKED-NOT: hw.module @decode
 
   // SV: assign _T.valid = TestEP_DataOutValid;
   // SV: assign _T.data = dataSection[6'h0+:32];
@@ -111,3 +121,7 @@ hw.module @top(%clk:i1, %rstn:i1) -> () {
   // names I'm assigning since it's inlining them. More work on ExportVerilog is
   // necessary to improve it and I'll fill in the rest when this is done.
 }
+
+// Both endpoints send si14, so they share an encoder.
+// COSIM: hw.module @encodeSi14(
+// COSIM-NOT: hw.module @encodeSi14(
@@ -43,3 +43,45 @@ hw.module @test(%m : !sv.modport<@IData::@Noexist>) {
   // expected-error @+1 {{Could not find modport @IData::@Noexist in symbol table.}}
   %idataChanOut = esi.wrap.iface %m: !sv.modport<@IData::@Noexist> -> !esi.channel<i32>
 }
+
+// -----
+
+hw.module @fifoImpl(%clk: i1, %rstn: i1, %chan: !esi.channel<i4>) {
+  // expected-error @+1 {{unknown buffer implementation 'ring'}}
+  %0 = esi.buffer %clk, %rstn, %chan { impl = "ring", depth = 4 } : i4
+}
+
+// -----
+
+hw.module @fifoDepth(%clk: i1, %rstn: i1, %chan: !esi.channel<i4>) {
+  // expected-error @+1 {{'fifo' buffers require a depth}}
+  %0 = esi.buffer %clk, %rstn, %chan { impl = "fifo" } : i4
+}
+
+// -----
+
+hw.module @fifoStages(%clk: i1, %rstn: i1, %chan: !esi.channel<i4>) {
+  // expected-error @+1 {{'fifo' buffers take a depth, not a number of stages}}
+  %0 = esi.buffer %clk, %rstn, %chan { impl = "fifo", stages = 4 } : i4
+}
+
+// -----
+
+hw.module @skidDepth(%clk: i1, %rstn: i1, %chan: !esi.channel<i4>) {
+  // expected-error @+1 {{skid buffers hold a single token and take no depth or almost full options}}
+  %0 = esi.buffer %clk, %rstn, %chan { impl = "skid", depth = 2 } : i4
+}
+
+// -----
+
+hw.module @almostFull(%clk: i1, %rstn: i1, %chan: !esi.channel<i4>) {
+  // expected-error @+1 {{almost full threshold (9) exceeds the depth (8)}}
+  %0 = esi.fifo %clk, %rstn, %chan { impl = "elastic", depth = 8 : i64, almostFull = 9 : i64 } : i4
+}
+
+// -----
+
+hw.module @gearboxWidth(%clk: i1, %rstn: i1, %chan: !esi.channel<i4>) {
+  // expected-error @+1 {{input width (4) and output width (6) must be multiples of one another}}
+  %0 = esi.gearbox %clk, %rstn, %chan : i4 -> i6
+}
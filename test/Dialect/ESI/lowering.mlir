@@ -25,6 +25,11 @@ hw.module.extern @Reciever(%a: !esi.channel<i4>, %clk: i1)
 // IFACE-LABEL: hw.module.extern @ArrSender(%x: !sv.modport<@IValidReady_ArrayOf4xi64::@sink>)
 // IFACE-LABEL: hw.module.extern @Reciever(%a: !sv.modport<@IValidReady_i4::@source>, %clk: i1)
 
+// HW-LABEL: hw.module.extern @ESI_FIFO(%clk: i1, %rstn: i1, %a: none, %a_valid: i1, %x_ready: i1) -> (%a_ready: i1, %x: none, %x_valid: i1)
+// HW-LABEL: hw.module.extern @ESI_SkidBuffer(%clk: i1, %rstn: i1, %a: none, %a_valid: i1, %x_ready: i1) -> (%a_ready: i1, %x: none, %x_valid: i1)
+// HW-LABEL: hw.module.extern @ESI_ElasticBuffer(%clk: i1, %rstn: i1, %a: none, %a_valid: i1, %x_ready: i1) -> (%a_ready: i1, %x: none, %x_valid: i1, %almost_full: i1)
+// HW-LABEL: hw.module.extern @ESI_Gearbox(%clk: i1, %rstn: i1, %a: none, %a_valid: i1, %x_ready: i1) -> (%a_ready: i1, %x: none, %x_valid: i1)
+
 
 hw.module @test(%clk:i1, %rstn:i1) {
 
@@ -99,3 +104,36 @@ hw.module @twoChannelArgs(%clk: i1, %ints: !esi.channel<i32>, %foo: !esi.channel
 // HW-LABEL: hw.module @twoChannelArgs(%clk: i1, %ints: i32, %ints_valid: i1, %foo: i7, %foo_valid: i1) -> (%ints_ready: i1, %foo_ready: i1)
 // HW:   %true = hw.constant true
 // HW:   hw.output %true, %true : i1, i1
+
+hw.module @fifos(%clk:i1, %rstn:i1) {
+  %chan, %0 = hw.instance "sender" @Sender (%clk) : (i1) -> (!esi.channel<i4>, i8)
+  %fifoChan = esi.buffer %clk, %rstn, %chan { impl = "fifo", depth = 64, name = "deep" } : i4
+  %skidChan = esi.buffer %clk, %rstn, %fifoChan { impl = "skid" } : i4
+  %elasticChan = esi.buffer %clk, %rstn, %skidChan { impl = "elastic", depth = 8, almostFull = 6 } : i4
+  hw.instance "recv" @Reciever (%elasticChan, %clk) : (!esi.channel<i4>, i1) -> ()
+}
+// CHECK-LABEL: hw.module @fifos(%clk: i1, %rstn: i1) {
+// CHECK-NEXT:    %sender.x, %sender.y = hw.instance "sender" @Sender(%clk) : (i1) -> (!esi.channel<i4>, i8)
+// CHECK-NEXT:    %0 = esi.fifo %clk, %rstn, %sender.x {depth = 64 : i64, impl = "fifo", name = "deep"} : i4
+// CHECK-NEXT:    %1 = esi.fifo %clk, %rstn, %0 {impl = "skid"} : i4
+// CHECK-NEXT:    %2 = esi.fifo %clk, %rstn, %1 {almostFull = 6 : i64, depth = 8 : i64, impl = "elastic"} : i4
+// CHECK-NEXT:    hw.instance "recv" @Reciever(%2, %clk) : (!esi.channel<i4>, i1) -> ()
+// HW-LABEL: hw.module @fifos(%clk: i1, %rstn: i1) {
+// HW:         hw.instance "deep" @ESI_FIFO(%clk, %rstn, {{.+}}) {parameters = {DEPTH = 64 : ui32, WIDTH = 4 : ui32}} : (i1, i1, i4, i1, i1) -> (i1, i4, i1)
+// HW:         hw.instance "fifo" @ESI_SkidBuffer(%clk, %rstn, {{.+}}) {parameters = {WIDTH = 4 : ui32}} : (i1, i1, i4, i1, i1) -> (i1, i4, i1)
+// HW:         hw.instance "fifo" @ESI_ElasticBuffer(%clk, %rstn, {{.+}}) {parameters = {ALMOST_FULL = 6 : ui32, DEPTH = 8 : ui32, WIDTH = 4 : ui32}} : (i1, i1, i4, i1, i1) -> (i1, i4, i1, i1)
+
+hw.module @gearboxes(%clk:i1, %rstn:i1) {
+  %chan, %0 = hw.instance "sender" @Sender (%clk) : (i1) -> (!esi.channel<i4>, i8)
+  %packed = esi.gearbox %clk, %rstn, %chan : i4 -> !hw.array<4xi4>
+  %serial = esi.gearbox %clk, %rstn, %packed {name = "ser"} : !hw.array<4xi4> -> i4
+  hw.instance "recv" @Reciever (%serial, %clk) : (!esi.channel<i4>, i1) -> ()
+}
+// CHECK-LABEL: hw.module @gearboxes(%clk: i1, %rstn: i1) {
+// CHECK-NEXT:    %sender.x, %sender.y = hw.instance "sender" @Sender(%clk) : (i1) -> (!esi.channel<i4>, i8)
+// CHECK-NEXT:    %0 = esi.gearbox %clk, %rstn, %sender.x : i4 -> !hw.array<4xi4>
+// CHECK-NEXT:    %1 = esi.gearbox %clk, %rstn, %0 {name = "ser"} : !hw.array<4xi4> -> i4
+// CHECK-NEXT:    hw.instance "recv" @Reciever(%1, %clk) : (!esi.channel<i4>, i1) -> ()
+// HW-LABEL: hw.module @gearboxes(%clk: i1, %rstn: i1) {
+// HW:         %gearbox.a_ready, %gearbox.x, %gearbox.x_valid = hw.instance "gearbox" @ESI_Gearbox(%clk, %rstn, {{.+}}) {parameters = {IN_WIDTH = 4 : ui32, OUT_WIDTH = 16 : ui32}} : (i1, i1, i4, i1, i1) -> (i1, !hw.array<4xi4>, i1)
+// HW:         hw.instance "ser" @ESI_Gearbox(%clk, %rstn, %gearbox.x, %gearbox.x_valid, {{.+}}) {parameters = {IN_WIDTH = 16 : ui32, OUT_WIDTH = 4 : ui32}} : (i1, i1, !hw.array<4xi4>, i1, i1) -> (i1, i4, i1)
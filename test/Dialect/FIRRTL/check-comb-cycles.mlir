@@ -165,3 +165,34 @@ module  {
     }
   }
 }
+
+// -----
+
+module  {
+  // Combinational loop through the paths summarized for two levels of instances
+  // CHECK-NOT: firrtl.circuit "hasloops"
+  firrtl.circuit "hasloops"   {
+    firrtl.module @leaf(in %in: !firrtl.uint<1>, out %out: !firrtl.uint<1>) {
+      %w = firrtl.wire  : !firrtl.uint<1>
+      firrtl.connect %w, %in : !firrtl.uint<1>, !firrtl.uint<1>
+      firrtl.connect %out, %w : !firrtl.uint<1>, !firrtl.uint<1>
+    }
+    firrtl.module @mid(in %clk: !firrtl.clock, in %a: !firrtl.uint<1>, in %b: !firrtl.uint<1>, out %x: !firrtl.uint<1>, out %y: !firrtl.uint<1>) {
+      %leaf_in, %leaf_out = firrtl.instance @leaf  {name = "leaf"} : !firrtl.uint<1>, !firrtl.uint<1>
+      firrtl.connect %leaf_in, %a : !firrtl.uint<1>, !firrtl.uint<1>
+      firrtl.connect %x, %leaf_out : !firrtl.uint<1>, !firrtl.uint<1>
+      %r = firrtl.reg %clk  : !firrtl.uint<1>
+      firrtl.connect %r, %b : !firrtl.uint<1>, !firrtl.uint<1>
+      firrtl.connect %y, %r : !firrtl.uint<1>, !firrtl.uint<1>
+    }
+    // expected-error @+1 {{detected combinational cycle in a FIRRTL module}}
+    firrtl.module @hasloops(in %clk: !firrtl.clock, out %o: !firrtl.uint<1>) {
+      // expected-note @+1 {{this operation is part of the combinational cycle}}
+      %mid_clk, %mid_a, %mid_b, %mid_x, %mid_y = firrtl.instance @mid  {name = "mid"} : !firrtl.clock, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+      firrtl.connect %mid_clk, %clk : !firrtl.clock, !firrtl.clock
+      firrtl.connect %mid_a, %mid_x : !firrtl.uint<1>, !firrtl.uint<1>
+      firrtl.connect %mid_b, %mid_y : !firrtl.uint<1>, !firrtl.uint<1>
+      firrtl.connect %o, %mid_y : !firrtl.uint<1>, !firrtl.uint<1>
+    }
+  }
+}
@@ -0,0 +1,72 @@
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-dedup)' --split-input-file %s | FileCheck %s
+
+// Modules which only differ in the names of their operations are merged.
+// CHECK-LABEL: firrtl.circuit "Simple"
+firrtl.circuit "Simple" {
+  // CHECK: firrtl.module @A
+  firrtl.module @A(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    %x = firrtl.wire : !firrtl.uint<1>
+    firrtl.connect %x, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b, %x : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-NOT: firrtl.module @B
+  firrtl.module @B(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    %y = firrtl.wire : !firrtl.uint<1>
+    firrtl.connect %y, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b, %y : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK: firrtl.module @C
+  firrtl.module @C(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    %0 = firrtl.not %a : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    firrtl.connect %b, %0 : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-LABEL: firrtl.module @Simple
+  firrtl.module @Simple(in %a: !firrtl.uint<1>) {
+    // CHECK: firrtl.instance @A {name = "a"}
+    // CHECK: firrtl.instance @A {name = "b"}
+    // CHECK: firrtl.instance @C {name = "c"}
+    %a_a, %a_b = firrtl.instance @A {name = "a"} : !firrtl.uint<1>, !firrtl.uint<1>
+    %b_a, %b_b = firrtl.instance @B {name = "b"} : !firrtl.uint<1>, !firrtl.uint<1>
+    %c_a, %c_b = firrtl.instance @C {name = "c"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %a_a, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b_a, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c_a, %a : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
+
+// -----
+
+// Modules instantiating merged modules are merged as well, while modules with
+// different port names or with annotations are left alone.
+// CHECK-LABEL: firrtl.circuit "Nested"
+firrtl.circuit "Nested" {
+  // CHECK: firrtl.module @Leaf0
+  firrtl.module @Leaf0(in %a: !firrtl.uint<1>) {}
+  // CHECK-NOT: firrtl.module @Leaf1
+  firrtl.module @Leaf1(in %a: !firrtl.uint<1>) {}
+  // CHECK: firrtl.module @Renamed
+  firrtl.module @Renamed(in %z: !firrtl.uint<1>) {}
+  // CHECK: firrtl.module @Annotated
+  firrtl.module @Annotated(in %a: !firrtl.uint<1>) attributes {annotations = [{class = "circt.test"}]} {}
+  // CHECK: firrtl.module @Mid0
+  // CHECK-NEXT: firrtl.instance @Leaf0 {name = "leaf"}
+  firrtl.module @Mid0() {
+    %leaf_a = firrtl.instance @Leaf0 {name = "leaf"} : !firrtl.uint<1>
+  }
+  // CHECK-NOT: firrtl.module @Mid1
+  firrtl.module @Mid1() {
+    %leaf_a = firrtl.instance @Leaf1 {name = "leaf"} : !firrtl.uint<1>
+  }
+  // CHECK-LABEL: firrtl.module @Nested
+  firrtl.module @Nested() {
+    // CHECK: firrtl.instance @Mid0 {name = "mid0"}
+    // CHECK: firrtl.instance @Mid0 {name = "mid1"}
+    // CHECK: firrtl.instance @Renamed
+    // CHECK: firrtl.instance @Annotated
+    firrtl.instance @Mid0 {name = "mid0"}
+    firrtl.instance @Mid1 {name = "mid1"}
+    %renamed_z = firrtl.instance @Renamed {name = "renamed"} : !firrtl.uint<1>
+    %annotated_a = firrtl.instance @Annotated {name = "annotated"} : !firrtl.uint<1>
+    %leaf_a = firrtl.instance @Leaf0 {name = "leaf"} : !firrtl.uint<1>
+  }
+}
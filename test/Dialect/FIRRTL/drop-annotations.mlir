@@ -0,0 +1,25 @@
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-drop-annotations{keep=firrtl.transforms.DontTouchAnnotation})' %s | FileCheck %s
+
+// The annotations of the circuit, of the modules and their ports, of the
+// operations and of the ports of instances and memories are dropped, except
+// for those of the kept classes.
+// CHECK-LABEL: firrtl.circuit "Drop"
+// CHECK-NOT: annotations = [{class = "circuit"}]
+firrtl.circuit "Drop" attributes {annotations = [{class = "circuit"}]} {
+  // CHECK: firrtl.extmodule @Ext(in %a: !firrtl.uint<1>)
+  // CHECK-NOT: annotations
+  firrtl.extmodule @Ext(in %a: !firrtl.uint<1> {firrtl.annotations = [{class = "port"}]}) attributes {annotations = [{class = "module"}]}
+
+  // CHECK-LABEL: firrtl.module @Drop(in %x: !firrtl.uint<1> {firrtl.annotations = [{class = "firrtl.transforms.DontTouchAnnotation"}]}, in %y: !firrtl.uint<1>) {
+  firrtl.module @Drop(in %x: !firrtl.uint<1> {firrtl.annotations = [{class = "firrtl.transforms.DontTouchAnnotation"}, {class = "port"}]}, in %y: !firrtl.uint<1> {firrtl.annotations = [{class = "port"}]}) attributes {annotations = [{class = "module"}]} {
+    // CHECK-NEXT: %w = firrtl.wire {annotations = [{class = "firrtl.transforms.DontTouchAnnotation"}]}
+    %w = firrtl.wire {annotations = [{class = "firrtl.transforms.DontTouchAnnotation"}, {class = "wire"}]} : !firrtl.uint<1>
+    // CHECK-NEXT: %v = firrtl.wire : !firrtl.uint<1>
+    %v = firrtl.wire {annotations = [{class = "wire"}]} : !firrtl.uint<1>
+    // CHECK-NEXT: %e_a = firrtl.instance @Ext {name = "e"} : !firrtl.uint<1>
+    %e_a = firrtl.instance @Ext {name = "e", portAnnotations = [[{class = "instance"}]]} : !firrtl.uint<1>
+    firrtl.connect %w, %x : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %v, %y : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %e_a, %w : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
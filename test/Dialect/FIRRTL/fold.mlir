@@ -0,0 +1,38 @@
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl.module(firrtl-fold))' %s | FileCheck %s
+
+firrtl.circuit "Fold" {
+
+// CHECK-LABEL: firrtl.module @Fold
+firrtl.module @Fold(in %x: !firrtl.uint<4>, in %p: !firrtl.uint<1>,
+                    out %a: !firrtl.uint<4>, out %b: !firrtl.uint<3>,
+                    out %c: !firrtl.uint<4>) {
+  // CHECK-DAG: %c0_ui4 = firrtl.constant 0 : !firrtl.uint<4>
+  // CHECK-DAG: %c3_ui3 = firrtl.constant 3 : !firrtl.uint<3>
+  // CHECK-NOT: firrtl.constant
+  // CHECK-NOT: firrtl.not
+  %c0_ui4 = firrtl.constant 0 : !firrtl.uint<4>
+  %c1_ui2 = firrtl.constant 1 : !firrtl.uint<2>
+  %c2_ui2 = firrtl.constant 2 : !firrtl.uint<2>
+
+  // CHECK: firrtl.connect %a, %c0_ui4
+  %0 = firrtl.and %x, %c0_ui4 : (!firrtl.uint<4>, !firrtl.uint<4>) -> !firrtl.uint<4>
+  firrtl.connect %a, %0 : !firrtl.uint<4>, !firrtl.uint<4>
+
+  // CHECK: firrtl.connect %b, %c3_ui3
+  %1 = firrtl.add %c1_ui2, %c2_ui2 : (!firrtl.uint<2>, !firrtl.uint<2>) -> !firrtl.uint<3>
+  firrtl.connect %b, %1 : !firrtl.uint<3>, !firrtl.uint<3>
+
+  // Dead expressions are erased.
+  %2 = firrtl.not %x : (!firrtl.uint<4>) -> !firrtl.uint<4>
+  %3 = firrtl.not %2 : (!firrtl.uint<4>) -> !firrtl.uint<4>
+
+  // Expressions in whens are folded too.
+  // CHECK: firrtl.when %p {
+  // CHECK-NEXT: firrtl.connect %c, %x
+  firrtl.when %p {
+    %4 = firrtl.and %x, %x : (!firrtl.uint<4>, !firrtl.uint<4>) -> !firrtl.uint<4>
+    firrtl.connect %c, %4 : !firrtl.uint<4>, !firrtl.uint<4>
+  }
+}
+
+}
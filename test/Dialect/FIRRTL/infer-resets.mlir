@@ -1,4 +1,5 @@
 // RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-infer-resets)' --verify-diagnostics --split-input-file %s | FileCheck %s
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-infer-resets{summarize-modules=true})' --verify-diagnostics --split-input-file %s | FileCheck %s
 
 // Tests extracted from:
 // - github.com/chipsalliance/firrtl:
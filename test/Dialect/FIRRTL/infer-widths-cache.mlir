@@ -0,0 +1,41 @@
+// RUN: rm -f %t.json
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-infer-widths{cache-file=%t.json})' --verify-diagnostics %s | FileCheck %s
+// RUN: FileCheck %s --check-prefix=CACHE < %t.json
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-infer-widths{cache-file=%t.json})' --verify-diagnostics %s | FileCheck %s
+// RUN: FileCheck %s --check-prefix=CACHE < %t.json
+
+// The widths are recorded for every module, and reused in the second run.
+// CACHE: "version":1
+// CACHE-SAME: "Foo":{"group":"[[GROUP:[0-9a-f]+]]","widths":[42,43,{{-?[0-9]+}}]}
+// CACHE-SAME: "Bar":{"group":"[[GROUP]]","widths":[44,42,43,{{-?[0-9]+}}]}
+// CACHE-SAME: "Baz":{"group":"{{[0-9a-f]+}}","widths":[8,8]}
+
+firrtl.circuit "Bar" {
+  // CHECK-LABEL: @Foo
+  // CHECK-SAME: in %in: !firrtl.uint<42>
+  // CHECK-SAME: out %out: !firrtl.uint<43>
+  firrtl.module @Foo(in %in: !firrtl.uint, out %out: !firrtl.uint) {
+    // CHECK: %0 = firrtl.add {{.*}} -> !firrtl.uint<43>
+    %0 = firrtl.add %in, %in : (!firrtl.uint, !firrtl.uint) -> !firrtl.uint
+    firrtl.connect %out, %0 : !firrtl.uint, !firrtl.uint
+  }
+
+  // CHECK-LABEL: @Bar
+  // CHECK-SAME: out %out: !firrtl.uint<44>
+  firrtl.module @Bar(in %in: !firrtl.uint<42>, out %out: !firrtl.uint) {
+    // CHECK: firrtl.instance @Foo {name = "inst"} : !firrtl.uint<42>, !firrtl.uint<43>
+    %inst_in, %inst_out = firrtl.instance @Foo {name = "inst"} : !firrtl.uint, !firrtl.uint
+    %0 = firrtl.add %inst_out, %inst_out : (!firrtl.uint, !firrtl.uint) -> !firrtl.uint
+    firrtl.connect %inst_in, %in : !firrtl.uint, !firrtl.uint<42>
+    firrtl.connect %out, %0 : !firrtl.uint, !firrtl.uint
+  }
+
+  // CHECK-LABEL: @Baz
+  // CHECK-SAME: out %out: !firrtl.uint<8>
+  firrtl.module @Baz(in %in: !firrtl.uint<8>, out %out: !firrtl.uint) {
+    // CHECK: %w = firrtl.wire : !firrtl.uint<8>
+    %w = firrtl.wire : !firrtl.uint
+    firrtl.connect %w, %in : !firrtl.uint, !firrtl.uint<8>
+    firrtl.connect %out, %w : !firrtl.uint, !firrtl.uint
+  }
+}
@@ -1,4 +1,6 @@
 // RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-infer-widths)' --verify-diagnostics --split-input-file %s
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-infer-widths{parallel-solve=true})' --verify-diagnostics --split-input-file %s
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-infer-widths{compact-solve=true})' --verify-diagnostics --split-input-file %s
 
 firrtl.circuit "Foo" {
   firrtl.module @Foo(in %clk: !firrtl.clock) {
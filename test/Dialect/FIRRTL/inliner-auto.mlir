@@ -0,0 +1,99 @@
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-inliner{auto-inline=true auto-inline-size=8 auto-inline-instances=2})' --split-input-file %s | FileCheck %s
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-inliner{auto-inline=true auto-inline-size=8 auto-inline-instances=2 auto-inline-budget=0})' --split-input-file %s | FileCheck %s --check-prefix=BUDGET
+
+// Small modules with few instances are inlined, wrappers of them included.
+// CHECK-LABEL: firrtl.circuit "Small"
+// BUDGET-LABEL: firrtl.circuit "Small"
+firrtl.circuit "Small" {
+  // CHECK-NOT: firrtl.module @Leaf
+  // BUDGET: firrtl.module @Leaf
+  firrtl.module @Leaf(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    firrtl.connect %b, %a : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-NOT: firrtl.module @Wrapper
+  firrtl.module @Wrapper(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    %leaf_a, %leaf_b = firrtl.instance @Leaf {name = "leaf"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %leaf_a, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b, %leaf_b : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-LABEL: firrtl.module @Small
+  // BUDGET-LABEL: firrtl.module @Small
+  firrtl.module @Small(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    // CHECK-NEXT: %w_a = firrtl.wire
+    // CHECK-NEXT: %w_b = firrtl.wire
+    // CHECK-NEXT: %w_leaf_a = firrtl.wire
+    // CHECK-NEXT: %w_leaf_b = firrtl.wire
+    // CHECK-NEXT: firrtl.connect %w_leaf_b, %w_leaf_a
+    // CHECK-NOT: firrtl.instance
+    // BUDGET: firrtl.instance @Wrapper
+    %w_a, %w_b = firrtl.instance @Wrapper {name = "w"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %w_a, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b, %w_b : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
+
+// -----
+
+// Modules over the size limit, with too many instances, or with annotations
+// are left alone.
+// CHECK-LABEL: firrtl.circuit "Limits"
+firrtl.circuit "Limits" {
+  // CHECK: firrtl.module @Big
+  firrtl.module @Big(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    %0 = firrtl.not %a : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %1 = firrtl.not %0 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %2 = firrtl.not %1 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %3 = firrtl.not %2 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %4 = firrtl.not %3 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %5 = firrtl.not %4 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    firrtl.connect %b, %5 : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK: firrtl.module @Popular
+  firrtl.module @Popular() {
+    %w = firrtl.wire : !firrtl.uint<1>
+  }
+  // CHECK: firrtl.module @Annotated
+  firrtl.module @Annotated() attributes {annotations = [{class = "circt.test"}]} {
+    %w = firrtl.wire : !firrtl.uint<1>
+  }
+  // CHECK-LABEL: firrtl.module @Limits
+  firrtl.module @Limits(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    // CHECK: firrtl.instance @Big
+    %big_a, %big_b = firrtl.instance @Big {name = "big"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %big_a, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b, %big_b : !firrtl.uint<1>, !firrtl.uint<1>
+    // CHECK: firrtl.instance @Popular
+    // CHECK: firrtl.instance @Popular
+    // CHECK: firrtl.instance @Popular
+    firrtl.instance @Popular {name = "p0"}
+    firrtl.instance @Popular {name = "p1"}
+    firrtl.instance @Popular {name = "p2"}
+    // CHECK: firrtl.instance @Annotated
+    firrtl.instance @Annotated {name = "annotated"}
+  }
+}
+
+// -----
+
+// Input ports driven by constants make a module cheaper to inline.
+// CHECK-LABEL: firrtl.circuit "Constants"
+firrtl.circuit "Constants" {
+  // CHECK-NOT: firrtl.module @Big
+  firrtl.module @Big(in %a: !firrtl.uint<1>, out %b: !firrtl.uint<1>) {
+    %0 = firrtl.not %a : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %1 = firrtl.not %0 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %2 = firrtl.not %1 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %3 = firrtl.not %2 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %4 = firrtl.not %3 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    %5 = firrtl.not %4 : (!firrtl.uint<1>) -> !firrtl.uint<1>
+    firrtl.connect %b, %5 : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-LABEL: firrtl.module @Constants
+  firrtl.module @Constants(out %b: !firrtl.uint<1>) {
+    // CHECK-NOT: firrtl.instance
+    %c0_ui1 = firrtl.constant 0 : !firrtl.uint<1>
+    %big_a, %big_b = firrtl.instance @Big {name = "big"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %big_a, %c0_ui1 : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b, %big_b : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
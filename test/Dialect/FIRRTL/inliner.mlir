@@ -220,3 +220,37 @@ firrtl.module @declarations(in %clock : !firrtl.clock, in %u8 : !firrtl.uint<8>,
 }
 
 }
+
+// Test that modules instantiated at several depths are processed before their
+// parents, and kept alive by the instances that remain.
+firrtl.circuit "levels" {
+firrtl.module @levels() {
+  firrtl.instance @Inlined {name = "a"}
+  firrtl.instance @Kept {name = "b"}
+}
+firrtl.module @Inlined()
+  attributes {annotations = [{class = "firrtl.passes.InlineAnnotation"}]} {
+  %w = firrtl.wire : !firrtl.uint<1>
+  firrtl.instance @Leaf {name = "leaf"}
+}
+firrtl.module @Kept() {
+  firrtl.instance @Inlined {name = "c"}
+}
+firrtl.module @Leaf() {
+  %w = firrtl.wire : !firrtl.uint<1>
+}
+}
+// CHECK-LABEL: firrtl.circuit "levels" {
+// CHECK-NEXT:   firrtl.module @levels() {
+// CHECK-NEXT:     %a_w = firrtl.wire  : !firrtl.uint<1>
+// CHECK-NEXT:     firrtl.instance @Leaf  {name = "a_leaf"}
+// CHECK-NEXT:     firrtl.instance @Kept  {name = "b"}
+// CHECK-NEXT:   }
+// CHECK-NEXT:   firrtl.module @Kept() {
+// CHECK-NEXT:     %c_w = firrtl.wire  : !firrtl.uint<1>
+// CHECK-NEXT:     firrtl.instance @Leaf  {name = "c_leaf"}
+// CHECK-NEXT:   }
+// CHECK-NEXT:   firrtl.module @Leaf() {
+// CHECK-NEXT:     %w = firrtl.wire  : !firrtl.uint<1>
+// CHECK-NEXT:   }
+// CHECK-NEXT: }
@@ -0,0 +1,57 @@
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-print-comb-paths)' %s -o %t 2>&1 | FileCheck %s
+
+// CHECK-LABEL: module Thru:
+// CHECK-NEXT:    in1 -> out1{{$}}
+// CHECK-NEXT:    in2 -> out2{{$}}
+
+// The paths through an instance are those of its module. A register breaks
+// a path.
+// CHECK-LABEL: module Cross:
+// CHECK-NEXT:    clk ->{{$}}
+// CHECK-NEXT:    a -> y{{$}}
+// CHECK-NEXT:    b -> x{{$}}
+
+// External modules have no known paths.
+// CHECK-LABEL: module Ext:
+// CHECK-NEXT:    e ->{{$}}
+
+// The paths go through several levels of instances, and an input may reach
+// several outputs.
+// CHECK-LABEL: module Top:
+// CHECK-NEXT:    clk ->{{$}}
+// CHECK-NEXT:    p -> s u{{$}}
+// CHECK-NEXT:    q ->{{$}}
+
+firrtl.circuit "Top" {
+  firrtl.module @Thru(in %in1: !firrtl.uint<1>, in %in2: !firrtl.uint<1>, out %out1: !firrtl.uint<1>, out %out2: !firrtl.uint<1>) {
+    firrtl.connect %out1, %in1 : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %out2, %in2 : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+
+  firrtl.module @Cross(in %clk: !firrtl.clock, in %a: !firrtl.uint<1>, in %b: !firrtl.uint<1>, out %x: !firrtl.uint<1>, out %y: !firrtl.uint<1>, out %z: !firrtl.uint<1>) {
+    %inner_in1, %inner_in2, %inner_out1, %inner_out2 = firrtl.instance @Thru {name = "inner"} : !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %inner_in1, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %y, %inner_out1 : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %inner_in2, %b : !firrtl.uint<1>, !firrtl.uint<1>
+    %w = firrtl.wire : !firrtl.uint<1>
+    firrtl.connect %w, %b : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %x, %w : !firrtl.uint<1>, !firrtl.uint<1>
+    %r = firrtl.reg %clk : !firrtl.uint<1>
+    firrtl.connect %r, %b : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %z, %r : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+
+  firrtl.extmodule @Ext(in %e: !firrtl.uint<1>, out %f: !firrtl.uint<1>)
+
+  firrtl.module @Top(in %clk: !firrtl.clock, in %p: !firrtl.uint<1>, in %q: !firrtl.uint<1>, out %s: !firrtl.uint<1>, out %t: !firrtl.uint<1>, out %u: !firrtl.uint<1>) {
+    %c_clk, %c_a, %c_b, %c_x, %c_y, %c_z = firrtl.instance @Cross {name = "c"} : !firrtl.clock, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c_clk, %clk : !firrtl.clock, !firrtl.clock
+    firrtl.connect %c_a, %p : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c_b, %q : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %s, %c_y : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %t, %c_z : !firrtl.uint<1>, !firrtl.uint<1>
+    %e_e, %e_f = firrtl.instance @Ext {name = "e"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %e_e, %q : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %u, %p : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
@@ -0,0 +1,88 @@
+// RUN: circt-opt --pass-pipeline='firrtl.circuit(firrtl-remove-unused-ports)' --split-input-file %s | FileCheck %s
+
+// Unused ports are removed from the module and from all its instances, along
+// with the connects to them.
+// CHECK-LABEL: firrtl.circuit "Unused"
+firrtl.circuit "Unused" {
+  // CHECK-LABEL: firrtl.module @Child(in %a: !firrtl.uint<1>, out %c: !firrtl.uint<1>)
+  firrtl.module @Child(in %a: !firrtl.uint<1>, in %b: !firrtl.uint<1>, out %c: !firrtl.uint<1>, out %d: !firrtl.uint<1>) {
+    // CHECK-NEXT: firrtl.connect %c, %a
+    // CHECK-NEXT: }
+    firrtl.connect %c, %a : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %d, %a : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-LABEL: firrtl.module @Unused
+  firrtl.module @Unused(in %x: !firrtl.uint<1>, in %y: !firrtl.uint<1>, out %z: !firrtl.uint<1>) {
+    // CHECK-NEXT: %c1_a, %c1_c = firrtl.instance @Child {name = "c1"} : !firrtl.uint<1>, !firrtl.uint<1>
+    // CHECK-NEXT: %c2_a, %c2_c = firrtl.instance @Child {name = "c2"} : !firrtl.uint<1>, !firrtl.uint<1>
+    // CHECK-NEXT: firrtl.connect %c1_a, %x
+    // CHECK-NEXT: firrtl.connect %c2_a, %y
+    // CHECK-NEXT: firrtl.connect %z, %c1_c
+    // CHECK-NEXT: }
+    %c1_a, %c1_b, %c1_c, %c1_d = firrtl.instance @Child {name = "c1"} : !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    %c2_a, %c2_b, %c2_c, %c2_d = firrtl.instance @Child {name = "c2"} : !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c1_a, %x : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c1_b, %x : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c2_a, %y : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c2_b, %y : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %z, %c1_c : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
+
+// -----
+
+// Constant ports are sunk into the other side of the module boundary.
+// CHECK-LABEL: firrtl.circuit "Constant"
+firrtl.circuit "Constant" {
+  // CHECK-LABEL: firrtl.module @Child(in %b: !firrtl.uint<2>, out %c: !firrtl.uint<2>)
+  firrtl.module @Child(in %a: !firrtl.uint<2>, in %b: !firrtl.uint<2>, out %c: !firrtl.uint<2>, out %d: !firrtl.uint<2>) {
+    // CHECK-NEXT: %c1_ui2 = firrtl.constant 1 : !firrtl.uint<2>
+    // CHECK-NEXT: %c2_ui2 = firrtl.constant 2 : !firrtl.uint<2>
+    // CHECK-NEXT: %0 = firrtl.and %c1_ui2, %b
+    // CHECK-NEXT: firrtl.connect %c, %0
+    %c2_ui2 = firrtl.constant 2 : !firrtl.uint<2>
+    %0 = firrtl.and %a, %b : (!firrtl.uint<2>, !firrtl.uint<2>) -> !firrtl.uint<2>
+    firrtl.connect %c, %0 : !firrtl.uint<2>, !firrtl.uint<2>
+    firrtl.connect %d, %c2_ui2 : !firrtl.uint<2>, !firrtl.uint<2>
+  }
+  // CHECK-LABEL: firrtl.module @Constant
+  firrtl.module @Constant(in %x: !firrtl.uint<2>, out %y: !firrtl.uint<2>, out %z: !firrtl.uint<2>) {
+    // CHECK-NEXT: %c1_ui2 = firrtl.constant 1 : !firrtl.uint<2>
+    // CHECK-NEXT: %c2_ui2 = firrtl.constant 2 : !firrtl.uint<2>
+    // CHECK-NEXT: %c_b, %c_c = firrtl.instance @Child {name = "c"} : !firrtl.uint<2>, !firrtl.uint<2>
+    // CHECK-NEXT: firrtl.connect %c_b, %x
+    // CHECK-NEXT: firrtl.connect %y, %c_c
+    // CHECK-NEXT: firrtl.connect %z, %c2_ui2
+    %c1_ui2 = firrtl.constant 1 : !firrtl.uint<2>
+    %c_a, %c_b, %c_c, %c_d = firrtl.instance @Child {name = "c"} : !firrtl.uint<2>, !firrtl.uint<2>, !firrtl.uint<2>, !firrtl.uint<2>
+    firrtl.connect %c_a, %c1_ui2 : !firrtl.uint<2>, !firrtl.uint<2>
+    firrtl.connect %c_b, %x : !firrtl.uint<2>, !firrtl.uint<2>
+    firrtl.connect %y, %c_c : !firrtl.uint<2>, !firrtl.uint<2>
+    firrtl.connect %z, %c_d : !firrtl.uint<2>, !firrtl.uint<2>
+  }
+}
+
+// -----
+
+// The ports of the main module, ports with annotations and ports driven by
+// different constants are kept.
+// CHECK-LABEL: firrtl.circuit "Kept"
+firrtl.circuit "Kept" {
+  // CHECK-LABEL: firrtl.module @Child(in %a: !firrtl.uint<1>, in %b: !firrtl.uint<1> {firrtl.annotations = [{class = "firrtl.transforms.DontTouchAnnotation"}]}, out %c: !firrtl.uint<1>)
+  firrtl.module @Child(in %a: !firrtl.uint<1>, in %b: !firrtl.uint<1> {firrtl.annotations = [{class = "firrtl.transforms.DontTouchAnnotation"}]}, out %c: !firrtl.uint<1>) {
+    firrtl.connect %c, %a : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-LABEL: firrtl.module @Kept(in %unused: !firrtl.uint<1>, out %z: !firrtl.uint<1>)
+  firrtl.module @Kept(in %unused: !firrtl.uint<1>, out %z: !firrtl.uint<1>) {
+    %c0_ui1 = firrtl.constant 0 : !firrtl.uint<1>
+    %c1_ui1 = firrtl.constant 1 : !firrtl.uint<1>
+    // CHECK: firrtl.instance @Child {name = "c1"} : !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    // CHECK: firrtl.instance @Child {name = "c2"} : !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    %c1_a, %c1_b, %c1_c = firrtl.instance @Child {name = "c1"} : !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    %c2_a, %c2_b, %c2_c = firrtl.instance @Child {name = "c2"} : !firrtl.uint<1>, !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c1_a, %c0_ui1 : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c2_a, %c1_ui1 : !firrtl.uint<1>, !firrtl.uint<1>
+    %0 = firrtl.and %c1_c, %c2_b : (!firrtl.uint<1>, !firrtl.uint<1>) -> !firrtl.uint<1>
+    firrtl.connect %z, %0 : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
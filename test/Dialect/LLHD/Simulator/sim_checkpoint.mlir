@@ -0,0 +1,47 @@
+// REQUIRES: llhd-sim
+// RUN: llhd-sim %s -T 2000 --trace-format=merged -checkpoint=%t.ckpt -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=FIRST
+// RUN: llhd-sim %s -T 5000 --trace-format=merged -restore=%t.ckpt -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=RESTORED
+
+// FIRST: 0ps
+// FIRST-NEXT:   root/foo/s  0x03
+// FIRST-NEXT:   root/s  0x03
+// FIRST-NEXT: 1000ps
+// FIRST-NEXT:   root/foo/s  0x09
+// FIRST-NEXT:   root/s  0x09
+// FIRST-NEXT: 2000ps
+// FIRST-NEXT:   root/foo/s  0x1b
+// FIRST-NEXT:   root/s  0x1b
+// FIRST-NOT: ps
+
+// The restored simulation carries on from the pending wakeup of the process.
+// RESTORED: 2000ps
+// RESTORED-NEXT:   root/foo/s  0x1b
+// RESTORED-NEXT:   root/s  0x1b
+// RESTORED-NEXT: 3000ps
+// RESTORED-NEXT:   root/foo/s  0x51
+// RESTORED-NEXT:   root/s  0x51
+// RESTORED-NEXT: 4000ps
+// RESTORED-NEXT:   root/foo/s  0xf3
+// RESTORED-NEXT:   root/s  0xf3
+// RESTORED-NEXT: 5000ps
+// RESTORED-NEXT:   root/foo/s  0xd9
+// RESTORED-NEXT:   root/s  0xd9
+llhd.entity @root () -> () {
+  %0 = llhd.const 1 : i8
+  %s = llhd.sig "s" %0 : i8
+  llhd.inst "foo" @foo () -> (%s) : () -> (!llhd.sig<i8>)
+}
+
+llhd.proc @foo () -> (%s : !llhd.sig<i8>) {
+  br ^entry
+^entry:
+  %1 = llhd.prb %s : !llhd.sig<i8>
+  %2 = addi %1, %1 : i8
+  %t0 = llhd.const #llhd.time<0ns, 0d, 1e> : !llhd.time
+  llhd.drv %s, %2 after %t0 : !llhd.sig<i8>
+  %3 = addi %2, %1 : i8
+  %t1 = llhd.const #llhd.time<0ns, 0d, 2e> : !llhd.time
+  llhd.drv %s, %3 after %t1 : !llhd.sig<i8>
+  %t2= llhd.const #llhd.time<1ns, 0d, 0e> : !llhd.time
+  llhd.wait for %t2, ^entry
+}
@@ -4,6 +4,7 @@
 // RUN: llhd-sim %s -T 5000 --trace-format=merged -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=MERGED
 // RUN: llhd-sim %s -T 5000 --trace-format=merged-reduce -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=MERGEDRED
 // RUN: llhd-sim %s -T 5000 --trace-format=named-only -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=NAMED
+// RUN: llhd-sim %s -T 5000 --trace-format=vcd -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=VCD
 
 // FULL: 0ps 0d 0e  root/1  0x01
 // FULL: 0ps 0d 0e  root/foo/s  0x01
@@ -94,6 +95,29 @@
 // NAMED:   root/s  0xf3
 // NAMED: 5000ps
 // NAMED:   root/s  0xd9
+
+// VCD: $timescale 1ps $end
+// VCD-NEXT: $scope module root $end
+// VCD-NEXT: $var wire 8 ! s $end
+// VCD-NEXT: $var wire 8 " 1 $end
+// VCD-NEXT: $scope module foo $end
+// VCD-NEXT: $var wire 8 ! s $end
+// VCD-NEXT: $upscope $end
+// VCD-NEXT: $upscope $end
+// VCD-NEXT: $enddefinitions $end
+// VCD-NEXT: #0
+// VCD-NEXT: b00000011 !
+// VCD-NEXT: b00000001 "
+// VCD-NEXT: #1000
+// VCD-NEXT: b00001001 !
+// VCD-NEXT: #2000
+// VCD-NEXT: b00011011 !
+// VCD-NEXT: #3000
+// VCD-NEXT: b01010001 !
+// VCD-NEXT: #4000
+// VCD-NEXT: b11110011 !
+// VCD-NEXT: #5000
+// VCD-NEXT: b11011001 !
 llhd.entity @root () -> () {
   %0 = llhd.const 1 : i8
   %s = llhd.sig "s" %0 : i8
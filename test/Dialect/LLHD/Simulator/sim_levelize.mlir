@@ -0,0 +1,44 @@
+// REQUIRES: llhd-sim
+// RUN: llhd-sim %s -T 2000 --trace-format=reduced -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=EVENT
+// RUN: llhd-sim %s -T 2000 --trace-format=reduced -levelize -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=LEVELIZE
+
+// EVENT: 0ps 0d 0e  root/a  0x01
+// EVENT-NEXT: 0ps 0d 0e  root/b  0x00
+// EVENT-NEXT: 0ps 0d 0e  root/clock  0x00
+// EVENT-NEXT: 1000ps 0d 0e  root/clock  0x01
+// EVENT-NEXT: 1000ps 1d 0e  root/a  0x00
+// EVENT-NEXT: 1000ps 2d 0e  root/b  0x01
+// EVENT-NEXT: 2000ps 0d 0e  root/clock  0x00
+// EVENT-NEXT: 2000ps 1d 0e  root/a  0x01
+// EVENT-NEXT: 2000ps 2d 0e  root/b  0x00
+
+// LEVELIZE: 0ps 0d 0e  root/a  0x01
+// LEVELIZE-NEXT: 0ps 0d 0e  root/b  0x00
+// LEVELIZE-NEXT: 0ps 0d 0e  root/clock  0x00
+// LEVELIZE-NEXT: 1000ps 0d 0e  root/a  0x00
+// LEVELIZE-NEXT: 1000ps 0d 0e  root/b  0x01
+// LEVELIZE-NEXT: 1000ps 0d 0e  root/clock  0x01
+// LEVELIZE-NEXT: 2000ps 0d 0e  root/a  0x01
+// LEVELIZE-NEXT: 2000ps 0d 0e  root/b  0x00
+// LEVELIZE-NEXT: 2000ps 0d 0e  root/clock  0x00
+
+llhd.entity @root () -> () {
+  %0 = llhd.const 0 : i1
+  %1 = llhd.const 1 : i1
+  %clock = llhd.sig "clock" %0 : i1
+  %a = llhd.sig "a" %1 : i1
+  %b = llhd.sig "b" %0 : i1
+  %2 = llhd.prb %clock : !llhd.sig<i1>
+  %3 = llhd.not %2 : i1
+  %t = llhd.const #llhd.time<1ns, 0d, 0e> : !llhd.time
+  llhd.drv %clock, %3 after %t : !llhd.sig<i1>
+  llhd.inst "inv1" @inv (%clock) -> (%a) : (!llhd.sig<i1>) -> (!llhd.sig<i1>)
+  llhd.inst "inv2" @inv (%a) -> (%b) : (!llhd.sig<i1>) -> (!llhd.sig<i1>)
+}
+
+llhd.entity @inv (%in : !llhd.sig<i1>) -> (%out : !llhd.sig<i1>) {
+  %0 = llhd.prb %in : !llhd.sig<i1>
+  %1 = llhd.not %0 : i1
+  %t = llhd.const #llhd.time<0ns, 1d, 0e> : !llhd.time
+  llhd.drv %out, %1 after %t : !llhd.sig<i1>
+}
@@ -0,0 +1,45 @@
+// REQUIRES: llhd-sim
+// RUN: llhd-sim %s --trace-format=reduced -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s
+// RUN: llhd-sim %s --trace-format=reduced -mlir-optimize -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s
+// RUN: llhd-sim %s -mlir-optimize -dump-llvm-dialect -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=LLVM
+
+// CHECK: 0ps 0d 0e  root/a  0x00
+// CHECK-NEXT: 0ps 0d 0e  root/b  0x00
+// CHECK-NEXT: 0ps 1d 0e  root/b  0x01
+// CHECK-NEXT: 1000ps 0d 0e  root/a  0x05
+// CHECK-NEXT: 1000ps 1d 0e  root/b  0x06
+
+// The function is inlined and eliminated.
+// LLVM-NOT: @addOne
+llhd.entity @root () -> () {
+  %0 = llhd.const 0 : i8
+  %1 = llhd.sig "a" %0 : i8
+  %2 = llhd.sig "b" %0 : i8
+  llhd.inst "gen" @gen () -> (%1) : () -> (!llhd.sig<i8>)
+  llhd.inst "inc" @inc (%1) -> (%2) : (!llhd.sig<i8>) -> (!llhd.sig<i8>)
+}
+
+func @addOne(%x : i8) -> i8 {
+  %c1 = llhd.const 1 : i8
+  %0 = addi %x, %c1 : i8
+  return %0 : i8
+}
+
+llhd.proc @gen () -> (%a : !llhd.sig<i8>) {
+  %c5 = llhd.const 5 : i8
+  %t = llhd.const #llhd.time<1ns, 0d, 0e> : !llhd.time
+  llhd.drv %a, %c5 after %t : !llhd.sig<i8>
+  llhd.halt
+}
+
+llhd.proc @inc (%a : !llhd.sig<i8>) -> (%b : !llhd.sig<i8>) {
+  br ^body
+^body:
+  %x = llhd.prb %a : !llhd.sig<i8>
+  %ptr = llhd.var %x : i8
+  %0 = llhd.load %ptr : !llhd.ptr<i8>
+  %1 = call @addOne(%0) : (i8) -> i8
+  %t = llhd.const #llhd.time<0ns, 1d, 0e> : !llhd.time
+  llhd.drv %b, %1 after %t : !llhd.sig<i8>
+  llhd.wait (%a : !llhd.sig<i8>), ^body
+}
@@ -1,5 +1,8 @@
 // REQUIRES: llhd-sim
 // RUN: llhd-sim %s -n 10 -r Foo -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s
+// RUN: llhd-sim %s -n 10 -r Foo -stats=%t.json --trace-format=no-trace -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext
+// RUN: FileCheck %s --check-prefix=STATS < %t.json
+// RUN: llhd-sim %s -n 10 -r Foo -runs=2 -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=RUNS
 
 // CHECK: 0ps 0d 0e  Foo/toggle  0x00
 // CHECK-NEXT: 1000ps 0d 0e  Foo/toggle  0x01
@@ -11,6 +14,21 @@
 // CHECK-NEXT: 7000ps 0d 0e  Foo/toggle  0x01
 // CHECK-NEXT: 8000ps 0d 0e  Foo/toggle  0x00
 // CHECK-NEXT: 9000ps 0d 0e  Foo/toggle  0x01
+
+// RUNS: 0ps 0d 0e  Foo/toggle  0x00
+// RUNS: 9000ps 0d 0e  Foo/toggle  0x01
+// RUNS-NEXT: 0ps 0d 0e  Foo/toggle  0x00
+// RUNS: 9000ps 0d 0e  Foo/toggle  0x01
+
+// STATS: "cycles": 10,
+// STATS: "slots": {
+// STATS-NEXT: "count": 10,
+// STATS: "instances": [
+// STATS: "path": "Foo",
+// STATS-NEXT: "unit": "Foo",
+// STATS-NEXT: "wakeups": 10,
+// STATS-NEXT: "sampledRuns": 1,
+
 llhd.entity @Foo () -> () {
   %0 = llhd.const 0 : i1
   %toggle = llhd.sig "toggle" %0 : i1
@@ -0,0 +1,47 @@
+// REQUIRES: llhd-sim
+// RUN: llhd-sim %s -T 2000 --trace-format=full -trace-filter=root/inv1/* -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=FILTER
+// RUN: llhd-sim %s -T 2000 --trace-format=reduced -trace-start=1500 -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=WINDOW
+// RUN: llhd-sim %s -T 2000 --trace-format=reduced -trace-trigger=root/b -trace-capture-steps=1 -shared-libs=%shlibdir/libcirct-llhd-signals-runtime-wrappers%shlibext | FileCheck %s --check-prefix=TRIGGER
+
+// FILTER: 0ps 0d 0e  root/inv1/a  0x01
+// FILTER-NEXT: 0ps 0d 0e  root/inv1/clock  0x00
+// FILTER-NEXT: 1000ps 0d 0e  root/inv1/clock  0x01
+// FILTER-NEXT: 1000ps 1d 0e  root/inv1/a  0x00
+// FILTER-NEXT: 2000ps 0d 0e  root/inv1/clock  0x00
+// FILTER-NEXT: 2000ps 1d 0e  root/inv1/a  0x01
+// FILTER-NOT: root/inv2
+
+// WINDOW-NOT: 1000ps
+// WINDOW: 2000ps 0d 0e  root/a  0x00
+// WINDOW-NEXT: 2000ps 0d 0e  root/b  0x01
+// WINDOW-NEXT: 2000ps 0d 0e  root/clock  0x00
+// WINDOW-NEXT: 2000ps 1d 0e  root/a  0x01
+// WINDOW-NEXT: 2000ps 2d 0e  root/b  0x00
+
+// TRIGGER-NOT: root/clock  0x01
+// TRIGGER: 1000ps 1d 0e  root/a  0x00
+// TRIGGER-NEXT: 1000ps 2d 0e  root/b  0x01
+// TRIGGER-NEXT: 2000ps 0d 0e  root/clock  0x00
+// TRIGGER-NOT: 2000ps 1d 0e
+
+
+llhd.entity @root () -> () {
+  %0 = llhd.const 0 : i1
+  %1 = llhd.const 1 : i1
+  %clock = llhd.sig "clock" %0 : i1
+  %a = llhd.sig "a" %1 : i1
+  %b = llhd.sig "b" %0 : i1
+  %2 = llhd.prb %clock : !llhd.sig<i1>
+  %3 = llhd.not %2 : i1
+  %t = llhd.const #llhd.time<1ns, 0d, 0e> : !llhd.time
+  llhd.drv %clock, %3 after %t : !llhd.sig<i1>
+  llhd.inst "inv1" @inv (%clock) -> (%a) : (!llhd.sig<i1>) -> (!llhd.sig<i1>)
+  llhd.inst "inv2" @inv (%a) -> (%b) : (!llhd.sig<i1>) -> (!llhd.sig<i1>)
+}
+
+llhd.entity @inv (%in : !llhd.sig<i1>) -> (%out : !llhd.sig<i1>) {
+  %0 = llhd.prb %in : !llhd.sig<i1>
+  %1 = llhd.not %0 : i1
+  %t = llhd.const #llhd.time<0ns, 1d, 0e> : !llhd.time
+  llhd.drv %out, %1 after %t : !llhd.sig<i1>
+}
@@ -0,0 +1,34 @@
+// RUN: circt-opt %s -llhd-process-lowering=skip-unsupported | FileCheck %s
+
+// CHECK-LABEL: llhd.entity @prbAndWait
+llhd.proc @prbAndWait(%arg0 : !llhd.sig<i64>) -> () {
+  br ^bb1
+^bb1:
+  %0 = llhd.prb %arg0 : !llhd.sig<i64>
+  llhd.wait (%arg0 : !llhd.sig<i64>), ^bb1
+}
+
+// Processes that cannot be lowered are kept.
+// CHECK-LABEL: llhd.proc @prbAndWaitNotObserved
+llhd.proc @prbAndWaitNotObserved(%arg0 : !llhd.sig<i64>) -> () {
+  br ^bb1
+^bb1:
+  %0 = llhd.prb %arg0 : !llhd.sig<i64>
+  llhd.wait ^bb1
+}
+
+// A halting process only probes its inputs once.
+// CHECK-LABEL: llhd.proc @prbAndHalt
+llhd.proc @prbAndHalt(%arg0 : !llhd.sig<i64>) -> () {
+  %0 = llhd.prb %arg0 : !llhd.sig<i64>
+  llhd.halt
+}
+
+// The entry block only runs once.
+// CHECK-LABEL: llhd.proc @prbInEntry
+llhd.proc @prbInEntry(%arg0 : !llhd.sig<i64>) -> () {
+  %0 = llhd.prb %arg0 : !llhd.sig<i64>
+  br ^bb1
+^bb1:
+  llhd.wait (%arg0 : !llhd.sig<i64>), ^bb1
+}
@@ -0,0 +1,15 @@
+#!/bin/sh
+# A generator which appends its arguments to the log file given as its first
+# argument, writes the module named by --moduleName to <moduleName>.v in the
+# working directory, and lists that file.
+log=$1
+shift
+echo "$@" >> "$log"
+while [ $# -gt 0 ]; do
+  if [ "$1" = "--moduleName" ]; then
+    name=$2
+  fi
+  shift
+done
+echo "module $name; endmodule" > "$name.v"
+echo "$name.v"
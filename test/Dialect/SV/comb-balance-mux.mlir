@@ -0,0 +1,72 @@
+// RUN: circt-opt -comb-balance-mux %s | FileCheck %s
+
+// A chain comparing one value with distinct constants becomes an OR of the
+// values masked by their conditions.
+// CHECK-LABEL: hw.module @exclusive(%sel: i4, %a: i8, %b: i8, %c: i8, %d: i8, %e: i8) -> (%x: i8) {
+// CHECK-NEXT:    %c1_i4 = hw.constant 1 : i4
+// CHECK-NEXT:    %c5_i4 = hw.constant 5 : i4
+// CHECK-NEXT:    %c2_i4 = hw.constant 2 : i4
+// CHECK-NEXT:    %c6_i4 = hw.constant 6 : i4
+// CHECK-NEXT:    %0 = comb.icmp eq %sel, %c1_i4 : i4
+// CHECK-NEXT:    %1 = comb.icmp eq %sel, %c5_i4 : i4
+// CHECK-NEXT:    %2 = comb.icmp eq %sel, %c2_i4 : i4
+// CHECK-NEXT:    %3 = comb.icmp eq %sel, %c6_i4 : i4
+// CHECK-NEXT:    %c0_i8 = hw.constant 0 : i8
+// CHECK-NEXT:    %4 = comb.mux %0, %a, %c0_i8 : i8
+// CHECK-NEXT:    %5 = comb.mux %1, %b, %c0_i8 : i8
+// CHECK-NEXT:    %6 = comb.mux %2, %c, %c0_i8 : i8
+// CHECK-NEXT:    %7 = comb.mux %3, %d, %c0_i8 : i8
+// CHECK-NEXT:    %8 = comb.or %0, %1, %2, %3 : i1
+// CHECK-NEXT:    %9 = comb.mux %8, %c0_i8, %e : i8
+// CHECK-NEXT:    %10 = comb.or %4, %5, %6, %7, %9 : i8
+// CHECK-NEXT:    hw.output %10 : i8
+// CHECK-NEXT:  }
+hw.module @exclusive(%sel: i4, %a: i8, %b: i8, %c: i8, %d: i8, %e: i8) -> (%x: i8) {
+  %c1 = hw.constant 1 : i4
+  %c5 = hw.constant 5 : i4
+  %c2 = hw.constant 2 : i4
+  %c6 = hw.constant 6 : i4
+  %0 = comb.icmp eq %sel, %c1 : i4
+  %1 = comb.icmp eq %sel, %c5 : i4
+  %2 = comb.icmp eq %sel, %c2 : i4
+  %3 = comb.icmp eq %sel, %c6 : i4
+  %4 = comb.mux %3, %d, %e : i8
+  %5 = comb.mux %2, %c, %4 : i8
+  %6 = comb.mux %1, %b, %5 : i8
+  %7 = comb.mux %0, %a, %6 : i8
+  hw.output %7 : i8
+}
+
+// Other chains become a balanced tree, selecting the first half of the chain
+// when any of its conditions is true.
+// CHECK-LABEL: hw.module @priority(%p: i1, %q: i1, %r: i1, %s: i1, %a: i8, %b: i8, %c: i8, %d: i8, %e: i8) -> (%x: i8) {
+// CHECK-NEXT:    %0 = comb.or %p, %q : i1
+// CHECK-NEXT:    %1 = comb.mux %p, %a, %b : i8
+// CHECK-NEXT:    %2 = comb.mux %s, %d, %e : i8
+// CHECK-NEXT:    %3 = comb.mux %r, %c, %2 : i8
+// CHECK-NEXT:    %4 = comb.mux %0, %1, %3 : i8
+// CHECK-NEXT:    hw.output %4 : i8
+// CHECK-NEXT:  }
+hw.module @priority(%p: i1, %q: i1, %r: i1, %s: i1, %a: i8, %b: i8, %c: i8, %d: i8, %e: i8) -> (%x: i8) {
+  %0 = comb.mux %s, %d, %e : i8
+  %1 = comb.mux %r, %c, %0 : i8
+  %2 = comb.mux %q, %b, %1 : i8
+  %3 = comb.mux %p, %a, %2 : i8
+  hw.output %3 : i8
+}
+
+// Short chains, and the links of a chain used elsewhere, are kept.
+// CHECK-LABEL: hw.module @kept(%p: i1, %q: i1, %r: i1, %s: i1, %a: i8, %b: i8, %c: i8, %d: i8, %e: i8) -> (%x: i8, %y: i8) {
+// CHECK-NEXT:    %0 = comb.mux %s, %d, %e : i8
+// CHECK-NEXT:    %1 = comb.mux %r, %c, %0 : i8
+// CHECK-NEXT:    %2 = comb.mux %q, %b, %1 : i8
+// CHECK-NEXT:    %3 = comb.mux %p, %a, %2 : i8
+// CHECK-NEXT:    hw.output %3, %1 : i8, i8
+// CHECK-NEXT:  }
+hw.module @kept(%p: i1, %q: i1, %r: i1, %s: i1, %a: i8, %b: i8, %c: i8, %d: i8, %e: i8) -> (%x: i8, %y: i8) {
+  %0 = comb.mux %s, %d, %e : i8
+  %1 = comb.mux %r, %c, %0 : i8
+  %2 = comb.mux %q, %b, %1 : i8
+  %3 = comb.mux %p, %a, %2 : i8
+  hw.output %3, %1 : i8, i8
+}
@@ -0,0 +1,66 @@
+// RUN: circt-opt -comb-narrow-widths %s | FileCheck %s
+// RUN: circt-opt -comb-narrow-widths -canonicalize %s | FileCheck %s --check-prefix=CANON
+
+// Arithmetic only keeps the low bits that are used.
+// CHECK-LABEL: hw.module @add(%a: i8, %b: i8) -> (%o: i4) {
+// CHECK-NEXT:    %0 = comb.extract %a from 0 : (i8) -> i4
+// CHECK-NEXT:    %1 = comb.extract %b from 0 : (i8) -> i4
+// CHECK-NEXT:    %2 = comb.add %0, %1 : i4
+// CHECK-NEXT:    %c0_i4 = hw.constant 0 : i4
+// CHECK-NEXT:    %3 = comb.concat %c0_i4, %2 : (i4, i4) -> i8
+// CHECK-NEXT:    %4 = comb.extract %3 from 0 : (i8) -> i4
+// CHECK-NEXT:    hw.output %4 : i4
+// CANON-LABEL: hw.module @add(%a: i8, %b: i8) -> (%o: i4) {
+// CANON-NEXT:    %0 = comb.extract %a from 0 : (i8) -> i4
+// CANON-NEXT:    %1 = comb.extract %b from 0 : (i8) -> i4
+// CANON-NEXT:    %2 = comb.add %0, %1 : i4
+// CANON-NEXT:    hw.output %2 : i4
+hw.module @add(%a: i8, %b: i8) -> (%o: i4) {
+  %0 = comb.add %a, %b : i8
+  %1 = comb.extract %0 from 0 : (i8) -> i4
+  hw.output %1 : i4
+}
+
+// Demanded bits are propagated through whole expression trees, and bitwise
+// operations are narrowed on both sides.
+// CANON-LABEL: hw.module @tree(%a: i8, %b: i8, %c: i8) -> (%o: i2) {
+// CANON-NEXT:    %0 = comb.extract %a from 2 : (i8) -> i2
+// CANON-NEXT:    %1 = comb.extract %b from 2 : (i8) -> i2
+// CANON-NEXT:    %2 = comb.xor %0, %1 : i2
+// CANON-NEXT:    %3 = comb.extract %c from 2 : (i8) -> i2
+// CANON-NEXT:    %4 = comb.and %2, %3 : i2
+// CANON-NEXT:    hw.output %4 : i2
+hw.module @tree(%a: i8, %b: i8, %c: i8) -> (%o: i2) {
+  %0 = comb.xor %a, %b : i8
+  %1 = comb.and %0, %c : i8
+  %2 = comb.extract %1 from 2 : (i8) -> i2
+  hw.output %2 : i2
+}
+
+// Operands of a concat whose bits are never used are replaced with zero.
+// CHECK-LABEL: hw.module @deadBits(%a: i4, %b: i4) -> (%o: i4) {
+// CHECK-NEXT:    %c0_i4 = hw.constant 0 : i4
+// CHECK-NEXT:    %0 = comb.and %a, %b : i4
+// CHECK-NEXT:    %1 = comb.concat %c0_i4, %0 : (i4, i4) -> i8
+hw.module @deadBits(%a: i4, %b: i4) -> (%o: i4) {
+  %0 = comb.xor %a, %b : i4
+  %1 = comb.and %a, %b : i4
+  %2 = comb.concat %0, %1 : (i4, i4) -> i8
+  %3 = comb.extract %2 from 0 : (i8) -> i4
+  hw.output %3 : i4
+}
+
+// Values feeding anything outside of the Comb dialect are fully demanded.
+// CHECK-LABEL: hw.module @observed(%clock: i1, %a: i8, %b: i8) -> (%o: i4) {
+// CHECK-NEXT:    %0 = comb.add %a, %b : i8
+// CHECK-NEXT:    %1 = comb.extract %0 from 0 : (i8) -> i4
+// CHECK-NEXT:    sv.always posedge %clock {
+// CHECK-NEXT:      sv.fwrite "%x"(%0) : i8
+hw.module @observed(%clock: i1, %a: i8, %b: i8) -> (%o: i4) {
+  %0 = comb.add %a, %b : i8
+  %1 = comb.extract %0 from 0 : (i8) -> i4
+  sv.always posedge %clock {
+    sv.fwrite "%x"(%0) : i8
+  }
+  hw.output %1 : i4
+}
@@ -0,0 +1,64 @@
+// RUN: circt-opt -comb-simplify %s | FileCheck %s
+
+// Folds and canonicalizations apply to operations in order, including to the
+// operations created by earlier rewrites.
+// CHECK-LABEL: hw.module @notNot(%a: i1) -> (%o: i1) {
+// CHECK-NEXT:    hw.output %a : i1
+// CHECK-NEXT:  }
+hw.module @notNot(%a: i1) -> (%o: i1) {
+  %c1 = hw.constant 1 : i1
+  %0 = comb.xor %a, %c1 : i1
+  %1 = comb.xor %0, %c1 : i1
+  hw.output %1 : i1
+}
+
+// CHECK-LABEL: hw.module @narrowMux
+// CHECK-NEXT:    %0 = comb.extract %a from 1 : (i8) -> i4
+// CHECK-NEXT:    %1 = comb.extract %b from 1 : (i8) -> i4
+// CHECK-NEXT:    %2 = comb.mux %c, %0, %1 : i4
+// CHECK-NEXT:    hw.output %2 : i4
+hw.module @narrowMux(%a: i8, %b: i8, %c: i1) -> (%o: i4) {
+  %0 = comb.mux %c, %a, %b : i8
+  %1 = comb.extract %0 from 1 : (i8) -> i4
+  hw.output %1 : i4
+}
+
+// Operations nested in procedural regions are simplified too, and dead
+// expression trees are removed.
+// CHECK-LABEL: hw.module @nested(%clock: i1, %a: i4) {
+// CHECK-NEXT:    sv.always posedge %clock {
+// CHECK-NEXT:      sv.fwrite "%x"(%a) : i4
+// CHECK-NEXT:    }
+// CHECK-NEXT:    hw.output
+// CHECK-NEXT:  }
+hw.module @nested(%clock: i1, %a: i4) {
+  %c0 = hw.constant 0 : i4
+  %0 = comb.or %a, %c0 : i4
+  %1 = comb.and %0, %a : i4
+  sv.always posedge %clock {
+    %2 = comb.xor %1, %c0 : i4
+    sv.fwrite "%x"(%2) : i4
+  }
+  hw.output
+}
+
+// Duplicate constants are merged and moved to the start of the module.
+// CHECK-LABEL: hw.module @constants(%clock: i1, %a: i4) -> (%o1: i4, %o2: i4) {
+// CHECK-NEXT:    %c5_i4 = hw.constant 5 : i4
+// CHECK-NEXT:    %c3_i4 = hw.constant 3 : i4
+// CHECK-NEXT:    %0 = comb.add %a, %c5_i4 : i4
+// CHECK-NEXT:    sv.always posedge %clock {
+// CHECK-NEXT:      sv.fwrite "%x %x"(%0, %c3_i4) : i4, i4
+// CHECK-NEXT:    }
+// CHECK-NEXT:    hw.output %0, %c5_i4 : i4, i4
+// CHECK-NEXT:  }
+hw.module @constants(%clock: i1, %a: i4) -> (%o1: i4, %o2: i4) {
+  %c5 = hw.constant 5 : i4
+  %0 = comb.add %a, %c5 : i4
+  sv.always posedge %clock {
+    %c3 = hw.constant 3 : i4
+    sv.fwrite "%x %x"(%0, %c3) : i4, i4
+  }
+  %c5_0 = hw.constant 5 : i4
+  hw.output %0, %c5_0 : i4, i4
+}
@@ -0,0 +1,55 @@
+// RUN: circt-opt -comb-structural-hash %s | FileCheck %s
+
+// Commutative operations are equivalent regardless of their operand order, and
+// equal constants are merged.
+// CHECK-LABEL: hw.module @commutative(%a: i4, %b: i4) -> (%x: i4, %y: i4, %z: i4) {
+// CHECK-NEXT:    %c1_i4 = hw.constant 1 : i4
+// CHECK-NEXT:    %0 = comb.and %a, %b : i4
+// CHECK-NEXT:    %1 = comb.add %0, %c1_i4 : i4
+// CHECK-NEXT:    hw.output %0, %1, %1 : i4, i4, i4
+// CHECK-NEXT:  }
+hw.module @commutative(%a: i4, %b: i4) -> (%x: i4, %y: i4, %z: i4) {
+  %c1 = hw.constant 1 : i4
+  %0 = comb.and %a, %b : i4
+  %1 = comb.and %b, %a : i4
+  %2 = comb.add %0, %c1 : i4
+  %c1_0 = hw.constant 1 : i4
+  %3 = comb.add %c1_0, %1 : i4
+  hw.output %1, %2, %3 : i4, i4, i4
+}
+
+// Nested associative operations are equivalent to flattened ones.
+// CHECK-LABEL: hw.module @associative(%a: i1, %b: i1, %c: i1) -> (%x: i1, %y: i1, %z: i3, %w: i3) {
+// CHECK-NEXT:    %0 = comb.or %a, %b : i1
+// CHECK-NEXT:    %1 = comb.or %c, %0 : i1
+// CHECK-NEXT:    %2 = comb.concat %a, %b : (i1, i1) -> i2
+// CHECK-NEXT:    %3 = comb.concat %2, %c : (i2, i1) -> i3
+// CHECK-NEXT:    %4 = comb.concat %c, %b, %a : (i1, i1, i1) -> i3
+// CHECK-NEXT:    hw.output %1, %1, %3, %4 : i1, i1, i3, i3
+// CHECK-NEXT:  }
+hw.module @associative(%a: i1, %b: i1, %c: i1) -> (%x: i1, %y: i1, %z: i3, %w: i3) {
+  %0 = comb.or %a, %b : i1
+  %1 = comb.or %c, %0 : i1
+  %2 = comb.or %b, %c, %a : i1
+  %3 = comb.concat %a, %b : (i1, i1) -> i2
+  %4 = comb.concat %3, %c : (i2, i1) -> i3
+  %5 = comb.concat %a, %b, %c : (i1, i1, i1) -> i3
+  %6 = comb.concat %c, %b, %a : (i1, i1, i1) -> i3
+  hw.output %1, %2, %5, %6 : i1, i1, i3, i3
+}
+
+// Operations with side effects and in nested regions are left alone.
+// CHECK-LABEL: hw.module @nested(%clock: i1, %a: i1, %b: i1) {
+// CHECK-NEXT:    %0 = comb.xor %a, %b : i1
+// CHECK-NEXT:    sv.always posedge %clock {
+// CHECK-NEXT:      %1 = comb.xor %b, %a : i1
+// CHECK-NEXT:      sv.fwrite "%x %x"(%0, %1) : i1, i1
+// CHECK-NEXT:    }
+hw.module @nested(%clock: i1, %a: i1, %b: i1) {
+  %0 = comb.xor %a, %b : i1
+  sv.always posedge %clock {
+    %1 = comb.xor %b, %a : i1
+    sv.fwrite "%x %x"(%0, %1) : i1, i1
+  }
+  hw.output
+}
@@ -253,6 +253,47 @@ hw.module @always_basic(%arg0: i1, %arg1: i1) {
 }
 
 
+// Merged always blocks are simplified again, which merges their ifs.
+// CHECK-LABEL: hw.module @always_revisit(%arg0: i1, %arg1: i1, %arg2: i1) {
+// CHECK-NEXT:    sv.always posedge %arg0 {
+// CHECK-NEXT:      sv.if %arg2 {
+// CHECK-NEXT:        sv.fwrite "A1"
+// CHECK-NEXT:        sv.fwrite "A2"
+// CHECK-NEXT:      }
+// CHECK-NEXT:    }
+// CHECK-NEXT:    sv.always posedge %arg1 {
+// CHECK-NEXT:      sv.if %arg2 {
+// CHECK-NEXT:        sv.fwrite "B1"
+// CHECK-NEXT:        sv.fwrite "B2"
+// CHECK-NEXT:      }
+// CHECK-NEXT:    }
+// CHECK-NEXT:    hw.output
+// CHECK-NEXT:  }
+hw.module @always_revisit(%arg0: i1, %arg1: i1, %arg2: i1) {
+  sv.always posedge %arg0 {
+    sv.if %arg2 {
+      sv.fwrite "A1"
+    }
+  }
+  sv.always posedge %arg1 {
+    sv.if %arg2 {
+      sv.fwrite "B1"
+    }
+  }
+  sv.always posedge %arg0 {
+    sv.if %arg2 {
+      sv.fwrite "A2"
+    }
+  }
+  sv.always posedge %arg1 {
+    sv.if %arg2 {
+      sv.fwrite "B2"
+    }
+  }
+  hw.output
+}
+
+
 // CHECK-LABEL: hw.module @alwayscomb_basic(
 hw.module @alwayscomb_basic(%a: i1, %b: i1) -> (%x: i1, %y: i1) {
   %w1 = sv.wire : !hw.inout<i1>
@@ -0,0 +1,34 @@
+// RUN: rm -rf %t.cache %t.log %t.dir1 %t.dir2
+// RUN: mkdir %t.dir1 %t.dir2
+
+// The first run calls the generator and stores its output and the file it
+// wrote in the cache.
+// RUN: cd %t.dir1 && circt-opt -hw-generator-callout='schema-name=Schema_Name generator-executable=%S/Inputs/record-generator.sh generator-executable-arguments=%t.log generator-cache-dir=%t.cache' %s | FileCheck %s
+// RUN: FileCheck %s --check-prefix=FILE < %t.dir1/sampleModuleName.v
+// RUN: FileCheck %s --check-prefix=LOG1 < %t.log
+
+// The second run reuses them, and puts the file back if it was removed.
+// RUN: rm %t.dir1/sampleModuleName.v
+// RUN: cd %t.dir1 && circt-opt -hw-generator-callout='schema-name=Schema_Name generator-executable=%S/Inputs/record-generator.sh generator-executable-arguments=%t.log generator-cache-dir=%t.cache' %s | FileCheck %s
+// RUN: FileCheck %s --check-prefix=FILE < %t.dir1/sampleModuleName.v
+// RUN: FileCheck %s --check-prefix=LOG1 < %t.log
+
+// A run in another working directory calls the generator again, so that the
+// file is written there.
+// RUN: cd %t.dir2 && circt-opt -hw-generator-callout='schema-name=Schema_Name generator-executable=%S/Inputs/record-generator.sh generator-executable-arguments=%t.log generator-cache-dir=%t.cache' %s | FileCheck %s
+// RUN: FileCheck %s --check-prefix=FILE < %t.dir2/sampleModuleName.v
+// RUN: FileCheck %s --check-prefix=LOG2 < %t.log
+
+// CHECK: hw.module.extern @sampleModuleName(%clock: i1) -> (%data: i16) attributes {filenames = "sampleModuleName.v"}
+// FILE: module sampleModuleName; endmodule
+
+// LOG1: --moduleName sampleModuleName --port1 10
+// LOG1-NOT: --moduleName
+
+// LOG2-COUNT-2: --moduleName sampleModuleName --port1 10
+// LOG2-NOT: --moduleName
+
+module {
+  hw.generator.schema @SchemaVar, "Schema_Name", ["port1"]
+  hw.module.generated @sampleModuleName, @SchemaVar(%clock: i1) -> (%data: i16) attributes {port1 = 10 : i64}
+}
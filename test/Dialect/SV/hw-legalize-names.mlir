@@ -107,3 +107,12 @@ hw.module @InstanceWithCollisions(%a: i1) {
 hw.module.extern @inout_0 () -> ()
 hw.module.extern @inout_1 () -> ()
 hw.module.extern @inout_2 () -> ()
+
+// The upper case macro names used in the emitted Verilog are reserved too.
+// CHECK-LABEL: hw.module @TestReservedMacroNames
+// CHECK-SAME: (%RANDOM_{{[0-9]+}}: i1) -> (%SYNTHESIS_{{[0-9]+}}: i1)
+hw.module @TestReservedMacroNames(%RANDOM: i1) -> (%SYNTHESIS: i1) {
+  // CHECK: %PRINTF_COND_{{[0-9]+}} = sv.wire
+  %PRINTF_COND = sv.wire : !hw.inout<i1>
+  hw.output %RANDOM : i1
+}
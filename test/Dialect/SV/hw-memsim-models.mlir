@@ -0,0 +1,50 @@
+// RUN: circt-opt -hw-memory-sim='model=single-process' %s | FileCheck %s --check-prefix=SINGLE
+// RUN: circt-opt -hw-memory-sim='model=sparse' %s | FileCheck %s --check-prefix=SPARSE
+// RUN: circt-opt -hw-memory-sim='sparse-depth=16' %s | FileCheck %s --check-prefix=DEPTH
+
+hw.generator.schema @FIRRTLMem, "FIRRTL_Memory", ["depth", "numReadPorts", "numWritePorts", "numReadWritePorts", "readLatency", "writeLatency", "width", "readUnderWrite"]
+
+hw.module @top(%clock: i1, %clock2: i1, %en: i1, %addr: i4, %addr2: i6, %data: i16) -> (%out1: i16, %out2: i16) {
+  %true = hw.constant true
+  %0 = hw.instance "shared" @FIRRTLMem_1_0_1_16_10_1_1_0(%clock, %en, %addr, %clock, %en, %addr, %true, %data) : (i1, i1, i4, i1, i1, i4, i1, i16) -> (i16)
+  %1 = hw.instance "split" @FIRRTLMem_1_0_1_16_40_0_1_0(%clock, %en, %addr2, %clock2, %en, %addr2, %true, %data) : (i1, i1, i6, i1, i1, i6, i1, i16) -> (i16)
+  hw.output %0, %1 : i16, i16
+}
+
+hw.module.generated @FIRRTLMem_1_0_1_16_10_1_1_0, @FIRRTLMem(%ro_clock_0: i1, %ro_en_0: i1, %ro_addr_0: i4, %wo_clock_0: i1, %wo_en_0: i1, %wo_addr_0: i4, %wo_mask_0: i1, %wo_data_0: i16) -> (%ro_data_0: i16) attributes {depth = 10 : i64, numReadPorts = 1 : ui32, numReadWritePorts = 0 : ui32, numWritePorts = 1 : ui32, readLatency = 1 : ui32, readUnderWrite = 0 : ui32, width = 16 : ui32, writeLatency = 1 : ui32}
+
+hw.module.generated @FIRRTLMem_1_0_0_8_1_0_1_0, @FIRRTLMem(%ro_clock_0: i1, %ro_en_0: i1, %ro_addr_0: i0) -> (%ro_data_0: i8) attributes {depth = 1 : i64, numReadPorts = 1 : ui32, numReadWritePorts = 0 : ui32, numWritePorts = 0 : ui32, readLatency = 0 : ui32, readUnderWrite = 0 : ui32, width = 8 : ui32, writeLatency = 1 : ui32}
+
+hw.module.generated @FIRRTLMem_1_0_1_16_40_0_1_0, @FIRRTLMem(%ro_clock_0: i1, %ro_en_0: i1, %ro_addr_0: i6, %wo_clock_0: i1, %wo_en_0: i1, %wo_addr_0: i6, %wo_mask_0: i1, %wo_data_0: i16) -> (%ro_data_0: i16) attributes {depth = 40 : i64, numReadPorts = 1 : ui32, numReadWritePorts = 0 : ui32, numWritePorts = 1 : ui32, readLatency = 0 : ui32, readUnderWrite = 0 : ui32, width = 16 : ui32, writeLatency = 1 : ui32}
+
+// All the clocks of @shared are the same, so its ports and pipeline stages
+// share a single process.
+// SINGLE-LABEL: hw.module @FIRRTLMem_1_0_1_16_10_1_1_0
+// SINGLE:       %Memory = sv.reg  : !hw.inout<uarray<10xi16>>
+// SINGLE-COUNT-1: sv.alwaysff(posedge %ro_clock_0)
+// SINGLE-NOT:   sv.alwaysff
+// SINGLE:       hw.output
+
+// @split is driven by two distinct clocks, so it keeps a process per port.
+// SINGLE-LABEL: hw.module @FIRRTLMem_1_0_1_16_40_0_1_0
+// SINGLE:       sv.alwaysff(posedge %wo_clock_0)
+
+// SPARSE-LABEL: hw.module @FIRRTLMem_1_0_1_16_10_1_1_0
+// SPARSE:       sv.verbatim "reg [15:0] FIRRTLMem_1_0_1_16_10_1_1_0 [bit [3:0]];"
+// SPARSE:       sv.verbatim.expr "FIRRTLMem_1_0_1_16_10_1_1_0[{{[{][{]0[}][}]}}]"
+// SPARSE:       sv.alwaysff(posedge %ro_clock_0)
+// SPARSE:       sv.verbatim "FIRRTLMem_1_0_1_16_10_1_1_0[{{[{][{]0[}][}]}}] <= {{[{][{]1[}][}]}};"(%{{.+}}, %{{.+}})
+// SPARSE-NOT:   sv.alwaysff
+
+// A memory with a 0-bit address holds a single word in a regular array.
+// SPARSE-LABEL: hw.module @FIRRTLMem_1_0_0_8_1_0_1_0
+// SPARSE:       %Memory = sv.reg  : !hw.inout<uarray<1xi8>>
+// SPARSE-NOT:   sv.verbatim
+// SPARSE:       hw.output
+
+// Only the memory deeper than the threshold is sparse.
+// DEPTH-LABEL: hw.module @FIRRTLMem_1_0_1_16_10_1_1_0
+// DEPTH:       %Memory = sv.reg  : !hw.inout<uarray<10xi16>>
+// DEPTH-LABEL: hw.module @FIRRTLMem_1_0_1_16_40_0_1_0
+// DEPTH:       sv.verbatim "reg [15:0] FIRRTLMem_1_0_1_16_40_0_1_0 [bit [5:0]];"
+// DEPTH:       sv.alwaysff(posedge %wo_clock_0)
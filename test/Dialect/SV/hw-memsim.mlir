@@ -80,3 +80,17 @@ hw.module.generated @FIRRTLMem_1_1_1_16_10_2_4_0, @FIRRTLMem(%ro_clock_0: i1, %r
 //CHECK-NEXT:    }
 //CHECK-NEXT:    %7 = sv.read_inout %6 : !hw.inout<i4>
 //CHECK-NEXT:    %8 = sv.array_index_inout %Memory[%7] : !hw.inout<uarray<10xi16>>, i4
+
+// Generated memories identical to one implemented already share its
+// implementation.
+//CHECK-LABEL: @shared
+hw.module @shared(%clock: i1, %r0en: i1, %mode: i1, %data0: i16) -> (%data1: i16, %data2: i16) {
+  %true = hw.constant true
+  %c0_i4 = hw.constant 0 : i4
+  //CHECK: hw.instance "tmp42" @FIRRTLMem_1_1_1_16_10_0_1_0
+  %tmp42.ro_data_0, %tmp42.rw_rdata_0 = hw.instance "tmp42" @FIRRTLMem_shared(%clock, %r0en, %c0_i4, %clock, %r0en, %c0_i4, %mode, %true, %data0, %clock, %r0en, %c0_i4, %true, %data0) : (i1, i1, i4, i1, i1, i4, i1, i1, i16, i1, i1, i4, i1, i16) -> (i16, i16)
+  hw.output %tmp42.ro_data_0, %tmp42.rw_rdata_0 : i16, i16
+}
+
+//CHECK-NOT: @FIRRTLMem_shared
+hw.module.generated @FIRRTLMem_shared, @FIRRTLMem(%ro_clock_0: i1, %ro_en_0: i1, %ro_addr_0: i4, %rw_clock_0: i1, %rw_en_0: i1, %rw_addr_0: i4, %rw_wmode_0: i1, %rw_wmask_0: i1, %rw_wdata_0: i16, %wo_clock_0: i1, %wo_en_0: i1, %wo_addr_0: i4, %wo_mask_0: i1, %wo_data_0: i16) -> (%ro_data_0: i16, %rw_rdata_0: i16) attributes {depth = 10 : i64, numReadPorts = 1 : ui32, numReadWritePorts = 1 : ui32, numWritePorts = 1 : ui32, readLatency = 0 : ui32, readUnderWrite = 0 : ui32, width = 16 : ui32, writeLatency = 1 : ui32}
@@ -0,0 +1,9 @@
+// RUN: circt-opt %s -seq-retime='clock-period=2' -verify-diagnostics
+
+// The adders alone take longer than the period.
+// expected-error @+1 {{cannot retime to a clock period of 2}}
+hw.module @tooFast(%clk: i1, %a: i8, %b: i8) -> (%o: i8) {
+  %0 = comb.add %a, %b : i8
+  %1 = seq.compreg %0, %clk : i8
+  hw.output %1 : i8
+}
@@ -0,0 +1,46 @@
+// RUN: circt-opt %s -seq-retime | FileCheck %s
+// RUN: circt-opt %s -seq-retime='clock-period=4' | FileCheck %s
+
+// The register at the output is moved between the adders.
+// CHECK-LABEL: hw.module @backward
+// CHECK-NEXT:    %[[ADD0:.+]] = comb.add %a, %b : i8
+// CHECK-NEXT:    %[[ADD1:.+]] = comb.add %[[REG0:.+]], %[[REG1:.+]] : i8
+// CHECK-NEXT:    %[[REG0]] = seq.compreg %[[ADD0]], %clk : i8
+// CHECK-NEXT:    %[[REG1]] = seq.compreg %b, %clk : i8
+// CHECK-NEXT:    hw.output %[[ADD1]] : i8
+hw.module @backward(%clk: i1, %a: i8, %b: i8) -> (%o: i8) {
+  %0 = comb.add %a, %b : i8
+  %1 = comb.add %0, %b : i8
+  %2 = seq.compreg %1, %clk : i8
+  hw.output %2 : i8
+}
+
+// The registers at the inputs are moved between the adders.
+// CHECK-LABEL: hw.module @forward
+// CHECK-NEXT:    %[[ADD0:.+]] = comb.add %a, %b : i8
+// CHECK-NEXT:    %[[ADD1:.+]] = comb.add %[[REG0:.+]], %[[REG1:.+]] : i8
+// CHECK-NEXT:    %[[REG0]] = seq.compreg %[[ADD0]], %clk : i8
+// CHECK-NEXT:    %[[REG1]] = seq.compreg %b, %clk : i8
+// CHECK-NEXT:    hw.output %[[ADD1]] : i8
+hw.module @forward(%clk: i1, %a: i8, %b: i8) -> (%o: i8) {
+  %0 = seq.compreg %a, %clk : i8
+  %1 = seq.compreg %b, %clk : i8
+  %2 = comb.add %0, %1 : i8
+  %3 = comb.add %2, %1 : i8
+  hw.output %3 : i8
+}
+
+// Registers with a reset are not moved.
+// CHECK-LABEL: hw.module @reset
+// CHECK-NEXT:    %c0_i8 = hw.constant 0 : i8
+// CHECK-NEXT:    %0 = comb.add %a, %b : i8
+// CHECK-NEXT:    %1 = comb.add %0, %b : i8
+// CHECK-NEXT:    %2 = seq.compreg %1, %clk, %rst, %c0_i8  : i8
+// CHECK-NEXT:    hw.output %2 : i8
+hw.module @reset(%clk: i1, %rst: i1, %a: i8, %b: i8) -> (%o: i8) {
+  %c0_i8 = hw.constant 0 : i8
+  %0 = comb.add %a, %b : i8
+  %1 = comb.add %0, %b : i8
+  %2 = seq.compreg %1, %clk, %rst, %c0_i8 : i8
+  hw.output %2 : i8
+}
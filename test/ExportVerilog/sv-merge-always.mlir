@@ -0,0 +1,35 @@
+// RUN: circt-translate --lowering-options=profile=simulation --export-verilog %s | FileCheck %s
+// RUN: circt-translate --lowering-options=mergeAlways --export-verilog %s | FileCheck %s --check-prefix=MERGE
+
+// CHECK-LABEL: module MergeAlways(
+hw.module @MergeAlways(%clock: i1, %clock2: i1, %a: i8, %b: i8) {
+  %r1 = sv.reg : !hw.inout<i8>
+  %r2 = sv.reg : !hw.inout<i8>
+  %r3 = sv.reg : !hw.inout<i8>
+
+  // CHECK:      always @(posedge clock) begin
+  // CHECK-NEXT:   r1 <= a;
+  // CHECK-NEXT:   r2 <= b;
+  // CHECK-NEXT: end
+  // CHECK-NEXT: always @(posedge clock2)
+  // CHECK-NEXT:   r3 <= a;
+  // CHECK-NOT:  always
+  sv.alwaysff(posedge %clock) {
+    sv.passign %r1, %a : i8
+  }
+  %0 = comb.and %clock, %clock2 : i1
+  sv.alwaysff(posedge %clock) {
+    sv.passign %r2, %b : i8
+  }
+  sv.alwaysff(posedge %clock2) {
+    sv.passign %r3, %a : i8
+  }
+  sv.always posedge %0 {
+  }
+}
+
+// The simulation profile leaves the clock expression inline.
+// CHECK: always @(posedge clock & clock2)
+
+// MERGE: wire [[CLOCK:.+]] = clock & clock2;
+// MERGE: always @(posedge [[CLOCK]])
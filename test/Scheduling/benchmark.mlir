@@ -0,0 +1,24 @@
+// RUN: circt-opt %s -test-scheduling-benchmark="sizes=20,50" -o /dev/null | FileCheck %s
+// RUN: circt-opt %s -test-scheduling-benchmark="sizes=50 kinds=dag max-simplex-size=20" -o /dev/null | FileCheck %s -check-prefix=NOSIMPLEX
+// RUN: not circt-opt %s -test-scheduling-benchmark="sizes=20 kinds=tree" -o /dev/null 2>&1 | FileCheck %s -check-prefix=ERROR
+
+// CHECK:      kind size scheduler status time(us) mem(KiB) length ii
+// CHECK-NEXT: dag 20 asap ok {{[0-9]+}} {{[0-9]+}} [[DAG20:[0-9]+]] -
+// CHECK-NEXT: dag 20 simplex ok {{[0-9]+}} {{[0-9]+}} [[DAG20]] -
+// CHECK-NEXT: dag 20 dc ok {{[0-9]+}} {{[0-9]+}} [[DAG20]] -
+// CHECK-NEXT: dag 50 asap ok {{[0-9]+}} {{[0-9]+}} [[DAG50:[0-9]+]] -
+// CHECK-NEXT: dag 50 simplex ok {{[0-9]+}} {{[0-9]+}} [[DAG50]] -
+// CHECK-NEXT: dag 50 dc ok {{[0-9]+}} {{[0-9]+}} [[DAG50]] -
+// CHECK-NEXT: recurrence 20 simplex ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} [[II20:[0-9]+]]
+// CHECK-NEXT: recurrence 20 dc ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} [[II20]]
+// CHECK-NEXT: recurrence 50 simplex ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} [[II50:[0-9]+]]
+// CHECK-NEXT: recurrence 50 dc ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} [[II50]]
+// CHECK-NEXT: shared 20 list ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} -
+// CHECK-NEXT: shared 20 modulo ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} {{[0-9]+}}
+// CHECK-NEXT: shared 50 list ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} -
+// CHECK-NEXT: shared 50 modulo ok {{[0-9]+}} {{[0-9]+}} {{[0-9]+}} {{[0-9]+}}
+
+// NOSIMPLEX:      dag 50 asap ok
+// NOSIMPLEX-NEXT: dag 50 dc ok
+
+// ERROR: error: unknown benchmark kind 'tree'
@@ -0,0 +1,44 @@
+// RUN: circt-opt %s -test-chaining-problem -verify-diagnostics -split-input-file
+
+// expected-error@+2 {{Missing delays for operator type 'add'}}
+// expected-error@+1 {{problem check failed}}
+func @missing_delays() attributes {
+  operatortypes = [ { name = "add", latency = 0 } ]
+  } {
+  return { opr = "add" }
+}
+
+// -----
+
+// expected-error@+2 {{Incoming & outgoing delay must be equal for zero-latency operator type 'add'}}
+// expected-error@+1 {{problem check failed}}
+func @unequal_delays() attributes {
+  operatortypes = [ { name = "add", latency = 0, incdelay = 1.0, outdelay = 2.0 } ]
+  } {
+  return { opr = "add" }
+}
+
+// -----
+
+// expected-error@+2 {{Precedence violated in cycle 0 for dependence}}
+// expected-error@+1 {{problem verification failed}}
+func @chained_too_early(%a0 : i32) -> i32 attributes {
+  operatortypes = [ { name = "add", latency = 0, incdelay = 2.0, outdelay = 2.0 } ]
+  } {
+  %0 = addi %a0, %a0 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 0.0 } : i32
+  %1 = addi %0, %0 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 1.0 } : i32
+  return { problemStartTime = 1, problemStartTimeInCycle = 0.0 } %1 : i32
+}
+
+// -----
+
+// expected-error@+1 {{problem verification failed}}
+func @too_long(%a0 : i32) -> i32 attributes {
+  cycletime = 3.0,
+  operatortypes = [ { name = "add", latency = 0, incdelay = 2.0, outdelay = 2.0 } ]
+  } {
+  %0 = addi %a0, %a0 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 0.0 } : i32
+  // expected-error@+1 {{Operation exceeds the cycle time}}
+  %1 = addi %0, %0 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 2.0 } : i32
+  return { problemStartTime = 1, problemStartTimeInCycle = 0.0 } %1 : i32
+}
@@ -0,0 +1,42 @@
+// RUN: circt-opt %s -test-chaining-problem -allow-unregistered-dialect
+// RUN: circt-opt %s -test-chaining-scheduler -allow-unregistered-dialect | FileCheck %s -check-prefix=CHAIN
+
+// CHAIN-LABEL: adder_chain
+func @adder_chain(%arg0 : i32, %arg1 : i32) -> i32 attributes {
+  cycletime = 5.0, operatortypes = [
+    { name = "add", latency = 0, incdelay = 2.0, outdelay = 2.0 },
+    { name = "mul", latency = 3, incdelay = 2.5, outdelay = 3.75 }
+  ] } {
+  // CHAIN-NEXT: chainingStartTime = 0 : i32, chainingStartTimeInCycle = 0.000000e+00 : f32
+  %0 = addi %arg0, %arg1 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 0.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 0 : i32, chainingStartTimeInCycle = 2.000000e+00 : f32
+  %1 = addi %0, %arg1 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 2.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 1 : i32, chainingStartTimeInCycle = 0.000000e+00 : f32
+  %2 = addi %1, %arg1 { opr = "add", problemStartTime = 1, problemStartTimeInCycle = 0.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 1 : i32, chainingStartTimeInCycle = 2.000000e+00 : f32
+  %3 = muli %2, %arg1 { opr = "mul", problemStartTime = 1, problemStartTimeInCycle = 2.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 5 : i32, chainingStartTimeInCycle = 0.000000e+00 : f32
+  %4 = addi %3, %arg1 { opr = "add", problemStartTime = 5, problemStartTimeInCycle = 0.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 5 : i32, chainingStartTimeInCycle = 2.000000e+00 : f32
+  return { problemStartTime = 5, problemStartTimeInCycle = 2.0 } %4 : i32
+}
+
+// Without a cycle time, combinational operators chain without bound, and
+// auxiliary dependences only order the operations.
+// CHAIN-LABEL: unbounded
+func @unbounded(%arg0 : i32) -> i32 attributes {
+  auxdeps = [ [0,2] ],
+  operatortypes = [
+    { name = "add", latency = 0, incdelay = 2.0, outdelay = 2.0 }
+  ] } {
+  // CHAIN-NEXT: chainingStartTime = 0 : i32, chainingStartTimeInCycle = 0.000000e+00 : f32
+  %0 = addi %arg0, %arg0 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 0.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 0 : i32, chainingStartTimeInCycle = 2.000000e+00 : f32
+  %1 = addi %0, %0 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 2.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 0 : i32, chainingStartTimeInCycle = 0.000000e+00 : f32
+  %2 = addi %arg0, %arg0 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 0.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 0 : i32, chainingStartTimeInCycle = 4.000000e+00 : f32
+  %3 = addi %1, %2 { opr = "add", problemStartTime = 0, problemStartTimeInCycle = 4.0 } : i32
+  // CHAIN-NEXT: chainingStartTime = 0 : i32, chainingStartTimeInCycle = 6.000000e+00 : f32
+  return { problemStartTime = 0, problemStartTimeInCycle = 6.0 } %3 : i32
+}
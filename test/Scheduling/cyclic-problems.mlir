@@ -1,8 +1,11 @@
 // RUN: circt-opt %s -test-cyclic-problem
 // RUN: circt-opt %s -test-simplex-scheduler | FileCheck %s -check-prefix=SIMPLEX
+// RUN: circt-opt %s -test-difference-constraint-scheduler | FileCheck %s -check-prefix=DC
 
 // SIMPLEX-LABEL: cyclic
+// DC-LABEL: cyclic
 // SIMPLEX-SAME: simplexInitiationInterval = 2
+// DC-SAME: dcInitiationInterval = 2
 func @cyclic(%a1 : i32, %a2 : i32) -> i32 attributes {
   problemInitiationInterval = 2,
   auxdeps = [ [4,1,1], [4,2,2] ],
@@ -19,11 +22,15 @@ func @cyclic(%a1 : i32, %a2 : i32) -> i32 attributes {
   // SIMPLEX-NEXT: simplexStartTime = 2
   %4 = divi_unsigned %2, %0 { problemStartTime = 3 } : i32
   // SIMPLEX-NEXT: simplexStartTime = 3
+  // DC: return
+  // DC-SAME: dcStartTime = 3
   return { problemStartTime = 4 } %3 : i32
 }
 
 // SIMPLEX-LABEL: mobility
+// DC-LABEL: mobility
 // SIMPLEX-SAME: simplexInitiationInterval = 3
+// DC-SAME: dcInitiationInterval = 3
 func @mobility() attributes {
   problemInitiationInterval = 3,
   auxdeps = [
@@ -46,11 +53,15 @@ func @mobility() attributes {
   // SIMPLEX-NEXT: simplexStartTime = 6
   %5 = constant { problemStartTime = 6} 5 : i32
   // SIMPLEX-NEXT: simplexStartTime = 10
+  // DC: return
+  // DC-SAME: dcStartTime = 10
   return { problemStartTime = 10 }
 }
 
 // SIMPLEX-LABEL: interleaved_cycles
+// DC-LABEL: interleaved_cycles
 // SIMPLEX-SAME: simplexInitiationInterval = 4
+// DC-SAME: dcInitiationInterval = 4
 func @interleaved_cycles() attributes {
   problemInitiationInterval = 4,
   auxdeps = [
@@ -82,5 +93,7 @@ func @interleaved_cycles() attributes {
   // SIMPLEX-NEXT: simplexStartTime = 23
   %9 = constant { problemStartTime = 23 } 9 : i32
   // SIMPLEX-NEXT: simplexStartTime = 33
+  // DC: return
+  // DC-SAME: dcStartTime = 33
   return { problemStartTime = 33 }
 }
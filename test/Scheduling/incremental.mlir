@@ -0,0 +1,60 @@
+// RUN: circt-opt %s -test-difference-constraint-scheduler=acyclic -split-input-file | FileCheck %s -check-prefix=ACYCLIC
+// RUN: circt-opt %s -test-difference-constraint-scheduler -split-input-file | FileCheck %s -check-prefix=CYCLIC
+
+// ACYCLIC-LABEL: changes
+// CYCLIC-LABEL: changes
+// CYCLIC-SAME: dcInitiationInterval = 1
+func @changes() attributes {
+  auxdeps = [ [0,1], [1,2], [0,3] ],
+  operatortypes = [ { name = "op", latency = 2 } ],
+  removedauxdeps = [ [1,2] ],
+  addedauxdeps = [ [3,2] ],
+  changedlatencies = [ { name = "op", latency = 3 } ]
+  } {
+  // ACYCLIC-NEXT: dcStartTime = 0
+  %0 = constant { opr = "op" } 0 : i32
+  // ACYCLIC-NEXT: dcStartTime = 3
+  %1 = constant 1 : i32
+  // ACYCLIC-NEXT: dcStartTime = 6
+  %2 = constant 2 : i32
+  // ACYCLIC-NEXT: dcStartTime = 3
+  %3 = constant { opr = "op" } 3 : i32
+  // ACYCLIC-NEXT: dcStartTime = 0
+  return
+}
+
+// -----
+
+// CYCLIC-LABEL: increased_ii
+// CYCLIC-SAME: dcInitiationInterval = 6
+func @increased_ii() attributes {
+  auxdeps = [ [0,1], [1,2], [2,0,1] ],
+  changedlatencies = [ { name = "unit", latency = 2 } ]
+  } {
+  // CYCLIC-NEXT: dcStartTime = 0
+  %0 = constant 0 : i32
+  // CYCLIC-NEXT: dcStartTime = 2
+  %1 = constant 1 : i32
+  // CYCLIC-NEXT: dcStartTime = 4
+  %2 = constant 2 : i32
+  // CYCLIC-NEXT: dcStartTime = 0
+  return
+}
+
+// -----
+
+// CYCLIC-LABEL: decreased_ii
+// CYCLIC-SAME: dcInitiationInterval = 2
+func @decreased_ii() attributes {
+  auxdeps = [ [0,1], [1,2], [2,0,1], [1,0,1] ],
+  removedauxdeps = [ [2,0] ]
+  } {
+  // CYCLIC-NEXT: dcStartTime = 0
+  %0 = constant 0 : i32
+  // CYCLIC-NEXT: dcStartTime = 1
+  %1 = constant 1 : i32
+  // CYCLIC-NEXT: dcStartTime = 2
+  %2 = constant 2 : i32
+  // CYCLIC-NEXT: dcStartTime = 0
+  return
+}
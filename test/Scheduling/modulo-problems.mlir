@@ -0,0 +1,40 @@
+// RUN: circt-opt %s -test-modulo-scheduler | FileCheck %s -check-prefix=MODULO
+
+// MODULO-LABEL: recurrence
+// MODULO-SAME: moduloInitiationInterval = 7
+func @recurrence(%a0 : i32, %a1 : i32) -> i32 attributes {
+  auxdeps = [ [2,0,1] ],
+  operatortypes = [ { name = "mul", latency = 3, limit = 1 } ]
+  } {
+  // MODULO-NEXT: moduloStartTime = 0
+  %0 = muli %a0, %a1 { opr = "mul" } : i32
+  // MODULO-NEXT: moduloStartTime = 3
+  %1 = muli %0, %a1 { opr = "mul" } : i32
+  // MODULO-NEXT: moduloStartTime = 6
+  %2 = addi %1, %a0 : i32
+  // MODULO-NEXT: moduloStartTime = 7
+  return %2 : i32
+}
+
+// MODULO-LABEL: resources
+// MODULO-SAME: moduloInitiationInterval = 4
+func @resources(%a0 : i32, %a1 : i32, %a2 : i32, %a3 : i32) -> i32 attributes {
+  operatortypes = [ { name = "mul", latency = 3, limit = 1 } ]
+  } {
+  // MODULO-NEXT: moduloStartTime = 0
+  %0 = muli %a0, %a1 { opr = "mul" } : i32
+  // MODULO-NEXT: moduloStartTime = 1
+  %1 = muli %a1, %a2 { opr = "mul" } : i32
+  // MODULO-NEXT: moduloStartTime = 2
+  %2 = muli %a2, %a3 { opr = "mul" } : i32
+  // MODULO-NEXT: moduloStartTime = 3
+  %3 = muli %a3, %a0 { opr = "mul" } : i32
+  // MODULO-NEXT: moduloStartTime = 4
+  %4 = addi %0, %1 : i32
+  // MODULO-NEXT: moduloStartTime = 6
+  %5 = addi %2, %3 : i32
+  // MODULO-NEXT: moduloStartTime = 7
+  %6 = addi %4, %5 : i32
+  // MODULO-NEXT: moduloStartTime = 8
+  return %6 : i32
+}
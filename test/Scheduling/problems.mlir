@@ -1,9 +1,11 @@
 // RUN: circt-opt %s -test-scheduling-problem -allow-unregistered-dialect
 // RUN: circt-opt %s -test-asap-scheduler -allow-unregistered-dialect | FileCheck %s -check-prefix=ASAP
 // RUN: circt-opt %s -test-simplex-scheduler=acyclic -allow-unregistered-dialect | FileCheck %s -check-prefix=SIMPLEX
+// RUN: circt-opt %s -test-difference-constraint-scheduler=acyclic -allow-unregistered-dialect | FileCheck %s -check-prefix=DC
 
 // ASAP-LABEL: unit_latencies
 // SIMPLEX-LABEL: unit_latencies
+// DC-LABEL: unit_latencies
 func @unit_latencies(%a1 : i32, %a2 : i32, %a3 : i32, %a4 : i32) -> i32 {
   // ASAP-NEXT: asapStartTime = 0
   %0 = addi %a1, %a2 { problemStartTime = 0 } : i32
@@ -20,6 +22,8 @@ func @unit_latencies(%a1 : i32, %a2 : i32, %a3 : i32, %a4 : i32) -> i32 {
   // ASAP-NEXT: asapStartTime = 5
   %6 = "more.operands"(%3, %4, %5) { problemStartTime = 6 } : (i32, i32, i32) -> i32
   // ASAP-NEXT: asapStartTime = 6
+  // DC: return
+  // DC-SAME: dcStartTime = 6
   // SIMPLEX: return
   // SIMPLEX-SAME: simplexStartTime = 6
   return { problemStartTime = 7 } %6 : i32
@@ -27,6 +31,7 @@ func @unit_latencies(%a1 : i32, %a2 : i32, %a3 : i32, %a4 : i32) -> i32 {
 
 // ASAP-LABEL: arbitrary_latencies
 // SIMPLEX-LABEL: arbitrary_latencies
+// DC-LABEL: arbitrary_latencies
 func @arbitrary_latencies(%v : complex<f32>) -> f32 attributes {
   operatortypes = [
     { name = "extr", latency = 0 },
@@ -47,6 +52,8 @@ func @arbitrary_latencies(%v : complex<f32>) -> f32 attributes {
   // ASAP-NEXT: asapStartTime = 9
   %5 = "math.sqrt"(%4) { opr = "sqrt", problemStartTime = 50 } : (f32) -> f32
   // ASAP-NEXT: asapStartTime = 19
+  // DC: return
+  // DC-SAME: dcStartTime = 19
   // SIMPLEX: return
   // SIMPLEX-SAME: simplexStartTime = 19
   return { problemStartTime = 60 } %5 : f32
@@ -54,6 +61,7 @@ func @arbitrary_latencies(%v : complex<f32>) -> f32 attributes {
 
 // ASAP-LABEL: auxiliary_dependences
 // SIMPLEX-LABEL: auxiliary_dependences
+// DC-LABEL: auxiliary_dependences
 func @auxiliary_dependences() attributes { auxdeps = [
     [0,1], [0,2], [2,3], [3,4], [3,6], [4,5], [5,6]
   ] } {
@@ -70,6 +78,8 @@ func @auxiliary_dependences() attributes { auxdeps = [
   // ASAP-NEXT: asapStartTime = 4
   %5 = constant { problemStartTime = 5 } 5 : i32
   // ASAP-NEXT: asapStartTime = 5
+  // DC: return
+  // DC-SAME: dcStartTime = 5
   // SIMPLEX: return
   // SIMPLEX-SAME: simplexStartTime = 5
   return { problemStartTime = 6 }
@@ -1,14 +1,22 @@
 // RUN: circt-opt %s -test-spo-problem
+// RUN: circt-opt %s -test-list-scheduler | FileCheck %s -check-prefix=LIST
 
+// LIST-LABEL: full_load
 func @full_load(%a0 : i32, %a1 : i32, %a2 : i32, %a3 : i32, %a4 : i32, %a5 : i32) -> i32 attributes {
   operatortypes = [
     { name = "add", latency = 3, limit = 1}
   ] } {
+  // LIST-NEXT: listStartTime = 1
   %0 = addi %a0, %a1 { opr = "add", problemStartTime = 0 } : i32
+  // LIST-NEXT: listStartTime = 2
   %1 = addi %a1, %a1 { opr = "add", problemStartTime = 1 } : i32
+  // LIST-NEXT: listStartTime = 3
   %2 = addi %a2, %a3 { opr = "add", problemStartTime = 2 } : i32
+  // LIST-NEXT: listStartTime = 4
   %3 = addi %a3, %a4 { opr = "add", problemStartTime = 3 } : i32
+  // LIST-NEXT: listStartTime = 0
   %4 = addi %a4, %a5 { opr = "add", problemStartTime = 4 } : i32
+  // LIST-NEXT: listStartTime = 3
   return { problemStartTime = 7 } %4 : i32
 }
 
@@ -24,15 +32,22 @@ func @partial_load(%a0 : i32, %a1 : i32, %a2 : i32, %a3 : i32, %a4 : i32, %a5 :
   return { problemStartTime = 10 } %4 : i32
 }
 
+// LIST-LABEL: multiple
 func @multiple(%a0 : i32, %a1 : i32, %a2 : i32, %a3 : i32, %a4 : i32, %a5 : i32) -> i32 attributes {
   operatortypes = [
     { name = "slowAdd", latency = 3, limit = 2},
     { name = "fastAdd", latency = 1, limit = 1}
   ] } {
+  // LIST-NEXT: listStartTime = 0
   %0 = addi %a0, %a1 { opr = "slowAdd", problemStartTime = 0 } : i32
+  // LIST-NEXT: listStartTime = 0
   %1 = addi %a1, %a1 { opr = "slowAdd", problemStartTime = 1 } : i32
+  // LIST-NEXT: listStartTime = 1
   %2 = addi %a2, %a3 { opr = "fastAdd", problemStartTime = 0 } : i32
+  // LIST-NEXT: listStartTime = 1
   %3 = addi %a3, %a4 { opr = "slowAdd", problemStartTime = 1 } : i32
+  // LIST-NEXT: listStartTime = 0
   %4 = addi %a4, %a5 { opr = "fastAdd", problemStartTime = 1 } : i32
+  // LIST-NEXT: listStartTime = 1
   return { problemStartTime = 10 } %4 : i32
 }
@@ -0,0 +1,20 @@
+// RUN: printf '5 3\n0xf0 2\n# division by zero\n7 0\n' > %t.stim
+// RUN: circt-cycle-sim %s -stimulus %t.stim | FileCheck %s
+
+// CHECK:      cycle 0: sum=8 diff=2 lt=0 slt=0 sra=0 cat=1283 hi=0 sx=5 par=0 max=5 quot=1
+// CHECK-NEXT: cycle 1: sum=242 diff=238 lt=0 slt=1 sra=252 cat=61442 hi=15 sx=65520 par=0 max=240 quot=248
+// CHECK-NEXT: cycle 2: sum=7 diff=7 lt=0 slt=0 sra=7 cat=1792 hi=0 sx=7 par=1 max=7 quot=0
+hw.module @alu(%a: i8, %b: i8) -> (%sum: i8, %diff: i8, %lt: i1, %slt: i1, %sra: i8, %cat: i16, %hi: i4, %sx: i16, %par: i1, %max: i8, %quot: i8) {
+  %sum = comb.add %a, %b : i8
+  %diff = comb.sub %a, %b : i8
+  %lt = comb.icmp ult %a, %b : i8
+  %slt = comb.icmp slt %a, %b : i8
+  %sra = comb.shrs %a, %b : i8
+  %cat = comb.concat %a, %b : (i8, i8) -> i16
+  %hi = comb.extract %a from 4 : (i8) -> i4
+  %sx = comb.sext %a : (i8) -> i16
+  %par = comb.parity %a : i8
+  %max = comb.mux %lt, %b, %a : i8
+  %quot = comb.divs %a, %b : i8
+  hw.output %sum, %diff, %lt, %slt, %sra, %cat, %hi, %sx, %par, %max, %quot : i8, i8, i1, i1, i8, i16, i4, i16, i1, i8, i8
+}
@@ -0,0 +1,41 @@
+// RUN: circt-cycle-sim %s -dump-program | FileCheck %s --check-prefix=PROGRAM
+// RUN: circt-cycle-sim %s -cycles 18 -trace=false | FileCheck %s --check-prefix=WRAP
+// RUN: printf '1\n0\n0\n1\n0\n' > %t.stim
+// RUN: circt-cycle-sim %s -stimulus %t.stim -cycles 6 | FileCheck %s
+
+hw.module @inc(%a: i4) -> (%b: i4) {
+  %c1 = hw.constant 1 : i4
+  %0 = comb.add %a, %c1 : i4
+  hw.output %0 : i4
+}
+
+// The instance is flattened into the program of the counter, whose register
+// only feeds the combinational logic in the next cycle.
+// PROGRAM:      state: 9 words
+// PROGRAM-NEXT: input rst: %2 : i1
+// PROGRAM-NEXT: output count: %3 : i4
+// PROGRAM-NEXT: const %4 = 0
+// PROGRAM-NEXT: const %7 = 1
+// PROGRAM-NEXT: reg %6 <= %5, reset %2 to %4
+// PROGRAM-NEXT: level 0:
+// PROGRAM-NEXT:   %8 = add %6, %7 : i4
+// PROGRAM-NEXT:   %3 = copy %6 : i4
+// PROGRAM-NEXT: level 1:
+// PROGRAM-NEXT:   %5 = copy %8 : i4
+hw.module @counter(%clk: i1, %rst: i1) -> (%count: i4) {
+  %zero = hw.constant 0 : i4
+  %next = hw.instance "inc" @inc(%count) : (i4) -> i4
+  %count = seq.compreg %next, %clk, %rst, %zero : i4
+  hw.output %count : i4
+}
+
+// WRAP-NOT: cycle 16
+// WRAP:     cycle 17: count=1
+
+// The reset is synchronous, and the last inputs are held.
+// CHECK:      cycle 0: count=0
+// CHECK-NEXT: cycle 1: count=0
+// CHECK-NEXT: cycle 2: count=1
+// CHECK-NEXT: cycle 3: count=2
+// CHECK-NEXT: cycle 4: count=0
+// CHECK-NEXT: cycle 5: count=1
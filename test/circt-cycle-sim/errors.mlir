@@ -0,0 +1,23 @@
+// RUN: not circt-cycle-sim %s -top loop 2>&1 | FileCheck %s --check-prefix=LOOP
+// RUN: not circt-cycle-sim %s -top gated 2>&1 | FileCheck %s --check-prefix=GATED
+// RUN: not circt-cycle-sim %s -top wide 2>&1 | FileCheck %s --check-prefix=WIDE
+
+// LOOP: error: combinational loop through this operation
+// LOOP-NEXT: comb.add
+hw.module @loop(%a: i8) -> (%o: i8) {
+  %0 = comb.add %a, %1 : i8
+  %1 = comb.xor %0, %a : i8
+  hw.output %1 : i8
+}
+
+// GATED: error: register must be clocked by the 'clk' port of the top module
+hw.module @gated(%clk: i1, %en: i1, %a: i8) -> (%o: i8) {
+  %gclk = comb.and %clk, %en : i1
+  %0 = seq.compreg %a, %gclk : i8
+  hw.output %0 : i8
+}
+
+// WIDE: error: cycle simulation only supports integers of up to 64 bits, but got 'i128'
+hw.module @wide(%a: i128) -> (%o: i128) {
+  hw.output %a : i128
+}
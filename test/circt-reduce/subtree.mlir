@@ -0,0 +1,36 @@
+// RUN: circt-reduce %s --test %S/trivial.sh --test-arg firtool | FileCheck %s
+
+// The subtree below @A is removed along with it, instead of turning each of
+// its modules into an extmodule.
+
+// CHECK-LABEL: firrtl.circuit "Foo"
+firrtl.circuit "Foo" {
+  // CHECK-NOT: @C
+  firrtl.module @C(in %x: !firrtl.uint<1>, out %y: !firrtl.uint<1>) {
+    firrtl.connect %y, %x : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK-NOT: @B
+  firrtl.module @B(in %x: !firrtl.uint<1>, out %y: !firrtl.uint<1>) {
+    %c_x, %c_y = firrtl.instance @C {name = "c"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %c_x, %x : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %y, %c_y : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK: firrtl.extmodule @A
+  firrtl.module @A(in %x: !firrtl.uint<1>, out %y: !firrtl.uint<1>) {
+    %b_x, %b_y = firrtl.instance @B {name = "b"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %b_x, %x : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %y, %b_y : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK: firrtl.extmodule @Leaf
+  firrtl.module @Leaf(in %x: !firrtl.uint<1>, out %y: !firrtl.uint<1>) {
+    firrtl.connect %y, %x : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+  // CHECK: firrtl.module @Foo
+  firrtl.module @Foo(in %x: !firrtl.uint<1>, out %y: !firrtl.uint<1>) {
+    %a_x, %a_y = firrtl.instance @A {name = "a"} : !firrtl.uint<1>, !firrtl.uint<1>
+    %x1_x, %x1_y = firrtl.instance @Leaf {name = "x1"} : !firrtl.uint<1>, !firrtl.uint<1>
+    firrtl.connect %a_x, %x : !firrtl.uint<1>, !firrtl.uint<1>
+    // Skip %x1_x to trigger a "sink not fully initialized" warning
+    firrtl.connect %y, %a_y : !firrtl.uint<1>, !firrtl.uint<1>
+  }
+}
@@ -1,4 +1,12 @@
 // RUN: circt-reduce %s --test %S/trivial.sh --test-arg firtool | FileCheck %s
+// RUN: circt-reduce %s --test %S/trivial.sh --test-arg firtool -j 4 | FileCheck %s
+// RUN: rm -f %t.cache
+// RUN: circt-reduce %s --test %S/trivial.sh --test-arg firtool --test-cache %t.cache | FileCheck %s
+// RUN: circt-reduce %s --test %S/trivial.sh --test-arg firtool --test-cache %t.cache | FileCheck %s
+// RUN: FileCheck %s --check-prefix=CACHE < %t.cache
+
+// CACHE: {{[0-9a-f]{32}}} 1 {{[0-9]+}}
+// CACHE: {{[0-9a-f]{32}}} 0 {{[0-9]+}}
 
 firrtl.circuit "Foo" {
   // CHECK: firrtl.extmodule @FooFooFoo
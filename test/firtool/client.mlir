@@ -0,0 +1,6 @@
+// RUN: not firtool-client %s 2>&1 | FileCheck %s --check-prefix=USAGE
+// RUN: not firtool-client --socket=%t.missing.sock %s 2>&1 | FileCheck %s --check-prefix=NO-SERVER
+// UNSUPPORTED: system-windows
+
+// USAGE: usage: firtool-client [--socket=<socket>] <firtool arguments>
+// NO-SERVER: firtool-client: {{.*}}missing.sock
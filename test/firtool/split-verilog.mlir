@@ -8,6 +8,9 @@
 // RUN: FileCheck %s --check-prefix=VERILOG-CUSTOM-1 < %t/custom1.sv
 // RUN: FileCheck %s --check-prefix=VERILOG-CUSTOM-2 < %t/custom2.sv
 // RUN: FileCheck %s --check-prefix=LIST < %t/filelist.f
+// RUN: rm -rf %t.report
+// RUN: firtool %s --format=mlir -split-verilog --lowering-options=emissionReport -o=%t.report
+// RUN: FileCheck %s --check-prefix=REPORT < %t.report/emission-report.json
 
 sv.verbatim "// I'm everywhere"
 sv.ifdef "VERILATOR" {
@@ -53,6 +56,14 @@ sv.verbatim "// Bar" {output_file = {name = "custom2.sv", exclude_from_filelist
 // LIST-NEXT: custom1.sv
 // LIST-NOT:  custom2.sv
 
+// REPORT:      "module": "foo"
+// REPORT-NEXT: "bytes":
+// REPORT-NEXT: "lines":
+// REPORT-NEXT: "temporaries": 0
+// REPORT-NEXT: "textSubstitutions": 0
+// REPORT-NEXT: "timeUs":
+// REPORT:      "module": "bar"
+
 // VERILOG-FOO:       // I'm everywhere
 // VERILOG-FOO-NEXT:  `ifdef VERILATOR
 // VERILOG-FOO-NEXT:    // Hello
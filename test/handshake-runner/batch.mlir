@@ -0,0 +1,15 @@
+// RUN: printf '2 3\n# comment\n\n4 5\n-1 7\n' > %t.batch
+// RUN: handshake-runner %s -batch=%t.batch | FileCheck %s
+// RUN: circt-opt -create-dataflow %s | handshake-runner -batch=%t.batch | FileCheck %s
+// CHECK: 8
+// CHECK-NEXT: 24
+// CHECK-NEXT: -6
+
+module {
+  func @main(%arg0: i32, %arg1: i32) -> i32 {
+    %c2 = constant 2 : i32
+    %0 = muli %arg0, %arg1 : i32
+    %1 = addi %0, %c2 : i32
+    return %1 : i32
+  }
+}
@@ -0,0 +1,15 @@
+// RUN: printf '\007\000\000\000\001\000\000\000\002\000\000\000\003\000\000\000' > %t.bin
+// RUN: handshake-runner %s @%t.bin | FileCheck %s
+// RUN: od -An -tx1 %t.bin.out | FileCheck %s --check-prefix=MEM
+// CHECK: 7 @{{.*}}.bin.out
+// MEM: 07 00 00 00 01 00 00 00 02 00 00 00 07 00 00 00
+
+module {
+  func @main(%arg0: memref<4xi32>) -> i32 {
+    %c0 = constant 0 : index
+    %c3 = constant 3 : index
+    %0 = memref.load %arg0[%c0] : memref<4xi32>
+    memref.store %0, %arg0[%c3] : memref<4xi32>
+    return %0 : i32
+  }
+}
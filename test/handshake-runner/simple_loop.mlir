@@ -1,7 +1,11 @@
 // RUN: mlir-opt --convert-std-to-llvm %s | mlir-cpu-runner --entry-point-result=i64 | FileCheck %s
 // RUN: circt-opt -create-dataflow %s | handshake-runner | FileCheck %s
 // RUN: handshake-runner %s | FileCheck %s
+// RUN: circt-opt -create-dataflow %s | handshake-runner -report=%t.report | FileCheck %s
+// RUN: FileCheck %s --check-prefix=REPORT < %t.report
 // CHECK: 42
+// REPORT: time {{[0-9]+}}
+// REPORT-NEXT: channel %{{.*}} ({{.*}}): {{[0-9]+}} tokens, first at {{[0-9]+}}, last at {{[0-9]+}}, interval {{[0-9.]+}}
 module {
   func @main() -> index {
     %c1 = constant 1 : index
@@ -56,8 +56,9 @@ tool_dirs = [
     config.circt_tools_dir, config.mlir_tools_dir, config.llvm_tools_dir
 ]
 tools = [
-    'firtool', 'handshake-runner', 'circt-opt', 'circt-reduce',
-    'circt-translate', 'circt-capi-ir-test', 'esi-tester'
+    'firtool', 'firtool-client', 'handshake-runner', 'circt-opt',
+    'circt-reduce', 'circt-translate', 'circt-capi-ir-test', 'circt-cycle-sim',
+    'esi-tester'
 ]
 
 # Enable Verilator if it has been detected.
@@ -0,0 +1,577 @@
+//===- CycleSimulator.cpp - Cycle-based HW/Comb/Seq simulator -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the compilation of a design to a levelized program, and
+// the evaluation of that program.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CycleSimulator.h"
+
+#include "circt/Dialect/Comb/CombOps.h"
+#include "circt/Dialect/Seq/SeqOps.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/TypeSwitch.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace mlir;
+using namespace circt;
+using namespace cyclesim;
+
+static uint64_t getMask(unsigned width) {
+  return width >= 64 ? ~0ULL : (1ULL << width) - 1;
+}
+
+static int64_t signExtend(uint64_t value, unsigned width) {
+  if (width == 0)
+    return 0;
+  if (width >= 64)
+    return value;
+  return llvm::SignExtend64(value, width);
+}
+
+//===----------------------------------------------------------------------===//
+// Compilation
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// The instructions computing the result of one operation. They only write
+/// the result slot, which may be read by the instructions following the first.
+struct Node {
+  Operation *op;
+  Slot result;
+  unsigned width;
+  SmallVector<Slot, 3> inputs;
+  SmallVector<Instruction, 1> code;
+};
+
+class Compiler {
+public:
+  Compiler(Program &program, StringRef clock)
+      : program(program), clock(clock) {}
+
+  LogicalResult compileTop(hw::HWModuleOp top);
+
+private:
+  Optional<Slot> allocate(Value value, Operation *diagOp);
+  LogicalResult compileModule(hw::HWModuleOp module, ArrayRef<Slot> inputs,
+                              ArrayRef<Slot> outputs);
+  LogicalResult compileOp(Operation *op, DenseMap<Value, Slot> &slots,
+                          ArrayRef<Slot> outputs);
+  void emit(Node &node, Opcode opcode, Slot a, Slot b = 0, Slot c = 0,
+            unsigned opWidth = 0, unsigned imm = 0);
+  LogicalResult levelize();
+
+  Program &program;
+  StringRef clock;
+  Slot clockSlot = 0;
+  std::vector<Node> nodes;
+  /// The modules being compiled, to reject recursive instantiations.
+  SmallPtrSet<Operation *, 8> activeModules;
+};
+} // namespace
+
+static unsigned getWidth(Value value) {
+  return value.getType().cast<IntegerType>().getWidth();
+}
+
+Optional<Slot> Compiler::allocate(Value value, Operation *diagOp) {
+  auto type = value.getType().dyn_cast<IntegerType>();
+  if (!type || type.getWidth() > 64) {
+    diagOp->emitError("cycle simulation only supports integers of up to 64 "
+                      "bits, but got ")
+        << value.getType();
+    return llvm::None;
+  }
+  return program.numSlots++;
+}
+
+void Compiler::emit(Node &node, Opcode opcode, Slot a, Slot b, Slot c,
+                    unsigned opWidth, unsigned imm) {
+  node.code.push_back({opcode, static_cast<uint8_t>(opWidth),
+                       static_cast<uint8_t>(imm),
+                       static_cast<uint8_t>(node.width), node.result, a, b, c,
+                       getMask(node.width)});
+}
+
+LogicalResult Compiler::compileTop(hw::HWModuleOp top) {
+  SmallVector<Slot> inputs, outputs;
+  for (auto port : top.getPorts()) {
+    if (port.direction == hw::PortDirection::INOUT)
+      return top.emitError("cycle simulation does not support inout ports");
+    auto slot = allocate(port.isOutput()
+                             ? top.getBodyBlock()->getTerminator()->getOperand(
+                                   port.argNum)
+                             : top.getArgument(port.argNum),
+                         top);
+    if (!slot)
+      return failure();
+    if (port.isOutput()) {
+      outputs.push_back(*slot);
+      program.outputs.push_back({port.getName().str(), *slot,
+                                 port.type.getIntOrFloatBitWidth()});
+      continue;
+    }
+    inputs.push_back(*slot);
+    if (port.getName() == clock) {
+      clockSlot = *slot;
+      continue;
+    }
+    program.inputs.push_back(
+        {port.getName().str(), *slot, port.type.getIntOrFloatBitWidth()});
+  }
+
+  if (failed(compileModule(top, inputs, outputs)))
+    return failure();
+  return levelize();
+}
+
+LogicalResult Compiler::compileModule(hw::HWModuleOp module,
+                                      ArrayRef<Slot> inputs,
+                                      ArrayRef<Slot> outputs) {
+  if (!activeModules.insert(module).second)
+    return module.emitError("cannot simulate a recursive instantiation");
+
+  // The module body is a graph region, so all the results get a slot before
+  // any operation is compiled.
+  DenseMap<Value, Slot> slots;
+  for (auto arg : llvm::enumerate(module.getArguments()))
+    slots[arg.value()] = inputs[arg.index()];
+  for (auto &op : *module.getBodyBlock()) {
+    for (auto result : op.getResults()) {
+      auto slot = allocate(result, &op);
+      if (!slot)
+        return failure();
+      slots[result] = *slot;
+    }
+  }
+
+  for (auto &op : *module.getBodyBlock())
+    if (failed(compileOp(&op, slots, outputs)))
+      return failure();
+
+  activeModules.erase(module);
+  return success();
+}
+
+/// Return the opcode of the comb operations that fold their operands with a
+/// single instruction each.
+static Optional<Opcode> getArithmeticOpcode(Operation *op) {
+  return TypeSwitch<Operation *, Optional<Opcode>>(op)
+      .Case<comb::AddOp>([](auto) { return Opcode::Add; })
+      .Case<comb::SubOp>([](auto) { return Opcode::Sub; })
+      .Case<comb::MulOp>([](auto) { return Opcode::Mul; })
+      .Case<comb::DivUOp>([](auto) { return Opcode::DivU; })
+      .Case<comb::DivSOp>([](auto) { return Opcode::DivS; })
+      .Case<comb::ModUOp>([](auto) { return Opcode::ModU; })
+      .Case<comb::ModSOp>([](auto) { return Opcode::ModS; })
+      .Case<comb::ShlOp>([](auto) { return Opcode::Shl; })
+      .Case<comb::ShrUOp>([](auto) { return Opcode::ShrU; })
+      .Case<comb::ShrSOp>([](auto) { return Opcode::ShrS; })
+      .Case<comb::AndOp>([](auto) { return Opcode::And; })
+      .Case<comb::OrOp>([](auto) { return Opcode::Or; })
+      .Case<comb::XorOp>([](auto) { return Opcode::Xor; })
+      .Default([](auto) { return llvm::None; });
+}
+
+LogicalResult Compiler::compileOp(Operation *op, DenseMap<Value, Slot> &slots,
+                                  ArrayRef<Slot> outputs) {
+  auto getSlot = [&](Value value) { return slots.lookup(value); };
+  auto addNode = [&](Slot result) -> Node & {
+    nodes.push_back({op, result, getWidth(op->getResult(0)), {}, {}});
+    auto &node = nodes.back();
+    for (auto operand : op->getOperands())
+      node.inputs.push_back(getSlot(operand));
+    return node;
+  };
+
+  // Fold the operands of arithmetic and logical operations one after the
+  // other into the result.
+  if (auto opcode = getArithmeticOpcode(op)) {
+    auto &node = addNode(getSlot(op->getResult(0)));
+    auto operands = op->getOperands();
+    unsigned width = getWidth(operands[0]);
+    if (operands.size() == 1) {
+      emit(node, Opcode::Copy, getSlot(operands[0]));
+      return success();
+    }
+    emit(node, *opcode, getSlot(operands[0]), getSlot(operands[1]), 0, width);
+    for (auto operand : operands.drop_front(2))
+      emit(node, *opcode, node.result, getSlot(operand), 0, width);
+    return success();
+  }
+
+  return TypeSwitch<Operation *, LogicalResult>(op)
+      .Case<hw::ConstantOp>([&](auto constOp) {
+        program.constants.push_back(
+            {getSlot(constOp), constOp.getValue().getZExtValue()});
+        return success();
+      })
+      .Case<hw::OutputOp>([&](auto outputOp) {
+        for (auto it : llvm::zip(outputOp.getOperands(), outputs)) {
+          Value operand = std::get<0>(it);
+          nodes.push_back(
+              {op, std::get<1>(it), getWidth(operand), {getSlot(operand)}, {}});
+          emit(nodes.back(), Opcode::Copy, getSlot(operand));
+        }
+        return success();
+      })
+      .Case<hw::InstanceOp>([&](auto instOp) -> LogicalResult {
+        auto module =
+            dyn_cast_or_null<hw::HWModuleOp>(instOp.getReferencedModule());
+        if (!module)
+          return instOp.emitError(
+              "cycle simulation only supports instances of hw.module");
+        SmallVector<Slot> inputs, results;
+        for (auto operand : instOp.getOperands())
+          inputs.push_back(getSlot(operand));
+        for (auto result : instOp.getResults())
+          results.push_back(getSlot(result));
+        return compileModule(module, inputs, results);
+      })
+      .Case<seq::CompRegOp>([&](auto regOp) -> LogicalResult {
+        if (getSlot(regOp.clk()) != clockSlot)
+          return regOp.emitError("register must be clocked by the '")
+                 << clock << "' port of the top module";
+        Register reg{getSlot(regOp), getSlot(regOp.input()), 0, 0};
+        if (regOp.reset() && regOp.resetValue()) {
+          reg.reset = getSlot(regOp.reset());
+          reg.resetValue = getSlot(regOp.resetValue());
+        }
+        program.registers.push_back(reg);
+        return success();
+      })
+      .Case<comb::ICmpOp>([&](auto cmpOp) {
+        auto &node = addNode(getSlot(cmpOp));
+        emit(node, Opcode::ICmp, getSlot(cmpOp.lhs()), getSlot(cmpOp.rhs()), 0,
+             getWidth(cmpOp.lhs()), static_cast<unsigned>(cmpOp.predicate()));
+        return success();
+      })
+      .Case<comb::ParityOp>([&](auto parityOp) {
+        auto &node = addNode(getSlot(parityOp));
+        emit(node, Opcode::Parity, getSlot(parityOp.input()));
+        return success();
+      })
+      .Case<comb::ExtractOp>([&](auto extractOp) {
+        auto &node = addNode(getSlot(extractOp));
+        emit(node, Opcode::Extract, getSlot(extractOp.input()), 0, 0,
+             getWidth(extractOp.input()), extractOp.lowBit());
+        return success();
+      })
+      .Case<comb::SExtOp>([&](auto sextOp) {
+        auto &node = addNode(getSlot(sextOp));
+        emit(node, Opcode::SExt, getSlot(sextOp.input()), 0, 0,
+             getWidth(sextOp.input()));
+        return success();
+      })
+      .Case<comb::ConcatOp>([&](auto concatOp) {
+        // The first operand holds the most significant bits.
+        auto &node = addNode(getSlot(concatOp));
+        auto operands = concatOp.getOperands();
+        emit(node, Opcode::Copy, getSlot(operands[0]));
+        for (auto operand : operands.drop_front())
+          emit(node, Opcode::Concat, node.result, getSlot(operand), 0, 0,
+               getWidth(operand));
+        return success();
+      })
+      .Case<comb::MuxOp>([&](auto muxOp) {
+        auto &node = addNode(getSlot(muxOp));
+        emit(node, Opcode::Mux, getSlot(muxOp.cond()),
+             getSlot(muxOp.trueValue()), getSlot(muxOp.falseValue()));
+        return success();
+      })
+      .Default([&](Operation *op) {
+        return op->emitError("operation is not supported by cycle simulation");
+      });
+}
+
+/// Order the nodes by level, such that every node only reads the results of
+/// nodes in lower levels, the state of the registers, the inputs and the
+/// constants.
+LogicalResult Compiler::levelize() {
+  DenseMap<Slot, unsigned> producers;
+  for (auto node : llvm::enumerate(nodes))
+    producers[node.value().result] = node.index();
+
+  std::vector<SmallVector<unsigned, 2>> users(nodes.size());
+  std::vector<unsigned> numPending(nodes.size(), 0);
+  for (auto node : llvm::enumerate(nodes)) {
+    for (auto input : node.value().inputs) {
+      auto it = producers.find(input);
+      if (it == producers.end())
+        continue;
+      users[it->second].push_back(node.index());
+      ++numPending[node.index()];
+    }
+  }
+
+  std::vector<unsigned> level, nextLevel;
+  for (unsigned i = 0, e = nodes.size(); i != e; ++i)
+    if (numPending[i] == 0)
+      level.push_back(i);
+
+  unsigned numScheduled = 0;
+  while (!level.empty()) {
+    program.levels.push_back(program.instructions.size());
+    for (auto i : level) {
+      auto &code = nodes[i].code;
+      program.instructions.insert(program.instructions.end(), code.begin(),
+                                  code.end());
+      for (auto user : users[i])
+        if (--numPending[user] == 0)
+          nextLevel.push_back(user);
+    }
+    numScheduled += level.size();
+    std::swap(level, nextLevel);
+    nextLevel.clear();
+  }
+  program.levels.push_back(program.instructions.size());
+
+  if (numScheduled == nodes.size())
+    return success();
+  for (auto node : llvm::enumerate(nodes))
+    if (numPending[node.index()] != 0)
+      return node.value().op->emitError(
+          "combinational loop through this operation");
+  llvm_unreachable("unscheduled node without pending inputs");
+}
+
+std::unique_ptr<Program> Program::compile(hw::HWModuleOp top,
+                                          StringRef clock) {
+  auto program = std::make_unique<Program>();
+  Compiler compiler(*program, clock);
+  if (failed(compiler.compileTop(top)))
+    return nullptr;
+  return program;
+}
+
+static StringRef getOpcodeName(Opcode opcode) {
+  switch (opcode) {
+  case Opcode::Copy:
+    return "copy";
+  case Opcode::Add:
+    return "add";
+  case Opcode::Sub:
+    return "sub";
+  case Opcode::Mul:
+    return "mul";
+  case Opcode::DivU:
+    return "divu";
+  case Opcode::DivS:
+    return "divs";
+  case Opcode::ModU:
+    return "modu";
+  case Opcode::ModS:
+    return "mods";
+  case Opcode::Shl:
+    return "shl";
+  case Opcode::ShrU:
+    return "shru";
+  case Opcode::ShrS:
+    return "shrs";
+  case Opcode::And:
+    return "and";
+  case Opcode::Or:
+    return "or";
+  case Opcode::Xor:
+    return "xor";
+  case Opcode::ICmp:
+    return "icmp";
+  case Opcode::Parity:
+    return "parity";
+  case Opcode::Extract:
+    return "extract";
+  case Opcode::SExt:
+    return "sext";
+  case Opcode::Concat:
+    return "concat";
+  case Opcode::Mux:
+    return "mux";
+  }
+  llvm_unreachable("unknown opcode");
+}
+
+void Program::print(llvm::raw_ostream &os) const {
+  os << "state: " << numSlots << " words\n";
+  for (auto &port : inputs)
+    os << "input " << port.name << ": %" << port.slot << " : i" << port.width
+       << "\n";
+  for (auto &port : outputs)
+    os << "output " << port.name << ": %" << port.slot << " : i" << port.width
+       << "\n";
+  for (auto &constant : constants)
+    os << "const %" << constant.first << " = " << constant.second << "\n";
+  for (auto &reg : registers) {
+    os << "reg %" << reg.data << " <= %" << reg.input;
+    if (reg.reset)
+      os << ", reset %" << reg.reset << " to %" << reg.resetValue;
+    os << "\n";
+  }
+  for (unsigned level = 0; level + 1 < levels.size(); ++level) {
+    os << "level " << level << ":\n";
+    for (unsigned i = levels[level]; i != levels[level + 1]; ++i) {
+      auto &inst = instructions[i];
+      os << "  %" << inst.dst << " = " << getOpcodeName(inst.opcode) << " %"
+         << inst.a;
+      switch (inst.opcode) {
+      case Opcode::Copy:
+      case Opcode::Parity:
+      case Opcode::SExt:
+        break;
+      case Opcode::Extract:
+        os << " from " << unsigned(inst.imm);
+        break;
+      case Opcode::Mux:
+        os << ", %" << inst.b << ", %" << inst.c;
+        break;
+      case Opcode::ICmp:
+        os << ", %" << inst.b << " [" << unsigned(inst.imm) << "]";
+        break;
+      default:
+        os << ", %" << inst.b;
+        break;
+      }
+      os << " : i" << unsigned(inst.width) << "\n";
+    }
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Simulation
+//===----------------------------------------------------------------------===//
+
+Simulator::Simulator(const Program &program)
+    : program(program), state(program.numSlots, 0),
+      nextRegisterValues(program.registers.size(), 0) {
+  for (auto &constant : program.constants)
+    state[constant.first] = constant.second;
+}
+
+void Simulator::setInput(unsigned index, uint64_t value) {
+  auto &port = program.inputs[index];
+  state[port.slot] = value & getMask(port.width);
+}
+
+static bool compare(unsigned predicate, uint64_t a, uint64_t b,
+                    unsigned width) {
+  int64_t sa = signExtend(a, width), sb = signExtend(b, width);
+  switch (static_cast<comb::ICmpPredicate>(predicate)) {
+  case comb::ICmpPredicate::eq:
+    return a == b;
+  case comb::ICmpPredicate::ne:
+    return a != b;
+  case comb::ICmpPredicate::slt:
+    return sa < sb;
+  case comb::ICmpPredicate::sle:
+    return sa <= sb;
+  case comb::ICmpPredicate::sgt:
+    return sa > sb;
+  case comb::ICmpPredicate::sge:
+    return sa >= sb;
+  case comb::ICmpPredicate::ult:
+    return a < b;
+  case comb::ICmpPredicate::ule:
+    return a <= b;
+  case comb::ICmpPredicate::ugt:
+    return a > b;
+  case comb::ICmpPredicate::uge:
+    return a >= b;
+  }
+  llvm_unreachable("unknown comparison predicate");
+}
+
+void Simulator::eval() {
+  uint64_t *s = state.data();
+  for (const Instruction &inst : program.instructions) {
+    uint64_t a = s[inst.a], b = s[inst.b];
+    uint64_t result;
+    switch (inst.opcode) {
+    case Opcode::Copy:
+      result = a;
+      break;
+    case Opcode::Add:
+      result = a + b;
+      break;
+    case Opcode::Sub:
+      result = a - b;
+      break;
+    case Opcode::Mul:
+      result = a * b;
+      break;
+    // Divisions by zero, which are undefined, produce zero.
+    case Opcode::DivU:
+      result = b ? a / b : 0;
+      break;
+    case Opcode::ModU:
+      result = b ? a % b : 0;
+      break;
+    case Opcode::DivS:
+    case Opcode::ModS: {
+      int64_t sa = signExtend(a, inst.opWidth);
+      int64_t sb = signExtend(b, inst.opWidth);
+      bool isDiv = inst.opcode == Opcode::DivS;
+      if (sb == 0)
+        result = 0;
+      else if (sb == -1)
+        result = isDiv ? 0 - a : 0;
+      else
+        result = isDiv ? sa / sb : sa % sb;
+      break;
+    }
+    case Opcode::Shl:
+      result = b >= inst.opWidth ? 0 : a << b;
+      break;
+    case Opcode::ShrU:
+      result = b >= inst.opWidth ? 0 : a >> b;
+      break;
+    case Opcode::ShrS:
+      result = signExtend(a, inst.opWidth) >> std::min<uint64_t>(b, 63);
+      break;
+    case Opcode::And:
+      result = a & b;
+      break;
+    case Opcode::Or:
+      result = a | b;
+      break;
+    case Opcode::Xor:
+      result = a ^ b;
+      break;
+    case Opcode::ICmp:
+      result = compare(inst.imm, a, b, inst.opWidth);
+      break;
+    case Opcode::Parity:
+      result = llvm::countPopulation(a) & 1;
+      break;
+    case Opcode::Extract:
+      result = a >> inst.imm;
+      break;
+    case Opcode::SExt:
+      result = signExtend(a, inst.opWidth);
+      break;
+    case Opcode::Concat:
+      result = inst.imm >= 64 ? b : (a << inst.imm) | b;
+      break;
+    case Opcode::Mux:
+      result = a ? b : s[inst.c];
+      break;
+    }
+    s[inst.dst] = result & inst.mask;
+  }
+}
+
+void Simulator::tick() {
+  // All the registers sample their inputs before any of them is updated.
+  uint64_t *s = state.data();
+  for (auto reg : llvm::enumerate(program.registers)) {
+    auto &r = reg.value();
+    nextRegisterValues[reg.index()] = s[r.reset] ? s[r.resetValue] : s[r.input];
+  }
+  for (auto reg : llvm::enumerate(program.registers))
+    s[reg.value().data] = nextRegisterValues[reg.index()];
+}
@@ -0,0 +1,130 @@
+//===- CycleSimulator.h - Cycle-based HW/Comb/Seq simulator -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines a cycle-based simulator for designs made of hw.module,
+// comb and seq operations. The design is flattened and its combinational logic
+// levelized into a straight-line program, which evaluates all of it once per
+// clock cycle without any event scheduling.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_TOOLS_CIRCT_CYCLE_SIM_CYCLESIMULATOR_H
+#define CIRCT_TOOLS_CIRCT_CYCLE_SIM_CYCLESIMULATOR_H
+
+#include "circt/Dialect/HW/HWOps.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace circt {
+namespace cyclesim {
+
+/// The index of a word in the state buffer. Slot 0 always holds zero.
+using Slot = uint32_t;
+
+enum class Opcode : uint8_t {
+  Copy,
+  Add,
+  Sub,
+  Mul,
+  DivU,
+  DivS,
+  ModU,
+  ModS,
+  Shl,
+  ShrU,
+  ShrS,
+  And,
+  Or,
+  Xor,
+  ICmp,
+  Parity,
+  Extract,
+  SExt,
+  Concat,
+  Mux
+};
+
+/// One step of the program: `dst = opcode(a, b, c)`, masked to the width of
+/// the result. `opWidth` is the width of the operands, and `imm` the
+/// comparison predicate, the low bit of an extraction or the width of the low
+/// part of a concatenation.
+struct Instruction {
+  Opcode opcode;
+  uint8_t opWidth;
+  uint8_t imm;
+  uint8_t width;
+  Slot dst, a, b, c;
+  uint64_t mask;
+};
+
+struct Port {
+  std::string name;
+  Slot slot;
+  unsigned width;
+};
+
+/// A register is clocked by the clock port of the design, and loads its
+/// `resetValue` rather than its `input` while `reset` is set. Registers
+/// without a reset use slot 0 as `reset`.
+struct Register {
+  Slot data, input, reset, resetValue;
+};
+
+/// The flattened and levelized form of a design.
+struct Program {
+  /// Compile the module `top` and the modules it instantiates. All the
+  /// registers must be clocked by its input port named `clock`. Returns null
+  /// and emits an error if the design cannot be simulated.
+  static std::unique_ptr<Program> compile(hw::HWModuleOp top,
+                                          llvm::StringRef clock);
+
+  void print(llvm::raw_ostream &os) const;
+
+  /// The number of words in the state buffer.
+  unsigned numSlots = 1;
+  /// The instructions evaluating the combinational logic, in a topological
+  /// order of their dependences.
+  std::vector<Instruction> instructions;
+  /// The index of the first instruction of each level, plus the end.
+  std::vector<unsigned> levels;
+  std::vector<Register> registers;
+  std::vector<std::pair<Slot, uint64_t>> constants;
+  /// The inputs, except the clock, and the outputs of the top module.
+  std::vector<Port> inputs, outputs;
+};
+
+/// The state of one simulation of a program, held in one contiguous buffer.
+class Simulator {
+public:
+  explicit Simulator(const Program &program);
+
+  void setInput(unsigned index, uint64_t value);
+  uint64_t getOutput(unsigned index) const {
+    return state[program.outputs[index].slot];
+  }
+
+  /// Evaluate the combinational logic for the current inputs and registers.
+  void eval();
+  /// Apply a rising edge of the clock to all the registers. This does not
+  /// re-evaluate the combinational logic.
+  void tick();
+
+private:
+  const Program &program;
+  std::vector<uint64_t> state;
+  std::vector<uint64_t> nextRegisterValues;
+};
+
+} // namespace cyclesim
+} // namespace circt
+
+#endif // CIRCT_TOOLS_CIRCT_CYCLE_SIM_CYCLESIMULATOR_H
@@ -0,0 +1,199 @@
+//===- circt-cycle-sim.cpp - Cycle-based HW/Comb/Seq simulator ------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Tool which simulates a design made of hw.module, comb and seq operations
+// cycle by cycle, without emitting Verilog first.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CycleSimulator.h"
+
+#include "circt/Dialect/Comb/CombDialect.h"
+#include "circt/Dialect/HW/HWDialect.h"
+#include "circt/Dialect/Seq/SeqDialect.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Parser.h"
+#include "mlir/Support/FileUtilities.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/ToolOutputFile.h"
+
+using namespace llvm;
+using namespace mlir;
+using namespace circt;
+
+static cl::OptionCategory mainCategory("Application options");
+
+static cl::opt<std::string> inputFilename(cl::Positional,
+                                          cl::desc("<input file>"),
+                                          cl::init("-"), cl::cat(mainCategory));
+
+static cl::opt<std::string> outputFilename("o", cl::desc("Output filename"),
+                                           cl::value_desc("filename"),
+                                           cl::init("-"),
+                                           cl::cat(mainCategory));
+
+static cl::opt<std::string>
+    topModule("top",
+              cl::desc("The module to simulate, by default the last one of "
+                       "the input"),
+              cl::value_desc("name"), cl::cat(mainCategory));
+
+static cl::opt<std::string>
+    clockPort("clock", cl::desc("The input port clocking all the registers"),
+              cl::value_desc("port"), cl::init("clk"), cl::cat(mainCategory));
+
+static cl::opt<std::string> stimulusFilename(
+    "stimulus",
+    cl::desc("A file with the values of the inputs, except the clock, in port "
+             "order: one line of whitespace-separated integers per cycle"),
+    cl::value_desc("filename"), cl::cat(mainCategory));
+
+static cl::opt<unsigned> numCycles(
+    "cycles",
+    cl::desc("The number of cycles to simulate, by default one per line of "
+             "the stimulus. The last inputs are held after the stimulus ends"),
+    cl::cat(mainCategory));
+
+static cl::opt<bool>
+    traceOutputs("trace",
+                 cl::desc("Print the outputs in every cycle, rather than only "
+                          "in the last one"),
+                 cl::init(true), cl::cat(mainCategory));
+
+static cl::opt<bool>
+    dumpProgram("dump-program",
+                cl::desc("Print the levelized program instead of simulating"),
+                cl::cat(mainCategory));
+
+static void printOutputs(raw_ostream &os, const cyclesim::Program &program,
+                         const cyclesim::Simulator &sim, unsigned cycle) {
+  os << "cycle " << cycle << ":";
+  for (unsigned i = 0, e = program.outputs.size(); i != e; ++i)
+    os << " " << program.outputs[i].name << "=" << sim.getOutput(i);
+  os << "\n";
+}
+
+/// Parse the stimulus, with one vector of input values per cycle. Empty lines
+/// and the ones starting with '#' are skipped.
+static LogicalResult
+parseStimulus(StringRef buffer, unsigned numInputs,
+              std::vector<SmallVector<uint64_t>> &stimulus) {
+  SmallVector<StringRef> lines, fields;
+  buffer.split(lines, '\n');
+  for (auto line : llvm::enumerate(lines)) {
+    auto text = line.value().trim();
+    if (text.empty() || text.startswith("#"))
+      continue;
+    fields.clear();
+    SplitString(text, fields);
+    if (fields.size() != numInputs) {
+      errs() << "stimulus line " << line.index() + 1 << ": expected "
+             << numInputs << " values, but got " << fields.size() << "\n";
+      return failure();
+    }
+    stimulus.emplace_back();
+    auto &values = stimulus.back();
+    for (auto field : fields) {
+      uint64_t value;
+      if (field.getAsInteger(0, value)) {
+        errs() << "stimulus line " << line.index() + 1 << ": invalid value '"
+               << field << "'\n";
+        return failure();
+      }
+      values.push_back(value);
+    }
+  }
+  return success();
+}
+
+int main(int argc, char **argv) {
+  InitLLVM y(argc, argv);
+  cl::HideUnrelatedOptions(mainCategory);
+  cl::ParseCommandLineOptions(
+      argc, argv,
+      "Cycle-based simulator for hw, comb and seq\n\n"
+      "The design is flattened and its combinational logic levelized into a\n"
+      "straight-line program over one buffer holding all of its values. The\n"
+      "outputs are printed after the combinational logic settles in each\n"
+      "cycle, before the rising edge of the clock.\n");
+
+  std::string errorMessage;
+  auto input = openInputFile(inputFilename, &errorMessage);
+  if (!input) {
+    errs() << errorMessage << "\n";
+    return 1;
+  }
+  auto output = openOutputFile(outputFilename, &errorMessage);
+  if (!output) {
+    errs() << errorMessage << "\n";
+    return 1;
+  }
+
+  MLIRContext context;
+  context.loadDialect<hw::HWDialect, comb::CombDialect, seq::SeqDialect>();
+  SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(std::move(input), SMLoc());
+  SourceMgrDiagnosticHandler diagHandler(sourceMgr, &context);
+  OwningModuleRef module(parseSourceFile(sourceMgr, &context));
+  if (!module)
+    return 1;
+
+  hw::HWModuleOp top;
+  if (topModule.empty()) {
+    for (auto op : module->getOps<hw::HWModuleOp>())
+      top = op;
+  } else {
+    top = module->lookupSymbol<hw::HWModuleOp>(topModule);
+  }
+  if (!top) {
+    errs() << "top module " << topModule << " not found\n";
+    return 1;
+  }
+
+  auto program = cyclesim::Program::compile(top, clockPort);
+  if (!program)
+    return 1;
+
+  if (dumpProgram) {
+    program->print(output->os());
+    output->keep();
+    return 0;
+  }
+
+  std::vector<SmallVector<uint64_t>> stimulus;
+  if (!stimulusFilename.empty()) {
+    auto stimulusFile = openInputFile(stimulusFilename, &errorMessage);
+    if (!stimulusFile) {
+      errs() << errorMessage << "\n";
+      return 1;
+    }
+    if (failed(parseStimulus(stimulusFile->getBuffer(),
+                             program->inputs.size(), stimulus)))
+      return 1;
+  }
+
+  unsigned cycles = numCycles.getNumOccurrences()
+                        ? numCycles
+                        : std::max<unsigned>(stimulus.size(), 1);
+  cyclesim::Simulator sim(*program);
+  for (unsigned cycle = 0; cycle < cycles; ++cycle) {
+    if (cycle < stimulus.size())
+      for (auto value : llvm::enumerate(stimulus[cycle]))
+        sim.setInput(value.index(), value.value());
+    sim.eval();
+    if (traceOutputs || cycle + 1 == cycles)
+      printOutputs(output->os(), *program, sim, cycle);
+    sim.tick();
+  }
+
+  output->keep();
+  return 0;
+}
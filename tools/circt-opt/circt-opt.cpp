@@ -13,6 +13,7 @@
 
 #include "circt/InitAllDialects.h"
 #include "circt/InitAllPasses.h"
+#include "circt/Support/ThreadingOptions.h"
 #include "mlir/Dialect/Affine/IR/AffineOps.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
@@ -49,6 +50,9 @@ int main(int argc, char **argv) {
   // Register test passes
   circt::test::registerSchedulingTestPasses();
 
+  // Register the options for the threads of the parallel passes.
+  circt::registerThreadingCLOptions();
+
   return mlir::failed(
       mlir::MlirOptMain(argc, argv, "CIRCT modular optimizer driver", registry,
                         /*preloadDialectsInContext=*/false));
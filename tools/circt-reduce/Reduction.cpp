@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "circt/Dialect/FIRRTL/FIRRTLOps.h"
+#include "circt/Dialect/FIRRTL/InstanceGraph.h"
 #include "circt/Dialect/FIRRTL/Passes.h"
 #include "circt/InitAllDialects.h"
 #include "mlir/IR/AsmState.h"
@@ -89,6 +90,43 @@ struct ModuleExternalizer : public Reduction {
   std::string getName() const override { return "module-externalizer"; }
 };
 
+/// A reduction pattern that maps a `firrtl.module` other than the top-level
+/// one to a `firrtl.extmodule`, and then removes the modules which are no
+/// longer instantiated from the top-level module. This removes the whole
+/// subtree of the instance hierarchy below the module in a single step, rather
+/// than first externalizing every module in it.
+struct ModuleSubtreeExternalizer : public ModuleExternalizer {
+  bool match(Operation *op) const override {
+    auto module = dyn_cast<firrtl::FModuleOp>(op);
+    if (!module)
+      return false;
+    auto circuit = module->getParentOfType<firrtl::CircuitOp>();
+    return circuit && circuit.name() != module.getName();
+  }
+  void afterReduction(ModuleOp module) const override {
+    for (auto circuit : module.getOps<firrtl::CircuitOp>()) {
+      firrtl::InstanceGraph instanceGraph(circuit);
+      auto *top = instanceGraph.getTopLevelNode();
+      if (!top)
+        continue;
+      SmallPtrSet<firrtl::InstanceGraphNode *, 16> reachable;
+      SmallVector<firrtl::InstanceGraphNode *, 16> worklist;
+      reachable.insert(top);
+      worklist.push_back(top);
+      while (!worklist.empty())
+        for (auto *record : worklist.pop_back_val()->instances())
+          if (reachable.insert(record->getTarget()).second)
+            worklist.push_back(record->getTarget());
+      for (auto *node : instanceGraph)
+        if (!reachable.count(node) && node->getModule())
+          node->getModule()->erase();
+    }
+  }
+  std::string getName() const override {
+    return "module-subtree-externalizer";
+  }
+};
+
 /// Starting at the given `op`, traverse through it and its operands and erase
 /// operations that have no more uses.
 static void pruneUnusedOps(Operation *initialOp) {
@@ -126,6 +164,7 @@ struct ConnectInvalidator : public Reduction {
     return success();
   }
   std::string getName() const override { return "connect-invalidator"; }
+  bool isLocal() const override { return true; }
 };
 
 /// A sample reduction pattern that removes operations which either produce no
@@ -142,6 +181,7 @@ struct OperationPruner : public Reduction {
     return success();
   }
   std::string getName() const override { return "operation-pruner"; }
+  bool isLocal() const override { return true; }
 };
 
 /// A sample reduction pattern that replaces instances of `firrtl.extmodule`
@@ -172,6 +212,7 @@ struct ExtmoduleInstanceRemover : public Reduction {
   }
   std::string getName() const override { return "extmodule-instance-remover"; }
   bool acceptSizeIncrease() const override { return true; }
+  bool isLocal() const override { return true; }
 };
 
 //===----------------------------------------------------------------------===//
@@ -192,6 +233,7 @@ void circt::createAllReductions(
   // sorted by decreasing reduction potential/benefit. For example, things that
   // can knock out entire modules while being cheap should be tried first,
   // before trying to tweak operands of individual arithmetic ops.
+  add(std::make_unique<ModuleSubtreeExternalizer>());
   add(std::make_unique<ModuleExternalizer>());
   add(std::make_unique<PassReduction>(context, firrtl::createInlinerPass()));
   add(std::make_unique<PassReduction>(context,
@@ -25,6 +25,7 @@ class function_ref;
 namespace mlir {
 struct LogicalResult;
 class MLIRContext;
+class ModuleOp;
 class Operation;
 class Pass;
 class PassManager;
@@ -44,6 +45,10 @@ struct Reduction {
   /// same as if the tester marked it as uninteresting.
   virtual mlir::LogicalResult rewrite(mlir::Operation *op) const = 0;
 
+  /// Called after the reduction has been applied to a subset of the operations
+  /// of a module, to clean up the module as a whole.
+  virtual void afterReduction(mlir::ModuleOp module) const {}
+
   /// Return a human-readable name for this reduction pattern.
   virtual std::string getName() const = 0;
 
@@ -52,6 +57,13 @@ struct Reduction {
   /// This can be handy for patterns that reduce the complexity of the IR at the
   /// cost of some verbosity.
   virtual bool acceptSizeIncrease() const { return false; }
+
+  /// Return true if rewriting an operation only modifies the inside of the
+  /// closest IsolatedFromAbove operation enclosing it. The tool applies such
+  /// reductions to the module directly and undoes them if the result is
+  /// rejected, instead of applying them to a clone of the whole module. Their
+  /// `afterReduction` is not called.
+  virtual bool isLocal() const { return false; }
 };
 
 /// A reduction pattern that applies an `mlir::Pass`.
@@ -17,9 +17,16 @@
 #include "mlir/Reducer/Tester.h"
 #include "mlir/Support/FileUtilities.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/LineIterator.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/ToolOutputFile.h"
 
+#include <mutex>
+
 #include "Reduction.h"
 
 #define DEBUG_TYPE "circt-reduce"
@@ -51,6 +58,15 @@ static cl::list<std::string>
     testerArgs("test-arg", cl::ZeroOrMore,
                cl::desc("Additional arguments to the test"));
 
+static cl::opt<unsigned>
+    numJobs("j", cl::init(1),
+            cl::desc("Number of candidate reductions to test in parallel"));
+
+static cl::opt<std::string> testCacheFilename(
+    "test-cache",
+    cl::desc("File in which to persist the test results, so that a reduction "
+             "can be resumed"));
+
 //===----------------------------------------------------------------------===//
 // Tool Implementation
 //===----------------------------------------------------------------------===//
@@ -72,6 +88,211 @@ static LogicalResult writeOutput(ModuleOp module) {
   return success();
 }
 
+namespace {
+/// A wrapper around the tester which remembers the outcome of the test for
+/// each distinct module, so that no module is tested twice. Modules are
+/// identified by a hash of their textual form and of the test command. The
+/// outcomes can be persisted to a file, from which a later run on the same
+/// input resumes. This is safe to use from multiple threads.
+class CachingTester {
+public:
+  using Result = std::pair<Tester::Interestingness, size_t>;
+
+  CachingTester(const Tester &tester) : tester(tester) {}
+
+  /// Load the outcomes recorded in the specified file, if it exists, and
+  /// record the new outcomes in it.
+  LogicalResult openCache(StringRef filename, MLIRContext *context);
+
+  /// Return whether the module is interesting, and the size of its textual
+  /// form.
+  Result isInteresting(ModuleOp module);
+
+private:
+  const Tester &tester;
+  std::mutex mutex;
+  llvm::StringMap<Result> cache;
+  std::unique_ptr<llvm::raw_fd_ostream> cacheFile;
+};
+} // namespace
+
+LogicalResult CachingTester::openCache(StringRef filename,
+                                       MLIRContext *context) {
+  // Each line of the file is the hash of a module, followed by 1 if it is
+  // interesting or 0 otherwise, and the size of the module.
+  if (auto buffer = llvm::MemoryBuffer::getFile(filename)) {
+    for (llvm::line_iterator line(**buffer); !line.is_at_eof(); ++line) {
+      SmallVector<StringRef, 3> fields;
+      line->split(fields, ' ');
+      size_t size;
+      if (fields.size() != 3 || (fields[1] != "0" && fields[1] != "1") ||
+          fields[2].getAsInteger(10, size))
+        continue;
+      auto interestingness = fields[1] == "1" ? Tester::Interestingness::True
+                                              : Tester::Interestingness::False;
+      cache[fields[0]] = {interestingness, size};
+    }
+    LLVM_DEBUG(llvm::dbgs() << "Loaded " << cache.size()
+                            << " test results from " << filename << "\n");
+  }
+
+  std::error_code ec;
+  cacheFile =
+      std::make_unique<llvm::raw_fd_ostream>(filename, ec, sys::fs::OF_Append);
+  if (ec) {
+    mlir::emitError(UnknownLoc::get(context), "unable to open test cache \"")
+        << filename << "\": " << ec.message();
+    return failure();
+  }
+  return success();
+}
+
+CachingTester::Result CachingTester::isInteresting(ModuleOp module) {
+  std::string text;
+  llvm::raw_string_ostream os(text);
+  module.print(os);
+  os.flush();
+
+  llvm::MD5 hasher;
+  hasher.update(testerCommand);
+  for (auto &arg : testerArgs) {
+    hasher.update(StringRef("\0", 1));
+    hasher.update(arg);
+  }
+  hasher.update(StringRef("\0", 1));
+  hasher.update(text);
+  llvm::MD5::MD5Result hash;
+  hasher.final(hash);
+  SmallString<32> key = hash.digest();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+      LLVM_DEBUG(llvm::dbgs() << "- Reusing test result for " << key << "\n");
+      return it->second;
+    }
+  }
+
+  // Write the module to a temporary file, which is deleted after the test.
+  SmallString<128> filename;
+  int fd;
+  if (std::error_code ec =
+          sys::fs::createTemporaryFile("circt-reduce", "mlir", fd, filename))
+    llvm::report_fatal_error("unable to create temporary file: " +
+                             ec.message());
+  llvm::ToolOutputFile file(filename, fd);
+  file.os() << text;
+  file.os().close();
+  if (file.os().has_error())
+    llvm::report_fatal_error(Twine("unable to write temporary file ") +
+                             filename);
+  Result result = {tester.isInteresting(filename), text.size()};
+
+  std::lock_guard<std::mutex> lock(mutex);
+  cache[key] = result;
+  if (cacheFile) {
+    *cacheFile << key << ' '
+               << (result.first == Tester::Interestingness::True ? 1 : 0)
+               << ' ' << result.second << '\n';
+    cacheFile->flush();
+  }
+  return result;
+}
+
+/// Apply the pattern to the subset of operations of the module selected by
+/// `rangeBase` and `rangeLength`, on a clone of the module. Set `numOps` to the
+/// number of operations the pattern matched.
+static OwningModuleRef applyReduction(ModuleOp module, Reduction &pattern,
+                                      size_t rangeBase, size_t rangeLength,
+                                      size_t &numOps) {
+  size_t opIdx = 0;
+  OwningModuleRef newModule = module.clone();
+  newModule->walk([&](Operation *op) {
+    if (!pattern.match(op))
+      return;
+    auto i = opIdx++;
+    if (i < rangeBase || i - rangeBase >= rangeLength)
+      return;
+    (void)pattern.rewrite(op);
+  });
+  pattern.afterReduction(newModule.get());
+  numOps = opIdx;
+  return newModule;
+}
+
+/// The operations modified by a reduction applied in place, and unmodified
+/// copies of them to undo the reduction with.
+using SavedOps = SmallVector<std::pair<Operation *, Operation *>, 4>;
+
+/// Return the closest IsolatedFromAbove operation enclosing `op`.
+static Operation *getIsolatedParent(Operation *op) {
+  for (auto *parent = op->getParentOp(); parent; parent = parent->getParentOp())
+    if (parent->hasTrait<OpTrait::IsIsolatedFromAbove>())
+      return parent;
+  return nullptr;
+}
+
+/// Apply a local pattern to the subset of operations of the module selected by
+/// `rangeBase` and `rangeLength`, directly on the module. Before an operation
+/// is rewritten, a copy of its closest IsolatedFromAbove parent is saved in
+/// `savedOps` unless one of its ancestors already was, so that the cost of
+/// the trial is proportional to the operations it modifies rather than to the
+/// module. Operations directly inside the module, and operations whose parent
+/// encloses an already saved one, are left alone. Set `numOps` to the number
+/// of operations the pattern matched.
+static void applyReductionInPlace(ModuleOp module, Reduction &pattern,
+                                  size_t rangeBase, size_t rangeLength,
+                                  size_t &numOps, SavedOps &savedOps) {
+  SmallPtrSet<Operation *, 8> savedSet;
+  size_t opIdx = 0;
+  module.walk([&](Operation *op) {
+    if (!pattern.match(op))
+      return;
+    auto i = opIdx++;
+    if (i < rangeBase || i - rangeBase >= rangeLength)
+      return;
+    auto *parent = getIsolatedParent(op);
+    if (!parent || parent == module)
+      return;
+
+    bool isSaved = false;
+    for (auto *ancestor = parent; ancestor != module && !isSaved;
+         ancestor = ancestor->getParentOp())
+      isSaved = savedSet.count(ancestor);
+    if (!isSaved) {
+      if (llvm::any_of(savedOps, [&](auto &saved) {
+            return parent->isProperAncestor(saved.first);
+          }))
+        return;
+      savedOps.push_back({parent, parent->clone()});
+      savedSet.insert(parent);
+    }
+    (void)pattern.rewrite(op);
+  });
+  numOps = opIdx;
+}
+
+/// Undo a reduction applied in place, by replacing the modified operations
+/// with their saved copies.
+static void undoReduction(SavedOps &savedOps) {
+  for (auto &saved : savedOps) {
+    Operation *op = saved.first;
+    op->getBlock()->getOperations().insert(Block::iterator(op), saved.second);
+    op->replaceAllUsesWith(saved.second);
+    op->erase();
+  }
+  savedOps.clear();
+}
+
+/// Keep a reduction applied in place, by deleting the saved copies of the
+/// modified operations.
+static void commitReduction(SavedOps &savedOps) {
+  for (auto &saved : savedOps)
+    saved.second->erase();
+  savedOps.clear();
+}
+
 /// Execute the main chunk of work of the tool. This function reads the input
 /// module and iteratively applies the reduction strategies until no options
 /// make it smaller.
@@ -90,7 +311,11 @@ static LogicalResult execute(MLIRContext &context) {
     for (auto &arg : testerArgs)
       llvm::dbgs() << "  with argument `" << arg << "`\n";
   });
-  Tester tester(testerCommand, testerArgs);
+  Tester baseTester(testerCommand, testerArgs);
+  CachingTester tester(baseTester);
+  if (!testCacheFilename.empty() &&
+      failed(tester.openCache(testCacheFilename, &context)))
+    return failure();
   auto initialTest = tester.isInteresting(module.get());
   if (initialTest.first != Tester::Interestingness::True) {
     mlir::emitError(UnknownLoc::get(&context), "input is not interesting");
@@ -99,6 +324,14 @@ static LogicalResult execute(MLIRContext &context) {
   auto bestSize = initialTest.second;
   LLVM_DEBUG(llvm::dbgs() << "Initial module has size " << bestSize << "\n");
 
+  // The threads running the tester on speculative candidates, if the user
+  // asked for more than one job.
+  unsigned maxCandidates = std::max(numJobs.getValue(), 1u);
+  std::unique_ptr<llvm::ThreadPool> threadPool;
+  if (maxCandidates > 1)
+    threadPool = std::make_unique<llvm::ThreadPool>(
+        llvm::hardware_concurrency(maxCandidates));
+
   // Gather a list of reduction patterns that we should try.
   SmallVector<std::unique_ptr<Reduction>> patterns;
   createAllReductions(&context, [&](auto reduction) {
@@ -116,37 +349,79 @@ static LogicalResult execute(MLIRContext &context) {
     size_t rangeBase = 0;
     size_t rangeLength = -1;
     bool patternDidReduce = false;
+    // Local patterns are applied directly to the module and undone if the
+    // result is rejected, unless speculative candidates are tested in
+    // parallel, since each of them needs its own module.
+    bool inPlace = pattern.isLocal() && !threadPool;
     while (rangeLength > 0) {
       // Apply the pattern to the subset of operations selected by `rangeBase`
-      // and `rangeLength`.
+      // and `rangeLength`. With multiple jobs, speculatively apply it to the
+      // following subsets of the same length as well, as if the first ones
+      // were going to be rejected. A null candidate stands for the module
+      // itself, when the pattern was applied in place.
       size_t opIdx = 0;
-      OwningModuleRef newModule = module->clone();
-      newModule->walk([&](Operation *op) {
-        if (!pattern.match(op))
-          return;
-        auto i = opIdx++;
-        if (i < rangeBase || i - rangeBase >= rangeLength)
-          return;
-        (void)pattern.rewrite(op);
-      });
+      SmallVector<OwningModuleRef, 8> candidates;
+      SavedOps savedOps;
+      size_t candidateBase = rangeBase;
+      if (inPlace) {
+        applyReductionInPlace(module.get(), pattern, rangeBase, rangeLength,
+                              opIdx, savedOps);
+        candidates.emplace_back();
+      }
+      while (!inPlace) {
+        candidates.push_back(applyReduction(module.get(), pattern,
+                                            candidateBase, rangeLength, opIdx));
+        if (candidates.size() == maxCandidates || rangeLength >= opIdx ||
+            candidateBase + rangeLength >= opIdx)
+          break;
+        candidateBase += rangeLength;
+      }
       if (opIdx == 0) {
         LLVM_DEBUG(llvm::dbgs() << "- No more ops where the pattern applies\n");
         break;
       }
 
-      // Check if this reduced module is still interesting, and its overall size
-      // is smaller than what we had before.
-      auto test = tester.isInteresting(newModule.get());
-      if (test.first == Tester::Interestingness::True &&
-          (test.second < bestSize || pattern.acceptSizeIncrease())) {
+      // Check if the reduced modules are still interesting.
+      auto getCandidate = [&](size_t i) {
+        return candidates[i] ? candidates[i].get() : module.get();
+      };
+      SmallVector<std::pair<Tester::Interestingness, size_t>, 8> tests(
+          candidates.size());
+      if (!threadPool) {
+        tests[0] = tester.isInteresting(getCandidate(0));
+      } else {
+        for (size_t i = 0, e = candidates.size(); i != e; ++i)
+          threadPool->async(
+              [&, i] { tests[i] = tester.isInteresting(getCandidate(i)); });
+        threadPool->wait();
+      }
+
+      // Pick the interesting module whose overall size is the smallest, if it
+      // is smaller than what we had before. Patterns which accept a size
+      // increase take the first interesting module.
+      Optional<size_t> bestCandidate;
+      for (size_t i = 0, e = candidates.size(); i != e; ++i) {
+        if (tests[i].first != Tester::Interestingness::True)
+          continue;
+        if (pattern.acceptSizeIncrease()) {
+          bestCandidate = i;
+          break;
+        }
+        if (tests[i].second < (bestCandidate ? tests[*bestCandidate].second
+                                             : bestSize))
+          bestCandidate = i;
+      }
+      if (bestCandidate) {
         // Make this reduced module the new baseline and reset our search
         // strategy to start again from the beginning, since this reduction may
         // have created additional opportunities.
         patternDidReduce = true;
-        bestSize = test.second;
+        bestSize = tests[*bestCandidate].second;
         LLVM_DEBUG(llvm::dbgs()
                    << "- Accepting module of size " << bestSize << "\n");
-        module = std::move(newModule);
+        if (candidates[*bestCandidate])
+          module = std::move(candidates[*bestCandidate]);
+        commitReduction(savedOps);
 
         // If this was already a run across all operations, no need to restart
         // again at the top. We're done at this point.
@@ -162,10 +437,13 @@ static LogicalResult execute(MLIRContext &context) {
           if (failed(writeOutput(module.get())))
             return failure();
       } else {
-        // Try the pattern on the next `rangeLength` number of operations. If we
-        // go past the end of the input, reduce the size of the chunk of
-        // operations we're reducing and start again from the top.
-        rangeBase += rangeLength;
+        undoReduction(savedOps);
+
+        // Try the pattern on the next `rangeLength` number of operations after
+        // the ones already tested. If we go past the end of the input, reduce
+        // the size of the chunk of operations we're reducing and start again
+        // from the top.
+        rangeBase = candidateBase + rangeLength;
         if (rangeBase >= opIdx) {
           // Exhausted all subsets of this size. Try to go smaller.
           rangeLength = std::min(rangeLength, opIdx) / 2;
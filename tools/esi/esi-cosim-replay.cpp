@@ -0,0 +1,232 @@
+//===- esi-cosim-replay.cpp - Replay the simulation side of cosim ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Tool which stands in for a simulation running the cosim DPI server, by
+// replaying a trace recorded with COSIM_TRACE_FILE. It registers the endpoints
+// of the trace and serves RPC clients like the DPI server does, then plays the
+// messages of the trace in order: it sends the messages the simulation sent
+// to the client, and waits for each message the client sent to the simulation,
+// checking that it is the same as the recorded one. This lets the software
+// side of a cosimulation be tested again without running the simulator.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/ESI/cosim/Server.h"
+#include "circt/Dialect/ESI/cosim/Trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace circt::esi::cosim;
+
+namespace {
+/// A record of the trace along with its payload.
+struct Record {
+  TraceRecord header;
+  std::vector<uint8_t> payload;
+};
+
+/// The options of the tool.
+struct Options {
+  const char *traceFile = nullptr;
+  uint16_t port = 0;
+  unsigned numThreads = 1;
+  /// How long to wait for each message from the client, and for the client to
+  /// close the endpoints at the end, in seconds.
+  double timeout = 60.0;
+  /// Compare the messages from the client to the recorded ones.
+  bool check = true;
+};
+} // namespace
+
+using Clock = std::chrono::steady_clock;
+
+static void printUsage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--port N] [--threads N] [--timeout SECONDS] "
+          "[--no-check] <trace>\n",
+          argv0);
+}
+
+static bool parseOptions(int argc, char **argv, Options &options) {
+  // The port defaults to the one the DPI server would use.
+  if (const char *portEnv = getenv("COSIM_PORT"))
+    options.port = std::strtoul(portEnv, nullptr, 10);
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--port") && hasValue)
+      options.port = std::strtoul(argv[++i], nullptr, 10);
+    else if (!strcmp(arg, "--threads") && hasValue)
+      options.numThreads = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+    else if (!strcmp(arg, "--timeout") && hasValue)
+      options.timeout = std::strtod(argv[++i], nullptr);
+    else if (!strcmp(arg, "--no-check"))
+      options.check = false;
+    else if (arg[0] != '-' && !options.traceFile)
+      options.traceFile = arg;
+    else
+      return false;
+  }
+  return options.traceFile != nullptr;
+}
+
+/// Read all the records of a trace. Return false if the file cannot be read or
+/// is not a trace with endpoint registrations.
+static bool readTrace(const char *fileName, std::vector<Record> &records) {
+  FILE *file = fopen(fileName, "rb");
+  if (!file) {
+    fprintf(stderr, "[replay] Could not open trace %s: %s\n", fileName,
+            strerror(errno));
+    return false;
+  }
+  uint32_t header[2];
+  bool ok = fread(header, sizeof(header), 1, file) == 1 &&
+            header[0] == traceMagic && header[1] == traceVersion;
+  if (!ok)
+    fprintf(stderr, "[replay] %s is not a version %u trace\n", fileName,
+            traceVersion);
+  while (ok) {
+    Record record;
+    if (fread(&record.header, sizeof(record.header), 1, file) != 1)
+      break;
+    record.payload.resize(record.header.size);
+    if (record.header.size &&
+        fread(record.payload.data(), record.header.size, 1, file) != 1) {
+      fprintf(stderr, "[replay] %s is truncated\n", fileName);
+      ok = false;
+    }
+    records.push_back(std::move(record));
+  }
+  fclose(file);
+  return ok;
+}
+
+/// Return true if the timeout started at `start` has expired, and back off
+/// briefly otherwise.
+static bool waitOrTimeout(Clock::time_point start, double timeout) {
+  if (std::chrono::duration<double>(Clock::now() - start).count() > timeout)
+    return true;
+  std::this_thread::sleep_for(std::chrono::microseconds(100));
+  return false;
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage(argv[0]);
+    return 2;
+  }
+
+  std::vector<Record> records;
+  if (!readTrace(options.traceFile, records))
+    return 1;
+
+  // Register the endpoints before any client can connect.
+  RpcServer server;
+  for (auto &record : records) {
+    if (record.header.kind != TraceRecordKind::Endpoint)
+      continue;
+    if (record.header.size != sizeof(TraceEndpoint)) {
+      fprintf(stderr,
+              "[replay] The registration of endpoint %u has %u bytes instead "
+              "of %zu\n",
+              record.header.epId, record.header.size, sizeof(TraceEndpoint));
+      return 1;
+    }
+    TraceEndpoint ep;
+    memcpy(&ep, record.payload.data(), sizeof(ep));
+    if (!server.endpoints.registerEndpoint(
+            record.header.epId, ep.sendTypeId, ep.sendTypeMaxSize,
+            ep.recvTypeId, ep.recvTypeMaxSize, ep.packed != 0)) {
+      fprintf(stderr, "[replay] Could not register endpoint %u\n",
+              record.header.epId);
+      return 1;
+    }
+  }
+  if (server.endpoints.size() == 0) {
+    fprintf(stderr, "[replay] The trace has no endpoints\n");
+    return 1;
+  }
+  server.run(options.port, options.numThreads);
+
+  // Play the messages in the order of the simulation.
+  size_t numToSim = 0, numToClient = 0, numMismatches = 0;
+  for (auto &record : records) {
+    if (record.header.kind == TraceRecordKind::Endpoint)
+      continue;
+    Endpoint *ep = server.endpoints[record.header.epId];
+    if (!ep) {
+      fprintf(stderr, "[replay] Message to unregistered endpoint %u\n",
+              record.header.epId);
+      return 1;
+    }
+
+    auto start = Clock::now();
+    auto &payload = record.payload;
+    if (record.header.kind == TraceRecordKind::MessageToClient) {
+      while (!ep->produceMessageToClient(payload.size(), [&](uint8_t *msg) {
+        memcpy(msg, payload.data(), payload.size());
+      })) {
+        if (waitOrTimeout(start, options.timeout)) {
+          fprintf(stderr,
+                  "[replay] Timed out sending message %zu to the client on "
+                  "endpoint %u\n",
+                  numToClient, record.header.epId);
+          return 1;
+        }
+      }
+      ++numToClient;
+      continue;
+    }
+
+    bool matches = true;
+    while (!ep->consumeMessageToSim([&](const uint8_t *msg, size_t size) {
+      matches = size == payload.size() &&
+                (size == 0 || !memcmp(msg, payload.data(), size));
+    })) {
+      if (waitOrTimeout(start, options.timeout)) {
+        fprintf(stderr,
+                "[replay] Timed out waiting for message %zu from the client "
+                "on endpoint %u\n",
+                numToSim, record.header.epId);
+        return 1;
+      }
+    }
+    if (options.check && !matches) {
+      fprintf(stderr,
+              "[replay] Message %zu from the client on endpoint %u differs "
+              "from the trace\n",
+              numToSim, record.header.epId);
+      ++numMismatches;
+    }
+    ++numToSim;
+  }
+
+  // Let the client read the last messages and close its endpoints.
+  auto start = Clock::now();
+  bool anyInUse = true;
+  while (anyInUse && !waitOrTimeout(start, options.timeout)) {
+    anyInUse = false;
+    server.endpoints.iterateEndpoints(
+        [&](int, const Endpoint &ep) { anyInUse |= ep.isInUse(); });
+  }
+  server.stop();
+
+  printf("[replay] %zu messages to the simulation, %zu mismatched, %zu "
+         "messages to the client\n",
+         numToSim, numMismatches, numToClient);
+  return numMismatches ? 1 : 0;
+}
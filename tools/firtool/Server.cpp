@@ -0,0 +1,286 @@
+//===- Server.cpp - The firtool server protocol ---------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the protocol between the firtool server and its
+// clients. A job is a 32-bit payload size sent along with the three standard
+// streams of the client, followed by the payload: the working directory and
+// the arguments, each terminated by a NUL character. The reply is the 32-bit
+// exit code.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Server.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Errno.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+
+#if LLVM_ON_UNIX
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace circt;
+using namespace firtool;
+
+#if LLVM_ON_UNIX
+
+/// Fill in the address of the socket at `path`. Return false if the path is
+/// too long for a socket address.
+static bool getSocketAddress(llvm::StringRef path, sockaddr_un &address,
+                             std::string &error) {
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    error = "socket path '" + path.str() + "' is too long";
+    return false;
+  }
+  memcpy(address.sun_path, path.data(), path.size());
+  return true;
+}
+
+/// Write all of `size` bytes at `data` to `fd`.
+static bool writeAll(int fd, const void *data, size_t size) {
+  auto *bytes = static_cast<const char *>(data);
+  while (size) {
+    auto written = llvm::sys::RetryAfterSignal(-1, ::write, fd, bytes, size);
+    if (written <= 0)
+      return false;
+    bytes += written;
+    size -= written;
+  }
+  return true;
+}
+
+/// Read all of `size` bytes at `data` from `fd`.
+static bool readAll(int fd, void *data, size_t size) {
+  auto *bytes = static_cast<char *>(data);
+  while (size) {
+    auto numRead = llvm::sys::RetryAfterSignal(-1, ::read, fd, bytes, size);
+    if (numRead <= 0)
+      return false;
+    bytes += numRead;
+    size -= numRead;
+  }
+  return true;
+}
+
+int firtool::listenForClients(llvm::StringRef path, std::string &error) {
+  sockaddr_un address;
+  if (!getSocketAddress(path, address, error))
+    return -1;
+
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (server < 0) {
+    error = "cannot create socket: " + llvm::sys::StrError();
+    return -1;
+  }
+  ::unlink(address.sun_path);
+  ::signal(SIGPIPE, SIG_IGN);
+  if (bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) ||
+      listen(server, SOMAXCONN)) {
+    error = "cannot listen on '" + path.str() + "': " + llvm::sys::StrError();
+    ::close(server);
+    return -1;
+  }
+  return server;
+}
+
+int firtool::receiveJob(int server, ServerJob &job, std::string &error) {
+  int connection = llvm::sys::RetryAfterSignal(-1, ::accept, server, nullptr,
+                                               nullptr);
+  if (connection < 0) {
+    error = "cannot accept client: " + llvm::sys::StrError();
+    return -1;
+  }
+
+  // Receive the payload size, along with the streams of the client.
+  uint32_t payloadSize = 0;
+  iovec iov = {&payloadSize, sizeof(payloadSize)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(job.streams))];
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  auto received =
+      llvm::sys::RetryAfterSignal(-1, ::recvmsg, connection, &message, 0);
+  cmsghdr *header = CMSG_FIRSTHDR(&message);
+  if (received != sizeof(payloadSize) || !header ||
+      header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS ||
+      header->cmsg_len != CMSG_LEN(sizeof(job.streams))) {
+    error = "malformed job";
+    ::close(connection);
+    return -1;
+  }
+  memcpy(job.streams, CMSG_DATA(header), sizeof(job.streams));
+
+  // Receive the working directory and the arguments.
+  std::string payload(payloadSize, '\0');
+  if (!readAll(connection, &payload[0], payloadSize) || payload.empty() ||
+      payload.back() != '\0') {
+    error = "malformed job";
+    finishJob(connection, job, 1);
+    return -1;
+  }
+  job.args.clear();
+  for (llvm::StringRef rest = payload; !rest.empty();) {
+    auto field = rest.split('\0');
+    job.args.push_back(field.first.str());
+    rest = field.second;
+  }
+  job.workingDirectory = job.args.front();
+  job.args.erase(job.args.begin());
+  if (job.args.empty()) {
+    error = "malformed job";
+    finishJob(connection, job, 1);
+    return -1;
+  }
+  return connection;
+}
+
+void firtool::finishJob(int connection, ServerJob &job, int exitCode) {
+  int32_t reply = exitCode;
+  (void)writeAll(connection, &reply, sizeof(reply));
+  ::close(connection);
+  for (int &stream : job.streams) {
+    if (stream >= 0)
+      ::close(stream);
+    stream = -1;
+  }
+}
+
+int firtool::runJob(const ServerJob &job,
+                    llvm::function_ref<int(llvm::ArrayRef<std::string>)> run) {
+  llvm::SmallString<128> serverDirectory;
+  if (llvm::sys::fs::current_path(serverDirectory) ||
+      llvm::sys::fs::set_current_path(job.workingDirectory))
+    return 1;
+
+  // The process-wide streams are buffered, flush them before and after
+  // switching their file descriptors to the ones of the client.
+  llvm::outs().flush();
+  llvm::errs().flush();
+  int serverStreams[3];
+  for (int i = 0; i != 3; ++i) {
+    serverStreams[i] = ::dup(i);
+    ::dup2(job.streams[i], i);
+  }
+
+  int exitCode = run(job.args);
+
+  // The streams of a client which went away fail to write, which must not
+  // carry over to the next job.
+  llvm::outs().flush();
+  llvm::errs().flush();
+  llvm::outs().clear_error();
+  llvm::errs().clear_error();
+  for (int i = 0; i != 3; ++i) {
+    ::dup2(serverStreams[i], i);
+    ::close(serverStreams[i]);
+  }
+  (void)llvm::sys::fs::set_current_path(serverDirectory);
+  return exitCode;
+}
+
+bool firtool::runOnServer(llvm::StringRef path,
+                          llvm::ArrayRef<std::string> args, int &exitCode,
+                          std::string &error) {
+  sockaddr_un address;
+  if (!getSocketAddress(path, address, error))
+    return false;
+
+  llvm::SmallString<128> workingDirectory;
+  if (auto ec = llvm::sys::fs::current_path(workingDirectory)) {
+    error = "cannot get the working directory: " + ec.message();
+    return false;
+  }
+  std::string payload = workingDirectory.str().str();
+  payload.push_back('\0');
+  for (auto &arg : args) {
+    payload += arg;
+    payload.push_back('\0');
+  }
+
+  int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (connection < 0 ||
+      connect(connection, reinterpret_cast<sockaddr *>(&address),
+              sizeof(address))) {
+    error = "cannot connect to the firtool server at '" + path.str() +
+            "': " + llvm::sys::StrError();
+    if (connection >= 0)
+      ::close(connection);
+    return false;
+  }
+
+  // Send the payload size along with the standard streams, then the payload.
+  uint32_t payloadSize = payload.size();
+  iovec iov = {&payloadSize, sizeof(payloadSize)};
+  int streams[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(streams))];
+  memset(control, 0, sizeof(control));
+  msghdr message;
+  memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  cmsghdr *header = CMSG_FIRSTHDR(&message);
+  header->cmsg_level = SOL_SOCKET;
+  header->cmsg_type = SCM_RIGHTS;
+  header->cmsg_len = CMSG_LEN(sizeof(streams));
+  memcpy(CMSG_DATA(header), streams, sizeof(streams));
+
+  int32_t reply;
+  bool sent =
+      llvm::sys::RetryAfterSignal(-1, ::sendmsg, connection, &message, 0) ==
+          (ssize_t)sizeof(payloadSize) &&
+      writeAll(connection, payload.data(), payload.size());
+  bool replied = sent && readAll(connection, &reply, sizeof(reply));
+  ::close(connection);
+  if (!replied) {
+    error = "the firtool server at '" + path.str() + "' did not reply";
+    return false;
+  }
+  exitCode = reply;
+  return true;
+}
+
+#else
+
+int firtool::listenForClients(llvm::StringRef path, std::string &error) {
+  error = "the firtool server is not supported on this host";
+  return -1;
+}
+
+int firtool::receiveJob(int server, ServerJob &job, std::string &error) {
+  error = "the firtool server is not supported on this host";
+  return -1;
+}
+
+void firtool::finishJob(int connection, ServerJob &job, int exitCode) {}
+
+int firtool::runJob(const ServerJob &job,
+                    llvm::function_ref<int(llvm::ArrayRef<std::string>)> run) {
+  return 1;
+}
+
+bool firtool::runOnServer(llvm::StringRef path,
+                          llvm::ArrayRef<std::string> args, int &exitCode,
+                          std::string &error) {
+  error = "the firtool server is not supported on this host";
+  return false;
+}
+
+#endif
@@ -0,0 +1,69 @@
+//===- Server.h - The firtool server protocol -------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the protocol between a firtool server, which runs the
+// jobs of clients one at a time in a warm process, and its clients. A client
+// connects to the Unix socket of the server, and sends its working directory,
+// its command line and its standard streams. The server runs the command line
+// with its standard streams redirected to those of the client, so the output
+// goes straight to the client, and replies with the exit code.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CIRCT_FIRTOOL_SERVER_H
+#define CIRCT_FIRTOOL_SERVER_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+#include <vector>
+
+namespace circt {
+namespace firtool {
+
+/// A job sent by a client.
+struct ServerJob {
+  std::string workingDirectory;
+  /// The command line, starting with the name of the program.
+  std::vector<std::string> args;
+  /// The standard input, output and error streams of the client.
+  int streams[3] = {-1, -1, -1};
+};
+
+/// Listen for clients on a Unix socket at `path`, replacing any stale socket.
+/// Return the listening socket, or -1 and set `error` if unsuccessful. SIGPIPE
+/// is ignored from then on, so that a client going away before its job is done
+/// makes the writes to it fail instead of killing the server.
+int listenForClients(llvm::StringRef path, std::string &error);
+
+/// Wait for the next client of the listening socket `server` and receive its
+/// job. Return the connection to the client, or -1 and set `error` if
+/// unsuccessful.
+int receiveJob(int server, ServerJob &job, std::string &error);
+
+/// Send the exit code of the job to the client on `connection`, and close the
+/// connection and the streams of the job.
+void finishJob(int connection, ServerJob &job, int exitCode);
+
+/// Run `run` on the arguments of the job, in the working directory and with the
+/// standard streams of the client. Return the exit code returned by `run`.
+int runJob(const ServerJob &job,
+           llvm::function_ref<int(llvm::ArrayRef<std::string>)> run);
+
+/// Run a command line on the server listening at `path`, with the working
+/// directory and the standard streams of this process. Return false and set
+/// `error` if there is no server or it fails to reply.
+bool runOnServer(llvm::StringRef path, llvm::ArrayRef<std::string> args,
+                 int &exitCode, std::string &error);
+
+} // namespace firtool
+} // namespace circt
+
+#endif // CIRCT_FIRTOOL_SERVER_H
@@ -0,0 +1,53 @@
+//===- firtool-client.cpp - Run firtool on a firtool server ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements 'firtool-client', which runs its arguments as a firtool
+// command line on a server started with `firtool -server=<socket>`. It behaves
+// like firtool, but without paying for the startup of a firtool process: the
+// client is small and only depends on LLVMSupport.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Server.h"
+
+using namespace llvm;
+using namespace circt;
+
+int main(int argc, char **argv) {
+  // The socket is either the first argument or in the environment.
+  StringRef socketPath;
+  int firstArg = 1;
+  if (argc > 1 && StringRef(argv[1]).startswith("--socket=")) {
+    socketPath = StringRef(argv[1]).drop_front(strlen("--socket="));
+    firstArg = 2;
+  } else if (const char *env = getenv("FIRTOOL_SERVER")) {
+    socketPath = env;
+  }
+  if (socketPath.empty()) {
+    errs() << "usage: firtool-client [--socket=<socket>] <firtool arguments>\n"
+           << "The socket defaults to the FIRTOOL_SERVER environment "
+              "variable.\n";
+    return 1;
+  }
+
+  std::vector<std::string> args = {"firtool"};
+  args.insert(args.end(), argv + firstArg, argv + argc);
+
+  int exitCode;
+  std::string error;
+  if (!firtool::runOnServer(socketPath, args, exitCode, error)) {
+    errs() << "firtool-client: " << error << "\n";
+    return 1;
+  }
+  return exitCode;
+}
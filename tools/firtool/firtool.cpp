@@ -11,36 +11,46 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include "circt/Conversion/Passes.h"
 #include "circt/Dialect/Comb/CombDialect.h"
 #include "circt/Dialect/FIRRTL/FIRParser.h"
 #include "circt/Dialect/FIRRTL/FIRRTLDialect.h"
 #include "circt/Dialect/FIRRTL/FIRRTLOps.h"
-#include "circt/Dialect/FIRRTL/Passes.h"
+#include "circt/Dialect/FIRRTL/FIRSnapshot.h"
 #include "circt/Dialect/HW/HWDialect.h"
 #include "circt/Dialect/HW/HWOps.h"
 #include "circt/Dialect/SV/SVDialect.h"
-#include "circt/Dialect/SV/SVPasses.h"
+#include "circt/Dialect/SV/SVOps.h"
+#include "circt/Firtool/Firtool.h"
+#include "circt/Firtool/PipelineReport.h"
+#include "circt/Firtool/StorageReport.h"
 #include "circt/Support/LoweringOptions.h"
+#include "circt/Support/ThreadingOptions.h"
 #include "circt/Translation/ExportVerilog.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 #include "mlir/IR/AsmState.h"
 #include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Parser.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Pass/PassManager.h"
 #include "mlir/Support/FileUtilities.h"
 #include "mlir/Support/Timing.h"
 #include "mlir/Support/ToolUtilities.h"
-#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
-#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/ScopeExit.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/ToolOutputFile.h"
 
+#include "Server.h"
+
+#include <numeric>
+
 using namespace llvm;
 using namespace mlir;
 using namespace circt;
@@ -48,14 +58,21 @@ using namespace circt;
 /// Allow the user to specify the input file format.  This can be used to
 /// override the input, and can be used to specify ambiguous cases like standard
 /// input.
-enum InputFormatKind { InputUnspecified, InputFIRFile, InputMLIRFile };
+enum InputFormatKind {
+  InputUnspecified,
+  InputFIRFile,
+  InputMLIRFile,
+  InputFIRSnapshot
+};
 
 static cl::opt<InputFormatKind> inputFormat(
     "format", cl::desc("Specify input file format:"),
     cl::values(clEnumValN(InputUnspecified, "autodetect",
                           "Autodetect input format"),
                clEnumValN(InputFIRFile, "fir", "Parse as .fir file"),
-               clEnumValN(InputMLIRFile, "mlir", "Parse as .mlir file")),
+               clEnumValN(InputMLIRFile, "mlir", "Parse as .mlir file"),
+               clEnumValN(InputFIRSnapshot, "firsnap",
+                          "Load as a binary FIRRTL snapshot")),
     cl::init(InputUnspecified));
 
 static cl::opt<std::string>
@@ -70,6 +87,12 @@ static cl::opt<bool>
     parseOnly("parse-only",
               cl::desc("Stop after parsing inputs and annotations"));
 
+static cl::opt<bool>
+    lexOnly("lex-only",
+            cl::desc("Stop after lexing a .fir input, for measuring the "
+                     "performance of the lexer with -mlir-timing"),
+            cl::init(false), cl::Hidden);
+
 static cl::opt<bool>
     splitInputFile("split-input-file",
                    cl::desc("Split the input file into pieces and process each "
@@ -89,6 +112,15 @@ static cl::opt<bool> inliner("inline",
                              cl::desc("Run the FIRRTL module inliner"),
                              cl::init(true));
 
+static cl::opt<bool> autoInline(
+    "auto-inline",
+    cl::desc("also inline small modules that are not annotated for inlining"),
+    cl::init(false));
+
+static cl::opt<bool>
+    dedup("dedup", cl::desc("deduplicate structurally identical modules"),
+          cl::init(false));
+
 static cl::opt<bool> lowerToHW("lower-to-hw",
                                cl::desc("run the lower-to-hw pass"));
 
@@ -103,6 +135,16 @@ static cl::opt<bool> imconstprop(
         "Enable intermodule constant propagation and dead code elimination"),
     cl::init(true));
 
+static cl::opt<bool> parallelIMConstProp(
+    "parallel-imconstprop",
+    cl::desc("propagate constants through each module in parallel"),
+    cl::init(false));
+
+static cl::opt<bool> removeUnusedPorts(
+    "remove-unused-ports",
+    cl::desc("remove the unused and constant ports of internal modules"),
+    cl::init(true));
+
 static cl::opt<bool>
     lowerTypes("lower-types",
                cl::desc("run the lower-types pass within lower-to-hw"),
@@ -122,16 +164,82 @@ static cl::opt<bool>
                        cl::desc("ignore the @info locations in the .fir file"),
                        cl::init(false));
 
+static cl::opt<bool> dropFIRLocations(
+    "drop-fir-locations",
+    cl::desc("do not attach any source locations to the IR parsed from the "
+             ".fir file, neither @info locations nor .fir file locations"),
+    cl::init(false));
+
+static cl::opt<std::string> moduleReportFilename(
+    "fir-module-report",
+    cl::desc("write statistics about parsing each module of a .fir input to "
+             "the specified file"),
+    cl::value_desc("filename"));
+
+enum ModuleReportFormatKind { ModuleReportJSON, ModuleReportChromeTrace };
+
+static cl::opt<ModuleReportFormatKind> moduleReportFormat(
+    "fir-module-report-format", cl::desc("format of the -fir-module-report:"),
+    cl::values(clEnumValN(ModuleReportJSON, "json", "An array of modules"),
+               clEnumValN(ModuleReportChromeTrace, "chrome-trace",
+                          "Chrome trace events, for chrome://tracing")),
+    cl::init(ModuleReportJSON));
+
+static cl::opt<std::string> pipelineReportFilename(
+    "pipeline-report",
+    cl::desc("write the time, memory and operation counts of each pass of the "
+             "pipeline to the specified file"),
+    cl::value_desc("filename"));
+
+static cl::opt<std::string> storageReportFilename(
+    "storage-report",
+    cl::desc("write the number and the estimated size of the attributes and "
+             "types, by dialect and kind, after parsing and after the pipeline "
+             "to the specified file"),
+    cl::value_desc("filename"));
+
+static cl::opt<unsigned> storageReportLargest(
+    "storage-report-largest",
+    cl::desc("the number of largest attributes and types to print in the "
+             "-storage-report"),
+    cl::init(10));
+
 static cl::opt<bool>
     inferWidths("infer-widths",
                 cl::desc("run the width inference pass on firrtl"),
                 cl::init(true));
 
+static cl::opt<bool> parallelInferWidths(
+    "parallel-infer-widths",
+    cl::desc("solve independent width constraints in parallel"),
+    cl::init(false));
+
+static cl::opt<std::string> inferWidthsCache(
+    "infer-widths-cache",
+    cl::desc("reuse widths of unchanged modules from this cache file"),
+    cl::value_desc("filename"), cl::init(""));
+
 static cl::opt<bool>
     inferResets("infer-resets",
                 cl::desc("run the reset inference pass on firrtl"),
                 cl::init(true));
 
+static cl::opt<bool>
+    earlyFold("early-fold",
+              cl::desc("fold firrtl expressions before the types are lowered"),
+              cl::init(true));
+
+static cl::opt<std::string> memoryModel(
+    "memory-model",
+    cl::desc("simulation model of the memories: behavioral, single-process "
+             "or sparse"),
+    cl::init("behavioral"));
+
+static cl::opt<unsigned> sparseMemoryDepth(
+    "sparse-memory-depth",
+    cl::desc("model the memories at least this deep with sparse storage"),
+    cl::init(0));
+
 static cl::opt<bool> extractTestCode("extract-test-code",
                                      cl::desc("run the extract test code pass"),
                                      cl::init(false));
@@ -146,10 +254,16 @@ static cl::opt<bool>
                     cl::desc("check combinational cycles on firrtl"),
                     cl::init(false));
 
+static cl::opt<bool> balanceMuxChains(
+    "balance-mux-chains",
+    cl::desc("balance the priority chains of muxes after lowering to hw"),
+    cl::init(false));
+
 enum OutputFormatKind {
   OutputMLIR,
   OutputVerilog,
   OutputSplitVerilog,
+  OutputSnapshot,
   OutputDisabled
 };
 
@@ -160,6 +274,9 @@ static cl::opt<OutputFormatKind> outputFormat(
                clEnumValN(OutputSplitVerilog, "split-verilog",
                           "Emit Verilog (one file per module; specify "
                           "directory with -o=<dir>)"),
+               clEnumValN(OutputSnapshot, "snapshot",
+                          "Emit a binary FIRRTL snapshot, which can be loaded "
+                          "again with -format=firsnap"),
                clEnumValN(OutputDisabled, "disable-output",
                           "Do not output anything")),
     cl::init(OutputMLIR));
@@ -185,17 +302,275 @@ static cl::opt<std::string> blackBoxRootResourcePath(
         "Optional path to use as the root of black box resource annotations"),
     cl::value_desc("path"), cl::init(""));
 
-/// Create a simple canonicalizer pass.
-static std::unique_ptr<Pass> createSimpleCanonicalizerPass() {
-  mlir::GreedyRewriteConfig config;
-  config.useTopDownTraversal = true;
-  config.enableRegionSimplification = false;
-  return mlir::createCanonicalizerPass(config);
+static cl::opt<std::string> cacheDir(
+    "cache-dir",
+    cl::desc("Reuse the output of an earlier run with the same input and "
+             "options from this directory, and store the output of this run "
+             "there"),
+    cl::value_desc("directory"), cl::init(""));
+
+static cl::opt<bool> incremental(
+    "incremental",
+    cl::desc("With -split-verilog and -cache-dir, reuse the Verilog of the "
+             "modules which are unchanged since an earlier run"),
+    cl::init(false));
+
+static cl::opt<unsigned> numPartitions(
+    "partitions",
+    cl::desc("With -split-verilog, divide the output files of the modules "
+             "between this many runs of firtool on the same input, which "
+             "select theirs with -partition"),
+    cl::init(1));
+
+static cl::opt<unsigned>
+    partitionIndex("partition",
+                   cl::desc("The partition to compile, from 0 to the number "
+                            "of -partitions minus 1"),
+                   cl::init(0));
+
+static cl::opt<unsigned> contextShards(
+    "context-shards",
+    cl::desc("Clean up the HW modules in this many separate MLIR contexts, "
+             "which do not contend with each other (experimental)"),
+    cl::init(1));
+
+static cl::opt<bool> reduceMemory(
+    "reduce-memory",
+    cl::desc("drop the annotations once they are no longer needed, and the "
+             "source locations of a .fir input if the output does not use "
+             "them"),
+    cl::init(false));
+
+enum PhaseKind { PhaseParse, PhasePasses, PhaseOutput };
+
+static cl::list<PhaseKind> serialPhases(
+    "serial-phases", cl::desc("Run these phases on a single thread:"),
+    cl::CommaSeparated,
+    cl::values(clEnumValN(PhaseParse, "parse", "Parsing the input"),
+               clEnumValN(PhasePasses, "passes", "The pass pipeline"),
+               clEnumValN(PhaseOutput, "output", "Writing the output")));
+
+static cl::opt<std::string> serverSocket(
+    "server",
+    cl::desc("Keep running, and run the firtool command lines which "
+             "firtool-client sends to the Unix socket at this path"),
+    cl::value_desc("socket"), cl::init(""));
+
+/// True when running the jobs of a server, which outlives them.
+static bool servingJobs = false;
+
+/// The command line firtool was invoked with, which is part of the key of the
+/// output cache.
+static std::vector<std::string> commandLine;
+
+/// Disable multithreading while in scope if the user asked for a phase to run
+/// on a single thread.
+class SerialPhaseScope {
+public:
+  SerialPhaseScope(MLIRContext &context, PhaseKind phase)
+      : context(context),
+        disabled(context.isMultithreadingEnabled() &&
+                 llvm::is_contained(serialPhases, phase)) {
+    if (disabled)
+      context.disableMultithreading();
+  }
+  ~SerialPhaseScope() {
+    if (disabled)
+      context.enableMultithreading();
+  }
+
+private:
+  MLIRContext &context;
+  bool disabled;
+};
+
+/// Emit the module with `callback`. Note that we intentionally "leak" the
+/// module into the MLIRContext instead of deallocating it. There is no need to
+/// deallocate it right before process exit, unless the process runs the jobs
+/// of a server.
+static LogicalResult
+emitModule(OwningModuleRef &module,
+           llvm::function_ref<LogicalResult(ModuleOp)> callback) {
+  auto result = callback(module.get());
+  if (!servingJobs)
+    (void)module.release();
+  return result;
+}
+
+/// Write the statistics collected while parsing each module to the file
+/// specified with -fir-module-report.
+static LogicalResult
+writeModuleReport(ArrayRef<firrtl::FIRModuleStatistics> statistics) {
+  std::string errorMessage;
+  auto output = openOutputFile(moduleReportFilename, &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return failure();
+  }
+
+  json::OStream json(output->os(), /*IndentSize=*/2);
+  if (moduleReportFormat == ModuleReportJSON) {
+    json.array([&] {
+      for (auto &module : statistics)
+        json.object([&] {
+          json.attribute("module", module.name);
+          json.attribute("bytes", int64_t(module.bytes));
+          json.attribute("tokens", int64_t(module.tokens));
+          json.attribute("ops", int64_t(module.ops));
+          json.attribute("thread", int64_t(module.threadID));
+          json.attribute("startTimeUs", int64_t(module.startTime));
+          json.attribute("parseTimeUs", int64_t(module.parseTime));
+          json.attribute("verifyTimeUs", int64_t(module.verifyTime));
+        });
+    });
+  } else {
+    // Emit complete events for parsing and verifying each module, on the
+    // threads that did so.
+    json.object([&] {
+      json.attributeArray("traceEvents", [&] {
+        for (auto &module : statistics) {
+          auto event = [&](StringRef category, uint64_t start,
+                           uint64_t duration) {
+            json.object([&] {
+              json.attribute("name", module.name);
+              json.attribute("cat", category);
+              json.attribute("ph", "X");
+              json.attribute("pid", 0);
+              json.attribute("tid", int64_t(module.threadID));
+              json.attribute("ts", int64_t(start));
+              json.attribute("dur", int64_t(duration));
+              json.attributeObject("args", [&] {
+                json.attribute("bytes", int64_t(module.bytes));
+                json.attribute("tokens", int64_t(module.tokens));
+                json.attribute("ops", int64_t(module.ops));
+              });
+            });
+          };
+          event("parse", module.startTime, module.parseTime);
+          event("verify", module.startTime + module.parseTime,
+                module.verifyTime);
+        }
+      });
+    });
+  }
+  output->os() << "\n";
+  output->keep();
+  return success();
+}
+
+/// Write the measurements of the pipeline to the file specified with
+/// -pipeline-report.
+static LogicalResult
+writePipelineReport(firtool::PipelineReportInstrumentation &instrumentation) {
+  std::string errorMessage;
+  auto output = openOutputFile(pipelineReportFilename, &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return failure();
+  }
+  instrumentation.writeJSON(output->os());
+  output->keep();
+  return success();
+}
+
+/// Write the storage measured after each phase to the file specified with
+/// -storage-report.
+static LogicalResult writeStorageReport(
+    ArrayRef<std::pair<StringRef, firtool::StorageReport>> reports) {
+  std::string errorMessage;
+  auto output = openOutputFile(storageReportFilename, &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return failure();
+  }
+
+  json::OStream json(output->os(), /*IndentSize=*/2);
+  json.array([&] {
+    for (auto &report : reports)
+      json.object([&] {
+        json.attribute("phase", report.first);
+        report.second.writeJSON(json, storageReportLargest);
+      });
+  });
+  output->os() << "\n";
+  output->keep();
+  return success();
+}
+
+/// The Verilog emitted for individual modules by earlier runs, stored in the
+/// "modules" subdirectory of the cache directory. The output file of a module
+/// is keyed on a fingerprint of everything it depends on: the module after the
+/// design-wide passes, the ports of the modules it instantiates, the top-level
+/// operations replicated in each output file and the firtool options.
+class ModuleCache {
+public:
+  /// Replace each module whose output file is in the cache by an external
+  /// module emitted into the same file, so the remaining passes skip it.
+  void stubCachedModules(ModuleOp module);
+
+  /// Complete the Verilog split into `directory`: restore the output files of
+  /// the modules stubbed out and store those of the others in the cache.
+  LogicalResult restoreAndStore(StringRef directory);
+
+private:
+  std::string getCachePath(StringRef fingerprint) const;
+
+  /// The output file and the fingerprint of each module whose Verilog was
+  /// reused from the cache, and of each module emitted by this run.
+  SmallVector<std::pair<std::string, std::string>> reused, emitted;
+};
+
+/// One of the partitions of the modules of a design, which runs of firtool on
+/// the same input with the same options compile separately, e.g. on different
+/// machines. Every run parses the input and runs the passes on the whole
+/// design, so that all of them agree on the ports, widths, resets and
+/// annotations of every module. The output files of the modules are then
+/// divided between the partitions, and each run stubs out the modules of the
+/// others before the remaining passes and the emission. Every output file is
+/// written by exactly one run into the shared output directory, so the runs
+/// may write it concurrently, and its contents are the same as those of a
+/// single run without partitions.
+class DesignPartition {
+public:
+  DesignPartition(unsigned index, unsigned numPartitions)
+      : index(index), numPartitions(numPartitions) {}
+
+  /// Divide the modules between the partitions and replace the modules of
+  /// the other partitions by external modules.
+  void stubOtherModules(ModuleOp module);
+
+  /// Emit the Verilog split into a staging directory, and copy the output
+  /// files of this partition into `directory`. The first partition also
+  /// writes the file list and the output files that don't hold a module.
+  LogicalResult exportSplitVerilog(ModuleOp module, StringRef directory);
+
+private:
+  unsigned index, numPartitions;
+
+  /// The output files of the modules of this partition, and of the others.
+  llvm::StringSet<> ownFiles, otherFiles;
+};
+
+/// Return true if the output refers to the source locations of the input: the
+/// Verilog and the snapshots do, and the MLIR does if it prints the debug info.
+static bool outputUsesLocations() {
+  switch (outputFormat) {
+  case OutputMLIR:
+    return OpPrintingFlags().shouldPrintDebugInfo();
+  case OutputDisabled:
+    return false;
+  case OutputVerilog:
+  case OutputSplitVerilog:
+  case OutputSnapshot:
+    return true;
+  }
+  return true;
 }
 
 /// Process a single buffer of the input.
 static LogicalResult
 processBuffer(MLIRContext &context, TimingScope &ts, llvm::SourceMgr &sourceMgr,
+              ModuleCache *moduleCache, DesignPartition *partition,
               llvm::function_ref<LogicalResult(ModuleOp)> callback) {
   // Add the annotation file if one was explicitly specified.
   std::string annotationFilenameDetermined;
@@ -209,138 +584,164 @@ processBuffer(MLIRContext &context, TimingScope &ts, llvm::SourceMgr &sourceMgr,
     }
   }
 
+  // If the user asked to just lex the input, do that and stop.
+  if (lexOnly) {
+    if (inputFormat != InputFIRFile) {
+      llvm::errs() << "-lex-only requires a .fir input\n";
+      return failure();
+    }
+    auto lexerTimer = ts.nest("FIR Lexer");
+    size_t numTokens;
+    return firrtl::lexFIRFile(sourceMgr, &context, numTokens);
+  }
+
   // Parse the input.
   OwningModuleRef module;
   if (inputFormat == InputFIRFile) {
     auto parserTimer = ts.nest("FIR Parser");
+    SerialPhaseScope serialPhase(context, PhaseParse);
     firrtl::FIRParserOptions options;
     options.ignoreInfoLocators = ignoreFIRLocations;
+    options.ignoreAllLocations =
+        dropFIRLocations || (reduceMemory && !outputUsesLocations());
+    std::vector<firrtl::FIRModuleStatistics> moduleStatistics;
+    if (!moduleReportFilename.empty())
+      options.moduleStatistics = &moduleStatistics;
     module = importFIRFile(sourceMgr, &context, options);
+    if (!moduleReportFilename.empty() &&
+        failed(writeModuleReport(moduleStatistics)))
+      return failure();
+  } else if (inputFormat == InputFIRSnapshot) {
+    auto parserTimer = ts.nest("FIR Snapshot Reader");
+    SerialPhaseScope serialPhase(context, PhaseParse);
+    module = firrtl::importFIRSnapshot(sourceMgr, &context);
   } else {
     auto parserTimer = ts.nest("MLIR Parser");
+    SerialPhaseScope serialPhase(context, PhaseParse);
     assert(inputFormat == InputMLIRFile);
     module = parseSourceFile(sourceMgr, &context);
   }
   if (!module)
     return failure();
 
+  // Measure the attributes and types after parsing and after the pipeline.
+  // Everything measured after parsing is still held by the context later on,
+  // even if the IR no longer refers to it.
+  SmallVector<std::pair<StringRef, firtool::StorageReport>, 2> storageReports;
+  if (!storageReportFilename.empty()) {
+    storageReports.emplace_back("parse", firtool::StorageReport());
+    storageReports.back().second.collect(module.get());
+  }
+
   // If the user asked for just a parse, stop here.
   if (parseOnly) {
+    if (!storageReports.empty() && failed(writeStorageReport(storageReports)))
+      return failure();
     auto outputTimer = ts.nest("Output");
-    return callback(module.release());
+    SerialPhaseScope serialPhase(context, PhaseOutput);
+    return emitModule(module, callback);
   }
 
+  // Load the emitter options from the command line. Command line options if
+  // specified will override any module options.
+  applyLoweringCLOptions(module.get());
+
   // Apply any pass manager command line options.
   PassManager pm(&context);
   pm.enableVerifier(verifyPasses);
   pm.enableTiming(ts);
   applyPassManagerCLOptions(pm);
 
-  if (!disableOptimization) {
-    pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>().addPass(
-        createCSEPass());
+  firtool::PipelineReportInstrumentation *pipelineReport = nullptr;
+  if (!pipelineReportFilename.empty()) {
+    auto instrumentation =
+        std::make_unique<firtool::PipelineReportInstrumentation>();
+    pipelineReport = instrumentation.get();
+    pm.addInstrumentation(std::move(instrumentation));
   }
 
-  // Width inference creates canonicalization opportunities.
-  if (inferWidths)
-    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createInferWidthsPass());
-
-  if (inferResets)
-    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createInferResetsPass());
+  // Run the pipeline, writing the pipeline report even if it fails.
+  auto runPipeline = [&]() -> LogicalResult {
+    SerialPhaseScope serialPhase(context, PhasePasses);
+    auto result = pm.run(module.get());
+    if (pipelineReport && failed(writePipelineReport(*pipelineReport)))
+      return failure();
+    return result;
+  };
 
-  // The input mlir file could be firrtl dialect so we might need to clean
-  // things up.
-  if (lowerTypes) {
-    pm.addNestedPass<firrtl::CircuitOp>(firrtl::createLowerFIRRTLTypesPass());
-    // Only enable expand whens if lower types is also enabled.
-    if (expandWhens) {
-      auto &modulePM = pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>();
-      modulePM.addPass(firrtl::createExpandWhensPass());
-    }
+  firtool::FirtoolOptions options;
+  options.disableOptimization = disableOptimization;
+  options.inferWidths = inferWidths;
+  options.parallelInferWidths = parallelInferWidths;
+  options.inferWidthsCache = inferWidthsCache;
+  options.inferResets = inferResets;
+  options.earlyFold = earlyFold;
+  options.lowerTypes = lowerTypes;
+  options.expandWhens = expandWhens;
+  options.checkCombCycles = checkCombCycles;
+  options.inliner = inliner;
+  options.autoInline = autoInline;
+  // -disable-opt turns off constant propagation unless it was explicitly
+  // enabled.
+  if (imconstprop.getNumOccurrences())
+    options.imconstprop = imconstprop;
+  options.parallelIMConstProp = parallelIMConstProp;
+  options.removeUnusedPorts = removeUnusedPorts;
+  options.dedup = dedup;
+  options.blackBoxMemory = blackBoxMemory;
+  options.blackBoxRoot = blackBoxRootPath.empty()
+                             ? llvm::sys::path::parent_path(inputFilename).str()
+                             : blackBoxRootPath;
+  options.blackBoxResourceRoot = blackBoxRootResourcePath;
+  options.grandCentral = grandCentral;
+  options.lowerToHW = lowerToHW;
+  options.emitVerilog =
+      outputFormat == OutputVerilog || outputFormat == OutputSplitVerilog;
+  options.memoryModel = memoryModel;
+  options.sparseMemoryDepth = sparseMemoryDepth;
+  options.extractTestCode = extractTestCode;
+  options.balanceMuxChains = balanceMuxChains;
+  options.warnOnUnprocessedAnnotations = enableAnnotationWarning;
+  options.reduceMemory = reduceMemory;
+  firtool::populateFIRRTLToHWPasses(pm, options);
+
+  // The modules whose Verilog is reused, or which another partition compiles,
+  // skip the remaining passes, so these run separately once the modules are
+  // known. So does the cleanup when it is divided between contexts.
+  bool shardCleanup = contextShards > 1 && options.lowersToHW();
+  if ((moduleCache || partition || shardCleanup) && options.lowersToHW()) {
+    if (failed(runPipeline()))
+      return failure();
+    if (moduleCache)
+      moduleCache->stubCachedModules(module.get());
+    if (partition)
+      partition->stubOtherModules(module.get());
+    pm.clear();
   }
 
-  if (checkCombCycles)
-    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createCheckCombCyclesPass());
-
-  // If we parsed a FIRRTL file and have optimizations enabled, clean it up.
-  if (!disableOptimization)
-    pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>().addPass(
-        createSimpleCanonicalizerPass());
-
-  if (inliner)
-    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createInlinerPass());
-
-  if (imconstprop)
-    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createIMConstPropPass());
-
-  if (blackBoxMemory)
-    pm.nest<firrtl::CircuitOp>().addPass(firrtl::createBlackBoxMemoryPass());
-
-  // Read black box source files into the IR.
-  StringRef blackBoxRoot = blackBoxRootPath.empty()
-                               ? llvm::sys::path::parent_path(inputFilename)
-                               : blackBoxRootPath;
-  pm.nest<firrtl::CircuitOp>().addPass(firrtl::createBlackBoxReaderPass(
-      blackBoxRoot, blackBoxRootResourcePath.empty()
-                        ? blackBoxRoot
-                        : blackBoxRootResourcePath));
-
-  if (grandCentral) {
-    auto &circuitPM = pm.nest<firrtl::CircuitOp>();
-    circuitPM.addPass(firrtl::createGrandCentralPass());
-    circuitPM.addPass(firrtl::createGrandCentralTapsPass());
-  }
-
-  // The above passes, IMConstProp in particular, introduce additional
-  // canonicalization opportunities that we should pick up here before we
-  // proceed to output-specific pipelines.
-  if (!disableOptimization)
-    pm.nest<firrtl::CircuitOp>().nest<firrtl::FModuleOp>().addPass(
-        createSimpleCanonicalizerPass());
-
-  // Lower if we are going to verilog or if lowering was specifically requested.
-  if (lowerToHW || outputFormat == OutputVerilog ||
-      outputFormat == OutputSplitVerilog) {
-    pm.addPass(createLowerFIRRTLToHWPass(enableAnnotationWarning.getValue()));
-    pm.addPass(sv::createHWMemSimImplPass());
-
-    if (extractTestCode)
-      pm.addPass(sv::createSVExtractTestCodePass());
-
-    // If enabled, run the optimizer.
-    if (!disableOptimization) {
-      auto &modulePM = pm.nest<hw::HWModuleOp>();
-      modulePM.addPass(sv::createHWCleanupPass());
-      modulePM.addPass(createCSEPass());
-      modulePM.addPass(createSimpleCanonicalizerPass());
-    }
+  if (shardCleanup) {
+    auto cleanupTimer = ts.nest("Sharded HW Cleanup");
+    SerialPhaseScope serialPhase(context, PhasePasses);
+    if (failed(firtool::runShardedHWCleanup(module.get(), options,
+                                            contextShards)))
+      return failure();
+  } else {
+    firtool::populateHWCleanupPasses(pm, options);
+    if (failed(runPipeline()))
+      return failure();
   }
 
-  // Add passes specific to Verilog emission if we're going there.
-  if (outputFormat == OutputVerilog || outputFormat == OutputSplitVerilog) {
-    // Legalize the module names.
-    pm.addPass(sv::createHWLegalizeNamesPass());
-
-    // Tidy up the IR to improve verilog emission quality.
-    if (!disableOptimization) {
-      auto &modulePM = pm.nest<hw::HWModuleOp>();
-      modulePM.addPass(sv::createPrettifyVerilogPass());
-    }
+  if (!storageReports.empty()) {
+    storageReports.emplace_back("pipeline", firtool::StorageReport());
+    storageReports.back().second.collect(module.get());
+    if (failed(writeStorageReport(storageReports)))
+      return failure();
   }
 
-  // Load the emitter options from the command line. Command line options if
-  // specified will override any module options.
-  applyLoweringCLOptions(module.get());
-
-  if (failed(pm.run(module.get())))
-    return failure();
-
   auto outputTimer = ts.nest("Output");
+  SerialPhaseScope serialPhase(context, PhaseOutput);
 
-  // Note that we intentionally "leak" the Module into the MLIRContext instead
-  // of deallocating it.  There is no need to deallocate it right before
-  // process exit.
-  return callback(module.release());
+  return emitModule(module, callback);
 }
 
 /// Process a single split of the input. This allocates a source manager and
@@ -349,17 +750,20 @@ processBuffer(MLIRContext &context, TimingScope &ts, llvm::SourceMgr &sourceMgr,
 static LogicalResult
 processInputSplit(MLIRContext &context, TimingScope &ts,
                   std::unique_ptr<llvm::MemoryBuffer> buffer,
+                  ModuleCache *moduleCache, DesignPartition *partition,
                   llvm::function_ref<LogicalResult(ModuleOp)> emitCallback) {
   llvm::SourceMgr sourceMgr;
   sourceMgr.AddNewSourceBuffer(std::move(buffer), llvm::SMLoc());
   if (verifyDiagnostics) {
     SourceMgrDiagnosticVerifierHandler sourceMgrHandler(sourceMgr, &context);
     context.printOpOnDiagnostic(false);
-    (void)processBuffer(context, ts, sourceMgr, emitCallback);
+    (void)processBuffer(context, ts, sourceMgr, moduleCache, partition,
+                        emitCallback);
     return sourceMgrHandler.verify();
   } else {
     SourceMgrDiagnosticHandler sourceMgrHandler(sourceMgr, &context);
-    return processBuffer(context, ts, sourceMgr, emitCallback);
+    return processBuffer(context, ts, sourceMgr, moduleCache, partition,
+                         emitCallback);
   }
 }
 
@@ -368,6 +772,7 @@ processInputSplit(MLIRContext &context, TimingScope &ts,
 static LogicalResult
 processInput(MLIRContext &context, TimingScope &ts,
              std::unique_ptr<llvm::MemoryBuffer> input,
+             ModuleCache *moduleCache, DesignPartition *partition,
              llvm::function_ref<LogicalResult(ModuleOp)> emitCallback) {
   if (splitInputFile) {
     // Emit an error if the user provides a separate annotation file alongside
@@ -387,14 +792,448 @@ processInput(MLIRContext &context, TimingScope &ts,
         std::move(input),
         [&](std::unique_ptr<MemoryBuffer> buffer, raw_ostream &) {
           return processInputSplit(context, ts, std::move(buffer),
-                                   emitCallback);
+                                   moduleCache, partition, emitCallback);
         },
         llvm::outs());
   } else {
-    return processInputSplit(context, ts, std::move(input), emitCallback);
+    return processInputSplit(context, ts, std::move(input), moduleCache,
+                             partition, emitCallback);
+  }
+}
+
+/// Add a field of a cache key to `hasher`.
+static void addKeyField(llvm::MD5 &hasher, StringRef field) {
+  hasher.update(field);
+  hasher.update(StringRef("", 1));
+}
+
+/// The options which change where the output goes or how firtool runs, but not
+/// what the output is. They are left out of the cache key.
+static const char *const outputNeutralOptions[] = {
+    "o",
+    "cache-dir",
+    "threads",
+    "thread-affinity",
+    "serial-phases",
+    "context-shards",
+    "parallel-imconstprop",
+    "parallel-infer-widths",
+    "infer-widths-cache",
+    "storage-report-largest",
+    "mlir-disable-threading",
+    "mlir-timing",
+    "mlir-timing-display",
+    "mlir-pass-statistics",
+    "mlir-pass-statistics-display",
+    "mlir-pass-pipeline-crash-reproducer",
+    "mlir-pass-pipeline-local-reproducer",
+    "mlir-print-ir-before",
+    "mlir-print-ir-after",
+    "mlir-print-ir-before-all",
+    "mlir-print-ir-after-all",
+    "mlir-print-ir-after-change",
+    "mlir-print-ir-module-scope",
+};
+
+/// Add the firtool executable and the command line except for the options
+/// which do not change the output to a cache key. Return failure if the
+/// executable can't be identified.
+static LogicalResult addToolAndOptions(llvm::MD5 &hasher) {
+  auto addField = [&](StringRef field) { addKeyField(hasher, field); };
+
+  // A different firtool may produce a different output, identify it by the
+  // size and the modification time of its executable.
+  auto executable = llvm::sys::fs::getMainExecutable(
+      commandLine[0].c_str(), (void *)(intptr_t)addToolAndOptions);
+  llvm::sys::fs::file_status status;
+  if (llvm::sys::fs::status(executable, status))
+    return failure();
+  addField(executable);
+  addField(std::to_string(status.getSize()));
+  addField(std::to_string(
+      status.getLastModificationTime().time_since_epoch().count()));
+
+  auto &options = cl::getRegisteredOptions();
+  for (size_t i = 1, e = commandLine.size(); i != e; ++i) {
+    StringRef arg = commandLine[i];
+    if (!arg.startswith("-")) {
+      addField(arg);
+      continue;
+    }
+    StringRef name, value;
+    std::tie(name, value) = arg.ltrim('-').split('=');
+    if (!llvm::is_contained(outputNeutralOptions, name)) {
+      addField(arg);
+      continue;
+    }
+    // Also skip the value of an option given as `-name value`.
+    auto option = options.find(name);
+    if (!arg.contains('=') && option != options.end() &&
+        option->second->getValueExpectedFlag() == cl::ValueRequired)
+      ++i;
+  }
+  return success();
+}
+
+/// Compute the key of the output cache for this run: a hash of the firtool
+/// executable, the command line except for the output locations, the input and
+/// the annotation file. Return None if the output of this run can't be cached.
+static Optional<std::string> getCacheKey(const llvm::MemoryBuffer &input) {
+  llvm::MD5 hasher;
+  auto addField = [&](StringRef field) { addKeyField(hasher, field); };
+  if (failed(addToolAndOptions(hasher)))
+    return None;
+
+  addField(input.getBuffer());
+  if (!inputAnnotationFilename.empty()) {
+    auto annotations = llvm::MemoryBuffer::getFile(inputAnnotationFilename);
+    if (!annotations)
+      return None;
+    addField((*annotations)->getBuffer());
+  }
+
+  llvm::MD5::MD5Result result;
+  hasher.final(result);
+  return result.digest().str().str();
+}
+
+/// Write `contents` to the file at `path`, unless it already holds them, so
+/// that the build systems looking at the file don't consider it changed.
+static LogicalResult writeFileIfChanged(StringRef path, StringRef contents) {
+  if (auto existing = llvm::MemoryBuffer::getFile(path))
+    if ((*existing)->getBuffer() == contents)
+      return success();
+
+  std::error_code error;
+  llvm::raw_fd_ostream os(path, error);
+  if (!error)
+    os << contents;
+  if (error || os.has_error()) {
+    llvm::errs() << "cannot write output file '" << path << "'\n";
+    return failure();
+  }
+  return success();
+}
+
+/// Copy the files of the directory `from` into the directory `to`, only
+/// writing the ones which differ. If given, `filter` selects the files to copy
+/// by their path relative to `from`.
+static LogicalResult
+copyOutputDirectory(StringRef from, StringRef to,
+                    llvm::function_ref<bool(StringRef)> filter = {}) {
+  std::error_code error;
+  for (llvm::sys::fs::recursive_directory_iterator it(from, error), end;
+       it != end && !error; it.increment(error)) {
+    StringRef relative = StringRef(it->path()).drop_front(from.size());
+    SmallString<128> target(to);
+    llvm::sys::path::append(target, relative);
+    if (it->type() == llvm::sys::fs::file_type::directory_file) {
+      error = llvm::sys::fs::create_directories(target);
+      continue;
+    }
+    if (filter && !filter(relative.drop_while([](char c) {
+          return llvm::sys::path::is_separator(c);
+        })))
+      continue;
+    auto contents = llvm::MemoryBuffer::getFile(it->path());
+    if (!contents) {
+      error = contents.getError();
+      break;
+    }
+    if (failed(writeFileIfChanged(target, (*contents)->getBuffer())))
+      return failure();
+  }
+  if (error) {
+    llvm::errs() << "cannot copy '" << from << "' to '" << to
+                 << "': " << error.message() << "\n";
+    return failure();
+  }
+  return success();
+}
+
+/// The output of a run stored in a cache entry, which is a directory named
+/// after the key of the run. Split Verilog output is stored as is, the other
+/// formats in a file named "output".
+struct CachedOutput {
+  /// The directory of the cache entry.
+  SmallString<128> entry;
+  /// The directory the output of this run is written to until it is complete
+  /// and moved to `entry`. Empty if the output is not stored in the cache.
+  SmallString<128> staging;
+  /// The single output file, until it is complete.
+  std::string contents;
+  llvm::raw_string_ostream os{contents};
+
+  /// Write the output stored in the cache entry. Return failure if there is
+  /// no usable entry.
+  LogicalResult restore(llvm::ToolOutputFile *outputFile) {
+    if (!llvm::sys::fs::is_directory(entry))
+      return failure();
+    if (!outputFile)
+      return copyOutputDirectory(entry, outputFilename);
+    SmallString<128> path(entry);
+    llvm::sys::path::append(path, "output");
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer)
+      return failure();
+    outputFile->os() << (*buffer)->getBuffer();
+    return success();
+  }
+
+  /// Create the staging directory of the output of this run. If unsuccessful,
+  /// the output is not stored in the cache.
+  void startStaging() {
+    if (llvm::sys::fs::create_directories(cacheDir))
+      return;
+    llvm::sys::fs::createUniquePath(Twine(entry) + "-%%%%%%%%", staging,
+                                    /*MakeAbsolute=*/false);
+    if (llvm::sys::fs::create_directory(staging))
+      staging.clear();
+  }
+
+  /// Write the output of this run where the user asked, and store it in the
+  /// cache entry.
+  LogicalResult finish(llvm::ToolOutputFile *outputFile) {
+    if (outputFile) {
+      outputFile->os() << os.str();
+      SmallString<128> path(staging);
+      llvm::sys::path::append(path, "output");
+      if (failed(writeFileIfChanged(path, contents))) {
+        discard();
+        return success();
+      }
+    } else if (failed(copyOutputDirectory(staging, outputFilename))) {
+      discard();
+      return failure();
+    }
+
+    // Another firtool may have stored the same output in the meantime, keep
+    // theirs.
+    if (llvm::sys::fs::rename(staging, entry))
+      discard();
+    return success();
+  }
+
+  /// Remove the staging directory.
+  void discard() { (void)llvm::sys::fs::remove_directories(staging); }
+};
+
+/// Replace `mod` by an external module with the same ports, which is emitted
+/// alone into the output file `fileName`.
+static void stubOutModule(hw::HWModuleOp mod, StringRef fileName) {
+  OpBuilder builder(mod);
+  auto stub = builder.create<hw::HWModuleExternOp>(
+      mod.getLoc(), builder.getStringAttr(mod.getName()), mod.getPorts());
+  stub->setAttr("output_file",
+                hw::OutputFileAttr::get(builder.getStringAttr(""),
+                                        builder.getStringAttr(fileName),
+                                        builder.getBoolAttr(false),
+                                        builder.getBoolAttr(true),
+                                        builder.getContext()));
+  mod.erase();
+}
+
+std::string ModuleCache::getCachePath(StringRef fingerprint) const {
+  SmallString<128> path(cacheDir);
+  llvm::sys::path::append(path, "modules", fingerprint + ".sv");
+  return path.str().str();
+}
+
+void ModuleCache::stubCachedModules(ModuleOp module) {
+  llvm::MD5 contextHasher;
+  if (failed(addToolAndOptions(contextHasher)))
+    return;
+
+  // The output file of a module holds the operations replicated in each file
+  // around the module, depending on its position among them.
+  auto flags = OpPrintingFlags().enableDebugInfo();
+  SmallVector<hw::HWModuleOp> modules;
+  SmallVector<size_t> positions;
+  size_t numOtherOps = 0;
+  for (auto &op : *module.getBody()) {
+    // Bound instances refer to the inside of their modules, which would be
+    // gone once stubbed out.
+    if (isa<sv::BindOp, sv::BindInterfaceOp>(op))
+      return;
+    if (auto mod = dyn_cast<hw::HWModuleOp>(op)) {
+      if (!mod->hasAttr("output_file")) {
+        modules.push_back(mod);
+        positions.push_back(numOtherOps);
+      }
+      continue;
+    }
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    op.print(os, flags);
+    addKeyField(contextHasher, os.str());
+    ++numOtherOps;
+  }
+  llvm::MD5::MD5Result contextHash;
+  contextHasher.final(contextHash);
+
+  SymbolTable symbolTable(module);
+  SmallVector<std::string> fingerprints(modules.size());
+  mlir::parallelForEachN(module.getContext(), 0, modules.size(), [&](size_t i) {
+    llvm::MD5 hasher;
+    addKeyField(hasher, contextHash.digest());
+    addKeyField(hasher, std::to_string(positions[i]));
+
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    modules[i]->print(os, flags);
+    // Instances are emitted with the port names of their modules.
+    modules[i].walk([&](hw::InstanceOp inst) {
+      if (auto *target = symbolTable.lookup(inst.moduleName()))
+        os << target->getAttrDictionary();
+    });
+    addKeyField(hasher, os.str());
+
+    llvm::MD5::MD5Result result;
+    hasher.final(result);
+    fingerprints[i] = result.digest().str().str();
+  });
+
+  for (size_t i = 0, e = modules.size(); i != e; ++i) {
+    auto mod = modules[i];
+    std::string fileName = (mod.getName() + ".sv").str();
+    if (!llvm::sys::fs::exists(getCachePath(fingerprints[i]))) {
+      emitted.push_back({fileName, fingerprints[i]});
+      continue;
+    }
+    reused.push_back({fileName, fingerprints[i]});
+
+    // The stub is emitted into the output file of the module, which is
+    // restored after emission.
+    stubOutModule(mod, fileName);
+  }
+}
+
+LogicalResult ModuleCache::restoreAndStore(StringRef directory) {
+  for (auto &file : reused) {
+    auto contents = llvm::MemoryBuffer::getFile(getCachePath(file.second));
+    if (!contents) {
+      llvm::errs() << "cannot read cached output file '"
+                   << getCachePath(file.second) << "'\n";
+      return failure();
+    }
+    SmallString<128> path(directory);
+    llvm::sys::path::append(path, file.first);
+    if (failed(writeFileIfChanged(path, (*contents)->getBuffer())))
+      return failure();
+  }
+
+  // Failing to store an output file only costs a later run its reuse.
+  for (auto &file : emitted) {
+    SmallString<128> path(directory);
+    llvm::sys::path::append(path, file.first);
+    auto contents = llvm::MemoryBuffer::getFile(path);
+    auto cachePath = getCachePath(file.second);
+    auto cacheDirectory = llvm::sys::path::parent_path(cachePath);
+    if (!contents || llvm::sys::fs::create_directories(cacheDirectory))
+      continue;
+
+    // Write the file next to its final location and move it there, so that
+    // concurrent runs never read a partial file.
+    SmallString<128> tempPath;
+    llvm::sys::fs::createUniquePath(cachePath + "-%%%%%%%%", tempPath,
+                                    /*MakeAbsolute=*/false);
+    if (failed(writeFileIfChanged(tempPath, (*contents)->getBuffer())) ||
+        llvm::sys::fs::rename(tempPath, cachePath))
+      (void)llvm::sys::fs::remove(tempPath);
+  }
+  return success();
+}
+
+/// Return the path of the output file of `mod` relative to the output
+/// directory.
+static std::string getOutputFilePath(hw::HWModuleOp mod) {
+  SmallString<64> path;
+  auto attr = mod->getAttrOfType<hw::OutputFileAttr>("output_file");
+  if (attr && attr.directory())
+    llvm::sys::path::append(path, attr.directory().getValue());
+  if (attr && attr.name() && !attr.name().getValue().empty())
+    llvm::sys::path::append(path, attr.name().getValue());
+  else
+    llvm::sys::path::append(path, mod.getName() + ".sv");
+  return path.str().str();
+}
+
+void DesignPartition::stubOtherModules(ModuleOp module) {
+  // The modules whose instances are bound elsewhere must be kept, since the
+  // binds refer to their insides.
+  DenseSet<Operation *> boundModules;
+  for (auto &op : *module.getBody()) {
+    Operation *inst = nullptr;
+    if (auto bind = dyn_cast<sv::BindOp>(op))
+      inst = bind.getReferencedInstance();
+    else if (auto bind = dyn_cast<sv::BindInterfaceOp>(op))
+      inst = bind.getReferencedInstance();
+    if (inst)
+      boundModules.insert(inst->getParentOfType<hw::HWModuleOp>());
+  }
+
+  // The output files are the unit of the division, since several modules may
+  // share one. They are weighed by the number of operations in their modules.
+  llvm::MapVector<StringRef, SmallVector<hw::HWModuleOp, 1>> files;
+  SmallVector<std::string> paths;
+  for (auto mod : module.getOps<hw::HWModuleOp>())
+    paths.push_back(getOutputFilePath(mod));
+  for (auto it : llvm::zip(module.getOps<hw::HWModuleOp>(), paths))
+    files[std::get<1>(it)].push_back(std::get<0>(it));
+
+  SmallVector<size_t> weights;
+  for (auto &file : files) {
+    size_t weight = 1;
+    for (auto mod : file.second)
+      mod.walk([&](Operation *) { ++weight; });
+    weights.push_back(weight);
+  }
+
+  // Assign the heaviest remaining file to the least loaded partition. The
+  // ties are broken by the order of the modules, so that all runs agree on
+  // the division.
+  SmallVector<size_t> order(files.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return weights[a] > weights[b]; });
+  SmallVector<size_t> loads(numPartitions, 0);
+  for (auto i : order) {
+    auto *least = std::min_element(loads.begin(), loads.end());
+    *least += weights[i];
+    auto &file = files.begin()[i];
+    if (unsigned(least - loads.begin()) == index) {
+      ownFiles.insert(file.first);
+      continue;
+    }
+    otherFiles.insert(file.first);
+    for (auto mod : file.second)
+      if (!boundModules.count(mod))
+        stubOutModule(mod, file.first);
   }
 }
 
+LogicalResult DesignPartition::exportSplitVerilog(ModuleOp module,
+                                                  StringRef directory) {
+  SmallString<128> staging;
+  llvm::sys::fs::createUniquePath(Twine(directory) + "/.partition-%%%%%%%%",
+                                  staging, /*MakeAbsolute=*/false);
+  if (auto error = llvm::sys::fs::create_directory(staging)) {
+    llvm::errs() << "cannot create directory '" << staging
+                 << "': " << error.message() << "\n";
+    return failure();
+  }
+
+  auto result = circt::exportSplitVerilog(module, staging);
+  if (succeeded(result))
+    result = copyOutputDirectory(staging, directory, [&](StringRef path) {
+      if (ownFiles.count(path))
+        return true;
+      return !otherFiles.count(path) && index == 0;
+    });
+  (void)llvm::sys::fs::remove_directories(staging);
+  return result;
+}
+
 /// This implements the top-level logic for the firtool command, invoked once
 /// command line options are parsed and LLVM/MLIR are all set up and ready to
 /// go.
@@ -410,12 +1249,31 @@ static LogicalResult executeFirtool(MLIRContext &context) {
       inputFormat = InputFIRFile;
     else if (StringRef(inputFilename).endswith(".mlir"))
       inputFormat = InputMLIRFile;
+    else if (StringRef(inputFilename).endswith(".firsnap"))
+      inputFormat = InputFIRSnapshot;
     else {
-      llvm::errs() << "unknown input format: "
-                      "specify with -format=fir or -format=mlir\n";
+      llvm::errs() << "unknown input format: specify with -format=fir, "
+                      "-format=mlir or -format=firsnap\n";
+      return failure();
+    }
+  }
+
+  // Compile one partition of the design if asked.
+  Optional<DesignPartition> partition;
+  if (numPartitions > 1 || partitionIndex.getNumOccurrences()) {
+    if (outputFormat != OutputSplitVerilog || !cacheDir.empty()) {
+      llvm::errs() << "-partitions requires -split-verilog, without "
+                      "-cache-dir\n";
       return failure();
     }
+    if (partitionIndex >= numPartitions) {
+      llvm::errs() << "-partition must be less than -partitions\n";
+      return failure();
+    }
+    partition.emplace(partitionIndex, numPartitions);
   }
+  DesignPartition *partitionPtr =
+      partition.hasValue() ? partition.getPointer() : nullptr;
 
   // Set up the input file.
   std::string errorMessage;
@@ -427,6 +1285,18 @@ static LogicalResult executeFirtool(MLIRContext &context) {
 
   // Create the output directory or output file depending on our mode.
   Optional<std::unique_ptr<llvm::ToolOutputFile>> outputFile;
+  // The client of a server job may be gone, along with the reading end of its
+  // stdout. Report the failed writes rather than let the stream abort the
+  // server when it is destroyed.
+  auto clearOutputError = llvm::make_scope_exit([&] {
+    if (!servingJobs || !outputFile.hasValue() || !outputFile.getValue())
+      return;
+    auto &os = outputFile.getValue()->os();
+    if (os.has_error()) {
+      llvm::errs() << "cannot write output: " << os.error().message() << "\n";
+      os.clear_error();
+    }
+  });
   if (outputFormat != OutputSplitVerilog) {
     // Create an output file.
     outputFile.emplace(openOutputFile(outputFilename, &errorMessage));
@@ -448,18 +1318,68 @@ static LogicalResult executeFirtool(MLIRContext &context) {
     }
   }
 
+  llvm::ToolOutputFile *singleOutputFile =
+      outputFile.hasValue() ? outputFile.getValue().get() : nullptr;
+
+  // If the user gave a cache directory, reuse the output of an earlier run
+  // with the same input and options, or direct the output of this run to the
+  // cache. The output of a run checking diagnostics, or producing more than
+  // its usual output, is not cached.
+  CachedOutput cache;
+  if (!cacheDir.empty() && !splitInputFile && !verifyDiagnostics &&
+      moduleReportFilename.empty() && pipelineReportFilename.empty() &&
+      storageReportFilename.empty()) {
+    if (auto key = getCacheKey(*input)) {
+      cache.entry = cacheDir;
+      llvm::sys::path::append(cache.entry, *key);
+      if (succeeded(cache.restore(singleOutputFile))) {
+        if (singleOutputFile)
+          singleOutputFile->keep();
+        return success();
+      }
+      cache.startStaging();
+    }
+  }
+
+  raw_ostream &outputStream = !cache.staging.empty() ? cache.os
+                              : singleOutputFile     ? singleOutputFile->os()
+                                                     : llvm::nulls();
+  StringRef outputDirectory = outputFilename;
+  if (!cache.staging.empty())
+    outputDirectory = cache.staging;
+
+  // Reuse the Verilog of the unchanged modules if asked.
+  Optional<ModuleCache> moduleCache;
+  if (incremental) {
+    if (outputFormat != OutputSplitVerilog || cacheDir.empty()) {
+      llvm::errs() << "-incremental requires -split-verilog and -cache-dir\n";
+      return failure();
+    }
+    if (!cache.entry.empty())
+      moduleCache.emplace();
+  }
+  ModuleCache *moduleCachePtr =
+      moduleCache.hasValue() ? moduleCache.getPointer() : nullptr;
+
   // Emit a single file or multiple files depending on the output format.
   auto emitCallback = [&](ModuleOp module) -> LogicalResult {
     switch (outputFormat) {
     case OutputMLIR:
-      module->print(outputFile.getValue()->os());
+      module->print(outputStream);
       return success();
     case OutputDisabled:
       return success();
     case OutputVerilog:
-      return exportVerilog(module, outputFile.getValue()->os());
+      return exportVerilog(module, outputStream);
     case OutputSplitVerilog:
-      return exportSplitVerilog(module, outputFilename);
+      if (partitionPtr)
+        return partitionPtr->exportSplitVerilog(module, outputDirectory);
+      if (failed(exportSplitVerilog(module, outputDirectory)))
+        return failure();
+      return moduleCachePtr ? moduleCachePtr->restoreAndStore(outputDirectory)
+                            : success();
+    case OutputSnapshot:
+      return firrtl::writeFIRSnapshot(module, outputStream);
     }
     return failure();
   };
@@ -469,7 +1389,13 @@ static LogicalResult executeFirtool(MLIRContext &context) {
                       sv::SVDialect>();
 
   // Process the input.
-  if (failed(processInput(context, ts, std::move(input), emitCallback)))
+  if (failed(processInput(context, ts, std::move(input), moduleCachePtr,
+                          partitionPtr, emitCallback))) {
+    if (!cache.staging.empty())
+      cache.discard();
+    return failure();
+  }
+  if (!cache.staging.empty() && failed(cache.finish(singleOutputFile)))
     return failure();
 
   // If the result succeeded and we're emitting a file, close it.
@@ -479,6 +1405,51 @@ static LogicalResult executeFirtool(MLIRContext &context) {
   return success();
 }
 
+/// Run a command line sent to the server, in a fresh MLIRContext.
+static int runServerJob(ArrayRef<std::string> args) {
+  cl::ResetAllOptionOccurrences();
+  std::vector<const char *> argv;
+  for (auto &arg : args)
+    argv.push_back(arg.c_str());
+  if (!cl::ParseCommandLineOptions(argv.size(), argv.data(),
+                                   "MLIR-based FIRRTL compiler\n",
+                                   &llvm::errs()))
+    return 1;
+  if (!serverSocket.empty()) {
+    llvm::errs() << "-server cannot be sent to a server\n";
+    return 1;
+  }
+  commandLine.assign(args.begin(), args.end());
+
+  MLIRContext context;
+  return failed(executeFirtool(context));
+}
+
+/// Run the command lines sent by clients to the socket specified with -server,
+/// one at a time, until the process is killed. The process-wide setup, such as
+/// the registration of the dialects, passes and options, and the threads of
+/// the parallel parts, is shared by the jobs.
+static int runServer() {
+  std::string socketPath = serverSocket;
+  std::string error;
+  int server = firtool::listenForClients(socketPath, error);
+  if (server < 0) {
+    llvm::errs() << error << "\n";
+    return 1;
+  }
+
+  servingJobs = true;
+  while (true) {
+    firtool::ServerJob job;
+    int connection = firtool::receiveJob(server, job, error);
+    if (connection < 0) {
+      llvm::errs() << "firtool server: " << error << "\n";
+      continue;
+    }
+    firtool::finishJob(connection, job, firtool::runJob(job, runServerJob));
+  }
+}
+
 /// Main driver for firtool command.  This sets up LLVM and MLIR, and parses
 /// command line options before passing off to 'executeFirtool'.  This is set up
 /// so we can `exit(0)` at the end of the program to avoid teardown of the
@@ -492,13 +1463,14 @@ int main(int argc, char **argv) {
   registerDefaultTimingManagerCLOptions();
   registerAsmPrinterCLOptions();
   registerLoweringCLOptions();
+  registerThreadingCLOptions();
   // Parse pass names in main to ensure static initialization completed.
   cl::ParseCommandLineOptions(argc, argv, "MLIR-based FIRRTL compiler\n");
+  commandLine.assign(argv, argv + argc);
 
-  // -disable-opt turns off constant propagation (unless it was explicitly
-  // enabled).
-  if (disableOptimization && imconstprop.getNumOccurrences() == 0)
-    imconstprop = false;
+  // Run as a server if asked.
+  if (!serverSocket.empty())
+    exit(runServer());
 
   MLIRContext context;
 
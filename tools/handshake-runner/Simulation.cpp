@@ -11,14 +11,21 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include <list>
+#include <atomic>
+#include <deque>
 
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
 
 #include "circt/Dialect/Handshake/HandshakeOps.h"
 #include "circt/Dialect/Handshake/Simulation.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/Threading.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #define DEBUG_TYPE "runner"
 
@@ -248,6 +255,86 @@ Any readValueWithType(mlir::Type type, std::string in) {
   }
 }
 
+/// Return the number of bytes of an element of the given type in a binary
+/// memref file.
+static unsigned getElementBytes(mlir::Type type) {
+  if (type.isIndex())
+    return INDEX_WIDTH / 8;
+  return llvm::divideCeil(type.getIntOrFloatBitWidth(), 8);
+}
+
+/// Read the contents of a memref from a binary file holding its elements in
+/// order, each in the little-endian representation of its type. Return false
+/// if the file cannot be read or does not have the size of the memref.
+static bool readMemRefFile(StringRef path, mlir::MemRefType type,
+                           std::vector<Any> &buffer) {
+  auto file = MemoryBuffer::getFile(path);
+  if (!file) {
+    errs() << "Could not open memref file '" << path
+           << "': " << file.getError().message() << "\n";
+    return false;
+  }
+  mlir::Type elementType = type.getElementType();
+  unsigned elementBytes = getElementBytes(elementType);
+  StringRef data = (*file)->getBuffer();
+  if (data.size() != buffer.size() * elementBytes) {
+    errs() << "Memref file '" << path << "' has " << data.size()
+           << " bytes, but " << buffer.size() * elementBytes
+           << " bytes were expected.\n";
+    return false;
+  }
+
+  unsigned width = elementType.isIndex() ? INDEX_WIDTH
+                                         : elementType.getIntOrFloatBitWidth();
+  SmallVector<uint64_t, 1> words(llvm::divideCeil(width, 64));
+  for (size_t i = 0, e = buffer.size(); i < e; ++i) {
+    const char *element = data.data() + i * elementBytes;
+    if (elementType.isF32()) {
+      float x;
+      std::memcpy(&x, element, sizeof(x));
+      buffer[i] = APFloat(x);
+    } else if (elementType.isF64()) {
+      double x;
+      std::memcpy(&x, element, sizeof(x));
+      buffer[i] = APFloat(x);
+    } else {
+      std::fill(words.begin(), words.end(), 0);
+      std::memcpy(words.data(), element, elementBytes);
+      buffer[i] = APInt(width, words);
+    }
+  }
+  return true;
+}
+
+/// Write the contents of a memref to a binary file, in the format read by
+/// readMemRefFile. Return false if the file cannot be written.
+static bool writeMemRefFile(StringRef path, mlir::MemRefType type,
+                            std::vector<Any> &buffer) {
+  std::error_code ec;
+  raw_fd_ostream os(path, ec);
+  if (ec) {
+    errs() << "Could not open memref file '" << path << "': " << ec.message()
+           << "\n";
+    return false;
+  }
+  mlir::Type elementType = type.getElementType();
+  unsigned elementBytes = getElementBytes(elementType);
+  for (auto &value : buffer) {
+    if (elementType.isF32()) {
+      float x = any_cast<APFloat>(value).convertToFloat();
+      os.write(reinterpret_cast<const char *>(&x), sizeof(x));
+    } else if (elementType.isF64()) {
+      double x = any_cast<APFloat>(value).convertToDouble();
+      os.write(reinterpret_cast<const char *>(&x), sizeof(x));
+    } else {
+      os.write(reinterpret_cast<const char *>(
+                   any_cast<APInt>(value).getRawData()),
+               elementBytes);
+    }
+  }
+  return true;
+}
+
 std::string printAnyValueWithType(mlir::Type type, Any &value) {
   std::stringstream out;
   if (type.isa<mlir::IntegerType>() || type.isa<mlir::IndexType>()) {
@@ -263,19 +350,43 @@ std::string printAnyValueWithType(mlir::Type type, Any &value) {
   }
 }
 
-void scheduleIfNeeded(std::list<mlir::Operation *> &readyList,
-                      llvm::DenseMap<mlir::Value, Any> &valueMap,
-                      mlir::Operation *op) {
-  if (std::find(readyList.begin(), readyList.end(), op) == readyList.end()) {
-    readyList.push_back(op);
+namespace {
+/// The operations which might be ready to execute, in the order they were
+/// scheduled. An operation is queued at most once, which is checked in
+/// constant time.
+class ReadyQueue {
+public:
+  void push(mlir::Operation *op) {
+    if (queued.insert(op).second)
+      ops.push_back(op);
   }
-}
-void scheduleUses(std::list<mlir::Operation *> &readyList,
-                  llvm::DenseMap<mlir::Value, Any> &valueMap,
-                  mlir::Value value) {
-  for (auto &use : value.getUses()) {
-    scheduleIfNeeded(readyList, valueMap, use.getOwner());
+
+  mlir::Operation *pop() {
+    mlir::Operation *op = ops.front();
+    ops.pop_front();
+    queued.erase(op);
+    return op;
+  }
+
+  size_t size() const { return ops.size(); }
+  std::deque<mlir::Operation *>::const_iterator begin() const {
+    return ops.begin();
+  }
+  std::deque<mlir::Operation *>::const_iterator end() const {
+    return ops.end();
   }
+
+private:
+  std::deque<mlir::Operation *> ops;
+  llvm::DenseSet<mlir::Operation *> queued;
+};
+} // namespace
+
+/// Schedule the operations using the value. The ready queue checks whether they
+/// are queued already in constant time.
+void scheduleUses(ReadyQueue &readyList, mlir::Value value) {
+  for (auto &use : value.getUses())
+    readyList.push(use.getOwner());
 }
 
 bool executeStdOp(mlir::Operation &op, std::vector<Any> &inValues,
@@ -452,7 +563,7 @@ void executeFunction(mlir::FuncOp &toplevel,
     i = 0;
     for (mlir::Value out : op.getResults()) {
       LLVM_DEBUG(debugArg("OUT", out, outValues[i], time));
-      valueMap[out] = outValues[i];
+      valueMap[out] = std::move(outValues[i]);
       timeMap[out] = time + 1;
       i++;
     }
@@ -461,18 +572,74 @@ void executeFunction(mlir::FuncOp &toplevel,
   }
 }
 
+namespace {
+/// The tokens that went through each channel of a handshake function, which
+/// give an estimate of its throughput.
+class ChannelReport {
+public:
+  void recordToken(mlir::Value channel, double time) {
+    auto &info = channels[channel];
+    if (info.tokens++ == 0)
+      info.firstTime = time;
+    info.lastTime = time;
+  }
+
+  /// Write the channels to `os`, from the one with the longest interval
+  /// between tokens, which limits the throughput the most.
+  void write(raw_ostream &os, handshake::FuncOp func, double time);
+
+private:
+  struct Channel {
+    unsigned tokens = 0;
+    double firstTime = 0.0;
+    double lastTime = 0.0;
+
+    double getInterval() const {
+      return tokens > 1 ? (lastTime - firstTime) / (tokens - 1) : 0.0;
+    }
+  };
+  llvm::MapVector<mlir::Value, Channel> channels;
+};
+} // namespace
+
+void ChannelReport::write(raw_ostream &os, handshake::FuncOp func,
+                          double time) {
+  std::vector<std::pair<mlir::Value, Channel>> sorted(channels.begin(),
+                                                      channels.end());
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const auto &lhs, const auto &rhs) {
+                     return lhs.second.getInterval() >
+                            rhs.second.getInterval();
+                   });
+
+  mlir::AsmState asmState(func);
+  os << "time " << time << "\n";
+  for (auto &entry : sorted) {
+    mlir::Value channel = entry.first;
+    auto &info = entry.second;
+    os << "channel ";
+    channel.printAsOperand(os, asmState);
+    if (auto *op = channel.getDefiningOp())
+      os << " (" << op->getName() << ")";
+    os << ": " << info.tokens << " tokens, first at " << info.firstTime
+       << ", last at " << info.lastTime << ", interval "
+       << info.getInterval() << "\n";
+  }
+}
+
 void executeHandshakeFunction(handshake::FuncOp &toplevel,
                               llvm::DenseMap<mlir::Value, Any> &valueMap,
                               llvm::DenseMap<mlir::Value, double> &timeMap,
                               std::vector<Any> &results,
                               std::vector<double> &resultTimes,
                               std::vector<std::vector<Any>> &store,
-                              std::vector<double> &storeTimes) {
+                              std::vector<double> &storeTimes,
+                              ChannelReport *report) {
   mlir::Block &entryBlock = toplevel.getBody().front();
   // The arguments of the entry block.
   mlir::Block::BlockArgListType blockArgs = entryBlock.getArguments();
-  // A list of operations which might be ready to execute.
-  std::list<mlir::Operation *> readyList;
+  // A queue of operations which might be ready to execute.
+  ReadyQueue readyList;
   // A map of memory ops
   llvm::DenseMap<unsigned, unsigned> memoryMap;
 
@@ -484,7 +651,7 @@ void executeHandshakeFunction(handshake::FuncOp &toplevel,
   });
 
   for (unsigned i = 0; i < blockArgs.size(); i++)
-    scheduleUses(readyList, valueMap, blockArgs[i]);
+    scheduleUses(readyList, blockArgs[i]);
 
 #define EXTRA_DEBUG
   while (true) {
@@ -501,8 +668,7 @@ void executeHandshakeFunction(handshake::FuncOp &toplevel,
         });
 #endif
     assert(readyList.size() > 0);
-    mlir::Operation &op = *readyList.front();
-    readyList.pop_front();
+    mlir::Operation &op = *readyList.pop();
 
     /*    for(mlir::Value out : op.getResults()) {
       if(valueMap.count(out) != 0) {
@@ -519,9 +685,12 @@ void executeHandshakeFunction(handshake::FuncOp &toplevel,
       std::vector<mlir::Value> scheduleList;
       if (!handshakeOp.tryExecute(valueMap, memoryMap, timeMap, store,
                                   scheduleList))
-        readyList.push_back(&op);
-      for (mlir::Value out : scheduleList)
-        scheduleUses(readyList, valueMap, out);
+        readyList.push(&op);
+      for (mlir::Value out : scheduleList) {
+        if (report)
+          report->recordToken(out, timeMap[out]);
+        scheduleUses(readyList, out);
+      }
       continue;
     }
 
@@ -531,25 +700,33 @@ void executeHandshakeFunction(handshake::FuncOp &toplevel,
     bool reschedule = false;
     LLVM_DEBUG(dbgs() << "OP: (" << op.getNumOperands() << "->"
                       << op.getNumResults() << ")" << op << "\n");
-    double time;
+    double time = 0.0;
     for (mlir::Value in : op.getOperands()) {
       if (valueMap.count(in) == 0) {
         reschedule = true;
-        continue;
+        break;
       }
-      inValues[i] = valueMap[in];
-      time = std::max(time, timeMap[in]);
-      LLVM_DEBUG(debugArg("IN", in, inValues[i], timeMap[in]));
-      i++;
     }
     if (reschedule) {
       LLVM_DEBUG(dbgs() << "Rescheduling data...\n");
-      readyList.push_back(&op);
+      readyList.push(&op);
       continue;
     }
-    // Consume the inputs.
+    // Consume the inputs. They are moved out of the map rather than copied,
+    // which would copy the boxed values.
     for (mlir::Value in : op.getOperands()) {
-      valueMap.erase(in);
+      auto it = valueMap.find(in);
+      if (it != valueMap.end()) {
+        inValues[i] = std::move(it->second);
+        valueMap.erase(it);
+      } else {
+        // The value was already consumed by an earlier operand.
+        auto operands = op.getOperands();
+        inValues[i] = inValues[llvm::find(operands, in) - operands.begin()];
+      }
+      time = std::max(time, timeMap[in]);
+      LLVM_DEBUG(debugArg("IN", in, inValues[i], timeMap[in]));
+      i++;
     }
     if (executeStdOp(op, inValues, outValues)) {
     } else if (auto returnOp = dyn_cast<handshake::ReturnOp>(op)) {
@@ -567,9 +744,11 @@ void executeHandshakeFunction(handshake::FuncOp &toplevel,
     for (mlir::Value out : op.getResults()) {
       LLVM_DEBUG(debugArg("OUT", out, outValues[i], time));
       assert(outValues[i].hasValue());
-      valueMap[out] = outValues[i];
+      valueMap[out] = std::move(outValues[i]);
       timeMap[out] = time + 1;
-      scheduleUses(readyList, valueMap, out);
+      if (report)
+        report->recordToken(out, time + 1);
+      scheduleUses(readyList, out);
 
       i++;
     }
@@ -577,8 +756,11 @@ void executeHandshakeFunction(handshake::FuncOp &toplevel,
   }
 }
 
-bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
-              mlir::OwningModuleRef &module, mlir::MLIRContext &context) {
+/// Execute the toplevel function, a FuncOp or a handshake::FuncOp, once and
+/// print its results to `out`.
+static bool simulateRun(StringRef toplevelFunction, mlir::Operation *toplevelOp,
+                        ArrayRef<std::string> inputArgs, StringRef reportFile,
+                        raw_ostream &out) {
   // The store associates each allocation in the program
   // (represented by a int) with a vector of values which can be
   // accessed by it.  Currently values are assumed to be an integer.
@@ -608,8 +790,7 @@ bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
   unsigned realInputs;
   unsigned realOutputs;
 
-  if (mlir::FuncOp toplevel =
-          module->lookupSymbol<mlir::FuncOp>(toplevelFunction)) {
+  if (auto toplevel = dyn_cast<mlir::FuncOp>(toplevelOp)) {
     ftype = toplevel.getType();
     mlir::Block &entryBlock = toplevel.getBody().front();
     blockArgs = entryBlock.getArguments();
@@ -619,8 +800,7 @@ bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
     realInputs = inputs;
     outputs = ftype.getNumResults();
     realOutputs = outputs;
-  } else if (handshake::FuncOp toplevel =
-                 module->lookupSymbol<handshake::FuncOp>(toplevelFunction)) {
+  } else if (auto toplevel = dyn_cast<handshake::FuncOp>(toplevelOp)) {
     ftype = toplevel.getType();
     mlir::Block &entryBlock = toplevel.getBody().front();
     blockArgs = entryBlock.getArguments();
@@ -664,11 +844,17 @@ bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
       unsigned buffer = allocateMemRef(memreftype, nothing, store, storeTimes);
       valueMap[blockArgs[i]] = buffer;
       timeMap[blockArgs[i]] = 0.0;
-      int64_t i = 0;
+      StringRef inputArg = inputArgs[i];
+      if (inputArg.startswith("@")) {
+        if (!readMemRefFile(inputArg.drop_front(), memreftype, store[buffer]))
+          return 1;
+        continue;
+      }
+      int64_t j = 0;
       std::stringstream arg(inputArgs[i]);
       while (!arg.eof()) {
         getline(arg, x, ',');
-        store[buffer][i++] = readValueWithType(memreftype.getElementType(), x);
+        store[buffer][j++] = readValueWithType(memreftype.getElementType(), x);
       }
     } else {
       Any value = readValueWithType(type, inputArgs[i]);
@@ -679,19 +865,32 @@ bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
 
   std::vector<Any> results(realOutputs);
   std::vector<double> resultTimes(realOutputs);
-  if (mlir::FuncOp toplevel =
-          module->lookupSymbol<mlir::FuncOp>(toplevelFunction)) {
+  if (auto toplevel = dyn_cast<mlir::FuncOp>(toplevelOp)) {
     executeFunction(toplevel, valueMap, timeMap, results, resultTimes, store,
                     storeTimes);
-  } else if (handshake::FuncOp toplevel =
-                 module->lookupSymbol<handshake::FuncOp>(toplevelFunction)) {
+  } else if (auto toplevel = dyn_cast<handshake::FuncOp>(toplevelOp)) {
+    ChannelReport report;
     executeHandshakeFunction(toplevel, valueMap, timeMap, results, resultTimes,
-                             store, storeTimes);
+                             store, storeTimes,
+                             reportFile.empty() ? nullptr : &report);
+    if (!reportFile.empty()) {
+      double time = 0.0;
+      for (double resultTime : resultTimes)
+        time = std::max(time, resultTime);
+      std::error_code ec;
+      raw_fd_ostream os(reportFile, ec);
+      if (ec) {
+        errs() << "Could not open report file '" << reportFile
+               << "': " << ec.message() << "\n";
+        return 1;
+      }
+      report.write(os, toplevel, time);
+    }
   }
   double time = 0.0;
   for (unsigned i = 0; i < results.size(); i++) {
     mlir::Type t = ftype.getResult(i);
-    outs() << printAnyValueWithType(t, results[i]) << " ";
+    out << printAnyValueWithType(t, results[i]) << " ";
     time = std::max(resultTimes[i], time);
   }
   // Go back through the arguments and output any memrefs.
@@ -702,17 +901,82 @@ bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
       auto memreftype = type.dyn_cast<mlir::MemRefType>();
       unsigned buffer = any_cast<unsigned>(valueMap[blockArgs[i]]);
       auto elementType = memreftype.getElementType();
+      // The contents of memrefs read from a binary file are written to a
+      // binary file as well.
+      StringRef inputArg = inputArgs[i];
+      if (inputArg.startswith("@")) {
+        std::string outputPath = (inputArg.drop_front() + ".out").str();
+        if (!writeMemRefFile(outputPath, memreftype, store[buffer]))
+          return 1;
+        out << "@" << outputPath << " ";
+        continue;
+      }
       for (int j = 0; j < memreftype.getNumElements(); j++) {
         if (j != 0)
-          outs() << ",";
-        outs() << printAnyValueWithType(elementType, store[buffer][j]);
+          out << ",";
+        out << printAnyValueWithType(elementType, store[buffer][j]);
       }
-      outs() << " ";
+      out << " ";
     }
   }
-  outs() << "\n";
+  out << "\n";
 
   simulatedTime += (int)time;
 
   return 0;
 }
+
+bool simulate(StringRef toplevelFunction, ArrayRef<std::string> inputArgs,
+              mlir::OwningModuleRef &module, mlir::MLIRContext &context,
+              StringRef reportFile) {
+  return simulateRun(toplevelFunction, module->lookupSymbol(toplevelFunction),
+                     inputArgs, reportFile, outs());
+}
+
+bool simulateBatch(StringRef toplevelFunction, StringRef batchFile,
+                   mlir::OwningModuleRef &module, mlir::MLIRContext &context) {
+  auto fileOrErr = MemoryBuffer::getFile(batchFile);
+  if (std::error_code error = fileOrErr.getError()) {
+    errs() << "Could not open batch file '" << batchFile
+           << "': " << error.message() << "\n";
+    return 1;
+  }
+
+  // Split the lines into the arguments of each run.  Empty lines and the ones
+  // starting with '#' are skipped.
+  std::vector<std::vector<std::string>> runArgs;
+  std::vector<unsigned> runLines;
+  SmallVector<StringRef> lines, fields;
+  (*fileOrErr)->getBuffer().split(lines, '\n');
+  for (auto line : llvm::enumerate(lines)) {
+    auto text = line.value().trim();
+    if (text.empty() || text.startswith("#"))
+      continue;
+    fields.clear();
+    SplitString(text, fields);
+    runArgs.emplace_back();
+    for (auto field : fields)
+      runArgs.back().push_back(field.str());
+    runLines.push_back(line.index() + 1);
+  }
+
+  // The toplevel function is only looked up once.  The runs only read the IR,
+  // and each of them has its own values and store, so they run in parallel.
+  mlir::Operation *toplevelOp = module->lookupSymbol(toplevelFunction);
+  std::vector<std::string> runOutputs(runArgs.size());
+  std::atomic<bool> failed(false);
+  mlir::parallelForEachN(&context, 0, runArgs.size(), [&](size_t i) {
+    raw_string_ostream os(runOutputs[i]);
+    if (simulateRun(toplevelFunction, toplevelOp, runArgs[i], {}, os)) {
+      errs() << batchFile << ":" << runLines[i] << ": simulation failed\n";
+      failed = true;
+    }
+  });
+  if (failed)
+    return 1;
+
+  // Write the results of all the runs at once, in the order of the batch.
+  for (auto &output : runOutputs)
+    outs() << output;
+  return 0;
+}
@@ -41,6 +41,19 @@ static cl::opt<std::string>
                      cl::desc("The toplevel function to execute"),
                      cl::init("main"), cl::cat(mainCategory));
 
+static cl::opt<std::string>
+    reportFile("report", cl::Optional,
+               cl::desc("Write the number of tokens and the interval between "
+                        "them of each channel of a handshake function to a "
+                        "file"),
+               cl::value_desc("filename"), cl::cat(mainCategory));
+
+static cl::opt<std::string> batchFile(
+    "batch", cl::Optional,
+    cl::desc("Run the function once for each line of a file, which holds the "
+             "arguments of the run, in parallel"),
+    cl::value_desc("filename"), cl::cat(mainCategory));
+
 // static opt<bool> runStats("runStats", cl::Optional,
 //                           cl::desc("Print Execution Statistics"),
 //                           cl::init(false), cl::cat(mainCategory));
@@ -53,7 +66,11 @@ int main(int argc, char **argv) {
       "This application executes a function in the given MLIR module\n"
       "Arguments to the function are passed on the command line and\n"
       "results are returned on stdout.\n"
-      "Memref types are specified as a comma-separated list of values.\n");
+      "Memref types are specified as a comma-separated list of values,\n"
+      "or as @file to read the values from a binary file. The values of\n"
+      "such memrefs are written to file.out when the function returns.\n"
+      "With -batch, each line of the batch file holds the arguments of one\n"
+      "run, and the results of each run are printed on one line.\n");
 
   auto file_or_err = MemoryBuffer::getFileOrSTDIN(inputFileName.c_str());
   if (std::error_code error = file_or_err.getError()) {
@@ -80,5 +97,14 @@ int main(int argc, char **argv) {
     return 1;
   }
 
-  return simulate(toplevelFunction, inputArgs, module, context);
+  if (!batchFile.empty()) {
+    if (!inputArgs.empty() || !reportFile.empty()) {
+      errs() << "-batch takes the arguments from the batch file, and cannot "
+                "be used with -report.\n";
+      return 1;
+    }
+    return simulateBatch(toplevelFunction, batchFile, module, context);
+  }
+
+  return simulate(toplevelFunction, inputArgs, module, context, reportFile);
 }
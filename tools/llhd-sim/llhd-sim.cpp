@@ -13,6 +13,7 @@
 #include "circt/Conversion/LLHDToLLVM/LLHDToLLVM.h"
 #include "circt/Dialect/LLHD/IR/LLHDDialect.h"
 #include "circt/Dialect/LLHD/Simulator/Engine.h"
+#include "circt/Dialect/LLHD/Transforms/Passes.h"
 
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 #include "mlir/Dialect/StandardOps/IR/Ops.h"
@@ -83,6 +84,7 @@ enum TraceFormat {
   merged,
   mergedReduce,
   namedOnly,
+  vcd,
   noTrace = -1
 };
 
@@ -102,8 +104,92 @@ static cl::opt<TraceFormat> traceMode(
             namedOnly, "named-only",
             "Only dump changes for real-time steps, only for top-level "
             "instance and signals not having the default name '(sig)?[0-9]*'"),
+        clEnumVal(vcd, "Dump the values of all signals at the end of every "
+                       "real-time step in the Value Change Dump format"),
         clEnumValN(noTrace, "no-trace", "Don't dump a signal trace")));
 
+static cl::list<std::string> traceFilters(
+    "trace-filter",
+    cl::desc("Only trace the signals whose hierarchical name matches one of "
+             "these glob patterns, such as root/core0/*"),
+    cl::ZeroOrMore, cl::MiscFlags::CommaSeparated);
+
+static cl::opt<uint64_t>
+    traceStart("trace-start",
+               cl::desc("Only trace the changes from this time on, in ps"),
+               cl::init(0));
+
+static cl::opt<uint64_t> traceStop(
+    "trace-stop", cl::desc("Only trace the changes up to this time, in ps"),
+    cl::init(std::numeric_limits<uint64_t>::max()));
+
+static cl::opt<std::string> traceTrigger(
+    "trace-trigger",
+    cl::desc("Only trace the steps around the first change of the signal with "
+             "this hierarchical name"),
+    cl::value_desc("signal"));
+
+static cl::opt<unsigned> traceCaptureSteps(
+    "trace-capture-steps",
+    cl::desc("The number of trace steps written before and after the trigger "
+             "of -trace-trigger"),
+    cl::init(16));
+
+static cl::opt<bool> timingWheel(
+    "timing-wheel",
+    cl::desc("Use a hierarchical timing wheel as the event queue, which scales "
+             "better with many pending events"));
+
+static cl::opt<bool> parallel(
+    "parallel",
+    cl::desc("Run the instances woken up in the same cycle in parallel"));
+
+static cl::opt<bool> levelize(
+    "levelize",
+    cl::desc("Evaluate the combinational entities in topological order "
+             "instead of through the event queue, skipping their delta "
+             "delays"));
+
+static cl::opt<bool> optimizeMLIR(
+    "mlir-optimize",
+    cl::desc("Inline the functions, promote the variables of the processes to "
+             "values and lower the processes that behave like entities to "
+             "entities before compiling the design"));
+
+static cl::opt<std::string>
+    checkpoint("checkpoint",
+               cl::desc("Save the state the simulation stops in to a file"),
+               cl::value_desc("filename"));
+
+static cl::opt<std::string>
+    restore("restore",
+            cl::desc("Start the simulation from a checkpoint of the design"),
+            cl::value_desc("filename"));
+
+static cl::opt<unsigned>
+    runs("runs",
+         cl::desc("Run this many independent simulations of the design "
+                  "concurrently, and write their traces one after the other"),
+         cl::init(1));
+
+static cl::opt<std::string> stats(
+    "stats",
+    cl::desc("Write counters of the work done by the simulation to a file, as "
+             "JSON"),
+    cl::value_desc("filename"));
+
+static cl::opt<std::string> emitObject(
+    "emit-object",
+    cl::desc("Write the compiled design to an object file instead of "
+             "simulating it"),
+    cl::value_desc("filename"));
+
+static cl::opt<std::string> loadDesign(
+    "load-design",
+    cl::desc("Load the units of the design from a shared library built from "
+             "the object written by -emit-object, instead of compiling them"),
+    cl::value_desc("filename"));
+
 static cl::list<std::string>
     sharedLibs("shared-libs",
                cl::desc("Libraries to link dynamically. Specify absolute path "
@@ -138,6 +224,33 @@ static int dumpLLVM(ModuleOp module, MLIRContext &context) {
   return 0;
 }
 
+/// Simplify the units of the design before they are compiled. This runs before
+/// the layout of the design is built, as it changes the kind of units.
+static LogicalResult optimizeDesign(ModuleOp module) {
+  PassManager pm(module.getContext());
+  pm.addPass(createInlinerPass());
+  pm.addNestedPass<llhd::ProcOp>(llhd::createMemoryToBlockArgumentPass());
+  pm.addNestedPass<llhd::ProcOp>(llhd::createEarlyCodeMotionPass());
+  pm.addPass(createCanonicalizerPass());
+  pm.addPass(llhd::createProcessLoweringPass(/*skipUnsupported=*/true));
+  pm.addPass(createCSEPass());
+  if (failed(pm.run(module)))
+    return failure();
+
+  // The functions are no longer needed once all the calls in the units are
+  // inlined. Recursive functions cannot be, they are kept in that case.
+  bool hasUnitCalls = false;
+  module.walk([&](CallOp op) {
+    if (isa<llhd::EntityOp, llhd::ProcOp>(op->getParentOp()))
+      hasUnitCalls = true;
+  });
+  if (hasUnitCalls)
+    return success();
+  PassManager cleanup(module.getContext());
+  cleanup.addPass(llhd::createFunctionEliminationPass());
+  return cleanup.run(module);
+}
+
 static LogicalResult applyMLIRPasses(ModuleOp module) {
   PassManager pm(module.getContext());
 
@@ -183,25 +296,70 @@ int main(int argc, char **argv) {
     return 0;
   }
 
+  if (optimizeMLIR && failed(optimizeDesign(*module))) {
+    llvm::errs() << "failed to optimize the design\n";
+    return 1;
+  }
+
   SmallVector<StringRef, 1> sharedLibPaths(sharedLibs.begin(),
                                            sharedLibs.end());
 
   llhd::sim::Engine engine(
       output->os(), *module, &applyMLIRPasses,
       makeOptimizingTransformer(optimizationLevel, 0, nullptr), root, traceMode,
-      sharedLibPaths);
+      sharedLibPaths, timingWheel, loadDesign, levelize);
+
+  if (!traceTrigger.empty() && traceMode == vcd) {
+    llvm::errs() << "-trace-trigger is not supported with the vcd format\n";
+    return 1;
+  }
+  llhd::sim::TraceFilter traceFilter;
+  traceFilter.patterns.assign(traceFilters.begin(), traceFilters.end());
+  traceFilter.startTime = traceStart;
+  traceFilter.stopTime = traceStop;
+  traceFilter.trigger = traceTrigger;
+  traceFilter.captureSteps = traceCaptureSteps;
+  engine.setTraceFilter(std::move(traceFilter));
 
   if (dumpLLVMDialect || dumpLLVMIR) {
     return dumpLLVM(engine.getModule(), context);
   }
 
+  if (!emitObject.empty())
+    return engine.dumpToObjectFile(emitObject) ? 0 : 1;
+
   if (dumpLayout) {
     engine.dumpStateLayout();
     engine.dumpStateSignalTriggers();
     return 0;
   }
 
-  engine.simulate(nSteps, maxTime);
+  // The design is only compiled once for all the runs, each of them has its own
+  // state.
+  if (runs > 1) {
+    if (!checkpoint.empty() || !stats.empty()) {
+      llvm::errs() << "-checkpoint and -stats cannot be used with -runs\n";
+      return 1;
+    }
+    std::vector<std::string> traces(runs);
+    std::vector<std::unique_ptr<llvm::raw_string_ostream>> streams;
+    for (auto &trace : traces)
+      streams.push_back(std::make_unique<llvm::raw_string_ostream>(trace));
+    auto getOutput = [&](unsigned i) -> llvm::raw_ostream & {
+      return *streams[i];
+    };
+    if (engine.simulateConcurrently(runs, getOutput, nSteps, maxTime, parallel,
+                                    restore) < 0)
+      return 1;
+    for (auto &os : streams)
+      output->os() << os->str();
+    output->keep();
+    return 0;
+  }
+
+  if (engine.simulate(nSteps, maxTime, parallel, restore, checkpoint,
+                      stats) < 0)
+    return 1;
 
   output->keep();
   return 0;
@@ -0,0 +1,290 @@
+//===- ShmChannelTest.cpp - Cosim shared-memory transport tests -----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The simulation side of the transport is the ShmChannel under test. The
+// client side is implemented here from the memory layout of ShmChannel.h, as a
+// client in another process would.
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/ESI/cosim/ShmChannel.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace circt::esi::cosim;
+
+namespace {
+/// The client side of a channel, which maps the shared memory on its own.
+class Client {
+public:
+  explicit Client(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    EXPECT_GE(fd, 0);
+    struct stat st;
+    EXPECT_EQ(fstat(fd, &st), 0);
+    size = st.st_size;
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    EXPECT_NE(memory, MAP_FAILED);
+    auto *header = static_cast<ShmHeader *>(memory);
+    EXPECT_EQ(header->magic, ShmHeader::magicValue);
+    EXPECT_EQ(header->version, ShmHeader::versionValue);
+    auto *bytes = static_cast<uint8_t *>(memory);
+    toSim = reinterpret_cast<ShmRing *>(bytes + header->toSimOffset);
+    toClient = reinterpret_cast<ShmRing *>(bytes + header->toClientOffset);
+  }
+  ~Client() { munmap(memory, size); }
+
+  /// Send a message to the simulation. Return false if the ring is full.
+  bool send(const std::vector<uint8_t> &msg) {
+    uint32_t t = toSim->tail.load(std::memory_order_relaxed);
+    if (t - toSim->head.load(std::memory_order_acquire) == toSim->capacity)
+      return false;
+    uint8_t *slot = getSlot(toSim, t);
+    uint32_t msgSize = msg.size();
+    memcpy(slot, &msgSize, sizeof(msgSize));
+    memcpy(slot + sizeof(msgSize), msg.data(), msg.size());
+    toSim->tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Receive a message from the simulation. Return false if there is none.
+  bool receive(std::vector<uint8_t> &msg) {
+    uint32_t h = toClient->head.load(std::memory_order_relaxed);
+    if (h == toClient->tail.load(std::memory_order_acquire))
+      return false;
+    uint8_t *slot = getSlot(toClient, h);
+    uint32_t msgSize;
+    memcpy(&msgSize, slot, sizeof(msgSize));
+    msg.assign(slot + sizeof(msgSize), slot + sizeof(msgSize) + msgSize);
+    toClient->head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Move the counters of both rings, which must be empty, to `value`.
+  void setCounters(uint32_t value) {
+    for (auto *ring : {toSim, toClient}) {
+      ring->head.store(value);
+      ring->tail.store(value);
+    }
+  }
+
+private:
+  static uint8_t *getSlot(ShmRing *ring, uint32_t index) {
+    return reinterpret_cast<uint8_t *>(ring) + ring->slotsOffset +
+           (size_t)(index % ring->capacity) * ring->slotStride;
+  }
+
+  void *memory;
+  size_t size;
+  ShmRing *toSim;
+  ShmRing *toClient;
+};
+
+/// Create a channel with a name unique to this process.
+std::unique_ptr<ShmChannel> createChannel(uint32_t capacity,
+                                          uint32_t slotSize) {
+  std::string error;
+  auto channel = ShmChannel::create(
+      "/circt-shm-test-" + std::to_string(getpid()), capacity, slotSize,
+      slotSize, error);
+  EXPECT_TRUE(channel) << error;
+  return channel;
+}
+
+/// The message number `i`, whose size varies with `i`.
+std::vector<uint8_t> makeMessage(unsigned i, uint32_t slotSize) {
+  std::vector<uint8_t> msg(1 + i % slotSize);
+  for (size_t j = 0; j < msg.size(); ++j)
+    msg[j] = i + j;
+  return msg;
+}
+
+/// Send a message to the client. Return false if the ring is full.
+bool sendToClient(ShmChannel &channel, const std::vector<uint8_t> &msg) {
+  uint8_t *slot = channel.getMessageToClientSlot(msg.size());
+  if (!slot)
+    return false;
+  memcpy(slot, msg.data(), msg.size());
+  channel.publishMessageToClient(msg.size());
+  return true;
+}
+
+/// Receive a message from the client. Return false if there is none.
+bool receiveFromClient(ShmChannel &channel, std::vector<uint8_t> &msg) {
+  const uint8_t *data;
+  size_t size;
+  if (!channel.peekMessageToSim(data, size))
+    return false;
+  msg.assign(data, data + size);
+  channel.popMessageToSim();
+  return true;
+}
+} // namespace
+
+TEST(ShmChannelTest, RejectsCapacityNotPowerOfTwo) {
+  std::string error;
+  EXPECT_FALSE(ShmChannel::create("/circt-shm-test-capacity", 3, 8, 8, error));
+  EXPECT_FALSE(error.empty());
+}
+
+TEST(ShmChannelTest, ToClientFullQueue) {
+  auto channel = createChannel(4, 16);
+  Client client(channel->getName());
+
+  // The ring holds `capacity` messages, then the producer has to wait.
+  for (unsigned i = 0; i < 4; ++i)
+    EXPECT_TRUE(sendToClient(*channel, makeMessage(i, 16)));
+  EXPECT_FALSE(sendToClient(*channel, makeMessage(4, 16)));
+
+  // Consuming one message frees exactly one slot.
+  std::vector<uint8_t> msg;
+  ASSERT_TRUE(client.receive(msg));
+  EXPECT_EQ(msg, makeMessage(0, 16));
+  EXPECT_TRUE(sendToClient(*channel, makeMessage(4, 16)));
+  EXPECT_FALSE(sendToClient(*channel, makeMessage(5, 16)));
+
+  for (unsigned i = 1; i < 5; ++i) {
+    ASSERT_TRUE(client.receive(msg));
+    EXPECT_EQ(msg, makeMessage(i, 16));
+  }
+  EXPECT_FALSE(client.receive(msg));
+}
+
+TEST(ShmChannelTest, ToSimFullQueue) {
+  auto channel = createChannel(4, 16);
+  Client client(channel->getName());
+
+  for (unsigned i = 0; i < 4; ++i)
+    EXPECT_TRUE(client.send(makeMessage(i, 16)));
+  EXPECT_FALSE(client.send(makeMessage(4, 16)));
+
+  // Peeking does not consume the message.
+  const uint8_t *data;
+  size_t size;
+  ASSERT_TRUE(channel->peekMessageToSim(data, size));
+  ASSERT_TRUE(channel->peekMessageToSim(data, size));
+  EXPECT_EQ(std::vector<uint8_t>(data, data + size), makeMessage(0, 16));
+  EXPECT_FALSE(client.send(makeMessage(4, 16)));
+  channel->popMessageToSim();
+  EXPECT_TRUE(client.send(makeMessage(4, 16)));
+
+  std::vector<uint8_t> msg;
+  for (unsigned i = 1; i < 5; ++i) {
+    ASSERT_TRUE(receiveFromClient(*channel, msg));
+    EXPECT_EQ(msg, makeMessage(i, 16));
+  }
+  EXPECT_FALSE(receiveFromClient(*channel, msg));
+}
+
+TEST(ShmChannelTest, SlotWraparound) {
+  auto channel = createChannel(4, 16);
+  Client client(channel->getName());
+
+  // Keep the rings partially filled while the messages go around the slots
+  // several times, in both directions.
+  std::vector<uint8_t> msg;
+  unsigned sent = 0, received = 0;
+  while (received < 40) {
+    for (unsigned i = 0; i < 3; ++i, ++sent) {
+      ASSERT_TRUE(sendToClient(*channel, makeMessage(sent, 16)));
+      ASSERT_TRUE(client.send(makeMessage(sent, 16)));
+    }
+    for (unsigned i = 0; i < 3; ++i, ++received) {
+      ASSERT_TRUE(client.receive(msg));
+      EXPECT_EQ(msg, makeMessage(received, 16));
+      ASSERT_TRUE(receiveFromClient(*channel, msg));
+      EXPECT_EQ(msg, makeMessage(received, 16));
+    }
+  }
+}
+
+TEST(ShmChannelTest, CounterWraparound) {
+  auto channel = createChannel(4, 16);
+  Client client(channel->getName());
+
+  // The counters are free-running and wrap around 2^32.
+  client.setCounters(UINT32_MAX - 2);
+  std::vector<uint8_t> msg;
+  for (unsigned i = 0; i < 4; ++i) {
+    EXPECT_TRUE(sendToClient(*channel, makeMessage(i, 16)));
+    EXPECT_TRUE(client.send(makeMessage(i, 16)));
+  }
+  EXPECT_FALSE(sendToClient(*channel, makeMessage(4, 16)));
+  EXPECT_FALSE(client.send(makeMessage(4, 16)));
+  for (unsigned i = 0; i < 4; ++i) {
+    ASSERT_TRUE(client.receive(msg));
+    EXPECT_EQ(msg, makeMessage(i, 16));
+    ASSERT_TRUE(receiveFromClient(*channel, msg));
+    EXPECT_EQ(msg, makeMessage(i, 16));
+  }
+  EXPECT_FALSE(client.receive(msg));
+  EXPECT_FALSE(receiveFromClient(*channel, msg));
+}
+
+TEST(ShmChannelTest, OversizedMessages) {
+  auto channel = createChannel(4, 16);
+  Client client(channel->getName());
+
+  EXPECT_EQ(channel->getMessageToClientSlot(17), nullptr);
+
+  // A client claiming a larger message than its slot is cut to the slot.
+  std::vector<uint8_t> msg(16, 7);
+  ASSERT_TRUE(client.send(msg));
+  uint32_t lie = 1000;
+  const uint8_t *data;
+  size_t size;
+  ASSERT_TRUE(channel->peekMessageToSim(data, size));
+  memcpy(const_cast<uint8_t *>(data) - sizeof(lie), &lie, sizeof(lie));
+  ASSERT_TRUE(channel->peekMessageToSim(data, size));
+  EXPECT_EQ(size, 16u);
+}
+
+TEST(ShmChannelTest, ConcurrentProducerConsumer) {
+  auto channel = createChannel(8, 32);
+  Client client(channel->getName());
+  const unsigned numMessages = 100000;
+
+  // The simulation produces on this thread while the client consumes on
+  // another, each waiting on the other when the ring is full or empty.
+  std::thread consumer([&] {
+    std::vector<uint8_t> msg;
+    for (unsigned i = 0; i < numMessages; ++i) {
+      while (!client.receive(msg))
+        std::this_thread::yield();
+      ASSERT_EQ(msg, makeMessage(i, 32));
+    }
+  });
+  for (unsigned i = 0; i < numMessages; ++i)
+    while (!sendToClient(*channel, makeMessage(i, 32)))
+      std::this_thread::yield();
+  consumer.join();
+
+  std::thread producer([&] {
+    for (unsigned i = 0; i < numMessages; ++i)
+      while (!client.send(makeMessage(i, 32)))
+        std::this_thread::yield();
+  });
+  std::vector<uint8_t> msg;
+  for (unsigned i = 0; i < numMessages; ++i) {
+    while (!receiveFromClient(*channel, msg))
+      std::this_thread::yield();
+    ASSERT_EQ(msg, makeMessage(i, 32));
+  }
+  producer.join();
+}
+#endif
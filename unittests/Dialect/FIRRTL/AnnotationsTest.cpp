@@ -0,0 +1,70 @@
+//===- AnnotationsTest.cpp - FIRRTL annotation unit tests -----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/FIRRTL/FIRRTLAnnotations.h"
+#include "circt/Dialect/FIRRTL/FIRRTLDialect.h"
+#include "mlir/IR/MLIRContext.h"
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace mlir;
+using namespace circt::firrtl;
+
+TEST(AnnotationsTest, ConcurrentClassQueries) {
+  MLIRContext context;
+  context.loadDialect<FIRRTLDialect>();
+
+  // There are more classes than bits in the class summaries, so some queries
+  // fall back to scanning the annotations.
+  const unsigned numClasses = 80, numArrays = 509, numThreads = 8;
+  std::vector<std::string> classes;
+  for (unsigned i = 0; i != numClasses; ++i)
+    classes.push_back("class" + std::to_string(i));
+
+  std::vector<ArrayAttr> arrays;
+  std::vector<std::vector<bool>> expected(numArrays,
+                                          std::vector<bool>(numClasses));
+  auto classID = Identifier::get("class", &context);
+  for (unsigned i = 0; i != numArrays; ++i) {
+    SmallVector<Attribute> annotations;
+    for (unsigned j = 0; j != numClasses; ++j) {
+      if ((i * 7 + j * 13) % 11 >= 2)
+        continue;
+      NamedAttribute classAttr(classID, StringAttr::get(&context, classes[j]));
+      annotations.push_back(DictionaryAttr::get(&context, {classAttr}));
+      expected[i][j] = true;
+    }
+    arrays.push_back(ArrayAttr::get(&context, annotations));
+  }
+
+  // Each thread queries the arrays in a different order, so that the
+  // summaries and the class bits are built concurrently.
+  std::atomic<unsigned> mismatches(0);
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t != numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (unsigned k = 0; k != numArrays; ++k) {
+        unsigned i = (k * (2 * t + 1) + t * 37) % numArrays;
+        AnnotationSet annotations(arrays[i]);
+        for (unsigned j = 0; j != numClasses; ++j) {
+          if (annotations.hasAnnotation(classes[j]) != expected[i][j])
+            ++mismatches;
+          if (bool(annotations.getAnnotation(classes[j])) != expected[i][j])
+            ++mismatches;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(mismatches.load(), 0u);
+}
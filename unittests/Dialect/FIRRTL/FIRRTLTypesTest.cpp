@@ -0,0 +1,110 @@
+//===- FIRRTLTypesTest.cpp - FIRRTL type unit tests -----------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Dialect/FIRRTL/FIRRTLDialect.h"
+#include "circt/Dialect/FIRRTL/FIRRTLTypes.h"
+#include "mlir/IR/MLIRContext.h"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+using namespace mlir;
+using namespace circt::firrtl;
+
+namespace {
+class FIRRTLTypesTest : public ::testing::Test {
+protected:
+  FIRRTLTypesTest() { context.loadDialect<FIRRTLDialect>(); }
+
+  FIRRTLType uint(int32_t width) { return UIntType::get(&context, width); }
+
+  FIRRTLType bundle(ArrayRef<std::pair<StringRef, FIRRTLType>> fields) {
+    SmallVector<BundleType::BundleElement> elements;
+    for (auto &field : fields)
+      elements.push_back(
+          {StringAttr::get(&context, field.first), false, field.second});
+    return BundleType::get(elements, &context);
+  }
+
+  MLIRContext context;
+};
+
+/// Describe the fields nested in `type`, the type of the field `fieldID`, in
+/// the order of their field IDs: each aggregate is numbered before its
+/// elements, which are numbered in order.
+void describeFields(FIRRTLType type, unsigned fieldID,
+                    std::vector<FieldIDInfo> &fields) {
+  auto describeElement = [&](FIRRTLType elementType, unsigned index) {
+    fields.push_back({elementType, fieldID, index});
+    describeFields(elementType, fields.size() - 1, fields);
+  };
+  if (auto bundleType = type.dyn_cast<BundleType>()) {
+    for (unsigned i = 0, e = bundleType.getNumElements(); i != e; ++i)
+      describeElement(bundleType.getElement(i).type, i);
+  } else if (auto vectorType = type.dyn_cast<FVectorType>()) {
+    for (unsigned i = 0, e = vectorType.getNumElements(); i != e; ++i)
+      describeElement(vectorType.getElementType(), i);
+  }
+}
+
+/// Check the description of each field of `type` against describeFields.
+void checkFieldIDInfo(FIRRTLType type) {
+  std::vector<FieldIDInfo> fields = {{type, 0, 0}};
+  describeFields(type, 0, fields);
+  ASSERT_EQ(fields.size(), type.getMaxFieldID() + 1);
+  // Look the fields up twice, before and after the table of a bundle is built.
+  for (unsigned pass = 0; pass != 2; ++pass) {
+    for (unsigned fieldID = 0, e = fields.size(); fieldID != e; ++fieldID) {
+      auto info = type.getFieldIDInfo(fieldID);
+      EXPECT_EQ(info.type, fields[fieldID].type) << "field ID " << fieldID;
+      EXPECT_EQ(info.parentID, fields[fieldID].parentID)
+          << "field ID " << fieldID;
+      EXPECT_EQ(info.index, fields[fieldID].index) << "field ID " << fieldID;
+      EXPECT_EQ(type.getFieldType(fieldID), fields[fieldID].type);
+    }
+  }
+}
+} // namespace
+
+TEST_F(FIRRTLTypesTest, GroundType) {
+  auto type = uint(8);
+  auto info = type.getFieldIDInfo(0);
+  EXPECT_EQ(info.type, type);
+  EXPECT_EQ(info.parentID, 0u);
+  EXPECT_EQ(info.index, 0u);
+}
+
+TEST_F(FIRRTLTypesTest, FlatBundle) {
+  checkFieldIDInfo(bundle({{"a", uint(1)}, {"b", uint(2)}, {"c", uint(3)}}));
+}
+
+TEST_F(FIRRTLTypesTest, Vector) {
+  checkFieldIDInfo(FVectorType::get(uint(1), 4));
+  checkFieldIDInfo(FVectorType::get(FVectorType::get(uint(1), 3), 2));
+}
+
+TEST_F(FIRRTLTypesTest, NestedBundlesAndVectors) {
+  auto inner = bundle({{"a", uint(1)}, {"b", FVectorType::get(uint(2), 3)}});
+  auto outer = bundle({{"x", uint(1)},
+                       {"y", FVectorType::get(inner, 2)},
+                       {"z", inner},
+                       {"w", bundle({{"v", inner}})}});
+  checkFieldIDInfo(outer);
+  // The nested types describe their fields on their own as well.
+  checkFieldIDInfo(inner);
+  checkFieldIDInfo(FVectorType::get(outer, 3));
+}
+
+TEST_F(FIRRTLTypesTest, LargeBundle) {
+  // Too many nested fields for a table, the fields are found by descending
+  // into the elements.
+  auto inner = bundle({{"p", uint(1)}, {"q", FVectorType::get(uint(1), 2)}});
+  auto outer = bundle({{"a", uint(1)}, {"b", FVectorType::get(inner, 2000)}});
+  ASSERT_GT(outer.getMaxFieldID(), 4096u);
+  checkFieldIDInfo(outer);
+}
@@ -0,0 +1,143 @@
+//===- BackedgeBuilderTest.cpp - BackedgeBuilder unit tests ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "circt/Support/BackedgeBuilder.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+using namespace circt;
+
+namespace {
+class BackedgeBuilderTest : public ::testing::Test {
+protected:
+  BackedgeBuilderTest()
+      : loc(UnknownLoc::get(&context)), module(ModuleOp::create(loc)),
+        builder(OpBuilder::atBlockEnd(module->getBody())) {
+    context.allowUnregisteredDialects();
+  }
+
+  /// Create an op defining an i1 value.
+  Value def() {
+    OperationState state(loc, "test.def");
+    state.addTypes(builder.getI1Type());
+    return builder.createOperation(state)->getResult(0);
+  }
+
+  /// Create an op using `value`.
+  Operation *use(Value value) {
+    OperationState state(loc, "test.use");
+    state.addOperands(value);
+    return builder.createOperation(state);
+  }
+
+  MLIRContext context;
+  Location loc;
+  OwningModuleRef module;
+  OpBuilder builder;
+};
+} // namespace
+
+TEST_F(BackedgeBuilderTest, Default) {
+  Operation *user;
+  Value value;
+  {
+    BackedgeBuilder bb(builder, loc);
+    Backedge edge = bb.get(builder.getI1Type());
+    user = use(edge);
+    value = def();
+    edge.setValue(value);
+    EXPECT_EQ(user->getOperand(0), value);
+  }
+  EXPECT_EQ(user->getOperand(0), value);
+  // Only the ops of the test are left.
+  EXPECT_EQ(module->getBody()->getOperations().size(), 2u);
+}
+
+TEST_F(BackedgeBuilderTest, Bulk) {
+  Operation *user;
+  Value value;
+  {
+    BackedgeBuilder bb(builder, loc, /*bulk=*/true);
+    Backedge edge = bb.get(builder.getI1Type());
+    user = use(edge);
+    value = def();
+    edge.setValue(value);
+    EXPECT_EQ(static_cast<Value>(edge), value);
+    // The backedge ops are not in the IR, and the uses are only replaced on
+    // resolution.
+    EXPECT_EQ(module->getBody()->getOperations().size(), 2u);
+    EXPECT_NE(user->getOperand(0), value);
+    bb.resolve();
+    EXPECT_EQ(user->getOperand(0), value);
+
+    // Backedges may be assigned after a resolution.
+    Backedge late = bb.get(builder.getI1Type());
+    Operation *lateUser = use(late);
+    late.setValue(value);
+    bb.resolve();
+    EXPECT_EQ(lateUser->getOperand(0), value);
+  }
+  EXPECT_EQ(user->getOperand(0), value);
+}
+
+TEST_F(BackedgeBuilderTest, BulkChains) {
+  SmallVector<Operation *> users;
+  Value value;
+  {
+    BackedgeBuilder bb(builder, loc, /*bulk=*/true);
+    SmallVector<Backedge> edges;
+    for (unsigned i = 0; i != 5; ++i) {
+      edges.push_back(bb.get(builder.getI1Type()));
+      users.push_back(use(edges.back()));
+    }
+    // Each backedge is assigned the next one, in an order which does not
+    // follow the chain, and the last one a value. The destructor resolves
+    // them.
+    edges[1].setValue(edges[2]);
+    edges[0].setValue(edges[1]);
+    edges[3].setValue(edges[4]);
+    edges[2].setValue(edges[3]);
+    value = def();
+    edges[4].setValue(value);
+  }
+  for (Operation *user : users)
+    EXPECT_EQ(user->getOperand(0), value);
+}
+
+#if GTEST_HAS_DEATH_TEST && !defined(NDEBUG)
+TEST_F(BackedgeBuilderTest, BulkAssignedTwice) {
+  EXPECT_DEATH(
+      {
+        BackedgeBuilder bb(builder, loc, /*bulk=*/true);
+        Backedge a = bb.get(builder.getI1Type());
+        Backedge b = bb.get(builder.getI1Type());
+        a.setValue(b);
+        a.setValue(def());
+      },
+      "Backedge assigned twice in bulk mode");
+}
+
+TEST_F(BackedgeBuilderTest, BulkCycle) {
+  EXPECT_DEATH(
+      {
+        BackedgeBuilder bb(builder, loc, /*bulk=*/true);
+        Backedge a = bb.get(builder.getI1Type());
+        Backedge b = bb.get(builder.getI1Type());
+        Backedge c = bb.get(builder.getI1Type());
+        use(a);
+        a.setValue(b);
+        b.setValue(c);
+        c.setValue(a);
+        bb.resolve();
+      },
+      "Backedges assigned each other in a cycle");
+}
+#endif